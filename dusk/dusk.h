@@ -5,6 +5,7 @@
 extern "C" {
 #endif
 
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
@@ -13,6 +14,31 @@ typedef struct DuskCompiler DuskCompiler;
 DuskCompiler *duskCompilerCreate(void);
 void duskCompilerDestroy(DuskCompiler *compiler);
 
+// Called to get the text of a file imported with `import "path";` from the
+// file at importer_path. Sets *resolved_path to a path that identifies the
+// imported file, which is used as the key of the module cache, and *text to
+// its contents, which must stay valid until the compilation finishes.
+// Returns false if the file can't be found.
+typedef bool (*DuskImportCallback)(
+    void *user_data,
+    const char *importer_path,
+    const char *import_path,
+    const char **resolved_path,
+    const char **text,
+    size_t *text_length);
+
+// By default, imports are read from the file system, relative to the
+// directory of the importing file. Imported files are parsed and analyzed
+// once and cached by the compiler, they're only analyzed again when their
+// text or the text of the files they import changes.
+void duskCompilerSetImportCallback(
+    DuskCompiler *compiler, DuskImportCallback callback, void *user_data);
+
+// Sets the number of threads used to parse, analyze and generate code for
+// large files, even if there are fewer processors. Zero, the default, uses one
+// thread per processor. The output doesn't depend on the number of threads.
+void duskCompilerSetThreadCount(DuskCompiler *compiler, uint32_t thread_count);
+
 // Returns NULL if there was an error.
 uint8_t *duskCompile(
     DuskCompiler *compiler,
@@ -21,6 +47,66 @@ uint8_t *duskCompile(
     size_t text_length,
     size_t *spirv_byte_size);
 
+typedef struct DuskEntryPointModule {
+    // Name of the entry point in the module
+    const char *name;
+    uint8_t *spirv;
+    size_t spirv_byte_size;
+} DuskEntryPointModule;
+
+// Compiles a file into a separate SPIR-V module for each of its entry points,
+// in the order they're declared in. Each module only has what its entry point
+// uses. The file is parsed and analyzed once.
+// Returns NULL if there was an error, otherwise sets *module_count.
+DuskEntryPointModule *duskCompileEntryPoints(
+    DuskCompiler *compiler,
+    const char *path,
+    const char *text,
+    size_t text_length,
+    size_t *module_count);
+
+// Compiles the file from the last call to duskCompile or
+// duskCompileIncremental again after an edit, where the bytes in
+// [edit_offset, edit_offset + removed_length) of the previous text were
+// replaced by [edit_offset, edit_offset + inserted_length) of the new text.
+// Only the top level declarations touched by the edit and the ones that
+// depend on them are parsed and analyzed again, everything is compiled from
+// scratch if the last compilation failed.
+// The declarations that are kept point into the texts given to the earlier
+// calls, so every text given to duskCompile and duskCompileIncremental has to
+// stay alive as long as the compiler if this function is used.
+// Returns NULL if there was an error, or if nothing was compiled before.
+uint8_t *duskCompileIncremental(
+    DuskCompiler *compiler,
+    const char *text,
+    size_t text_length,
+    size_t edit_offset,
+    size_t removed_length,
+    size_t inserted_length,
+    size_t *spirv_byte_size);
+
+// Parses and analyzes a file containing declarations shared by many shaders,
+// such as structs and helper functions, and serializes them into a blob that
+// can be loaded with duskCompilerLoadPrelude. The file can't contain entry
+// points.
+// Returns NULL if there was an error.
+uint8_t *duskCompilePrelude(
+    DuskCompiler *compiler,
+    const char *path,
+    const char *text,
+    size_t text_length,
+    size_t *blob_byte_size);
+
+// Makes the declarations of a blob from duskCompilePrelude visible to the
+// files compiled afterwards, without parsing or analyzing them again. Only
+// the declarations a file uses end up in its SPIR-V. The blob is used in
+// place, so it must be 4 byte aligned and outlive the compiler.
+// Returns false if the blob is from another version of the compiler, or if it
+// was truncated or corrupted after it was written. The declarations in the
+// blob aren't type checked again, so it must come from duskCompilePrelude.
+bool duskCompilerLoadPrelude(
+    DuskCompiler *compiler, const uint8_t *blob, size_t blob_byte_size);
+
 // Builds a null-terminated string containing the error messages from the last
 // compilation.
 char *duskCompilerGetErrorsStringMalloc(DuskCompiler *compiler);
@@ -140,6 +140,96 @@ void duskArenaDestroy(DuskArena *arena)
     duskFree(arena->parent_allocator, arena);
 }
 
+#define DUSK_POOL_MIN_CHUNK_CAPACITY 16
+
+void duskPoolInit(DuskPool *pool, DuskAllocator *allocator, size_t item_size)
+{
+    *pool = (DuskPool){
+        .allocator = allocator,
+        .item_size = item_size,
+        .next_id = 1,
+        .end_id = UINT32_MAX,
+    };
+}
+
+void duskPoolInitShared(
+    DuskPool *pool,
+    DuskPool *owner,
+    DuskAllocator *allocator,
+    DuskMutex *mutex)
+{
+    *pool = (DuskPool){
+        .allocator = allocator,
+        .item_size = owner->item_size,
+        .chunks = owner->chunks,
+        .chunk_capacity = owner->chunk_capacity,
+        .owner = owner,
+        .mutex = mutex,
+    };
+}
+
+void duskPoolReserveChunks(DuskPool *pool, uint32_t chunk_count)
+{
+    uint64_t wanted_capacity =
+        ((uint64_t)pool->next_id >> DUSK_POOL_CHUNK_SHIFT) + 1 + chunk_count;
+    if (wanted_capacity > ((uint64_t)1 << (32 - DUSK_POOL_CHUNK_SHIFT))) {
+        wanted_capacity = (uint64_t)1 << (32 - DUSK_POOL_CHUNK_SHIFT);
+    }
+    if (wanted_capacity <= pool->chunk_capacity) return;
+
+    uint32_t new_capacity = pool->chunk_capacity * 2;
+    if (new_capacity < DUSK_POOL_MIN_CHUNK_CAPACITY) {
+        new_capacity = DUSK_POOL_MIN_CHUNK_CAPACITY;
+    }
+    if (new_capacity < wanted_capacity) {
+        new_capacity = (uint32_t)wanted_capacity;
+    }
+
+    uint8_t **chunks = DUSK_NEW_ARRAY(pool->allocator, uint8_t *, new_capacity);
+    if (pool->chunks) {
+        memcpy(chunks, pool->chunks, sizeof(uint8_t *) * pool->chunk_capacity);
+    }
+    pool->chunks = chunks;
+    pool->chunk_capacity = new_capacity;
+}
+
+uint32_t duskPoolAllocate(DuskPool *pool)
+{
+    if (pool->next_id == pool->end_id) {
+        if (!pool->owner) return 0;
+
+        // Take the next chunk that the owner hasn't started on
+        DuskPool *owner = pool->owner;
+        duskMutexLock(pool->mutex);
+        uint64_t chunk_index =
+            ((uint64_t)owner->next_id + DUSK_POOL_CHUNK_ITEMS - 1) >>
+            DUSK_POOL_CHUNK_SHIFT;
+        bool exhausted = chunk_index >= owner->chunk_capacity;
+        if (!exhausted) {
+            owner->next_id =
+                (uint32_t)(chunk_index + 1) << DUSK_POOL_CHUNK_SHIFT;
+            if (owner->next_id == 0) owner->next_id = owner->end_id;
+        }
+        duskMutexUnlock(pool->mutex);
+        if (exhausted) return 0;
+
+        pool->next_id = (uint32_t)chunk_index << DUSK_POOL_CHUNK_SHIFT;
+        pool->end_id = pool->next_id + DUSK_POOL_CHUNK_ITEMS;
+    }
+
+    uint32_t id = pool->next_id++;
+    uint32_t chunk_index = id >> DUSK_POOL_CHUNK_SHIFT;
+    if (chunk_index >= pool->chunk_capacity) {
+        duskPoolReserveChunks(pool, 1);
+    }
+    if (!pool->chunks[chunk_index]) {
+        pool->chunks[chunk_index] = (uint8_t *)duskAllocateZeroed(
+            pool->allocator, pool->item_size * DUSK_POOL_CHUNK_ITEMS);
+    }
+
+    return id;
+}
+
 const char *duskStrdup(DuskAllocator *allocator, const char *str)
 {
     size_t length = strlen(str);
@@ -71,70 +71,83 @@ static size_t DUSK_BUILTIN_FUNCTION_PARAM_COUNTS[DUSK_BUILTIN_FUNCTION_COUNT] =
 
 typedef struct DuskAnalyzerState {
     DuskArray(DuskScope *) scope_stack_arr;
-    DuskArray(DuskStmt *) break_stack_arr;
-    DuskArray(DuskStmt *) continue_stack_arr;
-    DuskArray(DuskDecl *) function_stack_arr;
+    DuskArray(DuskStmtId) break_stack_arr;
+    DuskArray(DuskStmtId) continue_stack_arr;
+    DuskArray(DuskDeclId) function_stack_arr;
     DuskArray(DuskStructLayout) struct_layout_stack_arr;
+    // Names looked up by the top level declaration being analyzed
+    DuskMap *referenced_names;
+    // Index of each top level declaration of the file by name, and the index
+    // of the one being analyzed, so that declarations can't be used before
+    // they appear
+    DuskFile *file;
+    DuskMap *decl_indices;
+    size_t decl_index;
 } DuskAnalyzerState;
 
 static void duskAnalyzeDecl(
-    DuskCompiler *compiler, DuskAnalyzerState *state, DuskDecl *decl);
+    DuskCompiler *compiler, DuskAnalyzerState *state, DuskDeclId decl_id);
+static void duskAnalyzeExpr(
+    DuskCompiler *compiler,
+    DuskAnalyzerState *state,
+    DuskExprId expr_id,
+    DuskType *expected_type,
+    bool must_be_assignable);
 static void duskTryRegisterDecl(
-    DuskCompiler *compiler, DuskAnalyzerState *state, DuskDecl *decl);
+    DuskCompiler *compiler, DuskAnalyzerState *state, DuskDeclId decl_id);
 
 DuskScope *duskScopeCreate(
     DuskAllocator *allocator,
     DuskScope *parent,
     DuskScopeOwnerType type,
-    void *owner)
+    uint32_t owner)
 {
-    DuskMap *map = duskMapCreate(allocator, 16);
-
     DuskScope *scope = DUSK_NEW(allocator, DuskScope);
     *scope = (DuskScope){
         .type = type,
-        .map = map,
         .parent = parent,
+        .allocator = allocator,
     };
     if (type != DUSK_SCOPE_OWNER_TYPE_NONE) {
-        DUSK_ASSERT(owner != NULL);
-        memcpy(&owner, &scope->owner, sizeof(void *));
+        DUSK_ASSERT(owner != 0);
+        scope->owner.decl = owner;
     } else {
-        DUSK_ASSERT(owner == NULL);
+        DUSK_ASSERT(owner == 0);
     }
     return scope;
 }
 
-DuskDecl *duskScopeLookupLocal(DuskScope *scope, const char *name)
+// The maps of the scopes hold declaration ids in place of pointers
+DuskDeclId duskScopeLookupLocal(DuskScope *scope, const char *name)
 {
     DUSK_ASSERT(scope != NULL);
 
-    DuskDecl *decl = NULL;
-    if (duskMapGet(scope->map, name, (void **)&decl)) {
-        DUSK_ASSERT(decl != NULL);
-        return decl;
+    void *decl_ptr = NULL;
+    if (scope->map && duskMapGet(scope->map, name, &decl_ptr)) {
+        DUSK_ASSERT(decl_ptr != NULL);
+        return (DuskDeclId)(uintptr_t)decl_ptr;
     }
 
-    return NULL;
+    return 0;
 }
 
-DuskDecl *duskScopeLookup(DuskScope *scope, const char *name)
+DuskDeclId duskScopeLookup(DuskScope *scope, const char *name)
 {
-    DuskDecl *decl = duskScopeLookupLocal(scope, name);
-    if (decl) return decl;
-
-    if (scope->parent) {
-        DuskDecl *decl = duskScopeLookup(scope->parent, name);
-        if (decl) return decl;
+    for (; scope; scope = scope->parent) {
+        DuskDeclId decl_id = duskScopeLookupLocal(scope, name);
+        if (decl_id) return decl_id;
     }
 
-    return NULL;
+    return 0;
 }
 
-void duskScopeSet(DuskScope *scope, const char *name, DuskDecl *decl)
+void duskScopeSet(DuskScope *scope, const char *name, DuskDeclId decl_id)
 {
-    DUSK_ASSERT(decl != NULL);
-    duskMapSet(scope->map, name, decl);
+    DUSK_ASSERT(decl_id != 0);
+    if (!scope->map) {
+        scope->map = duskMapCreate(scope->allocator, 8);
+    }
+    duskMapSet(scope->map, name, (void *)(uintptr_t)decl_id);
 }
 
 static DuskScope *duskCurrentScope(DuskAnalyzerState *state)
@@ -143,59 +156,107 @@ static DuskScope *duskCurrentScope(DuskAnalyzerState *state)
     return state->scope_stack_arr[duskArrayLength(state->scope_stack_arr) - 1];
 }
 
-static void duskConcretizeExprType(DuskExpr *expr, DuskType *expected_type)
+static DuskDeclId
+duskLookupIdentifier(DuskAnalyzerState *state, const char *name)
+{
+    if (state->referenced_names) {
+        duskMapSet(state->referenced_names, name, NULL);
+    }
+    return duskScopeLookup(duskCurrentScope(state), name);
+}
+
+static bool duskIsDeclaredLater(
+    DuskCompiler *compiler, DuskAnalyzerState *state, DuskDeclId decl_id)
+{
+    void *index_ptr = NULL;
+    if (!state->decl_indices ||
+        !duskMapGet(
+            state->decl_indices,
+            duskDeclGet(compiler, decl_id)->name,
+            &index_ptr)) {
+        return false;
+    }
+
+    size_t index = (size_t)(uintptr_t)index_ptr;
+    return state->file->decls_arr[index] == decl_id &&
+           index > state->decl_index;
+}
+
+static void duskConcretizeExprType(
+    DuskCompiler *compiler, DuskExprId expr_id, DuskType *expected_type)
 {
     if (!expected_type) return;
     if (expected_type->kind != DUSK_TYPE_INT &&
         expected_type->kind != DUSK_TYPE_FLOAT)
         return;
-    if (!expr->type) return;
+    DuskType **type = &compiler->expr_types_arr[expr_id];
+    if (!*type) return;
+
+    // The value might have been evaluated with the untyped type
+    compiler->expr_const_values_arr[expr_id] = NULL;
 
+    DuskExpr *expr = duskExprGet(compiler, expr_id);
     switch (expr->kind) {
+    case DUSK_EXPR_IDENT: {
+        if (!expr->identifier.decl) break;
+        DuskDecl *decl = duskDeclGet(compiler, expr->identifier.decl);
+        if (decl->kind != DUSK_DECL_CONST) break;
+
+        if (((*type)->kind == DUSK_TYPE_UNTYPED_INT &&
+             (expected_type->kind == DUSK_TYPE_INT ||
+              expected_type->kind == DUSK_TYPE_FLOAT)) ||
+            ((*type)->kind == DUSK_TYPE_UNTYPED_FLOAT &&
+             expected_type->kind == DUSK_TYPE_FLOAT)) {
+            *type = expected_type;
+        }
+        break;
+    }
     case DUSK_EXPR_INT_LITERAL: {
-        if (expr->type->kind == DUSK_TYPE_UNTYPED_INT &&
+        if ((*type)->kind == DUSK_TYPE_UNTYPED_INT &&
             (expected_type->kind == DUSK_TYPE_INT ||
              expected_type->kind == DUSK_TYPE_FLOAT)) {
-            expr->type = expected_type;
+            *type = expected_type;
         }
         break;
     }
     case DUSK_EXPR_FLOAT_LITERAL: {
-        if (expr->type->kind == DUSK_TYPE_UNTYPED_FLOAT &&
+        if ((*type)->kind == DUSK_TYPE_UNTYPED_FLOAT &&
             expected_type->kind == DUSK_TYPE_FLOAT) {
-            expr->type = expected_type;
+            *type = expected_type;
         }
         break;
     }
 
     case DUSK_EXPR_UNARY: {
-        if (expr->type->kind == DUSK_TYPE_UNTYPED_INT &&
+        if ((*type)->kind == DUSK_TYPE_UNTYPED_INT &&
             (expected_type->kind == DUSK_TYPE_INT ||
              expected_type->kind == DUSK_TYPE_FLOAT)) {
-            expr->type = expected_type;
-            duskConcretizeExprType(expr->unary.right, expected_type);
+            *type = expected_type;
+            duskConcretizeExprType(compiler, expr->unary.right, expected_type);
         } else if (
-            expr->type->kind == DUSK_TYPE_UNTYPED_FLOAT &&
+            (*type)->kind == DUSK_TYPE_UNTYPED_FLOAT &&
             expected_type->kind == DUSK_TYPE_FLOAT) {
-            expr->type = expected_type;
-            duskConcretizeExprType(expr->unary.right, expected_type);
+            *type = expected_type;
+            duskConcretizeExprType(compiler, expr->unary.right, expected_type);
         }
         break;
     }
 
     case DUSK_EXPR_BINARY: {
-        if (expr->type->kind == DUSK_TYPE_UNTYPED_INT &&
+        if ((*type)->kind == DUSK_TYPE_UNTYPED_INT &&
             (expected_type->kind == DUSK_TYPE_INT ||
              expected_type->kind == DUSK_TYPE_FLOAT)) {
-            expr->type = expected_type;
-            duskConcretizeExprType(expr->binary.left, expected_type);
-            duskConcretizeExprType(expr->binary.right, expected_type);
+            *type = expected_type;
+            duskConcretizeExprType(compiler, expr->binary.left, expected_type);
+            duskConcretizeExprType(
+                compiler, expr->binary.right, expected_type);
         } else if (
-            expr->type->kind == DUSK_TYPE_UNTYPED_FLOAT &&
+            (*type)->kind == DUSK_TYPE_UNTYPED_FLOAT &&
             expected_type->kind == DUSK_TYPE_FLOAT) {
-            expr->type = expected_type;
-            duskConcretizeExprType(expr->binary.left, expected_type);
-            duskConcretizeExprType(expr->binary.right, expected_type);
+            *type = expected_type;
+            duskConcretizeExprType(compiler, expr->binary.left, expected_type);
+            duskConcretizeExprType(
+                compiler, expr->binary.right, expected_type);
         }
         break;
     }
@@ -205,71 +266,47 @@ static void duskConcretizeExprType(DuskExpr *expr, DuskType *expected_type)
 }
 
 static bool duskExprResolveInteger(
-    DuskAnalyzerState *state, DuskExpr *expr, int64_t *out_int)
+    DuskCompiler *compiler, DuskExprId expr_id, int64_t *out_int)
 {
-    switch (expr->kind) {
-    case DUSK_EXPR_INT_LITERAL: {
-        *out_int = expr->int_literal;
-        return true;
-    }
-    case DUSK_EXPR_IDENT: {
-        DuskDecl *ident_decl =
-            duskScopeLookup(duskCurrentScope(state), expr->identifier.str);
-        if (!ident_decl) {
-            return false;
-        }
-
-        switch (ident_decl->kind) {
-        // TODO: add resolve integer for constants
-        default: return false;
-        }
-
-        return false;
-    }
-
-    case DUSK_EXPR_UNARY: {
-        // TOOD: resolve integer for unary expression
-        return false;
-    }
+    DuskAllocator *allocator = duskArenaGetAllocator(compiler->main_arena);
+    return duskConstToInteger(
+        duskConstEvaluate(compiler, allocator, expr_id), out_int);
+}
 
-    case DUSK_EXPR_BINARY: {
-        // TOOD: resolve integer for binary expression
-        return false;
-    }
+// Some attribute values are bare names, like the stage of an entry point, so
+// only the values that refer to declarations in scope are analyzed
+static void duskAnalyzeAttributes(
+    DuskCompiler *compiler,
+    DuskAnalyzerState *state,
+    DuskArray(DuskAttribute) attributes_arr)
+{
+    for (size_t i = 0; i < duskArrayLength(attributes_arr); ++i) {
+        DuskAttribute *attribute = &attributes_arr[i];
 
-    case DUSK_EXPR_ARRAY_ACCESS:
-    case DUSK_EXPR_STRUCT_LITERAL:
-    case DUSK_EXPR_ARRAY_LITERAL:
-    case DUSK_EXPR_ACCESS:
-    case DUSK_EXPR_FUNCTION_CALL:
-    case DUSK_EXPR_BUILTIN_FUNCTION_CALL:
-    case DUSK_EXPR_BOOL_LITERAL:
-    case DUSK_EXPR_STRING_LITERAL:
-    case DUSK_EXPR_FLOAT_LITERAL:
-    case DUSK_EXPR_ARRAY_TYPE:
-    case DUSK_EXPR_MATRIX_TYPE:
-    case DUSK_EXPR_VECTOR_TYPE:
-    case DUSK_EXPR_SCALAR_TYPE:
-    case DUSK_EXPR_BOOL_TYPE:
-    case DUSK_EXPR_VOID_TYPE:
-    case DUSK_EXPR_PTR_TYPE:
-    case DUSK_EXPR_RUNTIME_ARRAY_TYPE:
-    case DUSK_EXPR_STRUCT_TYPE: {
-        return false;
-    }
+        for (size_t j = 0; j < attribute->value_expr_count; ++j) {
+            DuskExprId value_expr_id = attribute->value_exprs[j];
+            DuskExpr *value_expr = duskExprGet(compiler, value_expr_id);
+            if (value_expr->kind == DUSK_EXPR_IDENT &&
+                !duskScopeLookup(
+                    duskCurrentScope(state), value_expr->identifier.str)) {
+                continue;
+            }
+            duskAnalyzeExpr(compiler, state, value_expr_id, NULL, false);
+        }
     }
-
-    return false;
 }
 
-static bool duskIsExprAssignable(DuskAnalyzerState *state, DuskExpr *expr)
+static bool duskIsExprAssignable(
+    DuskCompiler *compiler, DuskAnalyzerState *state, DuskExprId expr_id)
 {
+    DuskExpr *expr = duskExprGet(compiler, expr_id);
     switch (expr->kind) {
     case DUSK_EXPR_IDENT: {
         DuskScope *scope = duskCurrentScope(state);
 
-        DuskDecl *decl = duskScopeLookup(scope, expr->identifier.str);
-        if (!decl) return false;
+        DuskDeclId decl_id = duskScopeLookup(scope, expr->identifier.str);
+        if (!decl_id) return false;
+        DuskDecl *decl = duskDeclGet(compiler, decl_id);
 
         if (decl->kind == DUSK_DECL_VAR) {
             switch (decl->var.storage_class) {
@@ -289,10 +326,10 @@ static bool duskIsExprAssignable(DuskAnalyzerState *state, DuskExpr *expr)
         break;
     }
     case DUSK_EXPR_ACCESS: {
-        return duskIsExprAssignable(state, expr->access.base_expr);
+        return duskIsExprAssignable(compiler, state, expr->access.base_expr);
     }
     case DUSK_EXPR_ARRAY_ACCESS: {
-        return duskIsExprAssignable(state, expr->access.base_expr);
+        return duskIsExprAssignable(compiler, state, expr->access.base_expr);
     }
     default: {
         break;
@@ -312,6 +349,10 @@ static const char *duskGetAttributeName(DuskAttributeKind kind)
     case DUSK_ATTRIBUTE_OFFSET: return "offset";
     case DUSK_ATTRIBUTE_STAGE: return "stage";
     case DUSK_ATTRIBUTE_READ_ONLY: return "read_only";
+    case DUSK_ATTRIBUTE_INLINE: return "inline";
+    case DUSK_ATTRIBUTE_NOINLINE: return "noinline";
+    case DUSK_ATTRIBUTE_UNROLL: return "unroll";
+    case DUSK_ATTRIBUTE_DONT_UNROLL: return "dont_unroll";
     case DUSK_ATTRIBUTE_UNKNOWN: return "<unknown>";
     }
     return "<unknown>";
@@ -364,7 +405,7 @@ static void duskCheckGlobalVariableAttributes(
         } else {
             int64_t resolved_int;
             if (!duskExprResolveInteger(
-                    state, set_attribute->value_exprs[0], &resolved_int)) {
+                    compiler, set_attribute->value_exprs[0], &resolved_int)) {
                 duskAddError(
                     compiler,
                     var_decl->location,
@@ -382,7 +423,9 @@ static void duskCheckGlobalVariableAttributes(
         } else {
             int64_t resolved_int;
             if (!duskExprResolveInteger(
-                    state, binding_attribute->value_exprs[0], &resolved_int)) {
+                    compiler,
+                    binding_attribute->value_exprs[0],
+                    &resolved_int)) {
                 duskAddError(
                     compiler,
                     var_decl->location,
@@ -428,7 +471,6 @@ static void duskCheckGlobalVariableAttributes(
 }
 
 static void duskCheckEntryPointInterfaceAttributes(
-    DuskAnalyzerState *state,
     DuskCompiler *compiler,
     DuskLocation location,
     DuskArray(DuskAttribute) attributes_arr)
@@ -467,7 +509,9 @@ static void duskCheckEntryPointInterfaceAttributes(
         } else {
             int64_t resolved_int;
             if (!duskExprResolveInteger(
-                    state, location_attribute->value_exprs[0], &resolved_int)) {
+                    compiler,
+                    location_attribute->value_exprs[0],
+                    &resolved_int)) {
                 duskAddError(
                     compiler,
                     location,
@@ -480,7 +524,9 @@ static void duskCheckEntryPointInterfaceAttributes(
                 compiler,
                 location,
                 "'builtin' attribute requires exactly 1 parameter");
-        } else if (builtin_attribute->value_exprs[0]->kind != DUSK_EXPR_IDENT) {
+        } else if (
+            duskExprGet(compiler, builtin_attribute->value_exprs[0])->kind !=
+            DUSK_EXPR_IDENT) {
             duskAddError(
                 compiler,
                 location,
@@ -608,46 +654,50 @@ static void duskCheckIfTypeHasBlockDecoration(
 static void duskAnalyzeExpr(
     DuskCompiler *compiler,
     DuskAnalyzerState *state,
-    DuskExpr *expr,
+    DuskExprId expr_id,
     DuskType *expected_type,
     bool must_be_assignable)
 {
     DuskAllocator *allocator = duskArenaGetAllocator(compiler->main_arena);
 
+    DuskExpr *expr = duskExprGet(compiler, expr_id);
+    DuskType **expr_type = &compiler->expr_types_arr[expr_id];
+    DuskType **expr_as_type = &compiler->expr_as_types_arr[expr_id];
+
     switch (expr->kind) {
     case DUSK_EXPR_VOID_TYPE: {
-        expr->type = duskTypeNewBasic(compiler, DUSK_TYPE_TYPE);
-        expr->as_type = duskTypeNewBasic(compiler, DUSK_TYPE_VOID);
+        *expr_type = duskTypeNewBasic(compiler, DUSK_TYPE_TYPE);
+        *expr_as_type = duskTypeNewBasic(compiler, DUSK_TYPE_VOID);
         break;
     }
     case DUSK_EXPR_BOOL_TYPE: {
-        expr->type = duskTypeNewBasic(compiler, DUSK_TYPE_TYPE);
-        expr->as_type = duskTypeNewBasic(compiler, DUSK_TYPE_BOOL);
+        *expr_type = duskTypeNewBasic(compiler, DUSK_TYPE_TYPE);
+        *expr_as_type = duskTypeNewBasic(compiler, DUSK_TYPE_BOOL);
         break;
     }
     case DUSK_EXPR_STRING_LITERAL: {
-        expr->type = duskTypeNewBasic(compiler, DUSK_TYPE_STRING);
+        *expr_type = duskTypeNewBasic(compiler, DUSK_TYPE_STRING);
         break;
     }
     case DUSK_EXPR_FLOAT_LITERAL: {
         if (expected_type && expected_type->kind == DUSK_TYPE_FLOAT) {
-            expr->type = expected_type;
+            *expr_type = expected_type;
         } else {
-            expr->type = duskTypeNewBasic(compiler, DUSK_TYPE_UNTYPED_FLOAT);
+            *expr_type = duskTypeNewBasic(compiler, DUSK_TYPE_UNTYPED_FLOAT);
         }
         break;
     }
     case DUSK_EXPR_INT_LITERAL: {
         if (expected_type && (expected_type->kind == DUSK_TYPE_INT ||
                               expected_type->kind == DUSK_TYPE_FLOAT)) {
-            expr->type = expected_type;
+            *expr_type = expected_type;
         } else {
-            expr->type = duskTypeNewBasic(compiler, DUSK_TYPE_UNTYPED_INT);
+            *expr_type = duskTypeNewBasic(compiler, DUSK_TYPE_UNTYPED_INT);
         }
         break;
     }
     case DUSK_EXPR_BOOL_LITERAL: {
-        expr->type = duskTypeNewBasic(compiler, DUSK_TYPE_BOOL);
+        *expr_type = duskTypeNewBasic(compiler, DUSK_TYPE_BOOL);
         break;
     }
     case DUSK_EXPR_STRUCT_LITERAL: {
@@ -656,7 +706,8 @@ static void duskAnalyzeExpr(
         duskAnalyzeExpr(
             compiler, state, expr->struct_literal.type_expr, type_type, false);
 
-        DuskType *struct_type = expr->struct_literal.type_expr->as_type;
+        DuskType *struct_type =
+            compiler->expr_as_types_arr[expr->struct_literal.type_expr];
         if (!struct_type) {
             DUSK_ASSERT(duskArrayLength(compiler->errors_arr) > 0);
             break;
@@ -730,7 +781,7 @@ static void duskAnalyzeExpr(
                 false);
         }
 
-        expr->type = struct_type;
+        *expr_type = struct_type;
 
         break;
     }
@@ -740,7 +791,8 @@ static void duskAnalyzeExpr(
         duskAnalyzeExpr(
             compiler, state, expr->array_literal.type_expr, type_type, false);
 
-        DuskType *array_type = expr->array_literal.type_expr->as_type;
+        DuskType *array_type =
+            compiler->expr_as_types_arr[expr->array_literal.type_expr];
         if (!array_type) {
             DUSK_ASSERT(duskArrayLength(compiler->errors_arr) > 0);
             break;
@@ -756,7 +808,7 @@ static void duskAnalyzeExpr(
                     array_type->struct_.field_count,
                     duskTypeToPrettyString(allocator, array_type));
             }
-            expr->type = array_type;
+            *expr_type = array_type;
             break;
         }
 
@@ -769,7 +821,7 @@ static void duskAnalyzeExpr(
             break;
         }
 
-        expr->type = array_type;
+        *expr_type = array_type;
 
         if (array_type->array.size !=
             duskArrayLength(expr->array_literal.field_values_arr)) {
@@ -798,9 +850,9 @@ static void duskAnalyzeExpr(
         break;
     }
     case DUSK_EXPR_IDENT: {
-        DuskDecl *ident_decl =
-            duskScopeLookup(duskCurrentScope(state), expr->identifier.str);
-        if (!ident_decl) {
+        DuskDeclId ident_decl_id =
+            duskLookupIdentifier(state, expr->identifier.str);
+        if (!ident_decl_id) {
             duskAddError(
                 compiler,
                 expr->location,
@@ -809,32 +861,47 @@ static void duskAnalyzeExpr(
             break;
         }
 
-        expr->identifier.decl = ident_decl;
+        if (duskIsDeclaredLater(compiler, state, ident_decl_id)) {
+            duskAddError(
+                compiler,
+                expr->location,
+                "'%s' is used before its declaration",
+                expr->identifier.str);
+            break;
+        }
+
+        expr->identifier.decl = ident_decl_id;
 
-        expr->type = ident_decl->type;
-        if (!expr->type) {
+        DuskDecl *ident_decl = duskDeclGet(compiler, ident_decl_id);
+        *expr_type = compiler->decl_types_arr[ident_decl_id];
+        if (!*expr_type) {
             DUSK_ASSERT(duskArrayLength(compiler->errors_arr) > 0);
         }
 
         if (ident_decl->kind == DUSK_DECL_TYPE) {
-            expr->as_type = ident_decl->typedef_.type_expr->as_type;
-            if (!expr->as_type) {
+            *expr_as_type =
+                compiler->expr_as_types_arr[ident_decl->typedef_.type_expr];
+            if (!*expr_as_type) {
                 DUSK_ASSERT(duskArrayLength(compiler->errors_arr) > 0);
             }
         }
+
+        if (ident_decl->kind == DUSK_DECL_CONST) {
+            duskConcretizeExprType(compiler, expr_id, expected_type);
+        }
         break;
     }
     case DUSK_EXPR_SCALAR_TYPE: {
-        expr->type = duskTypeNewBasic(compiler, DUSK_TYPE_TYPE);
-        expr->as_type = duskTypeNewScalar(compiler, expr->scalar_type);
+        *expr_type = duskTypeNewBasic(compiler, DUSK_TYPE_TYPE);
+        *expr_as_type = duskTypeNewScalar(compiler, expr->scalar_type);
         break;
     }
     case DUSK_EXPR_VECTOR_TYPE: {
         DuskType *scalar_type =
             duskTypeNewScalar(compiler, expr->vector_type.scalar_type);
 
-        expr->type = duskTypeNewBasic(compiler, DUSK_TYPE_TYPE);
-        expr->as_type =
+        *expr_type = duskTypeNewBasic(compiler, DUSK_TYPE_TYPE);
+        *expr_as_type =
             duskTypeNewVector(compiler, scalar_type, expr->vector_type.length);
         break;
     }
@@ -844,8 +911,8 @@ static void duskAnalyzeExpr(
         DuskType *col_type =
             duskTypeNewVector(compiler, scalar_type, expr->matrix_type.rows);
 
-        expr->type = duskTypeNewBasic(compiler, DUSK_TYPE_TYPE);
-        expr->as_type =
+        *expr_type = duskTypeNewBasic(compiler, DUSK_TYPE_TYPE);
+        *expr_as_type =
             duskTypeNewMatrix(compiler, col_type, expr->matrix_type.cols);
         break;
     }
@@ -859,10 +926,10 @@ static void duskAnalyzeExpr(
 
         int64_t array_size = 0;
         if (!duskExprResolveInteger(
-                state, expr->array_type.size_expr, &array_size)) {
+                compiler, expr->array_type.size_expr, &array_size)) {
             duskAddError(
                 compiler,
-                expr->array_type.size_expr->location,
+                duskExprGet(compiler, expr->array_type.size_expr)->location,
                 "failed to resolve integer for array size expression");
             break;
         }
@@ -870,12 +937,13 @@ static void duskAnalyzeExpr(
         if (array_size <= 0) {
             duskAddError(
                 compiler,
-                expr->array_type.size_expr->location,
+                duskExprGet(compiler, expr->array_type.size_expr)->location,
                 "array size must be greater than 0");
             break;
         }
 
-        DuskType *sub_type = expr->array_type.sub_expr->as_type;
+        DuskType *sub_type =
+            compiler->expr_as_types_arr[expr->array_type.sub_expr];
         if (!sub_type) {
             break;
         }
@@ -886,11 +954,11 @@ static void duskAnalyzeExpr(
                          [duskArrayLength(state->struct_layout_stack_arr) - 1];
         }
 
-        expr->type = type_type;
-        expr->as_type =
+        *expr_type = type_type;
+        *expr_as_type =
             duskTypeNewArray(compiler, layout, sub_type, (size_t)array_size);
 
-        duskCheckSubtypeLayouts(compiler, expr->location, expr->as_type);
+        duskCheckSubtypeLayouts(compiler, expr->location, *expr_as_type);
         break;
     }
     case DUSK_EXPR_RUNTIME_ARRAY_TYPE: {
@@ -899,7 +967,8 @@ static void duskAnalyzeExpr(
         duskAnalyzeExpr(
             compiler, state, expr->array_type.sub_expr, type_type, false);
 
-        DuskType *sub_type = expr->array_type.sub_expr->as_type;
+        DuskType *sub_type =
+            compiler->expr_as_types_arr[expr->array_type.sub_expr];
         if (!sub_type) {
             break;
         }
@@ -910,10 +979,10 @@ static void duskAnalyzeExpr(
                          [duskArrayLength(state->struct_layout_stack_arr) - 1];
         }
 
-        expr->type = type_type;
-        expr->as_type = duskTypeNewRuntimeArray(compiler, layout, sub_type);
+        *expr_type = type_type;
+        *expr_as_type = duskTypeNewRuntimeArray(compiler, layout, sub_type);
 
-        duskCheckSubtypeLayouts(compiler, expr->location, expr->as_type);
+        duskCheckSubtypeLayouts(compiler, expr->location, *expr_as_type);
         break;
     }
     case DUSK_EXPR_PTR_TYPE: {
@@ -921,14 +990,15 @@ static void duskAnalyzeExpr(
 
         duskAnalyzeExpr(
             compiler, state, expr->ptr_type.sub_expr, type_type, false);
-        DuskType *sub_type = expr->ptr_type.sub_expr->as_type;
+        DuskType *sub_type =
+            compiler->expr_as_types_arr[expr->ptr_type.sub_expr];
         if (!sub_type) {
             DUSK_ASSERT(duskArrayLength(compiler->errors_arr) > 0);
             break;
         }
 
-        expr->type = type_type;
-        expr->as_type = duskTypeNewPointer(
+        *expr_type = type_type;
+        *expr_as_type = duskTypeNewPointer(
             compiler,
             sub_type,
             expr->ptr_type.storage_class,
@@ -939,11 +1009,12 @@ static void duskAnalyzeExpr(
         DuskStructLayout struct_layout = DUSK_STRUCT_LAYOUT_UNKNOWN;
         bool is_block = false;
 
-        DuskMap *param_map = duskMapCreate(NULL, expr->struct_type.param_count);
+        DuskMap *param_map =
+            duskMapCreate(NULL, expr->struct_type->param_count);
         bool got_duplicate_params = false;
 
-        for (size_t i = 0; i < expr->struct_type.param_count; ++i) {
-            const char *param = expr->struct_type.params[i];
+        for (size_t i = 0; i < expr->struct_type->param_count; ++i) {
+            const char *param = expr->struct_type->params[i];
 
             if (duskMapGet(param_map, param, NULL)) {
                 got_duplicate_params = true;
@@ -997,43 +1068,29 @@ static void duskAnalyzeExpr(
             break;
         }
 
-        for (size_t i = 0; i < expr->struct_type.field_count; ++i) {
-            DuskArray(DuskAttribute) field_attributes_arr =
-                expr->struct_type.field_attribute_arrays[i];
-
-            for (size_t j = 0; j < duskArrayLength(field_attributes_arr); ++j) {
-                DuskAttribute *attribute = &field_attributes_arr[j];
-
-                for (size_t k = 0; k < attribute->value_expr_count; ++k) {
-                    DuskExpr *value_expr = attribute->value_exprs[k];
-                    int64_t resolved_int;
-                    if (duskExprResolveInteger(
-                            state, value_expr, &resolved_int)) {
-                        value_expr->resolved_int =
-                            duskAllocateZeroed(allocator, sizeof(int64_t));
-                        *value_expr->resolved_int = resolved_int;
-                    }
-                }
-            }
+        for (size_t i = 0; i < expr->struct_type->field_count; ++i) {
+            duskAnalyzeAttributes(
+                compiler, state, expr->struct_type->field_attribute_arrays[i]);
         }
 
-        size_t field_count = expr->struct_type.field_count;
+        size_t field_count = expr->struct_type->field_count;
 
         bool got_duplicate_field_names = false;
 
         DuskMap *field_map = duskMapCreate(NULL, field_count);
 
         for (size_t i = 0; i < field_count; ++i) {
-            if (duskMapGet(field_map, expr->struct_type.field_names[i], NULL)) {
+            if (duskMapGet(
+                    field_map, expr->struct_type->field_names[i], NULL)) {
                 duskAddError(
                     compiler,
                     expr->location,
                     "duplicate struct member name: '%s'",
-                    expr->struct_type.field_names[i]);
+                    expr->struct_type->field_names[i]);
                 got_duplicate_field_names = true;
                 continue;
             }
-            duskMapSet(field_map, expr->struct_type.field_names[i], NULL);
+            duskMapSet(field_map, expr->struct_type->field_names[i], NULL);
         }
 
         duskMapDestroy(field_map);
@@ -1053,13 +1110,13 @@ static void duskAnalyzeExpr(
         duskArrayPush(&state->struct_layout_stack_arr, struct_layout);
 
         for (size_t i = 0; i < field_count; ++i) {
-            DuskExpr *field_type_expr = expr->struct_type.field_type_exprs[i];
+            DuskExprId field_type_expr = expr->struct_type->field_type_exprs[i];
             duskAnalyzeExpr(compiler, state, field_type_expr, type_type, false);
-            if (!field_type_expr->as_type) {
+            if (!compiler->expr_as_types_arr[field_type_expr]) {
                 got_all_field_types = false;
                 break;
             }
-            field_types[i] = field_type_expr->as_type;
+            field_types[i] = compiler->expr_as_types_arr[field_type_expr];
         }
 
         duskArrayPop(&state->struct_layout_stack_arr);
@@ -1075,31 +1132,33 @@ static void duskAnalyzeExpr(
                 (i != (field_count - 1))) {
                 // Runtime array cannot be in the middle of a struct, only at
                 // the end
+                DuskExprId field_type_expr =
+                    expr->struct_type->field_type_exprs[i];
                 duskAddError(
                     compiler,
-                    expr->struct_type.field_type_exprs[i]->location,
+                    duskExprGet(compiler, field_type_expr)->location,
                     "runtime-sized arrays can only be at the end of a struct");
             }
         }
 
-        expr->type = type_type;
-        expr->as_type = duskTypeNewStruct(
+        *expr_type = type_type;
+        *expr_as_type = duskTypeNewStruct(
             compiler,
-            expr->struct_type.name,
+            expr->struct_type->name,
             struct_layout,
             is_block,
-            expr->struct_type.field_count,
-            expr->struct_type.field_names,
+            expr->struct_type->field_count,
+            expr->struct_type->field_names,
             field_types,
-            expr->struct_type.field_attribute_arrays);
+            expr->struct_type->field_attribute_arrays);
 
-        duskCheckSubtypeLayouts(compiler, expr->location, expr->as_type);
+        duskCheckSubtypeLayouts(compiler, expr->location, *expr_as_type);
 
-        if (expr->as_type->struct_.is_block) {
+        if ((*expr_as_type)->struct_.is_block) {
             duskTraverseSubTypes(
                 compiler,
                 expr->location,
-                expr->as_type,
+                *expr_as_type,
                 duskCheckIfTypeHasBlockDecoration);
         }
 
@@ -1108,16 +1167,17 @@ static void duskAnalyzeExpr(
     case DUSK_EXPR_FUNCTION_CALL: {
         duskAnalyzeExpr(
             compiler, state, expr->function_call.func_expr, NULL, false);
-        if (!expr->function_call.func_expr->type) {
+        if (!compiler->expr_types_arr[expr->function_call.func_expr]) {
             DUSK_ASSERT(duskArrayLength(compiler->errors_arr) > 0);
             break;
         }
 
-        DuskType *func_type = expr->function_call.func_expr->type;
+        DuskType *func_type =
+            compiler->expr_types_arr[expr->function_call.func_expr];
         switch (func_type->kind) {
         case DUSK_TYPE_FUNCTION: {
-            expr->type = func_type->function.return_type;
-            DUSK_ASSERT(expr->type);
+            *expr_type = func_type->function.return_type;
+            DUSK_ASSERT(*expr_type);
 
             if (duskArrayLength(expr->function_call.params_arr) !=
                 func_type->function.param_type_count) {
@@ -1134,7 +1194,7 @@ static void duskAnalyzeExpr(
             for (size_t i = 0;
                  i < duskArrayLength(expr->function_call.params_arr);
                  ++i) {
-                DuskExpr *param = expr->function_call.params_arr[i];
+                DuskExprId param = expr->function_call.params_arr[i];
                 DuskType *expected_param_type =
                     func_type->function.param_types[i];
                 duskAnalyzeExpr(
@@ -1143,9 +1203,10 @@ static void duskAnalyzeExpr(
             break;
         }
         case DUSK_TYPE_TYPE: {
-            DuskType *constructed_type = expr->function_call.func_expr->as_type;
+            DuskType *constructed_type =
+                compiler->expr_as_types_arr[expr->function_call.func_expr];
             DUSK_ASSERT(constructed_type);
-            expr->type = constructed_type;
+            *expr_type = constructed_type;
 
             size_t param_count =
                 duskArrayLength(expr->function_call.params_arr);
@@ -1164,20 +1225,20 @@ static void duskAnalyzeExpr(
                     break;
                 }
 
-                DuskExpr *param = expr->function_call.params_arr[0];
+                DuskExprId param = expr->function_call.params_arr[0];
                 duskAnalyzeExpr(compiler, state, param, NULL, false);
-                duskConcretizeExprType(param, constructed_type);
+                duskConcretizeExprType(compiler, param, constructed_type);
 
-                if (!param->type) {
+                if (!compiler->expr_types_arr[param]) {
                     DUSK_ASSERT(duskArrayLength(compiler->errors_arr) > 0);
                     break;
                 }
 
-                if (param->type->kind != DUSK_TYPE_FLOAT &&
-                    param->type->kind != DUSK_TYPE_INT) {
+                if (compiler->expr_types_arr[param]->kind != DUSK_TYPE_FLOAT &&
+                    compiler->expr_types_arr[param]->kind != DUSK_TYPE_INT) {
                     duskAddError(
                         compiler,
-                        param->location,
+                        duskExprGet(compiler, param)->location,
                         "expected a scalar parameter for '%s' constructor",
                         duskTypeToPrettyString(allocator, constructed_type));
                     break;
@@ -1192,28 +1253,29 @@ static void duskAnalyzeExpr(
                 bool analyzed_all_params = true;
 
                 for (size_t i = 0; i < param_count; ++i) {
-                    DuskExpr *param = expr->function_call.params_arr[i];
+                    DuskExprId param = expr->function_call.params_arr[i];
                     duskAnalyzeExpr(compiler, state, param, NULL, false);
 
-                    if (!param->type) {
+                    if (!compiler->expr_types_arr[param]) {
                         analyzed_all_params = false;
                         continue;
                     }
 
-                    duskConcretizeExprType(param, elem_type);
+                    duskConcretizeExprType(compiler, param, elem_type);
 
-                    if (param->type == elem_type) {
+                    DuskType *param_type = compiler->expr_types_arr[param];
+                    if (param_type == elem_type) {
                         elem_count += 1;
                     } else if (
-                        param->type->kind == DUSK_TYPE_VECTOR &&
-                        param->type->vector.sub == elem_type) {
-                        elem_count += param->type->vector.size;
+                        param_type->kind == DUSK_TYPE_VECTOR &&
+                        param_type->vector.sub == elem_type) {
+                        elem_count += param_type->vector.size;
                     } else {
                         duskAddError(
                             compiler,
-                            param->location,
+                            duskExprGet(compiler, param)->location,
                             "unexpected type for vector constructor: '%s'",
-                            duskTypeToPrettyString(allocator, param->type));
+                            duskTypeToPrettyString(allocator, param_type));
                     }
                 }
 
@@ -1251,7 +1313,7 @@ static void duskAnalyzeExpr(
                 }
 
                 for (size_t i = 0; i < param_count; ++i) {
-                    DuskExpr *param = expr->function_call.params_arr[i];
+                    DuskExprId param = expr->function_call.params_arr[i];
                     DuskType *expected_param_type =
                         constructed_type->matrix.col_type;
                     duskAnalyzeExpr(
@@ -1261,7 +1323,7 @@ static void duskAnalyzeExpr(
                 break;
             }
             default: {
-                expr->type = NULL;
+                *expr_type = NULL;
                 duskAddError(
                     compiler,
                     expr->location,
@@ -1332,28 +1394,30 @@ static void duskAnalyzeExpr(
             // Single parameter float -> float functions
 
             DUSK_ASSERT(duskArrayLength(expr->builtin_call.params_arr) == 1);
-            DuskExpr *param = expr->builtin_call.params_arr[0];
+            DuskExprId param = expr->builtin_call.params_arr[0];
 
             DuskType *float_type =
                 duskTypeNewScalar(compiler, DUSK_SCALAR_TYPE_FLOAT);
 
             duskAnalyzeExpr(compiler, state, param, NULL, false);
-            duskConcretizeExprType(param, float_type);
+            duskConcretizeExprType(compiler, param, float_type);
 
-            if (param->type->kind != DUSK_TYPE_FLOAT &&
-                !(param->type->kind == DUSK_TYPE_VECTOR &&
-                  param->type->vector.sub->kind == DUSK_TYPE_FLOAT)) {
+            DuskType *param_type = compiler->expr_types_arr[param];
+
+            if (param_type->kind != DUSK_TYPE_FLOAT &&
+                !(param_type->kind == DUSK_TYPE_VECTOR &&
+                  param_type->vector.sub->kind == DUSK_TYPE_FLOAT)) {
                 duskAddError(
                     compiler,
                     expr->location,
                     "invalid parameter type for '@%s' call: expected floating "
                     "point scalar or vector, instead got '%s'",
                     duskGetBuiltinFunctionName(expr->builtin_call.kind),
-                    duskTypeToPrettyString(allocator, param->type));
+                    duskTypeToPrettyString(allocator, param_type));
                 break;
             }
 
-            expr->type = param->type;
+            *expr_type = param_type;
 
             break;
         }
@@ -1361,23 +1425,25 @@ static void duskAnalyzeExpr(
         case DUSK_BUILTIN_FUNCTION_ABS: {
             // Single parameter float -> float or int -> int functions
             DUSK_ASSERT(duskArrayLength(expr->builtin_call.params_arr) == 1);
-            DuskExpr *param = expr->builtin_call.params_arr[0];
+            DuskExprId param = expr->builtin_call.params_arr[0];
 
             DuskType *float_type =
                 duskTypeNewScalar(compiler, DUSK_SCALAR_TYPE_FLOAT);
 
             duskAnalyzeExpr(compiler, state, param, NULL, false);
-            duskConcretizeExprType(param, float_type);
+            duskConcretizeExprType(compiler, param, float_type);
+
+            DuskType *param_type = compiler->expr_types_arr[param];
 
             const bool is_param_float_ty =
-                param->type->kind == DUSK_TYPE_FLOAT ||
-                (param->type->kind == DUSK_TYPE_VECTOR &&
-                 param->type->vector.sub->kind == DUSK_TYPE_FLOAT);
+                param_type->kind == DUSK_TYPE_FLOAT ||
+                (param_type->kind == DUSK_TYPE_VECTOR &&
+                 param_type->vector.sub->kind == DUSK_TYPE_FLOAT);
 
             const bool is_param_int_ty =
-                param->type->kind == DUSK_TYPE_INT ||
-                (param->type->kind == DUSK_TYPE_VECTOR &&
-                 param->type->vector.sub->kind == DUSK_TYPE_INT);
+                param_type->kind == DUSK_TYPE_INT ||
+                (param_type->kind == DUSK_TYPE_VECTOR &&
+                 param_type->vector.sub->kind == DUSK_TYPE_INT);
 
             if (!is_param_float_ty && !is_param_int_ty) {
                 duskAddError(
@@ -1386,11 +1452,11 @@ static void duskAnalyzeExpr(
                     "invalid parameter type for '@%s' call: expected floating "
                     "point or integer scalar or vector, instead got '%s'",
                     duskGetBuiltinFunctionName(expr->builtin_call.kind),
-                    duskTypeToPrettyString(allocator, param->type));
+                    duskTypeToPrettyString(allocator, param_type));
                 break;
             }
 
-            expr->type = param->type;
+            *expr_type = param_type;
 
             break;
         }
@@ -1398,45 +1464,52 @@ static void duskAnalyzeExpr(
         case DUSK_BUILTIN_FUNCTION_DOT:
         case DUSK_BUILTIN_FUNCTION_DISTANCE: {
             DUSK_ASSERT(duskArrayLength(expr->builtin_call.params_arr) == 2);
-            DuskExpr *param0 = expr->builtin_call.params_arr[0];
-            DuskExpr *param1 = expr->builtin_call.params_arr[1];
+            DuskExprId param0 = expr->builtin_call.params_arr[0];
+            DuskExprId param1 = expr->builtin_call.params_arr[1];
 
             duskAnalyzeExpr(compiler, state, param0, NULL, false);
             duskAnalyzeExpr(compiler, state, param1, NULL, false);
-            if (!param0->type) break;
-            if (!param1->type) break;
+
+            DuskType *param0_type = compiler->expr_types_arr[param0];
+            DuskType *param1_type = compiler->expr_types_arr[param1];
+
+            if (!param0_type) break;
+            if (!param1_type) break;
 
             const bool is_param_float_vector =
-                param0->type->kind == DUSK_TYPE_VECTOR &&
-                param0->type->vector.sub->kind == DUSK_TYPE_FLOAT;
+                param0_type->kind == DUSK_TYPE_VECTOR &&
+                param0_type->vector.sub->kind == DUSK_TYPE_FLOAT;
 
-            if (param0->type != param1->type || !is_param_float_vector) {
+            if (param0_type != param1_type || !is_param_float_vector) {
                 duskAddError(
                     compiler,
                     expr->location,
                     "invalid parameter types for '@%s' call: expected floating "
                     "point vectors, instead got '%s' and '%s'",
                     duskGetBuiltinFunctionName(expr->builtin_call.kind),
-                    duskTypeToPrettyString(allocator, param0->type),
-                    duskTypeToPrettyString(allocator, param1->type));
+                    duskTypeToPrettyString(allocator, param0_type),
+                    duskTypeToPrettyString(allocator, param1_type));
                 break;
             }
 
-            expr->type = param0->type->vector.sub;
+            *expr_type = param0_type->vector.sub;
 
             break;
         }
 
         case DUSK_BUILTIN_FUNCTION_NORMALIZE: {
             DUSK_ASSERT(duskArrayLength(expr->builtin_call.params_arr) == 1);
-            DuskExpr *param0 = expr->builtin_call.params_arr[0];
+            DuskExprId param0 = expr->builtin_call.params_arr[0];
 
             duskAnalyzeExpr(compiler, state, param0, NULL, false);
-            if (!param0->type) break;
+
+            DuskType *param0_type = compiler->expr_types_arr[param0];
+
+            if (!param0_type) break;
 
             const bool is_param_float_vector =
-                param0->type->kind == DUSK_TYPE_VECTOR &&
-                param0->type->vector.sub->kind == DUSK_TYPE_FLOAT;
+                param0_type->kind == DUSK_TYPE_VECTOR &&
+                param0_type->vector.sub->kind == DUSK_TYPE_FLOAT;
 
             if (!is_param_float_vector) {
                 duskAddError(
@@ -1445,25 +1518,28 @@ static void duskAnalyzeExpr(
                     "invalid parameter type for '@%s' call: expected floating "
                     "point vector, instead got '%s'",
                     duskGetBuiltinFunctionName(expr->builtin_call.kind),
-                    duskTypeToPrettyString(allocator, param0->type));
+                    duskTypeToPrettyString(allocator, param0_type));
                 break;
             }
 
-            expr->type = param0->type;
+            *expr_type = param0_type;
 
             break;
         }
 
         case DUSK_BUILTIN_FUNCTION_LENGTH: {
             DUSK_ASSERT(duskArrayLength(expr->builtin_call.params_arr) == 1);
-            DuskExpr *param0 = expr->builtin_call.params_arr[0];
+            DuskExprId param0 = expr->builtin_call.params_arr[0];
 
             duskAnalyzeExpr(compiler, state, param0, NULL, false);
-            if (!param0->type) break;
+
+            DuskType *param0_type = compiler->expr_types_arr[param0];
+
+            if (!param0_type) break;
 
             const bool is_param_float_vector =
-                param0->type->kind == DUSK_TYPE_VECTOR &&
-                param0->type->vector.sub->kind == DUSK_TYPE_FLOAT;
+                param0_type->kind == DUSK_TYPE_VECTOR &&
+                param0_type->vector.sub->kind == DUSK_TYPE_FLOAT;
 
             if (!is_param_float_vector) {
                 duskAddError(
@@ -1472,31 +1548,35 @@ static void duskAnalyzeExpr(
                     "invalid parameter type for '@%s' call: expected floating "
                     "point vector, instead got '%s'",
                     duskGetBuiltinFunctionName(expr->builtin_call.kind),
-                    duskTypeToPrettyString(allocator, param0->type));
+                    duskTypeToPrettyString(allocator, param0_type));
                 break;
             }
 
-            expr->type = param0->type->vector.sub;
+            *expr_type = param0_type->vector.sub;
 
             break;
         }
 
         case DUSK_BUILTIN_FUNCTION_CROSS: {
             DUSK_ASSERT(duskArrayLength(expr->builtin_call.params_arr) == 2);
-            DuskExpr *param0 = expr->builtin_call.params_arr[0];
-            DuskExpr *param1 = expr->builtin_call.params_arr[1];
+            DuskExprId param0 = expr->builtin_call.params_arr[0];
+            DuskExprId param1 = expr->builtin_call.params_arr[1];
 
             duskAnalyzeExpr(compiler, state, param0, NULL, false);
             duskAnalyzeExpr(compiler, state, param1, NULL, false);
-            if (!param0->type) break;
-            if (!param1->type) break;
+
+            DuskType *param0_type = compiler->expr_types_arr[param0];
+            DuskType *param1_type = compiler->expr_types_arr[param1];
+
+            if (!param0_type) break;
+            if (!param1_type) break;
 
             const bool is_param_float3_vector =
-                param0->type->kind == DUSK_TYPE_VECTOR &&
-                param0->type->vector.sub->kind == DUSK_TYPE_FLOAT &&
-                param0->type->vector.size == 3;
+                param0_type->kind == DUSK_TYPE_VECTOR &&
+                param0_type->vector.sub->kind == DUSK_TYPE_FLOAT &&
+                param0_type->vector.size == 3;
 
-            if (param0->type != param1->type || !is_param_float3_vector) {
+            if (param0_type != param1_type || !is_param_float3_vector) {
                 duskAddError(
                     compiler,
                     expr->location,
@@ -1504,38 +1584,41 @@ static void duskAnalyzeExpr(
                     "3-dimensional floating point vectors, instead got '%s' "
                     "and '%s'",
                     duskGetBuiltinFunctionName(expr->builtin_call.kind),
-                    duskTypeToPrettyString(allocator, param0->type),
-                    duskTypeToPrettyString(allocator, param1->type));
+                    duskTypeToPrettyString(allocator, param0_type),
+                    duskTypeToPrettyString(allocator, param1_type));
                 break;
             }
 
-            expr->type = param0->type;
+            *expr_type = param0_type;
 
             break;
         }
 
         case DUSK_BUILTIN_FUNCTION_REFLECT: {
             DUSK_ASSERT(duskArrayLength(expr->builtin_call.params_arr) == 2);
-            DuskExpr *param0 = expr->builtin_call.params_arr[0];
-            DuskExpr *param1 = expr->builtin_call.params_arr[1];
+            DuskExprId param0 = expr->builtin_call.params_arr[0];
+            DuskExprId param1 = expr->builtin_call.params_arr[1];
 
             duskAnalyzeExpr(compiler, state, param0, NULL, false);
             duskAnalyzeExpr(compiler, state, param1, NULL, false);
-            if (!param0->type) break;
-            if (!param1->type) break;
+            if (!compiler->expr_types_arr[param0]) break;
+            if (!compiler->expr_types_arr[param1]) break;
 
             DuskType *float_type =
                 duskTypeNewScalar(compiler, DUSK_SCALAR_TYPE_FLOAT);
 
-            duskConcretizeExprType(param0, float_type);
-            duskConcretizeExprType(param1, float_type);
+            duskConcretizeExprType(compiler, param0, float_type);
+            duskConcretizeExprType(compiler, param1, float_type);
+
+            DuskType *param0_type = compiler->expr_types_arr[param0];
+            DuskType *param1_type = compiler->expr_types_arr[param1];
 
             const bool is_param_float_or_vector =
-                param0->type->kind == DUSK_TYPE_FLOAT ||
-                (param0->type->kind == DUSK_TYPE_VECTOR &&
-                 param0->type->vector.sub->kind == DUSK_TYPE_FLOAT);
+                param0_type->kind == DUSK_TYPE_FLOAT ||
+                (param0_type->kind == DUSK_TYPE_VECTOR &&
+                 param0_type->vector.sub->kind == DUSK_TYPE_FLOAT);
 
-            if (param0->type != param1->type || !is_param_float_or_vector) {
+            if (param0_type != param1_type || !is_param_float_or_vector) {
                 duskAddError(
                     compiler,
                     expr->location,
@@ -1543,41 +1626,45 @@ static void duskAnalyzeExpr(
                     "floating point scalar or vector types, instead got '%s' "
                     "and '%s'",
                     duskGetBuiltinFunctionName(expr->builtin_call.kind),
-                    duskTypeToPrettyString(allocator, param0->type),
-                    duskTypeToPrettyString(allocator, param1->type));
+                    duskTypeToPrettyString(allocator, param0_type),
+                    duskTypeToPrettyString(allocator, param1_type));
                 break;
             }
 
-            expr->type = param0->type;
+            *expr_type = param0_type;
 
             break;
         }
 
         case DUSK_BUILTIN_FUNCTION_REFRACT: {
             DUSK_ASSERT(duskArrayLength(expr->builtin_call.params_arr) == 3);
-            DuskExpr *param0 = expr->builtin_call.params_arr[0];
-            DuskExpr *param1 = expr->builtin_call.params_arr[1];
-            DuskExpr *param2 = expr->builtin_call.params_arr[2];
+            DuskExprId param0 = expr->builtin_call.params_arr[0];
+            DuskExprId param1 = expr->builtin_call.params_arr[1];
+            DuskExprId param2 = expr->builtin_call.params_arr[2];
 
             duskAnalyzeExpr(compiler, state, param0, NULL, false);
             duskAnalyzeExpr(compiler, state, param1, NULL, false);
             duskAnalyzeExpr(compiler, state, param2, NULL, false);
-            if (!param0->type) break;
-            if (!param1->type) break;
-            if (!param2->type) break;
+            if (!compiler->expr_types_arr[param0]) break;
+            if (!compiler->expr_types_arr[param1]) break;
+            if (!compiler->expr_types_arr[param2]) break;
 
             DuskType *float_type =
                 duskTypeNewScalar(compiler, DUSK_SCALAR_TYPE_FLOAT);
-            duskConcretizeExprType(param0, float_type);
-            duskConcretizeExprType(param1, float_type);
-            duskConcretizeExprType(param2, float_type);
+            duskConcretizeExprType(compiler, param0, float_type);
+            duskConcretizeExprType(compiler, param1, float_type);
+            duskConcretizeExprType(compiler, param2, float_type);
+
+            DuskType *param0_type = compiler->expr_types_arr[param0];
+            DuskType *param1_type = compiler->expr_types_arr[param1];
+            DuskType *param2_type = compiler->expr_types_arr[param2];
 
             const bool is_param0_float_or_vector =
-                param0->type->kind == DUSK_TYPE_FLOAT ||
-                (param0->type->kind == DUSK_TYPE_VECTOR &&
-                 param0->type->vector.sub->kind == DUSK_TYPE_FLOAT);
+                param0_type->kind == DUSK_TYPE_FLOAT ||
+                (param0_type->kind == DUSK_TYPE_VECTOR &&
+                 param0_type->vector.sub->kind == DUSK_TYPE_FLOAT);
 
-            if (param0->type != param1->type || !is_param0_float_or_vector) {
+            if (param0_type != param1_type || !is_param0_float_or_vector) {
                 duskAddError(
                     compiler,
                     expr->location,
@@ -1585,12 +1672,12 @@ static void duskAnalyzeExpr(
                     "floating point scalar or vector types for the first two "
                     "parameters, instead got '%s' and '%s'",
                     duskGetBuiltinFunctionName(expr->builtin_call.kind),
-                    duskTypeToPrettyString(allocator, param0->type),
-                    duskTypeToPrettyString(allocator, param1->type));
+                    duskTypeToPrettyString(allocator, param0_type),
+                    duskTypeToPrettyString(allocator, param1_type));
                 break;
             }
 
-            if (param2->type->kind != DUSK_TYPE_FLOAT) {
+            if (param2_type->kind != DUSK_TYPE_FLOAT) {
                 duskAddError(
                     compiler,
                     expr->location,
@@ -1598,11 +1685,11 @@ static void duskAnalyzeExpr(
                     "parameter"
                     "to be of a floating pointer scalar type, instead got '%s'",
                     duskGetBuiltinFunctionName(expr->builtin_call.kind),
-                    duskTypeToPrettyString(allocator, param2->type));
+                    duskTypeToPrettyString(allocator, param2_type));
                 break;
             }
 
-            expr->type = param0->type;
+            *expr_type = param0_type;
 
             break;
         }
@@ -1610,31 +1697,34 @@ static void duskAnalyzeExpr(
         case DUSK_BUILTIN_FUNCTION_MIN:
         case DUSK_BUILTIN_FUNCTION_MAX: {
             DUSK_ASSERT(duskArrayLength(expr->builtin_call.params_arr) == 2);
-            DuskExpr *param0 = expr->builtin_call.params_arr[0];
-            DuskExpr *param1 = expr->builtin_call.params_arr[1];
+            DuskExprId param0 = expr->builtin_call.params_arr[0];
+            DuskExprId param1 = expr->builtin_call.params_arr[1];
 
             duskAnalyzeExpr(compiler, state, param0, NULL, false);
             duskAnalyzeExpr(compiler, state, param1, NULL, false);
-            if (!param0->type) break;
-            if (!param1->type) break;
+            if (!compiler->expr_types_arr[param0]) break;
+            if (!compiler->expr_types_arr[param1]) break;
 
             DuskType *float_type =
                 duskTypeNewScalar(compiler, DUSK_SCALAR_TYPE_FLOAT);
 
-            duskConcretizeExprType(param0, float_type);
-            duskConcretizeExprType(param1, float_type);
+            duskConcretizeExprType(compiler, param0, float_type);
+            duskConcretizeExprType(compiler, param1, float_type);
+
+            DuskType *param0_type = compiler->expr_types_arr[param0];
+            DuskType *param1_type = compiler->expr_types_arr[param1];
 
             const bool is_param_float_or_vector =
-                param0->type->kind == DUSK_TYPE_FLOAT ||
-                (param0->type->kind == DUSK_TYPE_VECTOR &&
-                 param0->type->vector.sub->kind == DUSK_TYPE_FLOAT);
+                param0_type->kind == DUSK_TYPE_FLOAT ||
+                (param0_type->kind == DUSK_TYPE_VECTOR &&
+                 param0_type->vector.sub->kind == DUSK_TYPE_FLOAT);
 
             const bool is_param_int_or_vector =
-                param0->type->kind == DUSK_TYPE_INT ||
-                (param0->type->kind == DUSK_TYPE_VECTOR &&
-                 param0->type->vector.sub->kind == DUSK_TYPE_INT);
+                param0_type->kind == DUSK_TYPE_INT ||
+                (param0_type->kind == DUSK_TYPE_VECTOR &&
+                 param0_type->vector.sub->kind == DUSK_TYPE_INT);
 
-            if (param0->type != param1->type ||
+            if (param0_type != param1_type ||
                 (!is_param_int_or_vector && !is_param_float_or_vector)) {
                 duskAddError(
                     compiler,
@@ -1642,42 +1732,46 @@ static void duskAnalyzeExpr(
                     "invalid parameter types for '@%s' call: expected the same "
                     "scalar or vector types, instead got '%s' and '%s'",
                     duskGetBuiltinFunctionName(expr->builtin_call.kind),
-                    duskTypeToPrettyString(allocator, param0->type),
-                    duskTypeToPrettyString(allocator, param1->type));
+                    duskTypeToPrettyString(allocator, param0_type),
+                    duskTypeToPrettyString(allocator, param1_type));
                 break;
             }
 
-            expr->type = param0->type;
+            *expr_type = param0_type;
 
             break;
         }
 
         case DUSK_BUILTIN_FUNCTION_MIX: {
             DUSK_ASSERT(duskArrayLength(expr->builtin_call.params_arr) == 3);
-            DuskExpr *param0 = expr->builtin_call.params_arr[0];
-            DuskExpr *param1 = expr->builtin_call.params_arr[1];
-            DuskExpr *param2 = expr->builtin_call.params_arr[2];
+            DuskExprId param0 = expr->builtin_call.params_arr[0];
+            DuskExprId param1 = expr->builtin_call.params_arr[1];
+            DuskExprId param2 = expr->builtin_call.params_arr[2];
 
             duskAnalyzeExpr(compiler, state, param0, NULL, false);
             duskAnalyzeExpr(compiler, state, param1, NULL, false);
             duskAnalyzeExpr(compiler, state, param2, NULL, false);
-            if (!param0->type) break;
-            if (!param1->type) break;
-            if (!param2->type) break;
+            if (!compiler->expr_types_arr[param0]) break;
+            if (!compiler->expr_types_arr[param1]) break;
+            if (!compiler->expr_types_arr[param2]) break;
 
             DuskType *float_type =
                 duskTypeNewScalar(compiler, DUSK_SCALAR_TYPE_FLOAT);
 
-            duskConcretizeExprType(param0, float_type);
-            duskConcretizeExprType(param1, float_type);
-            duskConcretizeExprType(param2, float_type);
+            duskConcretizeExprType(compiler, param0, float_type);
+            duskConcretizeExprType(compiler, param1, float_type);
+            duskConcretizeExprType(compiler, param2, float_type);
+
+            DuskType *param0_type = compiler->expr_types_arr[param0];
+            DuskType *param1_type = compiler->expr_types_arr[param1];
+            DuskType *param2_type = compiler->expr_types_arr[param2];
 
             const bool is_param_float_or_vector =
-                param0->type->kind == DUSK_TYPE_FLOAT ||
-                (param0->type->kind == DUSK_TYPE_VECTOR &&
-                 param0->type->vector.sub->kind == DUSK_TYPE_FLOAT);
+                param0_type->kind == DUSK_TYPE_FLOAT ||
+                (param0_type->kind == DUSK_TYPE_VECTOR &&
+                 param0_type->vector.sub->kind == DUSK_TYPE_FLOAT);
 
-            if (param0->type != param1->type || param0->type != param2->type ||
+            if (param0_type != param1_type || param0_type != param2_type ||
                 !is_param_float_or_vector) {
                 duskAddError(
                     compiler,
@@ -1687,48 +1781,52 @@ static void duskAnalyzeExpr(
                     "scalar or vector types for all parameters, instead got "
                     "'%s', '%s', '%s'",
                     duskGetBuiltinFunctionName(expr->builtin_call.kind),
-                    duskTypeToPrettyString(allocator, param0->type),
-                    duskTypeToPrettyString(allocator, param1->type),
-                    duskTypeToPrettyString(allocator, param2->type));
+                    duskTypeToPrettyString(allocator, param0_type),
+                    duskTypeToPrettyString(allocator, param1_type),
+                    duskTypeToPrettyString(allocator, param2_type));
                 break;
             }
 
-            expr->type = param0->type;
+            *expr_type = param0_type;
 
             break;
         }
 
         case DUSK_BUILTIN_FUNCTION_CLAMP: {
             DUSK_ASSERT(duskArrayLength(expr->builtin_call.params_arr) == 3);
-            DuskExpr *param0 = expr->builtin_call.params_arr[0];
-            DuskExpr *param1 = expr->builtin_call.params_arr[1];
-            DuskExpr *param2 = expr->builtin_call.params_arr[2];
+            DuskExprId param0 = expr->builtin_call.params_arr[0];
+            DuskExprId param1 = expr->builtin_call.params_arr[1];
+            DuskExprId param2 = expr->builtin_call.params_arr[2];
 
             duskAnalyzeExpr(compiler, state, param0, NULL, false);
             duskAnalyzeExpr(compiler, state, param1, NULL, false);
             duskAnalyzeExpr(compiler, state, param2, NULL, false);
-            if (!param0->type) break;
-            if (!param1->type) break;
-            if (!param2->type) break;
+            if (!compiler->expr_types_arr[param0]) break;
+            if (!compiler->expr_types_arr[param1]) break;
+            if (!compiler->expr_types_arr[param2]) break;
 
             DuskType *float_type =
                 duskTypeNewScalar(compiler, DUSK_SCALAR_TYPE_FLOAT);
 
-            duskConcretizeExprType(param0, float_type);
-            duskConcretizeExprType(param1, float_type);
-            duskConcretizeExprType(param2, float_type);
+            duskConcretizeExprType(compiler, param0, float_type);
+            duskConcretizeExprType(compiler, param1, float_type);
+            duskConcretizeExprType(compiler, param2, float_type);
+
+            DuskType *param0_type = compiler->expr_types_arr[param0];
+            DuskType *param1_type = compiler->expr_types_arr[param1];
+            DuskType *param2_type = compiler->expr_types_arr[param2];
 
             const bool is_param_int_or_vector =
-                param0->type->kind == DUSK_TYPE_INT ||
-                (param0->type->kind == DUSK_TYPE_VECTOR &&
-                 param0->type->vector.sub->kind == DUSK_TYPE_INT);
+                param0_type->kind == DUSK_TYPE_INT ||
+                (param0_type->kind == DUSK_TYPE_VECTOR &&
+                 param0_type->vector.sub->kind == DUSK_TYPE_INT);
 
             const bool is_param_float_or_vector =
-                param0->type->kind == DUSK_TYPE_FLOAT ||
-                (param0->type->kind == DUSK_TYPE_VECTOR &&
-                 param0->type->vector.sub->kind == DUSK_TYPE_FLOAT);
+                param0_type->kind == DUSK_TYPE_FLOAT ||
+                (param0_type->kind == DUSK_TYPE_VECTOR &&
+                 param0_type->vector.sub->kind == DUSK_TYPE_FLOAT);
 
-            if (param0->type != param1->type || param0->type != param2->type ||
+            if (param0_type != param1_type || param0_type != param2_type ||
                 (!is_param_float_or_vector && !is_param_int_or_vector)) {
                 duskAddError(
                     compiler,
@@ -1737,70 +1835,76 @@ static void duskAnalyzeExpr(
                     "scalar or vector types for all parameters, instead got "
                     "'%s', '%s', '%s'",
                     duskGetBuiltinFunctionName(expr->builtin_call.kind),
-                    duskTypeToPrettyString(allocator, param0->type),
-                    duskTypeToPrettyString(allocator, param1->type),
-                    duskTypeToPrettyString(allocator, param2->type));
+                    duskTypeToPrettyString(allocator, param0_type),
+                    duskTypeToPrettyString(allocator, param1_type),
+                    duskTypeToPrettyString(allocator, param2_type));
                 break;
             }
 
-            expr->type = param0->type;
+            *expr_type = param0_type;
 
             break;
         }
 
         case DUSK_BUILTIN_FUNCTION_DETERMINANT: {
             DUSK_ASSERT(duskArrayLength(expr->builtin_call.params_arr) == 1);
-            DuskExpr *param0 = expr->builtin_call.params_arr[0];
+            DuskExprId param0 = expr->builtin_call.params_arr[0];
 
             duskAnalyzeExpr(compiler, state, param0, NULL, false);
-            if (!param0->type) break;
 
-            if (param0->type->kind != DUSK_TYPE_MATRIX ||
-                param0->type->matrix.cols !=
-                    param0->type->matrix.col_type->vector.size) {
+            DuskType *param0_type = compiler->expr_types_arr[param0];
+
+            if (!param0_type) break;
+
+            if (param0_type->kind != DUSK_TYPE_MATRIX ||
+                param0_type->matrix.cols !=
+                    param0_type->matrix.col_type->vector.size) {
                 duskAddError(
                     compiler,
                     expr->location,
                     "invalid parameter type for '@%s' call: expected square "
                     "matrix, instead got '%s'",
                     duskGetBuiltinFunctionName(expr->builtin_call.kind),
-                    duskTypeToPrettyString(allocator, param0->type));
+                    duskTypeToPrettyString(allocator, param0_type));
                 break;
             }
 
-            expr->type = param0->type->matrix.col_type->vector.sub;
+            *expr_type = param0_type->matrix.col_type->vector.sub;
 
             break;
         }
 
         case DUSK_BUILTIN_FUNCTION_INVERSE: {
             DUSK_ASSERT(duskArrayLength(expr->builtin_call.params_arr) == 1);
-            DuskExpr *param0 = expr->builtin_call.params_arr[0];
+            DuskExprId param0 = expr->builtin_call.params_arr[0];
 
             duskAnalyzeExpr(compiler, state, param0, NULL, false);
-            if (!param0->type) break;
 
-            if (param0->type->kind != DUSK_TYPE_MATRIX ||
-                param0->type->matrix.cols !=
-                    param0->type->matrix.col_type->vector.size) {
+            DuskType *param0_type = compiler->expr_types_arr[param0];
+
+            if (!param0_type) break;
+
+            if (param0_type->kind != DUSK_TYPE_MATRIX ||
+                param0_type->matrix.cols !=
+                    param0_type->matrix.col_type->vector.size) {
                 duskAddError(
                     compiler,
                     expr->location,
                     "invalid parameter type for '@%s' call: expected square "
                     "matrix, instead got '%s'",
                     duskGetBuiltinFunctionName(expr->builtin_call.kind),
-                    duskTypeToPrettyString(allocator, param0->type));
+                    duskTypeToPrettyString(allocator, param0_type));
                 break;
             }
 
-            expr->type = param0->type;
+            *expr_type = param0_type;
 
             break;
         }
 
         case DUSK_BUILTIN_FUNCTION_SAMPLER_TYPE: {
-            expr->type = duskTypeNewBasic(compiler, DUSK_TYPE_TYPE);
-            expr->as_type = duskTypeNewBasic(compiler, DUSK_TYPE_SAMPLER);
+            *expr_type = duskTypeNewBasic(compiler, DUSK_TYPE_TYPE);
+            *expr_as_type = duskTypeNewBasic(compiler, DUSK_TYPE_SAMPLER);
             break;
         }
         case DUSK_BUILTIN_FUNCTION_IMAGE_1D_TYPE:
@@ -1815,14 +1919,10 @@ static void duskAnalyzeExpr(
         case DUSK_BUILTIN_FUNCTION_IMAGE_3D_SAMPLER_TYPE:
         case DUSK_BUILTIN_FUNCTION_IMAGE_CUBE_SAMPLER_TYPE:
         case DUSK_BUILTIN_FUNCTION_IMAGE_CUBE_ARRAY_SAMPLER_TYPE: {
+            DuskExprId param0 = expr->builtin_call.params_arr[0];
             DuskType *type_type = duskTypeNewBasic(compiler, DUSK_TYPE_TYPE);
-            duskAnalyzeExpr(
-                compiler,
-                state,
-                expr->builtin_call.params_arr[0],
-                type_type,
-                false);
-            DuskType *sampled_type = expr->builtin_call.params_arr[0]->as_type;
+            duskAnalyzeExpr(compiler, state, param0, type_type, false);
+            DuskType *sampled_type = compiler->expr_as_types_arr[param0];
 
             if (!sampled_type) {
                 DUSK_ASSERT(duskArrayLength(compiler->errors_arr) > 0);
@@ -1833,7 +1933,7 @@ static void duskAnalyzeExpr(
                 sampled_type->kind != DUSK_TYPE_INT) {
                 duskAddError(
                     compiler,
-                    expr->builtin_call.params_arr[0]->location,
+                    duskExprGet(compiler, param0)->location,
                     "expected a scalar type or void, instead got '%s'",
                     duskTypeToPrettyString(allocator, sampled_type));
                 break;
@@ -1903,8 +2003,8 @@ static void duskAnalyzeExpr(
             default: DUSK_ASSERT(0); break;
             }
 
-            expr->type = duskTypeNewBasic(compiler, DUSK_TYPE_TYPE);
-            expr->as_type = duskTypeNewImage(
+            *expr_type = duskTypeNewBasic(compiler, DUSK_TYPE_TYPE);
+            *expr_as_type = duskTypeNewImage(
                 compiler,
                 sampled_type,
                 dim,
@@ -1920,8 +2020,8 @@ static void duskAnalyzeExpr(
             case DUSK_BUILTIN_FUNCTION_IMAGE_3D_SAMPLER_TYPE:
             case DUSK_BUILTIN_FUNCTION_IMAGE_CUBE_SAMPLER_TYPE:
             case DUSK_BUILTIN_FUNCTION_IMAGE_CUBE_ARRAY_SAMPLER_TYPE: {
-                expr->as_type =
-                    duskTypeNewSampledImage(compiler, expr->as_type);
+                *expr_as_type =
+                    duskTypeNewSampledImage(compiler, *expr_as_type);
                 break;
             }
             default: break;
@@ -1931,55 +2031,62 @@ static void duskAnalyzeExpr(
 
         case DUSK_BUILTIN_FUNCTION_IMAGE: {
             DUSK_ASSERT(duskArrayLength(expr->builtin_call.params_arr) == 1);
-            DuskExpr *param0 = expr->builtin_call.params_arr[0];
+            DuskExprId param0 = expr->builtin_call.params_arr[0];
 
             duskAnalyzeExpr(compiler, state, param0, NULL, false);
-            if (!param0->type) break;
 
-            if (param0->type->kind != DUSK_TYPE_SAMPLED_IMAGE) {
+            DuskType *param0_type = compiler->expr_types_arr[param0];
+
+            if (!param0_type) break;
+
+            if (param0_type->kind != DUSK_TYPE_SAMPLED_IMAGE) {
                 duskAddError(
                     compiler,
-                    param0->location,
+                    duskExprGet(compiler, param0)->location,
                     "first parameter of @image must be of type sampled "
                     "image");
                 break;
             }
 
-            expr->type = param0->type->sampled_image.image_type;
+            *expr_type = param0_type->sampled_image.image_type;
 
             break;
         }
 
         case DUSK_BUILTIN_FUNCTION_IMAGE_SAMPLE: {
             DUSK_ASSERT(duskArrayLength(expr->builtin_call.params_arr) == 2);
-            DuskExpr *param0 = expr->builtin_call.params_arr[0];
-            DuskExpr *param1 = expr->builtin_call.params_arr[1];
+            DuskExprId param0 = expr->builtin_call.params_arr[0];
+            DuskExprId param1 = expr->builtin_call.params_arr[1];
 
             duskAnalyzeExpr(compiler, state, param0, NULL, false);
-            if (!param0->type) break;
+            if (!compiler->expr_types_arr[param0]) break;
 
             duskAnalyzeExpr(compiler, state, param1, NULL, false);
-            if (!param1->type) break;
 
-            if (param0->type->kind != DUSK_TYPE_SAMPLED_IMAGE) {
+            DuskType *param0_type = compiler->expr_types_arr[param0];
+            DuskType *param1_type = compiler->expr_types_arr[param1];
+
+            if (!param1_type) break;
+
+            if (param0_type->kind != DUSK_TYPE_SAMPLED_IMAGE) {
                 duskAddError(
                     compiler,
-                    param0->location,
+                    duskExprGet(compiler, param0)->location,
                     "first parameter of @imageSample must be of type sampled "
                     "image");
                 break;
             }
 
             DuskImageDimension dim =
-                param0->type->sampled_image.image_type->image.dim;
+                param0_type->sampled_image.image_type->image.dim;
             uint32_t vec_elems = duskImageDimensionVectorElems(dim);
 
-            if (param1->type->kind != DUSK_TYPE_VECTOR ||
-                param1->type->vector.size != vec_elems ||
-                param1->type->vector.sub->kind != DUSK_TYPE_FLOAT) {
+            if (param1_type->kind != DUSK_TYPE_VECTOR ||
+                param1_type->vector.size != vec_elems ||
+                param1_type->vector.sub->kind != DUSK_TYPE_FLOAT) {
                 duskAddError(
                     compiler,
-                    param0->location,
+                    duskExprGet(compiler, param0)->location,
                     "second parameter of @imageSample must be of vector type "
                     "'float%u' or 'int%u'",
                     vec_elems,
@@ -1989,32 +2096,37 @@ static void duskAnalyzeExpr(
 
             DuskType *float_type =
                 duskTypeNewScalar(compiler, DUSK_SCALAR_TYPE_FLOAT);
-            expr->type = duskTypeNewVector(compiler, float_type, 4);
+            *expr_type = duskTypeNewVector(compiler, float_type, 4);
 
             break;
         }
         case DUSK_BUILTIN_FUNCTION_IMAGE_SAMPLE_LOD: {
             DUSK_ASSERT(duskArrayLength(expr->builtin_call.params_arr) == 3);
-            DuskExpr *param0 = expr->builtin_call.params_arr[0];
-            DuskExpr *param1 = expr->builtin_call.params_arr[1];
-            DuskExpr *param2 = expr->builtin_call.params_arr[2];
+            DuskExprId param0 = expr->builtin_call.params_arr[0];
+            DuskExprId param1 = expr->builtin_call.params_arr[1];
+            DuskExprId param2 = expr->builtin_call.params_arr[2];
 
             DuskType *float_type =
                 duskTypeNewScalar(compiler, DUSK_SCALAR_TYPE_FLOAT);
 
             duskAnalyzeExpr(compiler, state, param0, NULL, false);
-            if (!param0->type) break;
+            if (!compiler->expr_types_arr[param0]) break;
 
             duskAnalyzeExpr(compiler, state, param1, NULL, false);
-            if (!param1->type) break;
+            if (!compiler->expr_types_arr[param1]) break;
 
             duskAnalyzeExpr(compiler, state, param2, float_type, false);
-            if (!param2->type) break;
 
-            if (param0->type->kind != DUSK_TYPE_SAMPLED_IMAGE) {
+            DuskType *param0_type = compiler->expr_types_arr[param0];
+            DuskType *param1_type = compiler->expr_types_arr[param1];
+            DuskType *param2_type = compiler->expr_types_arr[param2];
+
+            if (!param2_type) break;
+
+            if (param0_type->kind != DUSK_TYPE_SAMPLED_IMAGE) {
                 duskAddError(
                     compiler,
-                    param0->location,
+                    duskExprGet(compiler, param0)->location,
                     "first parameter of @imageSampleLod must be of type "
                     "sampled "
                     "image");
@@ -2022,15 +2134,15 @@ static void duskAnalyzeExpr(
             }
 
             DuskImageDimension dim =
-                param0->type->sampled_image.image_type->image.dim;
+                param0_type->sampled_image.image_type->image.dim;
             uint32_t vec_elems = duskImageDimensionVectorElems(dim);
 
-            if (param1->type->kind != DUSK_TYPE_VECTOR ||
-                param1->type->vector.size != vec_elems ||
-                param1->type->vector.sub->kind != DUSK_TYPE_FLOAT) {
+            if (param1_type->kind != DUSK_TYPE_VECTOR ||
+                param1_type->vector.size != vec_elems ||
+                param1_type->vector.sub->kind != DUSK_TYPE_FLOAT) {
                 duskAddError(
                     compiler,
-                    param0->location,
+                    duskExprGet(compiler, param0)->location,
                     "second parameter of @imageSampleLod must be of vector "
                     "type "
                     "'float%u' or 'int%u'",
@@ -2039,7 +2151,7 @@ static void duskAnalyzeExpr(
                 break;
             }
 
-            expr->type = duskTypeNewVector(compiler, float_type, 4);
+            *expr_type = duskTypeNewVector(compiler, float_type, 4);
             break;
         }
         case DUSK_BUILTIN_FUNCTION_IMAGE_LOAD: {
@@ -2060,33 +2172,37 @@ static void duskAnalyzeExpr(
         }
         case DUSK_BUILTIN_FUNCTION_IMAGE_QUERY_SIZE: {
             DUSK_ASSERT(duskArrayLength(expr->builtin_call.params_arr) == 2);
-            DuskExpr *param0 = expr->builtin_call.params_arr[0];
-            DuskExpr *param1 = expr->builtin_call.params_arr[1];
+            DuskExprId param0 = expr->builtin_call.params_arr[0];
+            DuskExprId param1 = expr->builtin_call.params_arr[1];
 
             DuskType *uint_type =
                 duskTypeNewScalar(compiler, DUSK_SCALAR_TYPE_UINT);
 
             duskAnalyzeExpr(compiler, state, param0, NULL, false);
-            if (!param0->type) break;
+            if (!compiler->expr_types_arr[param0]) break;
 
             duskAnalyzeExpr(compiler, state, param1, uint_type, false);
-            if (!param1->type) break;
 
-            if (param0->type->kind != DUSK_TYPE_SAMPLED_IMAGE &&
-                param0->type->kind != DUSK_TYPE_IMAGE) {
+            DuskType *param0_type = compiler->expr_types_arr[param0];
+            DuskType *param1_type = compiler->expr_types_arr[param1];
+
+            if (!param1_type) break;
+
+            if (param0_type->kind != DUSK_TYPE_SAMPLED_IMAGE &&
+                param0_type->kind != DUSK_TYPE_IMAGE) {
                 duskAddError(
                     compiler,
-                    param0->location,
+                    duskExprGet(compiler, param0)->location,
                     "first parameter of @imageQuerySizeLod must be of type "
                     "image or sampled image");
                 break;
             }
 
             DuskImageDimension dim =
-                param0->type->sampled_image.image_type->image.dim;
+                param0_type->sampled_image.image_type->image.dim;
             uint32_t vec_elems = duskImageDimensionVectorElems(dim);
 
-            expr->type = duskTypeNewVector(compiler, uint_type, vec_elems);
+            *expr_type = duskTypeNewVector(compiler, uint_type, vec_elems);
             break;
         }
 
@@ -2098,23 +2214,26 @@ static void duskAnalyzeExpr(
     case DUSK_EXPR_ACCESS: {
         duskAnalyzeExpr(
             compiler, state, expr->access.base_expr, NULL, must_be_assignable);
-        DuskExpr *left_expr = expr->access.base_expr;
-        if (!left_expr->type) {
+        DuskExprId left_expr_id = expr->access.base_expr;
+        if (!compiler->expr_types_arr[left_expr_id]) {
             DUSK_ASSERT(duskArrayLength(compiler->errors_arr) > 0);
             break;
         }
 
         for (size_t i = 0; i < duskArrayLength(expr->access.chain_arr); ++i) {
-            DuskExpr *right_expr = expr->access.chain_arr[i];
+            DuskExprId right_expr_id = expr->access.chain_arr[i];
+            DuskExpr *right_expr = duskExprGet(compiler, right_expr_id);
             DUSK_ASSERT(right_expr->kind == DUSK_EXPR_IDENT);
             const char *accessed_field_name = right_expr->identifier.str;
 
-            if (!left_expr->type) {
+            DuskType *left_type = compiler->expr_types_arr[left_expr_id];
+            DuskType **right_type = &compiler->expr_types_arr[right_expr_id];
+            if (!left_type) {
                 DUSK_ASSERT(duskArrayLength(compiler->errors_arr) > 0);
                 break;
             }
 
-            switch (left_expr->type->kind) {
+            switch (left_type->kind) {
             case DUSK_TYPE_VECTOR: {
                 size_t new_vec_dim = strlen(accessed_field_name);
                 if (new_vec_dim > 4) {
@@ -2155,7 +2274,7 @@ static void duskAnalyzeExpr(
                     }
 
                     if (shuffle_indices_arr[j] >=
-                        left_expr->type->vector.size) {
+                        left_type->vector.size) {
                         duskAddError(
                             compiler,
                             right_expr->location,
@@ -2179,10 +2298,10 @@ static void duskAnalyzeExpr(
                     shuffle_indices_arr;
 
                 if (new_vec_dim == 1) {
-                    right_expr->type = left_expr->type->vector.sub;
+                    *right_type = left_type->vector.sub;
                 } else {
-                    right_expr->type = duskTypeNewVector(
-                        compiler, left_expr->type->vector.sub, (uint32_t)new_vec_dim);
+                    *right_type = duskTypeNewVector(
+                        compiler, left_type->vector.sub, (uint32_t)new_vec_dim);
                 }
 
                 break;
@@ -2190,7 +2309,7 @@ static void duskAnalyzeExpr(
             case DUSK_TYPE_STRUCT: {
                 uintptr_t field_index = 0;
                 if (!duskMapGet(
-                        left_expr->type->struct_.index_map,
+                        left_type->struct_.index_map,
                         accessed_field_name,
                         (void *)&field_index)) {
                     duskAddError(
@@ -2198,29 +2317,33 @@ static void duskAnalyzeExpr(
                         right_expr->location,
                         "no struct field named '%s' in type '%s'",
                         accessed_field_name,
-                        duskTypeToPrettyString(allocator, left_expr->type));
+                        duskTypeToPrettyString(allocator, left_type));
                     break;
                 }
 
-                right_expr->type =
-                    left_expr->type->struct_.field_types[field_index];
+                *right_type =
+                    left_type->struct_.field_types[field_index];
 
                 break;
             }
             case DUSK_TYPE_RUNTIME_ARRAY: {
                 if (strcmp(accessed_field_name, "len") == 0) {
-                    right_expr->type =
+                    *right_type =
                         duskTypeNewScalar(compiler, DUSK_SCALAR_TYPE_UINT);
 
                     bool is_array_struct_member = true;
                     if (i >= 2) {
-                        DuskExpr *struct_expr = expr->access.chain_arr[i - 2];
-                        if (struct_expr->type->kind != DUSK_TYPE_STRUCT) {
+                        DuskExprId struct_expr = expr->access.chain_arr[i - 2];
+                        DuskType *struct_type =
+                            compiler->expr_types_arr[struct_expr];
+                        if (struct_type->kind != DUSK_TYPE_STRUCT) {
                             is_array_struct_member = false;
                         }
                     } else if (i >= 1) {
-                        DuskExpr *struct_expr = expr->access.base_expr;
-                        if (struct_expr->type->kind != DUSK_TYPE_STRUCT) {
+                        DuskExprId struct_expr = expr->access.base_expr;
+                        DuskType *struct_type =
+                            compiler->expr_types_arr[struct_expr];
+                        if (struct_type->kind != DUSK_TYPE_STRUCT) {
                             is_array_struct_member = false;
                         }
                     } else {
@@ -2230,16 +2353,16 @@ static void duskAnalyzeExpr(
                     if (!is_array_struct_member) {
                         duskAddError(
                             compiler,
-                            left_expr->location,
+                            duskExprGet(compiler, left_expr_id)->location,
                             "a runtime-sized array's size must be accessed "
                             "starting from the struct where it is located");
                     }
                 } else {
                     duskAddError(
                         compiler,
-                        left_expr->location,
+                        duskExprGet(compiler, left_expr_id)->location,
                         "expression of type '%s' only has 'len' field",
-                        duskTypeToPrettyString(allocator, left_expr->type));
+                        duskTypeToPrettyString(allocator, left_type));
                 }
 
                 break;
@@ -2247,29 +2370,29 @@ static void duskAnalyzeExpr(
             default: {
                 duskAddError(
                     compiler,
-                    left_expr->location,
+                    duskExprGet(compiler, left_expr_id)->location,
                     "expression of type '%s' cannot be accessed",
-                    duskTypeToPrettyString(allocator, left_expr->type));
+                    duskTypeToPrettyString(allocator, left_type));
                 break;
             }
             }
 
-            left_expr = right_expr;
+            left_expr_id = right_expr_id;
         }
 
-        expr->type = left_expr->type;
+        *expr_type = compiler->expr_types_arr[left_expr_id];
 
         break;
     }
     case DUSK_EXPR_ARRAY_ACCESS: {
         duskAnalyzeExpr(
             compiler, state, expr->access.base_expr, NULL, must_be_assignable);
-        if (!expr->access.base_expr->type) {
+        if (!compiler->expr_types_arr[expr->access.base_expr]) {
             DUSK_ASSERT(duskArrayLength(compiler->errors_arr) > 0);
             break;
         }
 
-        DuskType *left_type = expr->access.base_expr->type;
+        DuskType *left_type = compiler->expr_types_arr[expr->access.base_expr];
 
         DuskType *index_type =
             duskTypeNewScalar(compiler, DUSK_SCALAR_TYPE_UINT);
@@ -2295,15 +2418,15 @@ static void duskAnalyzeExpr(
         }
 
         for (size_t i = 0; i < duskArrayLength(expr->access.chain_arr); ++i) {
-            DuskExpr *right_expr = expr->access.chain_arr[i];
+            DuskExprId right_expr = expr->access.chain_arr[i];
             duskAnalyzeExpr(compiler, state, right_expr, index_type, false);
-            if (!right_expr->type) {
+            if (!compiler->expr_types_arr[right_expr]) {
                 DUSK_ASSERT(duskArrayLength(compiler->errors_arr) > 0);
                 break;
             }
         }
 
-        expr->type = left_type;
+        *expr_type = left_type;
 
         break;
     }
@@ -2311,8 +2434,8 @@ static void duskAnalyzeExpr(
         duskAnalyzeExpr(compiler, state, expr->binary.left, NULL, false);
         duskAnalyzeExpr(compiler, state, expr->binary.right, NULL, false);
 
-        DuskType *left_type = expr->binary.left->type;
-        DuskType *right_type = expr->binary.right->type;
+        DuskType *left_type = compiler->expr_types_arr[expr->binary.left];
+        DuskType *right_type = compiler->expr_types_arr[expr->binary.right];
 
         if (!left_type) {
             DUSK_ASSERT(duskArrayLength(compiler->errors_arr) > 0);
@@ -2339,7 +2462,7 @@ static void duskAnalyzeExpr(
                     duskTypeToPrettyString(allocator, left_type),
                     duskTypeToPrettyString(allocator, right_type));
             }
-            expr->type = duskTypeNewBasic(compiler, DUSK_TYPE_BOOL);
+            *expr_type = duskTypeNewBasic(compiler, DUSK_TYPE_BOOL);
             done_analysis = true;
             break;
         }
@@ -2364,11 +2487,13 @@ static void duskAnalyzeExpr(
         }
 
         if (expected_scalar_type) {
-            duskConcretizeExprType(expr->binary.left, expected_scalar_type);
-            duskConcretizeExprType(expr->binary.right, expected_scalar_type);
+            duskConcretizeExprType(
+                compiler, expr->binary.left, expected_scalar_type);
+            duskConcretizeExprType(
+                compiler, expr->binary.right, expected_scalar_type);
 
-            left_type = expr->binary.left->type;
-            right_type = expr->binary.right->type;
+            left_type = compiler->expr_types_arr[expr->binary.left];
+            right_type = compiler->expr_types_arr[expr->binary.right];
             left_scalar_type = duskGetScalarType(left_type);
             right_scalar_type = duskGetScalarType(right_type);
         }
@@ -2376,7 +2501,7 @@ static void duskAnalyzeExpr(
         if (!left_scalar_type) {
             duskAddError(
                 compiler,
-                expr->binary.left->location,
+                duskExprGet(compiler, expr->binary.left)->location,
                 "cannot perform binary operation on type '%s'",
                 duskTypeToPrettyString(allocator, left_type));
             break;
@@ -2385,7 +2510,7 @@ static void duskAnalyzeExpr(
         if (!right_scalar_type) {
             duskAddError(
                 compiler,
-                expr->binary.right->location,
+                duskExprGet(compiler, expr->binary.right)->location,
                 "cannot perform binary operation on type '%s'",
                 duskTypeToPrettyString(allocator, right_type));
             break;
@@ -2395,43 +2520,43 @@ static void duskAnalyzeExpr(
             if (left_type->kind == DUSK_TYPE_VECTOR &&
                 left_type->vector.sub == right_type) {
                 // vector * scalar
-                expr->type = left_type;
+                *expr_type = left_type;
             } else if (
                 // scalar * vector
                 right_type->kind == DUSK_TYPE_VECTOR &&
                 right_type->vector.sub == left_type) {
-                expr->type = right_type;
+                *expr_type = right_type;
             } else if (
                 left_type->kind == DUSK_TYPE_MATRIX &&
                 left_type->matrix.col_type->vector.sub == right_type) {
                 // matrix * scalar
-                expr->type = left_type;
+                *expr_type = left_type;
             } else if (
                 right_type->kind == DUSK_TYPE_MATRIX &&
                 right_type->matrix.col_type->vector.sub == left_type) {
                 // scalar * matrix
-                expr->type = right_type;
+                *expr_type = right_type;
             } else if (
                 left_type->kind == DUSK_TYPE_VECTOR &&
                 right_type->kind == DUSK_TYPE_MATRIX &&
                 left_type == right_type->matrix.col_type) {
                 // vector * matrix
-                expr->type = left_type;
+                *expr_type = left_type;
             } else if (
                 left_type->kind == DUSK_TYPE_MATRIX &&
                 right_type->kind == DUSK_TYPE_VECTOR &&
                 right_type == left_type->matrix.col_type) {
                 // matrix * vector
-                expr->type = right_type;
+                *expr_type = right_type;
             } else if (left_type == right_type) {
                 // scalar * scalar
                 // vector * vector
                 // matrix * matrix
-                expr->type = left_type;
+                *expr_type = left_type;
             } else {
                 duskAddError(
                     compiler,
-                    expr->binary.right->location,
+                    duskExprGet(compiler, expr->binary.right)->location,
                     "mismatched types for binary operation: '%s' and '%s'",
                     duskTypeToPrettyString(allocator, left_type),
                     duskTypeToPrettyString(allocator, right_type));
@@ -2441,16 +2566,16 @@ static void duskAnalyzeExpr(
             if (left_type != right_type) {
                 duskAddError(
                     compiler,
-                    expr->binary.right->location,
+                    duskExprGet(compiler, expr->binary.right)->location,
                     "mismatched types for binary operation: '%s' and '%s'",
                     duskTypeToPrettyString(allocator, left_type),
                     duskTypeToPrettyString(allocator, right_type));
                 break;
             }
-            expr->type = left_type;
+            *expr_type = left_type;
         }
 
-        DUSK_ASSERT(expr->type);
+        DUSK_ASSERT(*expr_type);
 
         switch (expr->binary.op) {
         // Int/float
@@ -2468,7 +2593,7 @@ static void duskAnalyzeExpr(
         case DUSK_BINARY_OP_BITXOR:
         case DUSK_BINARY_OP_LSHIFT:
         case DUSK_BINARY_OP_RSHIFT: {
-            DuskType *expr_scalar_type = duskGetScalarType(expr->type);
+            DuskType *expr_scalar_type = duskGetScalarType(*expr_type);
             if (expr_scalar_type->kind == DUSK_TYPE_FLOAT ||
                 expr_scalar_type->kind == DUSK_TYPE_UNTYPED_FLOAT) {
                 duskAddError(
@@ -2476,7 +2601,7 @@ static void duskAnalyzeExpr(
                     expr->location,
                     "binary operation only works on integer types, instead got "
                     "type: '%s'",
-                    duskTypeToPrettyString(allocator, expr->type));
+                    duskTypeToPrettyString(allocator, *expr_type));
             }
 
             break;
@@ -2489,7 +2614,7 @@ static void duskAnalyzeExpr(
         case DUSK_BINARY_OP_LESSEQ:
         case DUSK_BINARY_OP_GREATER:
         case DUSK_BINARY_OP_GREATEREQ: {
-            expr->type = duskTypeNewBasic(compiler, DUSK_TYPE_BOOL);
+            *expr_type = duskTypeNewBasic(compiler, DUSK_TYPE_BOOL);
             break;
         }
 
@@ -2503,7 +2628,7 @@ static void duskAnalyzeExpr(
     case DUSK_EXPR_UNARY: {
         duskAnalyzeExpr(
             compiler, state, expr->unary.right, expected_type, false);
-        DuskType *right_type = expr->unary.right->type;
+        DuskType *right_type = compiler->expr_types_arr[expr->unary.right];
         if (!right_type) {
             DUSK_ASSERT(duskArrayLength(compiler->errors_arr) > 0);
             break;
@@ -2555,45 +2680,112 @@ static void duskAnalyzeExpr(
             break;
         }
 
-        expr->type = right_type;
+        *expr_type = right_type;
     }
     }
 
-    if (!expr->type) {
+    if (!*expr_type) {
         DUSK_ASSERT(duskArrayLength(compiler->errors_arr) > 0);
     }
 
-    {
-        int64_t resolved_int;
-        if (duskExprResolveInteger(state, expr, &resolved_int)) {
-            expr->resolved_int =
-                duskAllocateZeroed(allocator, sizeof(*expr->resolved_int));
-            *expr->resolved_int = resolved_int;
-        }
-    }
-
-    if (expected_type && expr->type) {
-        if (expected_type != expr->type) {
+    if (expected_type && *expr_type) {
+        if (expected_type != *expr_type) {
             duskAddError(
                 compiler,
                 expr->location,
                 "type mismatch, expected '%s', instead got '%s'",
                 duskTypeToPrettyString(allocator, expected_type),
-                duskTypeToPrettyString(allocator, expr->type));
+                duskTypeToPrettyString(allocator, *expr_type));
         }
     }
 
-    if (must_be_assignable && !duskIsExprAssignable(state, expr)) {
+    if (must_be_assignable && !duskIsExprAssignable(compiler, state, expr_id)) {
         duskAddError(
             compiler, expr->location, "expected expression to be assignable");
     }
 }
 
-static void duskAnalyzeStmt(
+static void duskAnalyzeLoopAttributes(
     DuskCompiler *compiler, DuskAnalyzerState *state, DuskStmt *stmt)
+{
+    DuskArray(DuskAttribute) attributes_arr = stmt->while_.attributes_arr;
+    duskAnalyzeAttributes(compiler, state, attributes_arr);
+
+    stmt->while_.unroll_hint = DUSK_IR_UNROLL_DEFAULT;
+    stmt->while_.unroll_count = 0;
+
+    for (size_t i = 0; i < duskArrayLength(attributes_arr); ++i) {
+        DuskAttribute *attrib = &attributes_arr[i];
+        switch (attrib->kind) {
+        case DUSK_ATTRIBUTE_UNROLL:
+        case DUSK_ATTRIBUTE_DONT_UNROLL: {
+            if (attrib->kind == DUSK_ATTRIBUTE_UNROLL &&
+                attrib->value_expr_count > 1) {
+                duskAddError(
+                    compiler,
+                    stmt->location,
+                    "'unroll' attribute requires at most 1 parameter");
+                continue;
+            }
+            if (attrib->kind == DUSK_ATTRIBUTE_DONT_UNROLL &&
+                attrib->value_expr_count != 0) {
+                duskAddError(
+                    compiler,
+                    stmt->location,
+                    "'dont_unroll' attribute requires 0 parameters");
+                continue;
+            }
+
+            uint32_t unroll_count = 0;
+            if (attrib->value_expr_count == 1) {
+                int64_t resolved_int;
+                if (!duskExprResolveInteger(
+                        compiler, attrib->value_exprs[0], &resolved_int) ||
+                    resolved_int <= 0 || resolved_int > UINT32_MAX) {
+                    duskAddError(
+                        compiler,
+                        stmt->location,
+                        "'unroll' attribute requires a positive integer "
+                        "parameter");
+                    continue;
+                }
+                unroll_count = (uint32_t)resolved_int;
+            }
+
+            DuskIRUnrollHint unroll_hint =
+                attrib->kind == DUSK_ATTRIBUTE_UNROLL ? DUSK_IR_UNROLL_ALWAYS
+                                                      : DUSK_IR_UNROLL_NEVER;
+            if (stmt->while_.unroll_hint != DUSK_IR_UNROLL_DEFAULT &&
+                stmt->while_.unroll_hint != unroll_hint) {
+                duskAddError(
+                    compiler,
+                    stmt->location,
+                    "loop cannot have both the 'unroll' and 'dont_unroll' "
+                    "attributes");
+                continue;
+            }
+            stmt->while_.unroll_hint = unroll_hint;
+            stmt->while_.unroll_count = unroll_count;
+            break;
+        }
+        default: {
+            duskAddError(
+                compiler,
+                stmt->location,
+                "unexpected attribute: '%s'",
+                duskGetAttributeName(attrib->kind));
+            break;
+        }
+        }
+    }
+}
+
+static void duskAnalyzeStmt(
+    DuskCompiler *compiler, DuskAnalyzerState *state, DuskStmtId stmt_id)
 {
     DuskAllocator *allocator = duskArenaGetAllocator(compiler->main_arena);
 
+    DuskStmt *stmt = duskStmtGet(compiler, stmt_id);
     switch (stmt->kind) {
     case DUSK_STMT_DECL: {
         duskAnalyzeDecl(compiler, state, stmt->decl);
@@ -2606,12 +2798,13 @@ static void duskAnalyzeStmt(
     }
     case DUSK_STMT_RETURN: {
         DUSK_ASSERT(duskArrayLength(state->function_stack_arr) > 0);
-        DuskDecl *func = state->function_stack_arr
-                             [duskArrayLength(state->function_stack_arr) - 1];
+        DuskDeclId func_id = state->function_stack_arr
+            [duskArrayLength(state->function_stack_arr) - 1];
+        DuskType *func_type = compiler->decl_types_arr[func_id];
 
-        DUSK_ASSERT(func->type);
+        DUSK_ASSERT(func_type);
 
-        DuskType *return_type = func->type->function.return_type;
+        DuskType *return_type = func_type->function.return_type;
         if (stmt->return_.expr) {
             duskAnalyzeExpr(
                 compiler, state, stmt->return_.expr, return_type, false);
@@ -2629,16 +2822,16 @@ static void duskAnalyzeStmt(
     }
     case DUSK_STMT_DISCARD: {
         DUSK_ASSERT(duskArrayLength(state->function_stack_arr) > 0);
-        DuskDecl *func = state->function_stack_arr
-                             [duskArrayLength(state->function_stack_arr) - 1];
+        DuskDeclId func_id = state->function_stack_arr
+            [duskArrayLength(state->function_stack_arr) - 1];
 
-        DUSK_ASSERT(func->type);
+        DUSK_ASSERT(compiler->decl_types_arr[func_id]);
         break;
     }
     case DUSK_STMT_ASSIGN: {
         duskAnalyzeExpr(
             compiler, state, stmt->assign.assigned_expr, NULL, true);
-        DuskType *type = stmt->assign.assigned_expr->type;
+        DuskType *type = compiler->expr_types_arr[stmt->assign.assigned_expr];
         if (!type) {
             DUSK_ASSERT(duskArrayLength(compiler->errors_arr) > 0);
             break;
@@ -2652,11 +2845,11 @@ static void duskAnalyzeStmt(
             allocator,
             duskCurrentScope(state),
             DUSK_SCOPE_OWNER_TYPE_NONE,
-            NULL);
+            0);
 
         for (size_t i = 0; i < duskArrayLength(stmt->block.stmts_arr); ++i) {
-            DuskStmt *sub_stmt = stmt->block.stmts_arr[i];
-            duskAnalyzeStmt(compiler, state, sub_stmt);
+            DuskStmtId sub_stmt_id = stmt->block.stmts_arr[i];
+            duskAnalyzeStmt(compiler, state, sub_stmt_id);
         }
         break;
     }
@@ -2672,12 +2865,14 @@ static void duskAnalyzeStmt(
         break;
     }
     case DUSK_STMT_WHILE: {
+        duskAnalyzeLoopAttributes(compiler, state, stmt);
+
         DuskType *bool_ty = duskTypeNewBasic(compiler, DUSK_TYPE_BOOL);
         duskAnalyzeExpr(
             compiler, state, stmt->while_.cond_expr, bool_ty, false);
 
-        duskArrayPush(&state->break_stack_arr, stmt);
-        duskArrayPush(&state->continue_stack_arr, stmt);
+        duskArrayPush(&state->break_stack_arr, stmt_id);
+        duskArrayPush(&state->continue_stack_arr, stmt_id);
 
         duskAnalyzeStmt(compiler, state, stmt->while_.stmt);
 
@@ -2706,11 +2901,12 @@ static void duskAnalyzeStmt(
 }
 
 static void duskTryRegisterDecl(
-    DuskCompiler *compiler, DuskAnalyzerState *state, DuskDecl *decl)
+    DuskCompiler *compiler, DuskAnalyzerState *state, DuskDeclId decl_id)
 {
+    DuskDecl *decl = duskDeclGet(compiler, decl_id);
     DuskScope *scope = duskCurrentScope(state);
     DUSK_ASSERT(decl->name);
-    if (duskScopeLookup(scope, decl->name) != NULL) {
+    if (duskScopeLookup(scope, decl->name)) {
         duskAddError(
             compiler,
             decl->location,
@@ -2719,37 +2915,57 @@ static void duskTryRegisterDecl(
         return;
     }
 
-    duskScopeSet(scope, decl->name, decl);
+    duskScopeSet(scope, decl->name, decl_id);
 }
 
 static void duskAnalyzeDecl(
-    DuskCompiler *compiler, DuskAnalyzerState *state, DuskDecl *decl)
+    DuskCompiler *compiler, DuskAnalyzerState *state, DuskDeclId decl_id)
 {
     DuskAllocator *allocator = duskArenaGetAllocator(compiler->main_arena);
 
-    for (size_t i = 0; i < duskArrayLength(decl->attributes_arr); ++i) {
-        DuskAttribute *attribute = &decl->attributes_arr[i];
+    DuskDecl *decl = duskDeclGet(compiler, decl_id);
+    DuskType **decl_type = &compiler->decl_types_arr[decl_id];
 
-        for (size_t j = 0; j < attribute->value_expr_count; ++j) {
-            DuskExpr *value_expr = attribute->value_exprs[j];
-            int64_t resolved_int;
-            if (duskExprResolveInteger(state, value_expr, &resolved_int)) {
-                value_expr->resolved_int =
-                    duskAllocateZeroed(allocator, sizeof(int64_t));
-                *value_expr->resolved_int = resolved_int;
-            }
-        }
-    }
+    duskAnalyzeAttributes(compiler, state, decl->attributes_arr);
 
     switch (decl->kind) {
     case DUSK_DECL_FUNCTION: {
         DUSK_ASSERT(decl->function.scope == NULL);
 
         decl->function.link_name = decl->name;
+        decl->function.inline_hint = DUSK_IR_INLINE_DEFAULT;
 
         for (size_t i = 0; i < duskArrayLength(decl->attributes_arr); ++i) {
             DuskAttribute *attrib = &decl->attributes_arr[i];
             switch (attrib->kind) {
+            case DUSK_ATTRIBUTE_INLINE:
+            case DUSK_ATTRIBUTE_NOINLINE: {
+                if (attrib->value_expr_count != 0) {
+                    duskAddError(
+                        compiler,
+                        decl->location,
+                        "'%s' attribute requires 0 parameters",
+                        attrib->name);
+                    continue;
+                }
+
+                DuskIRInlineHint inline_hint =
+                    attrib->kind == DUSK_ATTRIBUTE_INLINE
+                        ? DUSK_IR_INLINE_ALWAYS
+                        : DUSK_IR_INLINE_NEVER;
+                if (decl->function.inline_hint != DUSK_IR_INLINE_DEFAULT &&
+                    decl->function.inline_hint != inline_hint) {
+                    duskAddError(
+                        compiler,
+                        decl->location,
+                        "function cannot have both the 'inline' and "
+                        "'noinline' attributes");
+                    continue;
+                }
+                decl->function.inline_hint = inline_hint;
+                break;
+            }
+
             case DUSK_ATTRIBUTE_STAGE: {
                 if (attrib->value_expr_count != 1) {
                     duskAddError(
@@ -2760,7 +2976,9 @@ static void duskAnalyzeDecl(
                     continue;
                 }
 
-                if (attrib->value_exprs[0]->kind != DUSK_EXPR_IDENT) {
+                DuskExpr *stage_expr =
+                    duskExprGet(compiler, attrib->value_exprs[0]);
+                if (stage_expr->kind != DUSK_EXPR_IDENT) {
                     duskAddError(
                         compiler,
                         decl->location,
@@ -2771,7 +2989,7 @@ static void duskAnalyzeDecl(
 
                 decl->function.is_entry_point = true;
 
-                const char *stage_str = attrib->value_exprs[0]->identifier.str;
+                const char *stage_str = stage_expr->identifier.str;
                 if (strcmp(stage_str, "fragment") == 0) {
                     decl->function.entry_point_stage =
                         DUSK_SHADER_STAGE_FRAGMENT;
@@ -2795,28 +3013,22 @@ static void duskAnalyzeDecl(
             }
         }
 
-        for (size_t i = 0;
-             i < duskArrayLength(decl->function.return_type_attributes_arr);
-             ++i) {
-            DuskAttribute *attribute =
-                &decl->function.return_type_attributes_arr[i];
-
-            for (size_t j = 0; j < attribute->value_expr_count; ++j) {
-                DuskExpr *value_expr = attribute->value_exprs[j];
-                int64_t resolved_int;
-                if (duskExprResolveInteger(state, value_expr, &resolved_int)) {
-                    value_expr->resolved_int =
-                        duskAllocateZeroed(allocator, sizeof(int64_t));
-                    *value_expr->resolved_int = resolved_int;
-                }
-            }
+        if (decl->function.is_entry_point &&
+            decl->function.inline_hint != DUSK_IR_INLINE_DEFAULT) {
+            duskAddError(
+                compiler,
+                decl->location,
+                "entry point cannot have inlining attributes");
         }
 
+        duskAnalyzeAttributes(
+            compiler, state, decl->function.return_type_attributes_arr);
+
         decl->function.scope = duskScopeCreate(
             allocator,
             duskCurrentScope(state),
             DUSK_SCOPE_OWNER_TYPE_FUNCTION,
-            decl);
+            decl_id);
 
         DuskType *type_type = duskTypeNewBasic(compiler, DUSK_TYPE_TYPE);
 
@@ -2830,16 +3042,17 @@ static void duskAnalyzeDecl(
 
         duskAnalyzeExpr(
             compiler, state, decl->function.return_type_expr, type_type, false);
-        return_type = decl->function.return_type_expr->as_type;
+        return_type =
+            compiler->expr_as_types_arr[decl->function.return_type_expr];
 
-        duskArrayPush(&state->function_stack_arr, decl);
+        duskArrayPush(&state->function_stack_arr, decl_id);
         duskArrayPush(&state->scope_stack_arr, decl->function.scope);
 
         for (size_t i = 0; i < param_count; ++i) {
-            DuskDecl *param_decl = decl->function.parameter_decls_arr[i];
-            duskTryRegisterDecl(compiler, state, param_decl);
-            duskAnalyzeDecl(compiler, state, param_decl);
-            param_types[i] = param_decl->type;
+            DuskDeclId param_decl_id = decl->function.parameter_decls_arr[i];
+            duskTryRegisterDecl(compiler, state, param_decl_id);
+            duskAnalyzeDecl(compiler, state, param_decl_id);
+            param_types[i] = compiler->decl_types_arr[param_decl_id];
             if (param_types[i] == NULL) {
                 got_all_param_types = false;
             }
@@ -2852,27 +3065,27 @@ static void duskAnalyzeDecl(
             break;
         }
 
-        decl->type = duskTypeNewFunction(
+        *decl_type = duskTypeNewFunction(
             compiler, return_type, param_count, param_types);
 
         if (decl->function.is_entry_point) {
             for (size_t i = 0; i < param_count; ++i) {
-                DuskDecl *param_decl = decl->function.parameter_decls_arr[i];
-                if (param_decl->type->kind != DUSK_TYPE_STRUCT) {
+                DuskDecl *param_decl = duskDeclGet(
+                    compiler, decl->function.parameter_decls_arr[i]);
+                DuskType *param_type = param_types[i];
+                if (param_type->kind != DUSK_TYPE_STRUCT) {
                     duskCheckEntryPointInterfaceAttributes(
-                        state,
                         compiler,
                         param_decl->location,
                         param_decl->attributes_arr);
                 } else {
-                    DuskType *struct_type = param_decl->type;
+                    DuskType *struct_type = param_type;
                     for (size_t j = 0; j < struct_type->struct_.field_count;
                          ++j) {
                         DuskArray(DuskAttribute) field_attributes_arr =
                             struct_type->struct_.field_attribute_arrays[j];
 
                         duskCheckEntryPointInterfaceAttributes(
-                            state,
                             compiler,
                             param_decl->location,
                             field_attributes_arr);
@@ -2880,22 +3093,21 @@ static void duskAnalyzeDecl(
                 }
             }
 
-            switch (decl->type->function.return_type->kind) {
+            switch (return_type->kind) {
             case DUSK_TYPE_VOID: break;
             case DUSK_TYPE_STRUCT: {
-                DuskType *struct_type = decl->type->function.return_type;
+                DuskType *struct_type = return_type;
                 for (size_t j = 0; j < struct_type->struct_.field_count; ++j) {
                     DuskArray(DuskAttribute) field_attributes_arr =
                         struct_type->struct_.field_attribute_arrays[j];
 
                     duskCheckEntryPointInterfaceAttributes(
-                        state, compiler, decl->location, field_attributes_arr);
+                        compiler, decl->location, field_attributes_arr);
                 }
                 break;
             }
             default: {
                 duskCheckEntryPointInterfaceAttributes(
-                    state,
                     compiler,
                     decl->location,
                     decl->function.return_type_attributes_arr);
@@ -2904,25 +3116,8 @@ static void duskAnalyzeDecl(
             }
         }
 
-        bool got_return_stmt = false;
-
-        for (size_t i = 0; i < duskArrayLength(decl->function.stmts_arr); ++i) {
-            DuskStmt *stmt = decl->function.stmts_arr[i];
-            duskAnalyzeStmt(compiler, state, stmt);
-
-            if (stmt->kind == DUSK_STMT_RETURN) {
-                got_return_stmt = true;
-            }
-        }
-
-        if ((decl->type->function.return_type->kind != DUSK_TYPE_VOID) &&
-            (!got_return_stmt)) {
-            duskAddError(
-                compiler,
-                decl->location,
-                "no return statement found for function '%s'",
-                decl->function.link_name);
-        }
+        // The body is analyzed separately by duskAnalyzeFunctionBody, once the
+        // signatures of all declarations are known
 
         duskArrayPop(&state->function_stack_arr);
         duskArrayPop(&state->scope_stack_arr);
@@ -2932,14 +3127,67 @@ static void duskAnalyzeDecl(
     case DUSK_DECL_TYPE: {
         DuskType *type_type = duskTypeNewBasic(compiler, DUSK_TYPE_TYPE);
 
-        if (decl->typedef_.type_expr->kind == DUSK_EXPR_STRUCT_TYPE) {
-            decl->typedef_.type_expr->struct_type.name = decl->name;
+        DuskExpr *type_expr = duskExprGet(compiler, decl->typedef_.type_expr);
+        if (type_expr->kind == DUSK_EXPR_STRUCT_TYPE) {
+            type_expr->struct_type->name = decl->name;
         }
 
         duskAnalyzeExpr(
             compiler, state, decl->typedef_.type_expr, type_type, false);
-        decl->type = type_type;
+        *decl_type = type_type;
+
+        break;
+    }
+    case DUSK_DECL_CONST: {
+        DuskType *type_type = duskTypeNewBasic(compiler, DUSK_TYPE_TYPE);
+
+        DuskType *const_type = NULL;
+        if (decl->const_.type_expr) {
+            duskAnalyzeExpr(
+                compiler, state, decl->const_.type_expr, type_type, false);
+            const_type = compiler->expr_as_types_arr[decl->const_.type_expr];
+            if (!const_type) {
+                DUSK_ASSERT(duskArrayLength(compiler->errors_arr) > 0);
+                break;
+            }
+        }
+
+        duskAnalyzeExpr(
+            compiler, state, decl->const_.value_expr, const_type, false);
+        if (!const_type) {
+            const_type = compiler->expr_types_arr[decl->const_.value_expr];
+        }
+
+        if (!const_type) {
+            DUSK_ASSERT(duskArrayLength(compiler->errors_arr) > 0);
+            break;
+        }
+
+        // Constants without a type annotation can stay untyped, and take the
+        // type of the expressions they are used in
+        if (!duskTypeIsRuntime(const_type) &&
+            const_type->kind != DUSK_TYPE_UNTYPED_INT &&
+            const_type->kind != DUSK_TYPE_UNTYPED_FLOAT) {
+            duskAddError(
+                compiler,
+                decl->location,
+                "constant type is not representable at runtime: '%s'",
+                duskTypeToPrettyString(allocator, const_type));
+            break;
+        }
 
+        decl->const_.value =
+            duskConstEvaluate(compiler, allocator, decl->const_.value_expr);
+        if (!decl->const_.value) {
+            duskAddError(
+                compiler,
+                duskExprGet(compiler, decl->const_.value_expr)->location,
+                "value of constant '%s' is not known at compile time",
+                decl->name);
+            break;
+        }
+
+        *decl_type = const_type;
         break;
     }
     case DUSK_DECL_VAR: {
@@ -2964,14 +3212,14 @@ static void duskAnalyzeDecl(
         if (decl->var.type_expr) {
             duskAnalyzeExpr(
                 compiler, state, decl->var.type_expr, type_type, false);
-            var_type = decl->var.type_expr->as_type;
+            var_type = compiler->expr_as_types_arr[decl->var.type_expr];
         }
 
         if (decl->var.value_expr) {
             duskAnalyzeExpr(
                 compiler, state, decl->var.value_expr, var_type, false);
             if (!var_type) {
-                var_type = decl->var.value_expr->type;
+                var_type = compiler->expr_types_arr[decl->var.value_expr];
             }
         }
 
@@ -2993,7 +3241,7 @@ static void duskAnalyzeDecl(
             break;
         }
 
-        decl->type = var_type;
+        *decl_type = var_type;
 
         if (duskArrayLength(state->function_stack_arr) == 0) {
             duskCheckGlobalVariableAttributes(
@@ -3002,7 +3250,7 @@ static void duskAnalyzeDecl(
 
         // Analyze the storage class
         if (duskArrayLength(state->function_stack_arr) == 0) {
-            switch (decl->type->kind) {
+            switch (var_type->kind) {
             case DUSK_TYPE_SAMPLER:
             case DUSK_TYPE_IMAGE:
             case DUSK_TYPE_SAMPLED_IMAGE: {
@@ -3031,15 +3279,15 @@ static void duskAnalyzeDecl(
 
         DuskType *struct_type = NULL;
 
-        switch (decl->type->kind) {
+        switch (var_type->kind) {
         case DUSK_TYPE_STRUCT: {
-            struct_type = decl->type;
+            struct_type = var_type;
             break;
         }
         case DUSK_TYPE_ARRAY:
         case DUSK_TYPE_RUNTIME_ARRAY: {
-            if (decl->type->array.sub->kind == DUSK_TYPE_STRUCT) {
-                struct_type = decl->type->array.sub;
+            if (var_type->array.sub->kind == DUSK_TYPE_STRUCT) {
+                struct_type = var_type->array.sub;
             }
 
             if (decl->var.storage_class == DUSK_STORAGE_CLASS_STORAGE &&
@@ -3096,30 +3344,322 @@ static void duskAnalyzeDecl(
     }
 }
 
-void duskAnalyzeFile(DuskCompiler *compiler, DuskFile *file)
+static void duskAnalyzeFunctionBody(
+    DuskCompiler *compiler, DuskAnalyzerState *state, DuskDeclId decl_id)
 {
     DuskAllocator *allocator = duskArenaGetAllocator(compiler->main_arena);
 
+    DuskDecl *decl = duskDeclGet(compiler, decl_id);
+
+    // Locals get a scope of their own, as the function's scope was allocated
+    // by whoever analyzed the signature
+    DuskScope *body_scope = duskScopeCreate(
+        allocator,
+        decl->function.scope,
+        DUSK_SCOPE_OWNER_TYPE_FUNCTION,
+        decl_id);
+
+    duskArrayPush(&state->function_stack_arr, decl_id);
+    duskArrayPush(&state->scope_stack_arr, body_scope);
+
+    bool got_return_stmt = false;
+
+    for (size_t i = 0; i < duskArrayLength(decl->function.stmts_arr); ++i) {
+        DuskStmtId stmt_id = decl->function.stmts_arr[i];
+        duskAnalyzeStmt(compiler, state, stmt_id);
+
+        if (duskStmtGet(compiler, stmt_id)->kind == DUSK_STMT_RETURN) {
+            got_return_stmt = true;
+        }
+    }
+
+    DuskType *func_type = compiler->decl_types_arr[decl_id];
+    if ((func_type->function.return_type->kind != DUSK_TYPE_VOID) &&
+        (!got_return_stmt)) {
+        duskAddError(
+            compiler,
+            decl->location,
+            "no return statement found for function '%s'",
+            decl->function.link_name);
+    }
+
+    duskArrayPop(&state->function_stack_arr);
+    duskArrayPop(&state->scope_stack_arr);
+}
+
+static DuskAnalyzerState *duskAnalyzerStateCreate(
+    DuskAllocator *allocator, DuskFile *file, DuskMap *decl_indices)
+{
     DuskAnalyzerState *state = DUSK_NEW(allocator, DuskAnalyzerState);
     *state = (DuskAnalyzerState){
         .scope_stack_arr = duskArrayCreate(allocator, DuskScope *),
-        .break_stack_arr = duskArrayCreate(allocator, DuskStmt *),
-        .continue_stack_arr = duskArrayCreate(allocator, DuskStmt *),
-        .function_stack_arr = duskArrayCreate(allocator, DuskDecl *),
+        .break_stack_arr = duskArrayCreate(allocator, DuskStmtId),
+        .continue_stack_arr = duskArrayCreate(allocator, DuskStmtId),
+        .function_stack_arr = duskArrayCreate(allocator, DuskDeclId),
         .struct_layout_stack_arr = duskArrayCreate(allocator, DuskStructLayout),
+        .file = file,
+        .decl_indices = decl_indices,
     };
-
     duskArrayPush(&state->scope_stack_arr, file->scope);
+    return state;
+}
+
+#define DUSK_PARALLEL_ANALYSIS_MIN_LENGTH (1 << 16)
+#define DUSK_PARALLEL_ANALYSIS_MAX_THREADS 64
+
+typedef struct DuskDeclAnalysis {
+    DuskDeclId decl_id;
+    size_t index;
+    // Types asked for while analyzing the declaration and its body, used to
+    // order the new types as if everything was analyzed in a single pass
+    DuskArray(DuskType *) types_arr;
+    DuskArray(DuskType *) body_types_arr;
+    // Names looked up by the body, merged into the declaration's afterwards
+    DuskMap *body_referenced_names;
+} DuskDeclAnalysis;
+
+typedef struct DuskAnalysisJob {
+    // Each job gets its own copy of the compiler with a separate arena and
+    // error list, types are interned by the compiler it was copied from
+    DuskCompiler compiler;
+    DuskFile *file;
+    DuskMap *decl_indices;
+    DuskDeclAnalysis **bodies;
+    size_t body_count;
+} DuskAnalysisJob;
+
+static void duskAnalyzeBody(
+    DuskCompiler *compiler,
+    DuskAnalyzerState *state,
+    DuskDeclAnalysis *analysis)
+{
+    DuskAllocator *allocator = duskArenaGetAllocator(compiler->main_arena);
+
+    analysis->body_referenced_names = duskMapCreate(allocator, 16);
+    state->referenced_names = analysis->body_referenced_names;
+    state->decl_index = analysis->index;
+    compiler->requested_types_arr = duskArrayCreate(allocator, DuskType *);
+
+    duskAnalyzeFunctionBody(compiler, state, analysis->decl_id);
+
+    analysis->body_types_arr = compiler->requested_types_arr;
+    compiler->requested_types_arr = NULL;
+    state->referenced_names = NULL;
+}
+
+static void duskAnalysisJobRun(void *user_data)
+{
+    DuskAnalysisJob *job = (DuskAnalysisJob *)user_data;
+    DuskCompiler *compiler = &job->compiler;
+    DuskAllocator *allocator = duskArenaGetAllocator(compiler->main_arena);
+
+    DuskAnalyzerState *state =
+        duskAnalyzerStateCreate(allocator, job->file, job->decl_indices);
+    for (size_t i = 0; i < job->body_count; ++i) {
+        duskAnalyzeBody(compiler, state, job->bodies[i]);
+    }
+}
 
-    for (size_t i = 0; i < duskArrayLength(file->decls_arr); ++i) {
-        DuskDecl *decl = file->decls_arr[i];
-        duskTryRegisterDecl(compiler, state, decl);
+// Analyzes the function bodies on worker threads if there is enough of them.
+// Returns false if they should be analyzed serially instead.
+static bool duskAnalyzeBodiesInParallel(
+    DuskCompiler *compiler,
+    DuskFile *file,
+    DuskMap *decl_indices,
+    DuskArray(DuskDeclAnalysis *) bodies_arr)
+{
+    DuskAllocator *allocator = duskArenaGetAllocator(compiler->main_arena);
+
+    // Bodies that use a declaration which failed to analyze expect its error
+    // to be in their own error list
+    if (!compiler->type_mutex || duskArrayLength(compiler->errors_arr) > 0 ||
+        duskArrayLength(file->decl_extents_arr) !=
+            duskArrayLength(file->decls_arr)) {
+        return false;
+    }
+
+    uint32_t thread_count = duskCompilerGetThreadCount(compiler);
+    if (thread_count > DUSK_PARALLEL_ANALYSIS_MAX_THREADS) {
+        thread_count = DUSK_PARALLEL_ANALYSIS_MAX_THREADS;
+    }
+
+    size_t body_count = duskArrayLength(bodies_arr);
+    size_t total_length = 0;
+    for (size_t i = 0; i < body_count; ++i) {
+        total_length += file->decl_extents_arr[bodies_arr[i]->index].length;
+    }
+
+    if (total_length < DUSK_PARALLEL_ANALYSIS_MIN_LENGTH || thread_count <= 1 ||
+        body_count < 2) {
+        return false;
+    }
+
+    if (thread_count > body_count) thread_count = (uint32_t)body_count;
+
+    // Hand out contiguous runs of functions with roughly the same amount of
+    // text to each job
+    DuskAnalysisJob *jobs =
+        DUSK_NEW_ARRAY(allocator, DuskAnalysisJob, thread_count);
+    size_t length_per_job = total_length / thread_count + 1;
+    size_t body_index = 0;
+    for (uint32_t i = 0; i < thread_count; ++i) {
+        DuskAnalysisJob *job = &jobs[i];
+        job->compiler = *compiler;
+        job->compiler.main_arena = duskArenaCreate(NULL, 1 << 16);
+        DuskAllocator *job_allocator =
+            duskArenaGetAllocator(job->compiler.main_arena);
+        job->compiler.errors_arr = duskArrayCreate(job_allocator, DuskError);
+        job->compiler.type_owner = compiler;
+        duskArrayPush(&compiler->worker_arenas_arr, job->compiler.main_arena);
+
+        job->file = file;
+        job->decl_indices = decl_indices;
+        job->bodies = &bodies_arr[body_index];
+        size_t job_length = 0;
+        while (body_index < body_count &&
+               (i == thread_count - 1 || job->body_count == 0 ||
+                job_length < length_per_job)) {
+            job_length +=
+                file->decl_extents_arr[bodies_arr[body_index]->index].length;
+            job->body_count++;
+            body_index++;
+        }
+        if (body_index >= body_count) {
+            thread_count = i + 1;
+            break;
+        }
+    }
+
+    DuskThread **threads =
+        DUSK_NEW_ARRAY(allocator, DuskThread *, thread_count);
+    // The jobs allocate new types from our arena while the threads are being
+    // created, so the threads are allocated from the heap
+    for (uint32_t i = 1; i < thread_count; ++i) {
+        threads[i] = duskThreadCreate(NULL, duskAnalysisJobRun, &jobs[i]);
+        if (!threads[i]) duskAnalysisJobRun(&jobs[i]);
+    }
+
+    duskAnalysisJobRun(&jobs[0]);
+
+    for (uint32_t i = 1; i < thread_count; ++i) {
+        if (threads[i]) duskThreadJoin(threads[i]);
+    }
+
+    for (uint32_t i = 0; i < thread_count; ++i) {
+        DuskArray(DuskError) job_errors_arr = jobs[i].compiler.errors_arr;
+        for (size_t j = 0; j < duskArrayLength(job_errors_arr); ++j) {
+            duskArrayPush(&compiler->errors_arr, job_errors_arr[j]);
+        }
+    }
+
+    return true;
+}
+
+// Stable sort of the errors reported since first_error by source location
+static void duskSortErrors(DuskCompiler *compiler, size_t first_error)
+{
+    DuskArray(DuskError) errors_arr = compiler->errors_arr;
+    for (size_t i = first_error + 1; i < duskArrayLength(errors_arr); ++i) {
+        DuskError error = errors_arr[i];
+        size_t j = i;
+        while (j > first_error &&
+               errors_arr[j - 1].location.offset > error.location.offset) {
+            errors_arr[j] = errors_arr[j - 1];
+            j--;
+        }
+        errors_arr[j] = error;
+    }
+}
+
+void duskAnalyzeFile(DuskCompiler *compiler, DuskFile *file)
+{
+    DuskAllocator *allocator = duskArenaGetAllocator(compiler->main_arena);
+
+    size_t decl_count = duskArrayLength(file->decls_arr);
+    size_t first_error = duskArrayLength(compiler->errors_arr);
+    size_t first_new_type = duskArrayLength(compiler->types_arr);
+
+    // The declarations may have changed since the file was last analyzed, so
+    // always register them from scratch
+    file->scope->map = NULL;
+
+    DuskMap *decl_indices = duskMapCreate(allocator, decl_count + 1);
+    DuskAnalyzerState *state =
+        duskAnalyzerStateCreate(allocator, file, decl_indices);
+
+    for (size_t i = 0; i < decl_count; ++i) {
+        DuskDeclId decl_id = file->decls_arr[i];
+        DuskDecl *decl = duskDeclGet(compiler, decl_id);
+        duskTryRegisterDecl(compiler, state, decl_id);
+        if (!duskMapGet(decl_indices, decl->name, NULL)) {
+            duskMapSet(decl_indices, decl->name, (void *)(uintptr_t)i);
+        }
+    }
+
+    // Declarations are analyzed in order, except for function bodies, which
+    // only depend on the signatures of other declarations and are analyzed
+    // afterwards
+    DuskDeclAnalysis *analyses =
+        DUSK_NEW_ARRAY(allocator, DuskDeclAnalysis, decl_count);
+    DuskArray(DuskDeclAnalysis *) bodies_arr =
+        duskArrayCreate(allocator, DuskDeclAnalysis *);
+
+    for (size_t i = 0; i < decl_count; ++i) {
+        DuskDeclId decl_id = file->decls_arr[i];
+        DuskDecl *decl = duskDeclGet(compiler, decl_id);
+        analyses[i].decl_id = decl_id;
+        analyses[i].index = i;
+        if (decl->referenced_names) {
+            // Kept from a previous compilation
+            continue;
+        }
+
+        decl->referenced_names = duskMapCreate(allocator, 16);
+        state->referenced_names = decl->referenced_names;
+        state->decl_index = i;
+        compiler->requested_types_arr = duskArrayCreate(allocator, DuskType *);
+
+        duskAnalyzeDecl(compiler, state, decl_id);
+
+        analyses[i].types_arr = compiler->requested_types_arr;
+        compiler->requested_types_arr = NULL;
+        state->referenced_names = NULL;
+
+        if (decl->kind == DUSK_DECL_FUNCTION &&
+            compiler->decl_types_arr[decl_id]) {
+            duskArrayPush(&bodies_arr, &analyses[i]);
+        }
+    }
+
+    if (!duskAnalyzeBodiesInParallel(
+            compiler, file, decl_indices, bodies_arr)) {
+        for (size_t i = 0; i < duskArrayLength(bodies_arr); ++i) {
+            duskAnalyzeBody(compiler, state, bodies_arr[i]);
+        }
+    }
+
+    for (size_t i = 0; i < duskArrayLength(bodies_arr); ++i) {
+        DuskMap *referenced_names =
+            duskDeclGet(compiler, bodies_arr[i]->decl_id)->referenced_names;
+        DuskMap *body_referenced_names = bodies_arr[i]->body_referenced_names;
+        for (size_t j = 0; j < body_referenced_names->size; ++j) {
+            DuskMapSlot *slot = &body_referenced_names->slots[j];
+            if (slot->hash == 0) continue;
+            duskMapSet(referenced_names, slot->key, NULL);
+        }
     }
 
-    for (size_t i = 0; i < duskArrayLength(file->decls_arr); ++i) {
-        DuskDecl *decl = file->decls_arr[i];
-        duskAnalyzeDecl(compiler, state, decl);
+    // Put the new types in the order in which the declarations and their
+    // bodies first asked for them
+    DuskArray(DuskType *) *requested_arrs = DUSK_NEW_ARRAY(
+        allocator, DuskArray(DuskType *), decl_count * 2);
+    for (size_t i = 0; i < decl_count; ++i) {
+        requested_arrs[i * 2] = analyses[i].types_arr;
+        requested_arrs[i * 2 + 1] = analyses[i].body_types_arr;
     }
+    duskTypeOrderNew(
+        compiler, first_new_type, decl_count * 2, requested_arrs);
+    duskSortErrors(compiler, first_error);
 
     duskArrayPop(&state->scope_stack_arr);
 }
@@ -7,7 +7,7 @@ typedef struct DuskAstToIRState {
 } DuskAstToIRState;
 
 static void duskGenerateLocalDecl(
-    DuskIRModule *module, DuskDecl *func_decl, DuskDecl *decl);
+    DuskIRModule *module, DuskDeclId func_decl_id, DuskDeclId decl_id);
 
 static DuskIRValue *duskGetLastBlock(DuskIRValue *function)
 {
@@ -15,7 +15,7 @@ static DuskIRValue *duskGetLastBlock(DuskIRValue *function)
         .blocks_arr[duskArrayLength(function->function.blocks_arr) - 1];
 }
 
-uint32_t duskTypeAlignOf(
+static uint32_t duskTypeComputeAlignOf(
     DuskAllocator *allocator, DuskType *type, DuskStructLayout layout)
 {
     uint32_t alignment = 0;
@@ -105,7 +105,7 @@ uint32_t duskTypeAlignOf(
     return alignment;
 }
 
-uint32_t duskTypeSizeOf(
+static uint32_t duskTypeComputeSizeOf(
     DuskAllocator *allocator, DuskType *type, DuskStructLayout layout)
 {
     uint32_t size = 0;
@@ -134,7 +134,8 @@ uint32_t duskTypeSizeOf(
             elem_size = DUSK_ROUND_UP(16, elem_size);
             uint32_t elem_alignment =
                 duskTypeAlignOf(allocator, type->array.sub, layout);
-            size = DUSK_ROUND_UP(elem_alignment, elem_size) * (uint32_t)type->array.size;
+            size = DUSK_ROUND_UP(elem_alignment, elem_size) *
+                   (uint32_t)type->array.size;
             break;
         }
 
@@ -144,7 +145,8 @@ uint32_t duskTypeSizeOf(
                 duskTypeSizeOf(allocator, type->array.sub, layout);
             uint32_t elem_alignment =
                 duskTypeAlignOf(allocator, type->array.sub, layout);
-            size = DUSK_ROUND_UP(elem_alignment, elem_size) * (uint32_t)type->array.size;
+            size = DUSK_ROUND_UP(elem_alignment, elem_size) *
+                   (uint32_t)type->array.size;
             break;
         }
         }
@@ -154,6 +156,9 @@ uint32_t duskTypeSizeOf(
     case DUSK_TYPE_STRUCT: {
         uint32_t struct_alignment = duskTypeAlignOf(allocator, type, layout);
 
+        // Field offsets don't depend on the layout passed in, so they only
+        // need to be recorded the first time
+        bool record_offsets = !type->struct_.field_decoration_arrays;
         if (!type->struct_.field_decoration_arrays) {
             type->struct_.field_decoration_arrays = DUSK_NEW_ARRAY(
                 allocator,
@@ -172,11 +177,13 @@ uint32_t duskTypeSizeOf(
                     duskArrayCreate(allocator, DuskIRDecoration);
             }
 
-            // Store the field offset
-            DuskIRDecoration decoration = duskIRCreateDecoration(
-                allocator, DUSK_IR_DECORATION_OFFSET, 1, &size);
-            duskArrayPush(
-                &type->struct_.field_decoration_arrays[i], decoration);
+            if (record_offsets) {
+                // Store the field offset
+                DuskIRDecoration decoration = duskIRCreateDecoration(
+                    allocator, DUSK_IR_DECORATION_OFFSET, 1, &size);
+                duskArrayPush(
+                    &type->struct_.field_decoration_arrays[i], decoration);
+            }
 
             uint32_t field_size =
                 duskTypeSizeOf(allocator, field_type, type->struct_.layout);
@@ -215,6 +222,29 @@ uint32_t duskTypeSizeOf(
     return size;
 }
 
+uint32_t duskTypeAlignOf(
+    DuskAllocator *allocator, DuskType *type, DuskStructLayout layout)
+{
+    uint8_t layout_bit = (uint8_t)(1u << layout);
+    if (!(type->computed_alignments & layout_bit)) {
+        type->alignments[layout] =
+            duskTypeComputeAlignOf(allocator, type, layout);
+        type->computed_alignments |= layout_bit;
+    }
+    return type->alignments[layout];
+}
+
+uint32_t duskTypeSizeOf(
+    DuskAllocator *allocator, DuskType *type, DuskStructLayout layout)
+{
+    uint8_t layout_bit = (uint8_t)(1u << layout);
+    if (!(type->computed_sizes & layout_bit)) {
+        type->sizes[layout] = duskTypeComputeSizeOf(allocator, type, layout);
+        type->computed_sizes |= layout_bit;
+    }
+    return type->sizes[layout];
+}
+
 static void duskReferenceGlobalOperands(void *user_data, DuskIRValue *operand)
 {
     DuskIREntryPoint *entry_point = (DuskIREntryPoint *)user_data;
@@ -255,6 +285,7 @@ static void duskWithOperands(
         case DUSK_IR_VALUE_BLOCK:
         case DUSK_IR_VALUE_VARIABLE:
         case DUSK_IR_VALUE_DISCARD:
+        case DUSK_IR_VALUE_UNREACHABLE:
         case DUSK_IR_VALUE_BRANCH:
         case DUSK_IR_VALUE_SELECTION_MERGE:
         case DUSK_IR_VALUE_LOOP_MERGE: break;
@@ -289,6 +320,11 @@ static void duskWithOperands(
             callback(user_data, value->composite_extract.composite);
             break;
         }
+        case DUSK_IR_VALUE_COMPOSITE_INSERT: {
+            callback(user_data, value->composite_insert.object);
+            callback(user_data, value->composite_insert.composite);
+            break;
+        }
         case DUSK_IR_VALUE_VECTOR_SHUFFLE: {
             callback(user_data, value->vector_shuffle.vec1);
             callback(user_data, value->vector_shuffle.vec2);
@@ -343,6 +379,21 @@ static void duskWithOperands(
     }
 }
 
+// The values of these attributes are integers known at compile time
+static uint32_t
+duskGetAttributeInteger(DuskIRModule *module, DuskAttribute *attribute)
+{
+    DUSK_ASSERT(attribute->value_expr_count == 1);
+
+    int64_t value = 0;
+    bool resolved = duskConstToInteger(
+        duskConstEvaluate(
+            module->compiler, module->allocator, attribute->value_exprs[0]),
+        &value);
+    DUSK_ASSERT(resolved);
+    return (uint32_t)value;
+}
+
 static void duskDecorateFromAttributes(
     DuskIRModule *module,
     DuskArray(DuskIRDecoration) * decorations_arr,
@@ -357,10 +408,7 @@ static void duskDecorateFromAttributes(
         DuskAttribute *attribute = &attributes[i];
         switch (attribute->kind) {
         case DUSK_ATTRIBUTE_LOCATION: {
-            DUSK_ASSERT(attribute->value_expr_count == 1);
-            DUSK_ASSERT(attribute->value_exprs[0]->resolved_int);
-            uint32_t location =
-                (uint32_t)*attribute->value_exprs[0]->resolved_int;
+            uint32_t location = duskGetAttributeInteger(module, attribute);
 
             DuskIRDecoration decoration = duskIRCreateDecoration(
                 module->allocator, DUSK_IR_DECORATION_LOCATION, 1, &location);
@@ -368,10 +416,7 @@ static void duskDecorateFromAttributes(
             break;
         }
         case DUSK_ATTRIBUTE_SET: {
-            DUSK_ASSERT(attribute->value_expr_count == 1);
-            DUSK_ASSERT(attribute->value_exprs[0]->resolved_int);
-            uint32_t descriptor_set =
-                (uint32_t)*attribute->value_exprs[0]->resolved_int;
+            uint32_t descriptor_set = duskGetAttributeInteger(module, attribute);
 
             DuskIRDecoration decoration = duskIRCreateDecoration(
                 module->allocator, DUSK_IR_DECORATION_SET, 1, &descriptor_set);
@@ -379,10 +424,7 @@ static void duskDecorateFromAttributes(
             break;
         }
         case DUSK_ATTRIBUTE_BINDING: {
-            DUSK_ASSERT(attribute->value_expr_count == 1);
-            DUSK_ASSERT(attribute->value_exprs[0]->resolved_int);
-            uint32_t binding =
-                (uint32_t)*attribute->value_exprs[0]->resolved_int;
+            uint32_t binding = duskGetAttributeInteger(module, attribute);
 
             DuskIRDecoration decoration = duskIRCreateDecoration(
                 module->allocator, DUSK_IR_DECORATION_BINDING, 1, &binding);
@@ -390,10 +432,7 @@ static void duskDecorateFromAttributes(
             break;
         }
         case DUSK_ATTRIBUTE_OFFSET: {
-            DUSK_ASSERT(attribute->value_expr_count == 1);
-            DUSK_ASSERT(attribute->value_exprs[0]->resolved_int);
-            uint32_t offset =
-                (uint32_t)*attribute->value_exprs[0]->resolved_int;
+            uint32_t offset = duskGetAttributeInteger(module, attribute);
 
             DuskIRDecoration decoration = duskIRCreateDecoration(
                 module->allocator, DUSK_IR_DECORATION_OFFSET, 1, &offset);
@@ -410,8 +449,10 @@ static void duskDecorateFromAttributes(
         }
         case DUSK_ATTRIBUTE_BUILTIN: {
             DUSK_ASSERT(attribute->value_expr_count == 1);
-            DUSK_ASSERT(attribute->value_exprs[0]->kind == DUSK_EXPR_IDENT);
-            const char *builtin_name = attribute->value_exprs[0]->string.str;
+            DuskExpr *value_expr =
+                duskExprGet(module->compiler, attribute->value_exprs[0]);
+            DUSK_ASSERT(value_expr->kind == DUSK_EXPR_IDENT);
+            const char *builtin_name = value_expr->string.str;
 
             uint32_t builtin = 0;
             if (strcmp(builtin_name, "position") == 0) {
@@ -454,47 +495,87 @@ static void duskDecorateFromAttributes(
     }
 }
 
-static void
-duskGenerateExpr(DuskIRModule *module, DuskDecl *func_decl, DuskExpr *expr)
+static DuskIRValue *
+duskGenerateConstValue(DuskIRModule *module, DuskConstValue *value)
 {
+    switch (value->type->kind) {
+    case DUSK_TYPE_BOOL: return duskIRConstBoolCreate(module, value->bool_value);
+    case DUSK_TYPE_INT:
+        return duskIRConstIntCreate(module, value->type, value->int_value);
+    case DUSK_TYPE_FLOAT:
+        return duskIRConstFloatCreate(module, value->type, value->float_value);
+    case DUSK_TYPE_VECTOR:
+    case DUSK_TYPE_MATRIX:
+    case DUSK_TYPE_ARRAY:
+    case DUSK_TYPE_STRUCT: {
+        size_t count = value->composite.count;
+        DuskIRValue **values =
+            DUSK_NEW_ARRAY(module->allocator, DuskIRValue *, count);
+        for (size_t i = 0; i < count; ++i) {
+            values[i] =
+                duskGenerateConstValue(module, value->composite.values[i]);
+        }
+        return duskIRConstCompositeCreate(module, value->type, count, values);
+    }
+    default: DUSK_ASSERT(0); return NULL;
+    }
+}
+
+static void duskGenerateExpr(
+    DuskIRModule *module, DuskDeclId func_decl_id, DuskExprId expr_id)
+{
+    DuskCompiler *compiler = module->compiler;
+    DuskExpr *expr = duskExprGet(compiler, expr_id);
+    DuskType *expr_type = compiler->expr_types_arr[expr_id];
+    DuskIRValue **expr_value = &module->expr_values[expr_id];
+
+    // Expressions known at compile time are emitted as a single constant,
+    // without any of the instructions that would compute them
+    DuskConstValue *const_value =
+        duskConstEvaluate(compiler, module->allocator, expr_id);
+    if (const_value && duskTypeIsRuntime(const_value->type)) {
+        *expr_value = duskGenerateConstValue(module, const_value);
+        return;
+    }
+
     switch (expr->kind) {
     case DUSK_EXPR_IDENT: {
         DUSK_ASSERT(expr->identifier.decl);
-        DUSK_ASSERT(expr->type);
-        expr->ir_value = expr->identifier.decl->ir_value;
+        DUSK_ASSERT(expr_type);
+        *expr_value = module->decl_infos[expr->identifier.decl].value;
         break;
     }
 
     case DUSK_EXPR_INT_LITERAL: {
         DUSK_ASSERT(
-            expr->type->kind != DUSK_TYPE_UNTYPED_INT &&
-            expr->type->kind != DUSK_TYPE_UNTYPED_FLOAT);
-        if (expr->type->kind == DUSK_TYPE_INT) {
-            expr->ir_value = duskIRConstIntCreate(
-                module, expr->type, (uint64_t)expr->int_literal);
-        } else if (expr->type->kind == DUSK_TYPE_FLOAT) {
-            expr->ir_value = duskIRConstFloatCreate(
-                module, expr->type, (double)expr->int_literal);
+            expr_type->kind != DUSK_TYPE_UNTYPED_INT &&
+            expr_type->kind != DUSK_TYPE_UNTYPED_FLOAT);
+        if (expr_type->kind == DUSK_TYPE_INT) {
+            *expr_value = duskIRConstIntCreate(
+                module, expr_type, (uint64_t)expr->int_literal);
+        } else if (expr_type->kind == DUSK_TYPE_FLOAT) {
+            *expr_value = duskIRConstFloatCreate(
+                module, expr_type, (double)expr->int_literal);
         }
         break;
     }
 
     case DUSK_EXPR_FLOAT_LITERAL: {
         DUSK_ASSERT(
-            expr->type->kind != DUSK_TYPE_UNTYPED_INT &&
-            expr->type->kind != DUSK_TYPE_UNTYPED_FLOAT);
-        expr->ir_value = duskIRConstFloatCreate(
-            module, expr->type, (double)expr->float_literal);
+            expr_type->kind != DUSK_TYPE_UNTYPED_INT &&
+            expr_type->kind != DUSK_TYPE_UNTYPED_FLOAT);
+        *expr_value = duskIRConstFloatCreate(
+            module, expr_type, (double)expr->float_literal);
         break;
     }
 
     case DUSK_EXPR_BOOL_LITERAL: {
-        expr->ir_value = duskIRConstBoolCreate(module, expr->bool_literal);
+        *expr_value = duskIRConstBoolCreate(module, expr->bool_literal);
         break;
     }
 
     case DUSK_EXPR_STRUCT_LITERAL: {
-        DuskType *struct_type = expr->type;
+        DuskType *struct_type = expr_type;
         size_t field_value_count =
             duskArrayLength(expr->struct_literal.field_values_arr);
         DuskIRValue **field_values = duskAllocateZeroed(
@@ -507,12 +588,10 @@ duskGenerateExpr(DuskIRModule *module, DuskDecl *func_decl, DuskExpr *expr)
                     struct_type->struct_.index_map,
                     field_name,
                     (void *)&index)) {
-                duskGenerateExpr(
-                    module,
-                    func_decl,
-                    expr->struct_literal.field_values_arr[i]);
-                field_values[index] =
-                    expr->struct_literal.field_values_arr[i]->ir_value;
+                DuskExprId value_expr =
+                    expr->struct_literal.field_values_arr[i];
+                duskGenerateExpr(module, func_decl_id, value_expr);
+                field_values[index] = module->expr_values[value_expr];
                 DUSK_ASSERT(field_values[index]);
             } else {
                 DUSK_ASSERT(0);
@@ -528,10 +607,10 @@ duskGenerateExpr(DuskIRModule *module, DuskDecl *func_decl, DuskExpr *expr)
         }
 
         if (all_fields_constant) {
-            expr->ir_value = duskIRConstCompositeCreate(
+            *expr_value = duskIRConstCompositeCreate(
                 module, struct_type, field_value_count, field_values);
         } else {
-            DuskIRValue *function = func_decl->ir_value;
+            DuskIRValue *function = module->decl_infos[func_decl_id].value;
             DUSK_ASSERT(duskArrayLength(function->function.blocks_arr) > 0);
 
             DuskIRValue *block = duskGetLastBlock(function);
@@ -541,7 +620,7 @@ duskGenerateExpr(DuskIRModule *module, DuskDecl *func_decl, DuskExpr *expr)
                     duskIRLoadLvalue(module, block, field_values[i]);
             }
 
-            expr->ir_value = duskIRCreateCompositeConstruct(
+            *expr_value = duskIRCreateCompositeConstruct(
                 module, block, struct_type, field_value_count, field_values);
         }
 
@@ -549,9 +628,9 @@ duskGenerateExpr(DuskIRModule *module, DuskDecl *func_decl, DuskExpr *expr)
     }
 
     case DUSK_EXPR_ARRAY_LITERAL: {
-        DuskType *array_type = expr->type;
+        DuskType *array_type = expr_type;
         if (array_type->kind == DUSK_TYPE_STRUCT) {
-            expr->ir_value =
+            *expr_value =
                 duskIRConstCompositeCreate(module, array_type, 0, NULL);
         } else {
             DUSK_ASSERT(array_type->kind == DUSK_TYPE_ARRAY);
@@ -564,8 +643,9 @@ duskGenerateExpr(DuskIRModule *module, DuskDecl *func_decl, DuskExpr *expr)
 
         for (size_t i = 0; i < field_value_count; ++i) {
             duskGenerateExpr(
-                module, func_decl, expr->array_literal.field_values_arr[i]);
-            field_values[i] = expr->array_literal.field_values_arr[i]->ir_value;
+                module, func_decl_id, expr->array_literal.field_values_arr[i]);
+            field_values[i] =
+                module->expr_values[expr->array_literal.field_values_arr[i]];
             DUSK_ASSERT(field_values[i]);
         }
 
@@ -578,10 +658,10 @@ duskGenerateExpr(DuskIRModule *module, DuskDecl *func_decl, DuskExpr *expr)
         }
 
         if (all_fields_constant) {
-            expr->ir_value = duskIRConstCompositeCreate(
+            *expr_value = duskIRConstCompositeCreate(
                 module, array_type, field_value_count, field_values);
         } else {
-            DuskIRValue *function = func_decl->ir_value;
+            DuskIRValue *function = module->decl_infos[func_decl_id].value;
             DUSK_ASSERT(duskArrayLength(function->function.blocks_arr) > 0);
 
             DuskIRValue *block = duskGetLastBlock(function);
@@ -591,7 +671,7 @@ duskGenerateExpr(DuskIRModule *module, DuskDecl *func_decl, DuskExpr *expr)
                     duskIRLoadLvalue(module, block, field_values[i]);
             }
 
-            expr->ir_value = duskIRCreateCompositeConstruct(
+            *expr_value = duskIRCreateCompositeConstruct(
                 module, block, array_type, field_value_count, field_values);
         }
 
@@ -599,10 +679,12 @@ duskGenerateExpr(DuskIRModule *module, DuskDecl *func_decl, DuskExpr *expr)
     }
 
     case DUSK_EXPR_FUNCTION_CALL: {
-        DuskType *func_type = expr->function_call.func_expr->type;
+        DuskType *func_type =
+            compiler->expr_types_arr[expr->function_call.func_expr];
         switch (func_type->kind) {
         case DUSK_TYPE_FUNCTION: {
-            duskGenerateExpr(module, func_decl, expr->function_call.func_expr);
+            duskGenerateExpr(
+                module, func_decl_id, expr->function_call.func_expr);
 
             size_t param_count =
                 duskArrayLength(expr->function_call.params_arr);
@@ -610,27 +692,34 @@ duskGenerateExpr(DuskIRModule *module, DuskDecl *func_decl, DuskExpr *expr)
                 DUSK_NEW_ARRAY(module->allocator, DuskIRValue *, param_count);
 
             for (size_t i = 0; i < param_count; ++i) {
-                DuskExpr *param_expr = expr->function_call.params_arr[i];
-                duskGenerateExpr(module, func_decl, param_expr);
-                DUSK_ASSERT(param_expr->ir_value);
-                param_values[i] = param_expr->ir_value;
+                DuskExprId param_expr = expr->function_call.params_arr[i];
+                duskGenerateExpr(module, func_decl_id, param_expr);
+                DUSK_ASSERT(module->expr_values[param_expr]);
+                param_values[i] = module->expr_values[param_expr];
             }
 
-            DuskIRValue *function = func_decl->ir_value;
+            DuskIRValue *function = module->decl_infos[func_decl_id].value;
             DUSK_ASSERT(duskArrayLength(function->function.blocks_arr) > 0);
             DuskIRValue *block = duskGetLastBlock(function);
 
-            expr->ir_value = duskIRCreateFunctionCall(
+            // Parameters are passed by value
+            for (size_t i = 0; i < param_count; ++i) {
+                param_values[i] =
+                    duskIRLoadLvalue(module, block, param_values[i]);
+            }
+
+            *expr_value = duskIRCreateFunctionCall(
                 module,
                 block,
-                expr->function_call.func_expr->ir_value,
+                module->expr_values[expr->function_call.func_expr],
                 param_count,
                 param_values);
             break;
         }
 
         case DUSK_TYPE_TYPE: {
-            DuskType *constructed_type = expr->function_call.func_expr->as_type;
+            DuskType *constructed_type =
+                compiler->expr_as_types_arr[expr->function_call.func_expr];
             size_t param_count =
                 duskArrayLength(expr->function_call.params_arr);
 
@@ -638,13 +727,14 @@ duskGenerateExpr(DuskIRModule *module, DuskDecl *func_decl, DuskExpr *expr)
             case DUSK_TYPE_INT:
             case DUSK_TYPE_FLOAT: {
                 DUSK_ASSERT(param_count == 1);
-                DuskExpr *param = expr->function_call.params_arr[0];
+                DuskExprId param = expr->function_call.params_arr[0];
 
-                duskGenerateExpr(module, func_decl, param);
-                DuskIRValue *value = param->ir_value;
+                duskGenerateExpr(module, func_decl_id, param);
+                DuskIRValue *value = module->expr_values[param];
                 if (duskIRIsLvalue(value)) {
-                    DUSK_ASSERT(func_decl);
-                    DuskIRValue *function = func_decl->ir_value;
+                    DUSK_ASSERT(func_decl_id);
+                    DuskIRValue *function =
+                        module->decl_infos[func_decl_id].value;
                     DUSK_ASSERT(
                         duskArrayLength(function->function.blocks_arr) > 0);
                     DuskIRValue *block = duskGetLastBlock(function);
@@ -652,17 +742,18 @@ duskGenerateExpr(DuskIRModule *module, DuskDecl *func_decl, DuskExpr *expr)
                     value = duskIRLoadLvalue(module, block, value);
                 }
 
-                if (constructed_type != param->type) {
-                    DUSK_ASSERT(func_decl);
-                    DuskIRValue *function = func_decl->ir_value;
+                if (constructed_type != compiler->expr_types_arr[param]) {
+                    DUSK_ASSERT(func_decl_id);
+                    DuskIRValue *function =
+                        module->decl_infos[func_decl_id].value;
                     DUSK_ASSERT(
                         duskArrayLength(function->function.blocks_arr) > 0);
                     DuskIRValue *block = duskGetLastBlock(function);
 
-                    expr->ir_value = duskIRCreateCast(
+                    *expr_value = duskIRCreateCast(
                         module, block, constructed_type, value);
                 } else {
-                    expr->ir_value = value;
+                    *expr_value = value;
                 }
 
                 break;
@@ -672,20 +763,21 @@ duskGenerateExpr(DuskIRModule *module, DuskDecl *func_decl, DuskExpr *expr)
                 DuskIRValue **values = duskAllocateZeroed(
                     module->allocator, sizeof(DuskIRValue *) * value_count);
 
-                if (func_decl) {
-                    DuskIRValue *function = func_decl->ir_value;
+                if (func_decl_id) {
+                    DuskIRValue *function =
+                        module->decl_infos[func_decl_id].value;
                     DUSK_ASSERT(
                         duskArrayLength(function->function.blocks_arr) > 0);
                     DuskIRValue *block = duskGetLastBlock(function);
 
                     bool all_constants = true;
                     if (param_count == 1 && value_count != param_count) {
-                        DuskExpr *param = expr->function_call.params_arr[0];
-                        duskGenerateExpr(module, func_decl, param);
-                        DuskIRValue *param_value = param->ir_value;
+                        DuskExprId param = expr->function_call.params_arr[0];
+                        duskGenerateExpr(module, func_decl_id, param);
+                        DuskIRValue *param_value = module->expr_values[param];
                         if (!duskIRValueIsConstant(param_value)) {
                             param_value = duskIRLoadLvalue(
-                                module, block, param->ir_value);
+                                module, block, module->expr_values[param]);
                             all_constants = false;
                         }
 
@@ -698,22 +790,27 @@ duskGenerateExpr(DuskIRModule *module, DuskDecl *func_decl, DuskExpr *expr)
 
                         size_t elem_index = 0;
                         for (size_t i = 0; i < param_count; ++i) {
-                            DuskExpr *param = expr->function_call.params_arr[i];
-                            duskGenerateExpr(module, func_decl, param);
+                            DuskExprId param =
+                                expr->function_call.params_arr[i];
+                            duskGenerateExpr(module, func_decl_id, param);
+                            DuskType *param_type =
+                                compiler->expr_types_arr[param];
 
-                            if (param->type->kind == DUSK_TYPE_VECTOR) {
+                            if (param_type->kind == DUSK_TYPE_VECTOR) {
                                 all_constants = false;
                                 DuskIRValue *loaded_composite =
                                     duskIRLoadLvalue(
-                                        module, block, param->ir_value);
+                                        module,
+                                        block,
+                                        module->expr_values[param]);
                                 for (uint32_t j = 0;
-                                     j < param->type->vector.size;
+                                     j < param_type->vector.size;
                                      ++j) {
                                     values[elem_index] =
                                         duskIRCreateCompositeExtract(
                                             module,
                                             block,
-                                            param->type->vector.sub,
+                                            param_type->vector.sub,
                                             loaded_composite,
                                             1,
                                             &j);
@@ -721,7 +818,7 @@ duskGenerateExpr(DuskIRModule *module, DuskDecl *func_decl, DuskExpr *expr)
                                     elem_index++;
                                 }
                             } else {
-                                values[elem_index] = param->ir_value;
+                                values[elem_index] = module->expr_values[param];
                                 if (!duskIRValueIsConstant(
                                         values[elem_index])) {
                                     values[elem_index] = duskIRLoadLvalue(
@@ -735,10 +832,10 @@ duskGenerateExpr(DuskIRModule *module, DuskDecl *func_decl, DuskExpr *expr)
                     }
 
                     if (all_constants) {
-                        expr->ir_value = duskIRConstCompositeCreate(
+                        *expr_value = duskIRConstCompositeCreate(
                             module, constructed_type, value_count, values);
                     } else {
-                        expr->ir_value = duskIRCreateCompositeConstruct(
+                        *expr_value = duskIRCreateCompositeConstruct(
                             module,
                             block,
                             constructed_type,
@@ -750,15 +847,16 @@ duskGenerateExpr(DuskIRModule *module, DuskDecl *func_decl, DuskExpr *expr)
 
                     if (param_count == value_count) {
                         for (size_t i = 0; i < value_count; ++i) {
-                            DuskExpr *param = expr->function_call.params_arr[i];
-                            duskGenerateExpr(module, func_decl, param);
-                            values[i] = param->ir_value;
+                            DuskExprId param =
+                                expr->function_call.params_arr[i];
+                            duskGenerateExpr(module, func_decl_id, param);
+                            values[i] = module->expr_values[param];
                             DUSK_ASSERT(duskIRValueIsConstant(values[i]));
                         }
                     } else if (param_count == 1) {
-                        DuskExpr *param = expr->function_call.params_arr[0];
-                        duskGenerateExpr(module, func_decl, param);
-                        DuskIRValue *param_value = param->ir_value;
+                        DuskExprId param = expr->function_call.params_arr[0];
+                        duskGenerateExpr(module, func_decl_id, param);
+                        DuskIRValue *param_value = module->expr_values[param];
                         DUSK_ASSERT(duskIRValueIsConstant(param_value));
 
                         for (size_t i = 0; i < value_count; ++i) {
@@ -768,7 +866,7 @@ duskGenerateExpr(DuskIRModule *module, DuskDecl *func_decl, DuskExpr *expr)
                         DUSK_ASSERT(0);
                     }
 
-                    expr->ir_value = duskIRConstCompositeCreate(
+                    *expr_value = duskIRConstCompositeCreate(
                         module, constructed_type, value_count, values);
                 }
                 break;
@@ -778,20 +876,21 @@ duskGenerateExpr(DuskIRModule *module, DuskDecl *func_decl, DuskExpr *expr)
                 DuskIRValue **values = duskAllocateZeroed(
                     module->allocator, sizeof(DuskIRValue *) * value_count);
 
-                if (func_decl) {
-                    DuskIRValue *function = func_decl->ir_value;
+                if (func_decl_id) {
+                    DuskIRValue *function =
+                        module->decl_infos[func_decl_id].value;
                     DUSK_ASSERT(
                         duskArrayLength(function->function.blocks_arr) > 0);
                     DuskIRValue *block = duskGetLastBlock(function);
 
                     bool all_constants = true;
                     if (param_count == 1 && value_count != param_count) {
-                        DuskExpr *param = expr->function_call.params_arr[0];
-                        duskGenerateExpr(module, func_decl, param);
-                        DuskIRValue *param_value = param->ir_value;
+                        DuskExprId param = expr->function_call.params_arr[0];
+                        duskGenerateExpr(module, func_decl_id, param);
+                        DuskIRValue *param_value = module->expr_values[param];
                         if (!duskIRValueIsConstant(param_value)) {
                             param_value = duskIRLoadLvalue(
-                                module, block, param->ir_value);
+                                module, block, module->expr_values[param]);
                             all_constants = false;
                         }
 
@@ -800,9 +899,10 @@ duskGenerateExpr(DuskIRModule *module, DuskDecl *func_decl, DuskExpr *expr)
                         }
                     } else if (param_count == value_count) {
                         for (size_t i = 0; i < param_count; ++i) {
-                            DuskExpr *param = expr->function_call.params_arr[i];
-                            duskGenerateExpr(module, func_decl, param);
-                            values[i] = param->ir_value;
+                            DuskExprId param =
+                                expr->function_call.params_arr[i];
+                            duskGenerateExpr(module, func_decl_id, param);
+                            values[i] = module->expr_values[param];
                             if (!duskIRValueIsConstant(values[i])) {
                                 values[i] =
                                     duskIRLoadLvalue(module, block, values[i]);
@@ -814,10 +914,10 @@ duskGenerateExpr(DuskIRModule *module, DuskDecl *func_decl, DuskExpr *expr)
                     }
 
                     if (all_constants) {
-                        expr->ir_value = duskIRConstCompositeCreate(
+                        *expr_value = duskIRConstCompositeCreate(
                             module, constructed_type, value_count, values);
                     } else {
-                        expr->ir_value = duskIRCreateCompositeConstruct(
+                        *expr_value = duskIRCreateCompositeConstruct(
                             module,
                             block,
                             constructed_type,
@@ -829,15 +929,16 @@ duskGenerateExpr(DuskIRModule *module, DuskDecl *func_decl, DuskExpr *expr)
 
                     if (param_count == value_count) {
                         for (size_t i = 0; i < value_count; ++i) {
-                            DuskExpr *param = expr->function_call.params_arr[i];
-                            duskGenerateExpr(module, func_decl, param);
-                            values[i] = param->ir_value;
+                            DuskExprId param =
+                                expr->function_call.params_arr[i];
+                            duskGenerateExpr(module, func_decl_id, param);
+                            values[i] = module->expr_values[param];
                             DUSK_ASSERT(duskIRValueIsConstant(values[i]));
                         }
                     } else if (param_count == 1) {
-                        DuskExpr *param = expr->function_call.params_arr[0];
-                        duskGenerateExpr(module, func_decl, param);
-                        DuskIRValue *param_value = param->ir_value;
+                        DuskExprId param = expr->function_call.params_arr[0];
+                        duskGenerateExpr(module, func_decl_id, param);
+                        DuskIRValue *param_value = module->expr_values[param];
                         DUSK_ASSERT(duskIRValueIsConstant(param_value));
 
                         for (size_t i = 0; i < value_count; ++i) {
@@ -847,7 +948,7 @@ duskGenerateExpr(DuskIRModule *module, DuskDecl *func_decl, DuskExpr *expr)
                         DUSK_ASSERT(0);
                     }
 
-                    expr->ir_value = duskIRConstCompositeCreate(
+                    *expr_value = duskIRConstCompositeCreate(
                         module, constructed_type, value_count, values);
                 }
                 break;
@@ -865,15 +966,6 @@ duskGenerateExpr(DuskIRModule *module, DuskDecl *func_decl, DuskExpr *expr)
     }
 
     case DUSK_EXPR_BUILTIN_FUNCTION_CALL: {
-        switch (expr->builtin_call.kind) {
-        case DUSK_BUILTIN_FUNCTION_IMAGE_QUERY_LEVELS:
-        case DUSK_BUILTIN_FUNCTION_IMAGE_QUERY_LOD:
-        case DUSK_BUILTIN_FUNCTION_IMAGE_QUERY_SIZE: {
-            duskArrayPush(&module->capabilities_arr, SpvCapabilityImageQuery);
-        }
-        default: break;
-        }
-
         switch (expr->builtin_call.kind) {
         case DUSK_BUILTIN_FUNCTION_RADIANS:
         case DUSK_BUILTIN_FUNCTION_DEGREES:
@@ -923,8 +1015,8 @@ duskGenerateExpr(DuskIRModule *module, DuskDecl *func_decl, DuskExpr *expr)
         case DUSK_BUILTIN_FUNCTION_IMAGE_LOAD:
         case DUSK_BUILTIN_FUNCTION_IMAGE_STORE:
         case DUSK_BUILTIN_FUNCTION_IMAGE_QUERY_LOD: {
-            DUSK_ASSERT(func_decl);
-            DuskIRValue *function = func_decl->ir_value;
+            DUSK_ASSERT(func_decl_id);
+            DuskIRValue *function = module->decl_infos[func_decl_id].value;
             DUSK_ASSERT(duskArrayLength(function->function.blocks_arr) > 0);
             DuskIRValue *block = duskGetLastBlock(function);
 
@@ -934,24 +1026,25 @@ duskGenerateExpr(DuskIRModule *module, DuskDecl *func_decl, DuskExpr *expr)
 
             for (size_t i = 0; i < param_count; ++i) {
                 duskGenerateExpr(
-                    module, func_decl, expr->builtin_call.params_arr[i]);
-                params[i] = expr->builtin_call.params_arr[i]->ir_value;
+                    module, func_decl_id, expr->builtin_call.params_arr[i]);
+                params[i] =
+                    module->expr_values[expr->builtin_call.params_arr[i]];
                 params[i] = duskIRLoadLvalue(module, block, params[i]);
             }
 
-            expr->ir_value = duskIRCreateBuiltinCall(
+            *expr_value = duskIRCreateBuiltinCall(
                 module,
                 block,
                 expr->builtin_call.kind,
-                expr->type,
+                expr_type,
                 param_count,
                 params);
             break;
         }
         case DUSK_BUILTIN_FUNCTION_IMAGE_QUERY_LEVELS:
         case DUSK_BUILTIN_FUNCTION_IMAGE_QUERY_SIZE: {
-            DUSK_ASSERT(func_decl);
-            DuskIRValue *function = func_decl->ir_value;
+            DUSK_ASSERT(func_decl_id);
+            DuskIRValue *function = module->decl_infos[func_decl_id].value;
             DUSK_ASSERT(duskArrayLength(function->function.blocks_arr) > 0);
             DuskIRValue *block = duskGetLastBlock(function);
 
@@ -961,8 +1054,9 @@ duskGenerateExpr(DuskIRModule *module, DuskDecl *func_decl, DuskExpr *expr)
 
             for (size_t i = 0; i < param_count; ++i) {
                 duskGenerateExpr(
-                    module, func_decl, expr->builtin_call.params_arr[i]);
-                params[i] = expr->builtin_call.params_arr[i]->ir_value;
+                    module, func_decl_id, expr->builtin_call.params_arr[i]);
+                params[i] =
+                    module->expr_values[expr->builtin_call.params_arr[i]];
                 params[i] = duskIRLoadLvalue(module, block, params[i]);
             }
 
@@ -976,11 +1070,11 @@ duskGenerateExpr(DuskIRModule *module, DuskDecl *func_decl, DuskExpr *expr)
                     &params[0]);
             }
 
-            expr->ir_value = duskIRCreateBuiltinCall(
+            *expr_value = duskIRCreateBuiltinCall(
                 module,
                 block,
                 expr->builtin_call.kind,
-                expr->type,
+                expr_type,
                 param_count,
                 params);
             break;
@@ -1007,20 +1101,25 @@ duskGenerateExpr(DuskIRModule *module, DuskDecl *func_decl, DuskExpr *expr)
     }
 
     case DUSK_EXPR_ACCESS: {
-        DuskIRValue *function = func_decl->ir_value;
+        DuskIRValue *function = module->decl_infos[func_decl_id].value;
         DUSK_ASSERT(duskArrayLength(function->function.blocks_arr) > 0);
         DuskIRValue *block = duskGetLastBlock(function);
 
-        DuskExpr *left_expr = expr->access.base_expr;
-        duskGenerateExpr(module, func_decl, left_expr);
+        DuskExprId left_expr_id = expr->access.base_expr;
+        duskGenerateExpr(module, func_decl_id, left_expr_id);
 
         for (size_t i = 0; i < duskArrayLength(expr->access.chain_arr); ++i) {
-            DUSK_ASSERT(left_expr->ir_value);
-
-            DuskExpr *right_expr = expr->access.chain_arr[i];
+            DuskType *left_type = compiler->expr_types_arr[left_expr_id];
+            DuskIRValue *left_value = module->expr_values[left_expr_id];
+            DUSK_ASSERT(left_value);
+
+            DuskExprId right_expr_id = expr->access.chain_arr[i];
+            DuskExpr *right_expr = duskExprGet(compiler, right_expr_id);
+            DuskType *right_type = compiler->expr_types_arr[right_expr_id];
+            DuskIRValue **right_value = &module->expr_values[right_expr_id];
             const char *accessed_field_name = right_expr->identifier.str;
 
-            switch (left_expr->type->kind) {
+            switch (left_type->kind) {
             case DUSK_TYPE_VECTOR: {
                 DUSK_ASSERT(right_expr->kind == DUSK_EXPR_IDENT);
                 DUSK_ASSERT(right_expr->identifier.shuffle_indices_arr);
@@ -1031,8 +1130,8 @@ duskGenerateExpr(DuskIRModule *module, DuskDecl *func_decl, DuskExpr *expr)
 
                 if (index_count > 1) {
                     DuskIRValue *vec_value =
-                        duskIRLoadLvalue(module, block, left_expr->ir_value);
-                    right_expr->ir_value = duskIRCreateVectorShuffle(
+                        duskIRLoadLvalue(module, block, left_value);
+                    *right_value = duskIRCreateVectorShuffle(
                         module,
                         block,
                         vec_value,
@@ -1042,27 +1141,27 @@ duskGenerateExpr(DuskIRModule *module, DuskDecl *func_decl, DuskExpr *expr)
                 } else {
                     DUSK_ASSERT(index_count == 1);
 
-                    if (duskIRIsLvalue(left_expr->ir_value)) {
+                    if (duskIRIsLvalue(left_value)) {
                         DuskIRValue *index_value = duskIRConstIntCreate(
                             module,
                             duskTypeNewScalar(
                                 module->compiler, DUSK_SCALAR_TYPE_UINT),
                             indices_arr[0]);
 
-                        right_expr->ir_value = duskIRCreateAccessChain(
+                        *right_value = duskIRCreateAccessChain(
                             module,
                             block,
-                            right_expr->type,
-                            left_expr->ir_value,
+                            right_type,
+                            left_value,
                             1,
                             &index_value);
                     } else {
-                        DuskIRValue *vec_value = duskIRLoadLvalue(
-                            module, block, left_expr->ir_value);
-                        right_expr->ir_value = duskIRCreateCompositeExtract(
+                        DuskIRValue *vec_value =
+                            duskIRLoadLvalue(module, block, left_value);
+                        *right_value = duskIRCreateCompositeExtract(
                             module,
                             block,
-                            left_expr->type->vector.sub,
+                            left_type->vector.sub,
                             vec_value,
                             index_count,
                             indices_arr);
@@ -1074,34 +1173,34 @@ duskGenerateExpr(DuskIRModule *module, DuskDecl *func_decl, DuskExpr *expr)
             case DUSK_TYPE_STRUCT: {
                 uintptr_t field_index = 0;
                 if (!duskMapGet(
-                        left_expr->type->struct_.index_map,
+                        left_type->struct_.index_map,
                         right_expr->identifier.str,
                         (void *)&field_index)) {
                     DUSK_ASSERT(0);
                 }
 
-                if (duskIRIsLvalue(left_expr->ir_value)) {
+                if (duskIRIsLvalue(left_value)) {
                     DuskIRValue *index_value = duskIRConstIntCreate(
                         module,
                         duskTypeNewScalar(
                             module->compiler, DUSK_SCALAR_TYPE_UINT),
                         field_index);
 
-                    right_expr->ir_value = duskIRCreateAccessChain(
+                    *right_value = duskIRCreateAccessChain(
                         module,
                         block,
-                        right_expr->type,
-                        left_expr->ir_value,
+                        right_type,
+                        left_value,
                         1,
                         &index_value);
                 } else {
                     uint32_t index = (uint32_t)field_index;
                     DuskIRValue *struct_value =
-                        duskIRLoadLvalue(module, block, left_expr->ir_value);
-                    right_expr->ir_value = duskIRCreateCompositeExtract(
+                        duskIRLoadLvalue(module, block, left_value);
+                    *right_value = duskIRCreateCompositeExtract(
                         module,
                         block,
-                        left_expr->type->struct_.field_types[field_index],
+                        left_type->struct_.field_types[field_index],
                         struct_value,
                         1,
                         &index);
@@ -1111,7 +1210,7 @@ duskGenerateExpr(DuskIRModule *module, DuskDecl *func_decl, DuskExpr *expr)
             }
             case DUSK_TYPE_RUNTIME_ARRAY: {
                 if (strcmp(accessed_field_name, "len") == 0) {
-                    DuskExpr *struct_expr = NULL;
+                    DuskExprId struct_expr = 0;
                     if (i >= 2) {
                         struct_expr = expr->access.chain_arr[i - 2];
                     } else if (i >= 1) {
@@ -1120,7 +1219,7 @@ duskGenerateExpr(DuskIRModule *module, DuskDecl *func_decl, DuskExpr *expr)
                         DUSK_ASSERT(0);
                     }
 
-                    DuskIRValue *struct_ptr = struct_expr->ir_value;
+                    DuskIRValue *struct_ptr = module->expr_values[struct_expr];
                     DUSK_ASSERT(struct_ptr->type->kind == DUSK_TYPE_POINTER);
                     DUSK_ASSERT(
                         struct_ptr->type->pointer.sub->kind ==
@@ -1131,13 +1230,16 @@ duskGenerateExpr(DuskIRModule *module, DuskDecl *func_decl, DuskExpr *expr)
                     uintptr_t struct_member_index = 0;
                     if (!duskMapGet(
                             struct_ty->struct_.index_map,
-                            left_expr->identifier.str,
+                            duskExprGet(compiler, left_expr_id)->identifier.str,
                             (void *)&struct_member_index)) {
                         DUSK_ASSERT(0);
                     }
 
-                    right_expr->ir_value = duskIRCreateArrayLength(
-                        module, block, struct_ptr, (uint32_t)struct_member_index);
+                    *right_value = duskIRCreateArrayLength(
+                        module,
+                        block,
+                        struct_ptr,
+                        (uint32_t)struct_member_index);
                 } else {
                     DUSK_ASSERT(0);
                 }
@@ -1149,18 +1251,18 @@ duskGenerateExpr(DuskIRModule *module, DuskDecl *func_decl, DuskExpr *expr)
             }
             }
 
-            DUSK_ASSERT(right_expr->ir_value);
+            DUSK_ASSERT(*right_value);
 
-            left_expr = right_expr;
+            left_expr_id = right_expr_id;
         }
 
-        expr->ir_value = left_expr->ir_value;
+        *expr_value = module->expr_values[left_expr_id];
 
         break;
     }
 
     case DUSK_EXPR_STRUCT_TYPE: {
-        DuskType *type = expr->as_type;
+        DuskType *type = compiler->expr_as_types_arr[expr_id];
 
         DUSK_ASSERT(type);
         DUSK_ASSERT(type->kind == DUSK_TYPE_STRUCT);
@@ -1188,24 +1290,24 @@ duskGenerateExpr(DuskIRModule *module, DuskDecl *func_decl, DuskExpr *expr)
     }
 
     case DUSK_EXPR_ARRAY_ACCESS: {
-        DuskIRValue *function = func_decl->ir_value;
+        DuskIRValue *function = module->decl_infos[func_decl_id].value;
         DUSK_ASSERT(duskArrayLength(function->function.blocks_arr) > 0);
         DuskIRValue *block = duskGetLastBlock(function);
 
-        duskGenerateExpr(module, func_decl, expr->access.base_expr);
-        DuskIRValue *base_value = expr->access.base_expr->ir_value;
+        duskGenerateExpr(module, func_decl_id, expr->access.base_expr);
+        DuskIRValue *base_value = module->expr_values[expr->access.base_expr];
         DUSK_ASSERT(base_value);
 
         DuskArray(DuskIRValue *) index_values_arr =
             duskArrayCreate(module->allocator, DuskIRValue *);
 
         for (size_t i = 0; i < duskArrayLength(expr->access.chain_arr); ++i) {
-            DuskExpr *index_expr = expr->access.chain_arr[i];
-            duskGenerateExpr(module, func_decl, index_expr);
-            DUSK_ASSERT(index_expr->ir_value);
+            DuskExprId index_expr = expr->access.chain_arr[i];
+            duskGenerateExpr(module, func_decl_id, index_expr);
+            DUSK_ASSERT(module->expr_values[index_expr]);
 
-            DuskIRValue *index_value =
-                duskIRLoadLvalue(module, block, index_expr->ir_value);
+            DuskIRValue *index_value = duskIRLoadLvalue(
+                module, block, module->expr_values[index_expr]);
             duskArrayPush(&index_values_arr, index_value);
         }
 
@@ -1219,10 +1321,10 @@ duskGenerateExpr(DuskIRModule *module, DuskDecl *func_decl, DuskExpr *expr)
             base_value = tmp_var;
         }
 
-        expr->ir_value = duskIRCreateAccessChain(
+        *expr_value = duskIRCreateAccessChain(
             module,
             block,
-            expr->type,
+            expr_type,
             base_value,
             duskArrayLength(index_values_arr),
             index_values_arr);
@@ -1231,8 +1333,8 @@ duskGenerateExpr(DuskIRModule *module, DuskDecl *func_decl, DuskExpr *expr)
     }
 
     case DUSK_EXPR_BINARY: {
-        DUSK_ASSERT(func_decl);
-        DuskIRValue *function = func_decl->ir_value;
+        DUSK_ASSERT(func_decl_id);
+        DuskIRValue *function = module->decl_infos[func_decl_id].value;
         DUSK_ASSERT(duskArrayLength(function->function.blocks_arr) > 0);
         DuskIRValue *block = duskGetLastBlock(function);
 
@@ -1244,19 +1346,19 @@ duskGenerateExpr(DuskIRModule *module, DuskDecl *func_decl, DuskExpr *expr)
         case DUSK_BINARY_OP_GREATEREQ:
         case DUSK_BINARY_OP_LESS:
         case DUSK_BINARY_OP_LESSEQ: {
-            duskGenerateExpr(module, func_decl, expr->binary.left);
-            duskGenerateExpr(module, func_decl, expr->binary.right);
+            duskGenerateExpr(module, func_decl_id, expr->binary.left);
+            duskGenerateExpr(module, func_decl_id, expr->binary.right);
 
-            DuskIRValue *left_val =
-                duskIRLoadLvalue(module, block, expr->binary.left->ir_value);
-            DuskIRValue *right_val =
-                duskIRLoadLvalue(module, block, expr->binary.right->ir_value);
+            DuskIRValue *left_val = duskIRLoadLvalue(
+                module, block, module->expr_values[expr->binary.left]);
+            DuskIRValue *right_val = duskIRLoadLvalue(
+                module, block, module->expr_values[expr->binary.right]);
 
-            expr->ir_value = duskIRCreateBinaryOperation(
+            *expr_value = duskIRCreateBinaryOperation(
                 module,
                 block,
                 expr->binary.op,
-                expr->type,
+                expr_type,
                 left_val,
                 right_val);
             break;
@@ -1272,18 +1374,18 @@ duskGenerateExpr(DuskIRModule *module, DuskDecl *func_decl, DuskExpr *expr)
         case DUSK_BINARY_OP_BITXOR:
         case DUSK_BINARY_OP_LSHIFT:
         case DUSK_BINARY_OP_RSHIFT: {
-            duskGenerateExpr(module, func_decl, expr->binary.left);
-            duskGenerateExpr(module, func_decl, expr->binary.right);
+            duskGenerateExpr(module, func_decl_id, expr->binary.left);
+            duskGenerateExpr(module, func_decl_id, expr->binary.right);
 
-            DuskIRValue *left_val =
-                duskIRLoadLvalue(module, block, expr->binary.left->ir_value);
-            DuskIRValue *right_val =
-                duskIRLoadLvalue(module, block, expr->binary.right->ir_value);
+            DuskIRValue *left_val = duskIRLoadLvalue(
+                module, block, module->expr_values[expr->binary.left]);
+            DuskIRValue *right_val = duskIRLoadLvalue(
+                module, block, module->expr_values[expr->binary.right]);
 
             DuskType *left_scalar_type =
-                duskGetScalarType(expr->binary.left->type);
+                duskGetScalarType(compiler->expr_types_arr[expr->binary.left]);
             DuskType *right_scalar_type =
-                duskGetScalarType(expr->binary.right->type);
+                duskGetScalarType(compiler->expr_types_arr[expr->binary.right]);
 
             DUSK_ASSERT(left_scalar_type);
             DUSK_ASSERT(right_scalar_type);
@@ -1291,11 +1393,11 @@ duskGenerateExpr(DuskIRModule *module, DuskDecl *func_decl, DuskExpr *expr)
             DUSK_ASSERT(duskTypeIsRuntime(left_scalar_type));
             DUSK_ASSERT(duskTypeIsRuntime(right_scalar_type));
 
-            expr->ir_value = duskIRCreateBinaryOperation(
+            *expr_value = duskIRCreateBinaryOperation(
                 module,
                 block,
                 expr->binary.op,
-                expr->type,
+                expr_type,
                 left_val,
                 right_val);
             break;
@@ -1306,11 +1408,12 @@ duskGenerateExpr(DuskIRModule *module, DuskDecl *func_decl, DuskExpr *expr)
             DuskIRValue *merge_block = duskIRBlockCreate(module);
 
             // First condition
-            duskGenerateExpr(module, func_decl, expr->binary.left);
+            duskGenerateExpr(module, func_decl_id, expr->binary.left);
             DuskIRValue *first_cond = duskIRLoadLvalue(
                 module,
                 duskGetLastBlock(function),
-                expr->binary.left->ir_value);
+                module->expr_values[expr->binary.left]);
+            DuskIRValue *first_cond_block = duskGetLastBlock(function);
             duskIRCreateSelectionMerge(
                 module, duskGetLastBlock(function), merge_block);
             duskIRCreateBranchCond(
@@ -1322,21 +1425,23 @@ duskGenerateExpr(DuskIRModule *module, DuskDecl *func_decl, DuskExpr *expr)
 
             // First condition is true
             duskIRFunctionAddBlock(function, first_cond_true_block);
-            duskGenerateExpr(module, func_decl, expr->binary.right);
+            duskGenerateExpr(module, func_decl_id, expr->binary.right);
             DuskIRValue *second_cond = duskIRLoadLvalue(
                 module,
                 duskGetLastBlock(function),
-                expr->binary.right->ir_value);
+                module->expr_values[expr->binary.right]);
+            DuskIRValue *second_cond_block = duskGetLastBlock(function);
             duskIRCreateBranch(module, duskGetLastBlock(function), merge_block);
 
             // Merge block
             duskIRFunctionAddBlock(function, merge_block);
+            // The conditions can end in other blocks than they started in
             DuskIRPhiPair pairs[2] = {
-                {block, first_cond},
-                {first_cond_true_block, second_cond},
+                {first_cond_block, first_cond},
+                {second_cond_block, second_cond},
             };
-            expr->ir_value =
-                duskIRCreatePhi(module, merge_block, expr->type, 2, pairs);
+            *expr_value =
+                duskIRCreatePhi(module, merge_block, expr_type, 2, pairs);
             break;
         }
 
@@ -1345,11 +1450,12 @@ duskGenerateExpr(DuskIRModule *module, DuskDecl *func_decl, DuskExpr *expr)
             DuskIRValue *merge_block = duskIRBlockCreate(module);
 
             // First condition
-            duskGenerateExpr(module, func_decl, expr->binary.left);
+            duskGenerateExpr(module, func_decl_id, expr->binary.left);
             DuskIRValue *first_cond = duskIRLoadLvalue(
                 module,
                 duskGetLastBlock(function),
-                expr->binary.left->ir_value);
+                module->expr_values[expr->binary.left]);
+            DuskIRValue *first_cond_block = duskGetLastBlock(function);
             duskIRCreateSelectionMerge(
                 module, duskGetLastBlock(function), merge_block);
             duskIRCreateBranchCond(
@@ -1361,21 +1467,23 @@ duskGenerateExpr(DuskIRModule *module, DuskDecl *func_decl, DuskExpr *expr)
 
             // First condition false
             duskIRFunctionAddBlock(function, first_cond_false_block);
-            duskGenerateExpr(module, func_decl, expr->binary.right);
+            duskGenerateExpr(module, func_decl_id, expr->binary.right);
             DuskIRValue *second_cond = duskIRLoadLvalue(
                 module,
                 duskGetLastBlock(function),
-                expr->binary.right->ir_value);
+                module->expr_values[expr->binary.right]);
+            DuskIRValue *second_cond_block = duskGetLastBlock(function);
             duskIRCreateBranch(module, duskGetLastBlock(function), merge_block);
 
             // Merge block
             duskIRFunctionAddBlock(function, merge_block);
+            // The conditions can end in other blocks than they started in
             DuskIRPhiPair pairs[2] = {
-                {block, first_cond},
-                {first_cond_false_block, second_cond},
+                {first_cond_block, first_cond},
+                {second_cond_block, second_cond},
             };
-            expr->ir_value =
-                duskIRCreatePhi(module, merge_block, expr->type, 2, pairs);
+            *expr_value =
+                duskIRCreatePhi(module, merge_block, expr_type, 2, pairs);
             break;
         }
         }
@@ -1384,18 +1492,18 @@ duskGenerateExpr(DuskIRModule *module, DuskDecl *func_decl, DuskExpr *expr)
     }
 
     case DUSK_EXPR_UNARY: {
-        DUSK_ASSERT(func_decl);
-        DuskIRValue *function = func_decl->ir_value;
+        DUSK_ASSERT(func_decl_id);
+        DuskIRValue *function = module->decl_infos[func_decl_id].value;
         DUSK_ASSERT(duskArrayLength(function->function.blocks_arr) > 0);
         DuskIRValue *block = duskGetLastBlock(function);
 
-        duskGenerateExpr(module, func_decl, expr->unary.right);
+        duskGenerateExpr(module, func_decl_id, expr->unary.right);
 
-        DuskIRValue *right_val =
-            duskIRLoadLvalue(module, block, expr->unary.right->ir_value);
+        DuskIRValue *right_val = duskIRLoadLvalue(
+            module, block, module->expr_values[expr->unary.right]);
 
-        expr->ir_value = duskIRCreateUnaryOperation(
-            module, block, expr->unary.op, expr->type, right_val);
+        *expr_value = duskIRCreateUnaryOperation(
+            module, block, expr->unary.op, expr_type, right_val);
     }
 
     case DUSK_EXPR_STRING_LITERAL:
@@ -1413,20 +1521,24 @@ duskGenerateExpr(DuskIRModule *module, DuskDecl *func_decl, DuskExpr *expr)
 static void duskGenerateStmt(
     DuskIRModule *module,
     DuskAstToIRState *state,
-    DuskDecl *func_decl,
-    DuskStmt *stmt)
+    DuskDeclId func_decl_id,
+    DuskStmtId stmt_id)
 {
-    DuskIRValue *function = func_decl->ir_value;
+    DuskCompiler *compiler = module->compiler;
+    DuskStmt *stmt = duskStmtGet(compiler, stmt_id);
+    DuskIRDeclInfo *func_info = &module->decl_infos[func_decl_id];
+    DuskIRValue *function = func_info->value;
 
     DUSK_ASSERT(duskArrayLength(function->function.blocks_arr) > 0);
     DuskIRValue *block = duskGetLastBlock(function);
 
     switch (stmt->kind) {
     case DUSK_STMT_RETURN: {
-        if (func_decl->function.is_entry_point) {
-            DuskType *return_type = func_decl->type->function.return_type;
+        if (duskDeclGet(compiler, func_decl_id)->function.is_entry_point) {
+            DuskType *return_type =
+                compiler->decl_types_arr[func_decl_id]->function.return_type;
             size_t output_count =
-                duskArrayLength(func_decl->function.entry_point_outputs_arr);
+                duskArrayLength(func_info->entry_point_outputs_arr);
 
             switch (return_type->kind) {
             case DUSK_TYPE_VOID: {
@@ -1436,10 +1548,12 @@ static void duskGenerateStmt(
             case DUSK_TYPE_STRUCT: {
                 DUSK_ASSERT(output_count == return_type->struct_.field_count);
 
-                duskGenerateExpr(module, func_decl, stmt->return_.expr);
-                DuskIRValue *struct_value = stmt->return_.expr->ir_value;
+                duskGenerateExpr(module, func_decl_id, stmt->return_.expr);
+                block = duskGetLastBlock(function);
+                DuskIRValue *struct_value =
+                    module->expr_values[stmt->return_.expr];
                 struct_value = duskIRLoadLvalue(
-                    module, block, stmt->return_.expr->ir_value);
+                    module, block, module->expr_values[stmt->return_.expr]);
 
                 for (uint32_t i = 0; i < output_count; ++i) {
                     DuskIRValue *field_value = duskIRCreateCompositeExtract(
@@ -1454,7 +1568,7 @@ static void duskGenerateStmt(
                     duskIRCreateStore(
                         module,
                         block,
-                        func_decl->function.entry_point_outputs_arr[i],
+                        func_info->entry_point_outputs_arr[i],
                         field_value);
                 }
                 break;
@@ -1463,12 +1577,14 @@ static void duskGenerateStmt(
                 DUSK_ASSERT(output_count == 1);
                 DUSK_ASSERT(stmt->return_.expr);
                 DuskIRValue *output_value =
-                    func_decl->function.entry_point_outputs_arr[0];
+                    func_info->entry_point_outputs_arr[0];
 
-                duskGenerateExpr(module, func_decl, stmt->return_.expr);
-                DuskIRValue *returned_value = stmt->return_.expr->ir_value;
+                duskGenerateExpr(module, func_decl_id, stmt->return_.expr);
+                block = duskGetLastBlock(function);
+                DuskIRValue *returned_value =
+                    module->expr_values[stmt->return_.expr];
                 returned_value = duskIRLoadLvalue(
-                    module, block, stmt->return_.expr->ir_value);
+                    module, block, module->expr_values[stmt->return_.expr]);
 
                 duskIRCreateStore(module, block, output_value, returned_value);
                 break;
@@ -1479,10 +1595,11 @@ static void duskGenerateStmt(
         } else {
             DuskIRValue *returned_value = NULL;
             if (stmt->return_.expr) {
-                duskGenerateExpr(module, func_decl, stmt->return_.expr);
-                returned_value = stmt->return_.expr->ir_value;
+                duskGenerateExpr(module, func_decl_id, stmt->return_.expr);
+                block = duskGetLastBlock(function);
+                returned_value = module->expr_values[stmt->return_.expr];
                 returned_value = duskIRLoadLvalue(
-                    module, block, stmt->return_.expr->ir_value);
+                    module, block, module->expr_values[stmt->return_.expr]);
                 DUSK_ASSERT(returned_value);
             }
 
@@ -1495,28 +1612,29 @@ static void duskGenerateStmt(
         break;
     }
     case DUSK_STMT_DECL: {
-        duskGenerateLocalDecl(module, func_decl, stmt->decl);
+        duskGenerateLocalDecl(module, func_decl_id, stmt->decl);
         break;
     }
     case DUSK_STMT_ASSIGN: {
-        duskGenerateExpr(module, func_decl, stmt->assign.assigned_expr);
-        duskGenerateExpr(module, func_decl, stmt->assign.value_expr);
+        duskGenerateExpr(module, func_decl_id, stmt->assign.assigned_expr);
+        duskGenerateExpr(module, func_decl_id, stmt->assign.value_expr);
+        block = duskGetLastBlock(function);
 
-        DuskIRValue *pointer = stmt->assign.assigned_expr->ir_value;
-        DuskIRValue *value = stmt->assign.value_expr->ir_value;
+        DuskIRValue *pointer = module->expr_values[stmt->assign.assigned_expr];
+        DuskIRValue *value = module->expr_values[stmt->assign.value_expr];
         value = duskIRLoadLvalue(module, block, value);
 
         duskIRCreateStore(module, block, pointer, value);
         break;
     }
     case DUSK_STMT_EXPR: {
-        duskGenerateExpr(module, func_decl, stmt->expr);
+        duskGenerateExpr(module, func_decl_id, stmt->expr);
         break;
     }
     case DUSK_STMT_BLOCK: {
         for (size_t i = 0; i < duskArrayLength(stmt->block.stmts_arr); ++i) {
             duskGenerateStmt(
-                module, state, func_decl, stmt->block.stmts_arr[i]);
+                module, state, func_decl_id, stmt->block.stmts_arr[i]);
         }
         break;
     }
@@ -1530,9 +1648,11 @@ static void duskGenerateStmt(
         DuskIRValue *merge_block = duskIRBlockCreate(module);
 
         // Generate conditional branch
-        duskGenerateExpr(module, func_decl, stmt->if_.cond_expr);
+        duskGenerateExpr(module, func_decl_id, stmt->if_.cond_expr);
         DuskIRValue *cond = duskIRLoadLvalue(
-            module, duskGetLastBlock(function), stmt->if_.cond_expr->ir_value);
+            module,
+            duskGetLastBlock(function),
+            module->expr_values[stmt->if_.cond_expr]);
         duskIRCreateSelectionMerge(
             module, duskGetLastBlock(function), merge_block);
         duskIRCreateBranchCond(
@@ -1545,12 +1665,12 @@ static void duskGenerateStmt(
         // Generate code and add blocks
 
         duskIRFunctionAddBlock(function, true_block);
-        duskGenerateStmt(module, state, func_decl, stmt->if_.true_stmt);
+        duskGenerateStmt(module, state, func_decl_id, stmt->if_.true_stmt);
         duskIRCreateBranch(module, duskGetLastBlock(function), merge_block);
 
         if (false_block) {
             duskIRFunctionAddBlock(function, false_block);
-            duskGenerateStmt(module, state, func_decl, stmt->if_.false_stmt);
+            duskGenerateStmt(module, state, func_decl_id, stmt->if_.false_stmt);
             duskIRCreateBranch(module, duskGetLastBlock(function), merge_block);
         }
 
@@ -1570,16 +1690,21 @@ static void duskGenerateStmt(
         // Header block
         duskIRFunctionAddBlock(function, header_block);
         duskIRCreateLoopMerge(
-            module, header_block, merge_block, continue_block);
+            module,
+            header_block,
+            merge_block,
+            continue_block,
+            stmt->while_.unroll_hint,
+            stmt->while_.unroll_count);
         duskIRCreateBranch(module, header_block, cond_block);
 
         // Cond block
         duskIRFunctionAddBlock(function, cond_block);
-        duskGenerateExpr(module, func_decl, stmt->while_.cond_expr);
+        duskGenerateExpr(module, func_decl_id, stmt->while_.cond_expr);
         DuskIRValue *cond = duskIRLoadLvalue(
             module,
             duskGetLastBlock(function),
-            stmt->while_.cond_expr->ir_value);
+            module->expr_values[stmt->while_.cond_expr]);
         duskIRCreateBranchCond(
             module, duskGetLastBlock(function), cond, body_block, merge_block);
 
@@ -1588,7 +1713,7 @@ static void duskGenerateStmt(
         duskArrayPush(&state->continue_block_stack_arr, continue_block);
 
         duskIRFunctionAddBlock(function, body_block);
-        duskGenerateStmt(module, state, func_decl, stmt->while_.stmt);
+        duskGenerateStmt(module, state, func_decl_id, stmt->while_.stmt);
         duskIRCreateBranch(module, duskGetLastBlock(function), continue_block);
 
         duskArrayPop(&state->continue_block_stack_arr);
@@ -1623,26 +1748,33 @@ static void duskGenerateStmt(
     }
 }
 
-static void
-duskGenerateLocalDecl(DuskIRModule *module, DuskDecl *func_decl, DuskDecl *decl)
+static void duskGenerateLocalDecl(
+    DuskIRModule *module, DuskDeclId func_decl_id, DuskDeclId decl_id)
 {
-    DuskIRValue *function = func_decl->ir_value;
+    DuskCompiler *compiler = module->compiler;
+    DuskDecl *decl = duskDeclGet(compiler, decl_id);
+    DuskType *decl_type = compiler->decl_types_arr[decl_id];
+    DuskIRValue **decl_value = &module->decl_infos[decl_id].value;
+
+    // Constants are folded into the expressions that use them
+    if (decl->kind == DUSK_DECL_CONST) return;
+
+    DuskIRValue *function = module->decl_infos[func_decl_id].value;
     DuskIRValue *block =
         function->function
             .blocks_arr[duskArrayLength(function->function.blocks_arr) - 1];
 
-    DUSK_ASSERT(decl->type);
-    if (decl->type) {
-        duskTypeMarkNotDead(decl->type);
+    DUSK_ASSERT(decl_type);
+    if (decl_type) {
+        duskTypeMarkNotDead(module->compiler, decl_type);
     }
-    DUSK_ASSERT(decl->type->emit);
 
     switch (decl->kind) {
     case DUSK_DECL_VAR: {
-        DUSK_ASSERT(decl->type);
+        DUSK_ASSERT(decl_type);
 
         bool should_create_var = true;
-        switch (decl->type->kind) {
+        switch (decl_type->kind) {
         case DUSK_TYPE_IMAGE:
         case DUSK_TYPE_SAMPLED_IMAGE:
         case DUSK_TYPE_SAMPLER: should_create_var = false; break;
@@ -1650,46 +1782,58 @@ duskGenerateLocalDecl(DuskIRModule *module, DuskDecl *func_decl, DuskDecl *decl)
         }
 
         if (should_create_var) {
-            decl->ir_value = duskIRVariableCreate(
-                module, decl->type, DUSK_STORAGE_CLASS_FUNCTION);
-            duskArrayPush(&function->function.variables_arr, decl->ir_value);
+            *decl_value = duskIRVariableCreate(
+                module, decl_type, DUSK_STORAGE_CLASS_FUNCTION);
+            duskArrayPush(&function->function.variables_arr, *decl_value);
         }
 
         if (decl->var.value_expr) {
-            duskGenerateExpr(module, func_decl, decl->var.value_expr);
-            DuskIRValue *assigned_value = decl->var.value_expr->ir_value;
+            duskGenerateExpr(module, func_decl_id, decl->var.value_expr);
+            DuskIRValue *assigned_value =
+                module->expr_values[decl->var.value_expr];
+
+            // The expression can end in a different block, like the merge
+            // block of a logical operator
+            block = duskGetLastBlock(function);
 
             if (should_create_var) {
                 assigned_value =
                     duskIRLoadLvalue(module, block, assigned_value);
-                duskIRCreateStore(
-                    module, block, decl->ir_value, assigned_value);
+                duskIRCreateStore(module, block, *decl_value, assigned_value);
             } else {
-                decl->ir_value = assigned_value;
+                *decl_value = assigned_value;
             }
         }
 
-        DUSK_ASSERT(decl->ir_value);
+        DUSK_ASSERT(*decl_value);
 
         break;
     }
     case DUSK_DECL_FUNCTION:
-    case DUSK_DECL_TYPE: DUSK_ASSERT(0); break;
+    case DUSK_DECL_TYPE:
+    case DUSK_DECL_CONST: DUSK_ASSERT(0); break;
     }
 }
 
-static void duskGenerateGlobalDecl(
-    DuskIRModule *module, DuskAstToIRState *state, DuskDecl *decl)
+static void duskGenerateGlobalDecl(DuskIRModule *module, DuskDeclId decl_id)
 {
-    if (decl->type) {
-        duskTypeMarkNotDead(decl->type);
+    DuskCompiler *compiler = module->compiler;
+    DuskDecl *decl = duskDeclGet(compiler, decl_id);
+    DuskType *decl_type = compiler->decl_types_arr[decl_id];
+    DuskIRDeclInfo *decl_info = &module->decl_infos[decl_id];
+
+    // Type and constant declarations don't generate any IR, so their types
+    // shouldn't take up an id
+    if (decl_type && decl->kind != DUSK_DECL_TYPE &&
+        decl->kind != DUSK_DECL_CONST) {
+        duskTypeMarkNotDead(module->compiler, decl_type);
     }
 
     switch (decl->kind) {
     case DUSK_DECL_FUNCTION: {
-        DUSK_ASSERT(decl->type);
+        DUSK_ASSERT(decl_type);
 
-        DuskType *function_type = decl->type;
+        DuskType *function_type = decl_type;
         if (decl->function.is_entry_point) {
             // Entry point is a function with no parameters and no return type
             function_type = duskTypeNewFunction(
@@ -1698,38 +1842,42 @@ static void duskGenerateGlobalDecl(
                 0,
                 NULL);
 
-            decl->function.entry_point_inputs_arr =
+            decl_info->entry_point_inputs_arr =
                 duskArrayCreate(module->allocator, DuskIRValue *);
-            decl->function.entry_point_outputs_arr =
+            decl_info->entry_point_outputs_arr =
                 duskArrayCreate(module->allocator, DuskIRValue *);
         }
-        decl->ir_value =
+        decl_info->value =
             duskIRFunctionCreate(module, function_type, decl->name);
-        duskArrayPush(&module->functions_arr, decl->ir_value);
+        decl_info->value->function.inline_hint = decl->function.inline_hint;
+        duskArrayPush(&module->functions_arr, decl_info->value);
 
         size_t param_count =
             duskArrayLength(decl->function.parameter_decls_arr);
         if (decl->function.is_entry_point) {
             for (size_t i = 0; i < param_count; ++i) {
-                DuskDecl *param_decl = decl->function.parameter_decls_arr[i];
+                DuskDeclId param_decl_id =
+                    decl->function.parameter_decls_arr[i];
+                DuskType *param_type = compiler->decl_types_arr[param_decl_id];
+                DuskIRValue **param_value =
+                    &module->decl_infos[param_decl_id].value;
 
-                switch (param_decl->type->kind) {
+                switch (param_type->kind) {
                 case DUSK_TYPE_STRUCT: {
-                    size_t field_count = param_decl->type->struct_.field_count;
+                    size_t field_count = param_type->struct_.field_count;
                     DuskIRValue **field_values = DUSK_NEW_ARRAY(
                         module->allocator, DuskIRValue *, field_count);
 
                     for (size_t j = 0; j < field_count; ++j) {
                         DuskType *field_type =
-                            param_decl->type->struct_.field_types[j];
+                            param_type->struct_.field_types[j];
                         DuskIRValue *input_value = duskIRVariableCreate(
                             module, field_type, DUSK_STORAGE_CLASS_INPUT);
                         duskArrayPush(
-                            &decl->function.entry_point_inputs_arr,
-                            input_value);
+                            &decl_info->entry_point_inputs_arr, input_value);
 
                         DuskArray(DuskAttribute) field_attributes_arr =
-                            param_decl->type->struct_.field_attribute_arrays[j];
+                            param_type->struct_.field_attribute_arrays[j];
 
                         duskDecorateFromAttributes(
                             module,
@@ -1741,45 +1889,40 @@ static void duskGenerateGlobalDecl(
                     }
 
                     DUSK_ASSERT(
-                        duskArrayLength(decl->ir_value->function.blocks_arr) >
+                        duskArrayLength(decl_info->value->function.blocks_arr) >
                         0);
 
-                    DuskIRValue *block = duskGetLastBlock(decl->ir_value);
+                    DuskIRValue *block = duskGetLastBlock(decl_info->value);
 
                     for (size_t j = 0; j < field_count; ++j) {
                         field_values[j] =
                             duskIRLoadLvalue(module, block, field_values[j]);
                     }
 
-                    param_decl->ir_value = duskIRCreateCompositeConstruct(
-                        module,
-                        block,
-                        param_decl->type,
-                        field_count,
-                        field_values);
+                    *param_value = duskIRCreateCompositeConstruct(
+                        module, block, param_type, field_count, field_values);
                     break;
                 }
                 default: {
-                    param_decl->ir_value = duskIRVariableCreate(
-                        module, param_decl->type, DUSK_STORAGE_CLASS_INPUT);
+                    *param_value = duskIRVariableCreate(
+                        module, param_type, DUSK_STORAGE_CLASS_INPUT);
                     duskArrayPush(
-                        &decl->function.entry_point_inputs_arr,
-                        param_decl->ir_value);
+                        &decl_info->entry_point_inputs_arr, *param_value);
 
                     duskDecorateFromAttributes(
                         module,
-                        &param_decl->ir_value->decorations_arr,
+                        &(*param_value)->decorations_arr,
                         duskArrayLength(
                             decl->function.return_type_attributes_arr),
                         decl->function.return_type_attributes_arr);
 
-                    DUSK_ASSERT(param_decl->ir_value);
+                    DUSK_ASSERT(*param_value);
                     break;
                 }
                 }
             }
 
-            DuskType *return_type = decl->type->function.return_type;
+            DuskType *return_type = decl_type->function.return_type;
             switch (return_type->kind) {
             case DUSK_TYPE_VOID: break;
             case DUSK_TYPE_STRUCT: {
@@ -1788,7 +1931,7 @@ static void duskGenerateGlobalDecl(
                     DuskIRValue *output_value = duskIRVariableCreate(
                         module, field_type, DUSK_STORAGE_CLASS_OUTPUT);
                     duskArrayPush(
-                        &decl->function.entry_point_outputs_arr, output_value);
+                        &decl_info->entry_point_outputs_arr, output_value);
 
                     DuskArray(DuskAttribute) field_attributes_arr =
                         return_type->struct_.field_attribute_arrays[i];
@@ -1805,7 +1948,7 @@ static void duskGenerateGlobalDecl(
                 DuskIRValue *output_value = duskIRVariableCreate(
                     module, return_type, DUSK_STORAGE_CLASS_OUTPUT);
                 duskArrayPush(
-                    &decl->function.entry_point_outputs_arr, output_value);
+                    &decl_info->entry_point_outputs_arr, output_value);
 
                 duskDecorateFromAttributes(
                     module,
@@ -1817,9 +1960,11 @@ static void duskGenerateGlobalDecl(
             }
         } else {
             for (size_t i = 0; i < param_count; ++i) {
-                DuskDecl *param_decl = decl->function.parameter_decls_arr[i];
-                param_decl->ir_value = decl->ir_value->function.params_arr[i];
-                DUSK_ASSERT(param_decl->ir_value);
+                DuskDeclId param_decl_id =
+                    decl->function.parameter_decls_arr[i];
+                module->decl_infos[param_decl_id].value =
+                    decl_info->value->function.params_arr[i];
+                DUSK_ASSERT(module->decl_infos[param_decl_id].value);
             }
         }
 
@@ -1829,111 +1974,465 @@ static void duskGenerateGlobalDecl(
                 duskArrayCreate(module->allocator, DuskIRValue *);
 
             for (size_t i = 0;
-                 i < duskArrayLength(decl->function.entry_point_inputs_arr);
+                 i < duskArrayLength(decl_info->entry_point_inputs_arr);
                  ++i) {
                 duskArrayPush(
                     &referenced_globals_arr,
-                    decl->function.entry_point_inputs_arr[i]);
+                    decl_info->entry_point_inputs_arr[i]);
             }
 
             for (size_t i = 0;
-                 i < duskArrayLength(decl->function.entry_point_outputs_arr);
+                 i < duskArrayLength(decl_info->entry_point_outputs_arr);
                  ++i) {
                 duskArrayPush(
                     &referenced_globals_arr,
-                    decl->function.entry_point_outputs_arr[i]);
+                    decl_info->entry_point_outputs_arr[i]);
             }
 
-            decl->function.entry_point = duskIRModuleAddEntryPoint(
+            decl_info->entry_point = duskIRModuleAddEntryPoint(
                 module,
-                decl->ir_value,
+                decl_info->value,
                 decl->function.link_name,
                 decl->function.entry_point_stage,
                 duskArrayLength(referenced_globals_arr),
                 referenced_globals_arr);
         }
 
-        // Generate function body
-        size_t stmt_count = duskArrayLength(decl->function.stmts_arr);
-        for (size_t i = 0; i < stmt_count; ++i) {
-            DuskStmt *stmt = decl->function.stmts_arr[i];
-            duskGenerateStmt(module, state, decl, stmt);
+        break;
+    }
+    case DUSK_DECL_VAR: {
+        DUSK_ASSERT(decl_type);
+
+        decl_info->value =
+            duskIRVariableCreate(module, decl_type, decl->var.storage_class);
+
+        duskDecorateFromAttributes(
+            module,
+            &decl_info->value->decorations_arr,
+            duskArrayLength(decl->attributes_arr),
+            decl->attributes_arr);
+        break;
+    }
+    case DUSK_DECL_TYPE:
+    case DUSK_DECL_CONST: break;
+    }
+}
+
+// The body of a function is generated after every declaration, so it can be
+// done by any thread
+static void duskGenerateFunctionBody(
+    DuskIRModule *module, DuskAstToIRState *state, DuskDeclId decl_id)
+{
+    DuskDecl *decl = duskDeclGet(module->compiler, decl_id);
+    DuskIRValue *function = module->decl_infos[decl_id].value;
+
+    size_t stmt_count = duskArrayLength(decl->function.stmts_arr);
+    for (size_t i = 0; i < stmt_count; ++i) {
+        DuskStmtId stmt_id = decl->function.stmts_arr[i];
+        duskGenerateStmt(module, state, decl_id, stmt_id);
+    }
+
+    duskIRPromoteLocals(module, function);
+    duskIRFoldConstants(module, function);
+    if (duskIRUnrollLoops(module, function)) {
+        duskIRFoldConstants(module, function);
+    }
+    duskIRReduceStrength(module, function);
+    duskIRHoistLoopInvariants(module, function);
+    duskIREliminateCommonSubexpressions(module, function);
+    duskIRRemoveDeadCode(module, function);
+}
+
+static void duskFinishFunction(DuskIRModule *module, DuskDeclId decl_id)
+{
+    DuskCompiler *compiler = module->compiler;
+    DuskIRDeclInfo *decl_info = &module->decl_infos[decl_id];
+    DuskIRValue *function = decl_info->value;
+
+    // Reference the globals in the function
+    if (duskDeclGet(compiler, decl_id)->function.is_entry_point) {
+        for (size_t i = 0; i < duskArrayLength(function->function.blocks_arr);
+             ++i) {
+            DuskIRValue *block = function->function.blocks_arr[i];
+
+            duskWithOperands(
+                block->block.insts_arr,
+                duskArrayLength(block->block.insts_arr),
+                (void *)decl_info->entry_point,
+                duskReferenceGlobalOperands);
         }
+    }
 
-        // Reference the globals in the function
-        if (decl->function.is_entry_point) {
-            for (size_t i = 0;
-                 i < duskArrayLength(decl->ir_value->function.blocks_arr);
-                 ++i) {
-                DuskIRValue *block = decl->ir_value->function.blocks_arr[i];
+    // Insert void returns where needed
+    DuskType *return_type =
+        compiler->decl_types_arr[decl_id]->function.return_type;
+    for (size_t i = 0; i < duskArrayLength(function->function.blocks_arr);
+         ++i) {
+        DuskIRValue *block = function->function.blocks_arr[i];
 
-                duskWithOperands(
-                    block->block.insts_arr,
-                    duskArrayLength(block->block.insts_arr),
-                    (void *)decl->function.entry_point,
-                    duskReferenceGlobalOperands);
+        if (!duskIRBlockIsTerminated(block)) {
+            if (return_type->kind == DUSK_TYPE_VOID) {
+                duskIRCreateReturn(module, block, NULL);
+            } else {
+                DUSK_ASSERT(0); // Missing terminator instruction
             }
         }
+    }
+}
 
-        // Insert void returns where needed
-        for (size_t i = 0;
-             i < duskArrayLength(decl->ir_value->function.blocks_arr);
-             ++i) {
-            DuskIRValue *block = decl->ir_value->function.blocks_arr[i];
+// Adds the declarations of the prelude that are used by a declaration with the
+// given referenced names, directly or through other prelude declarations
+static void duskCollectUsedExternalDecls(
+    DuskCompiler *compiler,
+    DuskScope *external_scope,
+    DuskMap *referenced_names,
+    DuskMap *used_decls)
+{
+    for (size_t i = 0; i < referenced_names->size; ++i) {
+        DuskMapSlot *slot = &referenced_names->slots[i];
+        if (slot->hash == 0) continue;
+
+        DuskDeclId decl_id = duskScopeLookup(external_scope, slot->key);
+        if (!decl_id || duskMapGet(used_decls, slot->key, NULL)) continue;
+
+        duskMapSet(used_decls, slot->key, (void *)(uintptr_t)decl_id);
+        duskCollectUsedExternalDecls(
+            compiler,
+            external_scope,
+            duskDeclGet(compiler, decl_id)->referenced_names,
+            used_decls);
+    }
+}
 
-            if (!duskIRBlockIsTerminated(block)) {
-                if (decl->type->function.return_type->kind == DUSK_TYPE_VOID) {
-                    duskIRCreateReturn(module, block, NULL);
-                } else {
-                    DUSK_ASSERT(0); // Missing terminator instruction
-                }
-            }
+static void duskAddUsedExternalDecls(
+    DuskCompiler *compiler,
+    DuskArray(DuskDeclId) * decls_arr,
+    DuskFile *external_file,
+    DuskMap *used_decls)
+{
+    for (size_t i = 0; i < duskArrayLength(external_file->decls_arr); ++i) {
+        DuskDeclId decl_id = external_file->decls_arr[i];
+        const char *name = duskDeclGet(compiler, decl_id)->name;
+        uintptr_t used_decl_id = 0;
+        if (duskMapGet(used_decls, name, (void **)&used_decl_id) &&
+            used_decl_id == decl_id) {
+            duskArrayPush(decls_arr, decl_id);
         }
+    }
+}
 
-        break;
+#define DUSK_PARALLEL_IR_MIN_LENGTH (1 << 16)
+#define DUSK_PARALLEL_IR_MAX_THREADS 64
+
+typedef struct DuskDeclGeneration {
+    DuskDeclId decl_id;
+    // Length of the declaration's text, used to split the bodies between jobs
+    size_t length;
+    // Types and constants asked for while generating the declaration and its
+    // body, used to order them as if everything was generated in a single pass
+    DuskArray(DuskType *) types_arr;
+    DuskArray(DuskType *) body_types_arr;
+    DuskArray(DuskIRValue *) consts_arr;
+    DuskArray(DuskIRValue *) body_consts_arr;
+} DuskDeclGeneration;
+
+typedef struct DuskIRJob {
+    // Each job gets its own copies of the compiler and of the module with a
+    // separate arena. Types and constants are interned by the ones they were
+    // copied from.
+    DuskCompiler compiler;
+    DuskIRModule module;
+    DuskDeclGeneration **bodies;
+    size_t body_count;
+} DuskIRJob;
+
+static void duskGenerateBody(
+    DuskIRModule *module,
+    DuskAstToIRState *state,
+    DuskDeclGeneration *generation)
+{
+    DuskCompiler *compiler = module->compiler;
+    DuskAllocator *allocator = module->allocator;
+
+    module->requested_consts_arr = duskArrayCreate(allocator, DuskIRValue *);
+    compiler->requested_types_arr = duskArrayCreate(allocator, DuskType *);
+
+    duskGenerateFunctionBody(module, state, generation->decl_id);
+
+    generation->body_consts_arr = module->requested_consts_arr;
+    generation->body_types_arr = compiler->requested_types_arr;
+    module->requested_consts_arr = NULL;
+    compiler->requested_types_arr = NULL;
+}
+
+static DuskArray(DuskIRValue *) duskCopyValues(
+    DuskAllocator *allocator, DuskArray(DuskIRValue *) values_arr)
+{
+    size_t value_count = duskArrayLength(values_arr);
+    DuskArray(DuskIRValue *) copy_arr =
+        duskArrayCreate(allocator, DuskIRValue *);
+    duskArrayResize(&copy_arr, value_count);
+    memcpy(copy_arr, values_arr, sizeof(DuskIRValue *) * value_count);
+    return copy_arr;
+}
+
+static void duskIRJobRun(void *user_data)
+{
+    DuskIRJob *job = (DuskIRJob *)user_data;
+    DuskIRModule *module = &job->module;
+    DuskAllocator *allocator = module->allocator;
+
+    DuskAstToIRState state = {
+        .break_block_stack_arr = duskArrayCreate(allocator, DuskIRValue *),
+        .continue_block_stack_arr = duskArrayCreate(allocator, DuskIRValue *),
+    };
+
+    for (size_t i = 0; i < job->body_count; ++i) {
+        // The function was created by the main thread, so the arrays that its
+        // body adds to are moved to this job's arena first
+        DuskIRValue *function =
+            module->decl_infos[job->bodies[i]->decl_id].value;
+        function->function.blocks_arr =
+            duskCopyValues(allocator, function->function.blocks_arr);
+        function->function.variables_arr =
+            duskCopyValues(allocator, function->function.variables_arr);
+        for (size_t j = 0; j < duskArrayLength(function->function.blocks_arr);
+             ++j) {
+            DuskIRValue *block = function->function.blocks_arr[j];
+            block->block.insts_arr =
+                duskCopyValues(allocator, block->block.insts_arr);
+        }
+
+        duskGenerateBody(module, &state, job->bodies[i]);
     }
-    case DUSK_DECL_VAR: {
-        DUSK_ASSERT(decl->type);
+}
 
-        decl->ir_value =
-            duskIRVariableCreate(module, decl->type, decl->var.storage_class);
+// Generates the function bodies on worker threads if there is enough of them.
+// Returns false if they should be generated serially instead.
+static bool duskGenerateBodiesInParallel(
+    DuskIRModule *module, DuskArray(DuskDeclGeneration *) bodies_arr)
+{
+    DuskCompiler *compiler = module->compiler;
+    DuskAllocator *allocator = module->allocator;
 
-        duskDecorateFromAttributes(
-            module,
-            &decl->ir_value->decorations_arr,
-            duskArrayLength(decl->attributes_arr),
-            decl->attributes_arr);
+    if (!compiler->type_mutex) return false;
+
+    uint32_t thread_count = duskCompilerGetThreadCount(compiler);
+    if (thread_count > DUSK_PARALLEL_IR_MAX_THREADS) {
+        thread_count = DUSK_PARALLEL_IR_MAX_THREADS;
+    }
+
+    size_t body_count = duskArrayLength(bodies_arr);
+    size_t total_length = 0;
+    for (size_t i = 0; i < body_count; ++i) {
+        total_length += bodies_arr[i]->length;
+    }
 
-        if (decl->type->kind == DUSK_TYPE_RUNTIME_ARRAY) {
-            duskArrayPush(
-                &module->extensions_arr, "SPV_EXT_descriptor_indexing");
-            duskArrayPush(
-                &module->capabilities_arr, SpvCapabilityRuntimeDescriptorArray);
+    if (total_length < DUSK_PARALLEL_IR_MIN_LENGTH || thread_count <= 1 ||
+        body_count < 2) {
+        return false;
+    }
+
+    if (thread_count > body_count) thread_count = (uint32_t)body_count;
+
+    // Hand out contiguous runs of functions with roughly the same amount of
+    // text to each job
+    DuskIRJob *jobs = DUSK_NEW_ARRAY(allocator, DuskIRJob, thread_count);
+    size_t length_per_job = total_length / thread_count + 1;
+    size_t body_index = 0;
+    for (uint32_t i = 0; i < thread_count; ++i) {
+        DuskIRJob *job = &jobs[i];
+        job->compiler = *compiler;
+        job->compiler.main_arena = duskArenaCreate(NULL, 1 << 16);
+        DuskAllocator *job_allocator =
+            duskArenaGetAllocator(job->compiler.main_arena);
+        job->compiler.type_owner = compiler;
+        job->compiler.marked_types_arr =
+            duskArrayCreate(job_allocator, DuskType *);
+        duskArrayPush(&compiler->worker_arenas_arr, job->compiler.main_arena);
+
+        job->module = *module;
+        job->module.compiler = &job->compiler;
+        job->module.allocator = job_allocator;
+        job->module.const_owner = module;
+
+        job->bodies = &bodies_arr[body_index];
+        size_t job_length = 0;
+        while (body_index < body_count &&
+               (i == thread_count - 1 || job->body_count == 0 ||
+                job_length < length_per_job)) {
+            job_length += bodies_arr[body_index]->length;
+            job->body_count++;
+            body_index++;
+        }
+        if (body_index >= body_count) {
+            thread_count = i + 1;
+            break;
         }
+    }
 
-        break;
+    DuskThread **threads =
+        DUSK_NEW_ARRAY(allocator, DuskThread *, thread_count);
+    // The jobs allocate new types and constants from our arena while the
+    // threads are being created, so the threads are allocated from the heap
+    for (uint32_t i = 1; i < thread_count; ++i) {
+        threads[i] = duskThreadCreate(NULL, duskIRJobRun, &jobs[i]);
+        if (!threads[i]) duskIRJobRun(&jobs[i]);
     }
-    case DUSK_DECL_TYPE: break;
+
+    duskIRJobRun(&jobs[0]);
+
+    for (uint32_t i = 1; i < thread_count; ++i) {
+        if (threads[i]) duskThreadJoin(threads[i]);
+    }
+
+    for (uint32_t i = 0; i < thread_count; ++i) {
+        DuskArray(DuskType *) marked_types_arr =
+            jobs[i].compiler.marked_types_arr;
+        for (size_t j = 0; j < duskArrayLength(marked_types_arr); ++j) {
+            duskTypeMarkNotDead(compiler, marked_types_arr[j]);
+        }
     }
+
+    return true;
 }
 
-DuskIRModule *duskGenerateIRModule(DuskCompiler *compiler, DuskFile *file)
+// Puts the constants in the order in which the declarations and their bodies
+// first asked for them, no matter which order they were actually created in
+static void duskOrderConsts(
+    DuskIRModule *module,
+    DuskDeclGeneration *generations,
+    size_t generation_count)
 {
-    (void)file;
+    size_t const_count = duskArrayLength(module->consts_arr);
+
+    // Ids are only assigned when the module is emitted, so borrow them to tell
+    // apart constants that are yet to be placed
+    for (size_t i = 0; i < const_count; ++i) {
+        module->consts_arr[i]->id = 1;
+    }
+
+    duskArrayResize(&module->consts_arr, 0);
+    for (size_t i = 0; i < generation_count; ++i) {
+        DuskArray(DuskIRValue *) consts_arrs[2] = {
+            generations[i].consts_arr,
+            generations[i].body_consts_arr,
+        };
+        for (size_t j = 0; j < DUSK_CARRAY_LENGTH(consts_arrs); ++j) {
+            for (size_t k = 0; k < duskArrayLength(consts_arrs[j]); ++k) {
+                DuskIRValue *value = consts_arrs[j][k];
+                if (value->id == 0) continue;
+                value->id = 0;
+                duskArrayPush(&module->consts_arr, value);
+            }
+        }
+    }
 
+    DUSK_ASSERT(duskArrayLength(module->consts_arr) == const_count);
+}
+
+DuskIRModule *duskGenerateIRModule(DuskCompiler *compiler, DuskFile *file)
+{
     DuskIRModule *module = duskIRModuleCreate(compiler);
+    DuskAllocator *allocator = module->allocator;
+
+    module->expr_values = DUSK_NEW_ARRAY(
+        allocator, DuskIRValue *, compiler->expr_pool.next_id);
+    module->decl_infos = DUSK_NEW_ARRAY(
+        allocator, DuskIRDeclInfo, compiler->decl_pool.next_id);
 
     DuskAstToIRState state = {
-        .break_block_stack_arr =
-            duskArrayCreate(module->allocator, DuskIRValue *),
-        .continue_block_stack_arr =
-            duskArrayCreate(module->allocator, DuskIRValue *),
+        .break_block_stack_arr = duskArrayCreate(allocator, DuskIRValue *),
+        .continue_block_stack_arr = duskArrayCreate(allocator, DuskIRValue *),
     };
 
+    // Only the declarations of the prelude and of the imported modules that
+    // the file uses are generated, in the order they appear in them
+    DuskArray(DuskDeclId) decls_arr = duskArrayCreate(allocator, DuskDeclId);
+    DuskScope *external_scope = file->scope->parent;
+    if (external_scope) {
+        DuskMap *used_decls = duskMapCreate(allocator, 32);
+        for (size_t i = 0; i < duskArrayLength(file->decls_arr); ++i) {
+            DuskDecl *decl = duskDeclGet(compiler, file->decls_arr[i]);
+            duskCollectUsedExternalDecls(
+                compiler, external_scope, decl->referenced_names, used_decls);
+        }
+
+        if (compiler->prelude_file) {
+            duskAddUsedExternalDecls(
+                compiler, &decls_arr, compiler->prelude_file, used_decls);
+        }
+        for (size_t i = 0; i < duskArrayLength(file->modules_arr); ++i) {
+            duskAddUsedExternalDecls(
+                compiler, &decls_arr, file->modules_arr[i], used_decls);
+        }
+    }
+
+    size_t first_file_decl = duskArrayLength(decls_arr);
     for (size_t i = 0; i < duskArrayLength(file->decls_arr); ++i) {
-        DuskDecl *decl = file->decls_arr[i];
-        duskGenerateGlobalDecl(module, &state, decl);
+        duskArrayPush(&decls_arr, file->decls_arr[i]);
+    }
+
+    size_t decl_count = duskArrayLength(decls_arr);
+    size_t first_new_type = duskArrayLength(compiler->types_arr);
+    bool has_extents = duskArrayLength(file->decl_extents_arr) ==
+                       duskArrayLength(file->decls_arr);
+
+    // Declarations are generated in order, except for function bodies, which
+    // only use declarations that come before them and are generated afterwards
+    DuskDeclGeneration *generations =
+        DUSK_NEW_ARRAY(allocator, DuskDeclGeneration, decl_count);
+    DuskArray(DuskDeclGeneration *) bodies_arr =
+        duskArrayCreate(allocator, DuskDeclGeneration *);
+
+    for (size_t i = 0; i < decl_count; ++i) {
+        DuskDeclGeneration *generation = &generations[i];
+        generation->decl_id = decls_arr[i];
+        if (has_extents && i >= first_file_decl) {
+            generation->length =
+                file->decl_extents_arr[i - first_file_decl].length;
+        }
+
+        module->requested_consts_arr =
+            duskArrayCreate(allocator, DuskIRValue *);
+        compiler->requested_types_arr = duskArrayCreate(allocator, DuskType *);
+
+        duskGenerateGlobalDecl(module, generation->decl_id);
+
+        generation->consts_arr = module->requested_consts_arr;
+        generation->types_arr = compiler->requested_types_arr;
+        module->requested_consts_arr = NULL;
+        compiler->requested_types_arr = NULL;
+
+        DuskDecl *decl = duskDeclGet(compiler, generation->decl_id);
+        if (decl->kind == DUSK_DECL_FUNCTION) {
+            duskArrayPush(&bodies_arr, generation);
+        }
+    }
+
+    if (!duskGenerateBodiesInParallel(module, bodies_arr)) {
+        for (size_t i = 0; i < duskArrayLength(bodies_arr); ++i) {
+            duskGenerateBody(module, &state, bodies_arr[i]);
+        }
     }
 
+    for (size_t i = 0; i < duskArrayLength(bodies_arr); ++i) {
+        duskFinishFunction(module, bodies_arr[i]->decl_id);
+    }
+
+    duskOrderConsts(module, generations, decl_count);
+
+    DuskArray(DuskType *) *requested_arrs = DUSK_NEW_ARRAY(
+        allocator, DuskArray(DuskType *), decl_count * 2);
+    for (size_t i = 0; i < decl_count; ++i) {
+        requested_arrs[i * 2] = generations[i].types_arr;
+        requested_arrs[i * 2 + 1] = generations[i].body_types_arr;
+    }
+    duskTypeOrderNew(
+        compiler, first_new_type, decl_count * 2, requested_arrs);
+
+    duskIRInlineCalls(module);
+    duskIRModuleRemoveDeadCode(module);
+
     return module;
 }
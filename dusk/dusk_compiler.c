@@ -80,14 +80,38 @@ DuskCompiler *duskCompilerCreate(void)
 
     *compiler = (DuskCompiler){
         .main_arena = arena,
+        .worker_arenas_arr = duskArrayCreate(allocator, DuskArena *),
         .errors_arr = duskArrayCreate(allocator, DuskError),
-        .type_cache = duskMapCreate(allocator, 32),
         .types_arr = duskArrayCreate(allocator, DuskType *),
+        .type_marks_arr = duskArrayCreate(allocator, uint32_t),
+        .type_mark_stack_arr = duskArrayCreate(allocator, DuskType *),
+        .referenced_types_arr = duskArrayCreate(allocator, DuskType *),
+        .type_mutex = duskMutexCreate(allocator),
 
         .keyword_map = duskMapCreate(allocator, 128),
         .builtin_function_map = duskMapCreate(allocator, 32),
+
+        .module_cache = duskMapCreate(allocator, 16),
+        .loaded_modules = duskMapCreate(allocator, 16),
     };
 
+    duskTypeCacheInit(&compiler->type_cache, allocator, 64);
+    duskArrayResize(&compiler->type_marks_arr, duskTypeBuiltinCount());
+    memset(
+        compiler->type_marks_arr,
+        0,
+        sizeof(uint32_t) * duskArrayLength(compiler->type_marks_arr));
+
+    duskPoolInit(&compiler->expr_pool, allocator, sizeof(DuskExpr));
+    duskPoolInit(&compiler->stmt_pool, allocator, sizeof(DuskStmt));
+    duskPoolInit(&compiler->decl_pool, allocator, sizeof(DuskDecl));
+    compiler->expr_types_arr = duskArrayCreate(allocator, DuskType *);
+    compiler->expr_as_types_arr = duskArrayCreate(allocator, DuskType *);
+    compiler->expr_const_values_arr =
+        duskArrayCreate(allocator, DuskConstValue *);
+    compiler->decl_types_arr = duskArrayCreate(allocator, DuskType *);
+    duskGrowSideTables(compiler);
+
     duskMapSet(compiler->keyword_map, "var", (void *)DUSK_TOKEN_VAR);
     duskMapSet(compiler->keyword_map, "fn", (void *)DUSK_TOKEN_FN);
     duskMapSet(compiler->keyword_map, "const", (void *)DUSK_TOKEN_CONST);
@@ -214,6 +238,12 @@ DuskCompiler *duskCompilerCreate(void)
 
 void duskCompilerDestroy(DuskCompiler *compiler)
 {
+    if (compiler->type_mutex) {
+        duskMutexDestroy(compiler->type_mutex);
+    }
+    for (size_t i = 0; i < duskArrayLength(compiler->worker_arenas_arr); ++i) {
+        duskArenaDestroy(compiler->worker_arenas_arr[i]);
+    }
     duskArenaDestroy(compiler->main_arena);
     free(compiler);
 }
@@ -241,27 +271,69 @@ void duskAddError(
     duskArrayPush(&compiler->errors_arr, error);
 }
 
-uint8_t *duskCompile(
+static void duskReportErrors(DuskCompiler *compiler)
+{
+    for (size_t i = 0; i < duskArrayLength(compiler->errors_arr); ++i) {
+        DuskError err = compiler->errors_arr[i];
+        fprintf(
+            stderr,
+            "%s:%u:%u: %s\n",
+            err.location.file->path,
+            err.location.line,
+            err.location.col,
+            err.message);
+    }
+}
+
+static DuskIRModule *duskGenerateFile(DuskCompiler *compiler, DuskFile *file)
+{
+    duskAnalyzeFile(compiler, file);
+    if (duskArrayLength(compiler->errors_arr) > 0) {
+        duskThrow(compiler);
+    }
+
+    return duskGenerateIRModule(compiler, file);
+}
+
+static uint8_t *duskCompileFile(
+    DuskCompiler *compiler, DuskFile *file, size_t *spirv_byte_size)
+{
+    DuskIRModule *module = duskGenerateFile(compiler, file);
+    DuskArray(uint32_t) spirv = duskIRModuleEmit(compiler, module);
+
+    compiler->last_compile_succeeded = true;
+
+    *spirv_byte_size = duskArrayLength(spirv) * 4;
+    return (uint8_t *)spirv;
+}
+
+// Types from a previous compilation could have been declared differently, so
+// only the ones used by the prelude are kept
+static void duskResetTypes(DuskCompiler *compiler)
+{
+    DuskAllocator *allocator = duskArenaGetAllocator(compiler->main_arena);
+
+    duskTypeCacheInit(&compiler->type_cache, allocator, 64);
+    compiler->types_arr = duskArrayCreate(allocator, DuskType *);
+
+    for (size_t i = 0; i < duskArrayLength(compiler->prelude_types_arr); ++i) {
+        DuskType *type = compiler->prelude_types_arr[i];
+        duskTypeCacheAdd(&compiler->type_cache, type);
+        duskArrayPush(&compiler->types_arr, type);
+    }
+}
+
+static DuskFile *duskCreateFile(
     DuskCompiler *compiler,
     const char *path,
     const char *text,
-    size_t text_length,
-    size_t *spirv_byte_size)
+    size_t text_length)
 {
     DuskAllocator *allocator = duskArenaGetAllocator(compiler->main_arena);
 
-    if (setjmp(compiler->jump_buffer) != 0) {
-        for (size_t i = 0; i < duskArrayLength(compiler->errors_arr); ++i) {
-            DuskError err = compiler->errors_arr[i];
-            fprintf(
-                stderr,
-                "%s:%zu:%zu: %s\n",
-                err.location.file->path,
-                err.location.line,
-                err.location.col,
-                err.message);
-        }
-        return NULL;
+    DuskScope *parent_scope = NULL;
+    if (compiler->prelude_file) {
+        parent_scope = compiler->prelude_file->scope;
     }
 
     DuskFile *file = DUSK_NEW(allocator, DuskFile);
@@ -269,23 +341,283 @@ uint8_t *duskCompile(
         .path = path,
         .text = text,
         .text_length = text_length,
-        .decls_arr = duskArrayCreate(allocator, DuskDecl *),
-        .scope =
-            duskScopeCreate(allocator, NULL, DUSK_SCOPE_OWNER_TYPE_NONE, NULL),
+        .decls_arr = duskArrayCreate(allocator, DuskDeclId),
+        .decl_extents_arr = duskArrayCreate(allocator, DuskDeclExtent),
+        .scope = duskScopeCreate(
+            allocator, parent_scope, DUSK_SCOPE_OWNER_TYPE_NONE, 0),
     };
+    return file;
+}
+
+// Parses a file and the modules it imports
+static DuskFile *duskReadFile(
+    DuskCompiler *compiler,
+    const char *path,
+    const char *text,
+    size_t text_length)
+{
+    DuskAllocator *allocator = duskArenaGetAllocator(compiler->main_arena);
+    compiler->loaded_modules = duskMapCreate(allocator, 16);
+
+    DuskFile *file = duskCreateFile(compiler, path, text, text_length);
+    compiler->last_file = file;
+
+    duskParse(compiler, file);
+    duskLoadImports(compiler, file);
+
+    return file;
+}
+
+uint8_t *duskCompile(
+    DuskCompiler *compiler,
+    const char *path,
+    const char *text,
+    size_t text_length,
+    size_t *spirv_byte_size)
+{
+    duskArrayResize(&compiler->errors_arr, 0);
+    compiler->last_compile_succeeded = false;
+
+    duskResetTypes(compiler);
+
+    if (setjmp(compiler->jump_buffer) != 0) {
+        duskReportErrors(compiler);
+        return NULL;
+    }
+
+    DuskFile *file = duskReadFile(compiler, path, text, text_length);
+    return duskCompileFile(compiler, file, spirv_byte_size);
+}
+
+DuskEntryPointModule *duskCompileEntryPoints(
+    DuskCompiler *compiler,
+    const char *path,
+    const char *text,
+    size_t text_length,
+    size_t *module_count)
+{
+    duskArrayResize(&compiler->errors_arr, 0);
+    compiler->last_compile_succeeded = false;
+
+    duskResetTypes(compiler);
+
+    if (setjmp(compiler->jump_buffer) != 0) {
+        duskReportErrors(compiler);
+        return NULL;
+    }
+
+    DuskAllocator *allocator = duskArenaGetAllocator(compiler->main_arena);
+    DuskFile *file = duskReadFile(compiler, path, text, text_length);
+    DuskIRModule *module = duskGenerateFile(compiler, file);
+
+    // One more module is allocated so a file without entry points doesn't get
+    // NULL
+    size_t entry_point_count = duskArrayLength(module->entry_points_arr);
+    DuskEntryPointModule *modules = DUSK_NEW_ARRAY(
+        allocator, DuskEntryPointModule, entry_point_count + 1);
+
+    for (size_t i = 0; i < entry_point_count; ++i) {
+        DuskIREntryPoint *entry_point = module->entry_points_arr[i];
+        DuskIRModule *split = duskIRModuleSplit(module, entry_point);
+        DuskArray(uint32_t) spirv = duskIRModuleEmit(compiler, split);
+
+        modules[i] = (DuskEntryPointModule){
+            .name = entry_point->name,
+            .spirv = (uint8_t *)spirv,
+            .spirv_byte_size = duskArrayLength(spirv) * 4,
+        };
+    }
+
+    compiler->last_compile_succeeded = true;
+
+    *module_count = entry_point_count;
+    return modules;
+}
+
+uint8_t *duskCompileIncremental(
+    DuskCompiler *compiler,
+    const char *text,
+    size_t text_length,
+    size_t edit_offset,
+    size_t removed_length,
+    size_t inserted_length,
+    size_t *spirv_byte_size)
+{
+    DuskFile *file = compiler->last_file;
+    if (!file) {
+        return NULL;
+    }
+
+    if (!compiler->last_compile_succeeded ||
+        !duskParseIncremental(
+            compiler,
+            file,
+            text,
+            text_length,
+            edit_offset,
+            removed_length,
+            inserted_length)) {
+        return duskCompile(
+            compiler, file->path, text, text_length, spirv_byte_size);
+    }
+
+    duskArrayResize(&compiler->errors_arr, 0);
+    compiler->last_compile_succeeded = false;
+
+    if (setjmp(compiler->jump_buffer) != 0) {
+        duskReportErrors(compiler);
+        return NULL;
+    }
+
+    return duskCompileFile(compiler, file, spirv_byte_size);
+}
+
+uint8_t *duskCompilePrelude(
+    DuskCompiler *compiler,
+    const char *path,
+    const char *text,
+    size_t text_length,
+    size_t *blob_byte_size)
+{
+    duskArrayResize(&compiler->errors_arr, 0);
+    compiler->last_compile_succeeded = false;
+
+    duskResetTypes(compiler);
+
+    if (setjmp(compiler->jump_buffer) != 0) {
+        duskReportErrors(compiler);
+        return NULL;
+    }
+
+    // Preludes can't depend on each other
+    DuskFile *file = duskCreateFile(compiler, path, text, text_length);
+    file->scope->parent = NULL;
 
     duskParse(compiler, file);
 
+    for (size_t i = 0; i < duskArrayLength(file->imports_arr); ++i) {
+        duskAddError(
+            compiler,
+            file->imports_arr[i].location,
+            "imports are not allowed in a prelude");
+    }
+    if (duskArrayLength(compiler->errors_arr) > 0) {
+        duskThrow(compiler);
+    }
+
     duskAnalyzeFile(compiler, file);
+
+    for (size_t i = 0; i < duskArrayLength(file->decls_arr); ++i) {
+        DuskDecl *decl = duskDeclGet(compiler, file->decls_arr[i]);
+        if (decl->kind == DUSK_DECL_FUNCTION && decl->function.is_entry_point) {
+            duskAddError(
+                compiler,
+                decl->location,
+                "entry points are not allowed in a prelude");
+        }
+    }
+
     if (duskArrayLength(compiler->errors_arr) > 0) {
         duskThrow(compiler);
     }
 
-    DuskIRModule *module = duskGenerateIRModule(compiler, file);
-    DuskArray(uint32_t) spirv = duskIRModuleEmit(compiler, module);
+    return duskPreludeWrite(compiler, file, blob_byte_size);
+}
 
-    *spirv_byte_size = duskArrayLength(spirv) * 4;
-    return (uint8_t *)spirv;
+bool duskCompilerLoadPrelude(
+    DuskCompiler *compiler, const uint8_t *blob, size_t blob_byte_size)
+{
+    DuskAllocator *allocator = duskArenaGetAllocator(compiler->main_arena);
+
+    // The declarations of the last file and of the cached modules could
+    // refer to the old prelude
+    compiler->last_compile_succeeded = false;
+    compiler->module_cache = duskMapCreate(allocator, 16);
+
+    compiler->prelude_file = NULL;
+    compiler->prelude_types_arr = NULL;
+    duskResetTypes(compiler);
+
+    DuskFile *prelude_file =
+        duskPreludeRead(compiler, blob, blob_byte_size, NULL);
+    if (!prelude_file) {
+        duskResetTypes(compiler);
+        return false;
+    }
+
+    compiler->prelude_file = prelude_file;
+    compiler->prelude_types_arr = duskArrayCreate(allocator, DuskType *);
+    for (size_t i = 0; i < duskArrayLength(compiler->types_arr); ++i) {
+        duskArrayPush(&compiler->prelude_types_arr, compiler->types_arr[i]);
+    }
+
+    return true;
+}
+
+void duskCompilerSetImportCallback(
+    DuskCompiler *compiler, DuskImportCallback callback, void *user_data)
+{
+    compiler->import_callback = callback;
+    compiler->import_user_data = user_data;
+}
+
+void duskCompilerSetThreadCount(DuskCompiler *compiler, uint32_t thread_count)
+{
+    compiler->thread_count = thread_count;
+}
+
+uint32_t duskCompilerGetThreadCount(DuskCompiler *compiler)
+{
+    if (compiler->thread_count > 0) return compiler->thread_count;
+    return duskGetProcessorCount();
+}
+
+static void duskGrowSideTable(void **table_ptr, size_t length)
+{
+    size_t old_length = duskArrayLength(*table_ptr);
+    if (length <= old_length) return;
+
+    duskArrayResize(table_ptr, length);
+    memset(
+        (uint8_t *)*table_ptr + old_length * duskArrayItemSize(*table_ptr),
+        0,
+        (length - old_length) * duskArrayItemSize(*table_ptr));
+}
+
+void duskGrowSideTables(DuskCompiler *compiler)
+{
+    size_t expr_count = compiler->expr_pool.next_id;
+    duskGrowSideTable((void **)&compiler->expr_types_arr, expr_count);
+    duskGrowSideTable((void **)&compiler->expr_as_types_arr, expr_count);
+    duskGrowSideTable((void **)&compiler->expr_const_values_arr, expr_count);
+
+    size_t decl_count = compiler->decl_pool.next_id;
+    duskGrowSideTable((void **)&compiler->decl_types_arr, decl_count);
+}
+
+// The pools of the copies used by worker threads share their ids with the
+// pools of the compiler, which grows the side tables once they are done
+static uint32_t duskNodeCreate(DuskCompiler *compiler, DuskPool *pool)
+{
+    uint32_t id = duskPoolAllocate(pool);
+    if (id == 0) duskThrow(compiler);
+    if (!pool->owner) duskGrowSideTables(compiler);
+    return id;
+}
+
+DuskDeclId duskDeclCreate(DuskCompiler *compiler)
+{
+    return duskNodeCreate(compiler, &compiler->decl_pool);
+}
+
+DuskStmtId duskStmtCreate(DuskCompiler *compiler)
+{
+    return duskNodeCreate(compiler, &compiler->stmt_pool);
+}
+
+DuskExprId duskExprCreate(DuskCompiler *compiler)
+{
+    return duskNodeCreate(compiler, &compiler->expr_pool);
 }
 
 const char *duskGetBuiltinFunctionName(DuskBuiltinFunctionKind kind)
@@ -306,7 +638,7 @@ char *duskCompilerGetErrorsStringMalloc(DuskCompiler *compiler)
         int len = snprintf(
             line_buf,
             LINE_BUF_LEN,
-            "%s:%zu:%zu: %s\n",
+            "%s:%u:%u: %s\n",
             err.location.file->path,
             err.location.line,
             err.location.col,
@@ -0,0 +1,1112 @@
+#include "dusk_internal.h"
+#include <math.h>
+
+#define DUSK_CONST_PI 3.14159265358979323846
+
+static DuskConstValue *duskConstCreate(DuskAllocator *allocator, DuskType *type)
+{
+    DuskConstValue *value = DUSK_NEW(allocator, DuskConstValue);
+    value->type = type;
+    return value;
+}
+
+static DuskConstValue *duskConstCompositeCreate(
+    DuskAllocator *allocator, DuskType *type, size_t count)
+{
+    DuskConstValue *value = duskConstCreate(allocator, type);
+    value->composite.count = count;
+    value->composite.values = DUSK_NEW_ARRAY(allocator, DuskConstValue *, count);
+    return value;
+}
+
+static bool duskConstIsIntType(DuskType *type)
+{
+    return type->kind == DUSK_TYPE_INT || type->kind == DUSK_TYPE_UNTYPED_INT;
+}
+
+static bool duskConstIsFloatType(DuskType *type)
+{
+    return type->kind == DUSK_TYPE_FLOAT ||
+           type->kind == DUSK_TYPE_UNTYPED_FLOAT;
+}
+
+static bool duskConstIsComposite(DuskConstValue *value)
+{
+    switch (value->type->kind) {
+    case DUSK_TYPE_VECTOR:
+    case DUSK_TYPE_MATRIX:
+    case DUSK_TYPE_ARRAY:
+    case DUSK_TYPE_STRUCT: return true;
+    default: return false;
+    }
+}
+
+// Untyped integers behave like 64-bit signed integers
+static uint32_t duskConstIntBits(DuskType *type)
+{
+    return type->kind == DUSK_TYPE_INT ? type->int_.bits : 64;
+}
+
+static bool duskConstIntIsSigned(DuskType *type)
+{
+    return type->kind != DUSK_TYPE_INT || type->int_.is_signed;
+}
+
+static uint64_t duskConstWrapInt(DuskType *type, uint64_t int_value)
+{
+    uint32_t bits = duskConstIntBits(type);
+    if (bits >= 64) return int_value;
+
+    uint64_t mask = (UINT64_C(1) << bits) - 1;
+    int_value &= mask;
+    if (duskConstIntIsSigned(type)) {
+        uint64_t sign_bit = UINT64_C(1) << (bits - 1);
+        int_value = (int_value ^ sign_bit) - sign_bit;
+    }
+    return int_value;
+}
+
+static DuskConstValue *
+duskConstInt(DuskAllocator *allocator, DuskType *type, uint64_t int_value)
+{
+    DuskConstValue *value = duskConstCreate(allocator, type);
+    value->int_value = duskConstWrapInt(type, int_value);
+    return value;
+}
+
+// Half floats are not folded, as they cannot be represented in the IR yet.
+// Results that are not finite are left for the target to compute as well.
+static DuskConstValue *
+duskConstFloat(DuskAllocator *allocator, DuskType *type, double float_value)
+{
+    if (type->kind == DUSK_TYPE_FLOAT) {
+        switch (type->float_.bits) {
+        case 32: float_value = (double)(float)float_value; break;
+        case 64: break;
+        default: return NULL;
+        }
+    }
+
+    if (!isfinite(float_value)) return NULL;
+
+    DuskConstValue *value = duskConstCreate(allocator, type);
+    value->float_value = float_value;
+    return value;
+}
+
+static DuskConstValue *
+duskConstBool(DuskAllocator *allocator, DuskType *type, bool bool_value)
+{
+    DuskConstValue *value = duskConstCreate(allocator, type);
+    value->bool_value = bool_value;
+    return value;
+}
+
+static double duskConstIntToDouble(DuskType *int_type, uint64_t int_value)
+{
+    if (duskConstIntIsSigned(int_type)) {
+        return (double)(int64_t)int_value;
+    }
+    return (double)int_value;
+}
+
+DuskConstValue *duskConstConvert(
+    DuskAllocator *allocator, DuskConstValue *value, DuskType *type)
+{
+    if (value->type == type) return value;
+
+    if (duskConstIsIntType(value->type)) {
+        if (duskConstIsIntType(type)) {
+            return duskConstInt(allocator, type, value->int_value);
+        }
+
+        if (duskConstIsFloatType(type)) {
+            // Converted straight to single precision to avoid rounding twice
+            if (type->kind == DUSK_TYPE_FLOAT && type->float_.bits == 32) {
+                float float_value =
+                    duskConstIntIsSigned(value->type)
+                        ? (float)(int64_t)value->int_value
+                        : (float)value->int_value;
+                return duskConstFloat(allocator, type, (double)float_value);
+            }
+            return duskConstFloat(
+                allocator,
+                type,
+                duskConstIntToDouble(value->type, value->int_value));
+        }
+    }
+
+    if (duskConstIsFloatType(value->type)) {
+        if (duskConstIsFloatType(type)) {
+            return duskConstFloat(allocator, type, value->float_value);
+        }
+
+        if (duskConstIsIntType(type)) {
+            // Conversions of values that don't fit in the integer type are
+            // undefined
+            double truncated = trunc(value->float_value);
+            uint32_t bits = duskConstIntBits(type);
+            if (duskConstIntIsSigned(type)) {
+                double limit = ldexp(1.0, (int)bits - 1);
+                if (truncated < -limit || truncated >= limit) return NULL;
+                return duskConstInt(
+                    allocator, type, (uint64_t)(int64_t)truncated);
+            }
+
+            double limit = ldexp(1.0, (int)bits);
+            if (truncated < 0.0 || truncated >= limit) return NULL;
+            return duskConstInt(allocator, type, (uint64_t)truncated);
+        }
+    }
+
+    return NULL;
+}
+
+bool duskConstToInteger(DuskConstValue *value, int64_t *out_int)
+{
+    if (!value || !duskConstIsIntType(value->type)) return false;
+    *out_int = (int64_t)value->int_value;
+    return true;
+}
+
+// Vectors and scalars of the same kind are often handled as arrays of
+// components, as there are at most 4 of them
+static size_t
+duskConstGetComponents(DuskConstValue *value, DuskConstValue *components[4])
+{
+    if (value->type->kind != DUSK_TYPE_VECTOR) {
+        components[0] = value;
+        return 1;
+    }
+
+    DUSK_ASSERT(value->composite.count <= 4);
+    for (size_t i = 0; i < value->composite.count; ++i) {
+        components[i] = value->composite.values[i];
+    }
+    return value->composite.count;
+}
+
+static DuskType *duskConstComponentType(DuskType *type)
+{
+    return type->kind == DUSK_TYPE_VECTOR ? type->vector.sub : type;
+}
+
+static DuskConstValue *duskConstFromFloats(
+    DuskAllocator *allocator, DuskType *type, size_t count, double *floats)
+{
+    DuskType *component_type = duskConstComponentType(type);
+    if (type->kind != DUSK_TYPE_VECTOR) {
+        DUSK_ASSERT(count == 1);
+        return duskConstFloat(allocator, component_type, floats[0]);
+    }
+
+    DUSK_ASSERT(count == type->vector.size);
+    DuskConstValue *value = duskConstCompositeCreate(allocator, type, count);
+    for (size_t i = 0; i < count; ++i) {
+        value->composite.values[i] =
+            duskConstFloat(allocator, component_type, floats[i]);
+        if (!value->composite.values[i]) return NULL;
+    }
+    return value;
+}
+
+static size_t duskConstGetFloats(DuskConstValue *value, double floats[4])
+{
+    DuskConstValue *components[4];
+    size_t count = duskConstGetComponents(value, components);
+    for (size_t i = 0; i < count; ++i) {
+        if (!duskConstIsFloatType(components[i]->type)) return 0;
+        floats[i] = components[i]->float_value;
+    }
+    return count;
+}
+
+static double duskConstDot(size_t count, double *a, double *b)
+{
+    double result = 0.0;
+    for (size_t i = 0; i < count; ++i) {
+        result += a[i] * b[i];
+    }
+    return result;
+}
+
+static bool duskConstScalarLess(DuskConstValue *left, DuskConstValue *right)
+{
+    if (duskConstIsFloatType(left->type)) {
+        return left->float_value < right->float_value;
+    }
+    if (duskConstIntIsSigned(left->type)) {
+        return (int64_t)left->int_value < (int64_t)right->int_value;
+    }
+    return left->int_value < right->int_value;
+}
+
+static DuskConstValue *duskConstScalarBinary(
+    DuskAllocator *allocator,
+    DuskBinaryOp op,
+    DuskType *type,
+    DuskConstValue *left,
+    DuskConstValue *right)
+{
+    if (duskConstIsFloatType(type)) {
+        double a = left->float_value;
+        double b = right->float_value;
+        switch (op) {
+        case DUSK_BINARY_OP_ADD: return duskConstFloat(allocator, type, a + b);
+        case DUSK_BINARY_OP_SUB: return duskConstFloat(allocator, type, a - b);
+        case DUSK_BINARY_OP_MUL: return duskConstFloat(allocator, type, a * b);
+        case DUSK_BINARY_OP_DIV: {
+            if (b == 0.0) return NULL;
+            return duskConstFloat(allocator, type, a / b);
+        }
+        default: return NULL;
+        }
+    }
+
+    if (!duskConstIsIntType(type)) return NULL;
+
+    uint64_t a = left->int_value;
+    uint64_t b = right->int_value;
+    uint32_t bits = duskConstIntBits(type);
+    bool is_signed = duskConstIntIsSigned(type);
+
+    // Signed division overflows for the minimum value divided by -1
+    bool is_min_div_minus_one =
+        is_signed && (int64_t)b == -1 &&
+        a == duskConstWrapInt(type, UINT64_C(1) << (bits - 1));
+
+    switch (op) {
+    case DUSK_BINARY_OP_ADD: return duskConstInt(allocator, type, a + b);
+    case DUSK_BINARY_OP_SUB: return duskConstInt(allocator, type, a - b);
+    case DUSK_BINARY_OP_MUL: return duskConstInt(allocator, type, a * b);
+    case DUSK_BINARY_OP_DIV: {
+        if (b == 0 || is_min_div_minus_one) return NULL;
+        if (is_signed) {
+            if ((int64_t)b == -1) return duskConstInt(allocator, type, 0 - a);
+            return duskConstInt(
+                allocator, type, (uint64_t)((int64_t)a / (int64_t)b));
+        }
+        return duskConstInt(allocator, type, a / b);
+    }
+    case DUSK_BINARY_OP_MOD: {
+        if (b == 0 || is_min_div_minus_one) return NULL;
+        if (is_signed) {
+            if ((int64_t)b == -1) return duskConstInt(allocator, type, 0);
+            // The result has the sign of the right operand, like OpSMod
+            int64_t result = (int64_t)a % (int64_t)b;
+            if (result != 0 && ((result < 0) != ((int64_t)b < 0))) {
+                result += (int64_t)b;
+            }
+            return duskConstInt(allocator, type, (uint64_t)result);
+        }
+        return duskConstInt(allocator, type, a % b);
+    }
+    case DUSK_BINARY_OP_BITAND: return duskConstInt(allocator, type, a & b);
+    case DUSK_BINARY_OP_BITOR: return duskConstInt(allocator, type, a | b);
+    case DUSK_BINARY_OP_BITXOR: return duskConstInt(allocator, type, a ^ b);
+    case DUSK_BINARY_OP_LSHIFT:
+    case DUSK_BINARY_OP_RSHIFT: {
+        // Shifting by the width of the type or more is undefined
+        if ((is_signed && (int64_t)b < 0) || b >= bits) return NULL;
+        if (op == DUSK_BINARY_OP_LSHIFT) {
+            return duskConstInt(allocator, type, a << b);
+        }
+        if (is_signed && (int64_t)a < 0) {
+            return duskConstInt(allocator, type, ~(~a >> b));
+        }
+        return duskConstInt(allocator, type, a >> b);
+    }
+    default: return NULL;
+    }
+}
+
+// Applies an operation to each component of vectors and matrices, with
+// scalar operands used for every component
+static DuskConstValue *duskConstComponentwise(
+    DuskAllocator *allocator,
+    DuskBinaryOp op,
+    DuskType *type,
+    DuskConstValue *left,
+    DuskConstValue *right)
+{
+    DuskType *sub_type = NULL;
+    switch (type->kind) {
+    case DUSK_TYPE_VECTOR: sub_type = type->vector.sub; break;
+    case DUSK_TYPE_MATRIX: sub_type = type->matrix.col_type; break;
+    default: return duskConstScalarBinary(allocator, op, type, left, right);
+    }
+
+    size_t count = type->kind == DUSK_TYPE_VECTOR ? type->vector.size
+                                                  : type->matrix.cols;
+    bool left_is_composite = left->type->kind == type->kind;
+    bool right_is_composite = right->type->kind == type->kind;
+    if ((left_is_composite && left->composite.count != count) ||
+        (right_is_composite && right->composite.count != count)) {
+        return NULL;
+    }
+
+    DuskConstValue *value = duskConstCompositeCreate(allocator, type, count);
+    for (size_t i = 0; i < count; ++i) {
+        value->composite.values[i] = duskConstComponentwise(
+            allocator,
+            op,
+            sub_type,
+            left_is_composite ? left->composite.values[i] : left,
+            right_is_composite ? right->composite.values[i] : right);
+        if (!value->composite.values[i]) return NULL;
+    }
+    return value;
+}
+
+// Multiplies a matrix by a column vector, returning a vector of the given type
+static DuskConstValue *duskConstMatrixTimesVector(
+    DuskAllocator *allocator,
+    DuskType *type,
+    DuskConstValue *matrix,
+    DuskConstValue *vector)
+{
+    size_t cols = matrix->composite.count;
+    if (vector->composite.count != cols || type->kind != DUSK_TYPE_VECTOR) {
+        return NULL;
+    }
+
+    double results[4] = {0};
+    for (size_t col = 0; col < cols; ++col) {
+        double column[4];
+        size_t rows = duskConstGetFloats(matrix->composite.values[col], column);
+        if (rows != type->vector.size) return NULL;
+        for (size_t row = 0; row < rows; ++row) {
+            results[row] += column[row] * vector->composite.values[col]
+                                              ->float_value;
+        }
+    }
+
+    return duskConstFromFloats(allocator, type, type->vector.size, results);
+}
+
+static DuskConstValue *duskConstBinary(
+    DuskAllocator *allocator,
+    DuskBinaryOp op,
+    DuskType *type,
+    DuskConstValue *left,
+    DuskConstValue *right)
+{
+    switch (op) {
+    case DUSK_BINARY_OP_EQ:
+    case DUSK_BINARY_OP_NOTEQ:
+    case DUSK_BINARY_OP_LESS:
+    case DUSK_BINARY_OP_LESSEQ:
+    case DUSK_BINARY_OP_GREATER:
+    case DUSK_BINARY_OP_GREATEREQ: {
+        if (type->kind != DUSK_TYPE_BOOL || duskConstIsComposite(left) ||
+            duskConstIsComposite(right)) {
+            return NULL;
+        }
+
+        if (left->type->kind == DUSK_TYPE_BOOL) {
+            if (right->type->kind != DUSK_TYPE_BOOL) return NULL;
+            switch (op) {
+            case DUSK_BINARY_OP_EQ:
+                return duskConstBool(
+                    allocator, type, left->bool_value == right->bool_value);
+            case DUSK_BINARY_OP_NOTEQ:
+                return duskConstBool(
+                    allocator, type, left->bool_value != right->bool_value);
+            default: return NULL;
+            }
+        }
+
+        // Values are never NaN, so ordered and unordered comparisons agree
+        bool equal = duskConstIsFloatType(left->type)
+                         ? left->float_value == right->float_value
+                         : left->int_value == right->int_value;
+        bool less = duskConstScalarLess(left, right);
+
+        bool result = false;
+        switch (op) {
+        case DUSK_BINARY_OP_EQ: result = equal; break;
+        case DUSK_BINARY_OP_NOTEQ: result = !equal; break;
+        case DUSK_BINARY_OP_LESS: result = less; break;
+        case DUSK_BINARY_OP_LESSEQ: result = less || equal; break;
+        case DUSK_BINARY_OP_GREATER: result = !less && !equal; break;
+        case DUSK_BINARY_OP_GREATEREQ: result = !less; break;
+        default: DUSK_ASSERT(0); break;
+        }
+        return duskConstBool(allocator, type, result);
+    }
+
+    case DUSK_BINARY_OP_AND:
+    case DUSK_BINARY_OP_OR: {
+        if (left->type->kind != DUSK_TYPE_BOOL ||
+            right->type->kind != DUSK_TYPE_BOOL) {
+            return NULL;
+        }
+        bool result = op == DUSK_BINARY_OP_AND
+                          ? left->bool_value && right->bool_value
+                          : left->bool_value || right->bool_value;
+        return duskConstBool(allocator, type, result);
+    }
+
+    case DUSK_BINARY_OP_MUL: {
+        if (left->type->kind == DUSK_TYPE_MATRIX &&
+            right->type->kind == DUSK_TYPE_VECTOR) {
+            return duskConstMatrixTimesVector(allocator, type, left, right);
+        }
+
+        if (left->type->kind == DUSK_TYPE_VECTOR &&
+            right->type->kind == DUSK_TYPE_MATRIX) {
+            // Each component of the result is the dot product of the vector
+            // and a column of the matrix
+            size_t cols = right->composite.count;
+            if (type->kind != DUSK_TYPE_VECTOR || type->vector.size != cols) {
+                return NULL;
+            }
+
+            double vector[4];
+            size_t rows = duskConstGetFloats(left, vector);
+            if (rows == 0) return NULL;
+            double results[4] = {0};
+            for (size_t col = 0; col < cols; ++col) {
+                double column[4];
+                if (duskConstGetFloats(right->composite.values[col], column) !=
+                    rows) {
+                    return NULL;
+                }
+                results[col] = duskConstDot(rows, vector, column);
+            }
+            return duskConstFromFloats(allocator, type, cols, results);
+        }
+
+        if (left->type->kind == DUSK_TYPE_MATRIX &&
+            right->type->kind == DUSK_TYPE_MATRIX) {
+            if (type->kind != DUSK_TYPE_MATRIX ||
+                type->matrix.cols != right->composite.count) {
+                return NULL;
+            }
+
+            DuskConstValue *value =
+                duskConstCompositeCreate(allocator, type, type->matrix.cols);
+            for (size_t col = 0; col < type->matrix.cols; ++col) {
+                value->composite.values[col] = duskConstMatrixTimesVector(
+                    allocator,
+                    type->matrix.col_type,
+                    left,
+                    right->composite.values[col]);
+                if (!value->composite.values[col]) return NULL;
+            }
+            return value;
+        }
+
+        return duskConstComponentwise(allocator, op, type, left, right);
+    }
+
+    case DUSK_BINARY_OP_MAX: return NULL;
+
+    default: return duskConstComponentwise(allocator, op, type, left, right);
+    }
+}
+
+static DuskConstValue *duskConstUnary(
+    DuskAllocator *allocator,
+    DuskUnaryOp op,
+    DuskType *type,
+    DuskConstValue *right)
+{
+    if (type->kind == DUSK_TYPE_VECTOR) {
+        if (right->type != type) return NULL;
+
+        DuskConstValue *value =
+            duskConstCompositeCreate(allocator, type, type->vector.size);
+        for (size_t i = 0; i < type->vector.size; ++i) {
+            value->composite.values[i] = duskConstUnary(
+                allocator, op, type->vector.sub, right->composite.values[i]);
+            if (!value->composite.values[i]) return NULL;
+        }
+        return value;
+    }
+
+    switch (op) {
+    case DUSK_UNARY_OP_NEGATE: {
+        if (duskConstIsFloatType(type)) {
+            return duskConstFloat(allocator, type, -right->float_value);
+        }
+        if (duskConstIsIntType(type)) {
+            return duskConstInt(allocator, type, 0 - right->int_value);
+        }
+        return NULL;
+    }
+    case DUSK_UNARY_OP_NOT: {
+        if (type->kind != DUSK_TYPE_BOOL) return NULL;
+        return duskConstBool(allocator, type, !right->bool_value);
+    }
+    case DUSK_UNARY_OP_BITNOT: {
+        if (!duskConstIsIntType(type)) return NULL;
+        return duskConstInt(allocator, type, ~right->int_value);
+    }
+    }
+
+    return NULL;
+}
+
+static bool duskConstApplyFloatFunction(
+    DuskBuiltinFunctionKind kind, double x, double *result)
+{
+    switch (kind) {
+    case DUSK_BUILTIN_FUNCTION_SIN: *result = sin(x); break;
+    case DUSK_BUILTIN_FUNCTION_COS: *result = cos(x); break;
+    case DUSK_BUILTIN_FUNCTION_TAN: *result = tan(x); break;
+    case DUSK_BUILTIN_FUNCTION_ASIN: *result = asin(x); break;
+    case DUSK_BUILTIN_FUNCTION_ACOS: *result = acos(x); break;
+    case DUSK_BUILTIN_FUNCTION_ATAN: *result = atan(x); break;
+    case DUSK_BUILTIN_FUNCTION_SINH: *result = sinh(x); break;
+    case DUSK_BUILTIN_FUNCTION_COSH: *result = cosh(x); break;
+    case DUSK_BUILTIN_FUNCTION_TANH: *result = tanh(x); break;
+    case DUSK_BUILTIN_FUNCTION_ASINH: *result = asinh(x); break;
+    case DUSK_BUILTIN_FUNCTION_ACOSH: *result = acosh(x); break;
+    case DUSK_BUILTIN_FUNCTION_ATANH: *result = atanh(x); break;
+    case DUSK_BUILTIN_FUNCTION_RADIANS:
+        *result = x * (DUSK_CONST_PI / 180.0);
+        break;
+    case DUSK_BUILTIN_FUNCTION_DEGREES:
+        *result = x * (180.0 / DUSK_CONST_PI);
+        break;
+    case DUSK_BUILTIN_FUNCTION_ROUND: {
+        // The direction in which halves are rounded is up to the target
+        if (fabs(x - trunc(x)) == 0.5) return false;
+        *result = round(x);
+        break;
+    }
+    case DUSK_BUILTIN_FUNCTION_TRUNC: *result = trunc(x); break;
+    case DUSK_BUILTIN_FUNCTION_FLOOR: *result = floor(x); break;
+    case DUSK_BUILTIN_FUNCTION_CEIL: *result = ceil(x); break;
+    case DUSK_BUILTIN_FUNCTION_FRACT: *result = x - floor(x); break;
+    case DUSK_BUILTIN_FUNCTION_SQRT: *result = sqrt(x); break;
+    case DUSK_BUILTIN_FUNCTION_INVERSE_SQRT: *result = 1.0 / sqrt(x); break;
+    case DUSK_BUILTIN_FUNCTION_LOG: *result = log(x); break;
+    case DUSK_BUILTIN_FUNCTION_LOG2: *result = log2(x); break;
+    case DUSK_BUILTIN_FUNCTION_EXP: *result = exp(x); break;
+    case DUSK_BUILTIN_FUNCTION_EXP2: *result = exp2(x); break;
+    case DUSK_BUILTIN_FUNCTION_ABS: *result = fabs(x); break;
+    default: return false;
+    }
+
+    return true;
+}
+
+// Abs, min, max and clamp of integers, component by component
+static DuskConstValue *duskConstIntBuiltin(
+    DuskAllocator *allocator,
+    DuskBuiltinFunctionKind kind,
+    DuskType *type,
+    size_t param_count,
+    DuskConstValue **params)
+{
+    DuskConstValue *components[3][4];
+    size_t count = 0;
+    for (size_t i = 0; i < param_count; ++i) {
+        count = duskConstGetComponents(params[i], components[i]);
+    }
+
+    DuskType *component_type = duskConstComponentType(type);
+    DuskConstValue *results[4];
+    for (size_t i = 0; i < count; ++i) {
+        DuskConstValue *x = components[0][i];
+        switch (kind) {
+        case DUSK_BUILTIN_FUNCTION_ABS: {
+            results[i] = x;
+            if (duskConstIntIsSigned(component_type) &&
+                (int64_t)x->int_value < 0) {
+                results[i] =
+                    duskConstInt(allocator, component_type, 0 - x->int_value);
+            }
+            break;
+        }
+        case DUSK_BUILTIN_FUNCTION_MIN: {
+            DuskConstValue *y = components[1][i];
+            results[i] = duskConstScalarLess(y, x) ? y : x;
+            break;
+        }
+        case DUSK_BUILTIN_FUNCTION_MAX: {
+            DuskConstValue *y = components[1][i];
+            results[i] = duskConstScalarLess(x, y) ? y : x;
+            break;
+        }
+        case DUSK_BUILTIN_FUNCTION_CLAMP: {
+            DuskConstValue *min_value = components[1][i];
+            DuskConstValue *max_value = components[2][i];
+            // Undefined if the bounds are reversed
+            if (duskConstScalarLess(max_value, min_value)) return NULL;
+            results[i] = x;
+            if (duskConstScalarLess(x, min_value)) results[i] = min_value;
+            if (duskConstScalarLess(max_value, x)) results[i] = max_value;
+            break;
+        }
+        default: return NULL;
+        }
+    }
+
+    if (type->kind != DUSK_TYPE_VECTOR) return results[0];
+
+    DuskConstValue *value = duskConstCompositeCreate(allocator, type, count);
+    for (size_t i = 0; i < count; ++i) {
+        value->composite.values[i] = results[i];
+    }
+    return value;
+}
+
+static DuskConstValue *duskConstBuiltin(
+    DuskAllocator *allocator,
+    DuskBuiltinFunctionKind kind,
+    DuskType *type,
+    size_t param_count,
+    DuskConstValue **params)
+{
+    if (param_count == 0 || param_count > 3) return NULL;
+    for (size_t i = 0; i < param_count; ++i) {
+        if (params[i]->type->kind != DUSK_TYPE_VECTOR &&
+            !duskConstIsIntType(params[i]->type) &&
+            !duskConstIsFloatType(params[i]->type)) {
+            return NULL;
+        }
+    }
+
+    if (duskConstIsIntType(duskConstComponentType(params[0]->type))) {
+        return duskConstIntBuiltin(allocator, kind, type, param_count, params);
+    }
+
+    double x[4] = {0}, y[4] = {0}, z[4] = {0};
+    size_t count = duskConstGetFloats(params[0], x);
+    if (count == 0) return NULL;
+    if (param_count > 1 && duskConstGetFloats(params[1], y) == 0) return NULL;
+    if (param_count > 2 && duskConstGetFloats(params[2], z) == 0) return NULL;
+
+    double results[4] = {0};
+    size_t result_count = count;
+
+    switch (kind) {
+    case DUSK_BUILTIN_FUNCTION_DOT: {
+        results[0] = duskConstDot(count, x, y);
+        result_count = 1;
+        break;
+    }
+    case DUSK_BUILTIN_FUNCTION_LENGTH: {
+        results[0] = sqrt(duskConstDot(count, x, x));
+        result_count = 1;
+        break;
+    }
+    case DUSK_BUILTIN_FUNCTION_DISTANCE: {
+        for (size_t i = 0; i < count; ++i) {
+            x[i] -= y[i];
+        }
+        results[0] = sqrt(duskConstDot(count, x, x));
+        result_count = 1;
+        break;
+    }
+    case DUSK_BUILTIN_FUNCTION_NORMALIZE: {
+        double length = sqrt(duskConstDot(count, x, x));
+        if (length == 0.0) return NULL;
+        for (size_t i = 0; i < count; ++i) {
+            results[i] = x[i] / length;
+        }
+        break;
+    }
+    case DUSK_BUILTIN_FUNCTION_CROSS: {
+        if (count != 3) return NULL;
+        results[0] = x[1] * y[2] - y[1] * x[2];
+        results[1] = x[2] * y[0] - y[2] * x[0];
+        results[2] = x[0] * y[1] - y[0] * x[1];
+        break;
+    }
+    case DUSK_BUILTIN_FUNCTION_REFLECT: {
+        double d = duskConstDot(count, y, x);
+        for (size_t i = 0; i < count; ++i) {
+            results[i] = x[i] - 2.0 * d * y[i];
+        }
+        break;
+    }
+    case DUSK_BUILTIN_FUNCTION_REFRACT: {
+        double eta = z[0];
+        double d = duskConstDot(count, y, x);
+        double k = 1.0 - eta * eta * (1.0 - d * d);
+        for (size_t i = 0; i < count; ++i) {
+            results[i] = k < 0.0 ? 0.0 : eta * x[i] - (eta * d + sqrt(k)) * y[i];
+        }
+        break;
+    }
+    case DUSK_BUILTIN_FUNCTION_MIN: {
+        for (size_t i = 0; i < count; ++i) {
+            results[i] = fmin(x[i], y[i]);
+        }
+        break;
+    }
+    case DUSK_BUILTIN_FUNCTION_MAX: {
+        for (size_t i = 0; i < count; ++i) {
+            results[i] = fmax(x[i], y[i]);
+        }
+        break;
+    }
+    case DUSK_BUILTIN_FUNCTION_CLAMP: {
+        for (size_t i = 0; i < count; ++i) {
+            if (z[i] < y[i]) return NULL;
+            results[i] = fmin(fmax(x[i], y[i]), z[i]);
+        }
+        break;
+    }
+    case DUSK_BUILTIN_FUNCTION_MIX: {
+        for (size_t i = 0; i < count; ++i) {
+            results[i] = x[i] * (1.0 - z[i]) + y[i] * z[i];
+        }
+        break;
+    }
+    default: {
+        for (size_t i = 0; i < count; ++i) {
+            if (!duskConstApplyFloatFunction(kind, x[i], &results[i])) {
+                return NULL;
+            }
+        }
+        break;
+    }
+    }
+
+    if ((type->kind == DUSK_TYPE_VECTOR ? type->vector.size : 1) !=
+        result_count) {
+        return NULL;
+    }
+    return duskConstFromFloats(allocator, type, result_count, results);
+}
+
+static DuskConstValue *duskConstConstruct(
+    DuskAllocator *allocator,
+    DuskType *type,
+    size_t param_count,
+    DuskConstValue **params)
+{
+    switch (type->kind) {
+    case DUSK_TYPE_INT:
+    case DUSK_TYPE_FLOAT: {
+        if (param_count != 1) return NULL;
+        return duskConstConvert(allocator, params[0], type);
+    }
+    case DUSK_TYPE_VECTOR: {
+        DuskConstValue *value =
+            duskConstCompositeCreate(allocator, type, type->vector.size);
+
+        // A single scalar is used for every component
+        if (param_count == 1 && params[0]->type == type->vector.sub) {
+            for (size_t i = 0; i < type->vector.size; ++i) {
+                value->composite.values[i] = params[0];
+            }
+            return value;
+        }
+
+        size_t count = 0;
+        for (size_t i = 0; i < param_count; ++i) {
+            DuskConstValue *components[4];
+            size_t component_count =
+                duskConstGetComponents(params[i], components);
+            for (size_t j = 0; j < component_count; ++j) {
+                if (count == type->vector.size ||
+                    components[j]->type != type->vector.sub) {
+                    return NULL;
+                }
+                value->composite.values[count++] = components[j];
+            }
+        }
+
+        if (count != type->vector.size) return NULL;
+        return value;
+    }
+    case DUSK_TYPE_MATRIX: {
+        if (param_count != 1 && param_count != type->matrix.cols) return NULL;
+
+        DuskConstValue *value =
+            duskConstCompositeCreate(allocator, type, type->matrix.cols);
+        for (size_t i = 0; i < type->matrix.cols; ++i) {
+            DuskConstValue *column = params[param_count == 1 ? 0 : i];
+            if (column->type != type->matrix.col_type) return NULL;
+            value->composite.values[i] = column;
+        }
+        return value;
+    }
+    default: return NULL;
+    }
+}
+
+static DuskConstValue *duskConstAccess(
+    DuskCompiler *compiler, DuskAllocator *allocator, DuskExpr *expr)
+{
+    DuskConstValue *value =
+        duskConstEvaluate(compiler, allocator, expr->access.base_expr);
+    if (!value) return NULL;
+
+    for (size_t i = 0; i < duskArrayLength(expr->access.chain_arr); ++i) {
+        DuskExprId field_expr_id = expr->access.chain_arr[i];
+        DuskExpr *field_expr = duskExprGet(compiler, field_expr_id);
+        DuskType *field_type = compiler->expr_types_arr[field_expr_id];
+        if (field_expr->kind != DUSK_EXPR_IDENT || !field_type) {
+            return NULL;
+        }
+
+        switch (value->type->kind) {
+        case DUSK_TYPE_VECTOR: {
+            DuskArray(uint32_t) indices_arr =
+                field_expr->identifier.shuffle_indices_arr;
+            size_t index_count = duskArrayLength(indices_arr);
+            for (size_t j = 0; j < index_count; ++j) {
+                if (indices_arr[j] >= value->composite.count) return NULL;
+            }
+
+            if (index_count == 1) {
+                value = value->composite.values[indices_arr[0]];
+            } else if (index_count > 1) {
+                DuskConstValue *shuffled = duskConstCompositeCreate(
+                    allocator, field_type, index_count);
+                for (size_t j = 0; j < index_count; ++j) {
+                    shuffled->composite.values[j] =
+                        value->composite.values[indices_arr[j]];
+                }
+                value = shuffled;
+            } else {
+                return NULL;
+            }
+            break;
+        }
+        case DUSK_TYPE_STRUCT: {
+            uintptr_t field_index = 0;
+            if (!duskMapGet(
+                    value->type->struct_.index_map,
+                    field_expr->identifier.str,
+                    (void *)&field_index)) {
+                return NULL;
+            }
+            value = value->composite.values[field_index];
+            break;
+        }
+        default: return NULL;
+        }
+
+        if (value->type != field_type) return NULL;
+    }
+
+    return value;
+}
+
+static DuskConstValue *duskConstArrayAccess(
+    DuskCompiler *compiler,
+    DuskAllocator *allocator,
+    DuskExpr *expr,
+    DuskType *type)
+{
+    DuskConstValue *value =
+        duskConstEvaluate(compiler, allocator, expr->access.base_expr);
+    if (!value) return NULL;
+
+    for (size_t i = 0; i < duskArrayLength(expr->access.chain_arr); ++i) {
+        if (!duskConstIsComposite(value) ||
+            value->type->kind == DUSK_TYPE_STRUCT) {
+            return NULL;
+        }
+
+        DuskConstValue *index_value =
+            duskConstEvaluate(compiler, allocator, expr->access.chain_arr[i]);
+        if (!index_value || !duskConstIsIntType(index_value->type)) {
+            return NULL;
+        }
+
+        // Out of bounds accesses are left to the target
+        uint64_t index = index_value->int_value;
+        if (duskConstIntIsSigned(index_value->type) && (int64_t)index < 0) {
+            return NULL;
+        }
+        if (index >= value->composite.count) return NULL;
+
+        value = value->composite.values[index];
+    }
+
+    if (value->type != type) return NULL;
+    return value;
+}
+
+static bool duskConstEvaluateParams(
+    DuskCompiler *compiler,
+    DuskAllocator *allocator,
+    DuskArray(DuskExprId) params_arr,
+    DuskConstValue **params)
+{
+    for (size_t i = 0; i < duskArrayLength(params_arr); ++i) {
+        params[i] = duskConstEvaluate(compiler, allocator, params_arr[i]);
+        if (!params[i]) return false;
+    }
+    return duskArrayLength(params_arr) > 0;
+}
+
+static DuskConstValue *duskConstEvaluateExpr(
+    DuskCompiler *compiler, DuskAllocator *allocator, DuskExprId expr_id)
+{
+    DuskExpr *expr = duskExprGet(compiler, expr_id);
+    DuskType *type = compiler->expr_types_arr[expr_id];
+
+    switch (expr->kind) {
+    case DUSK_EXPR_INT_LITERAL: {
+        if (duskConstIsFloatType(type)) {
+            return duskConstFloat(allocator, type, (double)expr->int_literal);
+        }
+        if (!duskConstIsIntType(type)) return NULL;
+        return duskConstInt(allocator, type, (uint64_t)expr->int_literal);
+    }
+    case DUSK_EXPR_FLOAT_LITERAL: {
+        if (!duskConstIsFloatType(type)) return NULL;
+        return duskConstFloat(allocator, type, expr->float_literal);
+    }
+    case DUSK_EXPR_BOOL_LITERAL: {
+        return duskConstBool(allocator, type, expr->bool_literal);
+    }
+
+    case DUSK_EXPR_STRUCT_LITERAL: {
+        if (type->kind != DUSK_TYPE_STRUCT) return NULL;
+
+        size_t field_count = type->struct_.field_count;
+        if (duskArrayLength(expr->struct_literal.field_values_arr) !=
+            field_count) {
+            return NULL;
+        }
+
+        DuskConstValue *value =
+            duskConstCompositeCreate(allocator, type, field_count);
+        for (size_t i = 0; i < field_count; ++i) {
+            uintptr_t index = 0;
+            if (!duskMapGet(
+                    type->struct_.index_map,
+                    expr->struct_literal.field_names_arr[i],
+                    (void *)&index) ||
+                value->composite.values[index]) {
+                return NULL;
+            }
+
+            value->composite.values[index] = duskConstEvaluate(
+                compiler, allocator, expr->struct_literal.field_values_arr[i]);
+            if (!value->composite.values[index]) return NULL;
+        }
+        return value;
+    }
+    case DUSK_EXPR_ARRAY_LITERAL: {
+        if (type->kind != DUSK_TYPE_ARRAY) return NULL;
+
+        size_t count = duskArrayLength(expr->array_literal.field_values_arr);
+        if (count != type->array.size) return NULL;
+
+        DuskConstValue *value = duskConstCompositeCreate(allocator, type, count);
+        for (size_t i = 0; i < count; ++i) {
+            value->composite.values[i] = duskConstEvaluate(
+                compiler, allocator, expr->array_literal.field_values_arr[i]);
+            if (!value->composite.values[i]) return NULL;
+        }
+        return value;
+    }
+
+    case DUSK_EXPR_IDENT: {
+        if (!expr->identifier.decl) return NULL;
+        DuskDecl *decl = duskDeclGet(compiler, expr->identifier.decl);
+        if (decl->kind != DUSK_DECL_CONST || !decl->const_.value) {
+            return NULL;
+        }
+
+        // Untyped constants take the type their uses are concretized to
+        return duskConstConvert(allocator, decl->const_.value, type);
+    }
+
+    case DUSK_EXPR_FUNCTION_CALL: {
+        DuskExprId func_expr = expr->function_call.func_expr;
+        DuskType *func_type = compiler->expr_types_arr[func_expr];
+        if (!func_type || func_type->kind != DUSK_TYPE_TYPE ||
+            compiler->expr_as_types_arr[func_expr] != type) {
+            return NULL;
+        }
+
+        size_t param_count = duskArrayLength(expr->function_call.params_arr);
+        DuskConstValue **params =
+            DUSK_NEW_ARRAY(allocator, DuskConstValue *, param_count);
+        if (!duskConstEvaluateParams(
+                compiler, allocator, expr->function_call.params_arr, params)) {
+            return NULL;
+        }
+
+        return duskConstConstruct(allocator, type, param_count, params);
+    }
+
+    case DUSK_EXPR_BUILTIN_FUNCTION_CALL: {
+        DuskConstValue *params[3];
+        size_t param_count = duskArrayLength(expr->builtin_call.params_arr);
+        if (param_count > DUSK_CARRAY_LENGTH(params) ||
+            !duskConstEvaluateParams(
+                compiler, allocator, expr->builtin_call.params_arr, params)) {
+            return NULL;
+        }
+
+        return duskConstBuiltin(
+            allocator, expr->builtin_call.kind, type, param_count, params);
+    }
+
+    case DUSK_EXPR_ACCESS: return duskConstAccess(compiler, allocator, expr);
+    case DUSK_EXPR_ARRAY_ACCESS: {
+        return duskConstArrayAccess(compiler, allocator, expr, type);
+    }
+
+    case DUSK_EXPR_BINARY: {
+        DuskConstValue *left =
+            duskConstEvaluate(compiler, allocator, expr->binary.left);
+
+        // The right operand of a short-circuiting operation is not evaluated
+        // when the left one decides the result
+        if (left && left->type->kind == DUSK_TYPE_BOOL &&
+            ((expr->binary.op == DUSK_BINARY_OP_AND && !left->bool_value) ||
+             (expr->binary.op == DUSK_BINARY_OP_OR && left->bool_value))) {
+            return duskConstBool(allocator, type, left->bool_value);
+        }
+
+        DuskConstValue *right =
+            duskConstEvaluate(compiler, allocator, expr->binary.right);
+        if (!left || !right) return NULL;
+
+        return duskConstBinary(allocator, expr->binary.op, type, left, right);
+    }
+
+    case DUSK_EXPR_UNARY: {
+        DuskConstValue *right =
+            duskConstEvaluate(compiler, allocator, expr->unary.right);
+        if (!right) return NULL;
+        return duskConstUnary(allocator, expr->unary.op, type, right);
+    }
+
+    case DUSK_EXPR_VOID_TYPE:
+    case DUSK_EXPR_BOOL_TYPE:
+    case DUSK_EXPR_PTR_TYPE:
+    case DUSK_EXPR_SCALAR_TYPE:
+    case DUSK_EXPR_VECTOR_TYPE:
+    case DUSK_EXPR_MATRIX_TYPE:
+    case DUSK_EXPR_STRING_LITERAL:
+    case DUSK_EXPR_STRUCT_TYPE:
+    case DUSK_EXPR_ARRAY_TYPE:
+    case DUSK_EXPR_RUNTIME_ARRAY_TYPE: return NULL;
+    }
+
+    return NULL;
+}
+
+// Stands for the expressions that were evaluated and found not to be constant
+// in expr_const_values_arr
+static DuskConstValue DUSK_CONST_NOT_CONSTANT;
+
+DuskConstValue *duskConstEvaluate(
+    DuskCompiler *compiler, DuskAllocator *allocator, DuskExprId expr_id)
+{
+    DuskConstValue *value = compiler->expr_const_values_arr[expr_id];
+    if (!value) {
+        if (compiler->expr_types_arr[expr_id]) {
+            value = duskConstEvaluateExpr(compiler, allocator, expr_id);
+        }
+        if (!value) value = &DUSK_CONST_NOT_CONSTANT;
+        compiler->expr_const_values_arr[expr_id] = value;
+    }
+    return value != &DUSK_CONST_NOT_CONSTANT ? value : NULL;
+}
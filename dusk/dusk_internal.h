@@ -77,6 +77,50 @@ duskArenaCreate(DuskAllocator *parent_allocator, size_t default_size);
 DuskAllocator *duskArenaGetAllocator(DuskArena *arena);
 void duskArenaDestroy(DuskArena *arena);
 
+#define DUSK_POOL_CHUNK_SHIFT 8
+#define DUSK_POOL_CHUNK_ITEMS (1 << DUSK_POOL_CHUNK_SHIFT)
+
+// Hands out fixed size items addressed by 32-bit ids, in chunks of
+// DUSK_POOL_CHUNK_ITEMS items taken from another allocator, so that items
+// allocated one after the other end up next to each other in memory without
+// any per-item header. Items are zeroed, never move and can't be freed
+// individually. Id zero is never handed out.
+typedef struct DuskPool {
+    DuskAllocator *allocator;
+    size_t item_size;
+    // Chunks by the upper bits of their ids, shared with the pools that take
+    // their ids from this one
+    uint8_t **chunks;
+    uint32_t chunk_capacity;
+    uint32_t next_id;
+    uint32_t end_id;
+    // Set on pools used by worker threads, which take a chunk of ids at a
+    // time from the owner, under its mutex
+    struct DuskPool *owner;
+    struct DuskMutex *mutex;
+} DuskPool;
+
+void duskPoolInit(DuskPool *pool, DuskAllocator *allocator, size_t item_size);
+// Makes pool take its ids from owner and allocate its chunks from allocator.
+// Pools that share an owner can be used by different threads at the same
+// time, as long as the owner itself isn't used.
+void duskPoolInitShared(
+    DuskPool *pool,
+    DuskPool *owner,
+    DuskAllocator *allocator,
+    struct DuskMutex *mutex);
+// Makes room for chunk_count more chunks, which has to be done before the ids
+// of the pool are shared since the shared pools can't make room themselves
+void duskPoolReserveChunks(DuskPool *pool, uint32_t chunk_count);
+// Returns zero if the pool has run out of ids
+uint32_t duskPoolAllocate(DuskPool *pool);
+
+static inline void *duskPoolGet(const DuskPool *pool, uint32_t id)
+{
+    return pool->chunks[id >> DUSK_POOL_CHUNK_SHIFT] +
+           (size_t)(id & (DUSK_POOL_CHUNK_ITEMS - 1)) * pool->item_size;
+}
+
 const char *duskStrdup(DuskAllocator *allocator, const char *str);
 const char *
 duskNullTerminate(DuskAllocator *allocator, const char *str, size_t length);
@@ -212,21 +256,55 @@ void duskStringBuilderAppendFormat(
 char *duskStringBuilderBuild(DuskStringBuilder *sb, DuskAllocator *allocator);
 // }}}
 
+// Thread {{{
+typedef struct DuskThread DuskThread;
+
+// Returns NULL if the thread could not be created
+DuskThread *duskThreadCreate(
+    DuskAllocator *allocator, void (*func)(void *user_data), void *user_data);
+void duskThreadJoin(DuskThread *thread);
+
+typedef struct DuskMutex DuskMutex;
+
+// Returns NULL if the mutex could not be created
+DuskMutex *duskMutexCreate(DuskAllocator *allocator);
+void duskMutexDestroy(DuskMutex *mutex);
+void duskMutexLock(DuskMutex *mutex);
+void duskMutexUnlock(DuskMutex *mutex);
+
+// Must be zero initialized, usually by being static
+typedef struct DuskOnce {
+    volatile long state;
+} DuskOnce;
+
+// Calls func the first time it's called with once, other threads calling it
+// at the same time wait for func to return
+void duskCallOnce(DuskOnce *once, void (*func)(void));
+
+uint32_t duskGetProcessorCount(void);
+// }}}
+
 // Typedefs {{{
 typedef struct DuskFile DuskFile;
 
 typedef struct DuskDecl DuskDecl;
 typedef struct DuskStmt DuskStmt;
 typedef struct DuskExpr DuskExpr;
+// AST nodes are kept in one pool per kind and refer to each other by their ids
+// in those pools, zero meaning no node
+typedef uint32_t DuskDeclId;
+typedef uint32_t DuskStmtId;
+typedef uint32_t DuskExprId;
+typedef struct DuskConstValue DuskConstValue;
 
 typedef struct DuskIRValue DuskIRValue;
 
 typedef struct DuskLocation {
     DuskFile *file;
-    size_t offset;
-    size_t length;
-    size_t line;
-    size_t col;
+    uint32_t offset;
+    uint32_t length;
+    uint32_t line;
+    uint32_t col;
 } DuskLocation;
 
 typedef enum DuskShaderStage {
@@ -275,11 +353,13 @@ typedef enum DuskScopeOwnerType {
 typedef struct DuskScope {
     DuskScopeOwnerType type;
     struct DuskScope *parent;
+    DuskAllocator *allocator;
+    // Created on the first declaration, as most block scopes don't have any
     DuskMap *map;
     union {
-        DuskDecl *decl;
-        DuskExpr *expr;
-        DuskStmt *stmt;
+        DuskDeclId decl;
+        DuskExprId expr;
+        DuskStmtId stmt;
     } owner;
 } DuskScope;
 
@@ -287,9 +367,10 @@ DuskScope *duskScopeCreate(
     DuskAllocator *allocator,
     DuskScope *parent,
     DuskScopeOwnerType type,
-    void *owner);
-DuskDecl *duskScopeLookup(DuskScope *scope, const char *name);
-void duskScopeSet(DuskScope *scope, const char *name, DuskDecl *decl);
+    uint32_t owner);
+DuskDeclId duskScopeLookupLocal(DuskScope *scope, const char *name);
+DuskDeclId duskScopeLookup(DuskScope *scope, const char *name);
+void duskScopeSet(DuskScope *scope, const char *name, DuskDeclId decl_id);
 // }}}
 
 // Type {{{
@@ -319,13 +400,17 @@ typedef enum DuskAttributeKind {
     DUSK_ATTRIBUTE_BUILTIN,
     DUSK_ATTRIBUTE_OFFSET,
     DUSK_ATTRIBUTE_READ_ONLY,
+    DUSK_ATTRIBUTE_INLINE,
+    DUSK_ATTRIBUTE_NOINLINE,
+    DUSK_ATTRIBUTE_UNROLL,
+    DUSK_ATTRIBUTE_DONT_UNROLL,
 } DuskAttributeKind;
 
 typedef struct DuskAttribute {
     DuskAttributeKind kind;
     const char *name;
     size_t value_expr_count;
-    DuskExpr **value_exprs;
+    DuskExprId *value_exprs;
 } DuskAttribute;
 
 typedef enum DuskImageDimension {
@@ -354,6 +439,8 @@ typedef enum DuskStructLayout {
     DUSK_STRUCT_LAYOUT_STD430,
 } DuskStructLayout;
 
+#define DUSK_STRUCT_LAYOUT_COUNT 3
+
 typedef enum DuskTypeKind {
     DUSK_TYPE_VOID,
     DUSK_TYPE_TYPE,
@@ -377,11 +464,19 @@ typedef enum DuskTypeKind {
 
 typedef struct DuskType DuskType;
 
+// Builtin types are shared by every compiler in the process and never
+// modified. What compilers and modules need to know about a type is stored by
+// them, indexed by the type's index.
 struct DuskType {
     DuskTypeKind kind;
-    uint32_t id;
-    bool emit; // This flag is set before SPIRV emission in order to emit the
-               // type. Once the type is emitted, the flag is set to false.
+    // Builtin types come first, followed by the types created by the compiler
+    uint32_t index;
+    // Memoized by duskTypeSizeOf and duskTypeAlignOf for each layout, with
+    // one bit per layout telling whether the value was computed
+    uint32_t sizes[DUSK_STRUCT_LAYOUT_COUNT];
+    uint32_t alignments[DUSK_STRUCT_LAYOUT_COUNT];
+    uint8_t computed_sizes;
+    uint8_t computed_alignments;
     const char *string;
     const char *pretty_string;
     DuskArray(DuskIRDecoration) decorations_arr;
@@ -405,7 +500,6 @@ struct DuskType {
         struct {
             DuskType *sub;
             size_t size;
-            DuskIRValue *size_ir_value;
             DuskStructLayout layout;
         } array;
         struct {
@@ -443,6 +537,29 @@ struct DuskType {
     };
 };
 
+// Interns types by their structure. Child types are interned as well, so they
+// are hashed and compared by pointer.
+typedef struct DuskTypeCacheSlot {
+    uint64_t hash;
+    DuskType *type;
+} DuskTypeCacheSlot;
+
+typedef struct DuskTypeCache {
+    DuskAllocator *allocator;
+    DuskTypeCacheSlot *slots;
+    uint64_t size;
+    uint64_t count;
+} DuskTypeCache;
+
+void duskTypeCacheInit(
+    DuskTypeCache *cache, DuskAllocator *allocator, size_t size);
+// Number of builtin types shared by every compiler, the first type created by
+// a compiler has this index
+uint32_t duskTypeBuiltinCount(void);
+// Returns the interned type that is structurally equal to key, or NULL
+DuskType *duskTypeCacheGet(DuskTypeCache *cache, DuskType *key);
+void duskTypeCacheAdd(DuskTypeCache *cache, DuskType *type);
+
 bool duskTypeIsRuntime(DuskType *type);
 DuskType *duskGetScalarType(DuskType *type);
 
@@ -500,7 +617,16 @@ DuskType *duskTypeNewImage(
     bool sampled);
 DuskType *duskTypeNewSampledImage(DuskCompiler *compiler, DuskType *image_type);
 
-void duskTypeMarkNotDead(DuskType *type);
+// Marks the type and the types it uses to be emitted
+void duskTypeMarkNotDead(DuskCompiler *compiler, DuskType *type);
+// Puts the types created since first_new_type in the order in which the
+// requested arrays first asked for them, no matter which order they were
+// actually created in
+void duskTypeOrderNew(
+    DuskCompiler *compiler,
+    size_t first_new_type,
+    size_t requested_count,
+    DuskArray(DuskType *) * requested_arrs);
 // }}}
 
 // IR {{{
@@ -617,6 +743,22 @@ typedef struct DuskIRPhiPair {
     DuskIRValue *value;
 } DuskIRPhiPair;
 
+// Whether calls to a function are inlined
+typedef enum DuskIRInlineHint {
+    // Decided by the size of the function and by how often it is called
+    DUSK_IR_INLINE_DEFAULT,
+    DUSK_IR_INLINE_ALWAYS,
+    DUSK_IR_INLINE_NEVER,
+} DuskIRInlineHint;
+
+// Whether a loop is unrolled
+typedef enum DuskIRUnrollHint {
+    // Decided by the trip count of the loop and by the size of its body
+    DUSK_IR_UNROLL_DEFAULT,
+    DUSK_IR_UNROLL_ALWAYS,
+    DUSK_IR_UNROLL_NEVER,
+} DuskIRUnrollHint;
+
 typedef enum DuskIRValueKind {
     DUSK_IR_VALUE_CONSTANT_BOOL,
     DUSK_IR_VALUE_CONSTANT,
@@ -627,11 +769,13 @@ typedef enum DuskIRValueKind {
     DUSK_IR_VALUE_VARIABLE,
     DUSK_IR_VALUE_RETURN,
     DUSK_IR_VALUE_DISCARD,
+    DUSK_IR_VALUE_UNREACHABLE,
     DUSK_IR_VALUE_STORE,
     DUSK_IR_VALUE_LOAD,
     DUSK_IR_VALUE_FUNCTION_CALL,
     DUSK_IR_VALUE_ACCESS_CHAIN,
     DUSK_IR_VALUE_COMPOSITE_EXTRACT,
+    DUSK_IR_VALUE_COMPOSITE_INSERT,
     DUSK_IR_VALUE_VECTOR_SHUFFLE,
     DUSK_IR_VALUE_COMPOSITE_CONSTRUCT,
     DUSK_IR_VALUE_CAST,
@@ -651,7 +795,6 @@ struct DuskIRValue {
     DuskIRValueKind kind;
     const char *name;
     DuskType *type;
-    const char *const_string;
     bool emitted;
     DuskArray(DuskIRDecoration) decorations_arr;
 
@@ -671,6 +814,7 @@ struct DuskIRValue {
             DuskArray(DuskIRValue *) params_arr;
             DuskArray(DuskIRValue *) variables_arr;
             DuskArray(DuskIRValue *) blocks_arr;
+            DuskIRInlineHint inline_hint;
         } function;
         struct {
             DuskStorageClass storage_class;
@@ -700,6 +844,11 @@ struct DuskIRValue {
             DuskIRValue *composite;
             DuskArray(uint32_t) indices_arr;
         } composite_extract;
+        struct {
+            DuskIRValue *composite;
+            DuskIRValue *object;
+            DuskArray(uint32_t) indices_arr;
+        } composite_insert;
         struct {
             DuskIRValue *vec1;
             DuskIRValue *vec2;
@@ -739,6 +888,9 @@ struct DuskIRValue {
         struct {
             DuskIRValue *merge_block;
             DuskIRValue *continue_block;
+            DuskIRUnrollHint unroll_hint;
+            // Number of iterations to unroll by, 0 if it isn't given
+            uint32_t unroll_count;
         } loop_merge;
         struct {
             DuskIRPhiPair *pairs;
@@ -751,6 +903,36 @@ struct DuskIRValue {
     };
 };
 
+// Interns constants by their type and value bits. The elements of composite
+// constants are interned too, so they are hashed and compared by pointer.
+typedef struct DuskIRConstCacheSlot {
+    uint64_t hash;
+    DuskIRValue *value;
+} DuskIRConstCacheSlot;
+
+typedef struct DuskIRConstCache {
+    DuskIRConstCacheSlot *slots;
+    uint64_t size;
+    uint64_t count;
+} DuskIRConstCache;
+
+// What a module knows about a type
+typedef struct DuskIRTypeInfo {
+    // Zero if the module doesn't emit the type
+    uint32_t id;
+    bool emitted;
+    // Length operand of array types
+    DuskIRValue *array_size;
+} DuskIRTypeInfo;
+
+// What the IR generation made out of a declaration
+typedef struct DuskIRDeclInfo {
+    DuskIRValue *value;
+    DuskIREntryPoint *entry_point;
+    DuskArray(DuskIRValue *) entry_point_inputs_arr;
+    DuskArray(DuskIRValue *) entry_point_outputs_arr;
+} DuskIRDeclInfo;
+
 typedef struct DuskIRModule {
     DuskCompiler *compiler;
     DuskAllocator *allocator;
@@ -759,8 +941,17 @@ typedef struct DuskIRModule {
     DuskArray(uint32_t) capabilities_arr;
     uint32_t last_id;
 
-    DuskMap *const_cache;
+    // Indexed by type index, set up when the module is emitted
+    DuskIRTypeInfo *type_infos;
+
+    DuskIRConstCache const_cache;
     DuskArray(DuskIRValue *) consts_arr;
+    // Set on the copies of the module used by worker threads, which intern
+    // constants in the module they were copied from, under the lock of the
+    // compiler's types
+    struct DuskIRModule *const_owner;
+    // When not NULL, every constant that is asked for is appended to this
+    DuskArray(DuskIRValue *) requested_consts_arr;
 
     uint32_t glsl_ext_inst_id;
 
@@ -768,6 +959,11 @@ typedef struct DuskIRModule {
     DuskArray(DuskIRValue *) globals_arr;
 
     DuskArray(DuskIREntryPoint *) entry_points_arr;
+
+    // Indexed by node id. Generating the IR creates no nodes, so these are
+    // sized once when it starts and shared with the worker copies
+    DuskIRValue **expr_values;
+    DuskIRDeclInfo *decl_infos;
 } DuskIRModule;
 
 bool duskIRBlockIsTerminated(DuskIRValue *block);
@@ -788,6 +984,11 @@ DuskIREntryPoint *duskIRModuleAddEntryPoint(
 void duskIREntryPointReferenceGlobal(
     DuskIREntryPoint *entry_point, DuskIRValue *global);
 DuskIRModule *duskIRModuleCreate(DuskCompiler *compiler);
+// Creates a module with one of the entry points of another module and only
+// what it uses, sharing the values of the other module. Marks the types it
+// uses, so it has to be emitted before another module is created or split.
+DuskIRModule *
+duskIRModuleSplit(DuskIRModule *module, DuskIREntryPoint *entry_point);
 
 DuskIRValue *duskIRConstBoolCreate(DuskIRModule *module, bool bool_value);
 DuskIRValue *
@@ -799,6 +1000,10 @@ DuskIRValue *duskIRConstCompositeCreate(
     DuskType *type,
     size_t value_count,
     DuskIRValue **values);
+// Replaces the constants of the module by a subset of them, which are the
+// only ones the cache hands out afterwards
+void duskIRModuleKeepConsts(
+    DuskIRModule *module, size_t const_count, DuskIRValue **consts);
 
 DuskIRDecoration duskIRCreateDecoration(
     DuskAllocator *allocator,
@@ -809,6 +1014,7 @@ DuskIRDecoration duskIRCreateDecoration(
 void duskIRCreateReturn(
     DuskIRModule *module, DuskIRValue *block, DuskIRValue *value);
 void duskIRCreateDiscard(DuskIRModule *module, DuskIRValue *block);
+void duskIRCreateUnreachable(DuskIRModule *module, DuskIRValue *block);
 void duskIRCreateBranch(
     DuskIRModule *module, DuskIRValue *block, DuskIRValue *dest_block);
 void duskIRCreateBranchCond(
@@ -823,7 +1029,9 @@ void duskIRCreateLoopMerge(
     DuskIRModule *module,
     DuskIRValue *block,
     DuskIRValue *merge_block,
-    DuskIRValue *continue_block);
+    DuskIRValue *continue_block,
+    DuskIRUnrollHint unroll_hint,
+    uint32_t unroll_count);
 DuskIRValue *duskIRCreatePhi(
     DuskIRModule *module,
     DuskIRValue *block,
@@ -905,6 +1113,37 @@ bool duskIRValueIsConstant(DuskIRValue *value);
 bool duskIRIsLvalue(DuskIRValue *value);
 DuskIRValue *
 duskIRLoadLvalue(DuskIRModule *module, DuskIRValue *block, DuskIRValue *value);
+
+// Turns the scalar and vector local variables of a function whose address
+// doesn't escape into SSA values, with phis where their values merge
+void duskIRPromoteLocals(DuskIRModule *module, DuskIRValue *function);
+// Replaces the instructions of a function that compute a constant by the
+// constant, and the ones that have an identity operand by their other operand.
+// Swizzles and extracts take their components from where they were made.
+void duskIRFoldConstants(DuskIRModule *module, DuskIRValue *function);
+// Replaces the loops of a function that run a small and constant number of
+// times by a copy of their body for every iteration. Returns whether any loop
+// was unrolled, as what comes after it can then be folded.
+bool duskIRUnrollLoops(DuskIRModule *module, DuskIRValue *function);
+// Replaces integer multiplications, divisions and remainders by powers of two
+// by shifts and masks, and other arithmetic by cheaper equivalents
+void duskIRReduceStrength(DuskIRModule *module, DuskIRValue *function);
+// Moves the instructions of the loops of a function that compute the same
+// value in every iteration to the block before the loop
+void duskIRHoistLoopInvariants(DuskIRModule *module, DuskIRValue *function);
+// Replaces the instructions of a function without side effects by an equal
+// instruction that dominates them
+void duskIREliminateCommonSubexpressions(
+    DuskIRModule *module, DuskIRValue *function);
+// Removes the blocks of a function that can't be reached and the instructions
+// without side effects whose results aren't used
+void duskIRRemoveDeadCode(DuskIRModule *module, DuskIRValue *function);
+// Replaces calls by a copy of the body of the called function, for functions
+// that are small, called once or marked with the 'inline' attribute
+void duskIRInlineCalls(DuskIRModule *module);
+// Removes the functions, globals, constants and types that the entry points
+// of the module don't use
+void duskIRModuleRemoveDeadCode(DuskIRModule *module);
 // }}}
 
 // Token {{{
@@ -1114,44 +1353,53 @@ typedef enum DuskDeclKind {
     DUSK_DECL_FUNCTION,
     DUSK_DECL_VAR,
     DUSK_DECL_TYPE,
+    DUSK_DECL_CONST,
 } DuskDeclKind;
 
+// The types of the nodes are kept in side tables of the compiler and what the
+// IR generation makes out of them in side tables of the IR module, indexed by
+// node id
 struct DuskDecl {
     DuskDeclKind kind;
     DuskLocation location;
     const char *name;
     DuskArray(DuskAttribute) attributes_arr;
-    DuskType *type;
-    DuskIRValue *ir_value;
+    // Names looked up while analyzing a top level declaration, NULL until the
+    // declaration is analyzed. Used to find the dependents of a declaration
+    // when compiling incrementally.
+    DuskMap *referenced_names;
 
     union {
         struct {
             bool is_entry_point;
-            DuskIREntryPoint *entry_point;
             DuskShaderStage entry_point_stage;
-            DuskArray(DuskIRValue *) entry_point_inputs_arr;
-            DuskArray(DuskIRValue *) entry_point_outputs_arr;
+            DuskIRInlineHint inline_hint;
 
             const char *link_name;
             DuskScope *scope;
 
-            DuskArray(DuskDecl *) parameter_decls_arr;
+            DuskArray(DuskDeclId) parameter_decls_arr;
 
-            DuskExpr *return_type_expr;
+            DuskExprId return_type_expr;
             DuskArray(DuskAttribute) return_type_attributes_arr;
 
-            DuskArray(DuskStmt *) stmts_arr;
+            DuskArray(DuskStmtId) stmts_arr;
         } function;
         struct {
             DuskScope *scope;
-            DuskExpr *type_expr;
-            DuskExpr *value_expr;
+            DuskExprId type_expr;
+            DuskExprId value_expr;
             DuskStorageClass storage_class;
             bool read_only;
         } var;
         struct {
-            DuskExpr *type_expr;
+            DuskExprId type_expr;
         } typedef_;
+        struct {
+            DuskExprId type_expr;
+            DuskExprId value_expr;
+            DuskConstValue *value;
+        } const_;
     };
 };
 
@@ -1173,27 +1421,30 @@ struct DuskStmt {
     DuskLocation location;
 
     union {
-        DuskDecl *decl;
-        DuskExpr *expr;
+        DuskDeclId decl;
+        DuskExprId expr;
         struct {
-            DuskExpr *assigned_expr;
-            DuskExpr *value_expr;
+            DuskExprId assigned_expr;
+            DuskExprId value_expr;
         } assign;
         struct {
-            DuskArray(DuskStmt *) stmts_arr;
+            DuskArray(DuskStmtId) stmts_arr;
             DuskScope *scope;
         } block;
         struct {
-            DuskExpr *expr;
+            DuskExprId expr;
         } return_;
         struct {
-            DuskExpr *cond_expr;
-            DuskStmt *true_stmt;
-            DuskStmt *false_stmt;
+            DuskExprId cond_expr;
+            DuskStmtId true_stmt;
+            DuskStmtId false_stmt;
         } if_;
         struct {
-            DuskExpr *cond_expr;
-            DuskStmt *stmt;
+            DuskArray(DuskAttribute) attributes_arr;
+            DuskExprId cond_expr;
+            DuskStmtId stmt;
+            DuskIRUnrollHint unroll_hint;
+            uint32_t unroll_count;
         } while_;
     };
 };
@@ -1223,13 +1474,21 @@ typedef enum DuskExprKind {
     DUSK_EXPR_UNARY,
 } DuskExprKind;
 
+// Struct type expressions are rare and a lot bigger than the other kinds of
+// expressions, so they are kept out of line
+typedef struct DuskStructTypeExpr {
+    const char **params;
+    size_t param_count;
+    const char *name;
+    size_t field_count;
+    const char **field_names;
+    DuskExprId *field_type_exprs;
+    DuskArray(DuskAttribute) * field_attribute_arrays;
+} DuskStructTypeExpr;
+
 struct DuskExpr {
     DuskExprKind kind;
     DuskLocation location;
-    DuskType *type;
-    DuskType *as_type;
-    DuskIRValue *ir_value;
-    int64_t *resolved_int; // To be filled after semantic analysis
 
     union {
         DuskScalarType scalar_type;
@@ -1245,77 +1504,105 @@ struct DuskExpr {
         struct {
             DuskStorageClass storage_class;
             uint16_t alignment;
-            DuskExpr *sub_expr;
+            DuskExprId sub_expr;
         } ptr_type;
         int64_t int_literal;
         double float_literal;
         bool bool_literal;
         struct {
-            DuskExpr *type_expr;
+            DuskExprId type_expr;
             DuskArray(const char *) field_names_arr;
-            DuskArray(DuskExpr *) field_values_arr;
+            DuskArray(DuskExprId) field_values_arr;
         } struct_literal;
         struct {
-            DuskExpr *type_expr;
-            DuskArray(DuskExpr *) field_values_arr;
+            DuskExprId type_expr;
+            DuskArray(DuskExprId) field_values_arr;
         } array_literal;
         struct {
             const char *str;
-            DuskDecl *decl;
+            DuskDeclId decl;
             DuskArray(uint32_t) shuffle_indices_arr;
         } identifier;
         struct {
             const char *str;
         } string;
+        DuskStructTypeExpr *struct_type;
         struct {
-            const char **params;
-            size_t param_count;
-            const char *name;
-            size_t field_count;
-            const char **field_names;
-            DuskExpr **field_type_exprs;
-            DuskArray(DuskAttribute) * field_attribute_arrays;
-        } struct_type;
-        struct {
-            DuskExpr *sub_expr;
-            DuskExpr *size_expr;
+            DuskExprId sub_expr;
+            DuskExprId size_expr;
         } array_type;
         struct {
-            DuskExpr *func_expr;
-            DuskArray(DuskExpr *) params_arr;
+            DuskExprId func_expr;
+            DuskArray(DuskExprId) params_arr;
         } function_call;
         struct {
             DuskBuiltinFunctionKind kind;
-            DuskArray(DuskExpr *) params_arr;
+            DuskArray(DuskExprId) params_arr;
         } builtin_call;
         struct {
-            DuskExpr *base_expr;
-            DuskArray(DuskExpr *) chain_arr;
+            DuskExprId base_expr;
+            DuskArray(DuskExprId) chain_arr;
         } access;
         struct {
             DuskBinaryOp op;
-            DuskExpr *left;
-            DuskExpr *right;
+            DuskExprId left;
+            DuskExprId right;
         } binary;
         struct {
             DuskUnaryOp op;
-            DuskExpr *right;
+            DuskExprId right;
         } unary;
     };
 };
 // }}}
 
 // Compiler {{{
+// Source range of a top level declaration, including the whitespace and
+// comments before it
+typedef struct DuskDeclExtent {
+    size_t offset;
+    size_t length;
+    size_t line;
+    size_t col;
+} DuskDeclExtent;
+
+typedef struct DuskImport {
+    const char *path;
+    DuskLocation location;
+} DuskImport;
+
 struct DuskFile {
     const char *path;
 
     const char *text;
     size_t text_length;
 
+    // The import statements at the top of the file, and where they end
+    DuskArray(DuskImport) imports_arr;
+    DuskLocation imports_end;
+    // Every module imported by the file, directly or not, with the imports
+    // of a module coming before it
+    DuskArray(DuskFile *) modules_arr;
+
+    // The parent scope holds the declarations of the imported modules
     DuskScope *scope;
-    DuskArray(DuskDecl *) decls_arr;
+    DuskArray(DuskDeclId) decls_arr;
+    DuskArray(DuskDeclExtent) decl_extents_arr; // One per declaration
 };
 
+// An imported file, analyzed once and kept serialized in the module cache
+typedef struct DuskModule {
+    const char *path; // As resolved by the import callback
+    uint64_t text_hash;
+    // Covers the text of the modules imported by this one as well
+    uint64_t hash;
+    uint8_t *blob;
+    size_t blob_byte_size;
+    DuskArray(DuskImport) imports_arr;
+    // Loaded in the current compilation
+    DuskFile *file;
+} DuskModule;
+
 typedef struct DuskError {
     DuskLocation location;
     const char *message;
@@ -1323,24 +1610,171 @@ typedef struct DuskError {
 
 typedef struct DuskCompiler {
     DuskArena *main_arena;
+    // Arenas owned by worker threads, destroyed along with the compiler
+    DuskArray(DuskArena *) worker_arenas_arr;
     DuskArray(DuskError) errors_arr;
-    DuskMap *type_cache;
+    // The parser allocates AST nodes from these
+    DuskPool expr_pool;
+    DuskPool stmt_pool;
+    DuskPool decl_pool;
+    // Side tables of the analysis by node id, which always have an entry for
+    // every node allocated so far. The type of a type expression is the type
+    // type, and the type it stands for is in expr_as_types_arr.
+    DuskArray(DuskType *) expr_types_arr;
+    DuskArray(DuskType *) expr_as_types_arr;
+    // Memoized by duskConstEvaluate, NULL until the expression is evaluated
+    DuskArray(DuskConstValue *) expr_const_values_arr;
+    DuskArray(DuskType *) decl_types_arr;
+    DuskTypeCache type_cache;
     DuskArray(DuskType *) types_arr;
+    // Set on the copies of the compiler used by worker threads, which intern
+    // types in the cache of the compiler they were copied from, under its lock
+    struct DuskCompiler *type_owner;
+    DuskMutex *type_mutex;
+    // When not NULL, every type that is asked for is appended to this, so
+    // that types created out of order can be put back in a deterministic one
+    DuskArray(DuskType *) requested_types_arr;
+    // Types created by this compiler, not counting the builtin ones
+    uint32_t type_count;
+    // Incremented for every IR module, so that types are only marked once
+    // per module by duskTypeMarkNotDead
+    uint32_t type_mark_epoch;
+    // Value of type_mark_epoch when each type was last marked, by type index
+    DuskArray(uint32_t) type_marks_arr;
+    DuskArray(DuskType *) type_mark_stack_arr;
+    // Types marked for the current IR module, which are the ones it emits
+    DuskArray(DuskType *) referenced_types_arr;
+    // Types that the copies used by worker threads were asked to mark, which
+    // the owner marks once the threads are done
+    DuskArray(DuskType *) marked_types_arr;
     jmp_buf jump_buffer;
 
+    // File from the last compilation, reused by duskCompileIncremental if
+    // that compilation succeeded
+    DuskFile *last_file;
+    bool last_compile_succeeded;
+
+    // Analyzed declarations loaded by duskCompilerLoadPrelude, which are
+    // visible from every file, and the types they use
+    DuskFile *prelude_file;
+    DuskArray(DuskType *) prelude_types_arr;
+
+    // Maximum number of threads a compilation uses, zero means one per
+    // processor
+    uint32_t thread_count;
+
+    DuskImportCallback import_callback;
+    void *import_user_data;
+    // Modules by path, kept across compilations
+    DuskMap *module_cache;
+    // Modules loaded in the current compilation by path, NULL while the
+    // module's imports are being loaded
+    DuskMap *loaded_modules;
+
     DuskMap *keyword_map;
     DuskMap *builtin_function_map;
 } DuskCompiler;
 // }}}
 
 void duskThrow(DuskCompiler *compiler);
+uint32_t duskCompilerGetThreadCount(DuskCompiler *compiler);
+
+// Allocate a zeroed node and its entries in the side tables. The copies of
+// the compiler used by worker threads throw if they run out of ids.
+DuskDeclId duskDeclCreate(DuskCompiler *compiler);
+DuskStmtId duskStmtCreate(DuskCompiler *compiler);
+DuskExprId duskExprCreate(DuskCompiler *compiler);
+// Makes room in the side tables for the ids reserved in the pools
+void duskGrowSideTables(DuskCompiler *compiler);
+
+static inline DuskDecl *duskDeclGet(DuskCompiler *compiler, DuskDeclId id)
+{
+    return (DuskDecl *)duskPoolGet(&compiler->decl_pool, id);
+}
+
+static inline DuskStmt *duskStmtGet(DuskCompiler *compiler, DuskStmtId id)
+{
+    return (DuskStmt *)duskPoolGet(&compiler->stmt_pool, id);
+}
+
+static inline DuskExpr *duskExprGet(DuskCompiler *compiler, DuskExprId id)
+{
+    return (DuskExpr *)duskPoolGet(&compiler->expr_pool, id);
+}
 DUSK_PRINTF_FORMATTING(3, 4)
 void duskAddError(
     DuskCompiler *compiler, DuskLocation loc, const char *fmt, ...);
 void duskParse(DuskCompiler *compiler, DuskFile *file);
+// Updates a previously parsed file after the bytes in
+// [edit_offset, edit_offset + removed_length) of its text were replaced by
+// [edit_offset, edit_offset + inserted_length) of the new text. Declarations
+// outside of the edit are kept, except for the ones that depend on a changed
+// declaration. Returns false if the file needs to be parsed from scratch.
+bool duskParseIncremental(
+    DuskCompiler *compiler,
+    DuskFile *file,
+    const char *text,
+    size_t text_length,
+    size_t edit_offset,
+    size_t removed_length,
+    size_t inserted_length);
 void duskAnalyzeFile(DuskCompiler *compiler, DuskFile *file);
 DuskIRModule *duskGenerateIRModule(DuskCompiler *compiler, DuskFile *file);
 DuskArray(uint32_t)
     duskIRModuleEmit(DuskCompiler *compiler, DuskIRModule *module);
 
+// Prelude {{{
+// Serializes the analyzed declarations of a file and the types they use.
+// Declarations from other files are referred to by name.
+uint8_t *duskPreludeWrite(
+    DuskCompiler *compiler, DuskFile *file, size_t *blob_byte_size);
+// Loads the declarations serialized by duskPreludeWrite, creating their types
+// in the compiler's type cache. Names of declarations from other files are
+// looked up in parent_scope, which becomes the parent of the file's scope.
+// Returns NULL if the blob is corrupt or doesn't describe resolved
+// declarations.
+DuskFile *duskPreludeRead(
+    DuskCompiler *compiler,
+    const uint8_t *blob,
+    size_t blob_byte_size,
+    DuskScope *parent_scope);
+// }}}
+
+// Module {{{
+// Loads the modules imported by a parsed file and makes their declarations
+// visible from the file's scope
+void duskLoadImports(DuskCompiler *compiler, DuskFile *file);
+// }}}
+
+// Const {{{
+// Value of an expression that is known at compile time. Integers are kept
+// wrapped to the width of their type and sign or zero extended to 64 bits,
+// and floats are kept rounded to the precision of their type.
+struct DuskConstValue {
+    DuskType *type;
+    union {
+        bool bool_value;
+        uint64_t int_value;
+        double float_value;
+        // Vectors, matrices (by column), arrays and structs
+        struct {
+            size_t count;
+            DuskConstValue **values;
+        } composite;
+    };
+};
+
+// Returns the value of an analyzed expression, or NULL if it is not known at
+// compile time. Nothing is folded if the result would depend on the target,
+// like an integer division by zero or an out of range conversion. The result
+// is memoized in expr_const_values_arr, so the types of the expression must be
+// final.
+DuskConstValue *duskConstEvaluate(
+    DuskCompiler *compiler, DuskAllocator *allocator, DuskExprId expr_id);
+// Converts a scalar value to another scalar type, or returns NULL
+DuskConstValue *duskConstConvert(
+    DuskAllocator *allocator, DuskConstValue *value, DuskType *type);
+bool duskConstToInteger(DuskConstValue *value, int64_t *out_int);
+// }}}
+
 #endif
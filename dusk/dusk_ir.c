@@ -5,139 +5,202 @@
 static void duskEmitType(DuskIRModule *module, DuskType *type);
 static void duskEmitValue(DuskIRModule *module, DuskIRValue *value);
 
-static const char *
-duskIRConstToString(DuskAllocator *allocator, DuskIRValue *value)
+static uint64_t duskIRConstHashMix(uint64_t hash, uint64_t value)
 {
-    if (value->const_string) return value->const_string;
+    hash ^= value;
+    hash *= 0x9e3779b97f4a7c15ULL;
+    return hash ^ (hash >> 32);
+}
+
+// What identifies a constant. The arrays are only borrowed, so lookups
+// don't need to allocate.
+typedef struct DuskIRConstKey {
+    DuskIRValueKind kind;
+    DuskType *type;
+    bool bool_value;
+    size_t word_count;
+    const uint32_t *words;
+    size_t value_count;
+    DuskIRValue **values;
+} DuskIRConstKey;
+
+static uint64_t duskIRConstHash(DuskIRConstKey *key)
+{
+    uint64_t hash = duskIRConstHashMix(14695981039346656037ULL, key->kind);
+    hash = duskIRConstHashMix(hash, (uintptr_t)key->type);
+    hash = duskIRConstHashMix(hash, key->bool_value);
+    for (size_t i = 0; i < key->word_count; ++i) {
+        hash = duskIRConstHashMix(hash, key->words[i]);
+    }
+    for (size_t i = 0; i < key->value_count; ++i) {
+        hash = duskIRConstHashMix(hash, (uintptr_t)key->values[i]);
+    }
+
+    // Zero marks an empty slot
+    return hash ? hash : 1;
+}
+
+static bool duskIRConstMatches(DuskIRValue *value, DuskIRConstKey *key)
+{
+    if (value->kind != key->kind || value->type != key->type) return false;
 
     switch (value->kind) {
     case DUSK_IR_VALUE_CONSTANT_BOOL: {
-        value->const_string =
-            (value->const_bool.value ? "@bool_true" : "@bool_false");
-        break;
+        return value->const_bool.value == key->bool_value;
     }
     case DUSK_IR_VALUE_CONSTANT: {
-        switch (value->type->kind) {
-        case DUSK_TYPE_INT: {
-            if (value->type->int_.is_signed) {
-                switch (value->type->int_.bits) {
-                case 8:
-                    value->const_string = duskSprintf(
-                        allocator,
-                        "@i8(%c)",
-                        *(int8_t *)value->constant.value_words);
-                    break;
-                case 16:
-                    value->const_string = duskSprintf(
-                        allocator,
-                        "@i16(%hd)",
-                        *(int16_t *)value->constant.value_words);
-                    break;
-                case 32:
-                    value->const_string = duskSprintf(
-                        allocator,
-                        "@i32(%d)",
-                        *(int32_t *)value->constant.value_words);
-                    break;
-                case 64:
-                    value->const_string = duskSprintf(
-                        allocator,
-                        "@i64(%ld)",
-                        *(int64_t *)value->constant.value_words);
-                    break;
-                }
-            } else {
-                switch (value->type->int_.bits) {
-                case 8:
-                    value->const_string = duskSprintf(
-                        allocator,
-                        "@u8(%uc)",
-                        *(uint8_t *)value->constant.value_words);
-                    break;
-                case 16:
-                    value->const_string = duskSprintf(
-                        allocator,
-                        "@u16(%hu)",
-                        *(uint16_t *)value->constant.value_words);
-                    break;
-                case 32:
-                    value->const_string = duskSprintf(
-                        allocator,
-                        "@u32(%u)",
-                        *(uint32_t *)value->constant.value_words);
-                    break;
-                case 64:
-                    value->const_string = duskSprintf(
-                        allocator,
-                        "@u64(%lu)",
-                        *(uint64_t *)value->constant.value_words);
-                    break;
-                }
-            }
-            break;
-        }
-        case DUSK_TYPE_FLOAT: {
-            switch (value->type->float_.bits) {
-            case 32: {
-                float val = 0.0f;
-                memcpy(&val, value->constant.value_words, sizeof(float));
-                value->const_string = duskSprintf(allocator, "@f32(%f)", val);
-                break;
-            }
-            case 64: {
-                double val = 0.0f;
-                memcpy(&val, value->constant.value_words, sizeof(double));
-                value->const_string = duskSprintf(allocator, "@f64(%lf)", val);
-                break;
-            }
+        // Compared bit for bit, so 0.0 and -0.0 are distinct constants
+        return value->constant.value_word_count == key->word_count &&
+               memcmp(
+                   value->constant.value_words,
+                   key->words,
+                   sizeof(uint32_t) * key->word_count) == 0;
+    }
+    case DUSK_IR_VALUE_CONSTANT_COMPOSITE: {
+        DuskArray(DuskIRValue *) values_arr =
+            value->constant_composite.values_arr;
+        return duskArrayLength(values_arr) == key->value_count &&
+               memcmp(
+                   values_arr,
+                   key->values,
+                   sizeof(DuskIRValue *) * key->value_count) == 0;
+    }
+    default: break;
+    }
+
+    return false;
+}
+
+static void duskIRConstCacheInsert(
+    DuskIRModule *module, uint64_t hash, DuskIRValue *value)
+{
+    DuskIRConstCache *cache = &module->const_cache;
+
+    // Keep the load factor at or below one half
+    if ((cache->count + 1) * 2 > cache->size) {
+        DuskIRConstCacheSlot *old_slots = cache->slots;
+        uint64_t old_size = cache->size;
+
+        cache->size *= 2;
+        cache->count = 0;
+        cache->slots = DUSK_NEW_ARRAY(
+            module->allocator, DuskIRConstCacheSlot, cache->size);
+
+        for (uint64_t i = 0; i < old_size; ++i) {
+            DuskIRConstCacheSlot *slot = &old_slots[i];
+            if (slot->value) {
+                duskIRConstCacheInsert(module, slot->hash, slot->value);
             }
-            break;
-        }
-        default: DUSK_ASSERT(0); break;
         }
-        break;
+        duskFree(module->allocator, old_slots);
     }
-    case DUSK_IR_VALUE_CONSTANT_COMPOSITE: {
-        DuskStringBuilder *sb = duskStringBuilderCreate(allocator, 1024);
-        duskStringBuilderAppend(sb, duskTypeToString(allocator, value->type));
-        duskStringBuilderAppend(sb, "{");
-        for (size_t i = 0;
-             i < duskArrayLength(value->constant_composite.values_arr);
-             ++i) {
-            if (i != 0) duskStringBuilderAppend(sb, ",");
-            DuskIRValue *elem_value = value->constant_composite.values_arr[i];
-            const char *elem_str = duskIRConstToString(allocator, elem_value);
-            duskStringBuilderAppend(sb, elem_str);
+
+    uint64_t i = hash & (cache->size - 1);
+    while (cache->slots[i].value) {
+        i = (i + 1) & (cache->size - 1);
+    }
+
+    cache->slots[i].hash = hash;
+    cache->slots[i].value = value;
+    cache->count++;
+}
+
+// Worker threads intern their constants in the module they were copied from.
+// Returns the module whose cache should be used, locking it if needed.
+static DuskIRModule *duskIRLockConstOwner(DuskIRModule *module)
+{
+    if (!module->const_owner) return module;
+    duskMutexLock(module->compiler->type_owner->type_mutex);
+    return module->const_owner;
+}
+
+static void duskIRUnlockConstOwner(DuskIRModule *module)
+{
+    if (!module->const_owner) return;
+    duskMutexUnlock(module->compiler->type_owner->type_mutex);
+}
+
+static DuskIRValue *
+duskIRConstRequested(DuskIRModule *module, DuskIRValue *value)
+{
+    if (module->requested_consts_arr) {
+        duskArrayPush(&module->requested_consts_arr, value);
+    }
+    return value;
+}
+
+static DuskIRValue *
+duskIRFindCachedConst(DuskIRModule *module, uint64_t hash, DuskIRConstKey *key)
+{
+    DuskIRConstCache *cache = &module->const_cache;
+
+    uint64_t i = hash & (cache->size - 1);
+    while (cache->slots[i].value) {
+        DuskIRConstCacheSlot *slot = &cache->slots[i];
+        if (slot->hash == hash && duskIRConstMatches(slot->value, key)) {
+            return slot->value;
         }
-        duskStringBuilderAppend(sb, "}");
+        i = (i + 1) & (cache->size - 1);
+    }
 
-        value->const_string = duskStringBuilderBuild(sb, allocator);
+    return NULL;
+}
 
-        duskStringBuilderDestroy(sb);
+static DuskIRValue *
+duskIRCreateConst(DuskIRModule *module, DuskIRConstKey *key)
+{
+    DuskIRValue *value = DUSK_NEW(module->allocator, DuskIRValue);
+    value->kind = key->kind;
+    value->type = key->type;
 
+    switch (key->kind) {
+    case DUSK_IR_VALUE_CONSTANT_BOOL: {
+        value->const_bool.value = key->bool_value;
+        break;
+    }
+    case DUSK_IR_VALUE_CONSTANT: {
+        value->constant.value_word_count = key->word_count;
+        value->constant.value_words =
+            DUSK_NEW_ARRAY(module->allocator, uint32_t, key->word_count);
+        memcpy(
+            value->constant.value_words,
+            key->words,
+            sizeof(uint32_t) * key->word_count);
+        break;
+    }
+    case DUSK_IR_VALUE_CONSTANT_COMPOSITE: {
+        DuskArray(DuskIRValue *) values_arr =
+            duskArrayCreate(module->allocator, DuskIRValue *);
+        duskArrayResize(&values_arr, key->value_count);
+        memcpy(
+            values_arr,
+            key->values,
+            sizeof(DuskIRValue *) * key->value_count);
+        value->constant_composite.values_arr = values_arr;
         break;
     }
     default: DUSK_ASSERT(0); break;
     }
 
-    return value->const_string;
+    return value;
 }
 
+// Returns the interned constant for key, creating it if there is none
 static DuskIRValue *
-duskIRGetCachedConst(DuskIRModule *module, DuskIRValue *value)
+duskIRGetCachedConst(DuskIRModule *module, DuskIRConstKey *key)
 {
-    const char *value_str = duskIRConstToString(module->allocator, value);
+    uint64_t hash = duskIRConstHash(key);
 
-    DuskIRValue *existing_value = NULL;
-    if (duskMapGet(module->const_cache, value_str, (void **)&existing_value)) {
-        DUSK_ASSERT(existing_value != NULL);
-        return existing_value;
+    DuskIRModule *owner = duskIRLockConstOwner(module);
+    DuskIRValue *value = duskIRFindCachedConst(owner, hash, key);
+    if (!value) {
+        value = duskIRCreateConst(owner, key);
+        duskIRConstCacheInsert(owner, hash, value);
+        duskArrayPush(&owner->consts_arr, value);
     }
+    duskIRUnlockConstOwner(module);
 
-    duskMapSet(module->const_cache, value_str, value);
-    duskArrayPush(&module->consts_arr, value);
-
-    return value;
+    return duskIRConstRequested(module, value);
 }
 
 static uint32_t duskReserveId(DuskIRModule *module)
@@ -168,6 +231,7 @@ bool duskIRBlockIsTerminated(DuskIRValue *block)
     switch (inst->kind) {
     case DUSK_IR_VALUE_RETURN:
     case DUSK_IR_VALUE_DISCARD:
+    case DUSK_IR_VALUE_UNREACHABLE:
     case DUSK_IR_VALUE_BRANCH:
     case DUSK_IR_VALUE_BRANCH_COND: {
         return true;
@@ -185,6 +249,9 @@ DuskIRModule *duskIRModuleCreate(DuskCompiler *compiler)
     module->compiler = compiler;
     module->allocator = allocator;
 
+    compiler->type_mark_epoch++;
+    duskArrayResize(&compiler->referenced_types_arr, 0);
+
     module->last_id = 0;
     module->stream_arr = duskArrayCreate(allocator, uint32_t);
     module->extensions_arr = duskArrayCreate(allocator, const char *);
@@ -192,7 +259,10 @@ DuskIRModule *duskIRModuleCreate(DuskCompiler *compiler)
 
     duskArrayPush(&module->capabilities_arr, SpvCapabilityShader);
 
-    module->const_cache = duskMapCreate(allocator, 32);
+    module->const_cache = (DuskIRConstCache){
+        .slots = DUSK_NEW_ARRAY(allocator, DuskIRConstCacheSlot, 64),
+        .size = 64,
+    };
     module->consts_arr = duskArrayCreate(allocator, DuskIRValue *);
 
     module->glsl_ext_inst_id = duskReserveId(module);
@@ -235,7 +305,7 @@ duskIRFunctionCreate(DuskIRModule *module, DuskType *type, const char *name)
     DuskIRValue *first_block = duskIRBlockCreate(module);
     duskIRFunctionAddBlock(value, first_block);
 
-    duskTypeMarkNotDead(value->type);
+    duskTypeMarkNotDead(module->compiler, value->type);
 
     return value;
 }
@@ -255,7 +325,7 @@ DuskIRValue *duskIRVariableCreate(
     value->type = duskTypeNewPointer(module->compiler, type, storage_class, 0);
     value->var.storage_class = storage_class;
 
-    duskTypeMarkNotDead(value->type);
+    duskTypeMarkNotDead(module->compiler, value->type);
 
     switch (storage_class) {
     case DUSK_STORAGE_CLASS_WORKGROUP:
@@ -276,6 +346,59 @@ DuskIRValue *duskIRVariableCreate(
     return value;
 }
 
+static DuskArray(DuskIRValue *) duskIRCopyValues(
+    DuskAllocator *allocator, DuskArray(DuskIRValue *) values_arr)
+{
+    size_t value_count = duskArrayLength(values_arr);
+    DuskArray(DuskIRValue *) copy_arr =
+        duskArrayCreate(allocator, DuskIRValue *);
+    duskArrayResize(&copy_arr, value_count);
+    memcpy(copy_arr, values_arr, sizeof(DuskIRValue *) * value_count);
+    return copy_arr;
+}
+
+DuskIRModule *
+duskIRModuleSplit(DuskIRModule *module, DuskIREntryPoint *entry_point)
+{
+    DuskAllocator *allocator = module->allocator;
+    DuskIRModule *split = DUSK_NEW(allocator, DuskIRModule);
+    *split = *module;
+
+    split->last_id = 0;
+    split->stream_arr = duskArrayCreate(allocator, uint32_t);
+    split->extensions_arr = duskArrayCreate(allocator, const char *);
+    for (size_t i = 0; i < duskArrayLength(module->extensions_arr); ++i) {
+        duskArrayPush(&split->extensions_arr, module->extensions_arr[i]);
+    }
+    split->capabilities_arr = duskArrayCreate(allocator, uint32_t);
+    for (size_t i = 0; i < duskArrayLength(module->capabilities_arr); ++i) {
+        duskArrayPush(&split->capabilities_arr, module->capabilities_arr[i]);
+    }
+    split->type_infos = NULL;
+
+    // Removing the constants the split module doesn't use must not affect the
+    // cache of the original one
+    split->const_cache.slots = DUSK_NEW_ARRAY(
+        allocator, DuskIRConstCacheSlot, module->const_cache.size);
+    memcpy(
+        split->const_cache.slots,
+        module->const_cache.slots,
+        sizeof(DuskIRConstCacheSlot) * module->const_cache.size);
+    split->consts_arr = duskIRCopyValues(allocator, module->consts_arr);
+    split->requested_consts_arr = NULL;
+
+    split->glsl_ext_inst_id = duskReserveId(split);
+
+    split->functions_arr = duskIRCopyValues(allocator, module->functions_arr);
+    split->globals_arr = duskIRCopyValues(allocator, module->globals_arr);
+    split->entry_points_arr =
+        duskArrayCreate(allocator, DuskIREntryPoint *);
+    duskArrayPush(&split->entry_points_arr, entry_point);
+
+    duskIRModuleRemoveDeadCode(split);
+    return split;
+}
+
 DuskIREntryPoint *duskIRModuleAddEntryPoint(
     DuskIRModule *module,
     DuskIRValue *function,
@@ -320,85 +443,80 @@ void duskIREntryPointReferenceGlobal(
 
 DuskIRValue *duskIRConstBoolCreate(DuskIRModule *module, bool bool_value)
 {
-    DuskIRValue *value = DUSK_NEW(module->allocator, DuskIRValue);
-    value->type = duskTypeNewBasic(module->compiler, DUSK_TYPE_BOOL);
-    value->kind = DUSK_IR_VALUE_CONSTANT_BOOL;
-    value->const_bool.value = bool_value;
-    return duskIRGetCachedConst(module, value);
+    DuskIRConstKey key = {
+        .kind = DUSK_IR_VALUE_CONSTANT_BOOL,
+        .type = duskTypeNewBasic(module->compiler, DUSK_TYPE_BOOL),
+        .bool_value = bool_value,
+    };
+    return duskIRGetCachedConst(module, &key);
 }
 
 DuskIRValue *
 duskIRConstIntCreate(DuskIRModule *module, DuskType *type, uint64_t int_value)
 {
-    DuskIRValue *value = DUSK_NEW(module->allocator, DuskIRValue);
-    value->type = type;
-    value->kind = DUSK_IR_VALUE_CONSTANT;
+    uint32_t words[2] = {0};
+    DuskIRConstKey key = {
+        .kind = DUSK_IR_VALUE_CONSTANT,
+        .type = type,
+        .words = words,
+    };
 
     switch (type->int_.bits) {
     case 8: {
-        value->constant.value_word_count = 1;
-        value->constant.value_words =
-            DUSK_NEW_ARRAY(module->allocator, uint32_t, 1);
+        key.word_count = 1;
         uint8_t val = (uint8_t)int_value;
-        memcpy(value->constant.value_words, &val, sizeof(val));
+        memcpy(words, &val, sizeof(val));
         break;
     }
     case 16: {
-        value->constant.value_word_count = 1;
-        value->constant.value_words =
-            DUSK_NEW_ARRAY(module->allocator, uint32_t, 1);
+        key.word_count = 1;
         uint16_t val = (uint16_t)int_value;
-        memcpy(value->constant.value_words, &val, sizeof(val));
+        memcpy(words, &val, sizeof(val));
         break;
     }
     case 32: {
-        value->constant.value_word_count = 1;
-        value->constant.value_words =
-            DUSK_NEW_ARRAY(module->allocator, uint32_t, 1);
+        key.word_count = 1;
         uint32_t val = (uint32_t)int_value;
-        memcpy(value->constant.value_words, &val, sizeof(val));
+        memcpy(words, &val, sizeof(val));
         break;
     }
     case 64: {
-        value->constant.value_word_count = 2;
-        value->constant.value_words =
-            DUSK_NEW_ARRAY(module->allocator, uint32_t, 2);
-        memcpy(value->constant.value_words, &int_value, sizeof(uint64_t));
+        key.word_count = 2;
+        memcpy(words, &int_value, sizeof(uint64_t));
         break;
     }
     default: DUSK_ASSERT(0); break;
     }
 
-    return duskIRGetCachedConst(module, value);
+    return duskIRGetCachedConst(module, &key);
 }
 
 DuskIRValue *duskIRConstFloatCreate(
     DuskIRModule *module, DuskType *type, double double_value)
 {
-    DuskIRValue *value = DUSK_NEW(module->allocator, DuskIRValue);
-    value->type = type;
-    value->kind = DUSK_IR_VALUE_CONSTANT;
+    uint32_t words[2] = {0};
+    DuskIRConstKey key = {
+        .kind = DUSK_IR_VALUE_CONSTANT,
+        .type = type,
+        .words = words,
+    };
 
     switch (type->float_.bits) {
     case 32: {
-        value->constant.value_word_count = 1;
-        value->constant.value_words =
-            DUSK_NEW_ARRAY(module->allocator, uint32_t, 1);
+        key.word_count = 1;
         float val = (float)double_value;
-        memcpy(value->constant.value_words, &val, sizeof(val));
+        memcpy(words, &val, sizeof(val));
         break;
     }
     case 64: {
-        value->constant.value_word_count = 2;
-        value->constant.value_words =
-            DUSK_NEW_ARRAY(module->allocator, uint32_t, 2);
-        memcpy(value->constant.value_words, &double_value, sizeof(uint64_t));
+        key.word_count = 2;
+        memcpy(words, &double_value, sizeof(uint64_t));
         break;
     }
     default: DUSK_ASSERT(0); break;
     }
 
-    return duskIRGetCachedConst(module, value);
+    return duskIRGetCachedConst(module, &key);
 }
 
 DuskIRValue *duskIRConstCompositeCreate(
@@ -407,20 +525,57 @@ DuskIRValue *duskIRConstCompositeCreate(
     size_t value_count,
     DuskIRValue **values)
 {
-    DuskIRValue *value = DUSK_NEW(module->allocator, DuskIRValue);
-    value->type = type;
-    duskTypeMarkNotDead(value->type);
-    value->kind = DUSK_IR_VALUE_CONSTANT_COMPOSITE;
+    duskTypeMarkNotDead(module->compiler, type);
+
+    DuskIRConstKey key = {
+        .kind = DUSK_IR_VALUE_CONSTANT_COMPOSITE,
+        .type = type,
+        .value_count = value_count,
+        .values = values,
+    };
+    return duskIRGetCachedConst(module, &key);
+}
+
+void duskIRModuleKeepConsts(
+    DuskIRModule *module, size_t const_count, DuskIRValue **consts)
+{
+    DuskIRConstCache *cache = &module->const_cache;
+    memset(cache->slots, 0, sizeof(DuskIRConstCacheSlot) * cache->size);
+    cache->count = 0;
 
-    value->constant_composite.values_arr =
+    DuskArray(DuskIRValue *) consts_arr =
         duskArrayCreate(module->allocator, DuskIRValue *);
-    duskArrayResize(&value->constant_composite.values_arr, value_count);
-    memcpy(
-        value->constant_composite.values_arr,
-        values,
-        value_count * sizeof(DuskIRValue *));
+    for (size_t i = 0; i < const_count; ++i) {
+        DuskIRValue *value = consts[i];
+        DuskIRConstKey key = {
+            .kind = value->kind,
+            .type = value->type,
+        };
+
+        switch (value->kind) {
+        case DUSK_IR_VALUE_CONSTANT_BOOL: {
+            key.bool_value = value->const_bool.value;
+            break;
+        }
+        case DUSK_IR_VALUE_CONSTANT: {
+            key.word_count = value->constant.value_word_count;
+            key.words = value->constant.value_words;
+            break;
+        }
+        case DUSK_IR_VALUE_CONSTANT_COMPOSITE: {
+            key.value_count =
+                duskArrayLength(value->constant_composite.values_arr);
+            key.values = value->constant_composite.values_arr;
+            break;
+        }
+        default: DUSK_ASSERT(0); break;
+        }
 
-    return duskIRGetCachedConst(module, value);
+        duskIRConstCacheInsert(module, duskIRConstHash(&key), value);
+        duskArrayPush(&consts_arr, value);
+    }
+
+    module->consts_arr = consts_arr;
 }
 
 static void duskIRBlockAppendInst(DuskIRValue *block, DuskIRValue *inst)
@@ -465,6 +620,14 @@ void duskIRCreateDiscard(DuskIRModule *module, DuskIRValue *block)
     duskIRBlockAppendInst(block, inst);
 }
 
+void duskIRCreateUnreachable(DuskIRModule *module, DuskIRValue *block)
+{
+    DuskIRValue *inst = DUSK_NEW(module->allocator, DuskIRValue);
+    inst->type = duskTypeNewBasic(module->compiler, DUSK_TYPE_VOID);
+    inst->kind = DUSK_IR_VALUE_UNREACHABLE;
+    duskIRBlockAppendInst(block, inst);
+}
+
 void duskIRCreateBranch(
     DuskIRModule *module, DuskIRValue *block, DuskIRValue *dest_block)
 {
@@ -505,13 +668,17 @@ void duskIRCreateLoopMerge(
     DuskIRModule *module,
     DuskIRValue *block,
     DuskIRValue *merge_block,
-    DuskIRValue *continue_block)
+    DuskIRValue *continue_block,
+    DuskIRUnrollHint unroll_hint,
+    uint32_t unroll_count)
 {
     DuskIRValue *inst = DUSK_NEW(module->allocator, DuskIRValue);
     inst->type = duskTypeNewBasic(module->compiler, DUSK_TYPE_VOID);
     inst->kind = DUSK_IR_VALUE_LOOP_MERGE;
     inst->loop_merge.merge_block = merge_block;
     inst->loop_merge.continue_block = continue_block;
+    inst->loop_merge.unroll_hint = unroll_hint;
+    inst->loop_merge.unroll_count = unroll_count;
     duskIRBlockAppendInst(block, inst);
 }
 
@@ -627,12 +794,12 @@ DuskIRValue *duskIRCreateAccessChain(
         index_count * sizeof(DuskIRValue *));
 
     for (size_t i = 0; i < index_count; ++i) {
-        duskTypeMarkNotDead(indices[i]->type);
+        duskTypeMarkNotDead(module->compiler, indices[i]->type);
     }
 
     inst->type = duskTypeNewPointer(
         module->compiler, accessed_type, storage_class, alignment);
-    duskTypeMarkNotDead(inst->type);
+    duskTypeMarkNotDead(module->compiler, inst->type);
 
     duskIRBlockAppendInst(block, inst);
     return inst;
@@ -658,7 +825,7 @@ DuskIRValue *duskIRCreateCompositeExtract(
         index_count * sizeof(uint32_t));
 
     inst->type = accessed_type;
-    duskTypeMarkNotDead(inst->type);
+    duskTypeMarkNotDead(module->compiler, inst->type);
 
     duskIRBlockAppendInst(block, inst);
     return inst;
@@ -690,7 +857,7 @@ DuskIRValue *duskIRCreateVectorShuffle(
 
     inst->type = duskTypeNewVector(
         module->compiler, vec1->type->vector.sub, (uint32_t)index_count);
-    duskTypeMarkNotDead(inst->type);
+    duskTypeMarkNotDead(module->compiler, inst->type);
 
     duskIRBlockAppendInst(block, inst);
     return inst;
@@ -714,7 +881,7 @@ DuskIRValue *duskIRCreateCompositeConstruct(
         value_count * sizeof(DuskIRValue *));
 
     inst->type = composite_type;
-    duskTypeMarkNotDead(inst->type);
+    duskTypeMarkNotDead(module->compiler, inst->type);
 
     duskIRBlockAppendInst(block, inst);
     return inst;
@@ -731,7 +898,7 @@ DuskIRValue *duskIRCreateCast(
     inst->cast.value = value;
 
     inst->type = destination_type;
-    duskTypeMarkNotDead(inst->type);
+    duskTypeMarkNotDead(module->compiler, inst->type);
 
     duskIRBlockAppendInst(block, inst);
     return inst;
@@ -756,7 +923,7 @@ DuskIRValue *duskIRCreateBuiltinCall(
         inst->builtin_call.params, params, sizeof(DuskIRValue *) * param_count);
 
     inst->type = destination_type;
-    duskTypeMarkNotDead(inst->type);
+    duskTypeMarkNotDead(module->compiler, inst->type);
 
     duskIRBlockAppendInst(block, inst);
     return inst;
@@ -777,7 +944,7 @@ DuskIRValue *duskIRCreateBinaryOperation(
     inst->binary.right = right;
 
     inst->type = destination_type;
-    duskTypeMarkNotDead(inst->type);
+    duskTypeMarkNotDead(module->compiler, inst->type);
 
     duskIRBlockAppendInst(block, inst);
     return inst;
@@ -796,7 +963,7 @@ DuskIRValue *duskIRCreateUnaryOperation(
     inst->unary.right = right;
 
     inst->type = destination_type;
-    duskTypeMarkNotDead(inst->type);
+    duskTypeMarkNotDead(module->compiler, inst->type);
 
     duskIRBlockAppendInst(block, inst);
     return inst;
@@ -825,21 +992,28 @@ duskIRLoadLvalue(DuskIRModule *module, DuskIRValue *block, DuskIRValue *value)
     return value;
 }
 
+static uint32_t duskGetTypeId(DuskIRModule *module, DuskType *type)
+{
+    return module->type_infos[type->index].id;
+}
+
 static void duskEmitType(DuskIRModule *module, DuskType *type)
 {
-    if (!type->emit) return;
+    DuskIRTypeInfo *info = &module->type_infos[type->index];
+    if (info->id == 0 || info->emitted) return;
 
-    type->emit = false;
+    info->emitted = true;
+    uint32_t id = info->id;
 
     DuskAllocator *allocator = module->allocator;
 
     switch (type->kind) {
     case DUSK_TYPE_VOID: {
-        duskEncodeInst(module, SpvOpTypeVoid, &type->id, 1);
+        duskEncodeInst(module, SpvOpTypeVoid, &id, 1);
         break;
     }
     case DUSK_TYPE_BOOL: {
-        duskEncodeInst(module, SpvOpTypeBool, &type->id, 1);
+        duskEncodeInst(module, SpvOpTypeBool, &id, 1);
         break;
     }
     case DUSK_TYPE_STRING: {
@@ -848,13 +1022,13 @@ static void duskEmitType(DuskIRModule *module, DuskType *type)
     }
     case DUSK_TYPE_INT: {
         uint32_t params[3] = {
-            type->id, type->int_.bits, (uint32_t)type->int_.is_signed};
+            id, type->int_.bits, (uint32_t)type->int_.is_signed};
         duskEncodeInst(
             module, SpvOpTypeInt, params, DUSK_CARRAY_LENGTH(params));
         break;
     }
     case DUSK_TYPE_FLOAT: {
-        uint32_t params[2] = {type->id, type->float_.bits};
+        uint32_t params[2] = {id, type->float_.bits};
         duskEncodeInst(
             module, SpvOpTypeFloat, params, DUSK_CARRAY_LENGTH(params));
         break;
@@ -895,7 +1069,11 @@ static void duskEmitType(DuskIRModule *module, DuskType *type)
         case DUSK_STORAGE_CLASS_PARAMETER: DUSK_ASSERT(0); break;
         }
 
-        uint32_t params[3] = {type->id, storage_class, type->pointer.sub->id};
+        uint32_t params[3] = {
+            id,
+            storage_class,
+            duskGetTypeId(module, type->pointer.sub),
+        };
         duskEncodeInst(
             module, SpvOpTypePointer, params, DUSK_CARRAY_LENGTH(params));
         break;
@@ -903,19 +1081,19 @@ static void duskEmitType(DuskIRModule *module, DuskType *type)
     case DUSK_TYPE_RUNTIME_ARRAY: {
         duskEmitType(module, type->array.sub);
 
-        uint32_t params[2] = {type->id, type->array.sub->id};
+        uint32_t params[2] = {id, duskGetTypeId(module, type->array.sub)};
         duskEncodeInst(
             module, SpvOpTypeRuntimeArray, params, DUSK_CARRAY_LENGTH(params));
         break;
     }
     case DUSK_TYPE_ARRAY: {
-        DUSK_ASSERT(type->array.size_ir_value);
+        DUSK_ASSERT(info->array_size);
 
         duskEmitType(module, type->array.sub);
-        duskEmitValue(module, type->array.size_ir_value);
+        duskEmitValue(module, info->array_size);
 
         uint32_t params[3] = {
-            type->id, type->array.sub->id, type->array.size_ir_value->id};
+            id, duskGetTypeId(module, type->array.sub), info->array_size->id};
         duskEncodeInst(
             module, SpvOpTypeArray, params, DUSK_CARRAY_LENGTH(params));
         break;
@@ -924,7 +1102,7 @@ static void duskEmitType(DuskIRModule *module, DuskType *type)
         duskEmitType(module, type->vector.sub);
 
         uint32_t params[3] = {
-            type->id, type->vector.sub->id, type->vector.size};
+            id, duskGetTypeId(module, type->vector.sub), type->vector.size};
         duskEncodeInst(
             module, SpvOpTypeVector, params, DUSK_CARRAY_LENGTH(params));
         break;
@@ -933,7 +1111,10 @@ static void duskEmitType(DuskIRModule *module, DuskType *type)
         duskEmitType(module, type->matrix.col_type);
 
         uint32_t params[3] = {
-            type->id, type->matrix.col_type->id, type->matrix.cols};
+            id,
+            duskGetTypeId(module, type->matrix.col_type),
+            type->matrix.cols,
+        };
         duskEncodeInst(
             module, SpvOpTypeMatrix, params, DUSK_CARRAY_LENGTH(params));
         break;
@@ -950,12 +1131,12 @@ static void duskEmitType(DuskIRModule *module, DuskType *type)
         uint32_t param_count = 2 + (uint32_t)func_param_count;
         uint32_t *params = DUSK_NEW_ARRAY(allocator, uint32_t, param_count);
 
-        params[0] = type->id;
-        params[1] = type->function.return_type->id;
+        params[0] = id;
+        params[1] = duskGetTypeId(module, type->function.return_type);
 
         for (size_t i = 0; i < func_param_count; ++i) {
             DuskType *param_type = type->function.param_types[i];
-            params[2 + i] = param_type->id;
+            params[2 + i] = duskGetTypeId(module, param_type);
         }
 
         duskEncodeInst(module, SpvOpTypeFunction, params, param_count);
@@ -970,17 +1151,18 @@ static void duskEmitType(DuskIRModule *module, DuskType *type)
 
         uint32_t word_count = 1 + (uint32_t)field_count;
         uint32_t *params = DUSK_NEW_ARRAY(allocator, uint32_t, word_count);
-        params[0] = type->id;
+        params[0] = id;
 
         for (size_t i = 0; i < field_count; ++i) {
-            params[1 + i] = type->struct_.field_types[i]->id;
+            params[1 + i] =
+                duskGetTypeId(module, type->struct_.field_types[i]);
         }
 
         duskEncodeInst(module, SpvOpTypeStruct, params, word_count);
         break;
     }
     case DUSK_TYPE_SAMPLER: {
-        duskEncodeInst(module, SpvOpTypeSampler, &type->id, 1);
+        duskEncodeInst(module, SpvOpTypeSampler, &id, 1);
         break;
     }
     case DUSK_TYPE_IMAGE: {
@@ -995,8 +1177,8 @@ static void duskEmitType(DuskIRModule *module, DuskType *type)
         }
 
         uint32_t params[] = {
-            type->id,
-            type->image.sampled_type->id,
+            id,
+            duskGetTypeId(module, type->image.sampled_type),
             dim,
             type->image.depth,
             type->image.arrayed,
@@ -1012,8 +1194,8 @@ static void duskEmitType(DuskIRModule *module, DuskType *type)
         duskEmitType(module, type->sampled_image.image_type);
 
         uint32_t params[] = {
-            type->id,
-            type->sampled_image.image_type->id,
+            id,
+            duskGetTypeId(module, type->sampled_image.image_type),
         };
         duskEncodeInst(
             module, SpvOpTypeSampledImage, params, DUSK_CARRAY_LENGTH(params));
@@ -1156,10 +1338,10 @@ static void duskEmitValue(DuskIRModule *module, DuskIRValue *value)
         }
 
         DUSK_ASSERT(value->id != 0);
-        DUSK_ASSERT(value->type->id != 0);
+        DUSK_ASSERT(duskGetTypeId(module, value->type) != 0);
 
         uint32_t params[3] = {
-            value->type->id,
+            duskGetTypeId(module, value->type),
             value->id,
             (uint32_t)storage_class,
         };
@@ -1183,6 +1365,10 @@ static void duskEmitValue(DuskIRModule *module, DuskIRValue *value)
         duskEncodeInst(module, SpvOpKill, NULL, 0);
         break;
     }
+    case DUSK_IR_VALUE_UNREACHABLE: {
+        duskEncodeInst(module, SpvOpUnreachable, NULL, 0);
+        break;
+    }
     case DUSK_IR_VALUE_CONSTANT: {
         DUSK_ASSERT(
             value->type->kind == DUSK_TYPE_INT ||
@@ -1192,7 +1378,7 @@ static void duskEmitValue(DuskIRModule *module, DuskIRValue *value)
 
         size_t param_count = 2 + value->constant.value_word_count;
         uint32_t *params = DUSK_NEW_ARRAY(allocator, uint32_t, param_count);
-        params[0] = value->type->id;
+        params[0] = duskGetTypeId(module, value->type);
         params[1] = value->id;
         memcpy(
             &params[2],
@@ -1206,7 +1392,7 @@ static void duskEmitValue(DuskIRModule *module, DuskIRValue *value)
 
         duskEmitType(module, value->type);
 
-        uint32_t params[2] = {value->type->id, value->id};
+        uint32_t params[2] = {duskGetTypeId(module, value->type), value->id};
         duskEncodeInst(
             module,
             value->const_bool.value ? SpvOpConstantTrue : SpvOpConstantFalse,
@@ -1222,7 +1408,7 @@ static void duskEmitValue(DuskIRModule *module, DuskIRValue *value)
         size_t param_count = 2 + literal_count;
         uint32_t *params =
             duskAllocate(allocator, sizeof(uint32_t) * param_count);
-        params[0] = value->type->id;
+        params[0] = duskGetTypeId(module, value->type);
         params[1] = value->id;
         for (size_t i = 0; i < literal_count; ++i) {
             params[2 + i] = value->constant_composite.values_arr[i]->id;
@@ -1234,15 +1420,17 @@ static void duskEmitValue(DuskIRModule *module, DuskIRValue *value)
     }
     case DUSK_IR_VALUE_FUNCTION: {
         {
-            DUSK_ASSERT(value->type->function.return_type->id > 0);
+            uint32_t return_type_id =
+                duskGetTypeId(module, value->type->function.return_type);
+            DUSK_ASSERT(return_type_id > 0);
             DUSK_ASSERT(value->id > 0);
-            DUSK_ASSERT(value->type->id > 0);
+            DUSK_ASSERT(duskGetTypeId(module, value->type) > 0);
 
             uint32_t params[4] = {
-                value->type->function.return_type->id,
+                return_type_id,
                 value->id,
                 SpvFunctionControlMaskNone,
-                value->type->id,
+                duskGetTypeId(module, value->type),
             };
             duskEncodeInst(
                 module, SpvOpFunction, params, DUSK_CARRAY_LENGTH(params));
@@ -1301,7 +1489,7 @@ static void duskEmitValue(DuskIRModule *module, DuskIRValue *value)
         DUSK_ASSERT(value->id > 0);
 
         uint32_t params[3] = {
-            value->type->id,
+            duskGetTypeId(module, value->type),
             value->id,
             value->load.pointer->id,
         };
@@ -1315,7 +1503,7 @@ static void duskEmitValue(DuskIRModule *module, DuskIRValue *value)
         size_t param_count = 3 + func_param_count;
         uint32_t *params =
             duskAllocate(allocator, sizeof(uint32_t) * param_count);
-        params[0] = value->type->id;
+        params[0] = duskGetTypeId(module, value->type);
         params[1] = value->id;
         params[2] = value->function_call.function->id;
         for (size_t i = 0; i < func_param_count; ++i) {
@@ -1326,7 +1514,7 @@ static void duskEmitValue(DuskIRModule *module, DuskIRValue *value)
         break;
     }
     case DUSK_IR_VALUE_ACCESS_CHAIN: {
-        DUSK_ASSERT(value->type->id > 0);
+        DUSK_ASSERT(duskGetTypeId(module, value->type) > 0);
         DUSK_ASSERT(value->id > 0);
         DUSK_ASSERT(value->access_chain.base->id > 0);
 
@@ -1334,7 +1522,7 @@ static void duskEmitValue(DuskIRModule *module, DuskIRValue *value)
         size_t param_count = 3 + literal_count;
         uint32_t *params =
             duskAllocate(allocator, sizeof(uint32_t) * param_count);
-        params[0] = value->type->id;
+        params[0] = duskGetTypeId(module, value->type);
         params[1] = value->id;
         params[2] = value->access_chain.base->id;
         for (size_t i = 0; i < literal_count; ++i) {
@@ -1346,7 +1534,7 @@ static void duskEmitValue(DuskIRModule *module, DuskIRValue *value)
         break;
     }
     case DUSK_IR_VALUE_COMPOSITE_EXTRACT: {
-        DUSK_ASSERT(value->type->id > 0);
+        DUSK_ASSERT(duskGetTypeId(module, value->type) > 0);
         DUSK_ASSERT(value->id > 0);
         DUSK_ASSERT(value->composite_extract.composite->id > 0);
 
@@ -1355,7 +1543,7 @@ static void duskEmitValue(DuskIRModule *module, DuskIRValue *value)
         size_t param_count = 3 + literal_count;
         uint32_t *params =
             duskAllocate(allocator, sizeof(uint32_t) * param_count);
-        params[0] = value->type->id;
+        params[0] = duskGetTypeId(module, value->type);
         params[1] = value->id;
         params[2] = value->composite_extract.composite->id;
         for (size_t i = 0; i < literal_count; ++i) {
@@ -1365,8 +1553,30 @@ static void duskEmitValue(DuskIRModule *module, DuskIRValue *value)
         duskEncodeInst(module, SpvOpCompositeExtract, params, param_count);
         break;
     }
+    case DUSK_IR_VALUE_COMPOSITE_INSERT: {
+        DUSK_ASSERT(duskGetTypeId(module, value->type) > 0);
+        DUSK_ASSERT(value->id > 0);
+        DUSK_ASSERT(value->composite_insert.object->id > 0);
+        DUSK_ASSERT(value->composite_insert.composite->id > 0);
+
+        size_t literal_count =
+            duskArrayLength(value->composite_insert.indices_arr);
+        size_t param_count = 4 + literal_count;
+        uint32_t *params =
+            duskAllocate(allocator, sizeof(uint32_t) * param_count);
+        params[0] = duskGetTypeId(module, value->type);
+        params[1] = value->id;
+        params[2] = value->composite_insert.object->id;
+        params[3] = value->composite_insert.composite->id;
+        for (size_t i = 0; i < literal_count; ++i) {
+            params[4 + i] = value->composite_insert.indices_arr[i];
+        }
+
+        duskEncodeInst(module, SpvOpCompositeInsert, params, param_count);
+        break;
+    }
     case DUSK_IR_VALUE_VECTOR_SHUFFLE: {
-        DUSK_ASSERT(value->type->id > 0);
+        DUSK_ASSERT(duskGetTypeId(module, value->type) > 0);
         DUSK_ASSERT(value->id > 0);
         DUSK_ASSERT(value->vector_shuffle.vec1->id > 0);
         DUSK_ASSERT(value->vector_shuffle.vec2->id > 0);
@@ -1376,7 +1586,7 @@ static void duskEmitValue(DuskIRModule *module, DuskIRValue *value)
         size_t param_count = 4 + literal_count;
         uint32_t *params =
             duskAllocate(allocator, sizeof(uint32_t) * param_count);
-        params[0] = value->type->id;
+        params[0] = duskGetTypeId(module, value->type);
         params[1] = value->id;
         params[2] = value->vector_shuffle.vec1->id;
         params[3] = value->vector_shuffle.vec2->id;
@@ -1388,7 +1598,7 @@ static void duskEmitValue(DuskIRModule *module, DuskIRValue *value)
         break;
     }
     case DUSK_IR_VALUE_COMPOSITE_CONSTRUCT: {
-        DUSK_ASSERT(value->type->id > 0);
+        DUSK_ASSERT(duskGetTypeId(module, value->type) > 0);
         DUSK_ASSERT(value->id > 0);
 
         size_t literal_count =
@@ -1396,7 +1606,7 @@ static void duskEmitValue(DuskIRModule *module, DuskIRValue *value)
         size_t param_count = 2 + literal_count;
         uint32_t *params =
             duskAllocate(allocator, sizeof(uint32_t) * param_count);
-        params[0] = value->type->id;
+        params[0] = duskGetTypeId(module, value->type);
         params[1] = value->id;
         for (size_t i = 0; i < literal_count; ++i) {
             params[2 + i] = value->composite_construct.values_arr[i]->id;
@@ -1410,7 +1620,7 @@ static void duskEmitValue(DuskIRModule *module, DuskIRValue *value)
         DUSK_ASSERT(value->id > 0);
 
         uint32_t params[2] = {
-            value->type->id,
+            duskGetTypeId(module, value->type),
             value->id,
         };
         duskEncodeInst(
@@ -1421,7 +1631,7 @@ static void duskEmitValue(DuskIRModule *module, DuskIRValue *value)
         SpvOp op = 0;
 
         uint32_t params[3] = {
-            value->type->id,
+            duskGetTypeId(module, value->type),
             value->id,
             value->cast.value->id,
         };
@@ -1636,7 +1846,7 @@ static void duskEmitValue(DuskIRModule *module, DuskIRValue *value)
         if (glsl_inst != 0) {
             size_t param_count = 4 + value->builtin_call.param_count;
             uint32_t *params = DUSK_NEW_ARRAY(allocator, uint32_t, param_count);
-            params[0] = value->type->id;
+            params[0] = duskGetTypeId(module, value->type);
             params[1] = value->id;
             params[2] = module->glsl_ext_inst_id;
             params[3] = glsl_inst;
@@ -1655,7 +1865,7 @@ static void duskEmitValue(DuskIRModule *module, DuskIRValue *value)
                 size_t param_count = 6;
                 uint32_t *params =
                     DUSK_NEW_ARRAY(allocator, uint32_t, param_count);
-                params[0] = value->type->id;
+                params[0] = duskGetTypeId(module, value->type);
                 params[1] = value->id;
 
                 params[2] = value->builtin_call.params[0]->id;
@@ -1670,7 +1880,7 @@ static void duskEmitValue(DuskIRModule *module, DuskIRValue *value)
                 size_t param_count = 2 + value->builtin_call.param_count;
                 uint32_t *params =
                     DUSK_NEW_ARRAY(allocator, uint32_t, param_count);
-                params[0] = value->type->id;
+                params[0] = duskGetTypeId(module, value->type);
                 params[1] = value->id;
 
                 for (size_t i = 0; i < value->builtin_call.param_count; ++i) {
@@ -1702,7 +1912,9 @@ static void duskEmitValue(DuskIRModule *module, DuskIRValue *value)
         if (left_type != right_type) {
             DUSK_ASSERT(
                 left_type->kind == DUSK_TYPE_VECTOR ||
-                right_type->kind == DUSK_TYPE_VECTOR);
+                right_type->kind == DUSK_TYPE_VECTOR ||
+                left_type->kind == DUSK_TYPE_MATRIX ||
+                right_type->kind == DUSK_TYPE_MATRIX);
             DUSK_ASSERT(value->binary.op == DUSK_BINARY_OP_MUL);
         }
 
@@ -1928,13 +2140,13 @@ static void duskEmitValue(DuskIRModule *module, DuskIRValue *value)
         case DUSK_BINARY_OP_MAX: DUSK_ASSERT(0); break;
         }
 
-        DUSK_ASSERT(value->type->id);
+        DUSK_ASSERT(duskGetTypeId(module, value->type));
         DUSK_ASSERT(value->id);
         DUSK_ASSERT(value->binary.left->id);
         DUSK_ASSERT(value->binary.right->id);
 
         uint32_t params[4] = {
-            value->type->id,
+            duskGetTypeId(module, value->type),
             value->id,
             left_val_id,
             right_val_id,
@@ -1959,12 +2171,12 @@ static void duskEmitValue(DuskIRModule *module, DuskIRValue *value)
             }
             break;
         }
-        case DUSK_UNARY_OP_NOT: op = SpvOpNot; break;
-        case DUSK_UNARY_OP_BITNOT: op = SpvOpBitReverse; break;
+        case DUSK_UNARY_OP_NOT: op = SpvOpLogicalNot; break;
+        case DUSK_UNARY_OP_BITNOT: op = SpvOpNot; break;
         }
 
         uint32_t params[3] = {
-            value->type->id,
+            duskGetTypeId(module, value->type),
             value->id,
             value->unary.right->id,
         };
@@ -1996,19 +2208,37 @@ static void duskEmitValue(DuskIRModule *module, DuskIRValue *value)
         break;
     }
     case DUSK_IR_VALUE_LOOP_MERGE: {
-        uint32_t params[3] = {
+        uint32_t params[4] = {
             value->loop_merge.merge_block->id,
             value->loop_merge.continue_block->id,
-            0x0, // None
+            SpvLoopControlMaskNone,
+            value->loop_merge.unroll_count,
         };
-        duskEncodeInst(
-            module, SpvOpLoopMerge, params, DUSK_CARRAY_LENGTH(params));
+        size_t param_count = 3;
+
+        switch (value->loop_merge.unroll_hint) {
+        case DUSK_IR_UNROLL_DEFAULT: break;
+        case DUSK_IR_UNROLL_ALWAYS: {
+            params[2] = SpvLoopControlUnrollMask;
+            if (value->loop_merge.unroll_count > 0) {
+                params[2] |= SpvLoopControlPartialCountMask;
+                param_count = 4;
+            }
+            break;
+        }
+        case DUSK_IR_UNROLL_NEVER: {
+            params[2] = SpvLoopControlDontUnrollMask;
+            break;
+        }
+        }
+
+        duskEncodeInst(module, SpvOpLoopMerge, params, param_count);
         break;
     }
     case DUSK_IR_VALUE_PHI: {
         size_t param_count = 2 + value->phi.pair_count * 2;
         uint32_t *params = DUSK_NEW_ARRAY(allocator, uint32_t, param_count);
-        params[0] = value->type->id;
+        params[0] = duskGetTypeId(module, value->type);
         params[1] = value->id;
         for (size_t i = 0; i < value->phi.pair_count; ++i) {
             params[2 + i * 2] = value->phi.pairs[i].value->id;
@@ -2019,7 +2249,7 @@ static void duskEmitValue(DuskIRModule *module, DuskIRValue *value)
     }
     case DUSK_IR_VALUE_ARRAY_LENGTH: {
         uint32_t params[4] = {
-            value->type->id,
+            duskGetTypeId(module, value->type),
             value->id,
             value->array_length.struct_ptr->id,
             value->array_length.struct_member_index,
@@ -2031,19 +2261,229 @@ static void duskEmitValue(DuskIRModule *module, DuskIRValue *value)
     }
 }
 
+// Types and constants are interned, so the order they were created in depends
+// on which function asked for them first, on the threads that generated the
+// function bodies and on what was compiled before. They're emitted in an order
+// derived from their contents instead, so the same file always compiles to the
+// same bytes.
+
+static int duskCompareTypes(const void *a, const void *b)
+{
+    DuskType *type_a = *(DuskType *const *)a;
+    DuskType *type_b = *(DuskType *const *)b;
+    // Type strings are unique, they're made of what identifies the type
+    return strcmp(type_a->string, type_b->string);
+}
+
+static int duskCompareConsts(DuskIRValue *a, DuskIRValue *b)
+{
+    if (a == b) return 0;
+
+    int result = strcmp(a->type->string, b->type->string);
+    if (result != 0) return result;
+    if (a->kind != b->kind) return a->kind < b->kind ? -1 : 1;
+
+    switch (a->kind) {
+    case DUSK_IR_VALUE_CONSTANT_BOOL: {
+        return (int)a->const_bool.value - (int)b->const_bool.value;
+    }
+    case DUSK_IR_VALUE_CONSTANT: {
+        size_t word_count = a->constant.value_word_count;
+        if (word_count != b->constant.value_word_count) {
+            return word_count < b->constant.value_word_count ? -1 : 1;
+        }
+        for (size_t i = 0; i < word_count; ++i) {
+            uint32_t word_a = a->constant.value_words[i];
+            uint32_t word_b = b->constant.value_words[i];
+            if (word_a != word_b) return word_a < word_b ? -1 : 1;
+        }
+        return 0;
+    }
+    case DUSK_IR_VALUE_CONSTANT_COMPOSITE: {
+        DuskArray(DuskIRValue *) values_a = a->constant_composite.values_arr;
+        DuskArray(DuskIRValue *) values_b = b->constant_composite.values_arr;
+        size_t value_count = duskArrayLength(values_a);
+        if (value_count != duskArrayLength(values_b)) {
+            return value_count < duskArrayLength(values_b) ? -1 : 1;
+        }
+        for (size_t i = 0; i < value_count; ++i) {
+            result = duskCompareConsts(values_a[i], values_b[i]);
+            if (result != 0) return result;
+        }
+        return 0;
+    }
+    default: DUSK_ASSERT(0); break;
+    }
+
+    return 0;
+}
+
+typedef struct DuskConstOrder {
+    DuskIRValue *value;
+    uint32_t depth;
+} DuskConstOrder;
+
+// Composites have to come after their elements
+static uint32_t duskConstDepth(DuskIRValue *value)
+{
+    if (value->kind != DUSK_IR_VALUE_CONSTANT_COMPOSITE) return 0;
+
+    uint32_t depth = 0;
+    DuskArray(DuskIRValue *) values_arr = value->constant_composite.values_arr;
+    for (size_t i = 0; i < duskArrayLength(values_arr); ++i) {
+        uint32_t value_depth = duskConstDepth(values_arr[i]) + 1;
+        if (value_depth > depth) depth = value_depth;
+    }
+    return depth;
+}
+
+static int duskCompareConstOrders(const void *a, const void *b)
+{
+    const DuskConstOrder *order_a = a;
+    const DuskConstOrder *order_b = b;
+    if (order_a->depth != order_b->depth) {
+        return order_a->depth < order_b->depth ? -1 : 1;
+    }
+    return duskCompareConsts(order_a->value, order_b->value);
+}
+
+static int duskCompareCapabilities(const void *a, const void *b)
+{
+    uint32_t capability_a = *(const uint32_t *)a;
+    uint32_t capability_b = *(const uint32_t *)b;
+    if (capability_a == capability_b) return 0;
+    return capability_a < capability_b ? -1 : 1;
+}
+
+static bool duskIsImageQuery(DuskBuiltinFunctionKind builtin_kind)
+{
+    switch (builtin_kind) {
+    case DUSK_BUILTIN_FUNCTION_IMAGE_QUERY_LEVELS:
+    case DUSK_BUILTIN_FUNCTION_IMAGE_QUERY_LOD:
+    case DUSK_BUILTIN_FUNCTION_IMAGE_QUERY_SIZE: return true;
+    default: return false;
+    }
+}
+
+static int duskCompareExtensions(const void *a, const void *b)
+{
+    return strcmp(*(const char *const *)a, *(const char *const *)b);
+}
+
+static void duskSortTypes(
+    DuskCompiler *compiler, DuskArray(DuskType *) * types_arr)
+{
+    DuskAllocator *allocator = duskArenaGetAllocator(compiler->main_arena);
+    for (size_t i = 0; i < duskArrayLength(compiler->referenced_types_arr);
+         ++i) {
+        DuskType *type = compiler->referenced_types_arr[i];
+        // Memoized in the type, so it's allocated where the type lives.
+        // Builtin types already have theirs.
+        duskTypeToString(allocator, type);
+        duskArrayPush(types_arr, type);
+    }
+
+    size_t type_count = duskArrayLength(*types_arr);
+    if (type_count == 0) return;
+
+    qsort(*types_arr, type_count, sizeof(DuskType *), duskCompareTypes);
+
+    // Types can be marked again after the epoch changes
+    size_t unique_count = 0;
+    for (size_t i = 0; i < type_count; ++i) {
+        DuskType *type = (*types_arr)[i];
+        if (unique_count > 0 && (*types_arr)[unique_count - 1] == type) {
+            continue;
+        }
+        (*types_arr)[unique_count++] = type;
+    }
+    duskArrayResize(types_arr, unique_count);
+}
+
+static void duskSortConsts(DuskCompiler *compiler, DuskIRModule *module)
+{
+    DuskAllocator *type_allocator =
+        duskArenaGetAllocator(compiler->main_arena);
+    size_t const_count = duskArrayLength(module->consts_arr);
+    if (const_count == 0) return;
+
+    DuskConstOrder *orders =
+        DUSK_NEW_ARRAY(module->allocator, DuskConstOrder, const_count);
+    for (size_t i = 0; i < const_count; ++i) {
+        DuskIRValue *value = module->consts_arr[i];
+        duskTypeToString(type_allocator, value->type);
+        orders[i].value = value;
+        orders[i].depth = duskConstDepth(value);
+    }
+
+    qsort(orders, const_count, sizeof(DuskConstOrder), duskCompareConstOrders);
+
+    for (size_t i = 0; i < const_count; ++i) {
+        module->consts_arr[i] = orders[i].value;
+    }
+}
+
+// Capabilities and extensions are requested once per use, and their order
+// depends on the order of the functions that use them
+static void duskSortRequirements(DuskIRModule *module)
+{
+    size_t capability_count = duskArrayLength(module->capabilities_arr);
+    qsort(
+        module->capabilities_arr,
+        capability_count,
+        sizeof(uint32_t),
+        duskCompareCapabilities);
+
+    size_t unique_count = 0;
+    for (size_t i = 0; i < capability_count; ++i) {
+        uint32_t capability = module->capabilities_arr[i];
+        if (unique_count > 0 &&
+            module->capabilities_arr[unique_count - 1] == capability) {
+            continue;
+        }
+        module->capabilities_arr[unique_count++] = capability;
+    }
+    duskArrayResize(&module->capabilities_arr, unique_count);
+
+    size_t extension_count = duskArrayLength(module->extensions_arr);
+    if (extension_count == 0) return;
+
+    qsort(
+        module->extensions_arr,
+        extension_count,
+        sizeof(const char *),
+        duskCompareExtensions);
+
+    unique_count = 0;
+    for (size_t i = 0; i < extension_count; ++i) {
+        const char *ext = module->extensions_arr[i];
+        if (unique_count > 0 &&
+            strcmp(module->extensions_arr[unique_count - 1], ext) == 0) {
+            continue;
+        }
+        module->extensions_arr[unique_count++] = ext;
+    }
+    duskArrayResize(&module->extensions_arr, unique_count);
+}
+
 DuskArray(uint32_t)
     duskIRModuleEmit(DuskCompiler *compiler, DuskIRModule *module)
 {
     DuskAllocator *allocator = module->allocator;
 
-    for (size_t i = 0; i < duskArrayLength(compiler->types_arr); ++i) {
-        DuskType *type = compiler->types_arr[i];
+    size_t type_count = duskTypeBuiltinCount() + compiler->type_count;
+    module->type_infos = DUSK_NEW_ARRAY(allocator, DuskIRTypeInfo, type_count);
+
+    // Marking the uint type can append to the array
+    for (size_t i = 0; i < duskArrayLength(compiler->referenced_types_arr);
+         ++i) {
+        DuskType *type = compiler->referenced_types_arr[i];
         switch (type->kind) {
         case DUSK_TYPE_ARRAY: {
             DuskType *uint_type =
                 duskTypeNewScalar(compiler, DUSK_SCALAR_TYPE_UINT);
-            uint_type->emit = true;
-            type->array.size_ir_value =
+            duskTypeMarkNotDead(compiler, uint_type);
+            module->type_infos[type->index].array_size =
                 duskIRConstIntCreate(module, uint_type, type->array.size);
             break;
         }
@@ -2051,6 +2491,12 @@ DuskArray(uint32_t)
         }
     }
 
+    // Globals and functions are emitted in the order they're declared in,
+    // which only depends on the source
+    DuskArray(DuskType *) types_arr = duskArrayCreate(allocator, DuskType *);
+    duskSortTypes(compiler, &types_arr);
+    duskSortConsts(compiler, module);
+
     bool got_byte_type = false;
     bool got_short_type = false;
     bool got_long_type = false;
@@ -2058,76 +2504,94 @@ DuskArray(uint32_t)
     bool got_double_type = false;
     bool got_buffer_pointer_type = false;
 
-    for (size_t i = 0; i < duskArrayLength(compiler->types_arr); ++i) {
-        DuskType *type = compiler->types_arr[i];
-        if (type->emit) {
-            type->id = duskReserveId(module);
-
-            if (!got_buffer_pointer_type && type->kind == DUSK_TYPE_POINTER &&
-                type->pointer.storage_class ==
-                    DUSK_STORAGE_CLASS_PHYSICAL_STORAGE) {
-                got_buffer_pointer_type = true;
-                duskArrayPush(
-                    &module->capabilities_arr,
-                    SpvCapabilityPhysicalStorageBufferAddresses);
-            }
+    for (size_t i = 0; i < duskArrayLength(types_arr); ++i) {
+        DuskType *type = types_arr[i];
+        module->type_infos[type->index].id = duskReserveId(module);
 
-            if (!got_byte_type && type->kind == DUSK_TYPE_INT &&
-                type->int_.bits == 8) {
-                got_byte_type = true;
-                duskArrayPush(&module->capabilities_arr, SpvCapabilityInt8);
-            }
+        if (!got_buffer_pointer_type && type->kind == DUSK_TYPE_POINTER &&
+            type->pointer.storage_class ==
+                DUSK_STORAGE_CLASS_PHYSICAL_STORAGE) {
+            got_buffer_pointer_type = true;
+            duskArrayPush(
+                &module->capabilities_arr,
+                SpvCapabilityPhysicalStorageBufferAddresses);
+        }
 
-            if (!got_short_type && type->kind == DUSK_TYPE_INT &&
-                type->int_.bits == 16) {
-                got_short_type = true;
-                duskArrayPush(&module->capabilities_arr, SpvCapabilityInt16);
-            }
+        if (!got_byte_type && type->kind == DUSK_TYPE_INT &&
+            type->int_.bits == 8) {
+            got_byte_type = true;
+            duskArrayPush(&module->capabilities_arr, SpvCapabilityInt8);
+        }
 
-            if (!got_long_type && type->kind == DUSK_TYPE_INT &&
-                type->int_.bits == 64) {
-                got_long_type = true;
-                duskArrayPush(&module->capabilities_arr, SpvCapabilityInt64);
-            }
+        if (!got_short_type && type->kind == DUSK_TYPE_INT &&
+            type->int_.bits == 16) {
+            got_short_type = true;
+            duskArrayPush(&module->capabilities_arr, SpvCapabilityInt16);
+        }
 
-            if (!got_half_type && type->kind == DUSK_TYPE_FLOAT &&
-                type->float_.bits == 16) {
-                got_half_type = true;
-                duskArrayPush(&module->capabilities_arr, SpvCapabilityFloat16);
-            }
+        if (!got_long_type && type->kind == DUSK_TYPE_INT &&
+            type->int_.bits == 64) {
+            got_long_type = true;
+            duskArrayPush(&module->capabilities_arr, SpvCapabilityInt64);
+        }
 
-            if (!got_double_type && type->kind == DUSK_TYPE_FLOAT &&
-                type->float_.bits == 64) {
-                got_double_type = true;
-                duskArrayPush(&module->capabilities_arr, SpvCapabilityFloat64);
-            }
+        if (!got_half_type && type->kind == DUSK_TYPE_FLOAT &&
+            type->float_.bits == 16) {
+            got_half_type = true;
+            duskArrayPush(&module->capabilities_arr, SpvCapabilityFloat16);
+        }
+
+        if (!got_double_type && type->kind == DUSK_TYPE_FLOAT &&
+            type->float_.bits == 64) {
+            got_double_type = true;
+            duskArrayPush(&module->capabilities_arr, SpvCapabilityFloat64);
         }
     }
 
+    // The modules split from the same one share their values, so every value
+    // is emitted again. The capabilities that depend on the values are only
+    // required by the modules that use them.
+    bool got_image_query = false;
+    bool got_descriptor_array = false;
+
     for (size_t i = 0; i < duskArrayLength(module->consts_arr); ++i) {
         DuskIRValue *value = module->consts_arr[i];
         value->id = duskReserveId(module);
+        value->emitted = false;
     }
 
     for (size_t i = 0; i < duskArrayLength(module->globals_arr); ++i) {
         DuskIRValue *value = module->globals_arr[i];
         value->id = duskReserveId(module);
+        value->emitted = false;
+
+        if (!got_descriptor_array &&
+            value->type->pointer.sub->kind == DUSK_TYPE_RUNTIME_ARRAY) {
+            got_descriptor_array = true;
+            duskArrayPush(
+                &module->extensions_arr, "SPV_EXT_descriptor_indexing");
+            duskArrayPush(
+                &module->capabilities_arr, SpvCapabilityRuntimeDescriptorArray);
+        }
     }
 
     for (size_t i = 0; i < duskArrayLength(module->functions_arr); ++i) {
         DuskIRValue *function = module->functions_arr[i];
         function->id = duskReserveId(module);
+        function->emitted = false;
 
         for (size_t j = 0; j < duskArrayLength(function->function.params_arr);
              ++j) {
             DuskIRValue *param = function->function.params_arr[j];
             param->id = duskReserveId(module);
+            param->emitted = false;
         }
 
         for (size_t j = 0; j < duskArrayLength(function->function.blocks_arr);
              ++j) {
             DuskIRValue *block = function->function.blocks_arr[j];
             block->id = duskReserveId(module);
+            block->emitted = false;
 
             if (j == 0) {
                 for (size_t k = 0;
@@ -2136,6 +2600,7 @@ DuskArray(uint32_t)
 
                     DuskIRValue *variable = function->function.variables_arr[k];
                     variable->id = duskReserveId(module);
+                    variable->emitted = false;
                 }
             }
 
@@ -2144,10 +2609,21 @@ DuskArray(uint32_t)
 
                 DuskIRValue *inst = block->block.insts_arr[k];
                 inst->id = duskReserveId(module);
+                inst->emitted = false;
+
+                if (!got_image_query &&
+                    inst->kind == DUSK_IR_VALUE_BUILTIN_CALL &&
+                    duskIsImageQuery(inst->builtin_call.builtin_kind)) {
+                    got_image_query = true;
+                    duskArrayPush(
+                        &module->capabilities_arr, SpvCapabilityImageQuery);
+                }
             }
         }
     }
 
+    duskSortRequirements(module);
+
     duskArrayPush(&module->stream_arr, SpvMagicNumber);
     duskArrayPush(&module->stream_arr, SpvVersion);
     duskArrayPush(&module->stream_arr, 28); // Khronos compiler ID
@@ -2252,14 +2728,22 @@ DuskArray(uint32_t)
 
     // TODO: generate names here
 
-    for (size_t i = 0; i < duskArrayLength(compiler->types_arr); ++i) {
-        DuskType *type = compiler->types_arr[i];
-        if (!type->emit) continue;
+    // Layout decorations are derived from the type on every emission instead
+    // of being stored in the cached type, which outlives the module
+    DuskArray(DuskIRDecoration) type_decorations_arr =
+        duskArrayCreate(allocator, DuskIRDecoration);
+
+    for (size_t i = 0; i < duskArrayLength(types_arr); ++i) {
+        DuskType *type = types_arr[i];
+        duskArrayResize(&type_decorations_arr, 0);
+        for (size_t j = 0; j < duskArrayLength(type->decorations_arr); ++j) {
+            duskArrayPush(&type_decorations_arr, type->decorations_arr[j]);
+        }
 
         if (type->kind == DUSK_TYPE_STRUCT && type->struct_.is_block) {
             DuskIRDecoration decoration = duskIRCreateDecoration(
                 allocator, DUSK_IR_DECORATION_BLOCK, 0, NULL);
-            duskArrayPush(&type->decorations_arr, decoration);
+            duskArrayPush(&type_decorations_arr, decoration);
         }
 
         if ((type->kind == DUSK_TYPE_ARRAY ||
@@ -2273,17 +2757,18 @@ DuskArray(uint32_t)
 
             DuskIRDecoration decoration = duskIRCreateDecoration(
                 allocator, DUSK_IR_DECORATION_ARRAY_STRIDE, 1, &stride);
-            duskArrayPush(&type->decorations_arr, decoration);
+            duskArrayPush(&type_decorations_arr, decoration);
         }
 
-        duskEmitDecorations(module, type->id, type->decorations_arr);
+        uint32_t type_id = duskGetTypeId(module, type);
+        duskEmitDecorations(module, type_id, type_decorations_arr);
 
         if (type->kind == DUSK_TYPE_STRUCT &&
             type->struct_.layout != DUSK_STRUCT_LAYOUT_UNKNOWN) {
             for (uint32_t j = 0; j < type->struct_.field_count; ++j) {
                 duskEmitMemberDecorations(
                     module,
-                    type->id,
+                    type_id,
                     j,
                     type->struct_.field_decoration_arrays[j]);
             }
@@ -2295,8 +2780,8 @@ DuskArray(uint32_t)
         duskEmitDecorations(module, value->id, value->decorations_arr);
     }
 
-    for (size_t i = 0; i < duskArrayLength(compiler->types_arr); ++i) {
-        DuskType *type = compiler->types_arr[i];
+    for (size_t i = 0; i < duskArrayLength(types_arr); ++i) {
+        DuskType *type = types_arr[i];
         duskEmitType(module, type);
     }
 
@@ -0,0 +1,5300 @@
+#include "dusk_internal.h"
+#include <math.h>
+
+// Calls the callback with the address of every value operand of an
+// instruction, so it can be replaced. Blocks and called functions are not
+// visited.
+static void duskIRForEachOperand(
+    DuskIRValue *inst,
+    void *user_data,
+    void (*callback)(void *user_data, DuskIRValue *inst, DuskIRValue **operand))
+{
+    switch (inst->kind) {
+    case DUSK_IR_VALUE_CONSTANT_BOOL:
+    case DUSK_IR_VALUE_CONSTANT:
+    case DUSK_IR_VALUE_CONSTANT_COMPOSITE:
+    case DUSK_IR_VALUE_FUNCTION:
+    case DUSK_IR_VALUE_FUNCTION_PARAMETER:
+    case DUSK_IR_VALUE_BLOCK:
+    case DUSK_IR_VALUE_VARIABLE:
+    case DUSK_IR_VALUE_DISCARD:
+    case DUSK_IR_VALUE_UNREACHABLE:
+    case DUSK_IR_VALUE_BRANCH:
+    case DUSK_IR_VALUE_SELECTION_MERGE:
+    case DUSK_IR_VALUE_LOOP_MERGE: break;
+
+    case DUSK_IR_VALUE_RETURN: {
+        if (inst->return_.value) {
+            callback(user_data, inst, &inst->return_.value);
+        }
+        break;
+    }
+    case DUSK_IR_VALUE_STORE: {
+        callback(user_data, inst, &inst->store.pointer);
+        callback(user_data, inst, &inst->store.value);
+        break;
+    }
+    case DUSK_IR_VALUE_LOAD: {
+        callback(user_data, inst, &inst->load.pointer);
+        break;
+    }
+    case DUSK_IR_VALUE_FUNCTION_CALL: {
+        for (size_t i = 0; i < duskArrayLength(inst->function_call.params_arr);
+             ++i) {
+            callback(user_data, inst, &inst->function_call.params_arr[i]);
+        }
+        break;
+    }
+    case DUSK_IR_VALUE_ACCESS_CHAIN: {
+        callback(user_data, inst, &inst->access_chain.base);
+        for (size_t i = 0; i < duskArrayLength(inst->access_chain.indices_arr);
+             ++i) {
+            callback(user_data, inst, &inst->access_chain.indices_arr[i]);
+        }
+        break;
+    }
+    case DUSK_IR_VALUE_COMPOSITE_EXTRACT: {
+        callback(user_data, inst, &inst->composite_extract.composite);
+        break;
+    }
+    case DUSK_IR_VALUE_COMPOSITE_INSERT: {
+        callback(user_data, inst, &inst->composite_insert.object);
+        callback(user_data, inst, &inst->composite_insert.composite);
+        break;
+    }
+    case DUSK_IR_VALUE_VECTOR_SHUFFLE: {
+        callback(user_data, inst, &inst->vector_shuffle.vec1);
+        callback(user_data, inst, &inst->vector_shuffle.vec2);
+        break;
+    }
+    case DUSK_IR_VALUE_COMPOSITE_CONSTRUCT: {
+        for (size_t i = 0;
+             i < duskArrayLength(inst->composite_construct.values_arr);
+             ++i) {
+            callback(user_data, inst, &inst->composite_construct.values_arr[i]);
+        }
+        break;
+    }
+    case DUSK_IR_VALUE_CAST: {
+        callback(user_data, inst, &inst->cast.value);
+        break;
+    }
+    case DUSK_IR_VALUE_BUILTIN_CALL: {
+        for (size_t i = 0; i < inst->builtin_call.param_count; ++i) {
+            callback(user_data, inst, &inst->builtin_call.params[i]);
+        }
+        break;
+    }
+    case DUSK_IR_VALUE_BINARY_OPERATION: {
+        callback(user_data, inst, &inst->binary.left);
+        callback(user_data, inst, &inst->binary.right);
+        break;
+    }
+    case DUSK_IR_VALUE_UNARY_OPERATION: {
+        callback(user_data, inst, &inst->unary.right);
+        break;
+    }
+    case DUSK_IR_VALUE_BRANCH_COND: {
+        callback(user_data, inst, &inst->branch_cond.cond);
+        break;
+    }
+    case DUSK_IR_VALUE_PHI: {
+        for (size_t i = 0; i < inst->phi.pair_count; ++i) {
+            callback(user_data, inst, &inst->phi.pairs[i].value);
+        }
+        break;
+    }
+    case DUSK_IR_VALUE_ARRAY_LENGTH: {
+        callback(user_data, inst, &inst->array_length.struct_ptr);
+        break;
+    }
+    }
+}
+
+// Zero value of a scalar or vector type, used where a promoted variable is
+// read before anything is stored to it
+static DuskIRValue *duskIRZeroValue(DuskIRModule *module, DuskType *type)
+{
+    switch (type->kind) {
+    case DUSK_TYPE_BOOL: return duskIRConstBoolCreate(module, false);
+    case DUSK_TYPE_INT: return duskIRConstIntCreate(module, type, 0);
+    case DUSK_TYPE_FLOAT: return duskIRConstFloatCreate(module, type, 0.0);
+    case DUSK_TYPE_VECTOR: {
+        DuskIRValue *zero = duskIRZeroValue(module, type->vector.sub);
+        DuskIRValue **values =
+            DUSK_NEW_ARRAY(module->allocator, DuskIRValue *, type->vector.size);
+        for (size_t i = 0; i < type->vector.size; ++i) {
+            values[i] = zero;
+        }
+        return duskIRConstCompositeCreate(
+            module, type, type->vector.size, values);
+    }
+    default: DUSK_ASSERT(0); return NULL;
+    }
+}
+
+// Dominators {{{
+//
+// The dominator tree and dominance frontiers are computed as in "A Simple,
+// Fast Dominance Algorithm" by Cooper, Harvey and Kennedy. The id of the
+// blocks of the function has to be their index while they are used.
+
+typedef struct DuskDominators {
+    size_t block_count;
+    DuskArray(uint32_t) * preds;
+    DuskArray(uint32_t) * frontiers;
+    DuskArray(uint32_t) * children;
+    // Index of each block in reverse post-order, UINT32_MAX if unreachable
+    uint32_t *rpo_indices;
+    uint32_t *idoms;
+} DuskDominators;
+
+static void duskGetSuccessors(
+    DuskIRValue *block, DuskIRValue **successors, size_t *successor_count)
+{
+    *successor_count = 0;
+
+    // Blocks without a terminator get a return once the body is finished
+    size_t inst_count = duskArrayLength(block->block.insts_arr);
+    if (inst_count == 0) return;
+
+    DuskIRValue *terminator = block->block.insts_arr[inst_count - 1];
+    switch (terminator->kind) {
+    case DUSK_IR_VALUE_BRANCH: {
+        successors[(*successor_count)++] = terminator->branch.dest_block;
+        break;
+    }
+    case DUSK_IR_VALUE_BRANCH_COND: {
+        successors[(*successor_count)++] = terminator->branch_cond.true_block;
+        if (terminator->branch_cond.false_block !=
+            terminator->branch_cond.true_block) {
+            successors[(*successor_count)++] =
+                terminator->branch_cond.false_block;
+        }
+        break;
+    }
+    default: break;
+    }
+}
+
+static bool duskIsReachable(DuskDominators *doms, uint32_t block_index)
+{
+    return doms->rpo_indices[block_index] != UINT32_MAX;
+}
+
+static uint32_t duskIntersectDominators(
+    DuskDominators *doms, uint32_t finger1, uint32_t finger2)
+{
+    while (finger1 != finger2) {
+        while (doms->rpo_indices[finger1] > doms->rpo_indices[finger2]) {
+            finger1 = doms->idoms[finger1];
+        }
+        while (doms->rpo_indices[finger2] > doms->rpo_indices[finger1]) {
+            finger2 = doms->idoms[finger2];
+        }
+    }
+    return finger1;
+}
+
+static void duskComputeDominators(
+    DuskAllocator *allocator, DuskIRValue *function, DuskDominators *doms)
+{
+    DuskIRValue **blocks = function->function.blocks_arr;
+    size_t block_count = duskArrayLength(function->function.blocks_arr);
+    doms->block_count = block_count;
+
+    doms->preds = DUSK_NEW_ARRAY(allocator, DuskArray(uint32_t), block_count);
+    doms->frontiers =
+        DUSK_NEW_ARRAY(allocator, DuskArray(uint32_t), block_count);
+    doms->children =
+        DUSK_NEW_ARRAY(allocator, DuskArray(uint32_t), block_count);
+    doms->rpo_indices = DUSK_NEW_ARRAY(allocator, uint32_t, block_count);
+    doms->idoms = DUSK_NEW_ARRAY(allocator, uint32_t, block_count);
+
+    for (size_t i = 0; i < block_count; ++i) {
+        doms->preds[i] = duskArrayCreate(allocator, uint32_t);
+        doms->frontiers[i] = duskArrayCreate(allocator, uint32_t);
+        doms->children[i] = duskArrayCreate(allocator, uint32_t);
+        doms->rpo_indices[i] = UINT32_MAX;
+        doms->idoms[i] = UINT32_MAX;
+    }
+
+    // Unreachable predecessors are kept, as phis need an incoming value for
+    // them too
+    for (size_t i = 0; i < block_count; ++i) {
+        DuskIRValue *successors[2];
+        size_t successor_count = 0;
+        duskGetSuccessors(blocks[i], successors, &successor_count);
+        for (size_t j = 0; j < successor_count; ++j) {
+            duskArrayPush(&doms->preds[successors[j]->id], (uint32_t)i);
+        }
+    }
+
+    // Without recursion, as bodies can nest deeply
+    DuskArray(uint32_t) post_order_arr = duskArrayCreate(allocator, uint32_t);
+    DuskArray(uint32_t) stack_arr = duskArrayCreate(allocator, uint32_t);
+    bool *visited = DUSK_NEW_ARRAY(allocator, bool, block_count);
+    uint8_t *next_successors = DUSK_NEW_ARRAY(allocator, uint8_t, block_count);
+
+    visited[0] = true;
+    duskArrayPush(&stack_arr, 0);
+    while (duskArrayLength(stack_arr) > 0) {
+        uint32_t block_index = stack_arr[duskArrayLength(stack_arr) - 1];
+
+        DuskIRValue *successors[2];
+        size_t successor_count = 0;
+        duskGetSuccessors(blocks[block_index], successors, &successor_count);
+
+        if (next_successors[block_index] < successor_count) {
+            DuskIRValue *successor =
+                successors[next_successors[block_index]++];
+            if (!visited[successor->id]) {
+                visited[successor->id] = true;
+                duskArrayPush(&stack_arr, successor->id);
+            }
+        } else {
+            duskArrayPop(&stack_arr);
+            duskArrayPush(&post_order_arr, block_index);
+        }
+    }
+
+    size_t reachable_count = duskArrayLength(post_order_arr);
+    uint32_t *rpo = DUSK_NEW_ARRAY(allocator, uint32_t, reachable_count);
+    for (size_t i = 0; i < reachable_count; ++i) {
+        rpo[i] = post_order_arr[reachable_count - 1 - i];
+        doms->rpo_indices[rpo[i]] = (uint32_t)i;
+    }
+
+    doms->idoms[0] = 0;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t i = 1; i < reachable_count; ++i) {
+            uint32_t block_index = rpo[i];
+            DuskArray(uint32_t) preds_arr = doms->preds[block_index];
+
+            uint32_t new_idom = UINT32_MAX;
+            for (size_t j = 0; j < duskArrayLength(preds_arr); ++j) {
+                uint32_t pred = preds_arr[j];
+                if (doms->idoms[pred] == UINT32_MAX) continue;
+
+                if (new_idom == UINT32_MAX) {
+                    new_idom = pred;
+                } else {
+                    new_idom = duskIntersectDominators(doms, pred, new_idom);
+                }
+            }
+
+            if (doms->idoms[block_index] != new_idom) {
+                doms->idoms[block_index] = new_idom;
+                changed = true;
+            }
+        }
+    }
+
+    for (size_t i = 1; i < reachable_count; ++i) {
+        uint32_t block_index = rpo[i];
+        duskArrayPush(&doms->children[doms->idoms[block_index]], block_index);
+    }
+
+    for (size_t i = 0; i < reachable_count; ++i) {
+        uint32_t block_index = rpo[i];
+        DuskArray(uint32_t) preds_arr = doms->preds[block_index];
+        if (duskArrayLength(preds_arr) < 2) continue;
+
+        for (size_t j = 0; j < duskArrayLength(preds_arr); ++j) {
+            uint32_t runner = preds_arr[j];
+            if (!duskIsReachable(doms, runner)) continue;
+
+            while (runner != doms->idoms[block_index]) {
+                DuskArray(uint32_t) *frontier = &doms->frontiers[runner];
+                size_t frontier_length = duskArrayLength(*frontier);
+                if (frontier_length == 0 ||
+                    (*frontier)[frontier_length - 1] != block_index) {
+                    duskArrayPush(frontier, block_index);
+                }
+                runner = doms->idoms[runner];
+            }
+        }
+    }
+}
+// }}}
+
+// Local variable promotion {{{
+//
+// Phis are placed on the iterated dominance frontier of the blocks that store
+// to each variable, then the loads are replaced by the value reaching them in
+// a walk over the dominator tree. Phis that end up unused or with a single
+// incoming value are removed afterwards.
+//
+// While the pass runs, the id of the blocks, variables and instructions of the
+// function is their index in the arrays below. Ids are assigned again when the
+// module is emitted.
+
+typedef struct DuskPromotedVar {
+    DuskIRValue *var;
+    bool promotable;
+    // Blocks that store to the variable
+    DuskArray(uint32_t) def_blocks_arr;
+    // Value reaching the point being renamed, NULL if nothing was stored
+    DuskIRValue *current_value;
+} DuskPromotedVar;
+
+typedef struct DuskPromotedInst {
+    // Access chain to a constant component of a local vector
+    bool component_access;
+    // Loads and stores of promoted variables and the access chains to their
+    // components are removed, and the loads are replaced by the stored value
+    bool removed;
+    DuskIRValue *replacement;
+} DuskPromotedInst;
+
+typedef struct DuskPromotedPhi {
+    DuskIRValue *phi;
+    uint32_t var_index;
+    uint32_t block_index;
+    bool live;
+    // Set for phis whose incoming values are all the same
+    bool removed;
+    DuskIRValue *replacement;
+} DuskPromotedPhi;
+
+typedef struct DuskRenameUndo {
+    uint32_t var_index;
+    DuskIRValue *previous_value;
+} DuskRenameUndo;
+
+typedef struct DuskRenameStep {
+    uint32_t block_index;
+    bool leaving;
+    size_t undo_length;
+} DuskRenameStep;
+
+typedef struct DuskPromoteState {
+    DuskIRModule *module;
+    DuskIRValue *function;
+
+    size_t block_count;
+    DuskDominators doms;
+    // Phis added to each block, by index in phis_arr
+    DuskArray(uint32_t) * block_phis;
+
+    DuskPromotedVar *vars;
+    size_t var_count;
+
+    DuskIRValue **insts;
+    DuskPromotedInst *inst_infos;
+    size_t inst_count;
+
+    DuskArray(DuskPromotedPhi) phis_arr;
+    DuskArray(DuskRenameUndo) undo_arr;
+    // Phis found to be live whose operands are yet to be visited
+    DuskArray(DuskIRValue *) live_arr;
+} DuskPromoteState;
+
+static bool duskIsPromotableType(DuskType *type)
+{
+    switch (type->kind) {
+    case DUSK_TYPE_BOOL:
+    case DUSK_TYPE_INT:
+    case DUSK_TYPE_FLOAT:
+    case DUSK_TYPE_VECTOR: return true;
+    default: return false;
+    }
+}
+
+static bool duskIsLocalVariable(DuskIRValue *value)
+{
+    return value->kind == DUSK_IR_VALUE_VARIABLE &&
+           value->var.storage_class == DUSK_STORAGE_CLASS_FUNCTION;
+}
+
+// Returns the promotion candidate a pointer points to, or to a component of
+static DuskPromotedVar *
+duskGetPointedVar(DuskPromoteState *state, DuskIRValue *pointer)
+{
+    if (pointer->kind == DUSK_IR_VALUE_ACCESS_CHAIN) {
+        if (!state->inst_infos[pointer->id].component_access) return NULL;
+        pointer = pointer->access_chain.base;
+    }
+
+    if (!duskIsLocalVariable(pointer)) return NULL;
+
+    DuskPromotedVar *var = &state->vars[pointer->id];
+    return var->promotable ? var : NULL;
+}
+
+static void duskCheckEscape(
+    void *user_data, DuskIRValue *inst, DuskIRValue **operand)
+{
+    DuskPromoteState *state = (DuskPromoteState *)user_data;
+    DuskIRValue *value = *operand;
+
+    bool is_address =
+        (inst->kind == DUSK_IR_VALUE_LOAD) ||
+        (inst->kind == DUSK_IR_VALUE_STORE && operand == &inst->store.pointer);
+
+    if (value->kind == DUSK_IR_VALUE_ACCESS_CHAIN &&
+        state->inst_infos[value->id].component_access) {
+        if (!is_address) {
+            state->vars[value->access_chain.base->id].promotable = false;
+        }
+    } else if (duskIsLocalVariable(value)) {
+        if (inst->kind == DUSK_IR_VALUE_ACCESS_CHAIN &&
+            state->inst_infos[inst->id].component_access) {
+            is_address = true;
+        }
+        if (!is_address) {
+            state->vars[value->id].promotable = false;
+        }
+    }
+}
+
+// Follows the replacements of removed loads and phis. NULL stands for the
+// value of a variable nothing was stored to.
+static DuskIRValue *
+duskResolvePromoted(DuskPromoteState *state, DuskIRValue *value)
+{
+    while (value) {
+        if (value->kind == DUSK_IR_VALUE_LOAD &&
+            state->inst_infos[value->id].removed) {
+            value = state->inst_infos[value->id].replacement;
+        } else if (
+            value->kind == DUSK_IR_VALUE_PHI &&
+            value->id >= state->inst_count &&
+            state->phis_arr[value->id - state->inst_count].removed) {
+            value = state->phis_arr[value->id - state->inst_count].replacement;
+        } else {
+            break;
+        }
+    }
+    return value;
+}
+
+static void duskInsertPhis(DuskPromoteState *state)
+{
+    DuskAllocator *allocator = state->module->allocator;
+    DuskIRValue **blocks = state->function->function.blocks_arr;
+
+    // Blocks are stamped with the index of the variable they were last
+    // visited for, plus one
+    uint32_t *phi_stamps =
+        DUSK_NEW_ARRAY(allocator, uint32_t, state->block_count);
+    uint32_t *work_stamps =
+        DUSK_NEW_ARRAY(allocator, uint32_t, state->block_count);
+    DuskArray(uint32_t) work_arr = duskArrayCreate(allocator, uint32_t);
+
+    for (uint32_t i = 0; i < state->var_count; ++i) {
+        DuskPromotedVar *var = &state->vars[i];
+        if (!var->promotable) continue;
+
+        uint32_t stamp = i + 1;
+        duskArrayResize(&work_arr, 0);
+        for (size_t j = 0; j < duskArrayLength(var->def_blocks_arr); ++j) {
+            uint32_t block_index = var->def_blocks_arr[j];
+            if (!duskIsReachable(&state->doms, block_index)) continue;
+            work_stamps[block_index] = stamp;
+            duskArrayPush(&work_arr, block_index);
+        }
+
+        while (duskArrayLength(work_arr) > 0) {
+            uint32_t block_index = work_arr[duskArrayLength(work_arr) - 1];
+            duskArrayPop(&work_arr);
+
+            DuskArray(uint32_t) frontier_arr =
+                state->doms.frontiers[block_index];
+            for (size_t j = 0; j < duskArrayLength(frontier_arr); ++j) {
+                uint32_t frontier_index = frontier_arr[j];
+                if (phi_stamps[frontier_index] == stamp) continue;
+                phi_stamps[frontier_index] = stamp;
+
+                // The incoming values are filled in while renaming
+                DuskArray(uint32_t) preds_arr =
+                    state->doms.preds[frontier_index];
+                size_t pair_count = duskArrayLength(preds_arr);
+
+                DuskIRValue *phi = DUSK_NEW(allocator, DuskIRValue);
+                phi->kind = DUSK_IR_VALUE_PHI;
+                phi->type = var->var->type->pointer.sub;
+                phi->id = (uint32_t)(
+                    state->inst_count + duskArrayLength(state->phis_arr));
+                phi->phi.pair_count = pair_count;
+                phi->phi.pairs =
+                    DUSK_NEW_ARRAY(allocator, DuskIRPhiPair, pair_count);
+                for (size_t k = 0; k < pair_count; ++k) {
+                    phi->phi.pairs[k].block = blocks[preds_arr[k]];
+                }
+
+                DuskPromotedPhi promoted_phi = {
+                    .phi = phi,
+                    .var_index = i,
+                    .block_index = frontier_index,
+                };
+                duskArrayPush(
+                    &state->block_phis[frontier_index],
+                    (uint32_t)duskArrayLength(state->phis_arr));
+                duskArrayPush(&state->phis_arr, promoted_phi);
+
+                if (work_stamps[frontier_index] != stamp) {
+                    work_stamps[frontier_index] = stamp;
+                    duskArrayPush(&work_arr, frontier_index);
+                }
+            }
+        }
+    }
+}
+
+static void duskSetCurrentValue(
+    DuskPromoteState *state, DuskPromotedVar *var, DuskIRValue *value)
+{
+    DuskRenameUndo undo = {
+        .var_index = (uint32_t)(var - state->vars),
+        .previous_value = var->current_value,
+    };
+    duskArrayPush(&state->undo_arr, undo);
+    var->current_value = value;
+}
+
+static uint32_t duskGetComponentIndex(DuskIRValue *access_chain)
+{
+    DuskIRValue *index = access_chain->access_chain.indices_arr[0];
+    return index->constant.value_words[0];
+}
+
+static void duskRenameBlock(DuskPromoteState *state, uint32_t block_index)
+{
+    DuskIRModule *module = state->module;
+    DuskIRValue **blocks = state->function->function.blocks_arr;
+    DuskIRValue *block = blocks[block_index];
+
+    DuskArray(uint32_t) block_phis_arr = state->block_phis[block_index];
+    for (size_t i = 0; i < duskArrayLength(block_phis_arr); ++i) {
+        DuskPromotedPhi *promoted_phi = &state->phis_arr[block_phis_arr[i]];
+        duskSetCurrentValue(
+            state, &state->vars[promoted_phi->var_index], promoted_phi->phi);
+    }
+
+    for (size_t i = 0; i < duskArrayLength(block->block.insts_arr); ++i) {
+        DuskIRValue *inst = block->block.insts_arr[i];
+        DuskPromotedInst *info = &state->inst_infos[inst->id];
+
+        switch (inst->kind) {
+        case DUSK_IR_VALUE_LOAD: {
+            DuskIRValue *pointer = inst->load.pointer;
+            DuskPromotedVar *var = duskGetPointedVar(state, pointer);
+            if (!var) break;
+
+            if (pointer->kind == DUSK_IR_VALUE_VARIABLE) {
+                info->removed = true;
+                info->replacement = var->current_value;
+                break;
+            }
+
+            // Loading a component becomes an extraction from the vector
+            DuskIRValue *composite = var->current_value;
+            if (!composite) {
+                composite =
+                    duskIRZeroValue(module, var->var->type->pointer.sub);
+            }
+
+            uint32_t component_index = duskGetComponentIndex(pointer);
+            inst->kind = DUSK_IR_VALUE_COMPOSITE_EXTRACT;
+            inst->composite_extract.composite = composite;
+            inst->composite_extract.indices_arr =
+                duskArrayCreate(module->allocator, uint32_t);
+            duskArrayPush(
+                &inst->composite_extract.indices_arr, component_index);
+            break;
+        }
+        case DUSK_IR_VALUE_STORE: {
+            DuskIRValue *pointer = inst->store.pointer;
+            DuskPromotedVar *var = duskGetPointedVar(state, pointer);
+            if (!var) break;
+
+            DuskIRValue *value =
+                duskResolvePromoted(state, inst->store.value);
+
+            if (pointer->kind == DUSK_IR_VALUE_VARIABLE) {
+                info->removed = true;
+                duskSetCurrentValue(state, var, value);
+                break;
+            }
+
+            // Storing to a component becomes an insertion into the vector
+            DuskType *vector_type = var->var->type->pointer.sub;
+            if (!value) {
+                value = duskIRZeroValue(module, inst->store.value->type);
+            }
+            DuskIRValue *composite = var->current_value;
+            if (!composite) {
+                composite = duskIRZeroValue(module, vector_type);
+            }
+
+            uint32_t component_index = duskGetComponentIndex(pointer);
+            inst->kind = DUSK_IR_VALUE_COMPOSITE_INSERT;
+            inst->type = vector_type;
+            inst->composite_insert.object = value;
+            inst->composite_insert.composite = composite;
+            inst->composite_insert.indices_arr =
+                duskArrayCreate(module->allocator, uint32_t);
+            duskArrayPush(
+                &inst->composite_insert.indices_arr, component_index);
+
+            duskSetCurrentValue(state, var, inst);
+            break;
+        }
+        case DUSK_IR_VALUE_ACCESS_CHAIN: {
+            if (info->component_access && duskGetPointedVar(state, inst)) {
+                info->removed = true;
+            }
+            break;
+        }
+        default: break;
+        }
+    }
+
+    // Unreachable blocks keep the undefined value in the phis of their
+    // successors, as what they compute doesn't dominate them
+    if (!duskIsReachable(&state->doms, block_index)) return;
+
+    DuskIRValue *successors[2];
+    size_t successor_count = 0;
+    duskGetSuccessors(block, successors, &successor_count);
+    for (size_t i = 0; i < successor_count; ++i) {
+        DuskArray(uint32_t) successor_phis_arr =
+            state->block_phis[successors[i]->id];
+        for (size_t j = 0; j < duskArrayLength(successor_phis_arr); ++j) {
+            DuskPromotedPhi *promoted_phi =
+                &state->phis_arr[successor_phis_arr[j]];
+            DuskIRValue *phi = promoted_phi->phi;
+            for (size_t k = 0; k < phi->phi.pair_count; ++k) {
+                if (phi->phi.pairs[k].block == block) {
+                    phi->phi.pairs[k].value =
+                        state->vars[promoted_phi->var_index].current_value;
+                }
+            }
+        }
+    }
+}
+
+static void duskUndoRename(DuskPromoteState *state, size_t undo_length)
+{
+    while (duskArrayLength(state->undo_arr) > undo_length) {
+        DuskRenameUndo undo =
+            state->undo_arr[duskArrayLength(state->undo_arr) - 1];
+        duskArrayPop(&state->undo_arr);
+        state->vars[undo.var_index].current_value = undo.previous_value;
+    }
+}
+
+static void duskRenameVars(DuskPromoteState *state)
+{
+    DuskAllocator *allocator = state->module->allocator;
+
+    // Walks the dominator tree, so the value stored last on the way to a block
+    // is the one that reaches it
+    DuskArray(DuskRenameStep) steps_arr =
+        duskArrayCreate(allocator, DuskRenameStep);
+    DuskRenameStep first_step = {.block_index = 0};
+    duskArrayPush(&steps_arr, first_step);
+
+    while (duskArrayLength(steps_arr) > 0) {
+        DuskRenameStep step = steps_arr[duskArrayLength(steps_arr) - 1];
+        duskArrayPop(&steps_arr);
+
+        if (step.leaving) {
+            duskUndoRename(state, step.undo_length);
+            continue;
+        }
+
+        DuskRenameStep leave_step = {
+            .block_index = step.block_index,
+            .leaving = true,
+            .undo_length = duskArrayLength(state->undo_arr),
+        };
+        duskRenameBlock(state, step.block_index);
+        duskArrayPush(&steps_arr, leave_step);
+
+        DuskArray(uint32_t) children_arr =
+            state->doms.children[step.block_index];
+        for (size_t i = duskArrayLength(children_arr); i > 0; --i) {
+            DuskRenameStep child_step = {.block_index = children_arr[i - 1]};
+            duskArrayPush(&steps_arr, child_step);
+        }
+    }
+
+    // Nothing reaches unreachable blocks, so variables start out undefined in
+    // each of them
+    for (uint32_t i = 0; i < state->block_count; ++i) {
+        if (duskIsReachable(&state->doms, i)) continue;
+        duskRenameBlock(state, i);
+        duskUndoRename(state, 0);
+    }
+}
+
+static void duskMarkLivePhis(
+    void *user_data, DuskIRValue *inst, DuskIRValue **operand)
+{
+    DuskPromoteState *state = (DuskPromoteState *)user_data;
+    (void)inst;
+
+    DuskIRValue *value = duskResolvePromoted(state, *operand);
+    if (!value || value->kind != DUSK_IR_VALUE_PHI ||
+        value->id < state->inst_count) {
+        return;
+    }
+
+    DuskPromotedPhi *promoted_phi =
+        &state->phis_arr[value->id - state->inst_count];
+    if (!promoted_phi->live) {
+        promoted_phi->live = true;
+        duskArrayPush(&state->live_arr, value);
+    }
+}
+
+static void duskRemoveRedundantPhis(DuskPromoteState *state)
+{
+    DuskAllocator *allocator = state->module->allocator;
+    size_t phi_count = duskArrayLength(state->phis_arr);
+
+    // A phi whose incoming values are all the same value or the phi itself
+    // can be replaced by that value
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t i = 0; i < phi_count; ++i) {
+            DuskPromotedPhi *promoted_phi = &state->phis_arr[i];
+            if (promoted_phi->removed) continue;
+
+            DuskIRValue *phi = promoted_phi->phi;
+            DuskIRValue *unique_value = phi;
+            bool is_redundant = true;
+            for (size_t j = 0; j < phi->phi.pair_count; ++j) {
+                DuskIRValue *value =
+                    duskResolvePromoted(state, phi->phi.pairs[j].value);
+                if (value == phi) continue;
+
+                if (unique_value == phi) {
+                    unique_value = value;
+                } else if (unique_value != value) {
+                    is_redundant = false;
+                    break;
+                }
+            }
+
+            if (is_redundant && unique_value != phi) {
+                promoted_phi->removed = true;
+                promoted_phi->replacement = unique_value;
+                changed = true;
+            }
+        }
+    }
+
+    // The remaining phis are kept if anything other than a dead phi uses them
+    state->live_arr = duskArrayCreate(allocator, DuskIRValue *);
+    for (size_t i = 0; i < state->inst_count; ++i) {
+        if (state->inst_infos[i].removed) continue;
+        duskIRForEachOperand(state->insts[i], state, duskMarkLivePhis);
+    }
+
+    while (duskArrayLength(state->live_arr) > 0) {
+        DuskIRValue *phi =
+            state->live_arr[duskArrayLength(state->live_arr) - 1];
+        duskArrayPop(&state->live_arr);
+        duskIRForEachOperand(phi, state, duskMarkLivePhis);
+    }
+}
+
+static void duskReplaceOperand(
+    void *user_data, DuskIRValue *inst, DuskIRValue **operand)
+{
+    DuskPromoteState *state = (DuskPromoteState *)user_data;
+    (void)inst;
+
+    DuskIRValue *value = duskResolvePromoted(state, *operand);
+    if (!value) value = duskIRZeroValue(state->module, (*operand)->type);
+    *operand = value;
+}
+
+void duskIRPromoteLocals(DuskIRModule *module, DuskIRValue *function)
+{
+    DUSK_ASSERT(function->kind == DUSK_IR_VALUE_FUNCTION);
+
+    size_t var_count = duskArrayLength(function->function.variables_arr);
+    if (var_count == 0) return;
+
+    DuskAllocator *allocator = module->allocator;
+    DuskIRValue **blocks = function->function.blocks_arr;
+
+    DuskPromoteState state_storage = {
+        .module = module,
+        .function = function,
+        .block_count = duskArrayLength(function->function.blocks_arr),
+        .var_count = var_count,
+        .phis_arr = duskArrayCreate(allocator, DuskPromotedPhi),
+        .undo_arr = duskArrayCreate(allocator, DuskRenameUndo),
+    };
+    DuskPromoteState *state = &state_storage;
+
+    state->vars = DUSK_NEW_ARRAY(allocator, DuskPromotedVar, var_count);
+    for (size_t i = 0; i < var_count; ++i) {
+        DuskIRValue *var = function->function.variables_arr[i];
+        var->id = (uint32_t)i;
+        state->vars[i].var = var;
+        state->vars[i].promotable =
+            duskIsPromotableType(var->type->pointer.sub);
+        state->vars[i].def_blocks_arr = duskArrayCreate(allocator, uint32_t);
+    }
+
+    for (size_t i = 0; i < state->block_count; ++i) {
+        blocks[i]->id = (uint32_t)i;
+        state->inst_count += duskArrayLength(blocks[i]->block.insts_arr);
+    }
+
+    state->insts =
+        DUSK_NEW_ARRAY(allocator, DuskIRValue *, state->inst_count);
+    state->inst_infos =
+        DUSK_NEW_ARRAY(allocator, DuskPromotedInst, state->inst_count);
+
+    size_t inst_index = 0;
+    for (size_t i = 0; i < state->block_count; ++i) {
+        DuskArray(DuskIRValue *) insts_arr = blocks[i]->block.insts_arr;
+        for (size_t j = 0; j < duskArrayLength(insts_arr); ++j) {
+            DuskIRValue *inst = insts_arr[j];
+            inst->id = (uint32_t)inst_index;
+            state->insts[inst_index++] = inst;
+
+            if (inst->kind == DUSK_IR_VALUE_ACCESS_CHAIN &&
+                duskIsLocalVariable(inst->access_chain.base) &&
+                inst->access_chain.base->type->pointer.sub->kind ==
+                    DUSK_TYPE_VECTOR &&
+                duskArrayLength(inst->access_chain.indices_arr) == 1 &&
+                inst->access_chain.indices_arr[0]->kind ==
+                    DUSK_IR_VALUE_CONSTANT) {
+                state->inst_infos[inst->id].component_access = true;
+            }
+        }
+    }
+
+    bool any_promotable = false;
+    for (size_t i = 0; i < state->inst_count; ++i) {
+        duskIRForEachOperand(state->insts[i], state, duskCheckEscape);
+    }
+    for (size_t i = 0; i < var_count; ++i) {
+        any_promotable = any_promotable || state->vars[i].promotable;
+    }
+    if (!any_promotable) return;
+
+    for (uint32_t i = 0; i < state->block_count; ++i) {
+        DuskArray(DuskIRValue *) insts_arr = blocks[i]->block.insts_arr;
+        for (size_t j = 0; j < duskArrayLength(insts_arr); ++j) {
+            DuskIRValue *inst = insts_arr[j];
+            if (inst->kind != DUSK_IR_VALUE_STORE) continue;
+
+            DuskPromotedVar *var =
+                duskGetPointedVar(state, inst->store.pointer);
+            if (!var) continue;
+
+            size_t def_count = duskArrayLength(var->def_blocks_arr);
+            if (def_count == 0 || var->def_blocks_arr[def_count - 1] != i) {
+                duskArrayPush(&var->def_blocks_arr, i);
+            }
+        }
+    }
+
+    duskComputeDominators(allocator, function, &state->doms);
+    state->block_phis =
+        DUSK_NEW_ARRAY(allocator, DuskArray(uint32_t), state->block_count);
+    for (size_t i = 0; i < state->block_count; ++i) {
+        state->block_phis[i] = duskArrayCreate(allocator, uint32_t);
+    }
+    duskInsertPhis(state);
+    duskRenameVars(state);
+    duskRemoveRedundantPhis(state);
+
+    for (size_t i = 0; i < state->block_count; ++i) {
+        DuskIRValue *block = blocks[i];
+        DuskArray(DuskIRValue *) insts_arr =
+            duskArrayCreate(allocator, DuskIRValue *);
+
+        DuskArray(uint32_t) block_phis_arr = state->block_phis[i];
+        for (size_t j = 0; j < duskArrayLength(block_phis_arr); ++j) {
+            DuskPromotedPhi *promoted_phi = &state->phis_arr[block_phis_arr[j]];
+            if (promoted_phi->removed || !promoted_phi->live) continue;
+
+            DuskIRValue *phi = promoted_phi->phi;
+            for (size_t k = 0; k < phi->phi.pair_count; ++k) {
+                DuskIRValue *value =
+                    duskResolvePromoted(state, phi->phi.pairs[k].value);
+                if (!value) value = duskIRZeroValue(module, phi->type);
+                phi->phi.pairs[k].value = value;
+            }
+            duskArrayPush(&insts_arr, phi);
+        }
+
+        for (size_t j = 0; j < duskArrayLength(block->block.insts_arr); ++j) {
+            DuskIRValue *inst = block->block.insts_arr[j];
+            if (state->inst_infos[inst->id].removed) continue;
+
+            duskIRForEachOperand(inst, state, duskReplaceOperand);
+            duskArrayPush(&insts_arr, inst);
+        }
+
+        block->block.insts_arr = insts_arr;
+    }
+
+    DuskArray(DuskIRValue *) variables_arr =
+        duskArrayCreate(allocator, DuskIRValue *);
+    for (size_t i = 0; i < var_count; ++i) {
+        if (state->vars[i].promotable) continue;
+        duskArrayPush(&variables_arr, state->vars[i].var);
+    }
+    function->function.variables_arr = variables_arr;
+}
+// }}}
+
+// Constant folding {{{
+//
+// Instructions whose operands are constants are replaced by the constant they
+// compute, and instructions with an identity operand by their other operand.
+// Results have to be the ones the target would compute, so only what IEEE 754
+// defines exactly is folded: float additions, subtractions, multiplications,
+// exact divisions, conversions, comparisons and the rounding, min and max
+// functions. Transcendental functions and reductions like dot products are
+// left alone, as targets compute them with some error or fuse the operations.
+// Subnormal and non-finite values are never folded either, as targets may
+// flush them to zero.
+//
+// Chains of swizzles and extracts are shortened as well: components are taken
+// straight from the vector or scalar they were shuffled, constructed or
+// inserted from, so the instructions in between can be removed once they are
+// no longer used.
+//
+// While the pass runs, the id of the instructions of the function is their
+// index in the function.
+
+typedef struct DuskFoldState {
+    DuskIRValue **insts;
+    size_t inst_count;
+    // Value that replaces each instruction, NULL if it's kept
+    DuskIRValue **replacements;
+} DuskFoldState;
+
+typedef enum DuskFoldPattern {
+    DUSK_FOLD_PATTERN_ZERO,
+    DUSK_FOLD_PATTERN_NEGATIVE_ZERO,
+    DUSK_FOLD_PATTERN_ONE,
+    DUSK_FOLD_PATTERN_ALL_ONES,
+} DuskFoldPattern;
+
+// Value of an integer constant, sign extended for signed types
+static uint64_t duskFoldGetInt(DuskIRValue *constant)
+{
+    DuskType *type = constant->type;
+    DUSK_ASSERT(type->kind == DUSK_TYPE_INT);
+
+    uint64_t int_value = 0;
+    memcpy(
+        &int_value,
+        constant->constant.value_words,
+        sizeof(uint32_t) * constant->constant.value_word_count);
+
+    uint32_t bits = type->int_.bits;
+    if (bits < 64) {
+        int_value &= (UINT64_C(1) << bits) - 1;
+        if (type->int_.is_signed) {
+            uint64_t sign_bit = UINT64_C(1) << (bits - 1);
+            int_value = (int_value ^ sign_bit) - sign_bit;
+        }
+    }
+    return int_value;
+}
+
+// Whether a value is zero or normal once rounded to a float type
+static bool duskFoldIsExactFloat(DuskType *type, double float_value)
+{
+    int float_class = FP_NAN;
+    switch (type->float_.bits) {
+    case 32: float_class = fpclassify((float)float_value); break;
+    case 64: float_class = fpclassify(float_value); break;
+    default: break;
+    }
+    return float_class == FP_ZERO || float_class == FP_NORMAL;
+}
+
+// Value of a float constant, false if it's a half float or a value that
+// isn't folded
+static bool duskFoldGetFloat(DuskIRValue *constant, double *out_float)
+{
+    DuskType *type = constant->type;
+    DUSK_ASSERT(type->kind == DUSK_TYPE_FLOAT);
+
+    switch (type->float_.bits) {
+    case 32: {
+        float float_value;
+        memcpy(&float_value, constant->constant.value_words, sizeof(float));
+        *out_float = (double)float_value;
+        break;
+    }
+    case 64: {
+        memcpy(out_float, constant->constant.value_words, sizeof(double));
+        break;
+    }
+    default: return false;
+    }
+
+    return duskFoldIsExactFloat(type, *out_float);
+}
+
+// Single precision results are computed in double precision and rounded
+// once more when the constant is created. For additions, subtractions and
+// multiplications that gives the correctly rounded result, as a double holds
+// more than twice the digits of a float.
+static DuskIRValue *
+duskFoldFloat(DuskIRModule *module, DuskType *type, double float_value)
+{
+    if (!duskFoldIsExactFloat(type, float_value)) return NULL;
+    return duskIRConstFloatCreate(module, type, float_value);
+}
+
+// Targets are allowed to divide with some error, so only exact quotients are
+// folded
+static DuskIRValue *
+duskFoldFloatDiv(DuskIRModule *module, DuskType *type, double a, double b)
+{
+    if (b == 0.0) return NULL;
+
+    switch (type->float_.bits) {
+    case 32: {
+        // The product of two floats is exact in double precision
+        float quotient = (float)(a / b);
+        if ((double)quotient * b != a) return NULL;
+        return duskFoldFloat(module, type, (double)quotient);
+    }
+    case 64: {
+        double quotient = a / b;
+        if (fma(quotient, b, -a) != 0.0) return NULL;
+        return duskFoldFloat(module, type, quotient);
+    }
+    default: return NULL;
+    }
+}
+
+// Scalar constants making up a constant scalar or vector, zero if the value
+// is neither
+static size_t
+duskFoldGetComponents(DuskIRValue *value, DuskIRValue *components[4])
+{
+    switch (value->kind) {
+    case DUSK_IR_VALUE_CONSTANT_BOOL:
+    case DUSK_IR_VALUE_CONSTANT: {
+        components[0] = value;
+        return 1;
+    }
+    case DUSK_IR_VALUE_CONSTANT_COMPOSITE: {
+        if (value->type->kind != DUSK_TYPE_VECTOR) return 0;
+
+        size_t count = duskArrayLength(value->constant_composite.values_arr);
+        DUSK_ASSERT(count <= 4);
+        for (size_t i = 0; i < count; ++i) {
+            components[i] = value->constant_composite.values_arr[i];
+        }
+        return count;
+    }
+    default: return 0;
+    }
+}
+
+static DuskType *duskFoldComponentType(DuskType *type)
+{
+    return type->kind == DUSK_TYPE_VECTOR ? type->vector.sub : type;
+}
+
+// Builds a scalar or vector constant out of its components, any of which may
+// be NULL if it couldn't be folded
+static DuskIRValue *duskFoldMakeValue(
+    DuskIRModule *module,
+    DuskType *type,
+    size_t count,
+    DuskIRValue **components)
+{
+    for (size_t i = 0; i < count; ++i) {
+        if (!components[i]) return NULL;
+    }
+
+    if (type->kind != DUSK_TYPE_VECTOR) {
+        return count == 1 ? components[0] : NULL;
+    }
+
+    if (count != type->vector.size) return NULL;
+    return duskIRConstCompositeCreate(module, type, count, components);
+}
+
+static bool duskFoldMatches(DuskIRValue *value, DuskFoldPattern pattern)
+{
+    DuskIRValue *components[4];
+    size_t count = duskFoldGetComponents(value, components);
+    if (count == 0) return false;
+
+    for (size_t i = 0; i < count; ++i) {
+        DuskIRValue *component = components[i];
+        DuskType *type = component->type;
+
+        bool matches = false;
+        if (type->kind == DUSK_TYPE_FLOAT) {
+            double x;
+            if (!duskFoldGetFloat(component, &x)) return false;
+
+            switch (pattern) {
+            case DUSK_FOLD_PATTERN_ZERO:
+                matches = x == 0.0 && !signbit(x);
+                break;
+            case DUSK_FOLD_PATTERN_NEGATIVE_ZERO:
+                matches = x == 0.0 && signbit(x);
+                break;
+            case DUSK_FOLD_PATTERN_ONE: matches = x == 1.0; break;
+            case DUSK_FOLD_PATTERN_ALL_ONES: break;
+            }
+        } else if (type->kind == DUSK_TYPE_INT) {
+            uint64_t x = duskFoldGetInt(component);
+            uint64_t mask = UINT64_MAX;
+            if (type->int_.bits < 64) {
+                mask = (UINT64_C(1) << type->int_.bits) - 1;
+            }
+
+            switch (pattern) {
+            case DUSK_FOLD_PATTERN_ZERO: matches = x == 0; break;
+            case DUSK_FOLD_PATTERN_NEGATIVE_ZERO: break;
+            case DUSK_FOLD_PATTERN_ONE: matches = x == 1; break;
+            case DUSK_FOLD_PATTERN_ALL_ONES:
+                matches = (x & mask) == mask;
+                break;
+            }
+        }
+
+        if (!matches) return false;
+    }
+
+    return true;
+}
+
+static bool duskFoldIntLess(DuskType *type, uint64_t a, uint64_t b)
+{
+    if (type->int_.is_signed) return (int64_t)a < (int64_t)b;
+    return a < b;
+}
+
+static DuskIRValue *duskFoldComparison(
+    DuskIRModule *module, DuskBinaryOp op, bool equal, bool less)
+{
+    bool result = false;
+    switch (op) {
+    case DUSK_BINARY_OP_EQ: result = equal; break;
+    case DUSK_BINARY_OP_NOTEQ: result = !equal; break;
+    case DUSK_BINARY_OP_LESS: result = less; break;
+    case DUSK_BINARY_OP_LESSEQ: result = less || equal; break;
+    case DUSK_BINARY_OP_GREATER: result = !less && !equal; break;
+    case DUSK_BINARY_OP_GREATEREQ: result = !less; break;
+    default: return NULL;
+    }
+    return duskIRConstBoolCreate(module, result);
+}
+
+// Comparison that gives the same result with its operands swapped
+static DuskBinaryOp duskMirrorComparison(DuskBinaryOp op)
+{
+    switch (op) {
+    case DUSK_BINARY_OP_LESS: return DUSK_BINARY_OP_GREATER;
+    case DUSK_BINARY_OP_LESSEQ: return DUSK_BINARY_OP_GREATEREQ;
+    case DUSK_BINARY_OP_GREATER: return DUSK_BINARY_OP_LESS;
+    case DUSK_BINARY_OP_GREATEREQ: return DUSK_BINARY_OP_LESSEQ;
+    default: return op;
+    }
+}
+
+// Comparisons of an integer with the smallest or largest value of its type
+// that have the same result for every value
+static DuskIRValue *
+duskSimplifyBoundComparison(DuskIRModule *module, DuskIRValue *inst)
+{
+    DuskBinaryOp op = inst->binary.op;
+    DuskIRValue *constant = inst->binary.right;
+    if (inst->binary.left->kind == DUSK_IR_VALUE_CONSTANT) {
+        constant = inst->binary.left;
+        op = duskMirrorComparison(op);
+    } else if (constant->kind != DUSK_IR_VALUE_CONSTANT) {
+        return NULL;
+    }
+
+    DuskType *type = constant->type;
+    uint32_t bits = type->int_.bits;
+    uint64_t value = duskFoldGetInt(constant);
+    uint64_t min_value = 0;
+    uint64_t max_value = bits < 64 ? (UINT64_C(1) << bits) - 1 : UINT64_MAX;
+    if (type->int_.is_signed) {
+        max_value = (UINT64_C(1) << (bits - 1)) - 1;
+        min_value = ~max_value;
+    }
+
+    if (value == min_value) {
+        if (op == DUSK_BINARY_OP_LESS) {
+            return duskIRConstBoolCreate(module, false);
+        }
+        if (op == DUSK_BINARY_OP_GREATEREQ) {
+            return duskIRConstBoolCreate(module, true);
+        }
+    }
+    if (value == max_value) {
+        if (op == DUSK_BINARY_OP_GREATER) {
+            return duskIRConstBoolCreate(module, false);
+        }
+        if (op == DUSK_BINARY_OP_LESSEQ) {
+            return duskIRConstBoolCreate(module, true);
+        }
+    }
+    return NULL;
+}
+
+static DuskIRValue *duskFoldScalarBinary(
+    DuskIRModule *module,
+    DuskBinaryOp op,
+    DuskType *type,
+    DuskIRValue *left,
+    DuskIRValue *right)
+{
+    DuskType *operand_type = left->type;
+    if (operand_type != right->type) return NULL;
+
+    if (operand_type->kind == DUSK_TYPE_FLOAT) {
+        double a, b;
+        if (!duskFoldGetFloat(left, &a) || !duskFoldGetFloat(right, &b)) {
+            return NULL;
+        }
+
+        switch (op) {
+        case DUSK_BINARY_OP_ADD: return duskFoldFloat(module, type, a + b);
+        case DUSK_BINARY_OP_SUB: return duskFoldFloat(module, type, a - b);
+        case DUSK_BINARY_OP_MUL: return duskFoldFloat(module, type, a * b);
+        case DUSK_BINARY_OP_DIV: return duskFoldFloatDiv(module, type, a, b);
+        default: return duskFoldComparison(module, op, a == b, a < b);
+        }
+    }
+
+    if (operand_type->kind != DUSK_TYPE_INT) return NULL;
+
+    uint64_t a = duskFoldGetInt(left);
+    uint64_t b = duskFoldGetInt(right);
+    uint32_t bits = operand_type->int_.bits;
+    bool is_signed = operand_type->int_.is_signed;
+
+    // Signed division overflows for the minimum value divided by -1
+    uint64_t min_value = is_signed ? UINT64_MAX << (bits - 1) : 0;
+    bool overflows = is_signed && a == min_value && b == UINT64_MAX;
+
+    switch (op) {
+    case DUSK_BINARY_OP_ADD: return duskIRConstIntCreate(module, type, a + b);
+    case DUSK_BINARY_OP_SUB: return duskIRConstIntCreate(module, type, a - b);
+    case DUSK_BINARY_OP_MUL: return duskIRConstIntCreate(module, type, a * b);
+    case DUSK_BINARY_OP_DIV: {
+        if (b == 0 || overflows) return NULL;
+        if (is_signed) {
+            return duskIRConstIntCreate(
+                module, type, (uint64_t)((int64_t)a / (int64_t)b));
+        }
+        return duskIRConstIntCreate(module, type, a / b);
+    }
+    case DUSK_BINARY_OP_MOD: {
+        if (b == 0 || overflows) return NULL;
+        if (is_signed) {
+            // The result has the sign of the right operand, like OpSMod
+            int64_t result = (int64_t)a % (int64_t)b;
+            if (result != 0 && ((result < 0) != ((int64_t)b < 0))) {
+                result += (int64_t)b;
+            }
+            return duskIRConstIntCreate(module, type, (uint64_t)result);
+        }
+        return duskIRConstIntCreate(module, type, a % b);
+    }
+    case DUSK_BINARY_OP_BITAND:
+        return duskIRConstIntCreate(module, type, a & b);
+    case DUSK_BINARY_OP_BITOR:
+        return duskIRConstIntCreate(module, type, a | b);
+    case DUSK_BINARY_OP_BITXOR:
+        return duskIRConstIntCreate(module, type, a ^ b);
+    case DUSK_BINARY_OP_LSHIFT:
+    case DUSK_BINARY_OP_RSHIFT: {
+        // Shifting by the width of the type or more is undefined
+        if (b >= bits) return NULL;
+        if (op == DUSK_BINARY_OP_LSHIFT) {
+            return duskIRConstIntCreate(module, type, a << b);
+        }
+        if (is_signed && (int64_t)a < 0) {
+            return duskIRConstIntCreate(module, type, ~(~a >> b));
+        }
+        return duskIRConstIntCreate(module, type, a >> b);
+    }
+    default: {
+        return duskFoldComparison(
+            module, op, a == b, duskFoldIntLess(operand_type, a, b));
+    }
+    }
+}
+
+static DuskIRValue *duskFoldBinary(DuskIRModule *module, DuskIRValue *inst)
+{
+    DuskIRValue *lefts[4];
+    DuskIRValue *rights[4];
+    size_t left_count = duskFoldGetComponents(inst->binary.left, lefts);
+    size_t right_count = duskFoldGetComponents(inst->binary.right, rights);
+    if (left_count == 0 || right_count == 0) return NULL;
+
+    // Scalars are used for every component of vectors
+    size_t count = left_count > right_count ? left_count : right_count;
+    if ((left_count != count && left_count != 1) ||
+        (right_count != count && right_count != 1)) {
+        return NULL;
+    }
+
+    DuskType *component_type = duskFoldComponentType(inst->type);
+    DuskIRValue *results[4];
+    for (size_t i = 0; i < count; ++i) {
+        results[i] = duskFoldScalarBinary(
+            module,
+            inst->binary.op,
+            component_type,
+            lefts[left_count == 1 ? 0 : i],
+            rights[right_count == 1 ? 0 : i]);
+    }
+
+    return duskFoldMakeValue(module, inst->type, count, results);
+}
+
+// Replaces an instruction by one of its operands, if it has the same type
+static DuskIRValue *duskFoldKeep(DuskIRValue *inst, DuskIRValue *value)
+{
+    return value->type == inst->type ? value : NULL;
+}
+
+// Identities that hold for every value, including negative zeros, infinities
+// and NaNs
+static DuskIRValue *duskSimplifyBinary(DuskIRModule *module, DuskIRValue *inst)
+{
+    DuskIRValue *left = inst->binary.left;
+    DuskIRValue *right = inst->binary.right;
+
+    DuskType *scalar_type = duskGetScalarType(left->type);
+    if (!scalar_type) return NULL;
+    bool is_int = scalar_type->kind == DUSK_TYPE_INT;
+
+    switch (inst->binary.op) {
+    case DUSK_BINARY_OP_ADD: {
+        // Adding a positive zero to a negative zero gives a positive zero
+        DuskFoldPattern zero = is_int ? DUSK_FOLD_PATTERN_ZERO
+                                      : DUSK_FOLD_PATTERN_NEGATIVE_ZERO;
+        if (duskFoldMatches(right, zero)) return duskFoldKeep(inst, left);
+        if (duskFoldMatches(left, zero)) return duskFoldKeep(inst, right);
+        break;
+    }
+    case DUSK_BINARY_OP_SUB: {
+        if (duskFoldMatches(right, DUSK_FOLD_PATTERN_ZERO)) {
+            return duskFoldKeep(inst, left);
+        }
+        if (is_int && left == right) {
+            return duskIRZeroValue(module, inst->type);
+        }
+        break;
+    }
+    case DUSK_BINARY_OP_MUL: {
+        if (duskFoldMatches(right, DUSK_FOLD_PATTERN_ONE)) {
+            return duskFoldKeep(inst, left);
+        }
+        if (duskFoldMatches(left, DUSK_FOLD_PATTERN_ONE)) {
+            return duskFoldKeep(inst, right);
+        }
+        if (is_int && (duskFoldMatches(left, DUSK_FOLD_PATTERN_ZERO) ||
+                       duskFoldMatches(right, DUSK_FOLD_PATTERN_ZERO))) {
+            return duskIRZeroValue(module, inst->type);
+        }
+        break;
+    }
+    case DUSK_BINARY_OP_DIV: {
+        if (duskFoldMatches(right, DUSK_FOLD_PATTERN_ONE)) {
+            return duskFoldKeep(inst, left);
+        }
+        break;
+    }
+    case DUSK_BINARY_OP_BITAND: {
+        if (duskFoldMatches(left, DUSK_FOLD_PATTERN_ZERO) ||
+            duskFoldMatches(right, DUSK_FOLD_PATTERN_ZERO)) {
+            return duskIRZeroValue(module, inst->type);
+        }
+        if (duskFoldMatches(right, DUSK_FOLD_PATTERN_ALL_ONES) ||
+            left == right) {
+            return duskFoldKeep(inst, left);
+        }
+        if (duskFoldMatches(left, DUSK_FOLD_PATTERN_ALL_ONES)) {
+            return duskFoldKeep(inst, right);
+        }
+        break;
+    }
+    case DUSK_BINARY_OP_BITOR: {
+        if (duskFoldMatches(right, DUSK_FOLD_PATTERN_ZERO) || left == right) {
+            return duskFoldKeep(inst, left);
+        }
+        if (duskFoldMatches(left, DUSK_FOLD_PATTERN_ZERO)) {
+            return duskFoldKeep(inst, right);
+        }
+        break;
+    }
+    case DUSK_BINARY_OP_BITXOR: {
+        if (duskFoldMatches(right, DUSK_FOLD_PATTERN_ZERO)) {
+            return duskFoldKeep(inst, left);
+        }
+        if (duskFoldMatches(left, DUSK_FOLD_PATTERN_ZERO)) {
+            return duskFoldKeep(inst, right);
+        }
+        if (left == right) return duskIRZeroValue(module, inst->type);
+        break;
+    }
+    case DUSK_BINARY_OP_LSHIFT:
+    case DUSK_BINARY_OP_RSHIFT: {
+        if (duskFoldMatches(right, DUSK_FOLD_PATTERN_ZERO)) {
+            return duskFoldKeep(inst, left);
+        }
+        break;
+    }
+    case DUSK_BINARY_OP_EQ:
+    case DUSK_BINARY_OP_NOTEQ:
+    case DUSK_BINARY_OP_LESS:
+    case DUSK_BINARY_OP_LESSEQ:
+    case DUSK_BINARY_OP_GREATER:
+    case DUSK_BINARY_OP_GREATEREQ: {
+        if (!is_int || left->type != scalar_type) break;
+
+        // Floats are not equal to themselves when they are NaN
+        if (left == right) {
+            return duskFoldComparison(module, inst->binary.op, true, false);
+        }
+        return duskSimplifyBoundComparison(module, inst);
+    }
+    default: break;
+    }
+
+    return NULL;
+}
+
+static DuskIRValue *duskFoldScalarUnary(
+    DuskIRModule *module, DuskUnaryOp op, DuskType *type, DuskIRValue *right)
+{
+    switch (op) {
+    case DUSK_UNARY_OP_NEGATE: {
+        if (type->kind == DUSK_TYPE_FLOAT) {
+            double x;
+            if (!duskFoldGetFloat(right, &x)) return NULL;
+            return duskFoldFloat(module, type, -x);
+        }
+        if (type->kind == DUSK_TYPE_INT) {
+            return duskIRConstIntCreate(
+                module, type, 0 - duskFoldGetInt(right));
+        }
+        return NULL;
+    }
+    case DUSK_UNARY_OP_NOT: {
+        if (right->kind != DUSK_IR_VALUE_CONSTANT_BOOL) return NULL;
+        return duskIRConstBoolCreate(module, !right->const_bool.value);
+    }
+    case DUSK_UNARY_OP_BITNOT: {
+        if (type->kind != DUSK_TYPE_INT) return NULL;
+        return duskIRConstIntCreate(module, type, ~duskFoldGetInt(right));
+    }
+    }
+
+    return NULL;
+}
+
+static DuskIRValue *duskFoldUnary(DuskIRModule *module, DuskIRValue *inst)
+{
+    DuskIRValue *right = inst->unary.right;
+
+    // Applying the same operation twice gives back the original value
+    if (right->kind == DUSK_IR_VALUE_UNARY_OPERATION &&
+        right->unary.op == inst->unary.op) {
+        return duskFoldKeep(inst, right->unary.right);
+    }
+
+    DuskIRValue *components[4];
+    size_t count = duskFoldGetComponents(right, components);
+    if (count == 0) return NULL;
+
+    DuskType *component_type = duskFoldComponentType(inst->type);
+    DuskIRValue *results[4];
+    for (size_t i = 0; i < count; ++i) {
+        results[i] = duskFoldScalarUnary(
+            module, inst->unary.op, component_type, components[i]);
+    }
+
+    return duskFoldMakeValue(module, inst->type, count, results);
+}
+
+static DuskIRValue *
+duskFoldScalarCast(DuskIRModule *module, DuskType *type, DuskIRValue *value)
+{
+    DuskType *source_type = value->type;
+
+    if (source_type->kind == DUSK_TYPE_INT) {
+        uint64_t int_value = duskFoldGetInt(value);
+        bool is_signed = source_type->int_.is_signed;
+
+        if (type->kind == DUSK_TYPE_INT) {
+            return duskIRConstIntCreate(module, type, int_value);
+        }
+
+        if (type->kind == DUSK_TYPE_FLOAT) {
+            // Converted straight to the destination precision, so the value
+            // is only rounded once
+            switch (type->float_.bits) {
+            case 32: {
+                float float_value = is_signed ? (float)(int64_t)int_value
+                                              : (float)int_value;
+                return duskFoldFloat(module, type, (double)float_value);
+            }
+            case 64: {
+                double float_value = is_signed ? (double)(int64_t)int_value
+                                               : (double)int_value;
+                return duskFoldFloat(module, type, float_value);
+            }
+            default: return NULL;
+            }
+        }
+
+        return NULL;
+    }
+
+    if (source_type->kind == DUSK_TYPE_FLOAT) {
+        double float_value;
+        if (!duskFoldGetFloat(value, &float_value)) return NULL;
+
+        if (type->kind == DUSK_TYPE_FLOAT) {
+            return duskFoldFloat(module, type, float_value);
+        }
+
+        if (type->kind == DUSK_TYPE_INT) {
+            // Conversions of values that don't fit in the integer type are
+            // undefined
+            double truncated = trunc(float_value);
+            int bits = (int)type->int_.bits;
+            if (type->int_.is_signed) {
+                double limit = ldexp(1.0, bits - 1);
+                if (truncated < -limit || truncated >= limit) return NULL;
+                return duskIRConstIntCreate(
+                    module, type, (uint64_t)(int64_t)truncated);
+            }
+
+            double limit = ldexp(1.0, bits);
+            if (truncated < 0.0 || truncated >= limit) return NULL;
+            return duskIRConstIntCreate(module, type, (uint64_t)truncated);
+        }
+    }
+
+    return NULL;
+}
+
+static DuskIRValue *duskFoldCast(DuskIRModule *module, DuskIRValue *inst)
+{
+    DuskIRValue *components[4];
+    size_t count = duskFoldGetComponents(inst->cast.value, components);
+    if (count == 0) return NULL;
+
+    DuskType *component_type = duskFoldComponentType(inst->type);
+    DuskIRValue *results[4];
+    for (size_t i = 0; i < count; ++i) {
+        results[i] = duskFoldScalarCast(module, component_type, components[i]);
+    }
+
+    return duskFoldMakeValue(module, inst->type, count, results);
+}
+
+static DuskIRValue *duskFoldScalarBuiltin(
+    DuskIRModule *module,
+    DuskBuiltinFunctionKind kind,
+    DuskType *type,
+    size_t param_count,
+    DuskIRValue **params)
+{
+    if (type->kind == DUSK_TYPE_FLOAT) {
+        double x[3];
+        for (size_t i = 0; i < param_count; ++i) {
+            if (params[i]->type != type) return NULL;
+            if (!duskFoldGetFloat(params[i], &x[i])) return NULL;
+        }
+
+        switch (kind) {
+        case DUSK_BUILTIN_FUNCTION_ABS:
+            return duskFoldFloat(module, type, fabs(x[0]));
+        case DUSK_BUILTIN_FUNCTION_FLOOR:
+            return duskFoldFloat(module, type, floor(x[0]));
+        case DUSK_BUILTIN_FUNCTION_CEIL:
+            return duskFoldFloat(module, type, ceil(x[0]));
+        case DUSK_BUILTIN_FUNCTION_TRUNC:
+            return duskFoldFloat(module, type, trunc(x[0]));
+        case DUSK_BUILTIN_FUNCTION_FRACT:
+            // Defined as a subtraction, which rounds like the others
+            return duskFoldFloat(module, type, x[0] - floor(x[0]));
+        case DUSK_BUILTIN_FUNCTION_ROUND: {
+            // The direction in which halves are rounded is up to the target
+            if (fabs(x[0] - trunc(x[0])) == 0.5) return NULL;
+            return duskFoldFloat(module, type, round(x[0]));
+        }
+        // Defined with comparisons, which also decide between signed zeros
+        case DUSK_BUILTIN_FUNCTION_MIN:
+            return duskFoldFloat(module, type, x[1] < x[0] ? x[1] : x[0]);
+        case DUSK_BUILTIN_FUNCTION_MAX:
+            return duskFoldFloat(module, type, x[0] < x[1] ? x[1] : x[0]);
+        case DUSK_BUILTIN_FUNCTION_CLAMP: {
+            // Undefined if the bounds are reversed
+            if (x[2] < x[1]) return NULL;
+            double result = x[0] < x[1] ? x[1] : x[0];
+            result = x[2] < result ? x[2] : result;
+            return duskFoldFloat(module, type, result);
+        }
+        default: return NULL;
+        }
+    }
+
+    if (type->kind == DUSK_TYPE_INT) {
+        uint64_t x[3];
+        for (size_t i = 0; i < param_count; ++i) {
+            if (params[i]->type != type) return NULL;
+            x[i] = duskFoldGetInt(params[i]);
+        }
+
+        switch (kind) {
+        case DUSK_BUILTIN_FUNCTION_ABS: {
+            // Always computed on the signed value, the minimum value has no
+            // positive counterpart
+            uint64_t sign_bit = UINT64_C(1) << (type->int_.bits - 1);
+            uint64_t value = x[0];
+            if (!type->int_.is_signed) value = (value ^ sign_bit) - sign_bit;
+            if (value == UINT64_MAX << (type->int_.bits - 1)) return NULL;
+            if ((int64_t)value < 0) value = 0 - value;
+            return duskIRConstIntCreate(module, type, value);
+        }
+        case DUSK_BUILTIN_FUNCTION_MIN: {
+            uint64_t result = duskFoldIntLess(type, x[1], x[0]) ? x[1] : x[0];
+            return duskIRConstIntCreate(module, type, result);
+        }
+        case DUSK_BUILTIN_FUNCTION_MAX: {
+            uint64_t result = duskFoldIntLess(type, x[0], x[1]) ? x[1] : x[0];
+            return duskIRConstIntCreate(module, type, result);
+        }
+        case DUSK_BUILTIN_FUNCTION_CLAMP: {
+            if (duskFoldIntLess(type, x[2], x[1])) return NULL;
+            uint64_t result = x[0];
+            if (duskFoldIntLess(type, result, x[1])) result = x[1];
+            if (duskFoldIntLess(type, x[2], result)) result = x[2];
+            return duskIRConstIntCreate(module, type, result);
+        }
+        default: return NULL;
+        }
+    }
+
+    return NULL;
+}
+
+static DuskIRValue *duskFoldBuiltin(DuskIRModule *module, DuskIRValue *inst)
+{
+    size_t param_count = inst->builtin_call.param_count;
+    if (param_count == 0 || param_count > 3) return NULL;
+
+    DuskIRValue *components[3][4];
+    size_t counts[3];
+    size_t count = 0;
+    for (size_t i = 0; i < param_count; ++i) {
+        counts[i] = duskFoldGetComponents(
+            inst->builtin_call.params[i], components[i]);
+        if (counts[i] == 0) return NULL;
+        if (counts[i] > count) count = counts[i];
+    }
+
+    // Every parameter has as many components as the result
+    DuskType *component_type = duskFoldComponentType(inst->type);
+    if ((inst->type->kind == DUSK_TYPE_VECTOR ? inst->type->vector.size
+                                              : 1) != count) {
+        return NULL;
+    }
+
+    DuskIRValue *results[4];
+    for (size_t i = 0; i < count; ++i) {
+        DuskIRValue *params[3];
+        for (size_t j = 0; j < param_count; ++j) {
+            if (counts[j] != count) return NULL;
+            params[j] = components[j][i];
+        }
+        results[i] = duskFoldScalarBuiltin(
+            module,
+            inst->builtin_call.builtin_kind,
+            component_type,
+            param_count,
+            params);
+    }
+
+    return duskFoldMakeValue(module, inst->type, count, results);
+}
+
+static DuskIRValue *
+duskFoldCompositeConstruct(DuskIRModule *module, DuskIRValue *inst)
+{
+    DuskArray(DuskIRValue *) values_arr = inst->composite_construct.values_arr;
+    size_t value_count = duskArrayLength(values_arr);
+    for (size_t i = 0; i < value_count; ++i) {
+        if (!duskIRValueIsConstant(values_arr[i])) return NULL;
+    }
+
+    if (inst->type->kind != DUSK_TYPE_VECTOR) {
+        return duskIRConstCompositeCreate(
+            module, inst->type, value_count, values_arr);
+    }
+
+    // Vectors can be constructed out of smaller vectors
+    DuskIRValue *components[4];
+    size_t count = 0;
+    for (size_t i = 0; i < value_count; ++i) {
+        DuskIRValue *value_components[4];
+        size_t value_component_count =
+            duskFoldGetComponents(values_arr[i], value_components);
+        if (value_component_count == 0 ||
+            count + value_component_count > inst->type->vector.size) {
+            return NULL;
+        }
+
+        for (size_t j = 0; j < value_component_count; ++j) {
+            components[count++] = value_components[j];
+        }
+    }
+
+    return duskFoldMakeValue(module, inst->type, count, components);
+}
+
+static DuskIRValue *duskFoldCompositeExtract(DuskIRValue *inst)
+{
+    DuskIRValue *value = inst->composite_extract.composite;
+    DuskArray(uint32_t) indices_arr = inst->composite_extract.indices_arr;
+    for (size_t i = 0; i < duskArrayLength(indices_arr); ++i) {
+        if (value->kind != DUSK_IR_VALUE_CONSTANT_COMPOSITE) return NULL;
+
+        DuskArray(DuskIRValue *) values_arr =
+            value->constant_composite.values_arr;
+        if (indices_arr[i] >= duskArrayLength(values_arr)) return NULL;
+        value = values_arr[indices_arr[i]];
+    }
+
+    return duskFoldKeep(inst, value);
+}
+
+static DuskIRValue *
+duskFoldVectorShuffle(DuskIRModule *module, DuskIRValue *inst)
+{
+    DuskIRValue *vec1 = inst->vector_shuffle.vec1;
+    DuskIRValue *vec2 = inst->vector_shuffle.vec2;
+
+    // Only the vectors that components are taken from need to be constant
+    DuskIRValue *components1[4];
+    DuskIRValue *components2[4];
+    size_t count1 = duskFoldGetComponents(vec1, components1);
+    size_t count2 = duskFoldGetComponents(vec2, components2);
+    size_t size1 = vec1->type->vector.size;
+
+    DuskArray(uint32_t) indices_arr = inst->vector_shuffle.indices_arr;
+    size_t count = duskArrayLength(indices_arr);
+    if (count > 4) return NULL;
+
+    DuskIRValue *results[4];
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t index = indices_arr[i];
+        if (index < size1) {
+            if (count1 != size1) return NULL;
+            results[i] = components1[index];
+        } else {
+            index -= (uint32_t)size1;
+            if (index >= count2) return NULL;
+            results[i] = components2[index];
+        }
+    }
+
+    return duskFoldMakeValue(module, inst->type, count, results);
+}
+
+// Component of a vector, with the last vector it can be extracted from and
+// the scalar it was built from, if there is one
+typedef struct DuskComponent {
+    DuskIRValue *vector;
+    uint32_t index;
+    DuskIRValue *scalar;
+} DuskComponent;
+
+// Finds where a component of a vector comes from, looking through the
+// shuffles, constructs and inserts that moved it, and through the extracts the
+// scalars it was built from were taken from
+static DuskComponent duskResolveComponent(DuskIRValue *vector, uint32_t index)
+{
+    DuskComponent component = {vector, index, NULL};
+    while (true) {
+        DuskIRValue *value = component.vector;
+        DuskIRValue *next_vector = NULL;
+        uint32_t next_index = component.index;
+        DuskIRValue *scalar = NULL;
+
+        switch (value->kind) {
+        case DUSK_IR_VALUE_VECTOR_SHUFFLE: {
+            uint32_t shuffle_index =
+                value->vector_shuffle.indices_arr[component.index];
+            uint32_t size1 = value->vector_shuffle.vec1->type->vector.size;
+            if (shuffle_index == UINT32_MAX) {
+                // Undefined component
+                break;
+            } else if (shuffle_index < size1) {
+                next_vector = value->vector_shuffle.vec1;
+                next_index = shuffle_index;
+            } else {
+                next_vector = value->vector_shuffle.vec2;
+                next_index = shuffle_index - size1;
+            }
+            break;
+        }
+        case DUSK_IR_VALUE_COMPOSITE_CONSTRUCT: {
+            DuskArray(DuskIRValue *) values_arr =
+                value->composite_construct.values_arr;
+            for (size_t i = 0; i < duskArrayLength(values_arr); ++i) {
+                DuskType *type = values_arr[i]->type;
+                uint32_t size =
+                    type->kind == DUSK_TYPE_VECTOR ? type->vector.size : 1;
+                if (next_index >= size) {
+                    next_index -= size;
+                } else if (type->kind == DUSK_TYPE_VECTOR) {
+                    next_vector = values_arr[i];
+                    break;
+                } else {
+                    scalar = values_arr[i];
+                    break;
+                }
+            }
+            break;
+        }
+        case DUSK_IR_VALUE_COMPOSITE_INSERT: {
+            if (value->composite_insert.indices_arr[0] == component.index) {
+                scalar = value->composite_insert.object;
+            } else {
+                next_vector = value->composite_insert.composite;
+            }
+            break;
+        }
+        case DUSK_IR_VALUE_CONSTANT_COMPOSITE: {
+            scalar = value->constant_composite.values_arr[component.index];
+            break;
+        }
+        default: break;
+        }
+
+        if (scalar) {
+            if (!component.scalar) component.scalar = scalar;
+
+            if (scalar->kind == DUSK_IR_VALUE_COMPOSITE_EXTRACT &&
+                duskArrayLength(scalar->composite_extract.indices_arr) == 1 &&
+                scalar->composite_extract.composite->type->kind ==
+                    DUSK_TYPE_VECTOR) {
+                next_vector = scalar->composite_extract.composite;
+                next_index = scalar->composite_extract.indices_arr[0];
+            }
+        }
+
+        if (!next_vector) return component;
+        component.vector = next_vector;
+        component.index = next_index;
+    }
+}
+
+// Turns an instruction into a shuffle of the vectors its components come
+// from, if there are at most two of them. Returns the vector if the shuffle
+// would only copy it, the instruction if it was turned into a shuffle, or NULL.
+static DuskIRValue *duskShuffleComponents(
+    DuskIRModule *module,
+    DuskIRValue *inst,
+    DuskComponent *components,
+    size_t count)
+{
+    DuskIRValue *sources[2] = {NULL, NULL};
+    for (size_t i = 0; i < count; ++i) {
+        DuskIRValue *vector = components[i].vector;
+        if (!sources[0] || sources[0] == vector) {
+            sources[0] = vector;
+        } else if (!sources[1] || sources[1] == vector) {
+            sources[1] = vector;
+        } else {
+            return NULL;
+        }
+    }
+
+    DuskArray(uint32_t) indices_arr =
+        duskArrayCreate(module->allocator, uint32_t);
+    bool is_copy = sources[1] == NULL && sources[0]->type == inst->type;
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t index = components[i].index;
+        if (components[i].vector != sources[0]) {
+            index += sources[0]->type->vector.size;
+        }
+        duskArrayPush(&indices_arr, index);
+        is_copy = is_copy && index == i;
+    }
+    if (is_copy) return sources[0];
+
+    inst->kind = DUSK_IR_VALUE_VECTOR_SHUFFLE;
+    inst->vector_shuffle.vec1 = sources[0];
+    inst->vector_shuffle.vec2 = sources[1] ? sources[1] : sources[0];
+    inst->vector_shuffle.indices_arr = indices_arr;
+    return inst;
+}
+
+// Extracts from the composite an extracted composite was extracted from, and
+// forwards the values that were inserted into or used to construct the
+// composite
+static DuskIRValue *
+duskCoalesceCompositeExtract(DuskIRModule *module, DuskIRValue *inst)
+{
+    DuskAllocator *allocator = module->allocator;
+    DuskIRValue *composite = inst->composite_extract.composite;
+    DuskArray(uint32_t) indices_arr = inst->composite_extract.indices_arr;
+    // Number of indices that were already taken into account
+    size_t first_index = 0;
+    bool changed = false;
+
+    while (first_index < duskArrayLength(indices_arr)) {
+        size_t index_count = duskArrayLength(indices_arr) - first_index;
+
+        if (composite->kind == DUSK_IR_VALUE_COMPOSITE_EXTRACT) {
+            DuskArray(uint32_t) composite_indices_arr =
+                composite->composite_extract.indices_arr;
+            DuskArray(uint32_t) chained_arr =
+                duskArrayCreate(allocator, uint32_t);
+            for (size_t i = 0; i < duskArrayLength(composite_indices_arr);
+                 ++i) {
+                duskArrayPush(&chained_arr, composite_indices_arr[i]);
+            }
+            for (size_t i = first_index; i < duskArrayLength(indices_arr);
+                 ++i) {
+                duskArrayPush(&chained_arr, indices_arr[i]);
+            }
+
+            composite = composite->composite_extract.composite;
+            indices_arr = chained_arr;
+            first_index = 0;
+        } else if (composite->type->kind == DUSK_TYPE_VECTOR) {
+            DuskComponent component =
+                duskResolveComponent(composite, indices_arr[first_index]);
+            if (component.scalar) return duskFoldKeep(inst, component.scalar);
+            if (component.vector == composite) break;
+
+            composite = component.vector;
+            indices_arr = duskArrayCreate(allocator, uint32_t);
+            duskArrayPush(&indices_arr, component.index);
+            first_index = 0;
+        } else if (composite->kind == DUSK_IR_VALUE_COMPOSITE_CONSTRUCT) {
+            uint32_t index = indices_arr[first_index++];
+            composite = composite->composite_construct.values_arr[index];
+        } else if (composite->kind == DUSK_IR_VALUE_COMPOSITE_INSERT) {
+            DuskArray(uint32_t) insert_indices_arr =
+                composite->composite_insert.indices_arr;
+            size_t insert_index_count = duskArrayLength(insert_indices_arr);
+
+            size_t shared_count = 0;
+            while (shared_count < insert_index_count &&
+                   shared_count < index_count &&
+                   insert_indices_arr[shared_count] ==
+                       indices_arr[first_index + shared_count]) {
+                shared_count++;
+            }
+
+            if (shared_count == insert_index_count) {
+                composite = composite->composite_insert.object;
+                first_index += shared_count;
+            } else if (shared_count == index_count) {
+                // Only part of the extracted value was inserted
+                break;
+            } else {
+                composite = composite->composite_insert.composite;
+            }
+        } else {
+            break;
+        }
+
+        changed = true;
+    }
+
+    if (!changed) return NULL;
+    if (first_index == duskArrayLength(indices_arr)) {
+        return duskFoldKeep(inst, composite);
+    }
+
+    if (first_index > 0) {
+        DuskArray(uint32_t) remaining_arr =
+            duskArrayCreate(allocator, uint32_t);
+        for (size_t i = first_index; i < duskArrayLength(indices_arr); ++i) {
+            duskArrayPush(&remaining_arr, indices_arr[i]);
+        }
+        indices_arr = remaining_arr;
+    }
+
+    inst->composite_extract.composite = composite;
+    inst->composite_extract.indices_arr = indices_arr;
+    return NULL;
+}
+
+// Takes the components of a shuffle from the vectors the shuffled vectors
+// were made from, or constructs the result out of the scalars they were made
+// from
+static DuskIRValue *
+duskCoalesceVectorShuffle(DuskIRModule *module, DuskIRValue *inst)
+{
+    DuskIRValue *vec1 = inst->vector_shuffle.vec1;
+    DuskIRValue *vec2 = inst->vector_shuffle.vec2;
+    uint32_t size1 = vec1->type->vector.size;
+
+    DuskArray(uint32_t) indices_arr = inst->vector_shuffle.indices_arr;
+    size_t count = duskArrayLength(indices_arr);
+    if (count > 4) return NULL;
+
+    DuskComponent components[4];
+    bool has_scalars = true;
+    bool from_constructs = false;
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t index = indices_arr[i];
+        if (index == UINT32_MAX) return NULL;
+
+        if (index < size1) {
+            components[i] = duskResolveComponent(vec1, index);
+        } else {
+            components[i] = duskResolveComponent(vec2, index - size1);
+        }
+
+        has_scalars = has_scalars && components[i].scalar;
+        from_constructs =
+            from_constructs || components[i].vector->kind ==
+                                   DUSK_IR_VALUE_COMPOSITE_CONSTRUCT;
+    }
+
+    // Constructs are skipped when the components come from scalars that
+    // weren't extracted from a vector
+    if (has_scalars && from_constructs) {
+        DuskArray(DuskIRValue *) values_arr =
+            duskArrayCreate(module->allocator, DuskIRValue *);
+        for (size_t i = 0; i < count; ++i) {
+            duskArrayPush(&values_arr, components[i].scalar);
+        }
+
+        inst->kind = DUSK_IR_VALUE_COMPOSITE_CONSTRUCT;
+        inst->composite_construct.values_arr = values_arr;
+        return NULL;
+    }
+
+    bool changed = false;
+    for (size_t i = 0; i < count; ++i) {
+        DuskIRValue *vector = indices_arr[i] < size1 ? vec1 : vec2;
+        changed = changed || components[i].vector != vector;
+    }
+    if (!changed) return NULL;
+
+    DuskIRValue *shuffled =
+        duskShuffleComponents(module, inst, components, count);
+    return shuffled == inst ? NULL : shuffled;
+}
+
+// Vectors constructed out of the components of at most two vectors are
+// shuffled out of them instead
+static DuskIRValue *
+duskCoalesceCompositeConstruct(DuskIRModule *module, DuskIRValue *inst)
+{
+    if (inst->type->kind != DUSK_TYPE_VECTOR) return NULL;
+
+    DuskComponent components[4];
+    size_t count = 0;
+    DuskArray(DuskIRValue *) values_arr = inst->composite_construct.values_arr;
+    for (size_t i = 0; i < duskArrayLength(values_arr); ++i) {
+        DuskIRValue *value = values_arr[i];
+        if (value->type->kind == DUSK_TYPE_VECTOR) {
+            for (uint32_t j = 0; j < value->type->vector.size; ++j) {
+                if (count == 4) return NULL;
+                components[count++] = duskResolveComponent(value, j);
+            }
+        } else if (
+            value->kind == DUSK_IR_VALUE_COMPOSITE_EXTRACT &&
+            duskArrayLength(value->composite_extract.indices_arr) == 1 &&
+            value->composite_extract.composite->type->kind ==
+                DUSK_TYPE_VECTOR) {
+            if (count == 4) return NULL;
+            components[count++] = duskResolveComponent(
+                value->composite_extract.composite,
+                value->composite_extract.indices_arr[0]);
+        } else {
+            return NULL;
+        }
+    }
+
+    DuskIRValue *shuffled =
+        duskShuffleComponents(module, inst, components, count);
+    return shuffled == inst ? NULL : shuffled;
+}
+
+static DuskIRValue *duskFoldInst(DuskIRModule *module, DuskIRValue *inst)
+{
+    switch (inst->kind) {
+    case DUSK_IR_VALUE_BINARY_OPERATION: {
+        DuskIRValue *folded = duskFoldBinary(module, inst);
+        if (!folded) folded = duskSimplifyBinary(module, inst);
+        return folded;
+    }
+    case DUSK_IR_VALUE_UNARY_OPERATION: return duskFoldUnary(module, inst);
+    case DUSK_IR_VALUE_CAST: return duskFoldCast(module, inst);
+    case DUSK_IR_VALUE_BUILTIN_CALL: return duskFoldBuiltin(module, inst);
+    case DUSK_IR_VALUE_COMPOSITE_CONSTRUCT: {
+        DuskIRValue *folded = duskFoldCompositeConstruct(module, inst);
+        if (!folded) folded = duskCoalesceCompositeConstruct(module, inst);
+        return folded;
+    }
+    case DUSK_IR_VALUE_COMPOSITE_EXTRACT: {
+        DuskIRValue *folded = duskFoldCompositeExtract(inst);
+        if (!folded) folded = duskCoalesceCompositeExtract(module, inst);
+        return folded;
+    }
+    case DUSK_IR_VALUE_VECTOR_SHUFFLE: {
+        DuskIRValue *folded = duskFoldVectorShuffle(module, inst);
+        if (!folded) folded = duskCoalesceVectorShuffle(module, inst);
+        return folded;
+    }
+    default: return NULL;
+    }
+}
+
+static bool duskIsInstruction(DuskIRValue *value)
+{
+    switch (value->kind) {
+    case DUSK_IR_VALUE_CONSTANT_BOOL:
+    case DUSK_IR_VALUE_CONSTANT:
+    case DUSK_IR_VALUE_CONSTANT_COMPOSITE:
+    case DUSK_IR_VALUE_FUNCTION:
+    case DUSK_IR_VALUE_FUNCTION_PARAMETER:
+    case DUSK_IR_VALUE_BLOCK:
+    case DUSK_IR_VALUE_VARIABLE: return false;
+    default: return true;
+    }
+}
+
+static void duskFoldReplaceOperand(
+    void *user_data, DuskIRValue *inst, DuskIRValue **operand)
+{
+    DuskFoldState *state = (DuskFoldState *)user_data;
+    (void)inst;
+
+    DuskIRValue *value = *operand;
+    if (!duskIsInstruction(value) || value->id >= state->inst_count ||
+        state->insts[value->id] != value) {
+        return;
+    }
+
+    if (state->replacements[value->id]) {
+        *operand = state->replacements[value->id];
+    }
+}
+
+void duskIRFoldConstants(DuskIRModule *module, DuskIRValue *function)
+{
+    DUSK_ASSERT(function->kind == DUSK_IR_VALUE_FUNCTION);
+
+    DuskAllocator *allocator = module->allocator;
+    DuskIRValue **blocks = function->function.blocks_arr;
+    size_t block_count = duskArrayLength(function->function.blocks_arr);
+
+    DuskFoldState state_storage = {0};
+    DuskFoldState *state = &state_storage;
+
+    for (size_t i = 0; i < block_count; ++i) {
+        state->inst_count += duskArrayLength(blocks[i]->block.insts_arr);
+    }
+
+    state->insts = DUSK_NEW_ARRAY(allocator, DuskIRValue *, state->inst_count);
+    state->replacements =
+        DUSK_NEW_ARRAY(allocator, DuskIRValue *, state->inst_count);
+
+    size_t inst_index = 0;
+    for (size_t i = 0; i < block_count; ++i) {
+        DuskArray(DuskIRValue *) insts_arr = blocks[i]->block.insts_arr;
+        for (size_t j = 0; j < duskArrayLength(insts_arr); ++j) {
+            DuskIRValue *inst = insts_arr[j];
+            inst->id = (uint32_t)inst_index;
+            state->insts[inst_index++] = inst;
+        }
+    }
+
+    // Blocks come after the blocks that dominate them, so the operands of an
+    // instruction are folded before it, except for the incoming values of
+    // phis from later blocks
+    bool any_folded = false;
+    for (size_t i = 0; i < state->inst_count; ++i) {
+        DuskIRValue *inst = state->insts[i];
+        duskIRForEachOperand(inst, state, duskFoldReplaceOperand);
+
+        state->replacements[i] = duskFoldInst(module, inst);
+        any_folded = any_folded || state->replacements[i];
+    }
+    if (!any_folded) return;
+
+    for (size_t i = 0; i < block_count; ++i) {
+        DuskIRValue *block = blocks[i];
+        DuskArray(DuskIRValue *) insts_arr =
+            duskArrayCreate(allocator, DuskIRValue *);
+
+        for (size_t j = 0; j < duskArrayLength(block->block.insts_arr); ++j) {
+            DuskIRValue *inst = block->block.insts_arr[j];
+            if (state->replacements[inst->id]) continue;
+
+            duskIRForEachOperand(inst, state, duskFoldReplaceOperand);
+            duskArrayPush(&insts_arr, inst);
+        }
+
+        block->block.insts_arr = insts_arr;
+    }
+}
+// }}}
+
+// Dead code elimination {{{
+
+// Blocks that no branch reaches are removed, except for the merge and continue
+// blocks of the selections and loops that are kept, which structured control
+// flow has to name. Those are only left with an OpUnreachable, or with the
+// branch back to their loop header for continue blocks. Then the instructions
+// without side effects are removed if no instruction that is kept uses them.
+//
+// While the pass runs, the id of the blocks, variables and instructions of the
+// function is their index in the arrays below.
+
+typedef struct DuskDeadCodeState {
+    DuskIRValue **insts;
+    bool *live_insts;
+    size_t inst_count;
+
+    DuskIRValue **vars;
+    bool *live_vars;
+    size_t var_count;
+
+    // Instructions found to be live whose operands are yet to be visited
+    DuskArray(DuskIRValue *) live_arr;
+} DuskDeadCodeState;
+
+static bool duskHasSideEffects(DuskIRValue *inst)
+{
+    switch (inst->kind) {
+    case DUSK_IR_VALUE_LOAD:
+    case DUSK_IR_VALUE_ACCESS_CHAIN:
+    case DUSK_IR_VALUE_COMPOSITE_EXTRACT:
+    case DUSK_IR_VALUE_COMPOSITE_INSERT:
+    case DUSK_IR_VALUE_VECTOR_SHUFFLE:
+    case DUSK_IR_VALUE_COMPOSITE_CONSTRUCT:
+    case DUSK_IR_VALUE_CAST:
+    case DUSK_IR_VALUE_BINARY_OPERATION:
+    case DUSK_IR_VALUE_UNARY_OPERATION:
+    case DUSK_IR_VALUE_PHI:
+    case DUSK_IR_VALUE_ARRAY_LENGTH: return false;
+    case DUSK_IR_VALUE_BUILTIN_CALL: {
+        return inst->builtin_call.builtin_kind ==
+               DUSK_BUILTIN_FUNCTION_IMAGE_STORE;
+    }
+    // Called functions could write to memory
+    default: return true;
+    }
+}
+
+static bool duskBranchesTo(DuskIRValue *block, DuskIRValue *dest_block)
+{
+    DuskIRValue *successors[2];
+    size_t successor_count;
+    duskGetSuccessors(block, successors, &successor_count);
+
+    for (size_t i = 0; i < successor_count; ++i) {
+        if (successors[i] == dest_block) return true;
+    }
+    return false;
+}
+
+static void duskMarkLiveOperand(
+    void *user_data, DuskIRValue *inst, DuskIRValue **operand)
+{
+    DuskDeadCodeState *state = (DuskDeadCodeState *)user_data;
+    (void)inst;
+
+    DuskIRValue *value = *operand;
+    if (duskIsLocalVariable(value)) {
+        if (value->id < state->var_count && state->vars[value->id] == value) {
+            state->live_vars[value->id] = true;
+        }
+        return;
+    }
+
+    if (!duskIsInstruction(value) || value->id >= state->inst_count ||
+        state->insts[value->id] != value || state->live_insts[value->id]) {
+        return;
+    }
+
+    state->live_insts[value->id] = true;
+    duskArrayPush(&state->live_arr, value);
+}
+
+// Removes the blocks that aren't reached, and returns whether any was
+static bool
+duskRemoveUnreachableBlocks(DuskIRModule *module, DuskIRValue *function)
+{
+    DuskAllocator *allocator = module->allocator;
+    DuskIRValue **blocks = function->function.blocks_arr;
+    size_t block_count = duskArrayLength(function->function.blocks_arr);
+
+    size_t inst_count = 0;
+    for (size_t i = 0; i < block_count; ++i) {
+        blocks[i]->id = (uint32_t)i;
+        inst_count += duskArrayLength(blocks[i]->block.insts_arr);
+    }
+
+    // Block of each instruction, to tell which values the incoming edges of
+    // the phis can still use
+    DuskIRValue **insts = DUSK_NEW_ARRAY(allocator, DuskIRValue *, inst_count);
+    uint32_t *inst_blocks = DUSK_NEW_ARRAY(allocator, uint32_t, inst_count);
+    size_t inst_index = 0;
+    for (size_t i = 0; i < block_count; ++i) {
+        DuskArray(DuskIRValue *) insts_arr = blocks[i]->block.insts_arr;
+        for (size_t j = 0; j < duskArrayLength(insts_arr); ++j) {
+            insts_arr[j]->id = (uint32_t)inst_index;
+            insts[inst_index] = insts_arr[j];
+            inst_blocks[inst_index++] = (uint32_t)i;
+        }
+    }
+
+    bool *reachable = DUSK_NEW_ARRAY(allocator, bool, block_count);
+    DuskArray(uint32_t) stack_arr = duskArrayCreate(allocator, uint32_t);
+    reachable[0] = true;
+    duskArrayPush(&stack_arr, 0);
+    while (duskArrayLength(stack_arr) > 0) {
+        uint32_t block_index = stack_arr[duskArrayLength(stack_arr) - 1];
+        duskArrayPop(&stack_arr);
+
+        DuskIRValue *successors[2];
+        size_t successor_count;
+        duskGetSuccessors(blocks[block_index], successors, &successor_count);
+        for (size_t i = 0; i < successor_count; ++i) {
+            uint32_t successor_index = successors[i]->id;
+            if (reachable[successor_index]) continue;
+            reachable[successor_index] = true;
+            duskArrayPush(&stack_arr, successor_index);
+        }
+    }
+
+    // Header of the loop of the continue blocks that are kept
+    DuskIRValue **loop_headers =
+        DUSK_NEW_ARRAY(allocator, DuskIRValue *, block_count);
+    bool *kept = DUSK_NEW_ARRAY(allocator, bool, block_count);
+    bool all_reachable = true;
+    for (size_t i = 0; i < block_count; ++i) {
+        if (!reachable[i]) {
+            all_reachable = false;
+            continue;
+        }
+        kept[i] = true;
+
+        DuskArray(DuskIRValue *) insts_arr = blocks[i]->block.insts_arr;
+        for (size_t j = 0; j < duskArrayLength(insts_arr); ++j) {
+            DuskIRValue *inst = insts_arr[j];
+            if (inst->kind == DUSK_IR_VALUE_SELECTION_MERGE) {
+                kept[inst->selection_merge.merge_block->id] = true;
+            } else if (inst->kind == DUSK_IR_VALUE_LOOP_MERGE) {
+                DuskIRValue *continue_block = inst->loop_merge.continue_block;
+                kept[inst->loop_merge.merge_block->id] = true;
+                kept[continue_block->id] = true;
+                loop_headers[continue_block->id] = blocks[i];
+            }
+        }
+    }
+    if (all_reachable) return false;
+
+    size_t kept_count = 0;
+    for (size_t i = 0; i < block_count; ++i) {
+        DuskIRValue *block = blocks[i];
+        if (!kept[i]) continue;
+
+        if (!reachable[i]) {
+            block->block.insts_arr = duskArrayCreate(allocator, DuskIRValue *);
+            if (loop_headers[i]) {
+                duskIRCreateBranch(module, block, loop_headers[i]);
+            } else {
+                duskIRCreateUnreachable(module, block);
+            }
+        }
+        blocks[kept_count++] = block;
+    }
+    duskArrayResize(&function->function.blocks_arr, kept_count);
+
+    // Phis only keep the edges that are left. Values that come from blocks
+    // that aren't reached are replaced, as they aren't defined anymore.
+    for (size_t i = 0; i < kept_count; ++i) {
+        DuskIRValue *block = blocks[i];
+        DuskArray(DuskIRValue *) insts_arr = block->block.insts_arr;
+        for (size_t j = 0; j < duskArrayLength(insts_arr); ++j) {
+            DuskIRValue *phi = insts_arr[j];
+            if (phi->kind != DUSK_IR_VALUE_PHI) continue;
+
+            size_t pair_count = 0;
+            for (size_t k = 0; k < phi->phi.pair_count; ++k) {
+                DuskIRPhiPair pair = phi->phi.pairs[k];
+                uint32_t parent_index = pair.block->id;
+                if (!kept[parent_index] || !duskBranchesTo(pair.block, block)) {
+                    continue;
+                }
+
+                DuskIRValue *value = pair.value;
+                if (duskIsInstruction(value) && value->id < inst_count &&
+                    insts[value->id] == value &&
+                    !reachable[inst_blocks[value->id]]) {
+                    pair.value = duskIRZeroValue(module, phi->type);
+                }
+                phi->phi.pairs[pair_count++] = pair;
+            }
+            phi->phi.pair_count = pair_count;
+        }
+    }
+
+    return true;
+}
+
+void duskIRRemoveDeadCode(DuskIRModule *module, DuskIRValue *function)
+{
+    DUSK_ASSERT(function->kind == DUSK_IR_VALUE_FUNCTION);
+
+    DuskAllocator *allocator = module->allocator;
+    bool removed_blocks = duskRemoveUnreachableBlocks(module, function);
+
+    DuskIRValue **blocks = function->function.blocks_arr;
+    size_t block_count = duskArrayLength(function->function.blocks_arr);
+
+    DuskDeadCodeState state_storage = {0};
+    DuskDeadCodeState *state = &state_storage;
+    state->live_arr = duskArrayCreate(allocator, DuskIRValue *);
+
+    state->vars = function->function.variables_arr;
+    state->var_count = duskArrayLength(function->function.variables_arr);
+    state->live_vars = DUSK_NEW_ARRAY(allocator, bool, state->var_count);
+    for (size_t i = 0; i < state->var_count; ++i) {
+        state->vars[i]->id = (uint32_t)i;
+    }
+
+    for (size_t i = 0; i < block_count; ++i) {
+        state->inst_count += duskArrayLength(blocks[i]->block.insts_arr);
+    }
+    state->insts = DUSK_NEW_ARRAY(allocator, DuskIRValue *, state->inst_count);
+    state->live_insts = DUSK_NEW_ARRAY(allocator, bool, state->inst_count);
+
+    size_t inst_index = 0;
+    for (size_t i = 0; i < block_count; ++i) {
+        DuskArray(DuskIRValue *) insts_arr = blocks[i]->block.insts_arr;
+        for (size_t j = 0; j < duskArrayLength(insts_arr); ++j) {
+            DuskIRValue *inst = insts_arr[j];
+            inst->id = (uint32_t)inst_index;
+            state->insts[inst_index] = inst;
+
+            if (duskHasSideEffects(inst)) {
+                state->live_insts[inst_index] = true;
+                duskArrayPush(&state->live_arr, inst);
+            }
+            inst_index++;
+        }
+    }
+
+    while (duskArrayLength(state->live_arr) > 0) {
+        DuskIRValue *inst =
+            state->live_arr[duskArrayLength(state->live_arr) - 1];
+        duskArrayPop(&state->live_arr);
+        duskIRForEachOperand(inst, state, duskMarkLiveOperand);
+    }
+
+    size_t live_inst_count = 0;
+    for (size_t i = 0; i < state->inst_count; ++i) {
+        if (state->live_insts[i]) live_inst_count++;
+    }
+    size_t live_var_count = 0;
+    for (size_t i = 0; i < state->var_count; ++i) {
+        if (state->live_vars[i]) live_var_count++;
+    }
+    if (!removed_blocks && live_inst_count == state->inst_count &&
+        live_var_count == state->var_count) {
+        return;
+    }
+
+    for (size_t i = 0; i < block_count; ++i) {
+        DuskIRValue *block = blocks[i];
+        DuskArray(DuskIRValue *) insts_arr =
+            duskArrayCreate(allocator, DuskIRValue *);
+
+        for (size_t j = 0; j < duskArrayLength(block->block.insts_arr); ++j) {
+            DuskIRValue *inst = block->block.insts_arr[j];
+            if (state->live_insts[inst->id]) duskArrayPush(&insts_arr, inst);
+        }
+
+        block->block.insts_arr = insts_arr;
+    }
+
+    size_t var_count = 0;
+    for (size_t i = 0; i < state->var_count; ++i) {
+        if (state->live_vars[i]) state->vars[var_count++] = state->vars[i];
+    }
+    duskArrayResize(&function->function.variables_arr, var_count);
+}
+
+static void duskMarkLiveConst(DuskIRValue *value)
+{
+    if (value->id != 0) return;
+    value->id = 1;
+
+    if (value->kind == DUSK_IR_VALUE_CONSTANT_COMPOSITE) {
+        DuskArray(DuskIRValue *) values_arr =
+            value->constant_composite.values_arr;
+        for (size_t i = 0; i < duskArrayLength(values_arr); ++i) {
+            duskMarkLiveConst(values_arr[i]);
+        }
+    }
+}
+
+static void duskMarkLiveModuleOperand(
+    void *user_data, DuskIRValue *inst, DuskIRValue **operand)
+{
+    (void)user_data;
+    (void)inst;
+
+    DuskIRValue *value = *operand;
+    switch (value->kind) {
+    case DUSK_IR_VALUE_CONSTANT_BOOL:
+    case DUSK_IR_VALUE_CONSTANT:
+    case DUSK_IR_VALUE_CONSTANT_COMPOSITE: {
+        duskMarkLiveConst(value);
+        break;
+    }
+    case DUSK_IR_VALUE_VARIABLE: {
+        if (!duskIsLocalVariable(value)) value->id = 1;
+        break;
+    }
+    default: break;
+    }
+}
+
+static void duskMarkLiveFunction(
+    DuskArray(DuskIRValue *) * functions_arr, DuskIRValue *function)
+{
+    if (function->id != 0) return;
+    function->id = 1;
+    duskArrayPush(functions_arr, function);
+}
+
+void duskIRModuleRemoveDeadCode(DuskIRModule *module)
+{
+    DuskCompiler *compiler = module->compiler;
+    DuskAllocator *allocator = module->allocator;
+
+    // A module without entry points is only checked, and would be left empty
+    size_t entry_point_count = duskArrayLength(module->entry_points_arr);
+    if (entry_point_count == 0) return;
+
+    // Ids are only assigned when the module is emitted, so borrow them to mark
+    // the values that are used
+    for (size_t i = 0; i < duskArrayLength(module->functions_arr); ++i) {
+        module->functions_arr[i]->id = 0;
+    }
+    for (size_t i = 0; i < duskArrayLength(module->globals_arr); ++i) {
+        module->globals_arr[i]->id = 0;
+    }
+    for (size_t i = 0; i < duskArrayLength(module->consts_arr); ++i) {
+        module->consts_arr[i]->id = 0;
+    }
+
+    DuskArray(DuskIRValue *) pending_arr =
+        duskArrayCreate(allocator, DuskIRValue *);
+    for (size_t i = 0; i < entry_point_count; ++i) {
+        DuskIREntryPoint *entry_point = module->entry_points_arr[i];
+        duskMarkLiveFunction(&pending_arr, entry_point->function);
+        for (size_t j = 0;
+             j < duskArrayLength(entry_point->referenced_globals_arr);
+             ++j) {
+            entry_point->referenced_globals_arr[j]->id = 1;
+        }
+    }
+
+    while (duskArrayLength(pending_arr) > 0) {
+        DuskIRValue *function = pending_arr[duskArrayLength(pending_arr) - 1];
+        duskArrayPop(&pending_arr);
+
+        DuskArray(DuskIRValue *) blocks_arr = function->function.blocks_arr;
+        for (size_t i = 0; i < duskArrayLength(blocks_arr); ++i) {
+            DuskArray(DuskIRValue *) insts_arr = blocks_arr[i]->block.insts_arr;
+            for (size_t j = 0; j < duskArrayLength(insts_arr); ++j) {
+                DuskIRValue *inst = insts_arr[j];
+                if (inst->kind == DUSK_IR_VALUE_FUNCTION_CALL) {
+                    duskMarkLiveFunction(
+                        &pending_arr, inst->function_call.function);
+                }
+                duskIRForEachOperand(inst, NULL, duskMarkLiveModuleOperand);
+            }
+        }
+    }
+
+    DuskArray(DuskIRValue *) *value_arrs[2] = {
+        &module->functions_arr,
+        &module->globals_arr,
+    };
+    for (size_t i = 0; i < DUSK_CARRAY_LENGTH(value_arrs); ++i) {
+        DuskArray(DuskIRValue *) values_arr = *value_arrs[i];
+        size_t live_count = 0;
+        for (size_t j = 0; j < duskArrayLength(values_arr); ++j) {
+            if (values_arr[j]->id == 0) continue;
+            values_arr[j]->id = 0;
+            values_arr[live_count++] = values_arr[j];
+        }
+        duskArrayResize(value_arrs[i], live_count);
+    }
+
+    DuskArray(DuskIRValue *) consts_arr =
+        duskArrayCreate(allocator, DuskIRValue *);
+    for (size_t i = 0; i < duskArrayLength(module->consts_arr); ++i) {
+        DuskIRValue *value = module->consts_arr[i];
+        if (value->id == 0) continue;
+        value->id = 0;
+        duskArrayPush(&consts_arr, value);
+    }
+    duskIRModuleKeepConsts(module, duskArrayLength(consts_arr), consts_arr);
+
+    // The types are marked again, from the values that are left
+    compiler->type_mark_epoch++;
+    duskArrayResize(&compiler->referenced_types_arr, 0);
+
+    for (size_t i = 0; i < duskArrayLength(module->consts_arr); ++i) {
+        duskTypeMarkNotDead(compiler, module->consts_arr[i]->type);
+    }
+    for (size_t i = 0; i < duskArrayLength(module->globals_arr); ++i) {
+        duskTypeMarkNotDead(compiler, module->globals_arr[i]->type);
+    }
+    for (size_t i = 0; i < duskArrayLength(module->functions_arr); ++i) {
+        DuskIRValue *function = module->functions_arr[i];
+        duskTypeMarkNotDead(compiler, function->type);
+
+        DuskArray(DuskIRValue *) values_arrs[2] = {
+            function->function.params_arr,
+            function->function.variables_arr,
+        };
+        for (size_t j = 0; j < DUSK_CARRAY_LENGTH(values_arrs); ++j) {
+            for (size_t k = 0; k < duskArrayLength(values_arrs[j]); ++k) {
+                duskTypeMarkNotDead(compiler, values_arrs[j][k]->type);
+            }
+        }
+
+        DuskArray(DuskIRValue *) blocks_arr = function->function.blocks_arr;
+        for (size_t j = 0; j < duskArrayLength(blocks_arr); ++j) {
+            DuskArray(DuskIRValue *) insts_arr = blocks_arr[j]->block.insts_arr;
+            for (size_t k = 0; k < duskArrayLength(insts_arr); ++k) {
+                duskTypeMarkNotDead(compiler, insts_arr[k]->type);
+            }
+        }
+    }
+}
+// }}}
+
+// Common subexpression elimination {{{
+
+// Instructions without side effects are given a hash of their kind, type and
+// operands, and are replaced by an equal instruction from a block that
+// dominates them if there is one. The dominator tree is walked with a scoped
+// hash table, so only the instructions of the blocks on the way to a block
+// can be found from it.
+//
+// Loads are only equal if nothing could have written to memory between them.
+// Memory that the function can't write to can be loaded once for every block
+// it dominates, while other loads are only shared within a block, up to the
+// next instruction with side effects.
+//
+// While the pass runs, the id of the blocks and instructions of the function
+// is their index in the arrays below.
+
+typedef struct DuskValueEntry {
+    DuskIRValue *inst;
+    uint64_t hash;
+    // Number of the stretch of instructions without side effects a load is
+    // from, or 0 if it loads memory nothing writes to
+    uint64_t epoch;
+    uint32_t next;
+} DuskValueEntry;
+
+typedef struct DuskNumberingStep {
+    uint32_t block_index;
+    bool leaving;
+    size_t entry_count;
+} DuskNumberingStep;
+
+typedef struct DuskNumberingState {
+    DuskIRValue **insts;
+    DuskIRValue **replacements;
+    size_t inst_count;
+
+    // Heads of the chains of entries with the same masked hash
+    uint32_t *buckets;
+    uint64_t bucket_mask;
+    DuskArray(DuskValueEntry) entries_arr;
+    uint64_t epoch;
+} DuskNumberingState;
+
+static bool duskIsPureBuiltin(DuskBuiltinFunctionKind builtin_kind)
+{
+    switch (builtin_kind) {
+    case DUSK_BUILTIN_FUNCTION_SIN:
+    case DUSK_BUILTIN_FUNCTION_COS:
+    case DUSK_BUILTIN_FUNCTION_TAN:
+    case DUSK_BUILTIN_FUNCTION_ASIN:
+    case DUSK_BUILTIN_FUNCTION_ACOS:
+    case DUSK_BUILTIN_FUNCTION_ATAN:
+    case DUSK_BUILTIN_FUNCTION_SINH:
+    case DUSK_BUILTIN_FUNCTION_COSH:
+    case DUSK_BUILTIN_FUNCTION_TANH:
+    case DUSK_BUILTIN_FUNCTION_ASINH:
+    case DUSK_BUILTIN_FUNCTION_ACOSH:
+    case DUSK_BUILTIN_FUNCTION_ATANH:
+    case DUSK_BUILTIN_FUNCTION_RADIANS:
+    case DUSK_BUILTIN_FUNCTION_DEGREES:
+    case DUSK_BUILTIN_FUNCTION_ROUND:
+    case DUSK_BUILTIN_FUNCTION_TRUNC:
+    case DUSK_BUILTIN_FUNCTION_FLOOR:
+    case DUSK_BUILTIN_FUNCTION_CEIL:
+    case DUSK_BUILTIN_FUNCTION_FRACT:
+    case DUSK_BUILTIN_FUNCTION_SQRT:
+    case DUSK_BUILTIN_FUNCTION_INVERSE_SQRT:
+    case DUSK_BUILTIN_FUNCTION_LOG:
+    case DUSK_BUILTIN_FUNCTION_LOG2:
+    case DUSK_BUILTIN_FUNCTION_EXP:
+    case DUSK_BUILTIN_FUNCTION_EXP2:
+    case DUSK_BUILTIN_FUNCTION_ABS:
+    case DUSK_BUILTIN_FUNCTION_DISTANCE:
+    case DUSK_BUILTIN_FUNCTION_NORMALIZE:
+    case DUSK_BUILTIN_FUNCTION_DOT:
+    case DUSK_BUILTIN_FUNCTION_LENGTH:
+    case DUSK_BUILTIN_FUNCTION_CROSS:
+    case DUSK_BUILTIN_FUNCTION_REFLECT:
+    case DUSK_BUILTIN_FUNCTION_REFRACT:
+    case DUSK_BUILTIN_FUNCTION_MIN:
+    case DUSK_BUILTIN_FUNCTION_MAX:
+    case DUSK_BUILTIN_FUNCTION_MIX:
+    case DUSK_BUILTIN_FUNCTION_CLAMP:
+    case DUSK_BUILTIN_FUNCTION_DETERMINANT:
+    case DUSK_BUILTIN_FUNCTION_INVERSE:
+    // Sampled images can't be written to, and an explicit level of detail
+    // doesn't depend on the neighbouring invocations like implicit ones do
+    case DUSK_BUILTIN_FUNCTION_IMAGE:
+    case DUSK_BUILTIN_FUNCTION_IMAGE_SAMPLE_LOD:
+    case DUSK_BUILTIN_FUNCTION_IMAGE_QUERY_LEVELS:
+    case DUSK_BUILTIN_FUNCTION_IMAGE_QUERY_SIZE: return true;
+    default: return false;
+    }
+}
+
+static bool duskIsNumbered(DuskIRValue *inst)
+{
+    switch (inst->kind) {
+    case DUSK_IR_VALUE_LOAD:
+    case DUSK_IR_VALUE_ACCESS_CHAIN:
+    case DUSK_IR_VALUE_COMPOSITE_EXTRACT:
+    case DUSK_IR_VALUE_COMPOSITE_INSERT:
+    case DUSK_IR_VALUE_VECTOR_SHUFFLE:
+    case DUSK_IR_VALUE_COMPOSITE_CONSTRUCT:
+    case DUSK_IR_VALUE_CAST:
+    case DUSK_IR_VALUE_BINARY_OPERATION:
+    case DUSK_IR_VALUE_UNARY_OPERATION:
+    case DUSK_IR_VALUE_ARRAY_LENGTH: return true;
+    case DUSK_IR_VALUE_BUILTIN_CALL: {
+        return duskIsPureBuiltin(inst->builtin_call.builtin_kind);
+    }
+    default: return false;
+    }
+}
+
+// Whether nothing can write to the memory a pointer points to while the
+// shader runs
+static bool duskIsReadOnlyPointer(DuskIRValue *pointer)
+{
+    while (pointer->kind == DUSK_IR_VALUE_ACCESS_CHAIN) {
+        pointer = pointer->access_chain.base;
+    }
+    if (pointer->kind != DUSK_IR_VALUE_VARIABLE) return false;
+
+    switch (pointer->var.storage_class) {
+    case DUSK_STORAGE_CLASS_UNIFORM:
+    case DUSK_STORAGE_CLASS_UNIFORM_CONSTANT:
+    case DUSK_STORAGE_CLASS_PUSH_CONSTANT:
+    case DUSK_STORAGE_CLASS_INPUT: return true;
+    case DUSK_STORAGE_CLASS_STORAGE: {
+        for (size_t i = 0; i < duskArrayLength(pointer->decorations_arr); ++i) {
+            if (pointer->decorations_arr[i].kind ==
+                DUSK_IR_DECORATION_NON_WRITABLE) {
+                return true;
+            }
+        }
+        return false;
+    }
+    default: return false;
+    }
+}
+
+static bool duskIsCommutative(DuskIRValue *inst)
+{
+    if (inst->binary.left->type != inst->binary.right->type ||
+        inst->binary.left->type->kind == DUSK_TYPE_MATRIX) {
+        return false;
+    }
+
+    switch (inst->binary.op) {
+    case DUSK_BINARY_OP_ADD:
+    case DUSK_BINARY_OP_MUL:
+    case DUSK_BINARY_OP_BITAND:
+    case DUSK_BINARY_OP_BITOR:
+    case DUSK_BINARY_OP_BITXOR:
+    case DUSK_BINARY_OP_EQ:
+    case DUSK_BINARY_OP_NOTEQ:
+    case DUSK_BINARY_OP_AND:
+    case DUSK_BINARY_OP_OR: return true;
+    default: return false;
+    }
+}
+
+static uint64_t duskHashCombine(uint64_t hash, uint64_t value)
+{
+    return (hash ^ value) * 1099511628211ULL;
+}
+
+static uint64_t duskHashPointer(const void *pointer)
+{
+    return (uint64_t)(uintptr_t)pointer;
+}
+
+static uint64_t duskHashValues(
+    uint64_t hash, size_t value_count, DuskIRValue **values)
+{
+    for (size_t i = 0; i < value_count; ++i) {
+        hash = duskHashCombine(hash, duskHashPointer(values[i]));
+    }
+    return hash;
+}
+
+static uint64_t
+duskHashIndices(uint64_t hash, DuskArray(uint32_t) indices_arr)
+{
+    for (size_t i = 0; i < duskArrayLength(indices_arr); ++i) {
+        hash = duskHashCombine(hash, indices_arr[i]);
+    }
+    return hash;
+}
+
+static uint64_t duskHashInst(DuskIRValue *inst)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    hash = duskHashCombine(hash, (uint64_t)inst->kind);
+    hash = duskHashCombine(hash, duskHashPointer(inst->type));
+
+    switch (inst->kind) {
+    case DUSK_IR_VALUE_LOAD: {
+        hash = duskHashCombine(hash, duskHashPointer(inst->load.pointer));
+        break;
+    }
+    case DUSK_IR_VALUE_ACCESS_CHAIN: {
+        hash = duskHashCombine(hash, duskHashPointer(inst->access_chain.base));
+        hash = duskHashValues(
+            hash,
+            duskArrayLength(inst->access_chain.indices_arr),
+            inst->access_chain.indices_arr);
+        break;
+    }
+    case DUSK_IR_VALUE_COMPOSITE_EXTRACT: {
+        hash = duskHashCombine(
+            hash, duskHashPointer(inst->composite_extract.composite));
+        hash = duskHashIndices(hash, inst->composite_extract.indices_arr);
+        break;
+    }
+    case DUSK_IR_VALUE_COMPOSITE_INSERT: {
+        hash = duskHashCombine(
+            hash, duskHashPointer(inst->composite_insert.composite));
+        hash = duskHashCombine(
+            hash, duskHashPointer(inst->composite_insert.object));
+        hash = duskHashIndices(hash, inst->composite_insert.indices_arr);
+        break;
+    }
+    case DUSK_IR_VALUE_VECTOR_SHUFFLE: {
+        hash = duskHashCombine(
+            hash, duskHashPointer(inst->vector_shuffle.vec1));
+        hash = duskHashCombine(
+            hash, duskHashPointer(inst->vector_shuffle.vec2));
+        hash = duskHashIndices(hash, inst->vector_shuffle.indices_arr);
+        break;
+    }
+    case DUSK_IR_VALUE_COMPOSITE_CONSTRUCT: {
+        hash = duskHashValues(
+            hash,
+            duskArrayLength(inst->composite_construct.values_arr),
+            inst->composite_construct.values_arr);
+        break;
+    }
+    case DUSK_IR_VALUE_CAST: {
+        hash = duskHashCombine(hash, duskHashPointer(inst->cast.value));
+        break;
+    }
+    case DUSK_IR_VALUE_BUILTIN_CALL: {
+        hash = duskHashCombine(hash, (uint64_t)inst->builtin_call.builtin_kind);
+        hash = duskHashValues(
+            hash, inst->builtin_call.param_count, inst->builtin_call.params);
+        break;
+    }
+    case DUSK_IR_VALUE_BINARY_OPERATION: {
+        hash = duskHashCombine(hash, (uint64_t)inst->binary.op);
+        uint64_t left = duskHashPointer(inst->binary.left);
+        uint64_t right = duskHashPointer(inst->binary.right);
+        if (duskIsCommutative(inst)) {
+            // Either order of the operands hashes the same
+            hash = duskHashCombine(hash, left ^ right);
+            hash = duskHashCombine(hash, left + right);
+        } else {
+            hash = duskHashCombine(hash, left);
+            hash = duskHashCombine(hash, right);
+        }
+        break;
+    }
+    case DUSK_IR_VALUE_UNARY_OPERATION: {
+        hash = duskHashCombine(hash, (uint64_t)inst->unary.op);
+        hash = duskHashCombine(hash, duskHashPointer(inst->unary.right));
+        break;
+    }
+    case DUSK_IR_VALUE_ARRAY_LENGTH: {
+        hash = duskHashCombine(
+            hash, duskHashPointer(inst->array_length.struct_ptr));
+        hash = duskHashCombine(hash, inst->array_length.struct_member_index);
+        break;
+    }
+    default: DUSK_ASSERT(0); break;
+    }
+
+    return hash;
+}
+
+static bool duskValuesEqual(
+    size_t value_count, DuskIRValue **values1, DuskIRValue **values2)
+{
+    for (size_t i = 0; i < value_count; ++i) {
+        if (values1[i] != values2[i]) return false;
+    }
+    return true;
+}
+
+static bool
+duskIndicesEqual(DuskArray(uint32_t) indices1, DuskArray(uint32_t) indices2)
+{
+    size_t index_count = duskArrayLength(indices1);
+    if (duskArrayLength(indices2) != index_count) return false;
+    return memcmp(indices1, indices2, sizeof(uint32_t) * index_count) == 0;
+}
+
+static bool duskInstsEqual(DuskIRValue *a, DuskIRValue *b)
+{
+    if (a->kind != b->kind || a->type != b->type) return false;
+
+    switch (a->kind) {
+    case DUSK_IR_VALUE_LOAD: return a->load.pointer == b->load.pointer;
+    case DUSK_IR_VALUE_ACCESS_CHAIN: {
+        size_t index_count = duskArrayLength(a->access_chain.indices_arr);
+        return a->access_chain.base == b->access_chain.base &&
+               duskArrayLength(b->access_chain.indices_arr) == index_count &&
+               duskValuesEqual(
+                   index_count,
+                   a->access_chain.indices_arr,
+                   b->access_chain.indices_arr);
+    }
+    case DUSK_IR_VALUE_COMPOSITE_EXTRACT: {
+        return a->composite_extract.composite ==
+                   b->composite_extract.composite &&
+               duskIndicesEqual(
+                   a->composite_extract.indices_arr,
+                   b->composite_extract.indices_arr);
+    }
+    case DUSK_IR_VALUE_COMPOSITE_INSERT: {
+        return a->composite_insert.composite ==
+                   b->composite_insert.composite &&
+               a->composite_insert.object == b->composite_insert.object &&
+               duskIndicesEqual(
+                   a->composite_insert.indices_arr,
+                   b->composite_insert.indices_arr);
+    }
+    case DUSK_IR_VALUE_VECTOR_SHUFFLE: {
+        return a->vector_shuffle.vec1 == b->vector_shuffle.vec1 &&
+               a->vector_shuffle.vec2 == b->vector_shuffle.vec2 &&
+               duskIndicesEqual(
+                   a->vector_shuffle.indices_arr,
+                   b->vector_shuffle.indices_arr);
+    }
+    case DUSK_IR_VALUE_COMPOSITE_CONSTRUCT: {
+        size_t value_count =
+            duskArrayLength(a->composite_construct.values_arr);
+        return duskArrayLength(b->composite_construct.values_arr) ==
+                   value_count &&
+               duskValuesEqual(
+                   value_count,
+                   a->composite_construct.values_arr,
+                   b->composite_construct.values_arr);
+    }
+    case DUSK_IR_VALUE_CAST: return a->cast.value == b->cast.value;
+    case DUSK_IR_VALUE_BUILTIN_CALL: {
+        return a->builtin_call.builtin_kind == b->builtin_call.builtin_kind &&
+               a->builtin_call.param_count == b->builtin_call.param_count &&
+               duskValuesEqual(
+                   a->builtin_call.param_count,
+                   a->builtin_call.params,
+                   b->builtin_call.params);
+    }
+    case DUSK_IR_VALUE_BINARY_OPERATION: {
+        if (a->binary.op != b->binary.op) return false;
+        if (a->binary.left == b->binary.left &&
+            a->binary.right == b->binary.right) {
+            return true;
+        }
+        return duskIsCommutative(a) && a->binary.left == b->binary.right &&
+               a->binary.right == b->binary.left;
+    }
+    case DUSK_IR_VALUE_UNARY_OPERATION: {
+        return a->unary.op == b->unary.op && a->unary.right == b->unary.right;
+    }
+    case DUSK_IR_VALUE_ARRAY_LENGTH: {
+        return a->array_length.struct_ptr == b->array_length.struct_ptr &&
+               a->array_length.struct_member_index ==
+                   b->array_length.struct_member_index;
+    }
+    default: return false;
+    }
+}
+
+static void duskNumberingReplaceOperand(
+    void *user_data, DuskIRValue *inst, DuskIRValue **operand)
+{
+    DuskNumberingState *state = (DuskNumberingState *)user_data;
+    (void)inst;
+
+    DuskIRValue *value = *operand;
+    if (!duskIsInstruction(value) || value->id >= state->inst_count ||
+        state->insts[value->id] != value) {
+        return;
+    }
+
+    if (state->replacements[value->id]) {
+        *operand = state->replacements[value->id];
+    }
+}
+
+static void duskNumberBlock(DuskNumberingState *state, DuskIRValue *block)
+{
+    // Loads of writable memory are never shared between blocks
+    state->epoch++;
+
+    DuskArray(DuskIRValue *) insts_arr = block->block.insts_arr;
+    for (size_t i = 0; i < duskArrayLength(insts_arr); ++i) {
+        DuskIRValue *inst = insts_arr[i];
+        duskIRForEachOperand(inst, state, duskNumberingReplaceOperand);
+
+        if (!duskIsNumbered(inst)) {
+            if (duskHasSideEffects(inst)) state->epoch++;
+            continue;
+        }
+
+        uint64_t epoch = 0;
+        if (inst->kind == DUSK_IR_VALUE_LOAD &&
+            !duskIsReadOnlyPointer(inst->load.pointer)) {
+            epoch = state->epoch;
+        }
+
+        uint64_t hash = duskHashInst(inst);
+        uint32_t *bucket = &state->buckets[hash & state->bucket_mask];
+        DuskIRValue *existing = NULL;
+        for (uint32_t entry_index = *bucket; entry_index != UINT32_MAX;
+             entry_index = state->entries_arr[entry_index].next) {
+            DuskValueEntry *entry = &state->entries_arr[entry_index];
+            if (entry->hash == hash && entry->epoch == epoch &&
+                duskInstsEqual(entry->inst, inst)) {
+                existing = entry->inst;
+                break;
+            }
+        }
+
+        if (existing) {
+            state->replacements[inst->id] = existing;
+            continue;
+        }
+
+        DuskValueEntry entry = {
+            .inst = inst,
+            .hash = hash,
+            .epoch = epoch,
+            .next = *bucket,
+        };
+        *bucket = (uint32_t)duskArrayLength(state->entries_arr);
+        duskArrayPush(&state->entries_arr, entry);
+    }
+}
+
+void duskIREliminateCommonSubexpressions(
+    DuskIRModule *module, DuskIRValue *function)
+{
+    DUSK_ASSERT(function->kind == DUSK_IR_VALUE_FUNCTION);
+
+    DuskAllocator *allocator = module->allocator;
+    DuskIRValue **blocks = function->function.blocks_arr;
+    size_t block_count = duskArrayLength(function->function.blocks_arr);
+    if (block_count == 0) return;
+
+    DuskNumberingState state_storage = {0};
+    DuskNumberingState *state = &state_storage;
+
+    for (size_t i = 0; i < block_count; ++i) {
+        blocks[i]->id = (uint32_t)i;
+        state->inst_count += duskArrayLength(blocks[i]->block.insts_arr);
+    }
+
+    state->insts = DUSK_NEW_ARRAY(allocator, DuskIRValue *, state->inst_count);
+    state->replacements =
+        DUSK_NEW_ARRAY(allocator, DuskIRValue *, state->inst_count);
+
+    size_t inst_index = 0;
+    for (size_t i = 0; i < block_count; ++i) {
+        DuskArray(DuskIRValue *) insts_arr = blocks[i]->block.insts_arr;
+        for (size_t j = 0; j < duskArrayLength(insts_arr); ++j) {
+            DuskIRValue *inst = insts_arr[j];
+            inst->id = (uint32_t)inst_index;
+            state->insts[inst_index++] = inst;
+        }
+    }
+
+    size_t bucket_count = 16;
+    while (bucket_count < state->inst_count * 2) {
+        bucket_count *= 2;
+    }
+    state->bucket_mask = bucket_count - 1;
+    state->buckets = DUSK_NEW_ARRAY(allocator, uint32_t, bucket_count);
+    memset(state->buckets, 0xff, sizeof(uint32_t) * bucket_count);
+    state->entries_arr = duskArrayCreate(allocator, DuskValueEntry);
+
+    DuskDominators doms = {0};
+    duskComputeDominators(allocator, function, &doms);
+
+    // Entries added by a block are removed once its subtree is left, so the
+    // ones left are those of the blocks that dominate the current one
+    DuskArray(DuskNumberingStep) steps_arr =
+        duskArrayCreate(allocator, DuskNumberingStep);
+    DuskNumberingStep first_step = {.block_index = 0};
+    duskArrayPush(&steps_arr, first_step);
+
+    bool any_replaced = false;
+    while (duskArrayLength(steps_arr) > 0) {
+        DuskNumberingStep step = steps_arr[duskArrayLength(steps_arr) - 1];
+        duskArrayPop(&steps_arr);
+
+        if (step.leaving) {
+            while (duskArrayLength(state->entries_arr) > step.entry_count) {
+                DuskValueEntry entry =
+                    state->entries_arr[duskArrayLength(state->entries_arr) - 1];
+                duskArrayPop(&state->entries_arr);
+                state->buckets[entry.hash & state->bucket_mask] = entry.next;
+            }
+            continue;
+        }
+
+        DuskNumberingStep leave_step = {
+            .block_index = step.block_index,
+            .leaving = true,
+            .entry_count = duskArrayLength(state->entries_arr),
+        };
+        duskNumberBlock(state, blocks[step.block_index]);
+        duskArrayPush(&steps_arr, leave_step);
+
+        DuskArray(uint32_t) children_arr = doms.children[step.block_index];
+        for (size_t i = duskArrayLength(children_arr); i > 0; --i) {
+            DuskNumberingStep child_step = {.block_index = children_arr[i - 1]};
+            duskArrayPush(&steps_arr, child_step);
+        }
+    }
+
+    for (size_t i = 0; i < state->inst_count; ++i) {
+        any_replaced = any_replaced || state->replacements[i];
+    }
+    if (!any_replaced) return;
+
+    // Phis and the blocks that aren't reached can use values that were
+    // replaced after them
+    for (size_t i = 0; i < block_count; ++i) {
+        DuskIRValue *block = blocks[i];
+        DuskArray(DuskIRValue *) insts_arr =
+            duskArrayCreate(allocator, DuskIRValue *);
+
+        for (size_t j = 0; j < duskArrayLength(block->block.insts_arr); ++j) {
+            DuskIRValue *inst = block->block.insts_arr[j];
+            if (state->replacements[inst->id]) continue;
+
+            duskIRForEachOperand(inst, state, duskNumberingReplaceOperand);
+            duskArrayPush(&insts_arr, inst);
+        }
+
+        block->block.insts_arr = insts_arr;
+    }
+}
+// }}}
+
+// Inlining {{{
+
+// Calls are replaced by a copy of the body of the called function if the
+// function asks for it with the 'inline' attribute, if it is only called once,
+// or if it has few enough instructions. The block of the call is cut at the
+// call and takes the place of the entry of the copy, and the instructions
+// after the call take the place of the return of the copy.
+//
+// Structured control flow can only leave a selection or a loop through its
+// merge block, so only functions whose single return is outside of all of
+// them are inlined. Functions are visited after the functions they call, so
+// the calls they make are inlined before they are inlined themselves.
+//
+// The body of a function that is only called once is moved into its caller
+// instead of being copied. The functions it calls once are only moved into it
+// along with it, once it ends up in a function that isn't inlined, so long
+// chains of calls take linear time.
+// Copies of small functions stop once they have added as many instructions to
+// the module as it had before, which bounds how much it can grow.
+//
+// While the pass runs, the id of the functions is their index in the module,
+// and the id of the parameters, variables, blocks and instructions of the
+// function being inlined is their index in the arrays below.
+
+// Largest number of instructions in the body of functions that are inlined
+// without being asked to
+#define DUSK_INLINE_MAX_COST 32
+// Number of instructions copies of small functions can add to any module, on
+// top of the number of instructions it has
+#define DUSK_INLINE_MIN_GROWTH 1024
+
+typedef enum DuskInlineVisit {
+    DUSK_INLINE_UNVISITED,
+    DUSK_INLINE_VISITING,
+    DUSK_INLINE_VISITED,
+} DuskInlineVisit;
+
+typedef struct DuskInlineFunction {
+    DuskInlineVisit visit;
+    DuskIREntryPoint *entry_point;
+    size_t call_count;
+    // Number of instructions in the body, not counting control flow
+    size_t cost;
+    // Block with the only return of the function, NULL if it can't be inlined
+    DuskIRValue *return_block;
+    // Set if the function is going to be moved into its only caller, which
+    // then inlines the functions it calls once
+    bool is_pending;
+} DuskInlineFunction;
+
+typedef struct DuskInlineState {
+    DuskIRModule *module;
+    DuskInlineFunction *functions;
+    size_t function_count;
+    // Number of instructions copies of functions can still add to the module
+    size_t growth_budget;
+
+    // The function being inlined, and its values and their copies by id. The
+    // copies of the values of a function that is moved are the values
+    // themselves, except for its entry block.
+    DuskIRValue *callee;
+    DuskIRValue **args;
+    DuskIRValue **blocks;
+    DuskArray(DuskIRValue *) copied_vars;
+    DuskArray(DuskIRValue *) copied_blocks;
+    DuskArray(DuskIRValue *) insts;
+    DuskArray(DuskIRValue *) copied_insts;
+    size_t inst_count;
+
+    // Blocks of the caller left to visit, the next one last
+    DuskArray(DuskIRValue *) stack_arr;
+    // Instructions after the call being inlined
+    DuskArray(DuskIRValue *) rest_arr;
+
+    // Calls of the caller that were inlined, and the values they returned
+    DuskArray(DuskIRValue *) calls_arr;
+    DuskArray(DuskIRValue *) returned_values_arr;
+} DuskInlineState;
+
+static DuskInlineFunction *
+duskGetInlineFunction(DuskInlineState *state, DuskIRValue *function)
+{
+    if (function->id >= state->function_count ||
+        state->module->functions_arr[function->id] != function) {
+        return NULL;
+    }
+    return &state->functions[function->id];
+}
+
+static bool duskIsControlFlow(DuskIRValue *inst)
+{
+    switch (inst->kind) {
+    case DUSK_IR_VALUE_RETURN:
+    case DUSK_IR_VALUE_DISCARD:
+    case DUSK_IR_VALUE_UNREACHABLE:
+    case DUSK_IR_VALUE_BRANCH:
+    case DUSK_IR_VALUE_BRANCH_COND:
+    case DUSK_IR_VALUE_SELECTION_MERGE:
+    case DUSK_IR_VALUE_LOOP_MERGE: return true;
+    default: return false;
+    }
+}
+
+// Finds the block with the return of a function that can be inlined, which
+// is reached by following the blocks outside of every selection and loop,
+// skipping over each one to its merge block
+static DuskIRValue *duskFindInlinableReturn(DuskIRValue *function)
+{
+    DuskIRValue **blocks = function->function.blocks_arr;
+    size_t block_count = duskArrayLength(function->function.blocks_arr);
+
+    DuskIRValue *return_block = NULL;
+    for (size_t i = 0; i < block_count; ++i) {
+        DuskArray(DuskIRValue *) insts_arr = blocks[i]->block.insts_arr;
+        for (size_t j = 0; j < duskArrayLength(insts_arr); ++j) {
+            if (insts_arr[j]->kind != DUSK_IR_VALUE_RETURN) continue;
+            if (return_block) return NULL;
+            return_block = blocks[i];
+        }
+    }
+    if (!return_block) return NULL;
+
+    DuskIRValue *block = blocks[0];
+    for (size_t i = 0; i < block_count; ++i) {
+        if (block == return_block) return return_block;
+
+        DuskArray(DuskIRValue *) insts_arr = block->block.insts_arr;
+        size_t inst_count = duskArrayLength(insts_arr);
+        if (inst_count == 0) return NULL;
+
+        DuskIRValue *terminator = insts_arr[inst_count - 1];
+        DuskIRValue *merge = inst_count > 1 ? insts_arr[inst_count - 2] : NULL;
+        if (merge && merge->kind == DUSK_IR_VALUE_SELECTION_MERGE) {
+            block = merge->selection_merge.merge_block;
+        } else if (merge && merge->kind == DUSK_IR_VALUE_LOOP_MERGE) {
+            block = merge->loop_merge.merge_block;
+        } else if (terminator->kind == DUSK_IR_VALUE_BRANCH) {
+            block = terminator->branch.dest_block;
+        } else {
+            return NULL;
+        }
+    }
+
+    return NULL;
+}
+
+static void duskMeasureInlineFunction(
+    DuskInlineFunction *info, DuskIRValue *function)
+{
+    info->cost = 0;
+    DuskArray(DuskIRValue *) blocks_arr = function->function.blocks_arr;
+    for (size_t i = 0; i < duskArrayLength(blocks_arr); ++i) {
+        DuskArray(DuskIRValue *) insts_arr = blocks_arr[i]->block.insts_arr;
+        for (size_t j = 0; j < duskArrayLength(insts_arr); ++j) {
+            if (!duskIsControlFlow(insts_arr[j])) info->cost++;
+        }
+    }
+
+    info->return_block = NULL;
+    if (!info->entry_point &&
+        function->function.inline_hint != DUSK_IR_INLINE_NEVER) {
+        info->return_block = duskFindInlinableReturn(function);
+    }
+}
+
+static bool duskShouldInline(
+    DuskInlineState *state, DuskIRValue *caller, DuskIRValue *call)
+{
+    DuskIRValue *callee = call->function_call.function;
+    DuskInlineFunction *info = duskGetInlineFunction(state, callee);
+    if (!info || callee == caller || info->visit != DUSK_INLINE_VISITED ||
+        !info->return_block) {
+        return false;
+    }
+
+    // Functions called once are moved along with the function that calls
+    // them, if it is moved itself
+    DuskInlineFunction *caller_info = duskGetInlineFunction(state, caller);
+    if (caller_info && caller_info->is_pending && info->call_count == 1) {
+        return false;
+    }
+
+    return callee->function.inline_hint == DUSK_IR_INLINE_ALWAYS ||
+           info->call_count == 1 ||
+           (info->cost <= DUSK_INLINE_MAX_COST &&
+            info->cost <= state->growth_budget);
+}
+
+static DuskArray(DuskIRValue *) duskCopyValues(
+    DuskAllocator *allocator, DuskArray(DuskIRValue *) values_arr)
+{
+    size_t value_count = duskArrayLength(values_arr);
+    DuskArray(DuskIRValue *) copy_arr =
+        duskArrayCreate(allocator, DuskIRValue *);
+    duskArrayResize(&copy_arr, value_count);
+    memcpy(copy_arr, values_arr, sizeof(DuskIRValue *) * value_count);
+    return copy_arr;
+}
+
+static DuskArray(uint32_t) duskCopyIndices(
+    DuskAllocator *allocator, DuskArray(uint32_t) indices_arr)
+{
+    size_t index_count = duskArrayLength(indices_arr);
+    DuskArray(uint32_t) copy_arr = duskArrayCreate(allocator, uint32_t);
+    duskArrayResize(&copy_arr, index_count);
+    memcpy(copy_arr, indices_arr, sizeof(uint32_t) * index_count);
+    return copy_arr;
+}
+
+// Copies an instruction along with the arrays it owns
+static DuskIRValue *
+duskCopyInst(DuskAllocator *allocator, DuskIRValue *inst)
+{
+    DuskIRValue *copy = DUSK_NEW(allocator, DuskIRValue);
+    *copy = *inst;
+
+    switch (inst->kind) {
+    case DUSK_IR_VALUE_FUNCTION_CALL: {
+        copy->function_call.params_arr =
+            duskCopyValues(allocator, inst->function_call.params_arr);
+        break;
+    }
+    case DUSK_IR_VALUE_ACCESS_CHAIN: {
+        copy->access_chain.indices_arr =
+            duskCopyValues(allocator, inst->access_chain.indices_arr);
+        break;
+    }
+    case DUSK_IR_VALUE_COMPOSITE_EXTRACT: {
+        copy->composite_extract.indices_arr = duskCopyIndices(
+            allocator, inst->composite_extract.indices_arr);
+        break;
+    }
+    case DUSK_IR_VALUE_COMPOSITE_INSERT: {
+        copy->composite_insert.indices_arr = duskCopyIndices(
+            allocator, inst->composite_insert.indices_arr);
+        break;
+    }
+    case DUSK_IR_VALUE_VECTOR_SHUFFLE: {
+        copy->vector_shuffle.indices_arr = duskCopyIndices(
+            allocator, inst->vector_shuffle.indices_arr);
+        break;
+    }
+    case DUSK_IR_VALUE_COMPOSITE_CONSTRUCT: {
+        copy->composite_construct.values_arr = duskCopyValues(
+            allocator, inst->composite_construct.values_arr);
+        break;
+    }
+    case DUSK_IR_VALUE_BUILTIN_CALL: {
+        copy->builtin_call.params = DUSK_NEW_ARRAY(
+            allocator, DuskIRValue *, inst->builtin_call.param_count);
+        memcpy(
+            copy->builtin_call.params,
+            inst->builtin_call.params,
+            sizeof(DuskIRValue *) * inst->builtin_call.param_count);
+        break;
+    }
+    case DUSK_IR_VALUE_PHI: {
+        copy->phi.pairs =
+            DUSK_NEW_ARRAY(allocator, DuskIRPhiPair, inst->phi.pair_count);
+        memcpy(
+            copy->phi.pairs,
+            inst->phi.pairs,
+            sizeof(DuskIRPhiPair) * inst->phi.pair_count);
+        break;
+    }
+    default: break;
+    }
+
+    return copy;
+}
+
+// Returns the value returned by the copy of the called function if the value
+// is a call that was inlined. The value can be another call that was inlined
+// after it.
+static DuskIRValue *
+duskInlineResolve(DuskInlineState *state, DuskIRValue *value)
+{
+    while (value->kind == DUSK_IR_VALUE_FUNCTION_CALL &&
+           value->id < duskArrayLength(state->calls_arr) &&
+           state->calls_arr[value->id] == value) {
+        value = state->returned_values_arr[value->id];
+    }
+    return value;
+}
+
+static void duskInlineResolveOperand(
+    void *user_data, DuskIRValue *inst, DuskIRValue **operand)
+{
+    (void)inst;
+    *operand = duskInlineResolve((DuskInlineState *)user_data, *operand);
+}
+
+static DuskIRValue *
+duskInlineMapBlock(DuskInlineState *state, DuskIRValue *block)
+{
+    DUSK_ASSERT(state->blocks[block->id] == block);
+    return state->copied_blocks[block->id];
+}
+
+static void
+duskInlineMapOperand(void *user_data, DuskIRValue *inst, DuskIRValue **operand)
+{
+    DuskInlineState *state = (DuskInlineState *)user_data;
+    (void)inst;
+
+    DuskIRValue *value = *operand;
+    DuskArray(DuskIRValue *) params_arr = state->callee->function.params_arr;
+    DuskArray(DuskIRValue *) variables_arr =
+        state->callee->function.variables_arr;
+
+    if (value->kind == DUSK_IR_VALUE_FUNCTION_PARAMETER) {
+        if (value->id < duskArrayLength(params_arr) &&
+            params_arr[value->id] == value) {
+            *operand = state->args[value->id];
+        }
+    } else if (duskIsLocalVariable(value)) {
+        if (value->id < duskArrayLength(variables_arr) &&
+            variables_arr[value->id] == value) {
+            *operand = state->copied_vars[value->id];
+        }
+    } else if (duskIsInstruction(value)) {
+        if (value->id < state->inst_count && state->insts[value->id] == value) {
+            *operand = state->copied_insts[value->id];
+        }
+    }
+}
+
+// Replaces the call at the given index of a block by a copy of the body of the
+// called function, or by the body itself if that was its only call. The entry
+// of the copy is the block itself, and the rest of the instructions of the
+// block are moved to the end of the copy of the block with the return. The
+// other blocks of the copy are pushed to the stack of blocks to visit, so they
+// are visited in order right after the block, and the one with the rest of the
+// instructions is returned.
+static DuskIRValue *duskInlineCall(
+    DuskInlineState *state,
+    DuskIRValue *caller,
+    DuskArray(DuskIRValue *) * stack_arr,
+    DuskIRValue *block,
+    size_t call_index)
+{
+    DuskIRModule *module = state->module;
+    DuskAllocator *allocator = module->allocator;
+    DuskIRValue *call = block->block.insts_arr[call_index];
+    DuskIRValue *callee = call->function_call.function;
+    DuskInlineFunction *info = duskGetInlineFunction(state, callee);
+
+    // Nothing else uses the body of a function called once, so it's moved
+    bool is_moved = info->call_count == 1;
+    if (!is_moved && callee->function.inline_hint != DUSK_IR_INLINE_ALWAYS) {
+        state->growth_budget -= info->cost;
+    }
+
+    // Arguments can be the result of calls that were inlined before
+    state->callee = callee;
+    state->args = call->function_call.params_arr;
+    for (size_t i = 0; i < duskArrayLength(state->args); ++i) {
+        state->args[i] = duskInlineResolve(state, state->args[i]);
+    }
+
+    DuskArray(DuskIRValue *) params_arr = callee->function.params_arr;
+    for (size_t i = 0; i < duskArrayLength(params_arr); ++i) {
+        params_arr[i]->id = (uint32_t)i;
+    }
+
+    // The variables of the copy are added to the caller, as variables can
+    // only be declared in the first block of a function
+    DuskArray(DuskIRValue *) variables_arr = callee->function.variables_arr;
+    size_t var_count = duskArrayLength(variables_arr);
+    duskArrayResize(&state->copied_vars, var_count);
+    for (size_t i = 0; i < var_count; ++i) {
+        variables_arr[i]->id = (uint32_t)i;
+        state->copied_vars[i] = is_moved
+                                    ? variables_arr[i]
+                                    : duskCopyInst(allocator, variables_arr[i]);
+        duskArrayPush(&caller->function.variables_arr, state->copied_vars[i]);
+    }
+
+    // Nothing branches to the entry of a function, so the block of the call
+    // can take its place
+    size_t rest_count =
+        duskArrayLength(block->block.insts_arr) - call_index - 1;
+    duskArrayResize(&state->rest_arr, rest_count);
+    for (size_t i = 0; i < rest_count; ++i) {
+        state->rest_arr[i] = block->block.insts_arr[call_index + 1 + i];
+    }
+
+    size_t block_count = duskArrayLength(callee->function.blocks_arr);
+    state->blocks = callee->function.blocks_arr;
+    duskArrayResize(&state->copied_blocks, block_count);
+    state->inst_count = 0;
+    for (size_t i = 0; i < block_count; ++i) {
+        state->blocks[i]->id = (uint32_t)i;
+        if (i == 0) {
+            state->copied_blocks[i] = block;
+        } else if (is_moved) {
+            state->copied_blocks[i] = state->blocks[i];
+        } else {
+            state->copied_blocks[i] = duskIRBlockCreate(module);
+        }
+        state->inst_count += duskArrayLength(state->blocks[i]->block.insts_arr);
+    }
+    DuskIRValue *rest_block = state->copied_blocks[info->return_block->id];
+
+    // The rest of the instructions piles up in chains of calls, so the block
+    // with the return takes the storage of the block of the call when the
+    // rest is longer than what comes before the call
+    DuskArray(DuskIRValue *) block_insts_arr = block->block.insts_arr;
+    bool is_storage_moved = rest_block != block && rest_count > call_index;
+    if (is_storage_moved) {
+        block->block.insts_arr = duskArrayCreate(allocator, DuskIRValue *);
+        for (size_t i = 0; i < call_index; ++i) {
+            duskArrayPush(&block->block.insts_arr, block_insts_arr[i]);
+        }
+    } else {
+        duskArrayResize(&block->block.insts_arr, call_index);
+    }
+
+    duskArrayResize(&state->insts, state->inst_count);
+    duskArrayResize(&state->copied_insts, state->inst_count);
+    size_t inst_index = 0;
+    for (size_t i = 0; i < block_count; ++i) {
+        DuskArray(DuskIRValue *) insts_arr = state->blocks[i]->block.insts_arr;
+        for (size_t j = 0; j < duskArrayLength(insts_arr); ++j) {
+            insts_arr[j]->id = (uint32_t)inst_index;
+            state->insts[inst_index] = insts_arr[j];
+            state->copied_insts[inst_index++] =
+                is_moved ? insts_arr[j] : duskCopyInst(allocator, insts_arr[j]);
+        }
+    }
+
+    DuskIRValue *return_value = NULL;
+    inst_index = 0;
+    for (size_t i = 0; i < block_count; ++i) {
+        DuskIRValue *copied_block = state->copied_blocks[i];
+        size_t inst_count = duskArrayLength(state->blocks[i]->block.insts_arr);
+        if (copied_block == rest_block && is_storage_moved) {
+            copied_block->block.insts_arr = block_insts_arr;
+            duskArrayResize(&copied_block->block.insts_arr, 0);
+        } else if (copied_block == state->blocks[i]) {
+            duskArrayResize(&copied_block->block.insts_arr, 0);
+        }
+        for (size_t j = 0; j < inst_count; ++j, ++inst_index) {
+            DuskIRValue *inst = state->insts[inst_index];
+            DuskIRValue *copy = state->copied_insts[inst_index];
+            duskIRForEachOperand(copy, state, duskInlineMapOperand);
+
+            switch (copy->kind) {
+            case DUSK_IR_VALUE_RETURN: {
+                return_value = copy->return_.value;
+                continue;
+            }
+            case DUSK_IR_VALUE_BRANCH: {
+                copy->branch.dest_block =
+                    duskInlineMapBlock(state, inst->branch.dest_block);
+                break;
+            }
+            case DUSK_IR_VALUE_BRANCH_COND: {
+                copy->branch_cond.true_block =
+                    duskInlineMapBlock(state, inst->branch_cond.true_block);
+                copy->branch_cond.false_block =
+                    duskInlineMapBlock(state, inst->branch_cond.false_block);
+                break;
+            }
+            case DUSK_IR_VALUE_SELECTION_MERGE: {
+                copy->selection_merge.merge_block = duskInlineMapBlock(
+                    state, inst->selection_merge.merge_block);
+                break;
+            }
+            case DUSK_IR_VALUE_LOOP_MERGE: {
+                copy->loop_merge.merge_block =
+                    duskInlineMapBlock(state, inst->loop_merge.merge_block);
+                copy->loop_merge.continue_block =
+                    duskInlineMapBlock(state, inst->loop_merge.continue_block);
+                break;
+            }
+            case DUSK_IR_VALUE_PHI: {
+                for (size_t k = 0; k < copy->phi.pair_count; ++k) {
+                    copy->phi.pairs[k].block =
+                        duskInlineMapBlock(state, inst->phi.pairs[k].block);
+                }
+                break;
+            }
+            case DUSK_IR_VALUE_FUNCTION_CALL: {
+                DuskInlineFunction *called =
+                    duskGetInlineFunction(state, copy->function_call.function);
+                if (called && !is_moved) called->call_count++;
+                break;
+            }
+            default: break;
+            }
+
+            duskArrayPush(&copied_block->block.insts_arr, copy);
+        }
+    }
+
+    for (size_t i = block_count; i-- > 1;) {
+        duskArrayPush(stack_arr, state->copied_blocks[i]);
+    }
+
+    for (size_t i = 0; i < rest_count; ++i) {
+        duskArrayPush(&rest_block->block.insts_arr, state->rest_arr[i]);
+    }
+
+    // The uses of the call are replaced once the whole caller is visited
+    if (return_value) {
+        call->id = (uint32_t)duskArrayLength(state->calls_arr);
+        duskArrayPush(&state->calls_arr, call);
+        duskArrayPush(&state->returned_values_arr, return_value);
+    }
+
+    // The function is removed with the rest of the functions that aren't
+    // called anymore, so it's left empty once its body is moved
+    if (is_moved) {
+        callee->function.blocks_arr = duskArrayCreate(allocator, DuskIRValue *);
+        callee->function.variables_arr =
+            duskArrayCreate(allocator, DuskIRValue *);
+    }
+
+    info->call_count--;
+    return rest_block;
+}
+
+// A loop header is the target of the branch back from its continue block, so
+// its merge can't be moved to the block after a call
+static bool duskIsLoopHeader(DuskIRValue *block)
+{
+    DuskArray(DuskIRValue *) insts_arr = block->block.insts_arr;
+    for (size_t i = 0; i < duskArrayLength(insts_arr); ++i) {
+        if (insts_arr[i]->kind == DUSK_IR_VALUE_LOOP_MERGE) return true;
+    }
+    return false;
+}
+
+// Phis in the successors of a block that was cut at a call now come from the
+// block with the rest of its instructions
+static void duskInlineRenameParent(DuskIRValue *block, DuskIRValue *first_block)
+{
+    DuskIRValue *successors[2];
+    size_t successor_count;
+    duskGetSuccessors(block, successors, &successor_count);
+
+    for (size_t i = 0; i < successor_count; ++i) {
+        DuskArray(DuskIRValue *) insts_arr = successors[i]->block.insts_arr;
+        for (size_t j = 0; j < duskArrayLength(insts_arr); ++j) {
+            DuskIRValue *phi = insts_arr[j];
+            if (phi->kind != DUSK_IR_VALUE_PHI) continue;
+
+            for (size_t k = 0; k < phi->phi.pair_count; ++k) {
+                if (phi->phi.pairs[k].block == first_block) {
+                    phi->phi.pairs[k].block = block;
+                }
+            }
+        }
+    }
+}
+
+static void duskInlineReferenceGlobal(
+    void *user_data, DuskIRValue *inst, DuskIRValue **operand)
+{
+    DuskIREntryPoint *entry_point = (DuskIREntryPoint *)user_data;
+    (void)inst;
+
+    DuskIRValue *value = *operand;
+    if (value->kind != DUSK_IR_VALUE_VARIABLE) return;
+
+    switch (value->var.storage_class) {
+    case DUSK_STORAGE_CLASS_PUSH_CONSTANT:
+    case DUSK_STORAGE_CLASS_UNIFORM:
+    case DUSK_STORAGE_CLASS_UNIFORM_CONSTANT:
+    case DUSK_STORAGE_CLASS_STORAGE:
+    case DUSK_STORAGE_CLASS_WORKGROUP: {
+        duskIREntryPointReferenceGlobal(entry_point, value);
+        break;
+    }
+    default: break;
+    }
+}
+
+// Inlines the calls of a function, and returns whether any was. The bodies
+// that are inlined are visited as well, as the calls of functions that are
+// moved into their caller are only inlined once they reach a function that
+// isn't.
+static bool duskInlineCalls(DuskInlineState *state, DuskIRValue *function)
+{
+    DuskAllocator *allocator = state->module->allocator;
+    DuskIRValue **blocks = function->function.blocks_arr;
+    size_t block_count = duskArrayLength(function->function.blocks_arr);
+
+    duskArrayResize(&state->stack_arr, 0);
+    for (size_t i = block_count; i-- > 0;) {
+        duskArrayPush(&state->stack_arr, blocks[i]);
+    }
+
+    bool inlined = false;
+    DuskArray(DuskIRValue *) blocks_arr =
+        duskArrayCreate(allocator, DuskIRValue *);
+    while (duskArrayLength(state->stack_arr) > 0) {
+        DuskIRValue *block =
+            state->stack_arr[duskArrayLength(state->stack_arr) - 1];
+        duskArrayPop(&state->stack_arr);
+        duskArrayPush(&blocks_arr, block);
+
+        if (duskIsLoopHeader(block)) continue;
+
+        // The instructions of the entry of the inlined function take the place
+        // of the call, so they are visited next
+        size_t inst_index = 0;
+        while (inst_index < duskArrayLength(block->block.insts_arr)) {
+            DuskIRValue *inst = block->block.insts_arr[inst_index];
+            if (inst->kind != DUSK_IR_VALUE_FUNCTION_CALL ||
+                !duskShouldInline(state, function, inst)) {
+                inst_index++;
+                continue;
+            }
+
+            DuskIRValue *rest_block = duskInlineCall(
+                state, function, &state->stack_arr, block, inst_index);
+            if (rest_block != block) {
+                duskInlineRenameParent(rest_block, block);
+            }
+            inlined = true;
+        }
+    }
+    if (!inlined) return false;
+
+    function->function.blocks_arr = blocks_arr;
+    for (size_t i = 0; i < duskArrayLength(blocks_arr); ++i) {
+        DuskArray(DuskIRValue *) insts_arr = blocks_arr[i]->block.insts_arr;
+        for (size_t j = 0; j < duskArrayLength(insts_arr); ++j) {
+            duskIRForEachOperand(insts_arr[j], state, duskInlineResolveOperand);
+        }
+    }
+    duskArrayResize(&state->calls_arr, 0);
+    duskArrayResize(&state->returned_values_arr, 0);
+
+    return true;
+}
+
+// Optimizes a function again after calls were inlined into it
+static void duskCleanUpInlined(
+    DuskIRModule *module, DuskInlineFunction *info, DuskIRValue *function)
+{
+    duskIRPromoteLocals(module, function);
+    duskIRFoldConstants(module, function);
+    if (duskIRUnrollLoops(module, function)) {
+        duskIRFoldConstants(module, function);
+    }
+    duskIRReduceStrength(module, function);
+    duskIRHoistLoopInvariants(module, function);
+    duskIREliminateCommonSubexpressions(module, function);
+    duskIRRemoveDeadCode(module, function);
+
+    if (!info->entry_point) return;
+
+    DuskArray(DuskIRValue *) blocks_arr = function->function.blocks_arr;
+    for (size_t i = 0; i < duskArrayLength(blocks_arr); ++i) {
+        DuskArray(DuskIRValue *) insts_arr = blocks_arr[i]->block.insts_arr;
+        for (size_t j = 0; j < duskArrayLength(insts_arr); ++j) {
+            duskIRForEachOperand(
+                insts_arr[j], info->entry_point, duskInlineReferenceGlobal);
+        }
+    }
+}
+
+void duskIRInlineCalls(DuskIRModule *module)
+{
+    DuskAllocator *allocator = module->allocator;
+    DuskIRValue **functions = module->functions_arr;
+    size_t function_count = duskArrayLength(module->functions_arr);
+
+    // A module without entry points is only checked, and the functions whose
+    // bodies are moved wouldn't be removed from it
+    if (duskArrayLength(module->entry_points_arr) == 0) return;
+
+    DuskInlineState state_storage = {0};
+    DuskInlineState *state = &state_storage;
+    state->module = module;
+    state->function_count = function_count;
+    state->functions =
+        DUSK_NEW_ARRAY(allocator, DuskInlineFunction, function_count);
+    state->growth_budget = DUSK_INLINE_MIN_GROWTH;
+    state->copied_vars = duskArrayCreate(allocator, DuskIRValue *);
+    state->copied_blocks = duskArrayCreate(allocator, DuskIRValue *);
+    state->insts = duskArrayCreate(allocator, DuskIRValue *);
+    state->copied_insts = duskArrayCreate(allocator, DuskIRValue *);
+    state->stack_arr = duskArrayCreate(allocator, DuskIRValue *);
+    state->rest_arr = duskArrayCreate(allocator, DuskIRValue *);
+    state->calls_arr = duskArrayCreate(allocator, DuskIRValue *);
+    state->returned_values_arr = duskArrayCreate(allocator, DuskIRValue *);
+
+    // Ids are only assigned when the module is emitted, so borrow them to find
+    // what is known about each function
+    for (size_t i = 0; i < function_count; ++i) {
+        functions[i]->id = (uint32_t)i;
+    }
+    for (size_t i = 0; i < duskArrayLength(module->entry_points_arr); ++i) {
+        DuskIREntryPoint *entry_point = module->entry_points_arr[i];
+        DuskInlineFunction *info =
+            duskGetInlineFunction(state, entry_point->function);
+        if (info) info->entry_point = entry_point;
+    }
+
+    DuskArray(uint32_t) *callees =
+        DUSK_NEW_ARRAY(allocator, DuskArray(uint32_t), function_count);
+    for (size_t i = 0; i < function_count; ++i) {
+        callees[i] = duskArrayCreate(allocator, uint32_t);
+
+        DuskArray(DuskIRValue *) blocks_arr = functions[i]->function.blocks_arr;
+        for (size_t j = 0; j < duskArrayLength(blocks_arr); ++j) {
+            DuskArray(DuskIRValue *) insts_arr = blocks_arr[j]->block.insts_arr;
+            for (size_t k = 0; k < duskArrayLength(insts_arr); ++k) {
+                DuskIRValue *inst = insts_arr[k];
+                if (!duskIsControlFlow(inst)) state->growth_budget++;
+                if (inst->kind != DUSK_IR_VALUE_FUNCTION_CALL) continue;
+
+                DuskInlineFunction *info =
+                    duskGetInlineFunction(state, inst->function_call.function);
+                if (!info) continue;
+                info->call_count++;
+                duskArrayPush(&callees[i], inst->function_call.function->id);
+            }
+        }
+    }
+
+    // Visits the functions in post-order without recursion, as call chains can
+    // be long. Calls that would make a cycle are left alone.
+    DuskArray(uint32_t) stack_arr = duskArrayCreate(allocator, uint32_t);
+    size_t *next_callees = DUSK_NEW_ARRAY(allocator, size_t, function_count);
+    for (size_t i = 0; i < function_count; ++i) {
+        if (state->functions[i].visit != DUSK_INLINE_UNVISITED) continue;
+
+        state->functions[i].visit = DUSK_INLINE_VISITING;
+        duskArrayPush(&stack_arr, (uint32_t)i);
+        while (duskArrayLength(stack_arr) > 0) {
+            uint32_t index = stack_arr[duskArrayLength(stack_arr) - 1];
+
+            if (next_callees[index] < duskArrayLength(callees[index])) {
+                uint32_t callee_index = callees[index][next_callees[index]++];
+                DuskInlineFunction *callee_info =
+                    &state->functions[callee_index];
+                if (callee_info->visit == DUSK_INLINE_UNVISITED) {
+                    callee_info->visit = DUSK_INLINE_VISITING;
+                    duskArrayPush(&stack_arr, callee_index);
+                }
+                continue;
+            }
+            duskArrayPop(&stack_arr);
+
+            DuskIRValue *function = functions[index];
+            DuskInlineFunction *info = &state->functions[index];
+            duskMeasureInlineFunction(info, function);
+            info->is_pending = info->call_count == 1 && info->return_block;
+            if (duskInlineCalls(state, function)) {
+                duskCleanUpInlined(module, info, function);
+            }
+            duskMeasureInlineFunction(info, function);
+            info->visit = DUSK_INLINE_VISITED;
+        }
+    }
+
+    // The calls to some of the functions that were going to be moved couldn't
+    // be inlined, so what they call once is inlined into them instead
+    for (size_t i = 0; i < function_count; ++i) {
+        DuskInlineFunction *info = &state->functions[i];
+        if (!info->is_pending || info->call_count == 0) continue;
+
+        info->is_pending = false;
+        if (duskInlineCalls(state, functions[i])) {
+            duskCleanUpInlined(module, info, functions[i]);
+        }
+    }
+
+    for (size_t i = 0; i < function_count; ++i) {
+        functions[i]->id = 0;
+    }
+}
+// }}}
+
+// Loop unrolling {{{
+
+// A loop is replaced by a copy of its blocks for every iteration, followed by
+// a copy of the blocks that test its condition for the last time. The copies
+// are folded as they are made, so the condition of every iteration is known
+// while the loop is unrolled, and the values that only depend on the
+// iteration, like the indices of arrays, become constants. If a condition
+// isn't constant, or the copies get too big, the loop is left alone.
+//
+// Only loops that run their blocks in a straight line from one iteration to
+// the next are unrolled: the condition has to be tested by the header and the
+// blocks it branches to unconditionally, and only the end of the body can
+// reach the continue block, so loops with break and continue statements are
+// left alone.
+//
+// While the pass runs, the id of the blocks of the function is their index in
+// the function, and the id of the instructions of the loop and of their copies
+// is the index of the instruction in the loop.
+
+// Number of instructions the copies of a loop can have, unless the loop has
+// the 'unroll' attribute
+#define DUSK_UNROLL_MAX_COST 256
+#define DUSK_UNROLL_FORCED_MAX_COST 4096
+
+typedef struct DuskUnrollState {
+    DuskIRModule *module;
+    DuskIRValue **blocks;
+    size_t block_count;
+    uint32_t *pred_counts;
+    // A block before each block that branches to it, if there is one
+    DuskIRValue **entry_blocks;
+
+    DuskIRValue *header;
+    DuskIRValue *merge_block;
+    bool *in_loop;
+    // Indices of the blocks marked as part of the loop
+    DuskArray(uint32_t) marked_arr;
+    DuskArray(DuskIRValue *) loop_blocks_arr;
+    size_t test_block_count;
+
+    DuskIRValue **insts;
+    size_t inst_count;
+    // Copy of each instruction and block of the loop in the current iteration
+    DuskIRValue **copied_insts;
+    DuskIRValue **copied_blocks;
+    // Value of each instruction of the loop in the current iteration, which is
+    // its copy unless it was folded
+    DuskIRValue **values;
+
+    DuskArray(DuskIRValue *) copies_arr;
+    size_t cost;
+} DuskUnrollState;
+
+static void
+duskUnrollMapOperand(void *user_data, DuskIRValue *inst, DuskIRValue **operand)
+{
+    DuskUnrollState *state = (DuskUnrollState *)user_data;
+    (void)inst;
+
+    DuskIRValue *value = *operand;
+    if (duskIsInstruction(value) && value->id < state->inst_count &&
+        state->insts[value->id] == value) {
+        *operand = state->values[value->id];
+    }
+}
+
+// Operands of copies can be copies made later in the same iteration, if they
+// are the incoming values of phis in a loop inside the unrolled one
+static void duskUnrollResolveOperand(
+    void *user_data, DuskIRValue *inst, DuskIRValue **operand)
+{
+    DuskUnrollState *state = (DuskUnrollState *)user_data;
+    (void)inst;
+
+    DuskIRValue *value = *operand;
+    if (duskIsInstruction(value) && value->id < state->inst_count &&
+        state->copied_insts[value->id] == value) {
+        *operand = state->values[value->id];
+    }
+}
+
+static DuskIRValue *
+duskUnrollMapBlock(DuskUnrollState *state, DuskIRValue *block)
+{
+    if (!state->in_loop[block->id]) return block;
+    return state->copied_blocks[block->id];
+}
+
+static void duskAddLoopBlock(
+    bool *in_loop,
+    DuskArray(uint32_t) * marked_arr,
+    DuskIRValue *merge_block,
+    DuskIRValue *block)
+{
+    if (block == merge_block || in_loop[block->id]) return;
+    in_loop[block->id] = true;
+    duskArrayPush(marked_arr, block->id);
+}
+
+static int duskCompareBlockIndices(const void *a, const void *b)
+{
+    uint32_t index_a = *(const uint32_t *)a;
+    uint32_t index_b = *(const uint32_t *)b;
+    return (index_a > index_b) - (index_a < index_b);
+}
+
+// The blocks of a loop are the ones reached from its header without going
+// through its merge block, including the merge blocks of the selections and
+// loops inside it that aren't reached. They are marked in in_loop, where the
+// marks left by the previous loop are cleared first, and returned in the
+// order of the function, or NULL if the header doesn't come first.
+//
+// The id of the blocks of the function has to be their index in blocks.
+static DuskArray(DuskIRValue *) duskFindLoopBlocks(
+    DuskAllocator *allocator,
+    DuskIRValue **blocks,
+    DuskIRValue *header,
+    DuskIRValue *merge_block,
+    bool *in_loop,
+    DuskArray(uint32_t) * marked_arr)
+{
+    for (size_t i = 0; i < duskArrayLength(*marked_arr); ++i) {
+        in_loop[(*marked_arr)[i]] = false;
+    }
+    duskArrayResize(marked_arr, 0);
+
+    duskAddLoopBlock(in_loop, marked_arr, merge_block, header);
+    for (size_t i = 0; i < duskArrayLength(*marked_arr); ++i) {
+        DuskIRValue *block = blocks[(*marked_arr)[i]];
+
+        DuskIRValue *successors[2];
+        size_t successor_count = 0;
+        duskGetSuccessors(block, successors, &successor_count);
+        for (size_t j = 0; j < successor_count; ++j) {
+            duskAddLoopBlock(in_loop, marked_arr, merge_block, successors[j]);
+        }
+
+        DuskArray(DuskIRValue *) insts_arr = block->block.insts_arr;
+        for (size_t j = 0; j < duskArrayLength(insts_arr); ++j) {
+            DuskIRValue *inst = insts_arr[j];
+            if (inst->kind == DUSK_IR_VALUE_SELECTION_MERGE) {
+                duskAddLoopBlock(
+                    in_loop,
+                    marked_arr,
+                    merge_block,
+                    inst->selection_merge.merge_block);
+            } else if (inst->kind == DUSK_IR_VALUE_LOOP_MERGE) {
+                duskAddLoopBlock(
+                    in_loop,
+                    marked_arr,
+                    merge_block,
+                    inst->loop_merge.merge_block);
+                duskAddLoopBlock(
+                    in_loop,
+                    marked_arr,
+                    merge_block,
+                    inst->loop_merge.continue_block);
+            }
+        }
+    }
+
+    size_t loop_block_count = duskArrayLength(*marked_arr);
+    uint32_t *indices = DUSK_NEW_ARRAY(allocator, uint32_t, loop_block_count);
+    memcpy(indices, *marked_arr, sizeof(uint32_t) * loop_block_count);
+    qsort(
+        indices, loop_block_count, sizeof(uint32_t), duskCompareBlockIndices);
+
+    // Blocks come after the blocks that dominate them, so the loop starts at
+    // its header
+    if (indices[0] != header->id) return NULL;
+
+    DuskArray(DuskIRValue *) loop_blocks_arr =
+        duskArrayCreate(allocator, DuskIRValue *);
+    for (size_t i = 0; i < loop_block_count; ++i) {
+        duskArrayPush(&loop_blocks_arr, blocks[indices[i]]);
+    }
+    return loop_blocks_arr;
+}
+
+static DuskIRValue *duskGetTerminator(DuskIRValue *block)
+{
+    size_t inst_count = duskArrayLength(block->block.insts_arr);
+    if (inst_count == 0) return NULL;
+    return block->block.insts_arr[inst_count - 1];
+}
+
+// Checks that the loop runs its blocks in a straight line, and finds the
+// blocks that test its condition. The last of them is returned.
+static DuskIRValue *
+duskUnrollFindTestBlocks(DuskUnrollState *state, DuskIRValue *continue_block)
+{
+    DuskIRValue *header = state->header;
+    DuskIRValue *merge_block = state->merge_block;
+
+    size_t loop_block_count = duskArrayLength(state->loop_blocks_arr);
+    for (size_t i = 0; i < loop_block_count; ++i) {
+        DuskIRValue *block = state->loop_blocks_arr[i];
+        DuskIRValue *successors[2];
+        size_t successor_count = 0;
+        duskGetSuccessors(block, successors, &successor_count);
+        for (size_t j = 0; j < successor_count; ++j) {
+            if (successors[j] == header && block != continue_block) {
+                return NULL;
+            }
+        }
+    }
+
+    DuskIRValue *terminator = duskGetTerminator(continue_block);
+    if (!state->in_loop[continue_block->id] ||
+        state->pred_counts[continue_block->id] != 1 || !terminator ||
+        terminator->kind != DUSK_IR_VALUE_BRANCH ||
+        terminator->branch.dest_block != header) {
+        return NULL;
+    }
+
+    DuskIRValue *block = header;
+    while (state->test_block_count < loop_block_count &&
+           state->loop_blocks_arr[state->test_block_count] == block) {
+        state->test_block_count++;
+
+        DuskArray(DuskIRValue *) insts_arr = block->block.insts_arr;
+        for (size_t i = 0; i < duskArrayLength(insts_arr); ++i) {
+            DuskIRValue *inst = insts_arr[i];
+            if (inst->kind == DUSK_IR_VALUE_SELECTION_MERGE ||
+                (inst->kind == DUSK_IR_VALUE_LOOP_MERGE && block != header)) {
+                return NULL;
+            }
+        }
+
+        terminator = duskGetTerminator(block);
+        if (!terminator) return NULL;
+
+        if (terminator->kind == DUSK_IR_VALUE_BRANCH_COND) {
+            // Breaking out of the loop anywhere else isn't unrolled
+            DuskIRValue *true_block = terminator->branch_cond.true_block;
+            DuskIRValue *false_block = terminator->branch_cond.false_block;
+            if ((true_block == merge_block) == (false_block == merge_block) ||
+                state->pred_counts[merge_block->id] != 1) {
+                return NULL;
+            }
+            return block;
+        }
+
+        if (terminator->kind != DUSK_IR_VALUE_BRANCH) return NULL;
+        block = terminator->branch.dest_block;
+        if (block == header || state->pred_counts[block->id] != 1) {
+            return NULL;
+        }
+    }
+
+    return NULL;
+}
+
+// Copies a range of the blocks of the loop for the current iteration
+static void
+duskUnrollCopyBlocks(DuskUnrollState *state, size_t first, size_t last)
+{
+    DuskIRModule *module = state->module;
+    DuskAllocator *allocator = module->allocator;
+
+    for (size_t i = first; i < last; ++i) {
+        DuskIRValue *block = state->loop_blocks_arr[i];
+        state->copied_blocks[block->id] = duskIRBlockCreate(module);
+        duskArrayPush(&state->copies_arr, state->copied_blocks[block->id]);
+    }
+
+    // Copies are made before they are folded, so the phis of loops inside the
+    // unrolled one can refer to the copies of their incoming values
+    for (size_t i = first; i < last; ++i) {
+        DuskArray(DuskIRValue *) insts_arr =
+            state->loop_blocks_arr[i]->block.insts_arr;
+        for (size_t j = 0; j < duskArrayLength(insts_arr); ++j) {
+            DuskIRValue *inst = insts_arr[j];
+            if (state->loop_blocks_arr[i] == state->header &&
+                (inst->kind == DUSK_IR_VALUE_PHI ||
+                 inst->kind == DUSK_IR_VALUE_LOOP_MERGE)) {
+                continue;
+            }
+
+            DuskIRValue *copy = duskCopyInst(allocator, inst);
+            state->copied_insts[inst->id] = copy;
+            state->values[inst->id] = copy;
+        }
+    }
+
+    DuskArray(DuskIRValue *) phis_arr =
+        duskArrayCreate(allocator, DuskIRValue *);
+    for (size_t i = first; i < last; ++i) {
+        DuskIRValue *block = state->loop_blocks_arr[i];
+        DuskIRValue *copied_block = state->copied_blocks[block->id];
+
+        DuskArray(DuskIRValue *) insts_arr = block->block.insts_arr;
+        for (size_t j = 0; j < duskArrayLength(insts_arr); ++j) {
+            DuskIRValue *inst = insts_arr[j];
+            if (block == state->header &&
+                (inst->kind == DUSK_IR_VALUE_PHI ||
+                 inst->kind == DUSK_IR_VALUE_LOOP_MERGE)) {
+                continue;
+            }
+
+            DuskIRValue *copy = state->copied_insts[inst->id];
+            duskIRForEachOperand(copy, state, duskUnrollMapOperand);
+
+            switch (copy->kind) {
+            case DUSK_IR_VALUE_BRANCH: {
+                // The branch back to the header is redirected to the copy of
+                // the next iteration once it's made
+                copy->branch.dest_block =
+                    duskUnrollMapBlock(state, inst->branch.dest_block);
+                break;
+            }
+            case DUSK_IR_VALUE_BRANCH_COND: {
+                copy->branch_cond.true_block =
+                    duskUnrollMapBlock(state, inst->branch_cond.true_block);
+                copy->branch_cond.false_block =
+                    duskUnrollMapBlock(state, inst->branch_cond.false_block);
+                break;
+            }
+            case DUSK_IR_VALUE_SELECTION_MERGE: {
+                copy->selection_merge.merge_block = duskUnrollMapBlock(
+                    state, inst->selection_merge.merge_block);
+                break;
+            }
+            case DUSK_IR_VALUE_LOOP_MERGE: {
+                copy->loop_merge.merge_block =
+                    duskUnrollMapBlock(state, inst->loop_merge.merge_block);
+                copy->loop_merge.continue_block =
+                    duskUnrollMapBlock(state, inst->loop_merge.continue_block);
+                break;
+            }
+            case DUSK_IR_VALUE_PHI: {
+                for (size_t k = 0; k < copy->phi.pair_count; ++k) {
+                    copy->phi.pairs[k].block =
+                        duskUnrollMapBlock(state, inst->phi.pairs[k].block);
+                }
+                duskArrayPush(&phis_arr, copy);
+                break;
+            }
+            default: break;
+            }
+
+            DuskIRValue *folded = duskFoldInst(module, copy);
+            if (folded) {
+                state->values[inst->id] = folded;
+                continue;
+            }
+
+            copy->id = inst->id;
+            duskArrayPush(&copied_block->block.insts_arr, copy);
+            state->cost++;
+        }
+    }
+
+    for (size_t i = 0; i < duskArrayLength(phis_arr); ++i) {
+        duskIRForEachOperand(phis_arr[i], state, duskUnrollResolveOperand);
+    }
+}
+
+static void duskUnrollSetBranch(DuskIRValue *block, DuskIRValue *dest_block)
+{
+    DuskIRValue *terminator = duskGetTerminator(block);
+    terminator->kind = DUSK_IR_VALUE_BRANCH;
+    terminator->branch.dest_block = dest_block;
+}
+
+static void duskUnrollMarkNamed(bool *named, DuskIRValue *block)
+{
+    if (block->id != UINT32_MAX) named[block->id] = true;
+}
+
+// Moves the instructions of each copied block, and of the merge block of the
+// loop, into the block before it when that's the only block that branches to
+// it, so iterations whose body is a straight line end up in one block. Blocks
+// that merge instructions name are kept. Returns whether the merge block of
+// the loop was moved.
+static bool
+duskUnrollMergeBlocks(DuskUnrollState *state, DuskIRValue *entry_block)
+{
+    DuskAllocator *allocator = state->module->allocator;
+    DuskArray(DuskIRValue *) copies_arr = state->copies_arr;
+    size_t copy_count = duskArrayLength(copies_arr);
+
+    // The merge block of the loop comes after the copies
+    uint32_t *pred_counts =
+        DUSK_NEW_ARRAY(allocator, uint32_t, copy_count + 1);
+    bool *named = DUSK_NEW_ARRAY(allocator, bool, copy_count + 1);
+    bool *merged = DUSK_NEW_ARRAY(allocator, bool, copy_count + 1);
+    for (size_t i = 0; i < state->block_count; ++i) {
+        if (!state->in_loop[i]) state->blocks[i]->id = UINT32_MAX;
+    }
+    for (size_t i = 0; i < copy_count; ++i) {
+        copies_arr[i]->id = (uint32_t)i;
+    }
+    state->merge_block->id = (uint32_t)copy_count;
+
+    pred_counts[0]++;
+    for (size_t i = 0; i < copy_count; ++i) {
+        DuskIRValue *successors[2];
+        size_t successor_count = 0;
+        duskGetSuccessors(copies_arr[i], successors, &successor_count);
+        for (size_t j = 0; j < successor_count; ++j) {
+            if (successors[j]->id != UINT32_MAX) {
+                pred_counts[successors[j]->id]++;
+            }
+        }
+
+        DuskArray(DuskIRValue *) insts_arr = copies_arr[i]->block.insts_arr;
+        for (size_t j = 0; j < duskArrayLength(insts_arr); ++j) {
+            DuskIRValue *inst = insts_arr[j];
+            if (inst->kind == DUSK_IR_VALUE_SELECTION_MERGE) {
+                duskUnrollMarkNamed(named, inst->selection_merge.merge_block);
+            } else if (inst->kind == DUSK_IR_VALUE_LOOP_MERGE) {
+                duskUnrollMarkNamed(named, inst->loop_merge.merge_block);
+                duskUnrollMarkNamed(named, inst->loop_merge.continue_block);
+            }
+        }
+    }
+
+    DuskArray(DuskIRValue *) blocks_arr =
+        duskArrayCreate(allocator, DuskIRValue *);
+    for (size_t i = 0; i <= copy_count; ++i) {
+        DuskIRValue *block = i == 0 ? entry_block : copies_arr[i - 1];
+        if (i > 0 && merged[i - 1]) continue;
+
+        while (true) {
+            if (duskIsLoopHeader(block)) break;
+            DuskIRValue *terminator = duskGetTerminator(block);
+            if (!terminator || terminator->kind != DUSK_IR_VALUE_BRANCH) break;
+
+            DuskIRValue *next = terminator->branch.dest_block;
+            if (next->id == UINT32_MAX || pred_counts[next->id] != 1 ||
+                named[next->id] ||
+                (duskArrayLength(next->block.insts_arr) > 0 &&
+                 next->block.insts_arr[0]->kind == DUSK_IR_VALUE_PHI)) {
+                break;
+            }
+
+            DuskArray(DuskIRValue *) next_insts_arr = next->block.insts_arr;
+            duskArrayPop(&block->block.insts_arr);
+            for (size_t j = 0; j < duskArrayLength(next_insts_arr); ++j) {
+                duskArrayPush(&block->block.insts_arr, next_insts_arr[j]);
+            }
+            merged[next->id] = true;
+
+            DuskIRValue *successors[2];
+            size_t successor_count = 0;
+            duskGetSuccessors(block, successors, &successor_count);
+            for (size_t j = 0; j < successor_count; ++j) {
+                DuskArray(DuskIRValue *) insts_arr =
+                    successors[j]->block.insts_arr;
+                for (size_t k = 0; k < duskArrayLength(insts_arr); ++k) {
+                    DuskIRValue *phi = insts_arr[k];
+                    if (phi->kind != DUSK_IR_VALUE_PHI) break;
+                    for (size_t l = 0; l < phi->phi.pair_count; ++l) {
+                        if (phi->phi.pairs[l].block == next) {
+                            phi->phi.pairs[l].block = block;
+                        }
+                    }
+                }
+            }
+        }
+
+        if (i > 0) duskArrayPush(&blocks_arr, block);
+    }
+
+    state->copies_arr = blocks_arr;
+    return merged[copy_count];
+}
+
+static bool duskUnrollLoop(DuskUnrollState *state, DuskIRValue *header)
+{
+    DuskIRModule *module = state->module;
+    DuskAllocator *allocator = module->allocator;
+
+    DuskIRValue *loop_merge = NULL;
+    DuskArray(DuskIRValue *) header_insts_arr = header->block.insts_arr;
+    for (size_t i = 0; i < duskArrayLength(header_insts_arr); ++i) {
+        if (header_insts_arr[i]->kind == DUSK_IR_VALUE_LOOP_MERGE) {
+            loop_merge = header_insts_arr[i];
+        }
+    }
+    if (!loop_merge ||
+        loop_merge->loop_merge.unroll_hint == DUSK_IR_UNROLL_NEVER) {
+        return false;
+    }
+
+    size_t max_cost = DUSK_UNROLL_MAX_COST;
+    uint32_t max_trip_count = UINT32_MAX;
+    if (loop_merge->loop_merge.unroll_hint == DUSK_IR_UNROLL_ALWAYS) {
+        max_cost = DUSK_UNROLL_FORCED_MAX_COST;
+        if (loop_merge->loop_merge.unroll_count > 0) {
+            max_trip_count = loop_merge->loop_merge.unroll_count;
+        }
+    }
+
+    state->header = header;
+    state->merge_block = loop_merge->loop_merge.merge_block;
+    state->test_block_count = 0;
+    state->cost = 0;
+
+    state->loop_blocks_arr = duskFindLoopBlocks(
+        allocator,
+        state->blocks,
+        header,
+        state->merge_block,
+        state->in_loop,
+        &state->marked_arr);
+    if (!state->loop_blocks_arr) return false;
+
+    // The header is only entered from one block outside of the loop
+    if (state->pred_counts[header->id] != 2) return false;
+    DuskIRValue *entry_branch_block = state->entry_blocks[header->id];
+    if (!entry_branch_block) return false;
+    DuskIRValue *entry_branch = duskGetTerminator(entry_branch_block);
+    if (entry_branch->kind != DUSK_IR_VALUE_BRANCH) return false;
+
+    DuskIRValue *continue_block = loop_merge->loop_merge.continue_block;
+    DuskIRValue *exit_block =
+        duskUnrollFindTestBlocks(state, continue_block);
+    if (!exit_block) return false;
+
+    DuskIRValue *exit_branch = duskGetTerminator(exit_block);
+    bool exits_if_true =
+        exit_branch->branch_cond.true_block == state->merge_block;
+    DuskIRValue *body_block = exits_if_true
+                                  ? exit_branch->branch_cond.false_block
+                                  : exit_branch->branch_cond.true_block;
+
+    state->inst_count = 0;
+    for (size_t i = 0; i < duskArrayLength(state->loop_blocks_arr); ++i) {
+        state->inst_count +=
+            duskArrayLength(state->loop_blocks_arr[i]->block.insts_arr);
+    }
+    if (state->inst_count > max_cost) return false;
+
+    state->insts = DUSK_NEW_ARRAY(allocator, DuskIRValue *, state->inst_count);
+    state->copied_insts =
+        DUSK_NEW_ARRAY(allocator, DuskIRValue *, state->inst_count);
+    state->values = DUSK_NEW_ARRAY(allocator, DuskIRValue *, state->inst_count);
+
+    size_t inst_index = 0;
+    for (size_t i = 0; i < duskArrayLength(state->loop_blocks_arr); ++i) {
+        DuskArray(DuskIRValue *) insts_arr =
+            state->loop_blocks_arr[i]->block.insts_arr;
+        for (size_t j = 0; j < duskArrayLength(insts_arr); ++j) {
+            insts_arr[j]->id = (uint32_t)inst_index;
+            state->insts[inst_index++] = insts_arr[j];
+        }
+    }
+
+    // The phis of the header take their incoming value from the entry in the
+    // first iteration, and from the continue block of the previous one after
+    // that
+    DuskArray(DuskIRValue *) phis_arr =
+        duskArrayCreate(allocator, DuskIRValue *);
+    for (size_t i = 0; i < duskArrayLength(header_insts_arr); ++i) {
+        DuskIRValue *phi = header_insts_arr[i];
+        if (phi->kind != DUSK_IR_VALUE_PHI) continue;
+        if (phi->phi.pair_count != 2) return false;
+
+        for (size_t j = 0; j < 2; ++j) {
+            DuskIRValue *pred = phi->phi.pairs[j].block;
+            if (!state->in_loop[pred->id]) {
+                state->values[phi->id] = phi->phi.pairs[j].value;
+            } else if (pred != continue_block) {
+                return false;
+            }
+        }
+        if (!state->values[phi->id]) return false;
+        duskArrayPush(&phis_arr, phi);
+    }
+
+    state->copies_arr = duskArrayCreate(allocator, DuskIRValue *);
+    size_t loop_block_count = duskArrayLength(state->loop_blocks_arr);
+    DuskIRValue *back_branch = NULL;
+    uint32_t trip_count = 0;
+    while (true) {
+        duskUnrollCopyBlocks(state, 0, state->test_block_count);
+        if (back_branch) {
+            back_branch->branch.dest_block = state->copied_blocks[header->id];
+        }
+
+        DuskIRValue *copied_exit_block = state->copied_blocks[exit_block->id];
+        DuskIRValue *cond =
+            duskGetTerminator(copied_exit_block)->branch_cond.cond;
+        if (cond->kind != DUSK_IR_VALUE_CONSTANT_BOOL) return false;
+
+        if (cond->const_bool.value == exits_if_true) {
+            duskUnrollSetBranch(copied_exit_block, state->merge_block);
+            break;
+        }
+
+        if (trip_count == max_trip_count) return false;
+        trip_count++;
+
+        duskUnrollCopyBlocks(
+            state, state->test_block_count, loop_block_count);
+        if (state->cost > max_cost) return false;
+
+        duskUnrollSetBranch(
+            copied_exit_block, state->copied_blocks[body_block->id]);
+        back_branch =
+            duskGetTerminator(state->copied_blocks[continue_block->id]);
+
+        // Incoming values of the next iteration
+        DuskIRValue **next_values =
+            DUSK_NEW_ARRAY(allocator, DuskIRValue *, duskArrayLength(phis_arr));
+        for (size_t i = 0; i < duskArrayLength(phis_arr); ++i) {
+            DuskIRValue *phi = phis_arr[i];
+            for (size_t j = 0; j < 2; ++j) {
+                if (phi->phi.pairs[j].block == continue_block) {
+                    DuskIRValue *value = phi->phi.pairs[j].value;
+                    duskUnrollMapOperand(state, phi, &value);
+                    next_values[i] = value;
+                }
+            }
+        }
+        for (size_t i = 0; i < duskArrayLength(phis_arr); ++i) {
+            state->values[phis_arr[i]->id] = next_values[i];
+        }
+    }
+
+    entry_branch->branch.dest_block = state->copies_arr[0];
+
+    // Values of the blocks that test the condition can be used after the
+    // loop, where the values of the last test are the ones they take
+    for (size_t i = 0; i < state->block_count; ++i) {
+        DuskIRValue *block = state->blocks[i];
+        if (state->in_loop[i]) continue;
+
+        DuskArray(DuskIRValue *) insts_arr = block->block.insts_arr;
+        for (size_t j = 0; j < duskArrayLength(insts_arr); ++j) {
+            DuskIRValue *inst = insts_arr[j];
+            duskIRForEachOperand(inst, state, duskUnrollMapOperand);
+            if (block == state->merge_block &&
+                inst->kind == DUSK_IR_VALUE_PHI) {
+                for (size_t k = 0; k < inst->phi.pair_count; ++k) {
+                    inst->phi.pairs[k].block =
+                        duskUnrollMapBlock(state, inst->phi.pairs[k].block);
+                }
+            }
+        }
+    }
+
+    // Blocks are given back the ids they had before the copies are merged
+    bool merge_block_moved = duskUnrollMergeBlocks(state, entry_branch_block);
+    for (size_t i = 0; i < state->block_count; ++i) {
+        state->blocks[i]->id = (uint32_t)i;
+    }
+    if (merge_block_moved) state->in_loop[state->merge_block->id] = true;
+
+    DuskArray(DuskIRValue *) blocks_arr =
+        duskArrayCreate(allocator, DuskIRValue *);
+    for (size_t i = 0; i < state->block_count; ++i) {
+        if (i == header->id) {
+            for (size_t j = 0; j < duskArrayLength(state->copies_arr); ++j) {
+                duskArrayPush(&blocks_arr, state->copies_arr[j]);
+            }
+        }
+        if (!state->in_loop[i]) {
+            duskArrayPush(&blocks_arr, state->blocks[i]);
+        }
+    }
+
+    state->blocks = blocks_arr;
+    return true;
+}
+
+static void duskUnrollCountBlocks(DuskUnrollState *state, DuskIRValue *function)
+{
+    DuskAllocator *allocator = state->module->allocator;
+    state->blocks = function->function.blocks_arr;
+    state->block_count = duskArrayLength(function->function.blocks_arr);
+
+    state->pred_counts =
+        DUSK_NEW_ARRAY(allocator, uint32_t, state->block_count);
+    state->entry_blocks =
+        DUSK_NEW_ARRAY(allocator, DuskIRValue *, state->block_count);
+    state->in_loop = DUSK_NEW_ARRAY(allocator, bool, state->block_count);
+    state->copied_blocks =
+        DUSK_NEW_ARRAY(allocator, DuskIRValue *, state->block_count);
+    state->marked_arr = duskArrayCreate(allocator, uint32_t);
+
+    for (size_t i = 0; i < state->block_count; ++i) {
+        state->blocks[i]->id = (uint32_t)i;
+    }
+    for (size_t i = 0; i < state->block_count; ++i) {
+        DuskIRValue *successors[2];
+        size_t successor_count = 0;
+        duskGetSuccessors(state->blocks[i], successors, &successor_count);
+        for (size_t j = 0; j < successor_count; ++j) {
+            state->pred_counts[successors[j]->id]++;
+            if (successors[j]->id > i) {
+                state->entry_blocks[successors[j]->id] = state->blocks[i];
+            }
+        }
+    }
+}
+
+bool duskIRUnrollLoops(DuskIRModule *module, DuskIRValue *function)
+{
+    DUSK_ASSERT(function->kind == DUSK_IR_VALUE_FUNCTION);
+
+    DuskUnrollState state_storage = {0};
+    DuskUnrollState *state = &state_storage;
+    state->module = module;
+
+    // Loops inside of others come after them, so they are unrolled first. The
+    // blocks are only counted again once a loop is unrolled.
+    bool any_unrolled = false;
+    bool blocks_changed = true;
+    for (size_t i = duskArrayLength(function->function.blocks_arr); i > 0;
+         --i) {
+        DuskIRValue *header = function->function.blocks_arr[i - 1];
+        if (!duskIsLoopHeader(header)) continue;
+
+        if (blocks_changed) {
+            duskUnrollCountBlocks(state, function);
+            blocks_changed = false;
+        }
+
+        if (duskUnrollLoop(state, header)) {
+            function->function.blocks_arr = state->blocks;
+            any_unrolled = true;
+            blocks_changed = true;
+        }
+    }
+
+    return any_unrolled;
+}
+// }}}
+
+// Loop-invariant code motion {{{
+
+// Instructions without side effects whose operands are all defined outside of
+// a loop compute the same value in every iteration, so they are moved to the
+// block that enters the loop and only run once. Loads are moved if nothing
+// can write to the memory they read while the shader runs.
+//
+// Instructions that don't run every time the loop is entered are only moved
+// if running them anyway can't go wrong: loads have to index into memory with
+// constant indices that are in bounds, and integer divisions need a constant
+// divisor.
+//
+// Loops inside of others come after them, so they are visited first, and
+// what is moved out of them can be moved again if it doesn't depend on the
+// outer loop either.
+//
+// While the pass runs, the id of the blocks of the function is their index in
+// the function, and the id of the instructions is the index of their block.
+
+typedef struct DuskHoistState {
+    DuskIRModule *module;
+    bool *in_loop;
+    DuskArray(uint32_t) marked_arr;
+    bool is_invariant;
+} DuskHoistState;
+
+static void duskCheckInvariantOperand(
+    void *user_data, DuskIRValue *inst, DuskIRValue **operand)
+{
+    DuskHoistState *state = (DuskHoistState *)user_data;
+    (void)inst;
+
+    DuskIRValue *value = *operand;
+    if (duskIsInstruction(value) && state->in_loop[value->id]) {
+        state->is_invariant = false;
+    }
+}
+
+// Whether a pointer only indexes into composites with constant indices that
+// are in bounds
+static bool duskIsInBoundsPointer(DuskIRValue *pointer)
+{
+    while (pointer->kind == DUSK_IR_VALUE_ACCESS_CHAIN) {
+        DuskIRValue *base = pointer->access_chain.base;
+        DuskType *type = base->type->pointer.sub;
+
+        DuskArray(DuskIRValue *) indices_arr =
+            pointer->access_chain.indices_arr;
+        for (size_t i = 0; i < duskArrayLength(indices_arr); ++i) {
+            if (indices_arr[i]->kind != DUSK_IR_VALUE_CONSTANT) return false;
+            uint64_t index = duskFoldGetInt(indices_arr[i]);
+
+            switch (type->kind) {
+            case DUSK_TYPE_STRUCT: {
+                type = type->struct_.field_types[index];
+                break;
+            }
+            case DUSK_TYPE_ARRAY: {
+                if (index >= type->array.size) return false;
+                type = type->array.sub;
+                break;
+            }
+            case DUSK_TYPE_VECTOR: {
+                if (index >= type->vector.size) return false;
+                type = type->vector.sub;
+                break;
+            }
+            case DUSK_TYPE_MATRIX: {
+                if (index >= type->matrix.cols) return false;
+                type = type->matrix.col_type;
+                break;
+            }
+            default: return false;
+            }
+        }
+
+        pointer = base;
+    }
+    return true;
+}
+
+static bool duskIsHoistable(DuskIRValue *inst)
+{
+    if (!duskIsNumbered(inst)) return false;
+    if (inst->kind == DUSK_IR_VALUE_LOAD) {
+        return duskIsReadOnlyPointer(inst->load.pointer);
+    }
+    return true;
+}
+
+// Whether an instruction can run where it didn't before
+static bool duskIsSafeToSpeculate(DuskIRValue *inst)
+{
+    switch (inst->kind) {
+    case DUSK_IR_VALUE_LOAD: return duskIsInBoundsPointer(inst->load.pointer);
+    case DUSK_IR_VALUE_BINARY_OPERATION: {
+        if (inst->binary.op != DUSK_BINARY_OP_DIV &&
+            inst->binary.op != DUSK_BINARY_OP_MOD) {
+            return true;
+        }
+
+        // Dividing an integer by zero, or the smallest signed integer by -1,
+        // is undefined
+        DuskIRValue *divisor = inst->binary.right;
+        if (duskFoldComponentType(divisor->type)->kind != DUSK_TYPE_INT) {
+            return true;
+        }
+        if (divisor->kind != DUSK_IR_VALUE_CONSTANT) return false;
+        uint64_t divisor_value = duskFoldGetInt(divisor);
+        return divisor_value != 0 && divisor_value != UINT64_MAX;
+    }
+    default: return true;
+    }
+}
+
+static void duskHoistLoop(
+    DuskHoistState *state,
+    DuskArray(DuskIRValue *) loop_blocks_arr,
+    DuskIRValue *pre_header)
+{
+    DuskArray(DuskIRValue *) hoisted_arr = NULL;
+
+    // The header and the blocks it branches to unconditionally run every
+    // time the loop is entered
+    DuskIRValue *next_entered_block = loop_blocks_arr[0];
+
+    for (size_t i = 0; i < duskArrayLength(loop_blocks_arr); ++i) {
+        DuskIRValue *block = loop_blocks_arr[i];
+        DuskArray(DuskIRValue *) insts_arr = block->block.insts_arr;
+
+        bool is_entered = block == next_entered_block;
+        if (is_entered) {
+            DuskIRValue *terminator = duskGetTerminator(block);
+            if (terminator->kind == DUSK_IR_VALUE_BRANCH &&
+                state->in_loop[terminator->branch.dest_block->id] &&
+                terminator->branch.dest_block->id > block->id) {
+                next_entered_block = terminator->branch.dest_block;
+            }
+        }
+
+        size_t kept_count = 0;
+        for (size_t j = 0; j < duskArrayLength(insts_arr); ++j) {
+            DuskIRValue *inst = insts_arr[j];
+            if (duskIsHoistable(inst) &&
+                (is_entered || duskIsSafeToSpeculate(inst))) {
+                state->is_invariant = true;
+                duskIRForEachOperand(inst, state, duskCheckInvariantOperand);
+                if (state->is_invariant) {
+                    if (!hoisted_arr) {
+                        hoisted_arr = duskArrayCreate(
+                            state->module->allocator, DuskIRValue *);
+                    }
+                    inst->id = pre_header->id;
+                    duskArrayPush(&hoisted_arr, inst);
+                    continue;
+                }
+            }
+            insts_arr[kept_count++] = inst;
+        }
+        duskArrayResize(&block->block.insts_arr, kept_count);
+    }
+
+    size_t hoisted_count = duskArrayLength(hoisted_arr);
+    if (hoisted_count == 0) return;
+
+    // The moved instructions go before the branch to the header, and before
+    // the merge instruction of the pre-header if it is a loop header itself
+    DuskArray(DuskIRValue *) *insts_arr = &pre_header->block.insts_arr;
+    size_t inst_count = duskArrayLength(*insts_arr);
+    size_t insert_index = inst_count - 1;
+    if (insert_index > 0 &&
+        (*insts_arr)[insert_index - 1]->kind == DUSK_IR_VALUE_LOOP_MERGE) {
+        insert_index--;
+    }
+
+    duskArrayResize(insts_arr, inst_count + hoisted_count);
+    memmove(
+        &(*insts_arr)[insert_index + hoisted_count],
+        &(*insts_arr)[insert_index],
+        sizeof(DuskIRValue *) * (inst_count - insert_index));
+    memcpy(
+        &(*insts_arr)[insert_index],
+        hoisted_arr,
+        sizeof(DuskIRValue *) * hoisted_count);
+}
+
+void duskIRHoistLoopInvariants(DuskIRModule *module, DuskIRValue *function)
+{
+    DUSK_ASSERT(function->kind == DUSK_IR_VALUE_FUNCTION);
+    DuskAllocator *allocator = module->allocator;
+
+    DuskIRValue **blocks = function->function.blocks_arr;
+    size_t block_count = duskArrayLength(function->function.blocks_arr);
+
+    for (size_t i = 0; i < block_count; ++i) {
+        blocks[i]->id = (uint32_t)i;
+        DuskArray(DuskIRValue *) insts_arr = blocks[i]->block.insts_arr;
+        for (size_t j = 0; j < duskArrayLength(insts_arr); ++j) {
+            insts_arr[j]->id = (uint32_t)i;
+        }
+    }
+
+    // Blocks are only entered from the blocks before them, except for the
+    // headers of loops, which are also entered from their continue block
+    uint32_t *entry_counts = DUSK_NEW_ARRAY(allocator, uint32_t, block_count);
+    DuskIRValue **entry_blocks =
+        DUSK_NEW_ARRAY(allocator, DuskIRValue *, block_count);
+    for (size_t i = 0; i < block_count; ++i) {
+        DuskIRValue *successors[2];
+        size_t successor_count = 0;
+        duskGetSuccessors(blocks[i], successors, &successor_count);
+        for (size_t j = 0; j < successor_count; ++j) {
+            if (successors[j]->id > i) {
+                entry_counts[successors[j]->id]++;
+                entry_blocks[successors[j]->id] = blocks[i];
+            }
+        }
+    }
+
+    DuskHoistState state_storage = {0};
+    DuskHoistState *state = &state_storage;
+    state->module = module;
+    state->in_loop = DUSK_NEW_ARRAY(allocator, bool, block_count);
+    state->marked_arr = duskArrayCreate(allocator, uint32_t);
+
+    for (size_t i = block_count; i > 0; --i) {
+        DuskIRValue *header = blocks[i - 1];
+
+        DuskIRValue *loop_merge = NULL;
+        DuskArray(DuskIRValue *) insts_arr = header->block.insts_arr;
+        for (size_t j = 0; j < duskArrayLength(insts_arr); ++j) {
+            if (insts_arr[j]->kind == DUSK_IR_VALUE_LOOP_MERGE) {
+                loop_merge = insts_arr[j];
+            }
+        }
+        if (!loop_merge) continue;
+
+        // The instructions are moved to the only block that enters the loop,
+        // which has to branch to it unconditionally
+        if (entry_counts[header->id] != 1) continue;
+        DuskIRValue *pre_header = entry_blocks[header->id];
+        if (duskGetTerminator(pre_header)->kind != DUSK_IR_VALUE_BRANCH) {
+            continue;
+        }
+
+        DuskArray(DuskIRValue *) loop_blocks_arr = duskFindLoopBlocks(
+            allocator,
+            blocks,
+            header,
+            loop_merge->loop_merge.merge_block,
+            state->in_loop,
+            &state->marked_arr);
+        if (!loop_blocks_arr) continue;
+
+        duskHoistLoop(state, loop_blocks_arr, pre_header);
+    }
+}
+// }}}
+
+// Strength reduction {{{
+
+// Integer multiplications, divisions and remainders by powers of two are
+// replaced by shifts and masks, which targets run much faster. Float
+// multiplications by two become additions, and float divisions by powers of
+// two multiplications by the inverse, which give the same results. Unsigned
+// comparisons with zero and one become equality tests.
+//
+// Signed divisions round towards zero while shifts round down, so negative
+// dividends are offset by the divisor minus one before they are shifted,
+// which takes a few instructions that are added before the division.
+
+// Value of the components of an integer constant, if they are all equal
+static bool duskGetSplatInt(DuskIRValue *value, uint64_t *out_int)
+{
+    DuskIRValue *components[4];
+    size_t count = duskFoldGetComponents(value, components);
+    if (count == 0 || components[0]->type->kind != DUSK_TYPE_INT) return false;
+
+    *out_int = duskFoldGetInt(components[0]);
+    for (size_t i = 1; i < count; ++i) {
+        if (duskFoldGetInt(components[i]) != *out_int) return false;
+    }
+    return true;
+}
+
+// Value of the components of a float constant, if they are all equal
+static bool duskGetSplatFloat(DuskIRValue *value, double *out_float)
+{
+    DuskIRValue *components[4];
+    size_t count = duskFoldGetComponents(value, components);
+    if (count == 0 || components[0]->type->kind != DUSK_TYPE_FLOAT) {
+        return false;
+    }
+
+    if (!duskFoldGetFloat(components[0], out_float)) return false;
+    for (size_t i = 1; i < count; ++i) {
+        double float_value;
+        if (!duskFoldGetFloat(components[i], &float_value) ||
+            float_value != *out_float) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Exponent of a power of two greater than one, or 0 if the value isn't one
+static uint32_t duskGetPowerOfTwoExponent(uint64_t value)
+{
+    if (value < 2 || (value & (value - 1)) != 0) return 0;
+
+    uint32_t exponent = 0;
+    while (value > 1) {
+        value >>= 1;
+        exponent++;
+    }
+    return exponent;
+}
+
+static DuskIRValue *
+duskSplatConstant(DuskIRModule *module, DuskType *type, DuskIRValue *scalar)
+{
+    if (type->kind != DUSK_TYPE_VECTOR) return scalar;
+
+    DuskIRValue *components[4];
+    for (uint32_t i = 0; i < type->vector.size; ++i) {
+        components[i] = scalar;
+    }
+    return duskIRConstCompositeCreate(
+        module, type, type->vector.size, components);
+}
+
+static DuskIRValue *
+duskIntConstant(DuskIRModule *module, DuskType *type, uint64_t int_value)
+{
+    DuskIRValue *scalar =
+        duskIRConstIntCreate(module, duskGetScalarType(type), int_value);
+    return duskSplatConstant(module, type, scalar);
+}
+
+// Exponent of the power of two a signed integer division divides by, or 0 if
+// it doesn't divide by one
+static uint32_t duskGetSignedDivisionShift(DuskIRValue *inst)
+{
+    if (inst->kind != DUSK_IR_VALUE_BINARY_OPERATION ||
+        inst->binary.op != DUSK_BINARY_OP_DIV ||
+        inst->binary.left->type != inst->type) {
+        return 0;
+    }
+
+    DuskType *scalar_type = duskGetScalarType(inst->type);
+    if (!scalar_type || scalar_type->kind != DUSK_TYPE_INT ||
+        !scalar_type->int_.is_signed) {
+        return 0;
+    }
+
+    uint64_t divisor;
+    if (!duskGetSplatInt(inst->binary.right, &divisor)) return 0;
+    uint32_t shift = duskGetPowerOfTwoExponent(divisor);
+    return shift < scalar_type->int_.bits - 1 ? shift : 0;
+}
+
+static void
+duskReduceBinary(DuskIRModule *module, DuskIRValue *block, DuskIRValue *inst)
+{
+    // Products with matrices are not commutative, and their operands are not
+    // reduced either
+    DuskType *type = inst->type;
+    DuskType *scalar_type = duskGetScalarType(inst->binary.left->type);
+    if (!scalar_type || type->kind == DUSK_TYPE_MATRIX ||
+        inst->binary.left->type->kind == DUSK_TYPE_MATRIX ||
+        inst->binary.right->type->kind == DUSK_TYPE_MATRIX) {
+        return;
+    }
+
+    // Constant factors and the constants unsigned integers are compared with
+    // are moved to the right
+    DuskBinaryOp mirrored_op = duskMirrorComparison(inst->binary.op);
+    bool is_unsigned =
+        scalar_type->kind == DUSK_TYPE_INT && !scalar_type->int_.is_signed;
+    if ((inst->binary.op == DUSK_BINARY_OP_MUL ||
+         (is_unsigned && mirrored_op != inst->binary.op)) &&
+        duskIRValueIsConstant(inst->binary.left) &&
+        !duskIRValueIsConstant(inst->binary.right)) {
+        DuskIRValue *left = inst->binary.left;
+        inst->binary.op = mirrored_op;
+        inst->binary.left = inst->binary.right;
+        inst->binary.right = left;
+    }
+
+    DuskIRValue *left = inst->binary.left;
+    DuskIRValue *right = inst->binary.right;
+
+    if (scalar_type->kind == DUSK_TYPE_FLOAT) {
+        if (left->type != type) return;
+
+        double float_value;
+        if (!duskGetSplatFloat(right, &float_value)) return;
+
+        if (inst->binary.op == DUSK_BINARY_OP_MUL && float_value == 2.0) {
+            inst->binary.op = DUSK_BINARY_OP_ADD;
+            inst->binary.right = left;
+        } else if (inst->binary.op == DUSK_BINARY_OP_DIV) {
+            int exponent;
+            double inverse = 1.0 / float_value;
+            if (fabs(frexp(float_value, &exponent)) != 0.5 ||
+                !duskFoldIsExactFloat(scalar_type, inverse)) {
+                return;
+            }
+
+            inst->binary.op = DUSK_BINARY_OP_MUL;
+            inst->binary.right = duskSplatConstant(
+                module,
+                right->type,
+                duskIRConstFloatCreate(module, scalar_type, inverse));
+        }
+        return;
+    }
+
+    if (scalar_type->kind != DUSK_TYPE_INT || right->type != left->type) {
+        return;
+    }
+
+    uint64_t int_value;
+    if (!duskGetSplatInt(right, &int_value)) return;
+    uint32_t shift = duskGetPowerOfTwoExponent(int_value);
+    bool is_signed = scalar_type->int_.is_signed;
+
+    switch (inst->binary.op) {
+    case DUSK_BINARY_OP_MUL: {
+        if (shift == 0) break;
+        inst->binary.op = DUSK_BINARY_OP_LSHIFT;
+        inst->binary.right = duskIntConstant(module, type, shift);
+        break;
+    }
+    case DUSK_BINARY_OP_DIV: {
+        if (!is_signed) {
+            if (shift == 0) break;
+            inst->binary.op = DUSK_BINARY_OP_RSHIFT;
+            inst->binary.right = duskIntConstant(module, type, shift);
+            break;
+        }
+
+        shift = duskGetSignedDivisionShift(inst);
+        if (shift == 0) break;
+
+        // The sign is all ones for negative dividends
+        DuskIRValue *sign = duskIRCreateBinaryOperation(
+            module,
+            block,
+            DUSK_BINARY_OP_RSHIFT,
+            type,
+            left,
+            duskIntConstant(module, type, scalar_type->int_.bits - 1));
+        DuskIRValue *offset = duskIRCreateBinaryOperation(
+            module,
+            block,
+            DUSK_BINARY_OP_BITAND,
+            type,
+            sign,
+            duskIntConstant(module, type, int_value - 1));
+        DuskIRValue *offset_left = duskIRCreateBinaryOperation(
+            module, block, DUSK_BINARY_OP_ADD, type, left, offset);
+
+        inst->binary.op = DUSK_BINARY_OP_RSHIFT;
+        inst->binary.left = offset_left;
+        inst->binary.right = duskIntConstant(module, type, shift);
+        break;
+    }
+    case DUSK_BINARY_OP_MOD: {
+        // The result of a signed remainder has the sign of the divisor
+        if (shift == 0 || (is_signed && shift >= scalar_type->int_.bits - 1)) {
+            break;
+        }
+        inst->binary.op = DUSK_BINARY_OP_BITAND;
+        inst->binary.right = duskIntConstant(module, type, int_value - 1);
+        break;
+    }
+    case DUSK_BINARY_OP_LESS:
+    case DUSK_BINARY_OP_LESSEQ:
+    case DUSK_BINARY_OP_GREATER:
+    case DUSK_BINARY_OP_GREATEREQ: {
+        if (is_signed) break;
+
+        DuskBinaryOp op = inst->binary.op;
+        if ((op == DUSK_BINARY_OP_LESS && int_value == 1) ||
+            (op == DUSK_BINARY_OP_LESSEQ && int_value == 0)) {
+            inst->binary.op = DUSK_BINARY_OP_EQ;
+        } else if (
+            (op == DUSK_BINARY_OP_GREATEREQ && int_value == 1) ||
+            (op == DUSK_BINARY_OP_GREATER && int_value == 0)) {
+            inst->binary.op = DUSK_BINARY_OP_NOTEQ;
+        } else {
+            break;
+        }
+        inst->binary.right = duskIntConstant(module, left->type, 0);
+        break;
+    }
+    default: break;
+    }
+}
+
+void duskIRReduceStrength(DuskIRModule *module, DuskIRValue *function)
+{
+    DUSK_ASSERT(function->kind == DUSK_IR_VALUE_FUNCTION);
+    DuskAllocator *allocator = module->allocator;
+
+    for (size_t i = 0; i < duskArrayLength(function->function.blocks_arr);
+         ++i) {
+        DuskIRValue *block = function->function.blocks_arr[i];
+        DuskArray(DuskIRValue *) insts_arr = block->block.insts_arr;
+
+        // Blocks with signed divisions are rebuilt, so the instructions they
+        // are turned into can be appended to them
+        bool is_rebuilt = false;
+        for (size_t j = 0; j < duskArrayLength(insts_arr); ++j) {
+            DuskIRValue *inst = insts_arr[j];
+            if (!is_rebuilt && duskGetSignedDivisionShift(inst) != 0) {
+                is_rebuilt = true;
+                block->block.insts_arr =
+                    duskArrayCreate(allocator, DuskIRValue *);
+                for (size_t k = 0; k < j; ++k) {
+                    duskArrayPush(&block->block.insts_arr, insts_arr[k]);
+                }
+            }
+
+            if (inst->kind == DUSK_IR_VALUE_BINARY_OPERATION) {
+                duskReduceBinary(module, block, inst);
+            }
+            if (is_rebuilt) duskArrayPush(&block->block.insts_arr, inst);
+        }
+    }
+}
+// }}}
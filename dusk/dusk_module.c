@@ -0,0 +1,318 @@
+#include "dusk_internal.h"
+
+// FNV-1a, like the string map, but over a text that isn't null-terminated
+static uint64_t duskHashText(const char *text, size_t text_length)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < text_length; ++i) {
+        hash ^= (uint8_t)text[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static bool duskIsPathSeparator(char c)
+{
+    return c == '/' || c == '\\';
+}
+
+// Reads imports from the file system, relative to the directory of the
+// importing file
+static bool duskReadImportedFile(
+    DuskCompiler *compiler,
+    const char *importer_path,
+    const char *import_path,
+    const char **resolved_path,
+    const char **text,
+    size_t *text_length)
+{
+    DuskAllocator *allocator = duskArenaGetAllocator(compiler->main_arena);
+
+    size_t dir_length = 0;
+    if (importer_path && !duskIsPathSeparator(import_path[0])) {
+        for (size_t i = 0; importer_path[i]; ++i) {
+            if (duskIsPathSeparator(importer_path[i])) dir_length = i + 1;
+        }
+    }
+
+    *resolved_path = duskSprintf(
+        allocator, "%.*s%s", (int)dir_length, importer_path, import_path);
+
+    FILE *f = fopen(*resolved_path, "rb");
+    if (!f) return false;
+
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    if (size < 0) {
+        fclose(f);
+        return false;
+    }
+
+    char *data = (char *)duskAllocate(allocator, (size_t)size);
+    size_t read_size = fread(data, 1, (size_t)size, f);
+    fclose(f);
+
+    if (read_size != (size_t)size) return false;
+
+    *text = data;
+    *text_length = read_size;
+    return true;
+}
+
+static DuskModule *duskLoadModule(
+    DuskCompiler *compiler, const char *importer_path, DuskImport *import);
+
+// Loads the modules of imports_arr, adding them and the modules they import to
+// modules_arr. Returns the scope that holds their declarations.
+static DuskScope *duskLoadModules(
+    DuskCompiler *compiler,
+    const char *importer_path,
+    DuskArray(DuskImport) imports_arr,
+    DuskArray(DuskModule *) * loaded_arr,
+    DuskArray(DuskFile *) * modules_arr)
+{
+    DuskAllocator *allocator = duskArenaGetAllocator(compiler->main_arena);
+
+    DuskScope *parent_scope = NULL;
+    if (compiler->prelude_file) {
+        parent_scope = compiler->prelude_file->scope;
+    }
+
+    if (duskArrayLength(imports_arr) == 0) {
+        return parent_scope;
+    }
+
+    DuskScope *scope = duskScopeCreate(
+        allocator, parent_scope, DUSK_SCOPE_OWNER_TYPE_NONE, 0);
+    DuskMap *added_modules = duskMapCreate(allocator, 16);
+
+    for (size_t i = 0; i < duskArrayLength(imports_arr); ++i) {
+        DuskImport *import = &imports_arr[i];
+        DuskModule *module = duskLoadModule(compiler, importer_path, import);
+        duskArrayPush(loaded_arr, module);
+
+        // The declarations of the modules imported by a module are visible
+        // too, so that names are unique across everything a file can see
+        DuskArray(DuskFile *) files_arr = module->file->modules_arr;
+        size_t file_count = duskArrayLength(files_arr);
+        for (size_t j = 0; j <= file_count; ++j) {
+            DuskFile *file = j < file_count ? files_arr[j] : module->file;
+            if (duskMapGet(added_modules, file->path, NULL)) continue;
+            duskMapSet(added_modules, file->path, file);
+            duskArrayPush(modules_arr, file);
+
+            for (size_t k = 0; k < duskArrayLength(file->decls_arr); ++k) {
+                DuskDeclId decl_id = file->decls_arr[k];
+                DuskDecl *decl = duskDeclGet(compiler, decl_id);
+                DuskDeclId existing_decl_id =
+                    duskScopeLookupLocal(scope, decl->name);
+                if (existing_decl_id && existing_decl_id != decl_id) {
+                    DuskDecl *existing_decl =
+                        duskDeclGet(compiler, existing_decl_id);
+                    duskAddError(
+                        compiler,
+                        import->location,
+                        "duplicate declaration: '%s' is declared in both "
+                        "'%s' and '%s'",
+                        decl->name,
+                        existing_decl->location.file->path,
+                        file->path);
+                    continue;
+                }
+                duskScopeSet(scope, decl->name, decl_id);
+            }
+        }
+    }
+
+    if (duskArrayLength(compiler->errors_arr) > 0) {
+        duskThrow(compiler);
+    }
+
+    return scope;
+}
+
+static DuskScope *duskLoadFileImports(
+    DuskCompiler *compiler,
+    DuskFile *file,
+    DuskArray(DuskModule *) * loaded_arr)
+{
+    DuskAllocator *allocator = duskArenaGetAllocator(compiler->main_arena);
+
+    file->modules_arr = duskArrayCreate(allocator, DuskFile *);
+    return duskLoadModules(
+        compiler,
+        file->path,
+        file->imports_arr,
+        loaded_arr,
+        &file->modules_arr);
+}
+
+void duskLoadImports(DuskCompiler *compiler, DuskFile *file)
+{
+    DuskAllocator *allocator = duskArenaGetAllocator(compiler->main_arena);
+
+    DuskArray(DuskModule *) loaded_arr =
+        duskArrayCreate(allocator, DuskModule *);
+    file->scope->parent = duskLoadFileImports(compiler, file, &loaded_arr);
+}
+
+// The hash of a module also covers the modules it imports, as its analysis
+// depends on them
+static uint64_t duskHashModule(
+    uint64_t text_hash, DuskArray(DuskModule *) loaded_arr)
+{
+    uint64_t hash = text_hash;
+    for (size_t i = 0; i < duskArrayLength(loaded_arr); ++i) {
+        hash ^= loaded_arr[i]->hash;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static DuskFile *duskAnalyzeModule(
+    DuskCompiler *compiler,
+    const char *path,
+    const char *text,
+    size_t text_length,
+    DuskArray(DuskModule *) * loaded_arr)
+{
+    DuskAllocator *allocator = duskArenaGetAllocator(compiler->main_arena);
+
+    DuskFile *file = DUSK_NEW(allocator, DuskFile);
+    *file = (DuskFile){
+        .path = path,
+        .text = text,
+        .text_length = text_length,
+        .decls_arr = duskArrayCreate(allocator, DuskDeclId),
+        .decl_extents_arr = duskArrayCreate(allocator, DuskDeclExtent),
+        .scope =
+            duskScopeCreate(allocator, NULL, DUSK_SCOPE_OWNER_TYPE_NONE, 0),
+    };
+
+    duskParse(compiler, file);
+    file->scope->parent = duskLoadFileImports(compiler, file, loaded_arr);
+    duskAnalyzeFile(compiler, file);
+
+    for (size_t i = 0; i < duskArrayLength(file->decls_arr); ++i) {
+        DuskDecl *decl = duskDeclGet(compiler, file->decls_arr[i]);
+        if (decl->kind == DUSK_DECL_FUNCTION && decl->function.is_entry_point) {
+            duskAddError(
+                compiler,
+                decl->location,
+                "entry points are not allowed in an imported module");
+        }
+    }
+
+    if (duskArrayLength(compiler->errors_arr) > 0) {
+        duskThrow(compiler);
+    }
+
+    return file;
+}
+
+// Loads a module from the cache if neither it nor the modules it imports
+// changed since it was analyzed. Returns false otherwise.
+static bool duskLoadCachedModule(DuskCompiler *compiler, DuskModule *module)
+{
+    DuskAllocator *allocator = duskArenaGetAllocator(compiler->main_arena);
+
+    DuskArray(DuskModule *) loaded_arr =
+        duskArrayCreate(allocator, DuskModule *);
+    DuskArray(DuskFile *) modules_arr = duskArrayCreate(allocator, DuskFile *);
+    DuskScope *parent_scope = duskLoadModules(
+        compiler, module->path, module->imports_arr, &loaded_arr, &modules_arr);
+
+    if (duskHashModule(module->text_hash, loaded_arr) != module->hash) {
+        return false;
+    }
+
+    DuskFile *file = duskPreludeRead(
+        compiler, module->blob, module->blob_byte_size, parent_scope);
+    if (!file) return false;
+
+    file->imports_arr = module->imports_arr;
+    file->modules_arr = modules_arr;
+    module->file = file;
+    return true;
+}
+
+static DuskModule *duskLoadModule(
+    DuskCompiler *compiler, const char *importer_path, DuskImport *import)
+{
+    DuskAllocator *allocator = duskArenaGetAllocator(compiler->main_arena);
+
+    const char *resolved_path = NULL;
+    const char *text = NULL;
+    size_t text_length = 0;
+    bool found = false;
+    if (compiler->import_callback) {
+        found = compiler->import_callback(
+            compiler->import_user_data,
+            importer_path,
+            import->path,
+            &resolved_path,
+            &text,
+            &text_length);
+        if (found) resolved_path = duskStrdup(allocator, resolved_path);
+    } else {
+        found = duskReadImportedFile(
+            compiler,
+            importer_path,
+            import->path,
+            &resolved_path,
+            &text,
+            &text_length);
+    }
+
+    if (!found) {
+        duskAddError(
+            compiler,
+            import->location,
+            "could not find imported file: '%s'",
+            import->path);
+        duskThrow(compiler);
+    }
+
+    DuskModule *module = NULL;
+    if (duskMapGet(compiler->loaded_modules, resolved_path, (void **)&module)) {
+        if (!module) {
+            duskAddError(
+                compiler,
+                import->location,
+                "import cycle: '%s' ends up importing itself",
+                resolved_path);
+            duskThrow(compiler);
+        }
+        return module;
+    }
+
+    duskMapSet(compiler->loaded_modules, resolved_path, NULL);
+
+    uint64_t text_hash = duskHashText(text, text_length);
+
+    module = NULL;
+    duskMapGet(compiler->module_cache, resolved_path, (void **)&module);
+    if (!module || module->text_hash != text_hash ||
+        !duskLoadCachedModule(compiler, module)) {
+        DuskArray(DuskModule *) loaded_arr =
+            duskArrayCreate(allocator, DuskModule *);
+        DuskFile *file = duskAnalyzeModule(
+            compiler, resolved_path, text, text_length, &loaded_arr);
+
+        module = DUSK_NEW(allocator, DuskModule);
+        *module = (DuskModule){
+            .path = resolved_path,
+            .text_hash = text_hash,
+            .hash = duskHashModule(text_hash, loaded_arr),
+            .imports_arr = file->imports_arr,
+            .file = file,
+        };
+        module->blob =
+            duskPreludeWrite(compiler, file, &module->blob_byte_size);
+        duskMapSet(compiler->module_cache, resolved_path, module);
+    }
+
+    duskMapSet(compiler->loaded_modules, resolved_path, module);
+    return module;
+}
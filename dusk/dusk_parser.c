@@ -450,9 +450,9 @@ begin:
             break;
     }
 
-    token->location.offset = state.pos;
-    token->location.line = state.line;
-    token->location.col = state.col;
+    token->location.offset = (uint32_t)state.pos;
+    token->location.line = (uint32_t)state.line;
+    token->location.col = (uint32_t)state.col;
     token->location.length = 1;
     token->location.file = state.file;
 
@@ -857,7 +857,7 @@ begin:
     }
     }
 
-    token->location.length = state.pos - token->location.offset;
+    token->location.length = (uint32_t)(state.pos - token->location.offset);
     state.col += token->location.length;
 
     return state;
@@ -882,7 +882,7 @@ static DuskToken consumeToken(
     return token;
 }
 
-static DuskExpr *
+static DuskExprId
 parseExpr(DuskCompiler *compiler, TokenizerState *state, bool only_types);
 
 static void parseAttributes(
@@ -917,6 +917,14 @@ static void parseAttributes(
                 attrib.kind = DUSK_ATTRIBUTE_OFFSET;
             } else if (strcmp(attrib_name_token.str, "read_only") == 0) {
                 attrib.kind = DUSK_ATTRIBUTE_READ_ONLY;
+            } else if (strcmp(attrib_name_token.str, "inline") == 0) {
+                attrib.kind = DUSK_ATTRIBUTE_INLINE;
+            } else if (strcmp(attrib_name_token.str, "noinline") == 0) {
+                attrib.kind = DUSK_ATTRIBUTE_NOINLINE;
+            } else if (strcmp(attrib_name_token.str, "unroll") == 0) {
+                attrib.kind = DUSK_ATTRIBUTE_UNROLL;
+            } else if (strcmp(attrib_name_token.str, "dont_unroll") == 0) {
+                attrib.kind = DUSK_ATTRIBUTE_DONT_UNROLL;
             } else {
                 duskAddError(
                     compiler,
@@ -925,15 +933,15 @@ static void parseAttributes(
                     attrib_name_token.str);
             }
             attrib.name = attrib_name_token.str;
-            DuskArray(DuskExpr *) value_exprs =
-                duskArrayCreate(allocator, DuskExpr *);
+            DuskArray(DuskExprId) value_exprs =
+                duskArrayCreate(allocator, DuskExprId);
 
             tokenizerNextToken(compiler, *state, &next_token);
             if (next_token.type == DUSK_TOKEN_LPAREN) {
                 consumeToken(compiler, state, DUSK_TOKEN_LPAREN);
 
                 while (next_token.type != DUSK_TOKEN_RPAREN) {
-                    DuskExpr *value_expr = parseExpr(compiler, state, false);
+                    DuskExprId value_expr = parseExpr(compiler, state, false);
                     duskArrayPush(&value_exprs, value_expr);
 
                     tokenizerNextToken(compiler, *state, &next_token);
@@ -955,11 +963,11 @@ static void parseAttributes(
 
             attrib.value_expr_count = duskArrayLength(value_exprs);
             attrib.value_exprs =
-                DUSK_NEW_ARRAY(allocator, DuskExpr *, attrib.value_expr_count);
+                DUSK_NEW_ARRAY(allocator, DuskExprId, attrib.value_expr_count);
             memcpy(
                 attrib.value_exprs,
                 value_exprs,
-                attrib.value_expr_count * sizeof(DuskExpr *));
+                attrib.value_expr_count * sizeof(DuskExprId));
 
             duskArrayPush(attributes, attrib);
         }
@@ -998,11 +1006,13 @@ parseStorageClass(DuskCompiler *compiler, TokenizerState *state)
     return storage_class;
 }
 
-static DuskExpr *parsePrimaryExpr(DuskCompiler *compiler, TokenizerState *state)
+static DuskExprId
+parsePrimaryExpr(DuskCompiler *compiler, TokenizerState *state)
 {
     DuskAllocator *allocator = duskArenaGetAllocator(compiler->main_arena);
 
-    DuskExpr *expr = DUSK_NEW(allocator, DuskExpr);
+    DuskExprId expr_id = duskExprCreate(compiler);
+    DuskExpr *expr = duskExprGet(compiler, expr_id);
 
     DuskToken token = {0};
     *state = tokenizerNextToken(compiler, *state, &token);
@@ -1544,7 +1554,7 @@ static DuskExpr *parsePrimaryExpr(DuskCompiler *compiler, TokenizerState *state)
         break;
     }
     case DUSK_TOKEN_LPAREN: {
-        expr = parseExpr(compiler, state, false);
+        expr_id = parseExpr(compiler, state, false);
         consumeToken(compiler, state, DUSK_TOKEN_RPAREN);
         break;
     }
@@ -1569,7 +1579,7 @@ static DuskExpr *parsePrimaryExpr(DuskCompiler *compiler, TokenizerState *state)
 
         DuskStorageClass storage_class = parseStorageClass(compiler, state);
         consumeToken(compiler, state, DUSK_TOKEN_COMMA);
-        DuskExpr *sub_type_expr = parseExpr(compiler, state, true);
+        DuskExprId sub_type_expr = parseExpr(compiler, state, true);
 
         uint16_t alignment = 0;
         if (storage_class == DUSK_STORAGE_CLASS_PHYSICAL_STORAGE) {
@@ -1597,8 +1607,8 @@ static DuskExpr *parsePrimaryExpr(DuskCompiler *compiler, TokenizerState *state)
 
         DuskArray(const char *) params =
             duskArrayCreate(allocator, const char *);
-        DuskArray(DuskExpr *) field_type_exprs =
-            duskArrayCreate(allocator, DuskExpr *);
+        DuskArray(DuskExprId) field_type_exprs =
+            duskArrayCreate(allocator, DuskExprId);
         DuskArray(const char *) field_names =
             duskArrayCreate(allocator, const char *);
         DuskArray(DuskArray(DuskAttribute)) field_attribute_arrays =
@@ -1636,7 +1646,7 @@ static DuskExpr *parsePrimaryExpr(DuskCompiler *compiler, TokenizerState *state)
                 consumeToken(compiler, state, DUSK_TOKEN_IDENT);
             consumeToken(compiler, state, DUSK_TOKEN_COLON);
 
-            DuskExpr *type_expr = parseExpr(compiler, state, true);
+            DuskExprId type_expr = parseExpr(compiler, state, true);
 
             duskArrayPush(&field_type_exprs, type_expr);
             duskArrayPush(&field_names, field_name_token.str);
@@ -1649,44 +1659,47 @@ static DuskExpr *parsePrimaryExpr(DuskCompiler *compiler, TokenizerState *state)
             }
         }
 
-        expr->struct_type.field_count = duskArrayLength(field_type_exprs);
-        expr->struct_type.param_count = duskArrayLength(params);
-
-        expr->struct_type.params = DUSK_NEW_ARRAY(
-            allocator, const char *, expr->struct_type.param_count);
-        expr->struct_type.field_names = DUSK_NEW_ARRAY(
-            allocator, const char *, expr->struct_type.field_count);
-        expr->struct_type.field_type_exprs = DUSK_NEW_ARRAY(
-            allocator, DuskExpr *, expr->struct_type.field_count);
-        expr->struct_type.field_attribute_arrays = DUSK_NEW_ARRAY(
-            allocator, DuskArray(DuskAttribute), expr->struct_type.field_count);
+        expr->struct_type = DUSK_NEW(allocator, DuskStructTypeExpr);
+        expr->struct_type->field_count = duskArrayLength(field_type_exprs);
+        expr->struct_type->param_count = duskArrayLength(params);
+
+        expr->struct_type->params = DUSK_NEW_ARRAY(
+            allocator, const char *, expr->struct_type->param_count);
+        expr->struct_type->field_names = DUSK_NEW_ARRAY(
+            allocator, const char *, expr->struct_type->field_count);
+        expr->struct_type->field_type_exprs = DUSK_NEW_ARRAY(
+            allocator, DuskExprId, expr->struct_type->field_count);
+        expr->struct_type->field_attribute_arrays = DUSK_NEW_ARRAY(
+            allocator,
+            DuskArray(DuskAttribute),
+            expr->struct_type->field_count);
 
         memcpy(
-            expr->struct_type.params,
+            expr->struct_type->params,
             params,
-            expr->struct_type.param_count * sizeof(const char *));
+            expr->struct_type->param_count * sizeof(const char *));
 
         memcpy(
-            expr->struct_type.field_names,
+            expr->struct_type->field_names,
             field_names,
-            expr->struct_type.field_count * sizeof(const char *));
+            expr->struct_type->field_count * sizeof(const char *));
 
         memcpy(
-            expr->struct_type.field_type_exprs,
+            expr->struct_type->field_type_exprs,
             field_type_exprs,
-            expr->struct_type.field_count * sizeof(DuskExpr *));
+            expr->struct_type->field_count * sizeof(DuskExprId));
 
         memcpy(
-            expr->struct_type.field_attribute_arrays,
+            expr->struct_type->field_attribute_arrays,
             field_attribute_arrays,
-            expr->struct_type.field_count * sizeof(DuskArray(DuskAttribute)));
+            expr->struct_type->field_count * sizeof(DuskArray(DuskAttribute)));
 
         consumeToken(compiler, state, DUSK_TOKEN_RCURLY);
         break;
     }
     case DUSK_TOKEN_BUILTIN_IDENT: {
         expr->kind = DUSK_EXPR_BUILTIN_FUNCTION_CALL;
-        expr->builtin_call.params_arr = duskArrayCreate(allocator, DuskExpr *);
+        expr->builtin_call.params_arr = duskArrayCreate(allocator, DuskExprId);
 
         uintptr_t builtin_function_type = 0;
         if (duskMapGet(
@@ -1708,7 +1721,7 @@ static DuskExpr *parsePrimaryExpr(DuskCompiler *compiler, TokenizerState *state)
         DuskToken next_token = {0};
         tokenizerNextToken(compiler, *state, &next_token);
         while (next_token.type != DUSK_TOKEN_RPAREN) {
-            DuskExpr *param_expr = parseExpr(compiler, state, false);
+            DuskExprId param_expr = parseExpr(compiler, state, false);
             duskArrayPush(&expr->builtin_call.params_arr, param_expr);
 
             tokenizerNextToken(compiler, *state, &next_token);
@@ -1732,16 +1745,16 @@ static DuskExpr *parsePrimaryExpr(DuskCompiler *compiler, TokenizerState *state)
     }
     }
 
-    return expr;
+    return expr_id;
 }
 
-static DuskExpr *parseAccessOrFunctionCallExpr(
+static DuskExprId parseAccessOrFunctionCallExpr(
     DuskCompiler *compiler, TokenizerState *state, bool only_types)
 {
     DuskAllocator *allocator = duskArenaGetAllocator(compiler->main_arena);
 
-    DuskExpr *expr = parsePrimaryExpr(compiler, state);
-    DUSK_ASSERT(expr);
+    DuskExprId expr_id = parsePrimaryExpr(compiler, state);
+    DUSK_ASSERT(expr_id);
 
     DuskToken next_token = {0};
     TokenizerState next_state =
@@ -1753,19 +1766,20 @@ static DuskExpr *parseAccessOrFunctionCallExpr(
            next_token.type == DUSK_TOKEN_DOT) {
         if (next_token.type == DUSK_TOKEN_LPAREN) {
             // Function call expression
-            DuskExpr *func_expr = expr;
-            expr = DUSK_NEW(allocator, DuskExpr);
-            expr->location = func_expr->location;
+            DuskExprId func_expr = expr_id;
+            expr_id = duskExprCreate(compiler);
+            DuskExpr *expr = duskExprGet(compiler, expr_id);
+            expr->location = duskExprGet(compiler, func_expr)->location;
             expr->kind = DUSK_EXPR_FUNCTION_CALL;
             expr->function_call.func_expr = func_expr;
             expr->function_call.params_arr =
-                duskArrayCreate(allocator, DuskExpr *);
+                duskArrayCreate(allocator, DuskExprId);
 
             consumeToken(compiler, state, DUSK_TOKEN_LPAREN);
 
             tokenizerNextToken(compiler, *state, &next_token);
             while (next_token.type != DUSK_TOKEN_RPAREN) {
-                DuskExpr *param_expr = parseExpr(compiler, state, false);
+                DuskExprId param_expr = parseExpr(compiler, state, false);
                 duskArrayPush(&expr->function_call.params_arr, param_expr);
 
                 tokenizerNextToken(compiler, *state, &next_token);
@@ -1779,12 +1793,13 @@ static DuskExpr *parseAccessOrFunctionCallExpr(
         } else if (next_token.type == DUSK_TOKEN_DOT) {
             // Access expr
             tokenizerNextToken(compiler, next_state, &next_token);
-            DuskExpr *base_expr = expr;
-            expr = DUSK_NEW(allocator, DuskExpr);
-            expr->location = base_expr->location;
+            DuskExprId base_expr = expr_id;
+            expr_id = duskExprCreate(compiler);
+            DuskExpr *expr = duskExprGet(compiler, expr_id);
+            expr->location = duskExprGet(compiler, base_expr)->location;
             expr->kind = DUSK_EXPR_ACCESS;
             expr->access.base_expr = base_expr;
-            expr->access.chain_arr = duskArrayCreate(allocator, DuskExpr *);
+            expr->access.chain_arr = duskArrayCreate(allocator, DuskExprId);
 
             tokenizerNextToken(compiler, *state, &next_token);
             while (next_token.type == DUSK_TOKEN_DOT) {
@@ -1793,29 +1808,31 @@ static DuskExpr *parseAccessOrFunctionCallExpr(
                 DuskToken ident_token =
                     consumeToken(compiler, state, DUSK_TOKEN_IDENT);
 
-                DuskExpr *ident_expr = DUSK_NEW(allocator, DuskExpr);
+                DuskExprId ident_expr_id = duskExprCreate(compiler);
+                DuskExpr *ident_expr = duskExprGet(compiler, ident_expr_id);
                 ident_expr->location = ident_token.location;
                 ident_expr->kind = DUSK_EXPR_IDENT;
                 ident_expr->identifier.str = ident_token.str;
 
-                duskArrayPush(&expr->access.chain_arr, ident_expr);
+                duskArrayPush(&expr->access.chain_arr, ident_expr_id);
 
                 tokenizerNextToken(compiler, *state, &next_token);
             }
         } else if (next_token.type == DUSK_TOKEN_LBRACKET) {
             // Array access expression
-            DuskExpr *base_expr = expr;
-            expr = DUSK_NEW(allocator, DuskExpr);
-            expr->location = base_expr->location;
+            DuskExprId base_expr = expr_id;
+            expr_id = duskExprCreate(compiler);
+            DuskExpr *expr = duskExprGet(compiler, expr_id);
+            expr->location = duskExprGet(compiler, base_expr)->location;
             expr->kind = DUSK_EXPR_ARRAY_ACCESS;
             expr->access.base_expr = base_expr;
-            expr->access.chain_arr = duskArrayCreate(allocator, DuskExpr *);
+            expr->access.chain_arr = duskArrayCreate(allocator, DuskExprId);
 
             tokenizerNextToken(compiler, *state, &next_token);
             while (next_token.type == DUSK_TOKEN_LBRACKET) {
                 consumeToken(compiler, state, DUSK_TOKEN_LBRACKET);
 
-                DuskExpr *index_expr = parseExpr(compiler, state, false);
+                DuskExprId index_expr = parseExpr(compiler, state, false);
 
                 duskArrayPush(&expr->access.chain_arr, index_expr);
 
@@ -1827,9 +1844,10 @@ static DuskExpr *parseAccessOrFunctionCallExpr(
             // Struct/array literal
             consumeToken(compiler, state, DUSK_TOKEN_LCURLY);
 
-            DuskExpr *type_expr = expr;
-            expr = DUSK_NEW(allocator, DuskExpr);
-            expr->location = type_expr->location;
+            DuskExprId type_expr = expr_id;
+            expr_id = duskExprCreate(compiler);
+            DuskExpr *expr = duskExprGet(compiler, expr_id);
+            expr->location = duskExprGet(compiler, type_expr)->location;
 
             tokenizerNextToken(compiler, *state, &next_token);
             if (next_token.type == DUSK_TOKEN_DOT) {
@@ -1840,7 +1858,7 @@ static DuskExpr *parseAccessOrFunctionCallExpr(
                 expr->struct_literal.field_names_arr =
                     duskArrayCreate(allocator, const char *);
                 expr->struct_literal.field_values_arr =
-                    duskArrayCreate(allocator, DuskExpr *);
+                    duskArrayCreate(allocator, DuskExprId);
 
                 tokenizerNextToken(compiler, *state, &next_token);
                 while (next_token.type != DUSK_TOKEN_RCURLY) {
@@ -1848,7 +1866,7 @@ static DuskExpr *parseAccessOrFunctionCallExpr(
                     DuskToken ident_token =
                         consumeToken(compiler, state, DUSK_TOKEN_IDENT);
                     consumeToken(compiler, state, DUSK_TOKEN_ASSIGN);
-                    DuskExpr *field_value_expr =
+                    DuskExprId field_value_expr =
                         parseExpr(compiler, state, false);
 
                     duskArrayPush(
@@ -1869,11 +1887,11 @@ static DuskExpr *parseAccessOrFunctionCallExpr(
                 expr->kind = DUSK_EXPR_ARRAY_LITERAL;
                 expr->array_literal.type_expr = type_expr;
                 expr->array_literal.field_values_arr =
-                    duskArrayCreate(allocator, DuskExpr *);
+                    duskArrayCreate(allocator, DuskExprId);
 
                 tokenizerNextToken(compiler, *state, &next_token);
                 while (next_token.type != DUSK_TOKEN_RCURLY) {
-                    DuskExpr *field_value_expr =
+                    DuskExprId field_value_expr =
                         parseExpr(compiler, state, false);
 
                     duskArrayPush(
@@ -1894,14 +1912,13 @@ static DuskExpr *parseAccessOrFunctionCallExpr(
         next_state = tokenizerNextToken(compiler, *state, &next_token);
     }
 
-    return expr;
+    return expr_id;
 }
 
-static DuskExpr *
+static DuskExprId
 parseUnaryExpr(DuskCompiler *compiler, TokenizerState *state, bool only_types)
 {
-    DuskAllocator *allocator = duskArenaGetAllocator(compiler->main_arena);
-
+    DuskExprId expr_id = 0;
     DuskExpr *expr = NULL;
 
     DuskToken next_token = {0};
@@ -1919,15 +1936,18 @@ parseUnaryExpr(DuskCompiler *compiler, TokenizerState *state, bool only_types)
         default: DUSK_ASSERT(0); break;
         }
 
-        DuskExpr *new_expr = DUSK_NEW(allocator, DuskExpr);
+        DuskExprId new_expr_id = duskExprCreate(compiler);
+        DuskExpr *new_expr = duskExprGet(compiler, new_expr_id);
         new_expr->location = next_token.location;
         new_expr->kind = DUSK_EXPR_UNARY;
         new_expr->unary.op = op;
-        new_expr->unary.right = NULL;
+        new_expr->unary.right = 0;
 
         if (expr) {
             DUSK_ASSERT(expr->kind == DUSK_EXPR_UNARY);
-            expr->unary.right = new_expr;
+            expr->unary.right = new_expr_id;
+        } else {
+            expr_id = new_expr_id;
         }
 
         expr = new_expr;
@@ -1936,14 +1956,14 @@ parseUnaryExpr(DuskCompiler *compiler, TokenizerState *state, bool only_types)
     }
 
     if (!expr) {
-        expr = parseAccessOrFunctionCallExpr(compiler, state, only_types);
+        expr_id = parseAccessOrFunctionCallExpr(compiler, state, only_types);
     } else {
         DUSK_ASSERT(expr->kind == DUSK_EXPR_UNARY);
         expr->unary.right =
             parseAccessOrFunctionCallExpr(compiler, state, only_types);
     }
 
-    return expr;
+    return expr_id;
 }
 
 typedef struct {
@@ -1952,17 +1972,17 @@ typedef struct {
         DUSK_BINARY_OP_SYMBOL_OPERATOR,
     } kind;
     union {
-        DuskExpr *expr;
+        DuskExprId expr;
         DuskBinaryOp op;
     };
 } DuskBinaryOpSymbol;
 
-static DuskExpr *
+static DuskExprId
 parseBinaryExpr(DuskCompiler *compiler, TokenizerState *state, bool only_types)
 {
     DuskAllocator *allocator = duskArenaGetAllocator(compiler->main_arena);
 
-    DuskExpr *expr = parseUnaryExpr(compiler, state, only_types);
+    DuskExprId expr = parseUnaryExpr(compiler, state, only_types);
     DUSK_ASSERT(expr);
 
     DuskToken next_token = {0};
@@ -2080,7 +2100,7 @@ parseBinaryExpr(DuskCompiler *compiler, TokenizerState *state, bool only_types)
 
         duskArrayPush(&op_stack_arr, op);
 
-        DuskExpr *right_expr = parseUnaryExpr(compiler, state, only_types);
+        DuskExprId right_expr = parseUnaryExpr(compiler, state, only_types);
 
         {
             DuskBinaryOpSymbol expr_symbol = {0};
@@ -2103,28 +2123,29 @@ parseBinaryExpr(DuskCompiler *compiler, TokenizerState *state, bool only_types)
         duskArrayPush(&symbol_queue_arr, op_symbol);
     }
 
-    DuskArray(DuskExpr *) expr_stack_arr =
-        duskArrayCreate(allocator, DuskExpr *);
+    DuskArray(DuskExprId) expr_stack_arr =
+        duskArrayCreate(allocator, DuskExprId);
 
     for (size_t i = 0; i < duskArrayLength(symbol_queue_arr); ++i) {
         DuskBinaryOpSymbol symbol = symbol_queue_arr[i];
         if (symbol.kind == DUSK_BINARY_OP_SYMBOL_OPERATOR) {
             DUSK_ASSERT(duskArrayLength(expr_stack_arr) >= 2);
-            DuskExpr *right_expr =
+            DuskExprId right_expr =
                 expr_stack_arr[duskArrayLength(expr_stack_arr) - 1];
-            DuskExpr *left_expr =
+            DuskExprId left_expr =
                 expr_stack_arr[duskArrayLength(expr_stack_arr) - 2];
             duskArrayPop(&expr_stack_arr);
             duskArrayPop(&expr_stack_arr);
 
-            DuskExpr *bin_expr = DUSK_NEW(allocator, DuskExpr);
+            DuskExprId bin_expr_id = duskExprCreate(compiler);
+            DuskExpr *bin_expr = duskExprGet(compiler, bin_expr_id);
             bin_expr->kind = DUSK_EXPR_BINARY;
-            bin_expr->location = left_expr->location;
+            bin_expr->location = duskExprGet(compiler, left_expr)->location;
             bin_expr->binary.op = symbol.op;
             bin_expr->binary.left = left_expr;
             bin_expr->binary.right = right_expr;
 
-            duskArrayPush(&expr_stack_arr, bin_expr);
+            duskArrayPush(&expr_stack_arr, bin_expr_id);
         } else {
             duskArrayPush(&expr_stack_arr, symbol.expr);
         }
@@ -2135,17 +2156,47 @@ parseBinaryExpr(DuskCompiler *compiler, TokenizerState *state, bool only_types)
     return expr_stack_arr[duskArrayLength(expr_stack_arr) - 1];
 }
 
-static DuskExpr *
+static DuskExprId
 parseExpr(DuskCompiler *compiler, TokenizerState *state, bool only_types)
 {
     return parseBinaryExpr(compiler, state, only_types);
 }
 
-static DuskStmt *parseStmt(DuskCompiler *compiler, TokenizerState *state)
+// Parses "const NAME [: TYPE] = VALUE;", both at the top level and inside of
+// functions
+static void
+parseConstDecl(DuskCompiler *compiler, TokenizerState *state, DuskDecl *decl)
+{
+    consumeToken(compiler, state, DUSK_TOKEN_CONST);
+
+    DuskToken name_token = consumeToken(compiler, state, DUSK_TOKEN_IDENT);
+
+    DuskExprId type_expr = 0;
+
+    DuskToken next_token = {0};
+    tokenizerNextToken(compiler, *state, &next_token);
+    if (next_token.type == DUSK_TOKEN_COLON) {
+        consumeToken(compiler, state, DUSK_TOKEN_COLON);
+        type_expr = parseExpr(compiler, state, true);
+    }
+
+    consumeToken(compiler, state, DUSK_TOKEN_ASSIGN);
+    DuskExprId value_expr = parseExpr(compiler, state, false);
+
+    decl->kind = DUSK_DECL_CONST;
+    decl->name = name_token.str;
+    decl->const_.type_expr = type_expr;
+    decl->const_.value_expr = value_expr;
+
+    consumeToken(compiler, state, DUSK_TOKEN_SEMICOLON);
+}
+
+static DuskStmtId parseStmt(DuskCompiler *compiler, TokenizerState *state)
 {
     DuskAllocator *allocator = duskArenaGetAllocator(compiler->main_arena);
 
-    DuskStmt *stmt = DUSK_NEW(allocator, DuskStmt);
+    DuskStmtId stmt_id = duskStmtCreate(compiler);
+    DuskStmt *stmt = duskStmtGet(compiler, stmt_id);
 
     DuskToken next_token = {0};
     tokenizerNextToken(compiler, *state, &next_token);
@@ -2155,12 +2206,13 @@ static DuskStmt *parseStmt(DuskCompiler *compiler, TokenizerState *state)
     case DUSK_TOKEN_VAR: {
         consumeToken(compiler, state, DUSK_TOKEN_VAR);
 
-        DuskDecl *decl = DUSK_NEW(allocator, DuskDecl);
+        DuskDeclId decl_id = duskDeclCreate(compiler);
+        DuskDecl *decl = duskDeclGet(compiler, decl_id);
 
         DuskToken name_token = consumeToken(compiler, state, DUSK_TOKEN_IDENT);
 
-        DuskExpr *value_expr = NULL;
-        DuskExpr *type_expr = NULL;
+        DuskExprId value_expr = 0;
+        DuskExprId type_expr = 0;
 
         tokenizerNextToken(compiler, *state, &next_token);
         if (next_token.type == DUSK_TOKEN_COLON) {
@@ -2182,21 +2234,32 @@ static DuskStmt *parseStmt(DuskCompiler *compiler, TokenizerState *state)
         decl->var.value_expr = value_expr;
 
         stmt->kind = DUSK_STMT_DECL;
-        stmt->decl = decl;
+        stmt->decl = decl_id;
 
         consumeToken(compiler, state, DUSK_TOKEN_SEMICOLON);
         break;
     }
 
+    case DUSK_TOKEN_CONST: {
+        DuskDeclId decl_id = duskDeclCreate(compiler);
+        DuskDecl *decl = duskDeclGet(compiler, decl_id);
+        decl->location = stmt->location;
+        parseConstDecl(compiler, state, decl);
+
+        stmt->kind = DUSK_STMT_DECL;
+        stmt->decl = decl_id;
+        break;
+    }
+
     case DUSK_TOKEN_LCURLY: {
         stmt->kind = DUSK_STMT_BLOCK;
-        stmt->block.stmts_arr = duskArrayCreate(allocator, DuskStmt *);
+        stmt->block.stmts_arr = duskArrayCreate(allocator, DuskStmtId);
 
         consumeToken(compiler, state, DUSK_TOKEN_LCURLY);
 
         tokenizerNextToken(compiler, *state, &next_token);
         while (next_token.type != DUSK_TOKEN_RCURLY) {
-            DuskStmt *sub_stmt = parseStmt(compiler, state);
+            DuskStmtId sub_stmt = parseStmt(compiler, state);
             duskArrayPush(&stmt->block.stmts_arr, sub_stmt);
 
             tokenizerNextToken(compiler, *state, &next_token);
@@ -2208,7 +2271,7 @@ static DuskStmt *parseStmt(DuskCompiler *compiler, TokenizerState *state)
 
     case DUSK_TOKEN_RETURN: {
         stmt->kind = DUSK_STMT_RETURN;
-        stmt->return_.expr = NULL;
+        stmt->return_.expr = 0;
 
         consumeToken(compiler, state, DUSK_TOKEN_RETURN);
 
@@ -2237,7 +2300,7 @@ static DuskStmt *parseStmt(DuskCompiler *compiler, TokenizerState *state)
         consumeToken(compiler, state, DUSK_TOKEN_RPAREN);
 
         stmt->if_.true_stmt = parseStmt(compiler, state);
-        stmt->if_.false_stmt = NULL;
+        stmt->if_.false_stmt = 0;
 
         tokenizerNextToken(compiler, *state, &next_token);
         if (next_token.type == DUSK_TOKEN_ELSE) {
@@ -2247,9 +2310,14 @@ static DuskStmt *parseStmt(DuskCompiler *compiler, TokenizerState *state)
         break;
     }
 
+    // Loops are the only statements with attributes
+    case DUSK_TOKEN_LBRACKET:
     case DUSK_TOKEN_WHILE: {
         stmt->kind = DUSK_STMT_WHILE;
 
+        stmt->while_.attributes_arr = duskArrayCreate(allocator, DuskAttribute);
+        parseAttributes(compiler, state, &stmt->while_.attributes_arr);
+
         consumeToken(compiler, state, DUSK_TOKEN_WHILE);
         consumeToken(compiler, state, DUSK_TOKEN_LPAREN);
         stmt->while_.cond_expr = parseExpr(compiler, state, false);
@@ -2275,14 +2343,14 @@ static DuskStmt *parseStmt(DuskCompiler *compiler, TokenizerState *state)
     }
 
     default: {
-        DuskExpr *expr = parseExpr(compiler, state, false);
+        DuskExprId expr = parseExpr(compiler, state, false);
 
         tokenizerNextToken(compiler, *state, &next_token);
         switch (next_token.type) {
         case DUSK_TOKEN_ASSIGN: {
             consumeToken(compiler, state, DUSK_TOKEN_ASSIGN);
 
-            DuskExpr *value_expr = parseExpr(compiler, state, false);
+            DuskExprId value_expr = parseExpr(compiler, state, false);
 
             stmt->kind = DUSK_STMT_ASSIGN;
             stmt->assign.assigned_expr = expr;
@@ -2316,9 +2384,10 @@ static DuskStmt *parseStmt(DuskCompiler *compiler, TokenizerState *state)
 
             consumeToken(compiler, state, next_token.type);
 
-            DuskExpr *value_expr = parseExpr(compiler, state, false);
+            DuskExprId value_expr = parseExpr(compiler, state, false);
 
-            DuskExpr *bin_expr = DUSK_NEW(allocator, DuskExpr);
+            DuskExprId bin_expr_id = duskExprCreate(compiler);
+            DuskExpr *bin_expr = duskExprGet(compiler, bin_expr_id);
             bin_expr->kind = DUSK_EXPR_BINARY;
             bin_expr->location = stmt->location;
             bin_expr->binary.op = op;
@@ -2327,7 +2396,7 @@ static DuskStmt *parseStmt(DuskCompiler *compiler, TokenizerState *state)
 
             stmt->kind = DUSK_STMT_ASSIGN;
             stmt->assign.assigned_expr = expr;
-            stmt->assign.value_expr = bin_expr;
+            stmt->assign.value_expr = bin_expr_id;
 
             break;
         }
@@ -2344,15 +2413,16 @@ static DuskStmt *parseStmt(DuskCompiler *compiler, TokenizerState *state)
     }
     }
 
-    return stmt;
+    return stmt_id;
 }
 
-static DuskDecl *
+static DuskDeclId
 parseTopLevelDecl(DuskCompiler *compiler, TokenizerState *state)
 {
     DuskAllocator *allocator = duskArenaGetAllocator(compiler->main_arena);
 
-    DuskDecl *decl = DUSK_NEW(allocator, DuskDecl);
+    DuskDeclId decl_id = duskDeclCreate(compiler);
+    DuskDecl *decl = duskDeclGet(compiler, decl_id);
 
     decl->attributes_arr = duskArrayCreate(allocator, DuskAttribute);
     parseAttributes(compiler, state, &decl->attributes_arr);
@@ -2369,8 +2439,8 @@ parseTopLevelDecl(DuskCompiler *compiler, TokenizerState *state)
         decl->kind = DUSK_DECL_FUNCTION;
         decl->name = name_token.str;
         decl->function.parameter_decls_arr =
-            duskArrayCreate(allocator, DuskDecl *);
-        decl->function.stmts_arr = duskArrayCreate(allocator, DuskStmt *);
+            duskArrayCreate(allocator, DuskDeclId);
+        decl->function.stmts_arr = duskArrayCreate(allocator, DuskStmtId);
 
         consumeToken(compiler, state, DUSK_TOKEN_LPAREN);
 
@@ -2386,17 +2456,18 @@ parseTopLevelDecl(DuskCompiler *compiler, TokenizerState *state)
 
             consumeToken(compiler, state, DUSK_TOKEN_COLON);
 
-            DuskExpr *param_type_expr = parseExpr(compiler, state, true);
+            DuskExprId param_type_expr = parseExpr(compiler, state, true);
 
-            DuskDecl *param_decl = DUSK_NEW(allocator, DuskDecl);
+            DuskDeclId param_decl_id = duskDeclCreate(compiler);
+            DuskDecl *param_decl = duskDeclGet(compiler, param_decl_id);
             param_decl->kind = DUSK_DECL_VAR;
             param_decl->location = param_ident.location;
             param_decl->name = param_ident.str;
             param_decl->attributes_arr = param_attributes;
             param_decl->var.type_expr = param_type_expr;
-            param_decl->var.value_expr = NULL;
+            param_decl->var.value_expr = 0;
             param_decl->var.storage_class = DUSK_STORAGE_CLASS_PARAMETER;
-            duskArrayPush(&decl->function.parameter_decls_arr, param_decl);
+            duskArrayPush(&decl->function.parameter_decls_arr, param_decl_id);
 
             tokenizerNextToken(compiler, *state, &next_token);
             if (next_token.type != DUSK_TOKEN_RPAREN) {
@@ -2418,7 +2489,7 @@ parseTopLevelDecl(DuskCompiler *compiler, TokenizerState *state)
 
         tokenizerNextToken(compiler, *state, &next_token);
         while (next_token.type != DUSK_TOKEN_RCURLY) {
-            DuskStmt *stmt = parseStmt(compiler, state);
+            DuskStmtId stmt = parseStmt(compiler, state);
             duskArrayPush(&decl->function.stmts_arr, stmt);
 
             tokenizerNextToken(compiler, *state, &next_token);
@@ -2442,13 +2513,13 @@ parseTopLevelDecl(DuskCompiler *compiler, TokenizerState *state)
         DuskToken name_token = consumeToken(compiler, state, DUSK_TOKEN_IDENT);
 
         consumeToken(compiler, state, DUSK_TOKEN_COLON);
-        DuskExpr *type_expr = parseExpr(compiler, state, true);
+        DuskExprId type_expr = parseExpr(compiler, state, true);
 
         decl->kind = DUSK_DECL_VAR;
         decl->name = name_token.str;
         decl->var.storage_class = storage_class;
         decl->var.type_expr = type_expr;
-        decl->var.value_expr = NULL;
+        decl->var.value_expr = 0;
 
         consumeToken(compiler, state, DUSK_TOKEN_SEMICOLON);
 
@@ -2459,7 +2530,7 @@ parseTopLevelDecl(DuskCompiler *compiler, TokenizerState *state)
 
         DuskToken name_token = consumeToken(compiler, state, DUSK_TOKEN_IDENT);
 
-        DuskExpr *type_expr = parseExpr(compiler, state, true);
+        DuskExprId type_expr = parseExpr(compiler, state, true);
 
         decl->kind = DUSK_DECL_TYPE;
         decl->name = name_token.str;
@@ -2468,6 +2539,10 @@ parseTopLevelDecl(DuskCompiler *compiler, TokenizerState *state)
         consumeToken(compiler, state, DUSK_TOKEN_SEMICOLON);
         break;
     }
+    case DUSK_TOKEN_CONST: {
+        parseConstDecl(compiler, state, decl);
+        break;
+    }
     default: {
         duskAddError(
             compiler,
@@ -2479,12 +2554,54 @@ parseTopLevelDecl(DuskCompiler *compiler, TokenizerState *state)
     }
     }
 
-    return decl;
+    return decl_id;
 }
 
-void duskParse(DuskCompiler *compiler, DuskFile *file)
+// Imports can only appear at the top of the file, before any declaration
+static void parseImports(DuskCompiler *compiler, DuskFile *file)
+{
+    DuskAllocator *allocator = duskArenaGetAllocator(compiler->main_arena);
+
+    TokenizerState state = tokenizerCreate(file);
+    file->imports_arr = duskArrayCreate(allocator, DuskImport);
+
+    DuskToken token = {0};
+    tokenizerNextToken(compiler, state, &token);
+    while (token.type == DUSK_TOKEN_IMPORT) {
+        consumeToken(compiler, &state, DUSK_TOKEN_IMPORT);
+        DuskToken path_token =
+            consumeToken(compiler, &state, DUSK_TOKEN_STRING_LITERAL);
+        consumeToken(compiler, &state, DUSK_TOKEN_SEMICOLON);
+
+        DuskImport import = {
+            .path = path_token.str,
+            .location = path_token.location,
+        };
+        duskArrayPush(&file->imports_arr, import);
+
+        tokenizerNextToken(compiler, state, &token);
+    }
+
+    file->imports_end = (DuskLocation){
+        .file = file,
+        .offset = (uint32_t)state.pos,
+        .line = (uint32_t)state.line,
+        .col = (uint32_t)state.col,
+    };
+}
+
+static TokenizerState tokenizerCreateAfterImports(DuskFile *file)
 {
     TokenizerState state = tokenizerCreate(file);
+    state.pos = file->imports_end.offset;
+    state.line = file->imports_end.line;
+    state.col = file->imports_end.col;
+    return state;
+}
+
+static void duskParseSerial(DuskCompiler *compiler, DuskFile *file)
+{
+    TokenizerState state = tokenizerCreateAfterImports(file);
 
     while (1) {
         DuskToken token = {0};
@@ -2499,7 +2616,787 @@ void duskParse(DuskCompiler *compiler, DuskFile *file)
             break;
         }
 
-        DuskDecl *decl = parseTopLevelDecl(compiler, &state);
+        DuskDeclExtent extent = {
+            .offset = state.pos,
+            .line = state.line,
+            .col = state.col,
+        };
+
+        DuskDeclId decl = parseTopLevelDecl(compiler, &state);
         duskArrayPush(&file->decls_arr, decl);
+
+        extent.length = state.pos - extent.offset;
+        duskArrayPush(&file->decl_extents_arr, extent);
+    }
+}
+
+// Files smaller than this are not worth spinning up threads for
+#define DUSK_PARALLEL_PARSE_MIN_LENGTH (1 << 16)
+#define DUSK_PARALLEL_PARSE_MAX_THREADS 64
+
+typedef struct DuskParseRange {
+    TokenizerState start;
+    size_t end;
+    DuskDeclId decl;
+} DuskParseRange;
+
+static DuskDeclExtent duskRangeToExtent(DuskParseRange *range)
+{
+    return (DuskDeclExtent){
+        .offset = range->start.pos,
+        .length = range->end - range->start.pos,
+        .line = range->start.line,
+        .col = range->start.col,
+    };
+}
+
+typedef struct DuskParseJob {
+    // Each job gets its own copy of the compiler with a separate arena, error
+    // list and jump buffer, the keyword maps are only ever read from
+    DuskCompiler compiler;
+    DuskParseRange *ranges;
+    size_t range_count;
+    bool failed;
+} DuskParseJob;
+
+// Splits the file into the source ranges of its top level declarations by
+// only looking at brackets, semicolons, strings and comments. Returns false if
+// the file could not be split, in which case the regular parser will take care
+// of reporting the errors.
+static bool prescanTopLevelDecls(
+    DuskFile *file, DuskArray(DuskParseRange) * ranges_arr)
+{
+    const char *text = file->text;
+    size_t length = file->text_length;
+
+    TokenizerState state = tokenizerCreateAfterImports(file);
+    TokenizerState range_start = state;
+    TokenizerState close_state = state;
+    size_t depth = 0;
+    bool pending_close = false;
+
+    while (state.pos < length) {
+        char c = text[state.pos];
+
+        if (c == '\n') {
+            state.pos++;
+            state.line++;
+            state.col = 1;
+            continue;
+        }
+
+        if (isWhitespace(c)) {
+            state.pos++;
+            state.col++;
+            continue;
+        }
+
+        if (c == '/' && state.pos + 1 < length && text[state.pos + 1] == '/') {
+            // The tokenizer does not advance the column for comments
+            while (state.pos < length && text[state.pos] != '\n') {
+                state.pos++;
+            }
+            continue;
+        }
+
+        if (pending_close) {
+            // A closing curly at depth 0 ends a declaration, unless it is
+            // followed by a semicolon (e.g. type declarations)
+            pending_close = false;
+            if (c != ';') {
+                DuskParseRange range = {
+                    .start = range_start, .end = close_state.pos};
+                duskArrayPush(ranges_arr, range);
+                range_start = close_state;
+            }
+        }
+
+        switch (c) {
+        case '\"': {
+            state.pos++;
+            state.col++;
+            while (state.pos < length && text[state.pos] != '\"') {
+                state.pos++;
+                state.col++;
+            }
+            if (state.pos >= length) return false;
+            state.pos++;
+            state.col++;
+            break;
+        }
+        case '{':
+        case '[':
+        case '(': {
+            depth++;
+            state.pos++;
+            state.col++;
+            break;
+        }
+        case '}':
+        case ']':
+        case ')': {
+            if (depth == 0) return false;
+            depth--;
+            state.pos++;
+            state.col++;
+            if (c == '}' && depth == 0) {
+                pending_close = true;
+                close_state = state;
+            }
+            break;
+        }
+        case ';': {
+            state.pos++;
+            state.col++;
+            if (depth == 0) {
+                DuskParseRange range = {.start = range_start, .end = state.pos};
+                duskArrayPush(ranges_arr, range);
+                range_start = state;
+            }
+            break;
+        }
+        default: {
+            state.pos++;
+            state.col++;
+            break;
+        }
+        }
+    }
+
+    if (pending_close) {
+        DuskParseRange range = {.start = range_start, .end = close_state.pos};
+        duskArrayPush(ranges_arr, range);
+        range_start = close_state;
+    }
+
+    if (depth != 0) return false;
+
+    // Anything left after the last declaration must be whitespace or comments
+    for (size_t i = range_start.pos; i < length; ++i) {
+        if (isWhitespace(text[i])) continue;
+        if (text[i] == '/' && i + 1 < length && text[i + 1] == '/') {
+            while (i < length && text[i] != '\n')
+                ++i;
+            continue;
+        }
+        return false;
+    }
+
+    return true;
+}
+
+static void duskParseJobRun(void *user_data)
+{
+    DuskParseJob *job = (DuskParseJob *)user_data;
+    DuskCompiler *compiler = &job->compiler;
+
+    if (setjmp(compiler->jump_buffer) != 0) {
+        job->failed = true;
+        return;
+    }
+
+    for (size_t i = 0; i < job->range_count; ++i) {
+        DuskParseRange *range = &job->ranges[i];
+        TokenizerState state = range->start;
+
+        DuskToken token = {0};
+        tokenizerNextToken(compiler, state, &token);
+        if (token.type == DUSK_TOKEN_ERROR || token.type == DUSK_TOKEN_EOF) {
+            job->failed = true;
+            return;
+        }
+
+        range->decl = parseTopLevelDecl(compiler, &state);
+        if (state.pos != range->end) {
+            // The declaration did not end where the prescan expected it to
+            job->failed = true;
+            return;
+        }
+    }
+}
+
+void duskParse(DuskCompiler *compiler, DuskFile *file)
+{
+    DuskAllocator *allocator = duskArenaGetAllocator(compiler->main_arena);
+
+    parseImports(compiler, file);
+
+    uint32_t thread_count = duskCompilerGetThreadCount(compiler);
+    if (thread_count > DUSK_PARALLEL_PARSE_MAX_THREADS) {
+        thread_count = DUSK_PARALLEL_PARSE_MAX_THREADS;
+    }
+
+    if (file->text_length < DUSK_PARALLEL_PARSE_MIN_LENGTH ||
+        thread_count <= 1) {
+        duskParseSerial(compiler, file);
+        return;
+    }
+
+    DuskArray(DuskParseRange) ranges_arr =
+        duskArrayCreate(allocator, DuskParseRange);
+    if (!prescanTopLevelDecls(file, &ranges_arr) ||
+        duskArrayLength(ranges_arr) < 2) {
+        duskParseSerial(compiler, file);
+        return;
+    }
+
+    size_t range_count = duskArrayLength(ranges_arr);
+    if (thread_count > range_count) thread_count = (uint32_t)range_count;
+
+    // The jobs take chunks of node ids from our pools, which can't make room
+    // for more chunks while the jobs run. A declaration doesn't have more
+    // nodes of a kind than characters, and each job leaves at most one chunk
+    // partly used.
+    uint32_t chunk_count =
+        (uint32_t)(file->text_length >> DUSK_POOL_CHUNK_SHIFT) + thread_count;
+    duskPoolReserveChunks(&compiler->expr_pool, chunk_count);
+    duskPoolReserveChunks(&compiler->stmt_pool, chunk_count);
+    duskPoolReserveChunks(&compiler->decl_pool, chunk_count);
+    DuskMutex *pool_mutex = duskMutexCreate(allocator);
+    if (!pool_mutex) {
+        duskParseSerial(compiler, file);
+        return;
+    }
+
+    // Hand out contiguous runs of declarations with roughly the same amount
+    // of text to each job
+    DuskParseJob *jobs = DUSK_NEW_ARRAY(allocator, DuskParseJob, thread_count);
+    size_t bytes_per_job = file->text_length / thread_count + 1;
+    size_t range_index = 0;
+    for (uint32_t i = 0; i < thread_count; ++i) {
+        DuskParseJob *job = &jobs[i];
+        job->compiler = *compiler;
+        job->compiler.main_arena = duskArenaCreate(NULL, 1 << 16);
+        DuskAllocator *job_allocator =
+            duskArenaGetAllocator(job->compiler.main_arena);
+        job->compiler.errors_arr = duskArrayCreate(job_allocator, DuskError);
+        duskPoolInitShared(
+            &job->compiler.expr_pool,
+            &compiler->expr_pool,
+            job_allocator,
+            pool_mutex);
+        duskPoolInitShared(
+            &job->compiler.stmt_pool,
+            &compiler->stmt_pool,
+            job_allocator,
+            pool_mutex);
+        duskPoolInitShared(
+            &job->compiler.decl_pool,
+            &compiler->decl_pool,
+            job_allocator,
+            pool_mutex);
+        duskArrayPush(&compiler->worker_arenas_arr, job->compiler.main_arena);
+
+        job->ranges = &ranges_arr[range_index];
+        size_t job_start = ranges_arr[range_index].start.pos;
+        while (range_index < range_count &&
+               (i == thread_count - 1 || job->range_count == 0 ||
+                ranges_arr[range_index].end - job_start < bytes_per_job)) {
+            job->range_count++;
+            range_index++;
+        }
+        if (range_index >= range_count) {
+            thread_count = i + 1;
+            break;
+        }
+    }
+
+    DuskThread **threads =
+        DUSK_NEW_ARRAY(allocator, DuskThread *, thread_count);
+    for (uint32_t i = 1; i < thread_count; ++i) {
+        threads[i] = duskThreadCreate(allocator, duskParseJobRun, &jobs[i]);
+        if (!threads[i]) duskParseJobRun(&jobs[i]);
+    }
+
+    duskParseJobRun(&jobs[0]);
+
+    bool failed = jobs[0].failed;
+    for (uint32_t i = 1; i < thread_count; ++i) {
+        if (threads[i]) duskThreadJoin(threads[i]);
+        failed = failed || jobs[i].failed;
+    }
+
+    duskMutexDestroy(pool_mutex);
+    duskGrowSideTables(compiler);
+
+    if (failed) {
+        // Let the serial parser report the first error in source order
+        duskParseSerial(compiler, file);
+        return;
     }
+
+    for (size_t i = 0; i < range_count; ++i) {
+        duskArrayPush(&file->decls_arr, ranges_arr[i].decl);
+        duskArrayPush(
+            &file->decl_extents_arr, duskRangeToExtent(&ranges_arr[i]));
+    }
+}
+
+static void shiftExprLocations(
+    DuskCompiler *compiler,
+    DuskExprId expr_id,
+    size_t offset_delta,
+    size_t line_delta);
+
+// The deltas wrap around when the text shrinks, unsigned addition takes care
+// of turning them back into subtractions
+static void
+shiftLocation(DuskLocation *location, size_t offset_delta, size_t line_delta)
+{
+    location->offset += (uint32_t)offset_delta;
+    location->line += (uint32_t)line_delta;
+}
+
+static void shiftAttributeLocations(
+    DuskCompiler *compiler,
+    DuskArray(DuskAttribute) attributes_arr,
+    size_t offset_delta,
+    size_t line_delta)
+{
+    for (size_t i = 0; i < duskArrayLength(attributes_arr); ++i) {
+        DuskAttribute *attribute = &attributes_arr[i];
+        for (size_t j = 0; j < attribute->value_expr_count; ++j) {
+            shiftExprLocations(
+                compiler, attribute->value_exprs[j], offset_delta, line_delta);
+        }
+    }
+}
+
+static void shiftExprArrayLocations(
+    DuskCompiler *compiler,
+    DuskArray(DuskExprId) exprs_arr,
+    size_t offset_delta,
+    size_t line_delta)
+{
+    for (size_t i = 0; i < duskArrayLength(exprs_arr); ++i) {
+        shiftExprLocations(compiler, exprs_arr[i], offset_delta, line_delta);
+    }
+}
+
+static void shiftExprLocations(
+    DuskCompiler *compiler,
+    DuskExprId expr_id,
+    size_t offset_delta,
+    size_t line_delta)
+{
+    if (!expr_id) return;
+
+    DuskExpr *expr = duskExprGet(compiler, expr_id);
+
+    shiftLocation(&expr->location, offset_delta, line_delta);
+
+    switch (expr->kind) {
+    case DUSK_EXPR_VOID_TYPE:
+    case DUSK_EXPR_BOOL_TYPE:
+    case DUSK_EXPR_SCALAR_TYPE:
+    case DUSK_EXPR_VECTOR_TYPE:
+    case DUSK_EXPR_MATRIX_TYPE:
+    case DUSK_EXPR_STRING_LITERAL:
+    case DUSK_EXPR_INT_LITERAL:
+    case DUSK_EXPR_FLOAT_LITERAL:
+    case DUSK_EXPR_BOOL_LITERAL:
+    case DUSK_EXPR_IDENT: break;
+    case DUSK_EXPR_PTR_TYPE: {
+        shiftExprLocations(
+            compiler, expr->ptr_type.sub_expr, offset_delta, line_delta);
+        break;
+    }
+    case DUSK_EXPR_STRUCT_LITERAL: {
+        shiftExprLocations(
+            compiler, expr->struct_literal.type_expr, offset_delta, line_delta);
+        shiftExprArrayLocations(
+            compiler,
+            expr->struct_literal.field_values_arr,
+            offset_delta,
+            line_delta);
+        break;
+    }
+    case DUSK_EXPR_ARRAY_LITERAL: {
+        shiftExprLocations(
+            compiler, expr->array_literal.type_expr, offset_delta, line_delta);
+        shiftExprArrayLocations(
+            compiler,
+            expr->array_literal.field_values_arr,
+            offset_delta,
+            line_delta);
+        break;
+    }
+    case DUSK_EXPR_STRUCT_TYPE: {
+        for (size_t i = 0; i < expr->struct_type->field_count; ++i) {
+            shiftExprLocations(
+                compiler,
+                expr->struct_type->field_type_exprs[i],
+                offset_delta,
+                line_delta);
+            shiftAttributeLocations(
+                compiler,
+                expr->struct_type->field_attribute_arrays[i],
+                offset_delta,
+                line_delta);
+        }
+        break;
+    }
+    case DUSK_EXPR_ARRAY_TYPE:
+    case DUSK_EXPR_RUNTIME_ARRAY_TYPE: {
+        shiftExprLocations(
+            compiler, expr->array_type.sub_expr, offset_delta, line_delta);
+        shiftExprLocations(
+            compiler, expr->array_type.size_expr, offset_delta, line_delta);
+        break;
+    }
+    case DUSK_EXPR_FUNCTION_CALL: {
+        shiftExprLocations(
+            compiler, expr->function_call.func_expr, offset_delta, line_delta);
+        shiftExprArrayLocations(
+            compiler, expr->function_call.params_arr, offset_delta, line_delta);
+        break;
+    }
+    case DUSK_EXPR_BUILTIN_FUNCTION_CALL: {
+        shiftExprArrayLocations(
+            compiler, expr->builtin_call.params_arr, offset_delta, line_delta);
+        break;
+    }
+    case DUSK_EXPR_ACCESS:
+    case DUSK_EXPR_ARRAY_ACCESS: {
+        shiftExprLocations(
+            compiler, expr->access.base_expr, offset_delta, line_delta);
+        shiftExprArrayLocations(
+            compiler, expr->access.chain_arr, offset_delta, line_delta);
+        break;
+    }
+    case DUSK_EXPR_BINARY: {
+        shiftExprLocations(
+            compiler, expr->binary.left, offset_delta, line_delta);
+        shiftExprLocations(
+            compiler, expr->binary.right, offset_delta, line_delta);
+        break;
+    }
+    case DUSK_EXPR_UNARY: {
+        shiftExprLocations(
+            compiler, expr->unary.right, offset_delta, line_delta);
+        break;
+    }
+    }
+}
+
+static void shiftDeclLocations(
+    DuskCompiler *compiler,
+    DuskDeclId decl_id,
+    size_t offset_delta,
+    size_t line_delta);
+
+static void shiftStmtLocations(
+    DuskCompiler *compiler,
+    DuskStmtId stmt_id,
+    size_t offset_delta,
+    size_t line_delta)
+{
+    if (!stmt_id) return;
+
+    DuskStmt *stmt = duskStmtGet(compiler, stmt_id);
+
+    shiftLocation(&stmt->location, offset_delta, line_delta);
+
+    switch (stmt->kind) {
+    case DUSK_STMT_DECL: {
+        shiftDeclLocations(compiler, stmt->decl, offset_delta, line_delta);
+        break;
+    }
+    case DUSK_STMT_ASSIGN: {
+        shiftExprLocations(
+            compiler, stmt->assign.assigned_expr, offset_delta, line_delta);
+        shiftExprLocations(
+            compiler, stmt->assign.value_expr, offset_delta, line_delta);
+        break;
+    }
+    case DUSK_STMT_EXPR: {
+        shiftExprLocations(compiler, stmt->expr, offset_delta, line_delta);
+        break;
+    }
+    case DUSK_STMT_BLOCK: {
+        for (size_t i = 0; i < duskArrayLength(stmt->block.stmts_arr); ++i) {
+            shiftStmtLocations(
+                compiler, stmt->block.stmts_arr[i], offset_delta, line_delta);
+        }
+        break;
+    }
+    case DUSK_STMT_RETURN: {
+        shiftExprLocations(
+            compiler, stmt->return_.expr, offset_delta, line_delta);
+        break;
+    }
+    case DUSK_STMT_IF: {
+        shiftExprLocations(
+            compiler, stmt->if_.cond_expr, offset_delta, line_delta);
+        shiftStmtLocations(
+            compiler, stmt->if_.true_stmt, offset_delta, line_delta);
+        shiftStmtLocations(
+            compiler, stmt->if_.false_stmt, offset_delta, line_delta);
+        break;
+    }
+    case DUSK_STMT_WHILE: {
+        shiftAttributeLocations(
+            compiler, stmt->while_.attributes_arr, offset_delta, line_delta);
+        shiftExprLocations(
+            compiler, stmt->while_.cond_expr, offset_delta, line_delta);
+        shiftStmtLocations(
+            compiler, stmt->while_.stmt, offset_delta, line_delta);
+        break;
+    }
+    case DUSK_STMT_DISCARD:
+    case DUSK_STMT_CONTINUE:
+    case DUSK_STMT_BREAK: break;
+    }
+}
+
+static void shiftDeclLocations(
+    DuskCompiler *compiler,
+    DuskDeclId decl_id,
+    size_t offset_delta,
+    size_t line_delta)
+{
+    DuskDecl *decl = duskDeclGet(compiler, decl_id);
+
+    shiftLocation(&decl->location, offset_delta, line_delta);
+    shiftAttributeLocations(
+        compiler, decl->attributes_arr, offset_delta, line_delta);
+
+    switch (decl->kind) {
+    case DUSK_DECL_FUNCTION: {
+        for (size_t i = 0;
+             i < duskArrayLength(decl->function.parameter_decls_arr);
+             ++i) {
+            shiftDeclLocations(
+                compiler,
+                decl->function.parameter_decls_arr[i],
+                offset_delta,
+                line_delta);
+        }
+        shiftExprLocations(
+            compiler,
+            decl->function.return_type_expr,
+            offset_delta,
+            line_delta);
+        shiftAttributeLocations(
+            compiler,
+            decl->function.return_type_attributes_arr,
+            offset_delta,
+            line_delta);
+        for (size_t i = 0; i < duskArrayLength(decl->function.stmts_arr);
+             ++i) {
+            shiftStmtLocations(
+                compiler,
+                decl->function.stmts_arr[i],
+                offset_delta,
+                line_delta);
+        }
+        break;
+    }
+    case DUSK_DECL_VAR: {
+        shiftExprLocations(
+            compiler, decl->var.type_expr, offset_delta, line_delta);
+        shiftExprLocations(
+            compiler, decl->var.value_expr, offset_delta, line_delta);
+        break;
+    }
+    case DUSK_DECL_TYPE: {
+        shiftExprLocations(
+            compiler, decl->typedef_.type_expr, offset_delta, line_delta);
+        break;
+    }
+    case DUSK_DECL_CONST: {
+        shiftExprLocations(
+            compiler, decl->const_.type_expr, offset_delta, line_delta);
+        shiftExprLocations(
+            compiler, decl->const_.value_expr, offset_delta, line_delta);
+        break;
+    }
+    }
+}
+
+static bool duskDeclReferencesAny(
+    DuskDecl *decl, DuskArray(const char *) names_arr, size_t name_count)
+{
+    for (size_t i = 0; i < name_count; ++i) {
+        if (duskMapGet(decl->referenced_names, names_arr[i], NULL)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool duskParseIncremental(
+    DuskCompiler *compiler,
+    DuskFile *file,
+    const char *text,
+    size_t text_length,
+    size_t edit_offset,
+    size_t removed_length,
+    size_t inserted_length)
+{
+    DuskAllocator *allocator = duskArenaGetAllocator(compiler->main_arena);
+
+    DuskArray(DuskDeclId) old_decls_arr = file->decls_arr;
+    DuskArray(DuskDeclExtent) old_extents_arr = file->decl_extents_arr;
+    size_t old_count = duskArrayLength(old_decls_arr);
+
+    if (edit_offset + removed_length > file->text_length ||
+        edit_offset + inserted_length > text_length ||
+        file->text_length - removed_length != text_length - inserted_length) {
+        return false;
+    }
+
+    // Changing the imports could change the meaning of every declaration
+    if (edit_offset < file->imports_end.offset) {
+        return false;
+    }
+
+    file->text = text;
+    file->text_length = text_length;
+
+    DuskArray(DuskParseRange) ranges_arr =
+        duskArrayCreate(allocator, DuskParseRange);
+    if (!prescanTopLevelDecls(file, &ranges_arr)) {
+        return false;
+    }
+
+    size_t range_count = duskArrayLength(ranges_arr);
+    size_t new_edit_end = edit_offset + inserted_length;
+    size_t offset_delta = inserted_length - removed_length;
+
+    // Match every range that lies entirely outside of the edit with the old
+    // declaration that was parsed from the same text
+    size_t *old_indices = DUSK_NEW_ARRAY(allocator, size_t, range_count);
+    bool *old_reused = DUSK_NEW_ARRAY(allocator, bool, old_count);
+    size_t j = 0;
+    for (size_t i = 0; i < range_count; ++i) {
+        DuskParseRange *range = &ranges_arr[i];
+        old_indices[i] = SIZE_MAX;
+
+        size_t old_offset;
+        if (range->end <= edit_offset) {
+            old_offset = range->start.pos;
+        } else if (range->start.pos >= new_edit_end) {
+            old_offset = range->start.pos - inserted_length + removed_length;
+        } else {
+            continue;
+        }
+
+        while (j < old_count && old_extents_arr[j].offset < old_offset) {
+            j++;
+        }
+        if (j >= old_count) break;
+
+        DuskDeclExtent *old_extent = &old_extents_arr[j];
+        if (old_extent->offset != old_offset ||
+            old_extent->length != range->end - range->start.pos ||
+            old_extent->col != range->start.col) {
+            continue;
+        }
+
+        DUSK_ASSERT(duskDeclGet(compiler, old_decls_arr[j])->referenced_names);
+        range->decl = old_decls_arr[j];
+        old_indices[i] = j;
+        old_reused[j] = true;
+    }
+
+    DuskArray(const char *) dirty_names_arr =
+        duskArrayCreate(allocator, const char *);
+    for (size_t i = 0; i < old_count; ++i) {
+        if (old_reused[i]) continue;
+        duskArrayPush(
+            &dirty_names_arr, duskDeclGet(compiler, old_decls_arr[i])->name);
+    }
+
+    // Declarations that reference a changed declaration are parsed and
+    // analyzed again, which in turn makes them dirty as well
+    size_t checked_name_count = 0;
+    while (checked_name_count < duskArrayLength(dirty_names_arr)) {
+        size_t name_count = duskArrayLength(dirty_names_arr);
+        for (size_t i = 0; i < range_count; ++i) {
+            if (!ranges_arr[i].decl) continue;
+            DuskDecl *decl = duskDeclGet(compiler, ranges_arr[i].decl);
+            if (!duskDeclReferencesAny(decl, dirty_names_arr, name_count)) {
+                continue;
+            }
+
+            ranges_arr[i].decl = 0;
+            old_reused[old_indices[i]] = false;
+            old_indices[i] = SIZE_MAX;
+            duskArrayPush(&dirty_names_arr, decl->name);
+        }
+        checked_name_count = name_count;
+    }
+
+    // Named struct types are cached by name, so changing a type declaration
+    // requires starting over with a clean type cache
+    for (size_t i = 0; i < old_count; ++i) {
+        if (!old_reused[i] &&
+            duskDeclGet(compiler, old_decls_arr[i])->kind == DUSK_DECL_TYPE) {
+            return false;
+        }
+    }
+
+    DuskArray(DuskParseRange) dirty_ranges_arr =
+        duskArrayCreate(allocator, DuskParseRange);
+    for (size_t i = 0; i < range_count; ++i) {
+        if (!ranges_arr[i].decl) {
+            duskArrayPush(&dirty_ranges_arr, ranges_arr[i]);
+        }
+    }
+
+    // Parse on a copy of the compiler so that errors make us fall back to
+    // the regular parser, which reports them in source order
+    DuskParseJob job = {
+        .compiler = *compiler,
+        .ranges = dirty_ranges_arr,
+        .range_count = duskArrayLength(dirty_ranges_arr),
+    };
+    job.compiler.errors_arr = duskArrayCreate(allocator, DuskError);
+    duskParseJobRun(&job);
+
+    // The copy allocated its nodes from our pools and side tables
+    compiler->expr_pool = job.compiler.expr_pool;
+    compiler->stmt_pool = job.compiler.stmt_pool;
+    compiler->decl_pool = job.compiler.decl_pool;
+    compiler->expr_types_arr = job.compiler.expr_types_arr;
+    compiler->expr_as_types_arr = job.compiler.expr_as_types_arr;
+    compiler->expr_const_values_arr = job.compiler.expr_const_values_arr;
+    compiler->decl_types_arr = job.compiler.decl_types_arr;
+
+    if (job.failed) {
+        return false;
+    }
+
+    for (size_t i = 0, k = 0; i < range_count; ++i) {
+        if (ranges_arr[i].decl) continue;
+        ranges_arr[i].decl = dirty_ranges_arr[k++].decl;
+        if (duskDeclGet(compiler, ranges_arr[i].decl)->kind == DUSK_DECL_TYPE) {
+            return false;
+        }
+    }
+
+    DuskArray(DuskDeclId) decls_arr = duskArrayCreate(allocator, DuskDeclId);
+    DuskArray(DuskDeclExtent) extents_arr =
+        duskArrayCreate(allocator, DuskDeclExtent);
+    for (size_t i = 0; i < range_count; ++i) {
+        DuskParseRange *range = &ranges_arr[i];
+
+        if (old_indices[i] != SIZE_MAX && range->start.pos >= new_edit_end) {
+            size_t line_delta =
+                range->start.line - old_extents_arr[old_indices[i]].line;
+            if (offset_delta != 0 || line_delta != 0) {
+                shiftDeclLocations(
+                    compiler, range->decl, offset_delta, line_delta);
+            }
+        }
+
+        duskArrayPush(&decls_arr, range->decl);
+        duskArrayPush(&extents_arr, duskRangeToExtent(range));
+    }
+
+    file->decls_arr = decls_arr;
+    file->decl_extents_arr = extents_arr;
+
+    return true;
 }
@@ -0,0 +1,1612 @@
+#include "dusk_internal.h"
+
+// A prelude blob is a header followed by a stream of 32-bit words describing
+// the analyzed declarations and a table of null-terminated strings, which the
+// words refer to by offset. Types are described the first time they are
+// referenced and referred to by index afterwards, so the blob is read in a
+// single pass. Nothing in the blob is a pointer and the strings are used in
+// place, so it can be mapped from a file as is.
+//
+// The header holds a checksum of the words and strings, so blobs that were
+// truncated or corrupted after they were written are rejected before they are
+// read. The reader also checks that every index, count and enum is in range,
+// that every declaration reference points to a declaration the referencing
+// code can see, and that every expression was resolved by the analysis.
+// Blobs are otherwise trusted to come from duskPreludeWrite, so the types of
+// the expressions aren't checked again.
+
+#define DUSK_PRELUDE_MAGIC 0x4c525044 // "DPRL"
+#define DUSK_PRELUDE_VERSION 6
+
+typedef struct DuskPreludeHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t word_count;
+    uint32_t string_table_size;
+    uint32_t path;
+    // Every declaration in the blob, including parameters and locals
+    uint32_t decl_count;
+    uint32_t top_level_decl_count;
+    uint32_t checksum;
+} DuskPreludeHeader;
+
+// Type references are 0 for NULL, 1 when the description of a new type
+// follows, or the index of an earlier type plus 2
+#define DUSK_PRELUDE_NEW_TYPE 1
+
+// Declaration references are 0 for NULL, 1 when the name of a declaration
+// from another file follows, or the index of the declaration plus 2
+#define DUSK_PRELUDE_EXTERNAL_DECL 1
+
+// FNV-1a over everything after the header
+static uint32_t duskPreludeChecksum(const uint8_t *data, size_t size)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Writer {{{
+typedef struct DuskPreludeWriter {
+    DuskCompiler *compiler;
+    DuskAllocator *allocator;
+    DuskArray(uint32_t) words_arr;
+    DuskArray(char) strings_arr;
+    DuskMap *string_offsets;
+    DuskMap *type_indices;
+    uint32_t type_count;
+    // Indexed by declaration id, holds the index of the declaration in the
+    // blob plus one, or 0 for declarations from other files. Filled before
+    // anything is written so that forward references can be resolved.
+    uint32_t *decl_indices;
+    uint32_t decl_count;
+} DuskPreludeWriter;
+
+static void duskPreludeNumberDecl(DuskPreludeWriter *writer, DuskDeclId decl_id)
+{
+    writer->decl_indices[decl_id] = ++writer->decl_count;
+}
+
+static void duskPreludeNumberStmt(DuskPreludeWriter *writer, DuskStmtId stmt_id)
+{
+    if (!stmt_id) return;
+
+    DuskStmt *stmt = duskStmtGet(writer->compiler, stmt_id);
+    switch (stmt->kind) {
+    case DUSK_STMT_DECL: {
+        duskPreludeNumberDecl(writer, stmt->decl);
+        break;
+    }
+    case DUSK_STMT_BLOCK: {
+        for (size_t i = 0; i < duskArrayLength(stmt->block.stmts_arr); ++i) {
+            duskPreludeNumberStmt(writer, stmt->block.stmts_arr[i]);
+        }
+        break;
+    }
+    case DUSK_STMT_IF: {
+        duskPreludeNumberStmt(writer, stmt->if_.true_stmt);
+        duskPreludeNumberStmt(writer, stmt->if_.false_stmt);
+        break;
+    }
+    case DUSK_STMT_WHILE: {
+        duskPreludeNumberStmt(writer, stmt->while_.stmt);
+        break;
+    }
+    default: break;
+    }
+}
+
+// Declarations are numbered in the same order they are written in
+static void
+duskPreludeNumberTopLevelDecl(DuskPreludeWriter *writer, DuskDeclId decl_id)
+{
+    duskPreludeNumberDecl(writer, decl_id);
+
+    DuskDecl *decl = duskDeclGet(writer->compiler, decl_id);
+    if (decl->kind == DUSK_DECL_FUNCTION) {
+        for (size_t i = 0;
+             i < duskArrayLength(decl->function.parameter_decls_arr);
+             ++i) {
+            duskPreludeNumberDecl(
+                writer, decl->function.parameter_decls_arr[i]);
+        }
+        for (size_t i = 0; i < duskArrayLength(decl->function.stmts_arr);
+             ++i) {
+            duskPreludeNumberStmt(writer, decl->function.stmts_arr[i]);
+        }
+    }
+}
+
+static void duskWriteWord(DuskPreludeWriter *writer, uint32_t word)
+{
+    duskArrayPush(&writer->words_arr, word);
+}
+
+static void duskWriteU64(DuskPreludeWriter *writer, uint64_t value)
+{
+    duskWriteWord(writer, (uint32_t)value);
+    duskWriteWord(writer, (uint32_t)(value >> 32));
+}
+
+// Arrays are written as their length plus one, or 0 if they are NULL
+static void duskWriteArrayLength(DuskPreludeWriter *writer, void *arr)
+{
+    duskWriteWord(writer, arr ? (uint32_t)duskArrayLength(arr) + 1 : 0);
+}
+
+static void duskWriteString(DuskPreludeWriter *writer, const char *str)
+{
+    if (!str) {
+        duskWriteWord(writer, 0);
+        return;
+    }
+
+    uintptr_t offset = 0;
+    if (!duskMapGet(writer->string_offsets, str, (void **)&offset)) {
+        offset = duskArrayLength(writer->strings_arr) + 1;
+        for (const char *c = str; *c; ++c) {
+            duskArrayPush(&writer->strings_arr, *c);
+        }
+        duskArrayPush(&writer->strings_arr, '\0');
+        duskMapSet(writer->string_offsets, str, (void *)offset);
+    }
+
+    duskWriteWord(writer, (uint32_t)offset);
+}
+
+static void duskWriteLocation(DuskPreludeWriter *writer, DuskLocation location)
+{
+    duskWriteWord(writer, location.offset);
+    duskWriteWord(writer, location.length);
+    duskWriteWord(writer, location.line);
+    duskWriteWord(writer, location.col);
+}
+
+static void duskWriteDeclRef(DuskPreludeWriter *writer, DuskDeclId decl_id)
+{
+    if (!decl_id) {
+        duskWriteWord(writer, 0);
+        return;
+    }
+
+    uint32_t index = writer->decl_indices[decl_id];
+    if (index == 0) {
+        duskWriteWord(writer, DUSK_PRELUDE_EXTERNAL_DECL);
+        duskWriteString(writer, duskDeclGet(writer->compiler, decl_id)->name);
+        return;
+    }
+
+    duskWriteWord(writer, index + 1);
+}
+
+static DuskScalarType duskScalarTypeOf(DuskType *type)
+{
+    if (type->kind == DUSK_TYPE_FLOAT) {
+        switch (type->float_.bits) {
+        case 16: return DUSK_SCALAR_TYPE_HALF;
+        case 32: return DUSK_SCALAR_TYPE_FLOAT;
+        default: return DUSK_SCALAR_TYPE_DOUBLE;
+        }
+    }
+
+    DUSK_ASSERT(type->kind == DUSK_TYPE_INT);
+    switch (type->int_.bits) {
+    case 8:
+        return type->int_.is_signed ? DUSK_SCALAR_TYPE_BYTE
+                                    : DUSK_SCALAR_TYPE_UBYTE;
+    case 16:
+        return type->int_.is_signed ? DUSK_SCALAR_TYPE_SHORT
+                                    : DUSK_SCALAR_TYPE_USHORT;
+    case 32:
+        return type->int_.is_signed ? DUSK_SCALAR_TYPE_INT
+                                    : DUSK_SCALAR_TYPE_UINT;
+    default:
+        return type->int_.is_signed ? DUSK_SCALAR_TYPE_LONG
+                                    : DUSK_SCALAR_TYPE_ULONG;
+    }
+}
+
+static void duskWriteExpr(DuskPreludeWriter *writer, DuskExprId expr_id);
+
+static void duskWriteAttributes(
+    DuskPreludeWriter *writer, DuskArray(DuskAttribute) attributes_arr)
+{
+    duskWriteArrayLength(writer, attributes_arr);
+    for (size_t i = 0; i < duskArrayLength(attributes_arr); ++i) {
+        DuskAttribute *attribute = &attributes_arr[i];
+        duskWriteWord(writer, (uint32_t)attribute->kind);
+        duskWriteString(writer, attribute->name);
+        duskWriteWord(writer, (uint32_t)attribute->value_expr_count);
+        for (size_t j = 0; j < attribute->value_expr_count; ++j) {
+            duskWriteExpr(writer, attribute->value_exprs[j]);
+        }
+    }
+}
+
+static void duskWriteType(DuskPreludeWriter *writer, DuskType *type)
+{
+    if (!type) {
+        duskWriteWord(writer, 0);
+        return;
+    }
+
+    const char *type_string = duskTypeToString(writer->allocator, type);
+    uintptr_t index = 0;
+    if (duskMapGet(writer->type_indices, type_string, (void **)&index)) {
+        duskWriteWord(writer, (uint32_t)index + 2);
+        return;
+    }
+
+    duskWriteWord(writer, DUSK_PRELUDE_NEW_TYPE);
+    duskWriteWord(writer, (uint32_t)type->kind);
+
+    switch (type->kind) {
+    case DUSK_TYPE_VOID:
+    case DUSK_TYPE_TYPE:
+    case DUSK_TYPE_BOOL:
+    case DUSK_TYPE_UNTYPED_INT:
+    case DUSK_TYPE_UNTYPED_FLOAT:
+    case DUSK_TYPE_SAMPLER:
+    case DUSK_TYPE_STRING: break;
+    case DUSK_TYPE_INT:
+    case DUSK_TYPE_FLOAT: {
+        duskWriteWord(writer, (uint32_t)duskScalarTypeOf(type));
+        break;
+    }
+    case DUSK_TYPE_VECTOR: {
+        duskWriteType(writer, type->vector.sub);
+        duskWriteWord(writer, type->vector.size);
+        break;
+    }
+    case DUSK_TYPE_MATRIX: {
+        duskWriteType(writer, type->matrix.col_type);
+        duskWriteWord(writer, type->matrix.cols);
+        break;
+    }
+    case DUSK_TYPE_RUNTIME_ARRAY: {
+        duskWriteWord(writer, (uint32_t)type->array.layout);
+        duskWriteType(writer, type->array.sub);
+        break;
+    }
+    case DUSK_TYPE_ARRAY: {
+        duskWriteWord(writer, (uint32_t)type->array.layout);
+        duskWriteType(writer, type->array.sub);
+        duskWriteU64(writer, type->array.size);
+        break;
+    }
+    case DUSK_TYPE_STRUCT: {
+        duskWriteString(writer, type->struct_.name);
+        duskWriteWord(writer, (uint32_t)type->struct_.layout);
+        duskWriteWord(writer, (uint32_t)type->struct_.is_block);
+        duskWriteWord(writer, (uint32_t)type->struct_.field_count);
+        for (size_t i = 0; i < type->struct_.field_count; ++i) {
+            duskWriteString(writer, type->struct_.field_names[i]);
+            duskWriteType(writer, type->struct_.field_types[i]);
+            duskWriteAttributes(
+                writer, type->struct_.field_attribute_arrays[i]);
+        }
+        break;
+    }
+    case DUSK_TYPE_FUNCTION: {
+        duskWriteType(writer, type->function.return_type);
+        duskWriteWord(writer, (uint32_t)type->function.param_type_count);
+        for (size_t i = 0; i < type->function.param_type_count; ++i) {
+            duskWriteType(writer, type->function.param_types[i]);
+        }
+        break;
+    }
+    case DUSK_TYPE_POINTER: {
+        duskWriteType(writer, type->pointer.sub);
+        duskWriteWord(writer, (uint32_t)type->pointer.storage_class);
+        duskWriteWord(writer, type->pointer.alignment);
+        break;
+    }
+    case DUSK_TYPE_IMAGE: {
+        duskWriteType(writer, type->image.sampled_type);
+        duskWriteWord(writer, (uint32_t)type->image.dim);
+        duskWriteWord(writer, type->image.depth);
+        duskWriteWord(writer, type->image.arrayed);
+        duskWriteWord(writer, type->image.multisampled);
+        duskWriteWord(writer, type->image.sampled);
+        break;
+    }
+    case DUSK_TYPE_SAMPLED_IMAGE: {
+        duskWriteType(writer, type->sampled_image.image_type);
+        break;
+    }
+    }
+
+    // The reader creates the type after reading the types it depends on, so
+    // it gets its index last
+    index = writer->type_count++;
+    duskMapSet(writer->type_indices, type_string, (void *)index);
+}
+
+// The shape of a constant follows from its type, so only the scalars are
+// written after it
+static void
+duskWriteConstValue(DuskPreludeWriter *writer, DuskConstValue *value)
+{
+    duskWriteType(writer, value->type);
+
+    switch (value->type->kind) {
+    case DUSK_TYPE_BOOL: duskWriteWord(writer, value->bool_value); break;
+    case DUSK_TYPE_INT:
+    case DUSK_TYPE_UNTYPED_INT: duskWriteU64(writer, value->int_value); break;
+    case DUSK_TYPE_FLOAT:
+    case DUSK_TYPE_UNTYPED_FLOAT: {
+        uint64_t bits;
+        memcpy(&bits, &value->float_value, sizeof(bits));
+        duskWriteU64(writer, bits);
+        break;
+    }
+    default: {
+        for (size_t i = 0; i < value->composite.count; ++i) {
+            duskWriteConstValue(writer, value->composite.values[i]);
+        }
+        break;
+    }
+    }
+}
+
+static void duskWriteExprArray(
+    DuskPreludeWriter *writer, DuskArray(DuskExprId) exprs_arr)
+{
+    duskWriteArrayLength(writer, exprs_arr);
+    for (size_t i = 0; i < duskArrayLength(exprs_arr); ++i) {
+        duskWriteExpr(writer, exprs_arr[i]);
+    }
+}
+
+static void duskWriteExpr(DuskPreludeWriter *writer, DuskExprId expr_id)
+{
+    if (!expr_id) {
+        duskWriteWord(writer, 0);
+        return;
+    }
+
+    DuskCompiler *compiler = writer->compiler;
+    DuskExpr *expr = duskExprGet(compiler, expr_id);
+    duskWriteWord(writer, (uint32_t)expr->kind + 1);
+    duskWriteLocation(writer, expr->location);
+    duskWriteType(writer, compiler->expr_types_arr[expr_id]);
+    duskWriteType(writer, compiler->expr_as_types_arr[expr_id]);
+
+    switch (expr->kind) {
+    case DUSK_EXPR_VOID_TYPE:
+    case DUSK_EXPR_BOOL_TYPE: break;
+    case DUSK_EXPR_SCALAR_TYPE: {
+        duskWriteWord(writer, (uint32_t)expr->scalar_type);
+        break;
+    }
+    case DUSK_EXPR_VECTOR_TYPE: {
+        duskWriteWord(writer, (uint32_t)expr->vector_type.scalar_type);
+        duskWriteWord(writer, expr->vector_type.length);
+        break;
+    }
+    case DUSK_EXPR_MATRIX_TYPE: {
+        duskWriteWord(writer, (uint32_t)expr->matrix_type.scalar_type);
+        duskWriteWord(writer, expr->matrix_type.cols);
+        duskWriteWord(writer, expr->matrix_type.rows);
+        break;
+    }
+    case DUSK_EXPR_PTR_TYPE: {
+        duskWriteWord(writer, (uint32_t)expr->ptr_type.storage_class);
+        duskWriteWord(writer, expr->ptr_type.alignment);
+        duskWriteExpr(writer, expr->ptr_type.sub_expr);
+        break;
+    }
+    case DUSK_EXPR_STRING_LITERAL: {
+        duskWriteString(writer, expr->string.str);
+        break;
+    }
+    case DUSK_EXPR_INT_LITERAL: {
+        duskWriteU64(writer, (uint64_t)expr->int_literal);
+        break;
+    }
+    case DUSK_EXPR_FLOAT_LITERAL: {
+        uint64_t bits = 0;
+        memcpy(&bits, &expr->float_literal, sizeof(bits));
+        duskWriteU64(writer, bits);
+        break;
+    }
+    case DUSK_EXPR_BOOL_LITERAL: {
+        duskWriteWord(writer, (uint32_t)expr->bool_literal);
+        break;
+    }
+    case DUSK_EXPR_STRUCT_LITERAL: {
+        duskWriteExpr(writer, expr->struct_literal.type_expr);
+        duskWriteArrayLength(writer, expr->struct_literal.field_names_arr);
+        for (size_t i = 0;
+             i < duskArrayLength(expr->struct_literal.field_names_arr);
+             ++i) {
+            duskWriteString(writer, expr->struct_literal.field_names_arr[i]);
+        }
+        duskWriteExprArray(writer, expr->struct_literal.field_values_arr);
+        break;
+    }
+    case DUSK_EXPR_ARRAY_LITERAL: {
+        duskWriteExpr(writer, expr->array_literal.type_expr);
+        duskWriteExprArray(writer, expr->array_literal.field_values_arr);
+        break;
+    }
+    case DUSK_EXPR_IDENT: {
+        duskWriteString(writer, expr->identifier.str);
+        duskWriteDeclRef(writer, expr->identifier.decl);
+        duskWriteArrayLength(writer, expr->identifier.shuffle_indices_arr);
+        for (size_t i = 0;
+             i < duskArrayLength(expr->identifier.shuffle_indices_arr);
+             ++i) {
+            duskWriteWord(writer, expr->identifier.shuffle_indices_arr[i]);
+        }
+        break;
+    }
+    case DUSK_EXPR_STRUCT_TYPE: {
+        DuskStructTypeExpr *struct_type = expr->struct_type;
+        duskWriteWord(writer, (uint32_t)struct_type->param_count);
+        for (size_t i = 0; i < struct_type->param_count; ++i) {
+            duskWriteString(writer, struct_type->params[i]);
+        }
+        duskWriteString(writer, struct_type->name);
+        duskWriteWord(writer, (uint32_t)struct_type->field_count);
+        for (size_t i = 0; i < struct_type->field_count; ++i) {
+            duskWriteString(writer, struct_type->field_names[i]);
+            duskWriteExpr(writer, struct_type->field_type_exprs[i]);
+            duskWriteAttributes(
+                writer, struct_type->field_attribute_arrays[i]);
+        }
+        break;
+    }
+    case DUSK_EXPR_ARRAY_TYPE:
+    case DUSK_EXPR_RUNTIME_ARRAY_TYPE: {
+        duskWriteExpr(writer, expr->array_type.sub_expr);
+        duskWriteExpr(writer, expr->array_type.size_expr);
+        break;
+    }
+    case DUSK_EXPR_FUNCTION_CALL: {
+        duskWriteExpr(writer, expr->function_call.func_expr);
+        duskWriteExprArray(writer, expr->function_call.params_arr);
+        break;
+    }
+    case DUSK_EXPR_BUILTIN_FUNCTION_CALL: {
+        duskWriteWord(writer, (uint32_t)expr->builtin_call.kind);
+        duskWriteExprArray(writer, expr->builtin_call.params_arr);
+        break;
+    }
+    case DUSK_EXPR_ACCESS:
+    case DUSK_EXPR_ARRAY_ACCESS: {
+        duskWriteExpr(writer, expr->access.base_expr);
+        duskWriteExprArray(writer, expr->access.chain_arr);
+        break;
+    }
+    case DUSK_EXPR_BINARY: {
+        duskWriteWord(writer, (uint32_t)expr->binary.op);
+        duskWriteExpr(writer, expr->binary.left);
+        duskWriteExpr(writer, expr->binary.right);
+        break;
+    }
+    case DUSK_EXPR_UNARY: {
+        duskWriteWord(writer, (uint32_t)expr->unary.op);
+        duskWriteExpr(writer, expr->unary.right);
+        break;
+    }
+    }
+}
+
+static void duskWriteDecl(DuskPreludeWriter *writer, DuskDeclId decl_id);
+
+static void duskWriteStmt(DuskPreludeWriter *writer, DuskStmtId stmt_id)
+{
+    if (!stmt_id) {
+        duskWriteWord(writer, 0);
+        return;
+    }
+
+    DuskStmt *stmt = duskStmtGet(writer->compiler, stmt_id);
+    duskWriteWord(writer, (uint32_t)stmt->kind + 1);
+    duskWriteLocation(writer, stmt->location);
+
+    switch (stmt->kind) {
+    case DUSK_STMT_DECL: {
+        duskWriteDecl(writer, stmt->decl);
+        break;
+    }
+    case DUSK_STMT_ASSIGN: {
+        duskWriteExpr(writer, stmt->assign.assigned_expr);
+        duskWriteExpr(writer, stmt->assign.value_expr);
+        break;
+    }
+    case DUSK_STMT_EXPR: {
+        duskWriteExpr(writer, stmt->expr);
+        break;
+    }
+    case DUSK_STMT_BLOCK: {
+        duskWriteArrayLength(writer, stmt->block.stmts_arr);
+        for (size_t i = 0; i < duskArrayLength(stmt->block.stmts_arr); ++i) {
+            duskWriteStmt(writer, stmt->block.stmts_arr[i]);
+        }
+        break;
+    }
+    case DUSK_STMT_RETURN: {
+        duskWriteExpr(writer, stmt->return_.expr);
+        break;
+    }
+    case DUSK_STMT_IF: {
+        duskWriteExpr(writer, stmt->if_.cond_expr);
+        duskWriteStmt(writer, stmt->if_.true_stmt);
+        duskWriteStmt(writer, stmt->if_.false_stmt);
+        break;
+    }
+    case DUSK_STMT_WHILE: {
+        duskWriteAttributes(writer, stmt->while_.attributes_arr);
+        duskWriteExpr(writer, stmt->while_.cond_expr);
+        duskWriteStmt(writer, stmt->while_.stmt);
+        duskWriteWord(writer, (uint32_t)stmt->while_.unroll_hint);
+        duskWriteWord(writer, stmt->while_.unroll_count);
+        break;
+    }
+    case DUSK_STMT_DISCARD:
+    case DUSK_STMT_CONTINUE:
+    case DUSK_STMT_BREAK: break;
+    }
+}
+
+static void duskWriteDecl(DuskPreludeWriter *writer, DuskDeclId decl_id)
+{
+    DuskDecl *decl = duskDeclGet(writer->compiler, decl_id);
+    duskWriteWord(writer, (uint32_t)decl->kind);
+    duskWriteLocation(writer, decl->location);
+    duskWriteString(writer, decl->name);
+    duskWriteAttributes(writer, decl->attributes_arr);
+    duskWriteType(writer, writer->compiler->decl_types_arr[decl_id]);
+
+    switch (decl->kind) {
+    case DUSK_DECL_FUNCTION: {
+        duskWriteWord(writer, (uint32_t)decl->function.is_entry_point);
+        duskWriteWord(writer, (uint32_t)decl->function.entry_point_stage);
+        duskWriteWord(writer, (uint32_t)decl->function.inline_hint);
+        duskWriteString(writer, decl->function.link_name);
+
+        duskWriteArrayLength(writer, decl->function.parameter_decls_arr);
+        for (size_t i = 0;
+             i < duskArrayLength(decl->function.parameter_decls_arr);
+             ++i) {
+            duskWriteDecl(writer, decl->function.parameter_decls_arr[i]);
+        }
+
+        duskWriteExpr(writer, decl->function.return_type_expr);
+        duskWriteAttributes(writer, decl->function.return_type_attributes_arr);
+
+        duskWriteArrayLength(writer, decl->function.stmts_arr);
+        for (size_t i = 0; i < duskArrayLength(decl->function.stmts_arr);
+             ++i) {
+            duskWriteStmt(writer, decl->function.stmts_arr[i]);
+        }
+        break;
+    }
+    case DUSK_DECL_VAR: {
+        duskWriteExpr(writer, decl->var.type_expr);
+        duskWriteExpr(writer, decl->var.value_expr);
+        duskWriteWord(writer, (uint32_t)decl->var.storage_class);
+        duskWriteWord(writer, (uint32_t)decl->var.read_only);
+        break;
+    }
+    case DUSK_DECL_TYPE: {
+        duskWriteExpr(writer, decl->typedef_.type_expr);
+        break;
+    }
+    case DUSK_DECL_CONST: {
+        duskWriteExpr(writer, decl->const_.type_expr);
+        duskWriteExpr(writer, decl->const_.value_expr);
+        duskWriteConstValue(writer, decl->const_.value);
+        break;
+    }
+    }
+}
+
+uint8_t *duskPreludeWrite(
+    DuskCompiler *compiler, DuskFile *file, size_t *blob_byte_size)
+{
+    DuskAllocator *allocator = duskArenaGetAllocator(compiler->main_arena);
+
+    DuskPreludeWriter writer = {
+        .compiler = compiler,
+        .allocator = allocator,
+        .words_arr = duskArrayCreate(allocator, uint32_t),
+        .strings_arr = duskArrayCreate(allocator, char),
+        .string_offsets = duskMapCreate(allocator, 256),
+        .type_indices = duskMapCreate(allocator, 64),
+        .decl_indices = DUSK_NEW_ARRAY(
+            allocator, uint32_t, compiler->decl_pool.next_id),
+    };
+
+    size_t decl_count = duskArrayLength(file->decls_arr);
+    for (size_t i = 0; i < decl_count; ++i) {
+        duskPreludeNumberTopLevelDecl(&writer, file->decls_arr[i]);
+    }
+
+    uint32_t path = 0;
+    if (file->path) {
+        duskWriteString(&writer, file->path);
+        path = writer.words_arr[0];
+        duskArrayResize(&writer.words_arr, 0);
+    }
+
+    for (size_t i = 0; i < decl_count; ++i) {
+        DuskDeclId decl_id = file->decls_arr[i];
+        duskWriteDecl(&writer, decl_id);
+
+        // Used to find out which declarations of the prelude a file needs
+        DuskMap *referenced_names =
+            duskDeclGet(compiler, decl_id)->referenced_names;
+        uint32_t name_count = 0;
+        for (size_t j = 0; j < referenced_names->size; ++j) {
+            if (referenced_names->slots[j].hash != 0) name_count++;
+        }
+        duskWriteWord(&writer, name_count);
+        for (size_t j = 0; j < referenced_names->size; ++j) {
+            if (referenced_names->slots[j].hash != 0) {
+                duskWriteString(&writer, referenced_names->slots[j].key);
+            }
+        }
+    }
+
+    while (duskArrayLength(writer.strings_arr) % 4 != 0) {
+        duskArrayPush(&writer.strings_arr, '\0');
+    }
+
+    DuskPreludeHeader header = {
+        .magic = DUSK_PRELUDE_MAGIC,
+        .version = DUSK_PRELUDE_VERSION,
+        .word_count = (uint32_t)duskArrayLength(writer.words_arr),
+        .string_table_size = (uint32_t)duskArrayLength(writer.strings_arr),
+        .path = path,
+        .decl_count = writer.decl_count,
+        .top_level_decl_count = (uint32_t)decl_count,
+    };
+
+    size_t words_size = duskArrayLength(writer.words_arr) * sizeof(uint32_t);
+    *blob_byte_size = sizeof(header) + words_size + header.string_table_size;
+
+    uint8_t *blob = duskAllocate(allocator, *blob_byte_size);
+    memcpy(blob + sizeof(header), writer.words_arr, words_size);
+    memcpy(
+        blob + sizeof(header) + words_size,
+        writer.strings_arr,
+        header.string_table_size);
+    header.checksum = duskPreludeChecksum(
+        blob + sizeof(header), *blob_byte_size - sizeof(header));
+    memcpy(blob, &header, sizeof(header));
+
+    return blob;
+}
+// }}}
+
+// Reader {{{
+typedef struct DuskPreludeReader {
+    DuskCompiler *compiler;
+    DuskAllocator *allocator;
+    DuskFile *file;
+    DuskScope *parent_scope;
+    const uint32_t *words;
+    size_t word_count;
+    size_t pos;
+    const char *strings;
+    size_t string_table_size;
+    DuskArray(DuskType *) types_arr;
+    DuskDeclId *decls;
+    size_t decl_count;
+    size_t next_decl;
+    // Index of the top level declaration each declaration that was read
+    // belongs to, and of the one being read
+    uint32_t *decl_owners;
+    uint32_t owner;
+    // References to declarations that weren't read yet, which can only be top
+    // level ones
+    DuskArray(uint32_t) forward_refs_arr;
+    // Values of attributes that must be integers known at compile time, which
+    // are evaluated once the constants they can refer to are read
+    DuskArray(DuskExprId) integer_exprs_arr;
+    jmp_buf jump_buffer;
+} DuskPreludeReader;
+
+static void duskPreludeReaderFail(DuskPreludeReader *reader)
+{
+    longjmp(reader->jump_buffer, 1);
+}
+
+static uint32_t duskReadWord(DuskPreludeReader *reader)
+{
+    if (reader->pos >= reader->word_count) {
+        duskPreludeReaderFail(reader);
+    }
+    return reader->words[reader->pos++];
+}
+
+static uint64_t duskReadU64(DuskPreludeReader *reader)
+{
+    uint64_t low = duskReadWord(reader);
+    uint64_t high = duskReadWord(reader);
+    return low | (high << 32);
+}
+
+static uint32_t duskReadEnum(DuskPreludeReader *reader, uint32_t value_count)
+{
+    uint32_t value = duskReadWord(reader);
+    if (value >= value_count) {
+        duskPreludeReaderFail(reader);
+    }
+    return value;
+}
+
+// Every item of a sequence takes at least one word, so a count that is
+// bigger than what's left of the blob can only come from a corrupt blob
+static size_t duskReadCount(DuskPreludeReader *reader)
+{
+    uint32_t count = duskReadWord(reader);
+    if (count > reader->word_count - reader->pos) {
+        duskPreludeReaderFail(reader);
+    }
+    return count;
+}
+
+// Returns the length of the array plus one, or 0 if it was NULL
+static size_t duskReadArrayLength(DuskPreludeReader *reader)
+{
+    size_t length = duskReadCount(reader);
+    if (length > reader->word_count - reader->pos + 1) {
+        duskPreludeReaderFail(reader);
+    }
+    return length;
+}
+
+static const char *duskReadString(DuskPreludeReader *reader)
+{
+    uint32_t offset = duskReadWord(reader);
+    if (offset == 0) return NULL;
+    if (offset - 1 >= reader->string_table_size) {
+        duskPreludeReaderFail(reader);
+    }
+    return &reader->strings[offset - 1];
+}
+
+static DuskLocation duskReadLocation(DuskPreludeReader *reader)
+{
+    DuskLocation location = {.file = reader->file};
+    location.offset = duskReadWord(reader);
+    location.length = duskReadWord(reader);
+    location.line = duskReadWord(reader);
+    location.col = duskReadWord(reader);
+    return location;
+}
+
+static DuskDeclId duskReadDeclRef(DuskPreludeReader *reader)
+{
+    uint32_t ref = duskReadWord(reader);
+    if (ref == 0) return 0;
+    if (ref == DUSK_PRELUDE_EXTERNAL_DECL) {
+        const char *name = duskReadString(reader);
+        DuskDeclId decl_id = 0;
+        if (name && reader->parent_scope) {
+            decl_id = duskScopeLookup(reader->parent_scope, name);
+        }
+        if (!decl_id) {
+            duskPreludeReaderFail(reader);
+        }
+        return decl_id;
+    }
+    if (ref - 2 >= reader->decl_count) {
+        duskPreludeReaderFail(reader);
+    }
+
+    // Parameters and locals can only be referred to by their function, after
+    // they are declared
+    uint32_t index = ref - 2;
+    if (index < reader->next_decl) {
+        uint32_t owner = reader->decl_owners[index];
+        if (owner != index && owner != reader->owner) {
+            duskPreludeReaderFail(reader);
+        }
+    } else {
+        duskArrayPush(&reader->forward_refs_arr, index);
+    }
+    return reader->decls[index];
+}
+
+static DuskExprId duskReadUncheckedExpr(DuskPreludeReader *reader);
+static DuskExprId duskReadExpr(DuskPreludeReader *reader);
+static DuskExprId duskReadRequiredExpr(DuskPreludeReader *reader);
+
+// Code generation relies on the checks the analysis does on the values of
+// the attributes it turns into decorations
+static void
+duskCheckAttribute(DuskPreludeReader *reader, DuskAttribute *attribute)
+{
+    switch (attribute->kind) {
+    case DUSK_ATTRIBUTE_LOCATION:
+    case DUSK_ATTRIBUTE_SET:
+    case DUSK_ATTRIBUTE_BINDING:
+    case DUSK_ATTRIBUTE_OFFSET: {
+        if (attribute->value_expr_count != 1 || !attribute->value_exprs[0]) {
+            duskPreludeReaderFail(reader);
+        }
+        duskArrayPush(&reader->integer_exprs_arr, attribute->value_exprs[0]);
+        break;
+    }
+    case DUSK_ATTRIBUTE_BUILTIN: {
+        DuskExpr *value_expr = NULL;
+        if (attribute->value_expr_count == 1 && attribute->value_exprs[0]) {
+            value_expr =
+                duskExprGet(reader->compiler, attribute->value_exprs[0]);
+        }
+        if (!value_expr || value_expr->kind != DUSK_EXPR_IDENT ||
+            !value_expr->identifier.str) {
+            duskPreludeReaderFail(reader);
+        }
+        break;
+    }
+    case DUSK_ATTRIBUTE_READ_ONLY: {
+        if (attribute->value_expr_count != 0) {
+            duskPreludeReaderFail(reader);
+        }
+        break;
+    }
+    default: break;
+    }
+}
+
+static DuskArray(DuskAttribute) duskReadAttributes(DuskPreludeReader *reader)
+{
+    size_t length = duskReadArrayLength(reader);
+    if (length == 0) return NULL;
+
+    DuskArray(DuskAttribute) attributes_arr =
+        duskArrayCreate(reader->allocator, DuskAttribute);
+    for (size_t i = 0; i < length - 1; ++i) {
+        DuskAttribute attribute = {0};
+        attribute.kind = (DuskAttributeKind)duskReadEnum(
+            reader, DUSK_ATTRIBUTE_DONT_UNROLL + 1);
+        attribute.name = duskReadString(reader);
+        attribute.value_expr_count = duskReadCount(reader);
+        attribute.value_exprs = DUSK_NEW_ARRAY(
+            reader->allocator, DuskExprId, attribute.value_expr_count);
+        for (size_t j = 0; j < attribute.value_expr_count; ++j) {
+            attribute.value_exprs[j] = duskReadUncheckedExpr(reader);
+        }
+        duskCheckAttribute(reader, &attribute);
+        duskArrayPush(&attributes_arr, attribute);
+    }
+
+    return attributes_arr;
+}
+
+static DuskType *duskReadType(DuskPreludeReader *reader);
+
+static DuskType *duskReadRequiredType(DuskPreludeReader *reader)
+{
+    DuskType *type = duskReadType(reader);
+    if (!type) {
+        duskPreludeReaderFail(reader);
+    }
+    return type;
+}
+
+// The layout of a struct is computed as soon as it is created, so its fields
+// must be types that have one
+static bool duskPreludeTypeHasLayout(DuskType *type)
+{
+    switch (type->kind) {
+    case DUSK_TYPE_BOOL:
+    case DUSK_TYPE_INT:
+    case DUSK_TYPE_FLOAT:
+    case DUSK_TYPE_VECTOR:
+    case DUSK_TYPE_MATRIX:
+    case DUSK_TYPE_STRUCT: return true;
+    case DUSK_TYPE_ARRAY:
+    case DUSK_TYPE_RUNTIME_ARRAY:
+        return duskPreludeTypeHasLayout(type->array.sub);
+    case DUSK_TYPE_POINTER:
+        return type->pointer.storage_class ==
+               DUSK_STORAGE_CLASS_PHYSICAL_STORAGE;
+    default: return false;
+    }
+}
+
+static DuskType *duskReadType(DuskPreludeReader *reader)
+{
+    uint32_t ref = duskReadWord(reader);
+    if (ref == 0) return NULL;
+    if (ref != DUSK_PRELUDE_NEW_TYPE) {
+        if (ref - 2 >= duskArrayLength(reader->types_arr)) {
+            duskPreludeReaderFail(reader);
+        }
+        return reader->types_arr[ref - 2];
+    }
+
+    DuskCompiler *compiler = reader->compiler;
+    DuskAllocator *allocator = reader->allocator;
+    DuskType *type = NULL;
+
+    DuskTypeKind kind =
+        (DuskTypeKind)duskReadEnum(reader, DUSK_TYPE_STRING + 1);
+    switch (kind) {
+    case DUSK_TYPE_VOID:
+    case DUSK_TYPE_TYPE:
+    case DUSK_TYPE_BOOL:
+    case DUSK_TYPE_UNTYPED_INT:
+    case DUSK_TYPE_UNTYPED_FLOAT:
+    case DUSK_TYPE_SAMPLER:
+    case DUSK_TYPE_STRING: {
+        type = duskTypeNewBasic(compiler, kind);
+        break;
+    }
+    case DUSK_TYPE_INT:
+    case DUSK_TYPE_FLOAT: {
+        DuskScalarType scalar_type = (DuskScalarType)duskReadEnum(
+            reader, DUSK_SCALAR_TYPE_ULONG + 1);
+        type = duskTypeNewScalar(compiler, scalar_type);
+        break;
+    }
+    case DUSK_TYPE_VECTOR: {
+        DuskType *sub = duskReadRequiredType(reader);
+        uint32_t size = duskReadWord(reader);
+        if ((sub->kind != DUSK_TYPE_BOOL && sub->kind != DUSK_TYPE_INT &&
+             sub->kind != DUSK_TYPE_FLOAT) ||
+            size < 1 || size > 4) {
+            duskPreludeReaderFail(reader);
+        }
+        type = duskTypeNewVector(compiler, sub, size);
+        break;
+    }
+    case DUSK_TYPE_MATRIX: {
+        DuskType *col_type = duskReadRequiredType(reader);
+        uint32_t cols = duskReadWord(reader);
+        if (col_type->kind != DUSK_TYPE_VECTOR || cols < 2 || cols > 4) {
+            duskPreludeReaderFail(reader);
+        }
+        type = duskTypeNewMatrix(compiler, col_type, cols);
+        break;
+    }
+    case DUSK_TYPE_RUNTIME_ARRAY: {
+        DuskStructLayout layout = (DuskStructLayout)duskReadEnum(
+            reader, DUSK_STRUCT_LAYOUT_STD430 + 1);
+        DuskType *sub = duskReadRequiredType(reader);
+        type = duskTypeNewRuntimeArray(compiler, layout, sub);
+        break;
+    }
+    case DUSK_TYPE_ARRAY: {
+        DuskStructLayout layout = (DuskStructLayout)duskReadEnum(
+            reader, DUSK_STRUCT_LAYOUT_STD430 + 1);
+        DuskType *sub = duskReadRequiredType(reader);
+        size_t size = (size_t)duskReadU64(reader);
+        type = duskTypeNewArray(compiler, layout, sub, size);
+        break;
+    }
+    case DUSK_TYPE_STRUCT: {
+        const char *name = duskReadString(reader);
+        DuskStructLayout layout = (DuskStructLayout)duskReadEnum(
+            reader, DUSK_STRUCT_LAYOUT_STD430 + 1);
+        bool is_block = duskReadWord(reader) != 0;
+        size_t field_count = duskReadCount(reader);
+        if (field_count == 0) {
+            duskPreludeReaderFail(reader);
+        }
+
+        const char **field_names =
+            DUSK_NEW_ARRAY(allocator, const char *, field_count);
+        DuskType **field_types =
+            DUSK_NEW_ARRAY(allocator, DuskType *, field_count);
+        DuskArray(DuskAttribute) *field_attribute_arrays =
+            DUSK_NEW_ARRAY(allocator, DuskArray(DuskAttribute), field_count);
+        for (size_t i = 0; i < field_count; ++i) {
+            field_names[i] = duskReadString(reader);
+            if (!field_names[i]) {
+                duskPreludeReaderFail(reader);
+            }
+            field_types[i] = duskReadRequiredType(reader);
+            if (!duskPreludeTypeHasLayout(field_types[i])) {
+                duskPreludeReaderFail(reader);
+            }
+            field_attribute_arrays[i] = duskReadAttributes(reader);
+        }
+
+        type = duskTypeNewStruct(
+            compiler,
+            name,
+            layout,
+            is_block,
+            field_count,
+            field_names,
+            field_types,
+            field_attribute_arrays);
+        break;
+    }
+    case DUSK_TYPE_FUNCTION: {
+        DuskType *return_type = duskReadRequiredType(reader);
+        size_t param_type_count = duskReadCount(reader);
+        DuskType **param_types =
+            DUSK_NEW_ARRAY(allocator, DuskType *, param_type_count);
+        for (size_t i = 0; i < param_type_count; ++i) {
+            param_types[i] = duskReadRequiredType(reader);
+        }
+        type = duskTypeNewFunction(
+            compiler, return_type, param_type_count, param_types);
+        break;
+    }
+    case DUSK_TYPE_POINTER: {
+        DuskType *sub = duskReadRequiredType(reader);
+        DuskStorageClass storage_class = (DuskStorageClass)duskReadEnum(
+            reader, DUSK_STORAGE_CLASS_PHYSICAL_STORAGE + 1);
+        uint16_t alignment = (uint16_t)duskReadWord(reader);
+        type = duskTypeNewPointer(compiler, sub, storage_class, alignment);
+        break;
+    }
+    case DUSK_TYPE_IMAGE: {
+        DuskType *sampled_type = duskReadRequiredType(reader);
+        DuskImageDimension dim = (DuskImageDimension)duskReadEnum(
+            reader, DUSK_IMAGE_DIMENSION_CUBE + 1);
+        bool depth = duskReadWord(reader) != 0;
+        bool arrayed = duskReadWord(reader) != 0;
+        bool multisampled = duskReadWord(reader) != 0;
+        bool sampled = duskReadWord(reader) != 0;
+        type = duskTypeNewImage(
+            compiler, sampled_type, dim, depth, arrayed, multisampled, sampled);
+        break;
+    }
+    case DUSK_TYPE_SAMPLED_IMAGE: {
+        DuskType *image_type = duskReadRequiredType(reader);
+        type = duskTypeNewSampledImage(compiler, image_type);
+        break;
+    }
+    }
+
+    duskArrayPush(&reader->types_arr, type);
+    return type;
+}
+
+static DuskConstValue *duskReadConstValue(DuskPreludeReader *reader)
+{
+    DuskConstValue *value = DUSK_NEW(reader->allocator, DuskConstValue);
+    value->type = duskReadRequiredType(reader);
+
+    size_t count = 0;
+    switch (value->type->kind) {
+    case DUSK_TYPE_BOOL: {
+        value->bool_value = duskReadWord(reader) != 0;
+        return value;
+    }
+    case DUSK_TYPE_INT:
+    case DUSK_TYPE_UNTYPED_INT: {
+        value->int_value = duskReadU64(reader);
+        return value;
+    }
+    case DUSK_TYPE_FLOAT:
+    case DUSK_TYPE_UNTYPED_FLOAT: {
+        uint64_t bits = duskReadU64(reader);
+        memcpy(&value->float_value, &bits, sizeof(bits));
+        return value;
+    }
+    case DUSK_TYPE_VECTOR: count = value->type->vector.size; break;
+    case DUSK_TYPE_MATRIX: count = value->type->matrix.cols; break;
+    case DUSK_TYPE_ARRAY: count = value->type->array.size; break;
+    case DUSK_TYPE_STRUCT: count = value->type->struct_.field_count; break;
+    default: duskPreludeReaderFail(reader); break;
+    }
+
+    // Every element takes at least one word
+    if (count > reader->word_count - reader->pos) {
+        duskPreludeReaderFail(reader);
+    }
+
+    value->composite.count = count;
+    value->composite.values =
+        DUSK_NEW_ARRAY(reader->allocator, DuskConstValue *, count);
+    for (size_t i = 0; i < count; ++i) {
+        value->composite.values[i] = duskReadConstValue(reader);
+    }
+    return value;
+}
+
+static DuskArray(DuskExprId) duskReadExprArray(DuskPreludeReader *reader)
+{
+    size_t length = duskReadArrayLength(reader);
+    if (length == 0) return NULL;
+
+    DuskArray(DuskExprId) exprs_arr =
+        duskArrayCreate(reader->allocator, DuskExprId);
+    for (size_t i = 0; i < length - 1; ++i) {
+        DuskExprId expr_id = duskReadExpr(reader);
+        duskArrayPush(&exprs_arr, expr_id);
+    }
+    return exprs_arr;
+}
+
+// The names of the fields in an access chain aren't bound to declarations
+static DuskArray(DuskExprId) duskReadFieldNames(DuskPreludeReader *reader)
+{
+    DuskCompiler *compiler = reader->compiler;
+
+    size_t length = duskReadArrayLength(reader);
+    if (length == 0) return NULL;
+
+    DuskArray(DuskExprId) exprs_arr =
+        duskArrayCreate(reader->allocator, DuskExprId);
+    for (size_t i = 0; i < length - 1; ++i) {
+        DuskExprId expr_id = duskReadUncheckedExpr(reader);
+        DuskExpr *expr = expr_id ? duskExprGet(compiler, expr_id) : NULL;
+        if (!expr || expr->kind != DUSK_EXPR_IDENT ||
+            !compiler->expr_types_arr[expr_id] || !expr->identifier.str) {
+            duskPreludeReaderFail(reader);
+        }
+        duskArrayPush(&exprs_arr, expr_id);
+    }
+    return exprs_arr;
+}
+
+static DuskExprId duskReadUncheckedExpr(DuskPreludeReader *reader)
+{
+    uint32_t kind_word = duskReadEnum(reader, DUSK_EXPR_UNARY + 2);
+    if (kind_word == 0) return 0;
+
+    DuskCompiler *compiler = reader->compiler;
+    DuskAllocator *allocator = reader->allocator;
+
+    DuskExprId expr_id = duskExprCreate(compiler);
+    DuskExpr *expr = duskExprGet(compiler, expr_id);
+    expr->kind = (DuskExprKind)(kind_word - 1);
+    expr->location = duskReadLocation(reader);
+    DuskType *type = duskReadType(reader);
+    DuskType *as_type = duskReadType(reader);
+    compiler->expr_types_arr[expr_id] = type;
+    compiler->expr_as_types_arr[expr_id] = as_type;
+
+    switch (expr->kind) {
+    case DUSK_EXPR_VOID_TYPE:
+    case DUSK_EXPR_BOOL_TYPE: break;
+    case DUSK_EXPR_SCALAR_TYPE: {
+        expr->scalar_type = (DuskScalarType)duskReadEnum(
+            reader, DUSK_SCALAR_TYPE_ULONG + 1);
+        break;
+    }
+    case DUSK_EXPR_VECTOR_TYPE: {
+        expr->vector_type.scalar_type = (DuskScalarType)duskReadEnum(
+            reader, DUSK_SCALAR_TYPE_ULONG + 1);
+        expr->vector_type.length = duskReadWord(reader);
+        break;
+    }
+    case DUSK_EXPR_MATRIX_TYPE: {
+        expr->matrix_type.scalar_type = (DuskScalarType)duskReadEnum(
+            reader, DUSK_SCALAR_TYPE_ULONG + 1);
+        expr->matrix_type.cols = duskReadWord(reader);
+        expr->matrix_type.rows = duskReadWord(reader);
+        break;
+    }
+    case DUSK_EXPR_PTR_TYPE: {
+        expr->ptr_type.storage_class = (DuskStorageClass)duskReadEnum(
+            reader, DUSK_STORAGE_CLASS_PHYSICAL_STORAGE + 1);
+        expr->ptr_type.alignment = (uint16_t)duskReadWord(reader);
+        expr->ptr_type.sub_expr = duskReadRequiredExpr(reader);
+        break;
+    }
+    case DUSK_EXPR_STRING_LITERAL: {
+        expr->string.str = duskReadString(reader);
+        break;
+    }
+    case DUSK_EXPR_INT_LITERAL: {
+        expr->int_literal = (int64_t)duskReadU64(reader);
+        break;
+    }
+    case DUSK_EXPR_FLOAT_LITERAL: {
+        uint64_t bits = duskReadU64(reader);
+        memcpy(&expr->float_literal, &bits, sizeof(bits));
+        break;
+    }
+    case DUSK_EXPR_BOOL_LITERAL: {
+        expr->bool_literal = duskReadWord(reader) != 0;
+        break;
+    }
+    case DUSK_EXPR_STRUCT_LITERAL: {
+        expr->struct_literal.type_expr = duskReadExpr(reader);
+        size_t name_count = duskReadArrayLength(reader);
+        if (name_count > 0) {
+            expr->struct_literal.field_names_arr =
+                duskArrayCreate(allocator, const char *);
+            for (size_t i = 0; i < name_count - 1; ++i) {
+                const char *name = duskReadString(reader);
+                duskArrayPush(&expr->struct_literal.field_names_arr, name);
+            }
+        }
+        expr->struct_literal.field_values_arr = duskReadExprArray(reader);
+        break;
+    }
+    case DUSK_EXPR_ARRAY_LITERAL: {
+        expr->array_literal.type_expr = duskReadExpr(reader);
+        expr->array_literal.field_values_arr = duskReadExprArray(reader);
+        break;
+    }
+    case DUSK_EXPR_IDENT: {
+        expr->identifier.str = duskReadString(reader);
+        expr->identifier.decl = duskReadDeclRef(reader);
+        size_t index_count = duskReadArrayLength(reader);
+        if (index_count > 0) {
+            expr->identifier.shuffle_indices_arr =
+                duskArrayCreate(allocator, uint32_t);
+            for (size_t i = 0; i < index_count - 1; ++i) {
+                uint32_t index = duskReadWord(reader);
+                duskArrayPush(&expr->identifier.shuffle_indices_arr, index);
+            }
+        }
+        break;
+    }
+    case DUSK_EXPR_STRUCT_TYPE: {
+        DuskStructTypeExpr *struct_type =
+            DUSK_NEW(allocator, DuskStructTypeExpr);
+        expr->struct_type = struct_type;
+
+        struct_type->param_count = duskReadCount(reader);
+        struct_type->params =
+            DUSK_NEW_ARRAY(allocator, const char *, struct_type->param_count);
+        for (size_t i = 0; i < struct_type->param_count; ++i) {
+            struct_type->params[i] = duskReadString(reader);
+        }
+
+        struct_type->name = duskReadString(reader);
+        struct_type->field_count = duskReadCount(reader);
+        struct_type->field_names =
+            DUSK_NEW_ARRAY(allocator, const char *, struct_type->field_count);
+        struct_type->field_type_exprs =
+            DUSK_NEW_ARRAY(allocator, DuskExprId, struct_type->field_count);
+        struct_type->field_attribute_arrays = DUSK_NEW_ARRAY(
+            allocator, DuskArray(DuskAttribute), struct_type->field_count);
+        for (size_t i = 0; i < struct_type->field_count; ++i) {
+            struct_type->field_names[i] = duskReadString(reader);
+            struct_type->field_type_exprs[i] = duskReadExpr(reader);
+            struct_type->field_attribute_arrays[i] =
+                duskReadAttributes(reader);
+        }
+        break;
+    }
+    case DUSK_EXPR_ARRAY_TYPE:
+    case DUSK_EXPR_RUNTIME_ARRAY_TYPE: {
+        expr->array_type.sub_expr = duskReadRequiredExpr(reader);
+        expr->array_type.size_expr = duskReadExpr(reader);
+        break;
+    }
+    case DUSK_EXPR_FUNCTION_CALL: {
+        expr->function_call.func_expr = duskReadRequiredExpr(reader);
+        expr->function_call.params_arr = duskReadExprArray(reader);
+        break;
+    }
+    case DUSK_EXPR_BUILTIN_FUNCTION_CALL: {
+        expr->builtin_call.kind = (DuskBuiltinFunctionKind)duskReadEnum(
+            reader, DUSK_BUILTIN_FUNCTION_COUNT);
+        expr->builtin_call.params_arr = duskReadExprArray(reader);
+        break;
+    }
+    case DUSK_EXPR_ACCESS: {
+        expr->access.base_expr = duskReadRequiredExpr(reader);
+        expr->access.chain_arr = duskReadFieldNames(reader);
+        break;
+    }
+    case DUSK_EXPR_ARRAY_ACCESS: {
+        expr->access.base_expr = duskReadRequiredExpr(reader);
+        expr->access.chain_arr = duskReadExprArray(reader);
+        break;
+    }
+    case DUSK_EXPR_BINARY: {
+        expr->binary.op =
+            (DuskBinaryOp)duskReadEnum(reader, DUSK_BINARY_OP_MAX);
+        expr->binary.left = duskReadRequiredExpr(reader);
+        expr->binary.right = duskReadRequiredExpr(reader);
+        break;
+    }
+    case DUSK_EXPR_UNARY: {
+        expr->unary.op =
+            (DuskUnaryOp)duskReadEnum(reader, DUSK_UNARY_OP_BITNOT + 1);
+        expr->unary.right = duskReadRequiredExpr(reader);
+        break;
+    }
+    }
+
+    return expr_id;
+}
+
+// The analysis gives every expression a type, and binds every identifier to
+// its declaration, except for the values of attributes and the names of
+// fields
+static DuskExprId duskReadExpr(DuskPreludeReader *reader)
+{
+    DuskCompiler *compiler = reader->compiler;
+
+    DuskExprId expr_id = duskReadUncheckedExpr(reader);
+    if (!expr_id) return 0;
+
+    DuskExpr *expr = duskExprGet(compiler, expr_id);
+    DuskType *type = compiler->expr_types_arr[expr_id];
+    if (!type ||
+        (type->kind == DUSK_TYPE_TYPE &&
+         !compiler->expr_as_types_arr[expr_id]) ||
+        (expr->kind == DUSK_EXPR_IDENT && !expr->identifier.decl)) {
+        duskPreludeReaderFail(reader);
+    }
+    return expr_id;
+}
+
+static DuskExprId duskReadRequiredExpr(DuskPreludeReader *reader)
+{
+    DuskExprId expr_id = duskReadExpr(reader);
+    if (!expr_id) {
+        duskPreludeReaderFail(reader);
+    }
+    return expr_id;
+}
+
+static DuskDeclId duskReadDecl(DuskPreludeReader *reader);
+static DuskStmtId duskReadRequiredStmt(DuskPreludeReader *reader);
+
+static DuskStmtId duskReadStmt(DuskPreludeReader *reader)
+{
+    uint32_t kind_word = duskReadEnum(reader, DUSK_STMT_BREAK + 2);
+    if (kind_word == 0) return 0;
+
+    DuskStmtId stmt_id = duskStmtCreate(reader->compiler);
+    DuskStmt *stmt = duskStmtGet(reader->compiler, stmt_id);
+    stmt->kind = (DuskStmtKind)(kind_word - 1);
+    stmt->location = duskReadLocation(reader);
+
+    switch (stmt->kind) {
+    case DUSK_STMT_DECL: {
+        stmt->decl = duskReadDecl(reader);
+        break;
+    }
+    case DUSK_STMT_ASSIGN: {
+        stmt->assign.assigned_expr = duskReadRequiredExpr(reader);
+        stmt->assign.value_expr = duskReadRequiredExpr(reader);
+        break;
+    }
+    case DUSK_STMT_EXPR: {
+        stmt->expr = duskReadRequiredExpr(reader);
+        break;
+    }
+    case DUSK_STMT_BLOCK: {
+        size_t length = duskReadArrayLength(reader);
+        if (length > 0) {
+            stmt->block.stmts_arr =
+                duskArrayCreate(reader->allocator, DuskStmtId);
+            for (size_t i = 0; i < length - 1; ++i) {
+                DuskStmtId sub_stmt_id = duskReadRequiredStmt(reader);
+                duskArrayPush(&stmt->block.stmts_arr, sub_stmt_id);
+            }
+        }
+        break;
+    }
+    case DUSK_STMT_RETURN: {
+        stmt->return_.expr = duskReadExpr(reader);
+        break;
+    }
+    case DUSK_STMT_IF: {
+        stmt->if_.cond_expr = duskReadRequiredExpr(reader);
+        stmt->if_.true_stmt = duskReadRequiredStmt(reader);
+        stmt->if_.false_stmt = duskReadStmt(reader);
+        break;
+    }
+    case DUSK_STMT_WHILE: {
+        stmt->while_.attributes_arr = duskReadAttributes(reader);
+        stmt->while_.cond_expr = duskReadRequiredExpr(reader);
+        stmt->while_.stmt = duskReadRequiredStmt(reader);
+        stmt->while_.unroll_hint = (DuskIRUnrollHint)duskReadEnum(
+            reader, DUSK_IR_UNROLL_NEVER + 1);
+        stmt->while_.unroll_count = duskReadWord(reader);
+        break;
+    }
+    case DUSK_STMT_DISCARD:
+    case DUSK_STMT_CONTINUE:
+    case DUSK_STMT_BREAK: break;
+    }
+
+    return stmt_id;
+}
+
+static DuskStmtId duskReadRequiredStmt(DuskPreludeReader *reader)
+{
+    DuskStmtId stmt_id = duskReadStmt(reader);
+    if (!stmt_id) {
+        duskPreludeReaderFail(reader);
+    }
+    return stmt_id;
+}
+
+static DuskDeclId duskReadDecl(DuskPreludeReader *reader)
+{
+    if (reader->next_decl >= reader->decl_count) {
+        duskPreludeReaderFail(reader);
+    }
+    reader->decl_owners[reader->next_decl] = reader->owner;
+    DuskDeclId decl_id = reader->decls[reader->next_decl++];
+    DuskDecl *decl = duskDeclGet(reader->compiler, decl_id);
+
+    decl->kind = (DuskDeclKind)duskReadEnum(reader, DUSK_DECL_CONST + 1);
+    decl->location = duskReadLocation(reader);
+    decl->name = duskReadString(reader);
+    decl->attributes_arr = duskReadAttributes(reader);
+    DuskType *type = duskReadType(reader);
+    reader->compiler->decl_types_arr[decl_id] = type;
+
+    switch (decl->kind) {
+    case DUSK_DECL_FUNCTION: {
+        decl->function.is_entry_point = duskReadWord(reader) != 0;
+        decl->function.entry_point_stage = (DuskShaderStage)duskReadEnum(
+            reader, DUSK_SHADER_STAGE_COMPUTE + 1);
+        decl->function.inline_hint = (DuskIRInlineHint)duskReadEnum(
+            reader, DUSK_IR_INLINE_NEVER + 1);
+        decl->function.link_name = duskReadString(reader);
+
+        size_t param_count = duskReadArrayLength(reader);
+        if (param_count > 0) {
+            decl->function.parameter_decls_arr =
+                duskArrayCreate(reader->allocator, DuskDeclId);
+            for (size_t i = 0; i < param_count - 1; ++i) {
+                DuskDeclId param_decl_id = duskReadDecl(reader);
+                duskArrayPush(
+                    &decl->function.parameter_decls_arr, param_decl_id);
+            }
+        }
+
+        decl->function.return_type_expr = duskReadExpr(reader);
+        decl->function.return_type_attributes_arr = duskReadAttributes(reader);
+
+        size_t stmt_count = duskReadArrayLength(reader);
+        if (stmt_count > 0) {
+            decl->function.stmts_arr =
+                duskArrayCreate(reader->allocator, DuskStmtId);
+            for (size_t i = 0; i < stmt_count - 1; ++i) {
+                DuskStmtId stmt_id = duskReadRequiredStmt(reader);
+                duskArrayPush(&decl->function.stmts_arr, stmt_id);
+            }
+        }
+        break;
+    }
+    case DUSK_DECL_VAR: {
+        decl->var.type_expr = duskReadExpr(reader);
+        decl->var.value_expr = duskReadExpr(reader);
+        decl->var.storage_class = (DuskStorageClass)duskReadEnum(
+            reader, DUSK_STORAGE_CLASS_PHYSICAL_STORAGE + 1);
+        decl->var.read_only = duskReadWord(reader) != 0;
+        break;
+    }
+    case DUSK_DECL_TYPE: {
+        decl->typedef_.type_expr = duskReadRequiredExpr(reader);
+        break;
+    }
+    case DUSK_DECL_CONST: {
+        decl->const_.type_expr = duskReadExpr(reader);
+        decl->const_.value_expr = duskReadRequiredExpr(reader);
+        decl->const_.value = duskReadConstValue(reader);
+        break;
+    }
+    }
+
+    return decl_id;
+}
+
+DuskFile *duskPreludeRead(
+    DuskCompiler *compiler,
+    const uint8_t *blob,
+    size_t blob_byte_size,
+    DuskScope *parent_scope)
+{
+    DuskAllocator *allocator = duskArenaGetAllocator(compiler->main_arena);
+
+    DuskPreludeHeader header;
+    if (((uintptr_t)blob % sizeof(uint32_t)) != 0 ||
+        blob_byte_size < sizeof(header)) {
+        return NULL;
+    }
+    memcpy(&header, blob, sizeof(header));
+
+    if (header.magic != DUSK_PRELUDE_MAGIC ||
+        header.version != DUSK_PRELUDE_VERSION ||
+        (uint64_t)header.word_count * sizeof(uint32_t) +
+                header.string_table_size !=
+            blob_byte_size - sizeof(header) ||
+        header.top_level_decl_count > header.decl_count ||
+        header.decl_count > header.word_count ||
+        header.checksum != duskPreludeChecksum(
+                               blob + sizeof(header),
+                               blob_byte_size - sizeof(header))) {
+        return NULL;
+    }
+
+    const char *strings = (const char *)blob + sizeof(header) +
+                          header.word_count * sizeof(uint32_t);
+    if (header.string_table_size > 0 &&
+        strings[header.string_table_size - 1] != '\0') {
+        return NULL;
+    }
+
+    DuskPreludeReader *reader = DUSK_NEW(allocator, DuskPreludeReader);
+    *reader = (DuskPreludeReader){
+        .compiler = compiler,
+        .allocator = allocator,
+        .parent_scope = parent_scope,
+        .words = (const uint32_t *)(blob + sizeof(header)),
+        .word_count = header.word_count,
+        .strings = strings,
+        .string_table_size = header.string_table_size,
+        .types_arr = duskArrayCreate(allocator, DuskType *),
+        .decls = DUSK_NEW_ARRAY(allocator, DuskDeclId, header.decl_count),
+        .decl_count = header.decl_count,
+        .decl_owners = DUSK_NEW_ARRAY(allocator, uint32_t, header.decl_count),
+        .forward_refs_arr = duskArrayCreate(allocator, uint32_t),
+        .integer_exprs_arr = duskArrayCreate(allocator, DuskExprId),
+    };
+
+    DuskFile *file = DUSK_NEW(allocator, DuskFile);
+    *file = (DuskFile){
+        .decls_arr = duskArrayCreate(allocator, DuskDeclId),
+        .scope = duskScopeCreate(
+            allocator, parent_scope, DUSK_SCOPE_OWNER_TYPE_NONE, 0),
+    };
+    reader->file = file;
+
+    if (setjmp(reader->jump_buffer) != 0) {
+        return NULL;
+    }
+
+    if (header.path != 0) {
+        if (header.path - 1 >= header.string_table_size) {
+            return NULL;
+        }
+        file->path = &strings[header.path - 1];
+    }
+
+    // Declarations can be referenced before they are read
+    for (size_t i = 0; i < reader->decl_count; ++i) {
+        reader->decls[i] = duskDeclCreate(compiler);
+    }
+
+    for (size_t i = 0; i < header.top_level_decl_count; ++i) {
+        reader->owner = (uint32_t)reader->next_decl;
+        DuskDeclId decl_id = duskReadDecl(reader);
+        DuskDecl *decl = duskDeclGet(compiler, decl_id);
+        if (!decl->name) {
+            duskPreludeReaderFail(reader);
+        }
+
+        size_t name_count = duskReadCount(reader);
+        decl->referenced_names = duskMapCreate(allocator, name_count + 1);
+        for (size_t j = 0; j < name_count; ++j) {
+            const char *name = duskReadString(reader);
+            if (!name) {
+                duskPreludeReaderFail(reader);
+            }
+            duskMapSet(decl->referenced_names, name, NULL);
+        }
+
+        duskArrayPush(&file->decls_arr, decl_id);
+        duskScopeSet(file->scope, decl->name, decl_id);
+    }
+
+    if (reader->pos != reader->word_count ||
+        reader->next_decl != reader->decl_count) {
+        return NULL;
+    }
+
+    for (size_t i = 0; i < duskArrayLength(reader->forward_refs_arr); ++i) {
+        uint32_t index = reader->forward_refs_arr[i];
+        if (reader->decl_owners[index] != index) return NULL;
+    }
+
+    for (size_t i = 0; i < duskArrayLength(reader->integer_exprs_arr); ++i) {
+        int64_t value = 0;
+        DuskConstValue *const_value = duskConstEvaluate(
+            compiler, allocator, reader->integer_exprs_arr[i]);
+        if (!duskConstToInteger(const_value, &value)) return NULL;
+    }
+
+    return file;
+}
+// }}}
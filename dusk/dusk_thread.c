@@ -0,0 +1,185 @@
+#include "dusk_internal.h"
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#endif
+
+struct DuskThread {
+    DuskAllocator *allocator;
+    void (*func)(void *user_data);
+    void *user_data;
+#if defined(_WIN32)
+    HANDLE handle;
+#else
+    pthread_t handle;
+#endif
+};
+
+struct DuskMutex {
+    DuskAllocator *allocator;
+#if defined(_WIN32)
+    SRWLOCK lock;
+#else
+    pthread_mutex_t lock;
+#endif
+};
+
+#if defined(_WIN32)
+static DWORD WINAPI _duskThreadEntry(LPVOID param)
+{
+    DuskThread *thread = (DuskThread *)param;
+    thread->func(thread->user_data);
+    return 0;
+}
+#else
+static void *_duskThreadEntry(void *param)
+{
+    DuskThread *thread = (DuskThread *)param;
+    thread->func(thread->user_data);
+    return NULL;
+}
+#endif
+
+DuskThread *duskThreadCreate(
+    DuskAllocator *allocator, void (*func)(void *user_data), void *user_data)
+{
+    DuskThread *thread = DUSK_NEW(allocator, DuskThread);
+    thread->allocator = allocator;
+    thread->func = func;
+    thread->user_data = user_data;
+
+#if defined(_WIN32)
+    thread->handle = CreateThread(NULL, 0, _duskThreadEntry, thread, 0, NULL);
+    if (thread->handle == NULL) {
+        duskFree(allocator, thread);
+        return NULL;
+    }
+#else
+    if (pthread_create(&thread->handle, NULL, _duskThreadEntry, thread) != 0) {
+        duskFree(allocator, thread);
+        return NULL;
+    }
+#endif
+
+    return thread;
+}
+
+void duskThreadJoin(DuskThread *thread)
+{
+#if defined(_WIN32)
+    WaitForSingleObject(thread->handle, INFINITE);
+    CloseHandle(thread->handle);
+#else
+    pthread_join(thread->handle, NULL);
+#endif
+    duskFree(thread->allocator, thread);
+}
+
+DuskMutex *duskMutexCreate(DuskAllocator *allocator)
+{
+    DuskMutex *mutex = DUSK_NEW(allocator, DuskMutex);
+    mutex->allocator = allocator;
+
+#if defined(_WIN32)
+    InitializeSRWLock(&mutex->lock);
+#else
+    if (pthread_mutex_init(&mutex->lock, NULL) != 0) {
+        duskFree(allocator, mutex);
+        return NULL;
+    }
+#endif
+
+    return mutex;
+}
+
+void duskMutexDestroy(DuskMutex *mutex)
+{
+#if !defined(_WIN32)
+    pthread_mutex_destroy(&mutex->lock);
+#endif
+    duskFree(mutex->allocator, mutex);
+}
+
+void duskMutexLock(DuskMutex *mutex)
+{
+#if defined(_WIN32)
+    AcquireSRWLockExclusive(&mutex->lock);
+#else
+    pthread_mutex_lock(&mutex->lock);
+#endif
+}
+
+void duskMutexUnlock(DuskMutex *mutex)
+{
+#if defined(_WIN32)
+    ReleaseSRWLockExclusive(&mutex->lock);
+#else
+    pthread_mutex_unlock(&mutex->lock);
+#endif
+}
+
+enum {
+    DUSK_ONCE_NOT_CALLED,
+    DUSK_ONCE_RUNNING,
+    DUSK_ONCE_DONE,
+};
+
+void duskCallOnce(DuskOnce *once, void (*func)(void))
+{
+#if defined(_WIN32)
+    if (InterlockedCompareExchange(&once->state, 0, 0) == DUSK_ONCE_DONE) {
+        return;
+    }
+
+    if (InterlockedCompareExchange(
+            &once->state, DUSK_ONCE_RUNNING, DUSK_ONCE_NOT_CALLED) ==
+        DUSK_ONCE_NOT_CALLED) {
+        func();
+        InterlockedExchange(&once->state, DUSK_ONCE_DONE);
+        return;
+    }
+
+    while (InterlockedCompareExchange(&once->state, 0, 0) != DUSK_ONCE_DONE) {
+        SwitchToThread();
+    }
+#else
+    if (__atomic_load_n(&once->state, __ATOMIC_ACQUIRE) == DUSK_ONCE_DONE) {
+        return;
+    }
+
+    long expected = DUSK_ONCE_NOT_CALLED;
+    if (__atomic_compare_exchange_n(
+            &once->state,
+            &expected,
+            DUSK_ONCE_RUNNING,
+            false,
+            __ATOMIC_ACQ_REL,
+            __ATOMIC_ACQUIRE)) {
+        func();
+        __atomic_store_n(&once->state, DUSK_ONCE_DONE, __ATOMIC_RELEASE);
+        return;
+    }
+
+    while (__atomic_load_n(&once->state, __ATOMIC_ACQUIRE) != DUSK_ONCE_DONE) {
+        sched_yield();
+    }
+#endif
+}
+
+uint32_t duskGetProcessorCount(void)
+{
+#if defined(_WIN32)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (uint32_t)info.dwNumberOfProcessors;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    if (count < 1) return 1;
+    return (uint32_t)count;
+#endif
+}
@@ -32,12 +32,18 @@ const char *duskTypeToPrettyString(DuskAllocator *allocator, DuskType *type)
     case DUSK_TYPE_INT: {
         if (type->int_.is_signed) {
             switch (type->int_.bits) {
+            case 8: type->pretty_string = "byte"; break;
+            case 16: type->pretty_string = "short"; break;
             case 32: type->pretty_string = "int"; break;
+            case 64: type->pretty_string = "long"; break;
             default: DUSK_ASSERT(0); break;
             }
         } else {
             switch (type->int_.bits) {
+            case 8: type->pretty_string = "ubyte"; break;
+            case 16: type->pretty_string = "ushort"; break;
             case 32: type->pretty_string = "uint"; break;
+            case 64: type->pretty_string = "ulong"; break;
             default: DUSK_ASSERT(0); break;
             }
         }
@@ -45,6 +51,7 @@ const char *duskTypeToPrettyString(DuskAllocator *allocator, DuskType *type)
     }
     case DUSK_TYPE_FLOAT: {
         switch (type->float_.bits) {
+        case 16: type->pretty_string = "half"; break;
         case 32: type->pretty_string = "float"; break;
         case 64: type->pretty_string = "double"; break;
         default: DUSK_ASSERT(0); break;
@@ -402,25 +409,485 @@ const char *duskTypeToString(DuskAllocator *allocator, DuskType *type)
     return type->string;
 }
 
-static DuskType *duskTypeGetCached(DuskCompiler *compiler, DuskType *type)
+static uint64_t duskTypeHashMix(uint64_t hash, uint64_t value)
 {
-    DuskAllocator *allocator = duskArenaGetAllocator(compiler->main_arena);
-    const char *type_str = duskTypeToString(allocator, type);
+    hash ^= value;
+    hash *= 0x9e3779b97f4a7c15ULL;
+    return hash ^ (hash >> 32);
+}
+
+static uint64_t duskTypeHashString(uint64_t hash, const char *str)
+{
+    for (size_t i = 0; str[i]; ++i) {
+        hash ^= (uint8_t)str[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static uint64_t duskTypeHash(DuskType *type)
+{
+    uint64_t hash = duskTypeHashMix(14695981039346656037ULL, type->kind);
+
+    switch (type->kind) {
+    case DUSK_TYPE_VOID:
+    case DUSK_TYPE_TYPE:
+    case DUSK_TYPE_BOOL:
+    case DUSK_TYPE_UNTYPED_INT:
+    case DUSK_TYPE_UNTYPED_FLOAT:
+    case DUSK_TYPE_STRING:
+    case DUSK_TYPE_SAMPLER: break;
+    case DUSK_TYPE_INT: {
+        hash = duskTypeHashMix(hash, type->int_.bits);
+        hash = duskTypeHashMix(hash, type->int_.is_signed);
+        break;
+    }
+    case DUSK_TYPE_FLOAT: {
+        hash = duskTypeHashMix(hash, type->float_.bits);
+        break;
+    }
+    case DUSK_TYPE_VECTOR: {
+        hash = duskTypeHashMix(hash, (uintptr_t)type->vector.sub);
+        hash = duskTypeHashMix(hash, type->vector.size);
+        break;
+    }
+    case DUSK_TYPE_MATRIX: {
+        hash = duskTypeHashMix(hash, (uintptr_t)type->matrix.col_type);
+        hash = duskTypeHashMix(hash, type->matrix.cols);
+        break;
+    }
+    case DUSK_TYPE_RUNTIME_ARRAY:
+    case DUSK_TYPE_ARRAY: {
+        hash = duskTypeHashMix(hash, (uintptr_t)type->array.sub);
+        hash = duskTypeHashMix(hash, type->array.size);
+        hash = duskTypeHashMix(hash, type->array.layout);
+        break;
+    }
+    case DUSK_TYPE_STRUCT: {
+        // Named structs are identified by their name alone
+        if (type->struct_.name) {
+            hash = duskTypeHashString(hash, type->struct_.name);
+            break;
+        }
+
+        hash = duskTypeHashMix(hash, type->struct_.layout);
+        hash = duskTypeHashMix(hash, type->struct_.is_block);
+        hash = duskTypeHashMix(hash, type->struct_.field_count);
+        for (size_t i = 0; i < type->struct_.field_count; ++i) {
+            hash = duskTypeHashMix(
+                hash, (uintptr_t)type->struct_.field_types[i]);
+        }
+        break;
+    }
+    case DUSK_TYPE_FUNCTION: {
+        hash = duskTypeHashMix(hash, (uintptr_t)type->function.return_type);
+        hash = duskTypeHashMix(hash, type->function.param_type_count);
+        for (size_t i = 0; i < type->function.param_type_count; ++i) {
+            hash = duskTypeHashMix(
+                hash, (uintptr_t)type->function.param_types[i]);
+        }
+        break;
+    }
+    case DUSK_TYPE_POINTER: {
+        hash = duskTypeHashMix(hash, (uintptr_t)type->pointer.sub);
+        hash = duskTypeHashMix(hash, type->pointer.storage_class);
+        break;
+    }
+    case DUSK_TYPE_IMAGE: {
+        hash = duskTypeHashMix(hash, (uintptr_t)type->image.sampled_type);
+        hash = duskTypeHashMix(hash, type->image.dim);
+        hash = duskTypeHashMix(hash, type->image.depth);
+        hash = duskTypeHashMix(hash, type->image.arrayed);
+        hash = duskTypeHashMix(hash, type->image.multisampled);
+        hash = duskTypeHashMix(hash, type->image.sampled);
+        break;
+    }
+    case DUSK_TYPE_SAMPLED_IMAGE: {
+        hash = duskTypeHashMix(
+            hash, (uintptr_t)type->sampled_image.image_type);
+        break;
+    }
+    }
+
+    // Zero marks an empty slot
+    return hash ? hash : 1;
+}
+
+// Compares the parts of the types that make up their identity, which are the
+// same ones that duskTypeHash and duskTypeToString look at
+static bool duskTypeEquals(DuskType *a, DuskType *b)
+{
+    if (a->kind != b->kind) return false;
+
+    switch (a->kind) {
+    case DUSK_TYPE_VOID:
+    case DUSK_TYPE_TYPE:
+    case DUSK_TYPE_BOOL:
+    case DUSK_TYPE_UNTYPED_INT:
+    case DUSK_TYPE_UNTYPED_FLOAT:
+    case DUSK_TYPE_STRING:
+    case DUSK_TYPE_SAMPLER: return true;
+    case DUSK_TYPE_INT: {
+        return a->int_.bits == b->int_.bits &&
+               a->int_.is_signed == b->int_.is_signed;
+    }
+    case DUSK_TYPE_FLOAT: {
+        return a->float_.bits == b->float_.bits;
+    }
+    case DUSK_TYPE_VECTOR: {
+        return a->vector.sub == b->vector.sub &&
+               a->vector.size == b->vector.size;
+    }
+    case DUSK_TYPE_MATRIX: {
+        return a->matrix.col_type == b->matrix.col_type &&
+               a->matrix.cols == b->matrix.cols;
+    }
+    case DUSK_TYPE_RUNTIME_ARRAY:
+    case DUSK_TYPE_ARRAY: {
+        return a->array.sub == b->array.sub &&
+               a->array.size == b->array.size &&
+               a->array.layout == b->array.layout;
+    }
+    case DUSK_TYPE_STRUCT: {
+        if (a->struct_.name || b->struct_.name) {
+            return a->struct_.name && b->struct_.name &&
+                   strcmp(a->struct_.name, b->struct_.name) == 0;
+        }
+
+        if (a->struct_.layout != b->struct_.layout ||
+            a->struct_.is_block != b->struct_.is_block ||
+            a->struct_.field_count != b->struct_.field_count) {
+            return false;
+        }
+        for (size_t i = 0; i < a->struct_.field_count; ++i) {
+            if (a->struct_.field_types[i] != b->struct_.field_types[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+    case DUSK_TYPE_FUNCTION: {
+        if (a->function.return_type != b->function.return_type ||
+            a->function.param_type_count != b->function.param_type_count) {
+            return false;
+        }
+        for (size_t i = 0; i < a->function.param_type_count; ++i) {
+            if (a->function.param_types[i] != b->function.param_types[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+    case DUSK_TYPE_POINTER: {
+        return a->pointer.sub == b->pointer.sub &&
+               a->pointer.storage_class == b->pointer.storage_class;
+    }
+    case DUSK_TYPE_IMAGE: {
+        return a->image.sampled_type == b->image.sampled_type &&
+               a->image.dim == b->image.dim &&
+               a->image.depth == b->image.depth &&
+               a->image.arrayed == b->image.arrayed &&
+               a->image.multisampled == b->image.multisampled &&
+               a->image.sampled == b->image.sampled;
+    }
+    case DUSK_TYPE_SAMPLED_IMAGE: {
+        return a->sampled_image.image_type == b->sampled_image.image_type;
+    }
+    }
+
+    return false;
+}
+
+void duskTypeCacheInit(
+    DuskTypeCache *cache, DuskAllocator *allocator, size_t size)
+{
+    DUSK_ASSERT(size > 0 && (size & (size - 1)) == 0);
+
+    *cache = (DuskTypeCache){
+        .allocator = allocator,
+        .slots = DUSK_NEW_ARRAY(allocator, DuskTypeCacheSlot, size),
+        .size = size,
+    };
+}
+
+static void
+duskTypeCacheInsert(DuskTypeCache *cache, uint64_t hash, DuskType *type)
+{
+    // Keep the load factor at or below one half
+    if ((cache->count + 1) * 2 > cache->size) {
+        DuskTypeCacheSlot *old_slots = cache->slots;
+        uint64_t old_size = cache->size;
+
+        cache->size *= 2;
+        cache->count = 0;
+        cache->slots =
+            DUSK_NEW_ARRAY(cache->allocator, DuskTypeCacheSlot, cache->size);
+
+        for (uint64_t i = 0; i < old_size; ++i) {
+            DuskTypeCacheSlot *slot = &old_slots[i];
+            if (slot->type) duskTypeCacheInsert(cache, slot->hash, slot->type);
+        }
+        duskFree(cache->allocator, old_slots);
+    }
 
-    DuskType *existing_type = NULL;
-    if (duskMapGet(compiler->type_cache, type_str, (void **)&existing_type)) {
-        DUSK_ASSERT(existing_type != NULL);
-        return existing_type;
+    uint64_t i = hash & (cache->size - 1);
+    while (cache->slots[i].type) {
+        i = (i + 1) & (cache->size - 1);
     }
 
-    duskMapSet(compiler->type_cache, type_str, type);
-    duskArrayPush(&compiler->types_arr, type);
+    cache->slots[i].hash = hash;
+    cache->slots[i].type = type;
+    cache->count++;
+}
 
-    type->decorations_arr = duskArrayCreate(allocator, DuskIRDecoration);
+static DuskType *
+duskTypeCacheFind(DuskTypeCache *cache, uint64_t hash, DuskType *key)
+{
+    uint64_t i = hash & (cache->size - 1);
+    while (cache->slots[i].type) {
+        DuskTypeCacheSlot *slot = &cache->slots[i];
+        if (slot->hash == hash && duskTypeEquals(slot->type, key)) {
+            return slot->type;
+        }
+        i = (i + 1) & (cache->size - 1);
+    }
+    return NULL;
+}
 
+DuskType *duskTypeCacheGet(DuskTypeCache *cache, DuskType *key)
+{
+    return duskTypeCacheFind(cache, duskTypeHash(key), key);
+}
+
+void duskTypeCacheAdd(DuskTypeCache *cache, DuskType *type)
+{
+    duskTypeCacheInsert(cache, duskTypeHash(type), type);
+}
+
+// Builtin scalar, vector, matrix, sampler and image types, shared by every
+// compiler in the process. They're created once, with everything that is
+// memoized in a type already computed, and never modified afterwards, so they
+// can be used from any thread without locking.
+typedef struct DuskTypePool {
+    DuskArena *arena;
+    DuskTypeCache cache;
+    uint32_t type_count;
+} DuskTypePool;
+
+static DuskTypePool g_type_pool;
+static DuskOnce g_type_pool_once;
+
+static DuskType *duskTypePoolAdd(DuskType *key)
+{
+    DuskTypeCache *cache = &g_type_pool.cache;
+    uint64_t hash = duskTypeHash(key);
+    DuskType *type = duskTypeCacheFind(cache, hash, key);
+    if (type) return type;
+
+    DuskAllocator *allocator = duskArenaGetAllocator(g_type_pool.arena);
+    type = DUSK_NEW(allocator, DuskType);
+    *type = *key;
+    type->index = g_type_pool.type_count++;
+
+    duskTypeToString(allocator, type);
+    duskTypeToPrettyString(allocator, type);
+    for (uint32_t layout = 0; layout < DUSK_STRUCT_LAYOUT_COUNT; ++layout) {
+        duskTypeSizeOf(allocator, type, (DuskStructLayout)layout);
+        duskTypeAlignOf(allocator, type, (DuskStructLayout)layout);
+    }
+
+    duskTypeCacheInsert(cache, hash, type);
+    return type;
+}
+
+static void duskTypePoolInit(void)
+{
+    g_type_pool.arena = duskArenaCreate(NULL, 1 << 14);
+    duskTypeCacheInit(
+        &g_type_pool.cache, duskArenaGetAllocator(g_type_pool.arena), 512);
+
+    static const DuskTypeKind basic_kinds[] = {
+        DUSK_TYPE_VOID,
+        DUSK_TYPE_TYPE,
+        DUSK_TYPE_BOOL,
+        DUSK_TYPE_UNTYPED_INT,
+        DUSK_TYPE_UNTYPED_FLOAT,
+        DUSK_TYPE_STRING,
+        DUSK_TYPE_SAMPLER,
+    };
+    for (size_t i = 0; i < DUSK_CARRAY_LENGTH(basic_kinds); ++i) {
+        DuskType key = {.kind = basic_kinds[i]};
+        duskTypePoolAdd(&key);
+    }
+
+    DuskType bool_key = {.kind = DUSK_TYPE_BOOL};
+    DuskType *scalar_types[12] = {duskTypePoolAdd(&bool_key)};
+    size_t scalar_count = 1;
+    for (uint32_t bits = 8; bits <= 64; bits *= 2) {
+        DuskType key = {.kind = DUSK_TYPE_INT};
+        key.int_.bits = bits;
+        key.int_.is_signed = true;
+        scalar_types[scalar_count++] = duskTypePoolAdd(&key);
+        key.int_.is_signed = false;
+        scalar_types[scalar_count++] = duskTypePoolAdd(&key);
+    }
+    for (uint32_t bits = 16; bits <= 64; bits *= 2) {
+        DuskType key = {.kind = DUSK_TYPE_FLOAT};
+        key.float_.bits = bits;
+        scalar_types[scalar_count++] = duskTypePoolAdd(&key);
+    }
+    DUSK_ASSERT(scalar_count == DUSK_CARRAY_LENGTH(scalar_types));
+
+    for (size_t i = 0; i < scalar_count; ++i) {
+        for (uint32_t size = 2; size <= 4; ++size) {
+            DuskType key = {.kind = DUSK_TYPE_VECTOR};
+            key.vector.sub = scalar_types[i];
+            key.vector.size = size;
+            DuskType *col_type = duskTypePoolAdd(&key);
+
+            if (scalar_types[i]->kind != DUSK_TYPE_FLOAT) continue;
+
+            for (uint32_t cols = 2; cols <= 4; ++cols) {
+                DuskType matrix_key = {.kind = DUSK_TYPE_MATRIX};
+                matrix_key.matrix.col_type = col_type;
+                matrix_key.matrix.cols = cols;
+                duskTypePoolAdd(&matrix_key);
+            }
+        }
+    }
+
+    // The image types that can be declared with a scalar type of the same
+    // size as the texel components
+    DuskType void_key = {.kind = DUSK_TYPE_VOID};
+    DuskType float_key = {.kind = DUSK_TYPE_FLOAT};
+    float_key.float_.bits = 32;
+    DuskType int_key = {.kind = DUSK_TYPE_INT};
+    int_key.int_.bits = 32;
+    int_key.int_.is_signed = true;
+    DuskType uint_key = int_key;
+    uint_key.int_.is_signed = false;
+    DuskType *sampled_types[] = {
+        duskTypePoolAdd(&void_key),
+        duskTypePoolAdd(&float_key),
+        duskTypePoolAdd(&int_key),
+        duskTypePoolAdd(&uint_key),
+    };
+
+    static const struct {
+        DuskImageDimension dim;
+        bool arrayed;
+    } image_shapes[] = {
+        {DUSK_IMAGE_DIMENSION_1D, false},
+        {DUSK_IMAGE_DIMENSION_2D, false},
+        {DUSK_IMAGE_DIMENSION_2D, true},
+        {DUSK_IMAGE_DIMENSION_3D, false},
+        {DUSK_IMAGE_DIMENSION_CUBE, false},
+        {DUSK_IMAGE_DIMENSION_CUBE, true},
+    };
+    for (size_t i = 0; i < DUSK_CARRAY_LENGTH(sampled_types); ++i) {
+        for (size_t j = 0; j < DUSK_CARRAY_LENGTH(image_shapes); ++j) {
+            DuskType key = {.kind = DUSK_TYPE_IMAGE};
+            key.image.sampled_type = sampled_types[i];
+            key.image.dim = image_shapes[j].dim;
+            key.image.arrayed = (uint32_t)image_shapes[j].arrayed;
+            key.image.sampled = 1;
+
+            DuskType sampled_image_key = {.kind = DUSK_TYPE_SAMPLED_IMAGE};
+            sampled_image_key.sampled_image.image_type = duskTypePoolAdd(&key);
+            duskTypePoolAdd(&sampled_image_key);
+        }
+    }
+}
+
+static DuskTypePool *duskGetTypePool(void)
+{
+    duskCallOnce(&g_type_pool_once, duskTypePoolInit);
+    return &g_type_pool;
+}
+
+uint32_t duskTypeBuiltinCount(void)
+{
+    return duskGetTypePool()->type_count;
+}
+
+// Worker threads intern their types in the compiler they were copied from.
+// Returns the compiler whose cache should be used, locking it if needed.
+static DuskCompiler *duskTypeLockOwner(DuskCompiler *compiler)
+{
+    if (!compiler->type_owner) return compiler;
+    duskMutexLock(compiler->type_owner->type_mutex);
+    return compiler->type_owner;
+}
+
+static void duskTypeUnlockOwner(DuskCompiler *compiler)
+{
+    if (!compiler->type_owner) return;
+    duskMutexUnlock(compiler->type_owner->type_mutex);
+}
+
+static DuskType *duskTypeRequested(DuskCompiler *compiler, DuskType *type)
+{
+    if (compiler->requested_types_arr) {
+        duskArrayPush(&compiler->requested_types_arr, type);
+    }
     return type;
 }
 
+// Returns the interned type equal to key, or NULL if there is none
+static DuskType *duskTypeFindCached(DuskCompiler *compiler, DuskType *key)
+{
+    uint64_t hash = duskTypeHash(key);
+
+    DuskType *existing_type =
+        duskTypeCacheFind(&duskGetTypePool()->cache, hash, key);
+    if (!existing_type) {
+        DuskCompiler *owner = duskTypeLockOwner(compiler);
+        existing_type = duskTypeCacheFind(&owner->type_cache, hash, key);
+        duskTypeUnlockOwner(compiler);
+    }
+
+    if (!existing_type) return NULL;
+    return duskTypeRequested(compiler, existing_type);
+}
+
+// Returns the interned type equal to key, copying key into a new type if there
+// is none. Key can live on the stack, so looking up an existing type doesn't
+// allocate anything.
+static DuskType *duskTypeGetCached(DuskCompiler *compiler, DuskType *key)
+{
+    uint64_t hash = duskTypeHash(key);
+
+    DuskTypePool *pool = duskGetTypePool();
+    DuskType *type = duskTypeCacheFind(&pool->cache, hash, key);
+    if (type) return duskTypeRequested(compiler, type);
+
+    DuskCompiler *owner = duskTypeLockOwner(compiler);
+    type = duskTypeCacheFind(&owner->type_cache, hash, key);
+    if (!type) {
+        DuskAllocator *allocator = duskArenaGetAllocator(owner->main_arena);
+        type = DUSK_NEW(allocator, DuskType);
+        *type = *key;
+        type->index = pool->type_count + owner->type_count++;
+        type->decorations_arr = duskArrayCreate(allocator, DuskIRDecoration);
+
+        duskTypeCacheInsert(&owner->type_cache, hash, type);
+        duskArrayPush(&owner->types_arr, type);
+        duskArrayPush(&owner->type_marks_arr, 0);
+
+        // Sub-types already have their layouts computed, so this takes
+        // constant time per field, and layouts are never computed lazily
+        // later on
+        for (uint32_t layout = 0; layout < DUSK_STRUCT_LAYOUT_COUNT;
+             ++layout) {
+            duskTypeSizeOf(allocator, type, (DuskStructLayout)layout);
+            duskTypeAlignOf(allocator, type, (DuskStructLayout)layout);
+        }
+    }
+    duskTypeUnlockOwner(compiler);
+
+    return duskTypeRequested(compiler, type);
+}
+
 bool duskTypeIsRuntime(DuskType *type)
 {
     if (!type) return false;
@@ -457,130 +924,118 @@ DuskType *duskGetScalarType(DuskType *type)
 
 DuskType *duskTypeNewBasic(DuskCompiler *compiler, DuskTypeKind kind)
 {
-    DuskAllocator *allocator = duskArenaGetAllocator(compiler->main_arena);
-    DuskType *type = DUSK_NEW(allocator, DuskType);
-    type->kind = kind;
-    return duskTypeGetCached(compiler, type);
+    DuskType type = {.kind = kind};
+    return duskTypeGetCached(compiler, &type);
 }
 
 DuskType *duskTypeNewScalar(DuskCompiler *compiler, DuskScalarType scalar_type)
 {
-    DuskAllocator *allocator = duskArenaGetAllocator(compiler->main_arena);
-    DuskType *type = DUSK_NEW(allocator, DuskType);
+    DuskType type = {0};
 
     switch (scalar_type) {
     case DUSK_SCALAR_TYPE_BYTE: {
-        type->kind = DUSK_TYPE_INT;
-        type->int_.is_signed = true;
-        type->int_.bits = 8;
+        type.kind = DUSK_TYPE_INT;
+        type.int_.is_signed = true;
+        type.int_.bits = 8;
         break;
     }
     case DUSK_SCALAR_TYPE_UBYTE: {
-        type->kind = DUSK_TYPE_INT;
-        type->int_.is_signed = false;
-        type->int_.bits = 8;
+        type.kind = DUSK_TYPE_INT;
+        type.int_.is_signed = false;
+        type.int_.bits = 8;
         break;
     }
     case DUSK_SCALAR_TYPE_SHORT: {
-        type->kind = DUSK_TYPE_INT;
-        type->int_.is_signed = true;
-        type->int_.bits = 16;
+        type.kind = DUSK_TYPE_INT;
+        type.int_.is_signed = true;
+        type.int_.bits = 16;
         break;
     }
     case DUSK_SCALAR_TYPE_USHORT: {
-        type->kind = DUSK_TYPE_INT;
-        type->int_.is_signed = false;
-        type->int_.bits = 16;
+        type.kind = DUSK_TYPE_INT;
+        type.int_.is_signed = false;
+        type.int_.bits = 16;
         break;
     }
     case DUSK_SCALAR_TYPE_INT: {
-        type->kind = DUSK_TYPE_INT;
-        type->int_.is_signed = true;
-        type->int_.bits = 32;
+        type.kind = DUSK_TYPE_INT;
+        type.int_.is_signed = true;
+        type.int_.bits = 32;
         break;
     }
     case DUSK_SCALAR_TYPE_UINT: {
-        type->kind = DUSK_TYPE_INT;
-        type->int_.is_signed = false;
-        type->int_.bits = 32;
+        type.kind = DUSK_TYPE_INT;
+        type.int_.is_signed = false;
+        type.int_.bits = 32;
         break;
     }
     case DUSK_SCALAR_TYPE_LONG: {
-        type->kind = DUSK_TYPE_INT;
-        type->int_.is_signed = true;
-        type->int_.bits = 64;
+        type.kind = DUSK_TYPE_INT;
+        type.int_.is_signed = true;
+        type.int_.bits = 64;
         break;
     }
     case DUSK_SCALAR_TYPE_ULONG: {
-        type->kind = DUSK_TYPE_INT;
-        type->int_.is_signed = false;
-        type->int_.bits = 64;
+        type.kind = DUSK_TYPE_INT;
+        type.int_.is_signed = false;
+        type.int_.bits = 64;
         break;
     }
     case DUSK_SCALAR_TYPE_HALF: {
-        type->kind = DUSK_TYPE_FLOAT;
-        type->float_.bits = 16;
+        type.kind = DUSK_TYPE_FLOAT;
+        type.float_.bits = 16;
         break;
     }
     case DUSK_SCALAR_TYPE_FLOAT: {
-        type->kind = DUSK_TYPE_FLOAT;
-        type->float_.bits = 32;
+        type.kind = DUSK_TYPE_FLOAT;
+        type.float_.bits = 32;
         break;
     }
     case DUSK_SCALAR_TYPE_DOUBLE: {
-        type->kind = DUSK_TYPE_FLOAT;
-        type->float_.bits = 64;
+        type.kind = DUSK_TYPE_FLOAT;
+        type.float_.bits = 64;
         break;
     }
     }
 
-    return duskTypeGetCached(compiler, type);
+    return duskTypeGetCached(compiler, &type);
 }
 
 DuskType *
 duskTypeNewVector(DuskCompiler *compiler, DuskType *sub, uint32_t size)
 {
-    DuskAllocator *allocator = duskArenaGetAllocator(compiler->main_arena);
-    DuskType *type = DUSK_NEW(allocator, DuskType);
-    type->kind = DUSK_TYPE_VECTOR;
-    type->vector.sub = sub;
-    type->vector.size = size;
-    return duskTypeGetCached(compiler, type);
+    DuskType type = {.kind = DUSK_TYPE_VECTOR};
+    type.vector.sub = sub;
+    type.vector.size = size;
+    return duskTypeGetCached(compiler, &type);
 }
 
 DuskType *
 duskTypeNewMatrix(DuskCompiler *compiler, DuskType *col_type, uint32_t cols)
 {
-    DuskAllocator *allocator = duskArenaGetAllocator(compiler->main_arena);
-    DuskType *type = DUSK_NEW(allocator, DuskType);
-    type->kind = DUSK_TYPE_MATRIX;
-    type->matrix.col_type = col_type;
-    type->matrix.cols = cols;
-    return duskTypeGetCached(compiler, type);
+    DuskType type = {.kind = DUSK_TYPE_MATRIX};
+    type.matrix.col_type = col_type;
+    type.matrix.cols = cols;
+    return duskTypeGetCached(compiler, &type);
 }
 
 DuskType *duskTypeNewRuntimeArray(
     DuskCompiler *compiler, DuskStructLayout layout, DuskType *sub)
 {
-    DuskAllocator *allocator = duskArenaGetAllocator(compiler->main_arena);
-    DuskType *type = DUSK_NEW(allocator, DuskType);
-    type->kind = DUSK_TYPE_RUNTIME_ARRAY;
-    type->array.sub = sub;
-    type->array.layout = layout;
-    return duskTypeGetCached(compiler, type);
+    DuskType type = {.kind = DUSK_TYPE_RUNTIME_ARRAY};
+    type.array.sub = sub;
+    type.array.layout = layout;
+    return duskTypeGetCached(compiler, &type);
 }
 
 DuskType *duskTypeNewArray(
     DuskCompiler *compiler, DuskStructLayout layout, DuskType *sub, size_t size)
 {
-    DuskAllocator *allocator = duskArenaGetAllocator(compiler->main_arena);
-    DuskType *type = DUSK_NEW(allocator, DuskType);
-    type->kind = DUSK_TYPE_ARRAY;
-    type->array.sub = sub;
-    type->array.size = size;
-    type->array.layout = layout;
-
-    return duskTypeGetCached(compiler, type);
+    DuskType type = {.kind = DUSK_TYPE_ARRAY};
+    type.array.sub = sub;
+    type.array.size = size;
+    type.array.layout = layout;
+    return duskTypeGetCached(compiler, &type);
 }
 
 DuskType *duskTypeNewStruct(
@@ -593,26 +1048,25 @@ DuskType *duskTypeNewStruct(
     DuskType **field_types,
     DuskArray(DuskAttribute) * field_attribute_arrays)
 {
+    DuskType key = {.kind = DUSK_TYPE_STRUCT};
+    key.struct_.name = name;
+    key.struct_.layout = layout;
+    key.struct_.is_block = is_block;
+    key.struct_.field_count = field_count;
+    key.struct_.field_names = field_names;
+    key.struct_.field_types = field_types;
+    key.struct_.field_attribute_arrays = field_attribute_arrays;
+
+    DuskType *existing_type = duskTypeFindCached(compiler, &key);
+    if (existing_type) return existing_type;
+
     DuskAllocator *allocator = duskArenaGetAllocator(compiler->main_arena);
-    DuskType *type = DUSK_NEW(allocator, DuskType);
-    type->kind = DUSK_TYPE_STRUCT;
-    type->struct_.name = name;
-    type->struct_.layout = layout;
-    type->struct_.is_block = is_block;
-    type->struct_.field_count = field_count;
-    type->struct_.field_names = field_names;
-    type->struct_.field_types = field_types;
-    type->struct_.field_attribute_arrays = field_attribute_arrays;
-
-    type->struct_.index_map = duskMapCreate(allocator, field_count);
+    key.struct_.index_map = duskMapCreate(allocator, field_count);
     for (uintptr_t i = 0; i < field_count; ++i) {
-        duskMapSet(type->struct_.index_map, field_names[i], (void *)i);
+        duskMapSet(key.struct_.index_map, field_names[i], (void *)i);
     }
 
-    duskTypeSizeOf(allocator, type, DUSK_STRUCT_LAYOUT_UNKNOWN);
-    duskTypeAlignOf(allocator, type, DUSK_STRUCT_LAYOUT_UNKNOWN);
-
-    return duskTypeGetCached(compiler, type);
+    return duskTypeGetCached(compiler, &key);
 }
 
 DuskType *duskTypeNewFunction(
@@ -621,33 +1075,39 @@ DuskType *duskTypeNewFunction(
     size_t param_type_count,
     DuskType **param_types)
 {
+    DuskType key = {.kind = DUSK_TYPE_FUNCTION};
+    key.function.return_type = return_type;
+    key.function.param_type_count = param_type_count;
+    key.function.param_types = param_types;
+
+    DuskType *existing_type = duskTypeFindCached(compiler, &key);
+    if (existing_type) return existing_type;
+
+    // The caller's array is only borrowed for the lookup
     DuskAllocator *allocator = duskArenaGetAllocator(compiler->main_arena);
-    DuskType *type = DUSK_NEW(allocator, DuskType);
-    type->kind = DUSK_TYPE_FUNCTION;
-    type->function.return_type = return_type;
-    type->function.param_type_count = param_type_count;
-    type->function.param_types =
+    key.function.param_types =
         DUSK_NEW_ARRAY(allocator, DuskType *, param_type_count);
     if (param_type_count > 0) {
         memcpy(
-            type->function.param_types,
+            key.function.param_types,
             param_types,
             sizeof(DuskType *) * param_type_count);
     }
 
-    return duskTypeGetCached(compiler, type);
+    return duskTypeGetCached(compiler, &key);
 }
 
 DuskType *duskTypeNewPointer(
-    DuskCompiler *compiler, DuskType *sub, DuskStorageClass storage_class, uint16_t alignment)
+    DuskCompiler *compiler,
+    DuskType *sub,
+    DuskStorageClass storage_class,
+    uint16_t alignment)
 {
-    DuskAllocator *allocator = duskArenaGetAllocator(compiler->main_arena);
-    DuskType *type = DUSK_NEW(allocator, DuskType);
-    type->kind = DUSK_TYPE_POINTER;
-    type->pointer.sub = sub;
-    type->pointer.storage_class = storage_class;
-    type->pointer.alignment = alignment;
-    return duskTypeGetCached(compiler, type);
+    DuskType type = {.kind = DUSK_TYPE_POINTER};
+    type.pointer.sub = sub;
+    type.pointer.storage_class = storage_class;
+    type.pointer.alignment = alignment;
+    return duskTypeGetCached(compiler, &type);
 }
 
 DuskType *duskTypeNewImage(
@@ -659,79 +1119,134 @@ DuskType *duskTypeNewImage(
     bool multisampled,
     bool sampled)
 {
-    DuskAllocator *allocator = duskArenaGetAllocator(compiler->main_arena);
-    DuskType *type = DUSK_NEW(allocator, DuskType);
-    type->kind = DUSK_TYPE_IMAGE;
-    type->image.sampled_type = sampled_type;
-    type->image.dim = (uint32_t)dim;
-    type->image.depth = (uint32_t)depth;
-    type->image.arrayed = (uint32_t)arrayed;
-    type->image.multisampled = (uint32_t)multisampled;
-    type->image.sampled = (uint32_t)sampled;
-    return duskTypeGetCached(compiler, type);
+    DuskType type = {.kind = DUSK_TYPE_IMAGE};
+    type.image.sampled_type = sampled_type;
+    type.image.dim = (uint32_t)dim;
+    type.image.depth = (uint32_t)depth;
+    type.image.arrayed = (uint32_t)arrayed;
+    type.image.multisampled = (uint32_t)multisampled;
+    type.image.sampled = (uint32_t)sampled;
+    return duskTypeGetCached(compiler, &type);
 }
 
 DuskType *duskTypeNewSampledImage(DuskCompiler *compiler, DuskType *image_type)
 {
-    DuskAllocator *allocator = duskArenaGetAllocator(compiler->main_arena);
-    DuskType *type = DUSK_NEW(allocator, DuskType);
-    type->kind = DUSK_TYPE_SAMPLED_IMAGE;
-    type->sampled_image.image_type = image_type;
-    return duskTypeGetCached(compiler, type);
+    DuskType type = {.kind = DUSK_TYPE_SAMPLED_IMAGE};
+    type.sampled_image.image_type = image_type;
+    return duskTypeGetCached(compiler, &type);
 }
 
-void duskTypeMarkNotDead(DuskType *type)
+void duskTypeMarkNotDead(DuskCompiler *compiler, DuskType *type)
 {
     DUSK_ASSERT(type);
-    type->emit = true;
 
-    switch (type->kind) {
-    case DUSK_TYPE_POINTER: {
-        duskTypeMarkNotDead(type->pointer.sub);
-        break;
+    if (compiler->type_owner) {
+        // The marks are shared with other threads, so types are marked by
+        // the owner once the threads are done
+        duskArrayPush(&compiler->marked_types_arr, type);
+        return;
     }
-    case DUSK_TYPE_VECTOR: {
-        duskTypeMarkNotDead(type->vector.sub);
-        break;
-    }
-    case DUSK_TYPE_RUNTIME_ARRAY:
-    case DUSK_TYPE_ARRAY: {
-        duskTypeMarkNotDead(type->array.sub);
-        break;
-    }
-    case DUSK_TYPE_MATRIX: {
-        duskTypeMarkNotDead(type->matrix.col_type);
-        break;
-    }
-    case DUSK_TYPE_STRUCT: {
-        for (size_t i = 0; i < type->struct_.field_count; ++i) {
-            duskTypeMarkNotDead(type->struct_.field_types[i]);
+
+    uint32_t *marks = compiler->type_marks_arr;
+    if (marks[type->index] == compiler->type_mark_epoch) return;
+
+    // Types are DAGs that share a lot of sub-types, so each one is only
+    // visited once per module. The stack is always left empty.
+    DuskArray(DuskType *) *stack_arr = &compiler->type_mark_stack_arr;
+    duskArrayPush(stack_arr, type);
+
+    while (duskArrayLength(*stack_arr) > 0) {
+        type = (*stack_arr)[duskArrayLength(*stack_arr) - 1];
+        duskArrayPop(stack_arr);
+
+        if (marks[type->index] == compiler->type_mark_epoch) continue;
+        marks[type->index] = compiler->type_mark_epoch;
+        duskArrayPush(&compiler->referenced_types_arr, type);
+
+        switch (type->kind) {
+        case DUSK_TYPE_POINTER: {
+            duskArrayPush(stack_arr, type->pointer.sub);
+            break;
         }
-        break;
-    }
-    case DUSK_TYPE_FUNCTION: {
-        duskTypeMarkNotDead(type->function.return_type);
-        for (size_t i = 0; i < type->function.param_type_count; ++i) {
-            duskTypeMarkNotDead(type->function.param_types[i]);
+        case DUSK_TYPE_VECTOR: {
+            duskArrayPush(stack_arr, type->vector.sub);
+            break;
+        }
+        case DUSK_TYPE_RUNTIME_ARRAY:
+        case DUSK_TYPE_ARRAY: {
+            duskArrayPush(stack_arr, type->array.sub);
+            break;
+        }
+        case DUSK_TYPE_MATRIX: {
+            duskArrayPush(stack_arr, type->matrix.col_type);
+            break;
+        }
+        case DUSK_TYPE_STRUCT: {
+            for (size_t i = 0; i < type->struct_.field_count; ++i) {
+                duskArrayPush(stack_arr, type->struct_.field_types[i]);
+            }
+            break;
+        }
+        case DUSK_TYPE_FUNCTION: {
+            duskArrayPush(stack_arr, type->function.return_type);
+            for (size_t i = 0; i < type->function.param_type_count; ++i) {
+                duskArrayPush(stack_arr, type->function.param_types[i]);
+            }
+            break;
+        }
+        case DUSK_TYPE_IMAGE: {
+            duskArrayPush(stack_arr, type->image.sampled_type);
+            break;
+        }
+        case DUSK_TYPE_SAMPLED_IMAGE: {
+            duskArrayPush(stack_arr, type->sampled_image.image_type);
+            break;
+        }
+        case DUSK_TYPE_SAMPLER:
+        case DUSK_TYPE_STRING:
+        case DUSK_TYPE_TYPE:
+        case DUSK_TYPE_FLOAT:
+        case DUSK_TYPE_INT:
+        case DUSK_TYPE_UNTYPED_FLOAT:
+        case DUSK_TYPE_UNTYPED_INT:
+        case DUSK_TYPE_BOOL:
+        case DUSK_TYPE_VOID: break;
         }
-        break;
-    }
-    case DUSK_TYPE_IMAGE: {
-        duskTypeMarkNotDead(type->image.sampled_type);
-        break;
-    }
-    case DUSK_TYPE_SAMPLED_IMAGE: {
-        duskTypeMarkNotDead(type->sampled_image.image_type);
-        break;
     }
-    case DUSK_TYPE_SAMPLER:
-    case DUSK_TYPE_STRING:
-    case DUSK_TYPE_TYPE:
-    case DUSK_TYPE_FLOAT:
-    case DUSK_TYPE_INT:
-    case DUSK_TYPE_UNTYPED_FLOAT:
-    case DUSK_TYPE_UNTYPED_INT:
-    case DUSK_TYPE_BOOL:
-    case DUSK_TYPE_VOID: break;
+}
+
+void duskTypeOrderNew(
+    DuskCompiler *compiler,
+    size_t first_new_type,
+    size_t requested_count,
+    DuskArray(DuskType *) * requested_arrs)
+{
+    size_t type_count = duskArrayLength(compiler->types_arr);
+    if (type_count == first_new_type) return;
+
+    // Borrow the marking epochs to tell apart new types that are yet to be
+    // placed
+    uint32_t *marks = compiler->type_marks_arr;
+    uint32_t new_epoch = ++compiler->type_mark_epoch;
+    for (size_t i = first_new_type; i < type_count; ++i) {
+        marks[compiler->types_arr[i]->index] = new_epoch;
+    }
+    uint32_t placed_epoch = ++compiler->type_mark_epoch;
+
+    duskArrayResize(&compiler->types_arr, first_new_type);
+    for (size_t i = 0; i < requested_count; ++i) {
+        DuskArray(DuskType *) types_arr = requested_arrs[i];
+        for (size_t j = 0; j < duskArrayLength(types_arr); ++j) {
+            DuskType *type = types_arr[j];
+            if (marks[type->index] != new_epoch) continue;
+            marks[type->index] = placed_epoch;
+            duskArrayPush(&compiler->types_arr, type);
+        }
     }
+
+    DUSK_ASSERT(duskArrayLength(compiler->types_arr) == type_count);
+
+    // None of the types count as marked by duskTypeMarkNotDead anymore, the
+    // ones that were are still in referenced_types_arr
+    compiler->type_mark_epoch++;
 }
@@ -26,15 +26,200 @@ static char *loadFile(const char *path, size_t *out_size)
     return data;
 }
 
+static bool writeFile(const char *path, const uint8_t *data, size_t size)
+{
+    FILE *f = fopen(path, "wb");
+    if (!f) return false;
+
+    fwrite(data, 1, size, f);
+
+    fclose(f);
+    return true;
+}
+
+// Writes the module of each entry point next to the output path, as
+// "<output path without .spv>.<entry point>.spv"
+static int compileEntryPoints(
+    DuskCompiler *compiler,
+    const char *in_path,
+    const char *text,
+    size_t text_size,
+    const char *out_path,
+    bool recompile)
+{
+    size_t module_count = 0;
+    DuskEntryPointModule *modules = duskCompileEntryPoints(
+        compiler, in_path, text, text_size, &module_count);
+    if (modules && recompile) {
+        modules = duskCompileEntryPoints(
+            compiler, in_path, text, text_size, &module_count);
+    }
+
+    if (!modules) {
+        char *errors = duskCompilerGetErrorsStringMalloc(compiler);
+        fprintf(stderr, "Compilation finished with errors:\n%s", errors);
+        free(errors);
+        exit(1);
+    }
+
+    if (!out_path) out_path = "a.spv";
+    size_t base_len = strlen(out_path);
+    if (base_len >= 4 && strcmp(out_path + base_len - 4, ".spv") == 0) {
+        base_len -= 4;
+    }
+
+    for (size_t i = 0; i < module_count; ++i) {
+        DuskEntryPointModule *module = &modules[i];
+        size_t path_size = base_len + strlen(module->name) + 6;
+        char *path = malloc(path_size);
+        snprintf(
+            path,
+            path_size,
+            "%.*s.%s.spv",
+            (int)base_len,
+            out_path,
+            module->name);
+
+        if (!writeFile(path, module->spirv, module->spirv_byte_size)) {
+            fprintf(stderr, "Failed to open output file: %s\n", path);
+            exit(1);
+        }
+        free(path);
+    }
+
+    duskCompilerDestroy(compiler);
+    return 0;
+}
+
+// Compiles the base file, then each file in edit_paths_arr with
+// duskCompileIncremental, as an edit of the text before it. Every step is also
+// compiled from scratch by a new compiler, and has to give the same output or
+// the same errors. The output of the last step is written to out_path.
+static int compileEdits(
+    DuskCompiler *compiler,
+    const char *in_path,
+    const char *text,
+    size_t text_size,
+    DuskArray(const char *) edit_paths_arr,
+    const uint8_t *prelude,
+    size_t prelude_size,
+    uint32_t thread_count,
+    const char *out_path)
+{
+    size_t output_size = 0;
+    uint8_t *output =
+        duskCompile(compiler, in_path, text, text_size, &output_size);
+
+    for (size_t i = 0; i < duskArrayLength(edit_paths_arr); ++i) {
+        const char *edit_path = edit_paths_arr[i];
+        size_t new_size = 0;
+        // The compiler keeps pointing into the texts of the previous steps,
+        // so they're never freed
+        const char *new_text = loadFile(edit_path, &new_size);
+        if (!new_text) {
+            fprintf(stderr, "Failed to open edit file: %s\n", edit_path);
+            exit(1);
+        }
+
+        // The edit is the smallest range that differs between the two texts
+        size_t min_size = text_size < new_size ? text_size : new_size;
+        size_t prefix = 0;
+        while (prefix < min_size && text[prefix] == new_text[prefix]) {
+            prefix++;
+        }
+        size_t suffix = 0;
+        while (suffix < min_size - prefix &&
+               text[text_size - 1 - suffix] ==
+                   new_text[new_size - 1 - suffix]) {
+            suffix++;
+        }
+
+        output = duskCompileIncremental(
+            compiler,
+            new_text,
+            new_size,
+            prefix,
+            text_size - prefix - suffix,
+            new_size - prefix - suffix,
+            &output_size);
+
+        DuskCompiler *reference = duskCompilerCreate();
+        duskCompilerSetThreadCount(reference, thread_count);
+        if (prelude) {
+            duskCompilerLoadPrelude(reference, prelude, prelude_size);
+        }
+        size_t reference_size = 0;
+        uint8_t *reference_output = duskCompile(
+            reference, in_path, new_text, new_size, &reference_size);
+
+        bool same;
+        if (output && reference_output) {
+            same = output_size == reference_size &&
+                   memcmp(output, reference_output, output_size) == 0;
+        } else if (!output && !reference_output) {
+            char *errors = duskCompilerGetErrorsStringMalloc(compiler);
+            char *reference_errors =
+                duskCompilerGetErrorsStringMalloc(reference);
+            same = strcmp(errors, reference_errors) == 0;
+            free(errors);
+            free(reference_errors);
+        } else {
+            same = false;
+        }
+        duskCompilerDestroy(reference);
+
+        if (!same) {
+            fprintf(
+                stderr,
+                "%s: incremental compilation differs from a full "
+                "compilation\n",
+                edit_path);
+            exit(1);
+        }
+
+        text = new_text;
+        text_size = new_size;
+    }
+
+    if (!output) {
+        char *errors = duskCompilerGetErrorsStringMalloc(compiler);
+        fprintf(stderr, "Compilation finished with errors:\n%s", errors);
+        free(errors);
+        exit(1);
+    }
+
+    if (!writeFile(out_path ? out_path : "a.spv", output, output_size)) {
+        fprintf(stderr, "Failed to open output file\n");
+        exit(1);
+    }
+
+    duskCompilerDestroy(compiler);
+    return 0;
+}
+
 int main(int argc, char *argv[])
 {
     (void)argc;
     (void)argv;
 
-    struct optparse_long longopts[] = {{"output", 'o', OPTPARSE_REQUIRED}, {0}};
+    struct optparse_long longopts[] = {
+        {"output", 'o', OPTPARSE_REQUIRED},
+        {"prelude", 'p', OPTPARSE_REQUIRED},
+        {"emit-prelude", 'E', OPTPARSE_NONE},
+        {"threads", 'j', OPTPARSE_REQUIRED},
+        {"recompile", 'r', OPTPARSE_NONE},
+        {"split-entry-points", 's', OPTPARSE_NONE},
+        {"edit", 'e', OPTPARSE_REQUIRED},
+        {0}};
 
     char *out_path = NULL;
     char *in_path = NULL;
+    char *prelude_path = NULL;
+    bool emit_prelude = false;
+    uint32_t thread_count = 0;
+    bool recompile = false;
+    bool split_entry_points = false;
+    DuskArray(const char *) edit_paths_arr = NULL;
 
     int option;
     struct optparse options;
@@ -48,6 +233,33 @@ int main(int argc, char *argv[])
             memcpy(out_path, options.optarg, out_path_len + 1);
             break;
         }
+        case 'p': {
+            prelude_path = options.optarg;
+            break;
+        }
+        case 'E': {
+            emit_prelude = true;
+            break;
+        }
+        case 'j': {
+            thread_count = (uint32_t)strtoul(options.optarg, NULL, 10);
+            break;
+        }
+        case 'r': {
+            recompile = true;
+            break;
+        }
+        case 's': {
+            split_entry_points = true;
+            break;
+        }
+        case 'e': {
+            if (!edit_paths_arr) {
+                edit_paths_arr = duskArrayCreate(NULL, const char *);
+            }
+            duskArrayPush(&edit_paths_arr, options.optarg);
+            break;
+        }
         case '?':
             fprintf(stderr, "%s: %s\n", argv[0], options.errmsg);
             exit(EXIT_FAILURE);
@@ -61,36 +273,86 @@ int main(int argc, char *argv[])
     }
 
     if (!in_path) {
-        fprintf(stderr, "Usage: %s [-o <output path>] <filename>\n", argv[0]);
+        fprintf(
+            stderr,
+            "Usage: %s [-o <output path>] [--prelude <prelude path>] "
+            "[--emit-prelude] [--threads <count>] [--recompile] "
+            "[--split-entry-points] [--edit <edited file>]... <filename>\n",
+            argv[0]);
         exit(EXIT_FAILURE);
     }
 
     DuskCompiler *compiler = duskCompilerCreate();
+    duskCompilerSetThreadCount(compiler, thread_count);
+
+    size_t prelude_size = 0;
+    const uint8_t *prelude = NULL;
+    if (prelude_path) {
+        prelude =
+            (const uint8_t *)loadFile(prelude_path, &prelude_size);
+        if (!prelude) {
+            fprintf(stderr, "Failed to open prelude file\n");
+            exit(1);
+        }
+
+        if (!duskCompilerLoadPrelude(compiler, prelude, prelude_size)) {
+            fprintf(stderr, "Invalid prelude file: %s\n", prelude_path);
+            exit(1);
+        }
+    }
 
     size_t text_size = 0;
     const char *text = loadFile(in_path, &text_size);
 
-    size_t spirv_size = 0;
-    uint8_t *spirv =
-        duskCompile(compiler, in_path, text, text_size, &spirv_size);
+    if (edit_paths_arr && !emit_prelude) {
+        int result = compileEdits(
+            compiler,
+            in_path,
+            text,
+            text_size,
+            edit_paths_arr,
+            prelude,
+            prelude_size,
+            thread_count,
+            out_path);
+        free(out_path);
+        return result;
+    }
+
+    if (split_entry_points && !emit_prelude) {
+        int result = compileEntryPoints(
+            compiler, in_path, text, text_size, out_path, recompile);
+        free(out_path);
+        return result;
+    }
+
+    size_t output_size = 0;
+    uint8_t *output = NULL;
+    if (emit_prelude) {
+        output = duskCompilePrelude(
+            compiler, in_path, text, text_size, &output_size);
+    } else {
+        output = duskCompile(compiler, in_path, text, text_size, &output_size);
+        // Compiles the file again with the same compiler, which reuses what
+        // was cached by the first compilation. The output should be the same.
+        if (output && recompile) {
+            output =
+                duskCompile(compiler, in_path, text, text_size, &output_size);
+        }
+    }
 
-    if (!spirv) {
+    if (!output) {
         char *errors = duskCompilerGetErrorsStringMalloc(compiler);
         fprintf(stderr, "Compilation finished with errors:\n%s", errors);
         free(errors);
         exit(1);
     }
 
-    FILE *f = fopen(out_path ? out_path : "a.spv", "wb");
-    if (!f) {
+    if (!writeFile(out_path ? out_path : "a.spv", output, output_size)) {
         fprintf(stderr, "Failed to open output file\n");
         exit(1);
     }
 
-    fwrite(spirv, 1, spirv_size, f);
-
-    fclose(f);
-
     duskCompilerDestroy(compiler);
     if (out_path) {
         free(out_path);
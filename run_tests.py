@@ -1,6 +1,6 @@
 #!/usr/bin/env python
 
-import os, subprocess
+import os, subprocess, filecmp, glob, re, struct
 
 # Go to base dir
 os.chdir(os.path.dirname(os.path.realpath(__file__)))
@@ -21,9 +21,244 @@ else:
     compiler_exe = "./build/duskc"
 
 
+# Commands taking longer than this many seconds fail, so that compile times
+# that grow exponentially with the input fail the tests instead of slowing
+# them down
+command_timeout = 60
+
 def run_proc(cmd_line):
     print("Running:", cmd_line)
-    return subprocess.run(cmd_line.split(" ")).returncode == 0
+    try:
+        result = subprocess.run(cmd_line.split(" "), timeout=command_timeout)
+    except subprocess.TimeoutExpired:
+        print(f"Timed out after {command_timeout} seconds")
+        return False
+    return result.returncode == 0
+
+# Options that shouldn't change the output of a valid test
+reproducibility_options = [
+    "",
+    "--threads 1",
+    "--threads 4",
+    "--recompile",
+]
+
+def run_reproducible(in_path, out_path):
+    repeat_path = out_path + ".repeat"
+    for options in reproducibility_options:
+        args = f"{options} {in_path}".strip()
+        if not run_proc(f"{compiler_exe} {args} -o {repeat_path}"):
+            return False
+        if not filecmp.cmp(out_path, repeat_path, shallow=False):
+            print(f"Output differs with options: '{options}'")
+            return False
+    os.remove(repeat_path)
+    return True
+
+# Names of the opcodes, from the SPIR-V header used by the compiler
+opcode_names = {}
+with open("dusk/spirv.h") as f:
+    for match in re.finditer(r"^\s*SpvOp(\w+) = (\d+),$", f.read(), re.M):
+        opcode_names.setdefault(int(match.group(2)), "Op" + match.group(1))
+
+# Returns the opcodes of a module with the number of loops each instruction is
+# in, counted from the loop merge instruction of their headers to their merge
+# blocks
+def read_opcodes(path):
+    with open(path, "rb") as f:
+        data = f.read()
+    words = struct.unpack(f"<{len(data) // 4}I", data)
+    opcodes = []
+    merge_blocks = []
+    # Skips the header
+    i = 5
+    while i < len(words):
+        opcode = opcode_names.get(words[i] & 0xffff, "OpUnknown")
+        if opcode == "OpLabel" and words[i + 1] in merge_blocks:
+            del merge_blocks[merge_blocks.index(words[i + 1]):]
+        elif opcode == "OpLoopMerge":
+            merge_blocks.append(words[i + 1])
+        opcodes.append((opcode, len(merge_blocks)))
+        i += max(words[i] >> 16, 1)
+    return opcodes
+
+# Valid tests can check the opcodes of their output, to make sure the
+# optimizations they test happened, or didn't:
+#   // CHECK: OpLoopMerge OpLoad     the opcodes appear in this order
+#   // CHECK-NOT: OpLoad OpStore     none of the opcodes appear
+#   // CHECK-COUNT-2: OpFAdd         each of the opcodes appears 2 times
+#   // CHECK-DEPTH-1: OpDot          each of the opcodes appears, and always
+#                                    inside exactly 1 loop
+# Every check looks at the whole module on its own. Checks followed by the name
+# of an entry point in parentheses, like CHECK-NOT(main), look at the module
+# of that entry point from --split-entry-points instead.
+check_pattern = re.compile(
+    r"//\s*CHECK(-NOT|-COUNT-(\d+)|-DEPTH-(\d+))?(\((\w+)\))?:(.*)$")
+
+def run_checks(in_path, out_path, entry_point=None):
+    opcodes = read_opcodes(out_path)
+    names = [opcode for opcode, _ in opcodes]
+    success = True
+    with open(in_path) as f:
+        lines = f.read().splitlines()
+    for line_index, line in enumerate(lines):
+        match = check_pattern.search(line)
+        if not match or match.group(5) != entry_point:
+            continue
+        expected = match.group(6).split()
+        if match.group(1) is None:
+            remaining = iter(names)
+            passed = all(opcode in remaining for opcode in expected)
+        elif match.group(1) == "-NOT":
+            passed = all(opcode not in names for opcode in expected)
+        elif match.group(2) is not None:
+            count = int(match.group(2))
+            passed = all(names.count(opcode) == count for opcode in expected)
+        else:
+            depths = {str(depth) for opcode, depth in opcodes
+                      if opcode in expected}
+            passed = (all(opcode in names for opcode in expected) and
+                      depths == {match.group(3)})
+        if not passed:
+            print(f"{in_path}:{line_index + 1}: check failed: {line.strip()}")
+            success = False
+    return success
+
+# Each entry point is also compiled to its own module, which has to be valid
+# on its own
+def run_split(in_path, out_path):
+    split_path = out_path.replace(".spv", ".split.spv")
+    split_pattern = split_path.replace(".spv", ".*.spv")
+    for path in glob.glob(split_pattern):
+        os.remove(path)
+    if not run_proc(f"{compiler_exe} --split-entry-points {in_path} -o {split_path}"):
+        return False
+    for path in sorted(glob.glob(split_pattern)):
+        if not run_proc(f"spirv-val {path}"):
+            return False
+        entry_point = path[len(split_path) - 3:-4]
+        if not run_checks(in_path, path, entry_point):
+            return False
+        os.remove(path)
+    return True
+
+# Each prelude in tests/preludes is written with --emit-prelude and loaded with
+# --prelude to compile the file next to it, which has to give the same output
+# as compiling both files as one. The blob also has to be rejected when any of
+# its bytes after the header is changed.
+prelude_header_size = 32
+
+def run_prelude(prelude_path, main_path):
+    name = os.path.basename(prelude_path)[:-len(".dusk")]
+    blob_path = f"tests/out/{name}.prelude"
+    out_path = f"tests/out/{name}.spv"
+    if not run_proc(f"{compiler_exe} --emit-prelude {prelude_path} -o {blob_path}"):
+        return False
+    if not run_proc(f"{compiler_exe} --prelude {blob_path} {main_path} -o {out_path}"):
+        return False
+    if not run_proc(f"spirv-val {out_path}"):
+        return False
+
+    combined_path = f"tests/out/{name}.combined.dusk"
+    with open(combined_path, "w") as combined:
+        for path in (prelude_path, main_path):
+            with open(path) as f:
+                combined.write(f.read())
+    if not run_proc(f"{compiler_exe} {combined_path} -o {out_path}.repeat"):
+        return False
+    if not filecmp.cmp(out_path, out_path + ".repeat", shallow=False):
+        print(f"Output differs from the one of {combined_path}")
+        return False
+
+    with open(blob_path, "rb") as f:
+        blob = f.read()
+    corrupt_path = f"tests/out/{name}.corrupt.prelude"
+    step = max((len(blob) - prelude_header_size) // 64, 1)
+    print(f"Loading {blob_path} with corrupted bytes")
+    for offset in range(prelude_header_size, len(blob), step):
+        corrupt = bytearray(blob)
+        corrupt[offset] ^= 0xff
+        with open(corrupt_path, "wb") as f:
+            f.write(corrupt)
+        result = subprocess.run(
+            [compiler_exe, "--prelude", corrupt_path, main_path,
+             "-o", out_path + ".repeat"],
+            capture_output=True, text=True)
+        if result.returncode != 1 or "Invalid prelude" not in result.stderr:
+            print(f"Corrupted byte at offset {offset} wasn't rejected:")
+            print(result.stderr)
+            return False
+
+    for path in (blob_path, combined_path, corrupt_path, out_path + ".repeat"):
+        os.remove(path)
+    return True
+
+# Each group of files in tests/edits, named <name>.<step>.dusk, is the text of
+# a file after each edit. The first step is compiled, then every other one is
+# compiled incrementally with --edit, which fails if the output or the errors
+# differ from compiling the same text from scratch.
+def run_edits(name, step_paths):
+    out_path = f"tests/out/{name}.edits.spv"
+    edit_args = " ".join(f"--edit {path}" for path in step_paths[1:])
+    if not run_proc(f"{compiler_exe} {step_paths[0]} {edit_args} -o {out_path}"):
+        return False
+    if not run_proc(f"spirv-val {out_path}"):
+        return False
+    os.remove(out_path)
+    return True
+
+# Files from 64 KiB on are parsed, analyzed and generated by several threads,
+# which is checked on generated files with hundreds of functions, each calling
+# the one before it. The functions listed in syntax_errors miss a semicolon,
+# and the ones in semantic_errors use a name that doesn't exist.
+parallel_min_length = 1 << 16
+large_function_count = 600
+
+def write_large_file(path, syntax_errors=(), semantic_errors=()):
+    lines = []
+    for i in range(large_function_count):
+        previous = f"f{i - 1}(x)" if i > 0 else "x"
+        end = "" if i in syntax_errors else ";"
+        value = "missing" if i in semantic_errors else "x"
+        lines += [
+            f"fn f{i}(x: float) float {{",
+            f"    var a = {value} * {i}.0 + 1.0{end}",
+            f"    var b = a * a - {previous};",
+            f"    if (b > a) {{ b = b * 0.5; }}",
+            f"    return a + b;",
+            f"}}",
+            f"",
+        ]
+    lines += [
+        "[stage(fragment)]",
+        "fn main([location(0)] uv: float2) [location(0)] float4 {",
+        f"    return float4(f{large_function_count - 1}(uv.x), uv.y, 0.0, 1.0);",
+        "}",
+    ]
+    text = "\n".join(lines) + "\n"
+    assert len(text) >= parallel_min_length
+    with open(path, "w") as f:
+        f.write(text)
+
+# An invalid file has to fail with the same errors with one thread or many
+def run_threaded_errors(in_path):
+    out_path = in_path.replace(".dusk", ".spv")
+    errors = []
+    for options in ("--threads 1", "--threads 4"):
+        print(f"Running: {compiler_exe} {options} {in_path}")
+        result = subprocess.run(
+            [compiler_exe, *options.split(), in_path, "-o", out_path],
+            capture_output=True, text=True)
+        if result.returncode == 0 or not result.stderr:
+            print(f"Compilation didn't fail with options: '{options}'")
+            return False
+        errors.append(result.stderr)
+    if errors[0] != errors[1]:
+        print("Errors differ with more threads:")
+        print(errors[1])
+        return False
+    os.remove(in_path)
+    return True
 
 tests = []
 for filename in os.listdir("./tests/"):
@@ -49,11 +284,68 @@ for test_name in tests:
         if not success:
             failed_tests.append(test_name)
             continue
+
+        success = run_checks(in_path, out_path)
+        if not success:
+            failed_tests.append(test_name)
+            continue
+
+        success = run_reproducible(in_path, out_path)
+        if not success:
+            failed_tests.append(test_name)
+            continue
+
+        success = run_split(in_path, out_path)
+        if not success:
+            failed_tests.append(test_name)
+            continue
     elif test_name.startswith("invalid"):
         if success:
             failed_tests.append(test_name)
             continue
 
+for main_path in sorted(glob.glob("tests/preludes/*.main.dusk")):
+    prelude_path = main_path.replace(".main.dusk", ".dusk")
+    print(f"\n=> Testing prelude: {prelude_path}")
+    if not run_prelude(prelude_path, main_path):
+        failed_tests.append(prelude_path)
+
+# The generated code has to be the same with any number of threads
+print("\n=> Testing: large_valid")
+large_path = "tests/out/large_valid.dusk"
+large_out_path = "tests/out/large_valid.spv"
+write_large_file(large_path)
+if (run_proc(f"{compiler_exe} {large_path} -o {large_out_path}") and
+        run_proc(f"spirv-val {large_out_path}") and
+        run_reproducible(large_path, large_out_path)):
+    os.remove(large_path)
+    os.remove(large_out_path)
+else:
+    failed_tests.append(large_path)
+
+print("\n=> Testing: large_syntax_error")
+large_path = "tests/out/large_syntax_error.dusk"
+write_large_file(large_path, syntax_errors=(large_function_count - 10,))
+if not run_threaded_errors(large_path):
+    failed_tests.append(large_path)
+
+# Errors found by different threads have to be reported in source order
+print("\n=> Testing: large_semantic_errors")
+large_path = "tests/out/large_semantic_errors.dusk"
+write_large_file(large_path, semantic_errors=range(5, large_function_count, 40))
+if not run_threaded_errors(large_path):
+    failed_tests.append(large_path)
+
+edit_steps = {}
+for path in glob.glob("tests/edits/*.dusk"):
+    name, step = os.path.basename(path).split(".")[:2]
+    edit_steps.setdefault(name, []).append((int(step), path))
+
+for name, steps in sorted(edit_steps.items()):
+    print(f"\n=> Testing edits: {name}")
+    if not run_edits(name, [path for _, path in sorted(steps)]):
+        failed_tests.append(f"tests/edits/{name}")
+
 
 if len(failed_tests) > 0:
     print("Tests failed:")